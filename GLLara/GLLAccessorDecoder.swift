@@ -0,0 +1,180 @@
+//
+//  GLLAccessorDecoder.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # Turns a whole glTF accessor into a plain array.
+ *
+ * glTF stores attributes in whatever type the exporter liked: floats, or (normalized) integers of various sizes, interleaved with other attributes or not, and optionally with sparse replacements. The rest of the program wants floats. This converts a whole accessor in one loop per component type, instead of looking at the type for every value.
+ */
+struct GLLAccessorDecoder {
+    enum ComponentType: Int {
+        case byte = 0x1400
+        case unsignedByte = 0x1401
+        case short = 0x1402
+        case unsignedShort = 0x1403
+        case unsignedInt = 0x1405
+        case float = 0x1406
+        
+        var size: Int {
+            switch self {
+            case .byte, .unsignedByte:
+                return 1
+            case .short, .unsignedShort:
+                return 2
+            case .unsignedInt, .float:
+                return 4
+            }
+        }
+    }
+    
+    let componentType: ComponentType
+    let componentCount: Int
+    let count: Int
+    let isNormalized: Bool
+    // Bytes from the start of one element to the next
+    let stride: Int
+    
+    static func componentCount(type: String) -> Int? {
+        switch type {
+        case "SCALAR":
+            return 1
+        case "VEC2":
+            return 2
+        case "VEC3":
+            return 3
+        case "VEC4", "MAT2":
+            return 4
+        case "MAT3":
+            return 9
+        case "MAT4":
+            return 16
+        default:
+            return nil
+        }
+    }
+    
+    // Nil if the types are not valid. Without a byte stride, the elements are tightly packed.
+    init?(componentType: Int, componentCount: Int, count: Int, isNormalized: Bool = false, byteStride: Int? = nil) {
+        guard let type = ComponentType(rawValue: componentType), componentCount > 0, count >= 0, !(isNormalized && type == .float) else {
+            return nil
+        }
+        self.componentType = type
+        self.componentCount = componentCount
+        self.count = count
+        self.isNormalized = isNormalized
+        self.stride = byteStride ?? componentCount * type.size
+        guard stride >= elementSize else {
+            return nil
+        }
+    }
+    
+    var elementSize: Int {
+        return componentCount * componentType.size
+    }
+    
+    // How many bytes the data has to have, from the start of the first element to the end of the last
+    var byteLength: Int {
+        return count == 0 ? 0 : (count - 1) * stride + elementSize
+    }
+    
+    // All values, element after element. The bytes start with the first element.
+    func floats(from bytes: UnsafeRawBufferPointer) -> [Float] {
+        precondition(bytes.count >= byteLength)
+        return Array(unsafeUninitializedCapacity: count * componentCount) { output, initializedCount in
+            switch componentType {
+            case .byte:
+                convert(bytes, into: output, as: Int8.self)
+            case .unsignedByte:
+                convert(bytes, into: output, as: UInt8.self)
+            case .short:
+                convert(bytes, into: output, as: Int16.self)
+            case .unsignedShort:
+                convert(bytes, into: output, as: UInt16.self)
+            case .unsignedInt:
+                convert(bytes, into: output, as: UInt32.self)
+            case .float:
+                if stride == elementSize {
+                    if count > 0 {
+                        UnsafeMutableRawPointer(output.baseAddress!).copyMemory(from: bytes.baseAddress!, byteCount: count * elementSize)
+                    }
+                } else {
+                    for element in 0 ..< count {
+                        for component in 0 ..< componentCount {
+                            output[element * componentCount + component] = bytes.loadUnaligned(fromByteOffset: element * stride + component * 4, as: Float.self)
+                        }
+                    }
+                }
+            }
+            initializedCount = count * componentCount
+        }
+    }
+    
+    // Same for integer data like indices. Normalization and floats do not make sense here.
+    func integers(from bytes: UnsafeRawBufferPointer) -> [UInt32] {
+        precondition(bytes.count >= byteLength && componentType != .float)
+        return Array(unsafeUninitializedCapacity: count * componentCount) { output, initializedCount in
+            switch componentType {
+            case .byte, .unsignedByte:
+                convert(bytes, into: output, as: UInt8.self)
+            case .short, .unsignedShort:
+                convert(bytes, into: output, as: UInt16.self)
+            case .unsignedInt, .float:
+                convert(bytes, into: output, as: UInt32.self)
+            }
+            initializedCount = count * componentCount
+        }
+    }
+    
+    // Signed normalized values go to -1 for both the smallest and the second smallest value, as the spec says. Dividing (instead of multiplying with the inverse) makes the largest value exactly 1.
+    @inline(__always)
+    private func convert<T: FixedWidthInteger>(_ bytes: UnsafeRawBufferPointer, into output: UnsafeMutableBufferPointer<Float>, as type: T.Type) {
+        let divisor: Float = isNormalized ? Float(T.max) : 1
+        let minimum: Float = isNormalized ? -1 : -.infinity
+        for element in 0 ..< count {
+            let start = element * stride
+            for component in 0 ..< componentCount {
+                let value = bytes.loadUnaligned(fromByteOffset: start + component * MemoryLayout<T>.size, as: T.self)
+                output[element * componentCount + component] = Swift.max(Float(value) / divisor, minimum)
+            }
+        }
+    }
+    
+    @inline(__always)
+    private func convert<T: FixedWidthInteger>(_ bytes: UnsafeRawBufferPointer, into output: UnsafeMutableBufferPointer<UInt32>, as type: T.Type) {
+        for element in 0 ..< count {
+            let start = element * stride
+            for component in 0 ..< componentCount {
+                output[element * componentCount + component] = UInt32(truncatingIfNeeded: bytes.loadUnaligned(fromByteOffset: start + component * MemoryLayout<T>.size, as: T.self))
+            }
+        }
+    }
+    
+    /**
+     * # Puts the values of a sparse accessor in place.
+     *
+     * The indices are tightly packed unsigned integers, the values are tightly packed and of the same type as this accessor. Returns false if an index is out of range.
+     */
+    func applySparse(count sparseCount: Int, indexComponentType: Int, indices: UnsafeRawBufferPointer, values: UnsafeRawBufferPointer, to floats: inout [Float]) -> Bool {
+        guard let indexDecoder = GLLAccessorDecoder(componentType: indexComponentType, componentCount: 1, count: sparseCount), indexDecoder.componentType != .float, indexDecoder.componentType != .byte, indexDecoder.componentType != .short, indices.count >= indexDecoder.byteLength, let valueDecoder = GLLAccessorDecoder(componentType: componentType.rawValue, componentCount: componentCount, count: sparseCount, isNormalized: isNormalized), values.count >= valueDecoder.byteLength else {
+            return false
+        }
+        let targets = indexDecoder.integers(from: indices)
+        let replacements = valueDecoder.floats(from: values)
+        for (index, target) in targets.enumerated() {
+            guard Int(target) < count else {
+                return false
+            }
+            for component in 0 ..< componentCount {
+                floats[Int(target) * componentCount + component] = replacements[index * componentCount + component]
+            }
+        }
+        return true
+    }
+}
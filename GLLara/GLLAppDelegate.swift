@@ -18,12 +18,18 @@ import Cocoa
             GLLPrefUseMSAA: false,
             GLLPrefAnisotropyAmount: 4,
             GLLPrefMSAAAmount: 2,
+            GLLPrefMaximumDepthPeelLayers: GLLDepthPeelEstimator.maximumLayers,
             GLLPrefObjExportIncludesTransforms: true,
             GLLPrefObjExportIncludesVertexColors: false,
+            GLLPrefMeshExportPosed: false,
             GLLPrefPoseExportIncludesUnused: false,
             GLLPrefPoseExportOnlySelected: true,
             GLLPrefShowSkeleton: true,
+            GLLPrefForceSoftwareRendering: false,
             GLLPrefHideUnusedBones: true,
+            GLLPrefQuantizeVertices: false,
+            GLLPrefUseLevelsOfDetail: true,
+            GLLPrefUseMeshletCulling: true,
             GLLPrefSpaceMouseSpeedTranslation: 1,
             GLLPrefSpaceMouseDeadzoneTranslation: 0.0,
             GLLPrefSpaceMouseSpeedRotation: 90.0 * Double.pi / 180.0,
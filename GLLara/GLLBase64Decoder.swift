@@ -0,0 +1,168 @@
+//
+//  GLLBase64Decoder.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # Decodes base64 in pieces, straight from bytes.
+ *
+ * glTF files can contain their buffers as data URIs, which can be hundreds of megabytes. Data(base64Encoded:) needs it all as one string first; this takes the bytes in any number of pieces, so it can work directly on the UTF-8 of the URI, and does 16 characters at a time where there is nothing unusual in them.
+ *
+ * Like .ignoreUnknownCharacters, anything that is not part of the alphabet (e.g. line breaks) gets skipped.
+ */
+struct GLLBase64Decoder {
+    private static let invalid: UInt8 = 0xFF
+    private static let padding: UInt8 = 0xFE
+    
+    // The six bit value of every character, or invalid or padding
+    private static let values: [UInt8] = {
+        var values = Array(repeating: GLLBase64Decoder.invalid, count: 256)
+        for (index, character) in "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/".utf8.enumerated() {
+            values[Int(character)] = UInt8(index)
+        }
+        values[Int(Character("=").asciiValue!)] = GLLBase64Decoder.padding
+        return values
+    }()
+    
+    private struct State {
+        // Characters of an incomplete group of four, six bits each
+        var group: UInt32 = 0
+        var groupCount = 0
+        var paddingCount = 0
+        var length = 0
+        var isValid = true
+        
+        mutating func decode(_ input: UnsafeRawBufferPointer, into output: UnsafeMutableBufferPointer<UInt8>) {
+            var position = 0
+            while position < input.count && isValid {
+                if groupCount == 0 && paddingCount == 0 && input.count - position >= 16 && GLLBase64Decoder.decodeBlock(input.loadUnaligned(fromByteOffset: position, as: SIMD16<UInt8>.self), into: output, at: length) {
+                    position += 16
+                    length += 12
+                    continue
+                }
+                
+                let value = GLLBase64Decoder.values[Int(input[position])]
+                position += 1
+                if value < 64 {
+                    // Nothing may follow the padding
+                    isValid = paddingCount == 0
+                    group = group << 6 | UInt32(value)
+                    groupCount += 1
+                    if groupCount == 4 {
+                        output[length] = UInt8(truncatingIfNeeded: group >> 16)
+                        output[length + 1] = UInt8(truncatingIfNeeded: group >> 8)
+                        output[length + 2] = UInt8(truncatingIfNeeded: group)
+                        length += 3
+                        group = 0
+                        groupCount = 0
+                    }
+                } else if value == GLLBase64Decoder.padding {
+                    paddingCount += 1
+                    isValid = groupCount >= 2 && groupCount + paddingCount <= 4
+                }
+            }
+        }
+        
+        // Writes the last incomplete group
+        mutating func finish(into output: UnsafeMutableBufferPointer<UInt8>) {
+            switch groupCount {
+            case 0:
+                break
+            case 2:
+                output[length] = UInt8(truncatingIfNeeded: group >> 4)
+                length += 1
+            case 3:
+                output[length] = UInt8(truncatingIfNeeded: group >> 10)
+                output[length + 1] = UInt8(truncatingIfNeeded: group >> 2)
+                length += 2
+            default:
+                isValid = false
+            }
+            groupCount = 0
+        }
+    }
+    
+    private var state = State()
+    private var output: [UInt8] = []
+    
+    init(expectedCount: Int = 0) {
+        output.reserveCapacity(expectedCount / 4 * 3 + 3)
+    }
+    
+    // False once something invalid turned up; everything after that gets ignored
+    var isValid: Bool {
+        return state.isValid
+    }
+    
+    mutating func decode(_ input: UnsafeRawBufferPointer) {
+        // Take the array out, so it can be written to without copying
+        var output: [UInt8] = []
+        swap(&output, &self.output)
+        let needed = state.length + (input.count + 4) / 4 * 3 + 3
+        if output.count < needed {
+            output.append(contentsOf: repeatElement(0, count: max(needed, output.count * 2) - output.count))
+        }
+        output.withUnsafeMutableBufferPointer { state.decode(input, into: $0) }
+        swap(&output, &self.output)
+    }
+    
+    // The decoded data, or nil if the input was not valid base64
+    mutating func finish() -> Data? {
+        var output: [UInt8] = []
+        swap(&output, &self.output)
+        if output.count < state.length + 3 {
+            output.append(contentsOf: repeatElement(0, count: state.length + 3 - output.count))
+        }
+        output.withUnsafeMutableBufferPointer { state.finish(into: $0) }
+        guard state.isValid else {
+            return nil
+        }
+        return Data(output.prefix(state.length))
+    }
+    
+    static func decode<S: StringProtocol>(_ string: S) -> Data? {
+        var decoder = GLLBase64Decoder(expectedCount: string.utf8.count)
+        var string = String(string)
+        string.withUTF8 { decoder.decode(UnsafeRawBufferPointer($0)) }
+        return decoder.finish()
+    }
+    
+    /**
+     * # Sixteen characters to twelve bytes.
+     *
+     * Returns false without writing anything if any of the characters is not part of the alphabet; the caller then does them one by one.
+     */
+    private static func decodeBlock(_ characters: SIMD16<UInt8>, into output: UnsafeMutableBufferPointer<UInt8>, at start: Int) -> Bool {
+        let upper = (characters .>= 65) .& (characters .<= 90)
+        let lower = (characters .>= 97) .& (characters .<= 122)
+        let digit = (characters .>= 48) .& (characters .<= 57)
+        let plus = characters .== 43
+        let slash = characters .== 47
+        guard all(upper .| lower .| digit .| plus .| slash) else {
+            return false
+        }
+        var values = characters &- 65
+        values.replace(with: characters &- 71, where: lower)
+        values.replace(with: characters &+ 4, where: digit)
+        values.replace(with: 62, where: plus)
+        values.replace(with: 63, where: slash)
+        
+        // The four characters of each group, for all four groups at once
+        let even = values.evenHalf, odd = values.oddHalf
+        let a = even.evenHalf, b = odd.evenHalf, c = even.oddHalf, d = odd.oddHalf
+        let first = a &<< 2 | b &>> 4
+        let second = (b & 0x0F) &<< 4 | c &>> 2
+        let third = (c & 0x03) &<< 6 | d
+        for group in 0 ..< 4 {
+            output[start + group * 3] = first[group]
+            output[start + group * 3 + 1] = second[group]
+            output[start + group * 3 + 2] = third[group]
+        }
+        return true
+    }
+}
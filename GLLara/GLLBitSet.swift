@@ -0,0 +1,86 @@
+//
+//  GLLBitSet.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # A set of small integers, stored as one bit each.
+ *
+ * Much more compact than a Set<Int> or [Bool], and checking membership needs no hashing.
+ */
+struct GLLBitSet: Equatable {
+    private(set) var words: [UInt64]
+    private(set) var count: Int
+    
+    init(count: Int) {
+        self.count = count
+        words = Array(repeating: 0, count: (count + 63) / 64)
+    }
+    
+    init(count: Int, members: [Int]) {
+        self.init(count: count)
+        for member in members {
+            insert(member)
+        }
+    }
+    
+    subscript(index: Int) -> Bool {
+        get {
+            return contains(index)
+        }
+        set {
+            if newValue {
+                insert(index)
+            } else {
+                remove(index)
+            }
+        }
+    }
+    
+    func contains(_ index: Int) -> Bool {
+        precondition(index >= 0 && index < count)
+        return words[index >> 6] & (1 << UInt64(index & 63)) != 0
+    }
+    
+    mutating func insert(_ index: Int) {
+        precondition(index >= 0 && index < count)
+        words[index >> 6] |= 1 << UInt64(index & 63)
+    }
+    
+    mutating func remove(_ index: Int) {
+        precondition(index >= 0 && index < count)
+        words[index >> 6] &= ~(1 << UInt64(index & 63))
+    }
+    
+    // Adds the bits of the other set after the existing ones
+    mutating func append(contentsOf other: GLLBitSet) {
+        let base = count
+        count += other.count
+        words.append(contentsOf: repeatElement(0, count: (count + 63) / 64 - words.count))
+        other.forEachMember { insert(base + $0) }
+    }
+    
+    var isEmpty: Bool {
+        return words.allSatisfy { $0 == 0 }
+    }
+    
+    var countOfMembers: Int {
+        return words.reduce(0) { $0 + $1.nonzeroBitCount }
+    }
+    
+    // Calls the action for every member, in ascending order
+    func forEachMember(_ action: (Int) throws -> Void) rethrows {
+        for (wordIndex, word) in words.enumerated() {
+            var remaining = word
+            while remaining != 0 {
+                try action(wordIndex * 64 + remaining.trailingZeroBitCount)
+                remaining &= remaining - 1
+            }
+        }
+    }
+}
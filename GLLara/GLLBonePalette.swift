@@ -0,0 +1,148 @@
+//
+//  GLLBonePalette.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # The bones that one mesh actually uses.
+ *
+ * Meshes store bone indices into the whole skeleton, but most of them only touch a few dozen of its bones. The palette lists the bones that are used, in ascending order, so that the indices can be rewritten to local ones (which usually fit in eight bits) and the renderer only has to provide the matrices for those bones to each mesh.
+ *
+ * Local index 0 is always bone 0, even if the mesh does not reference it, because the vertex shader uses that bone's transform for the tangent space.
+ */
+struct GLLBonePalette {
+    // Global bone index for every local index
+    let bones: [UInt16]
+    // Local index for every global index up to the highest one used, -1 for bones that are not used
+    private let localIndices: [Int32]
+    
+    // Palette for meshes without bone data; contains only bone 0.
+    init() {
+        self.init(used: [true])
+    }
+    
+    // Palette that contains every bone of a skeleton, i.e. local and global indices are the same.
+    init(boneCount: Int) {
+        self.init(used: Array(repeating: true, count: max(boneCount, 1)))
+    }
+    
+    // Palette for the fixed four bones per vertex layout.
+    init(indices: [SIMD4<UInt16>]) {
+        var used = [true]
+        for index in indices {
+            for i in 0 ..< 4 {
+                GLLBonePalette.mark(index[i], in: &used)
+            }
+        }
+        self.init(used: used)
+    }
+    
+    // Palette for the variable bones per vertex layout.
+    init(indices: [UInt16]) {
+        var used = [true]
+        for index in indices {
+            GLLBonePalette.mark(index, in: &used)
+        }
+        self.init(used: used)
+    }
+    
+    private init(used: [Bool]) {
+        var bones: [UInt16] = []
+        var localIndices = Array(repeating: Int32(-1), count: used.count)
+        for (bone, isUsed) in used.enumerated() where isUsed {
+            localIndices[bone] = Int32(bones.count)
+            bones.append(UInt16(bone))
+        }
+        self.bones = bones
+        self.localIndices = localIndices
+    }
+    
+    private static func mark(_ bone: UInt16, in used: inout [Bool]) {
+        let index = Int(bone)
+        if index >= used.count {
+            used.append(contentsOf: repeatElement(false, count: index + 1 - used.count))
+        }
+        used[index] = true
+    }
+    
+    var count: Int {
+        return bones.count
+    }
+    
+    // Whether the local indices fit in an UInt8, so the vertex data can use uchar4 instead of ushort4.
+    var fitsInUInt8: Bool {
+        return bones.count <= Int(UInt8.max) + 1
+    }
+    
+    // Number of matrices the vertex shader needs for this palette; the normal permutation plus one per bone.
+    var matrixCount: Int {
+        return 1 + bones.count
+    }
+    
+    func localIndex(of bone: UInt16) -> Int {
+        let local = Int(bone) < localIndices.count ? Int(localIndices[Int(bone)]) : -1
+        precondition(local >= 0, "Bone \(bone) is not in the palette")
+        return local
+    }
+    
+    func remapped(_ indices: [SIMD4<UInt16>]) -> [SIMD4<UInt16>] {
+        return indices.map { index in
+            SIMD4<UInt16>(UInt16(localIndex(of: index.x)), UInt16(localIndex(of: index.y)), UInt16(localIndex(of: index.z)), UInt16(localIndex(of: index.w)))
+        }
+    }
+    
+    func remapped8Bit(_ indices: [SIMD4<UInt16>]) -> [SIMD4<UInt8>] {
+        precondition(fitsInUInt8)
+        return indices.map { index in
+            SIMD4<UInt8>(UInt8(localIndex(of: index.x)), UInt8(localIndex(of: index.y)), UInt8(localIndex(of: index.z)), UInt8(localIndex(of: index.w)))
+        }
+    }
+    
+    func remapped(_ indices: [UInt16]) -> [UInt16] {
+        return indices.map { UInt16(localIndex(of: $0)) }
+    }
+    
+    /**
+     * # Writes the matrices for this palette.
+     *
+     * Uses the layout that xnaLaraVertex expects: First the permutation for the normals, then one transform per entry in the palette. Bones that the skeleton does not have (only possible with broken files) get the identity.
+     *
+     * If there is a vertex transform, it gets applied before every bone transform; quantized meshes use that to scale their positions back up.
+     *
+     * The destination must have space for matrixCount matrices.
+     */
+    func gather(permutation: matrix_float4x4, boneTransforms: UnsafeBufferPointer<matrix_float4x4>, into destination: UnsafeMutablePointer<matrix_float4x4>, vertexTransform: matrix_float4x4? = nil) {
+        destination[0] = permutation
+        for (local, bone) in bones.enumerated() {
+            let boneTransform = Int(bone) < boneTransforms.count ? boneTransforms[Int(bone)] : matrix_identity_float4x4
+            destination[1 + local] = vertexTransform.map { boneTransform * $0 } ?? boneTransform
+        }
+    }
+    
+    func gather(permutation: matrix_float4x4, boneTransforms: [matrix_float4x4]) -> [matrix_float4x4] {
+        return [matrix_float4x4](unsafeUninitializedCapacity: matrixCount) { buffer, initializedCount in
+            boneTransforms.withUnsafeBufferPointer {
+                gather(permutation: permutation, boneTransforms: $0, into: buffer.baseAddress!)
+            }
+            initializedCount = matrixCount
+        }
+    }
+    
+    // One line per mesh with the size of its palette, for the log.
+    static func report(meshNames: [String], palettes: [GLLBonePalette], totalBones: Int) -> String {
+        var result = ""
+        for (name, palette) in zip(meshNames, palettes) {
+            let indexSize = palette.fitsInUInt8 ? "8" : "16"
+            result += "\(name): \(palette.count) of \(totalBones) bones, \(indexSize)-bit indices\n"
+        }
+        let matrices = palettes.reduce(0) { $0 + $1.matrixCount }
+        result += "Total: \(matrices) matrices gathered per frame, skeleton has \(1 + totalBones)\n"
+        return result
+    }
+}
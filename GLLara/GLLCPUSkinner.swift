@@ -0,0 +1,211 @@
+//
+//  GLLCPUSkinner.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # Skinning on the CPU.
+ *
+ * Does the same vertex transformation as xnaLaraVertex in XnaLaraShader.metal, for both the fixed four bones per vertex and the variable bones per vertex layouts, and additionally transforms the tangents. It is used by all exporters that need posed vertices and does not depend on Metal, so it also works without a GPU.
+ *
+ * The transforms are indexed by bone index, i.e. unlike the transforms buffer on the GPU there is no permutation matrix at index 0. Meshes without bone data use the first transform, like the shader does.
+ */
+final class GLLCPUSkinner {
+    enum BoneData {
+        case none
+        case fixed(indices: [SIMD4<UInt16>], weights: [SIMD4<Float>])
+        case variable(offsetLength: [SIMD2<UInt16>], indices: [UInt16], weights: [Float])
+    }
+    
+    struct Output {
+        var positions: [SIMD3<Float>]
+        var normals: [SIMD3<Float>]
+        // One array per UV layer
+        var tangents: [[SIMD4<Float>]]
+    }
+    
+    let positions: [SIMD3<Float>]
+    let normals: [SIMD3<Float>]
+    let tangents: [[SIMD4<Float>]]
+    let boneData: BoneData
+    
+    var countOfVertices: Int {
+        return positions.count
+    }
+    
+    // Number of vertices that one worker handles at a time. Large enough that the dispatch overhead does not matter, small enough to spread well over all cores.
+    static let verticesPerChunk = 4096
+    
+    /**
+     * # Runs body once for every iteration.
+     *
+     * On all cores, or one after the other on the calling thread if concurrent is false. The serial version is there so tests can check that the results do not depend on the order.
+     */
+    static func perform(iterations: Int, concurrent: Bool = true, _ body: (Int) -> Void) {
+        if concurrent {
+            DispatchQueue.concurrentPerform(iterations: iterations, execute: body)
+        } else {
+            for iteration in 0 ..< iterations {
+                body(iteration)
+            }
+        }
+    }
+    
+    // Number of chunks of verticesPerChunk elements needed for count elements
+    static func chunkCount(_ count: Int) -> Int {
+        return (count + verticesPerChunk - 1) / verticesPerChunk
+    }
+    
+    // Runs body with the index and range of every chunk of 0 ..< count, as perform does. Other code that works on vertices or triangles in parallel uses the same chunks.
+    static func forEachChunk(count: Int, concurrent: Bool = true, _ body: (_ chunk: Int, _ range: Range<Int>) -> Void) {
+        perform(iterations: chunkCount(count), concurrent: concurrent) { chunk in
+            let start = chunk * verticesPerChunk
+            body(chunk, start ..< min(start + verticesPerChunk, count))
+        }
+    }
+    
+    init(positions: [SIMD3<Float>], normals: [SIMD3<Float>], tangents: [[SIMD4<Float>]] = [], boneData: BoneData) {
+        precondition(normals.count == positions.count)
+        precondition(tangents.allSatisfy { $0.count == positions.count })
+        
+        self.positions = positions
+        self.normals = normals
+        self.tangents = tangents
+        self.boneData = boneData
+    }
+    
+    // Morph deltas, if any, get added to the positions and normals before the bones move them
+    func skin(transforms: [matrix_float4x4], morphDeltas: GLLMorphTargetSet.Deltas? = nil) -> Output {
+        precondition(!transforms.isEmpty)
+        precondition(morphDeltas == nil || (morphDeltas!.positions.count == countOfVertices && morphDeltas!.normals.count == countOfVertices))
+        
+        let count = countOfVertices
+        let layers = tangents.count
+        var skinnedPositions = Array(repeating: SIMD3<Float>(), count: count)
+        var skinnedNormals = Array(repeating: SIMD3<Float>(), count: count)
+        // All layers in one array, so there is a fixed number of buffers to write to
+        var skinnedTangents = Array(repeating: SIMD4<Float>(), count: count * layers)
+        
+        // Without morphing, these are empty
+        let morphPositions = morphDeltas?.positions ?? []
+        let morphNormals = morphDeltas?.normals ?? []
+        
+        transforms.withUnsafeBufferPointer { transforms in
+            skinnedPositions.withUnsafeMutableBufferPointer { outPositions in
+                skinnedNormals.withUnsafeMutableBufferPointer { outNormals in
+                    skinnedTangents.withUnsafeMutableBufferPointer { outTangents in
+                        morphPositions.withUnsafeBufferPointer { morphPositions in
+                            morphNormals.withUnsafeBufferPointer { morphNormals in
+                                GLLCPUSkinner.forEachChunk(count: count) { _, range in
+                                    skin(range: range, transforms: transforms, morphPositions: morphPositions, morphNormals: morphNormals, positions: outPositions, normals: outNormals, tangents: outTangents)
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        
+        let tangentLayers = (0 ..< layers).map { Array(skinnedTangents[$0 * count ..< ($0 + 1) * count]) }
+        return Output(positions: skinnedPositions, normals: skinnedNormals, tangents: tangentLayers)
+    }
+    
+    private func skin(range: Range<Int>, transforms: UnsafeBufferPointer<matrix_float4x4>, morphPositions: UnsafeBufferPointer<SIMD3<Float>>, morphNormals: UnsafeBufferPointer<SIMD3<Float>>, positions outPositions: UnsafeMutableBufferPointer<SIMD3<Float>>, normals outNormals: UnsafeMutableBufferPointer<SIMD3<Float>>, tangents outTangents: UnsafeMutableBufferPointer<SIMD4<Float>>) {
+        let count = countOfVertices
+        let isMorphed = !morphPositions.isEmpty
+        positions.withUnsafeBufferPointer { positions in
+            normals.withUnsafeBufferPointer { normals in
+                @inline(__always) func write(vertex: Int, transform: matrix_float4x4) {
+                    let basePosition = isMorphed ? positions[vertex] + morphPositions[vertex] : positions[vertex]
+                    let position = transform * SIMD4<Float>(basePosition, 1)
+                    outPositions[vertex] = SIMD3<Float>(position.x, position.y, position.z)
+                    
+                    // Upper left 3x3 only, done by setting w to 0
+                    let baseNormal = isMorphed ? normals[vertex] + morphNormals[vertex] : normals[vertex]
+                    let normal = transform * SIMD4<Float>(baseNormal, 0)
+                    outNormals[vertex] = SIMD3<Float>(normal.x, normal.y, normal.z)
+                    
+                    for layer in 0 ..< tangents.count {
+                        let tangent = tangents[layer][vertex]
+                        var transformed = transform * SIMD4<Float>(tangent.x, tangent.y, tangent.z, 0)
+                        // Keep the handedness
+                        transformed.w = tangent.w
+                        outTangents[layer * count + vertex] = transformed
+                    }
+                }
+                
+                // Blend the bone matrices exactly as the shader does
+                switch boneData {
+                case .none:
+                    for vertex in range {
+                        write(vertex: vertex, transform: transforms[0])
+                    }
+                case .fixed(let indices, let weights):
+                    indices.withUnsafeBufferPointer { indices in
+                        weights.withUnsafeBufferPointer { weights in
+                            for vertex in range {
+                                let index = indices[vertex]
+                                let weight = weights[vertex]
+                                let transform = transforms[Int(index.x)] * weight.x
+                                    + transforms[Int(index.y)] * weight.y
+                                    + transforms[Int(index.z)] * weight.z
+                                    + transforms[Int(index.w)] * weight.w
+                                write(vertex: vertex, transform: transform)
+                            }
+                        }
+                    }
+                case .variable(let offsetLength, let indices, let weights):
+                    offsetLength.withUnsafeBufferPointer { offsetLength in
+                        indices.withUnsafeBufferPointer { indices in
+                            weights.withUnsafeBufferPointer { weights in
+                                for vertex in range {
+                                    let start = Int(offsetLength[vertex].x)
+                                    let end = start + Int(offsetLength[vertex].y)
+                                    var transform = matrix_float4x4()
+                                    for i in start ..< end {
+                                        transform += transforms[Int(indices[i])] * weights[i]
+                                    }
+                                    write(vertex: vertex, transform: transform)
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+extension GLLCPUSkinner.BoneData {
+    /**
+     * # The bone with the most influence on a point in a triangle.
+     *
+     * The weights of the three corners get mixed with the barycentric coordinates, per bone. Ties go to the lower bone index. Without bone data, everything moves with the first bone.
+     */
+    func dominantBone(corners: SIMD3<UInt32>, barycentrics: SIMD3<Float>) -> Int {
+        var influence: [Int: Float] = [:]
+        for corner in 0 ..< 3 {
+            let vertex = Int(corners[corner])
+            switch self {
+            case .none:
+                return 0
+            case .fixed(let indices, let weights):
+                for i in 0 ..< 4 {
+                    influence[Int(indices[vertex][i]), default: 0] += weights[vertex][i] * barycentrics[corner]
+                }
+            case .variable(let offsetLength, let indices, let weights):
+                let start = Int(offsetLength[vertex].x)
+                for i in start ..< start + Int(offsetLength[vertex].y) {
+                    influence[Int(indices[i]), default: 0] += weights[i] * barycentrics[corner]
+                }
+            }
+        }
+        return influence.max { $0.value < $1.value || ($0.value == $1.value && $0.key > $1.key) }?.key ?? 0
+    }
+}
@@ -0,0 +1,160 @@
+//
+//  GLLChangeBatch.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import CoreData
+
+/**
+ * # The work that a change batch puts off until it ends.
+ *
+ * The stages get processed in this order, and work in one stage can schedule work in later ones.
+ */
+@objc enum GLLChangeBatchStage: Int, CaseIterable {
+    // Relative transform of a single bone
+    case boneTransforms
+    // Global transforms of all bones of a root item
+    case globalTransforms
+    // Telling a scene drawer to draw again
+    case redraw
+}
+
+/**
+ * # Groups many changes to the document into one.
+ *
+ * Normally every setter of a bone or item immediately updates all the global transforms that depend on it, which in turn makes every drawer ask for a redraw. Resetting all six values of every bone in a skeleton does that six times per bone. While a batch is open, these updates get collected instead, with each object only once per stage, and performed when the outermost batch ends. The whole batch also becomes a single undo step.
+ *
+ * Batches can be nested; only ending the outermost one does anything. They must only be used on the main thread, like the managed object context itself.
+ */
+@objc class GLLChangeBatch: NSObject {
+    private weak var context: NSManagedObjectContext?
+    private var depth = 0
+    private var startedUndoGroup = false
+    // While ending the batch, the stage whose updates are running right now
+    private var replayingStage: GLLChangeBatchStage? = nil
+    
+    private var pending: [[(object: AnyObject, action: () -> Void)]]
+    private var pendingKeys: [Set<ObjectIdentifier>]
+    
+    // Statistics since the batch was created, by stage
+    private var deferredCounts: [Int]
+    private var performedCounts: [Int]
+    @objc private(set) var completedBatches = 0
+    
+    @objc init(context: NSManagedObjectContext?) {
+        self.context = context
+        let stageCount = GLLChangeBatchStage.allCases.count
+        pending = Array(repeating: [], count: stageCount)
+        pendingKeys = Array(repeating: [], count: stageCount)
+        deferredCounts = Array(repeating: 0, count: stageCount)
+        performedCounts = Array(repeating: 0, count: stageCount)
+    }
+    
+    @objc var isActive: Bool {
+        return depth > 0 || replayingStage != nil
+    }
+    
+    @objc func begin() {
+        if depth == 0 && replayingStage == nil, let undoManager = context?.undoManager {
+            undoManager.beginUndoGrouping()
+            startedUndoGroup = true
+        }
+        depth += 1
+    }
+    
+    /**
+     * # Closes the batch.
+     *
+     * If this was the outermost one, performs all collected updates, registers the changes for undo and names the undo step (if an action name is given).
+     */
+    @objc(endWithActionName:) func end(actionName: String? = nil) {
+        precondition(depth > 0, "Ending a change batch that was never started")
+        depth -= 1
+        guard depth == 0, replayingStage == nil else {
+            return
+        }
+        
+        for stage in GLLChangeBatchStage.allCases {
+            replayingStage = stage
+            let updates = pending[stage.rawValue]
+            pending[stage.rawValue] = []
+            pendingKeys[stage.rawValue] = []
+            for update in updates {
+                update.action()
+            }
+            performedCounts[stage.rawValue] += updates.count
+        }
+        replayingStage = nil
+        completedBatches += 1
+        
+        if startedUndoGroup, let context = context {
+            // Core Data registers its undo actions here, so this has to happen within the group
+            context.processPendingChanges()
+            if let actionName = actionName {
+                context.undoManager?.setActionName(actionName)
+            }
+            context.undoManager?.endUndoGrouping()
+        }
+        startedUndoGroup = false
+    }
+    
+    @objc(performWithActionName:block:) func perform(actionName: String?, _ block: () -> Void) {
+        begin()
+        block()
+        end(actionName: actionName)
+    }
+    
+    /**
+     * # Schedules an update for the end of the batch.
+     *
+     * Returns false if there is no open batch, or the stage has already been processed; in that case the caller has to do the update immediately. If an update for the same object and stage is already scheduled, the new action is dropped, so it must do the same thing as the first one.
+     */
+    @objc(deferUpdateOf:stage:action:) func deferUpdate(of object: AnyObject, stage: GLLChangeBatchStage, action: @escaping () -> Void) -> Bool {
+        if let replayingStage = replayingStage {
+            if stage.rawValue <= replayingStage.rawValue {
+                return false
+            }
+        } else if depth == 0 {
+            return false
+        }
+        
+        deferredCounts[stage.rawValue] += 1
+        if pendingKeys[stage.rawValue].insert(ObjectIdentifier(object)).inserted {
+            pending[stage.rawValue].append((object, action))
+        }
+        return true
+    }
+    
+    @objc(deferredUpdatesInStage:) func deferredUpdates(in stage: GLLChangeBatchStage) -> Int {
+        return deferredCounts[stage.rawValue]
+    }
+    
+    @objc(performedUpdatesInStage:) func performedUpdates(in stage: GLLChangeBatchStage) -> Int {
+        return performedCounts[stage.rawValue]
+    }
+    
+    // How many notifications were saved by merging them with others
+    @objc(coalescedUpdatesInStage:) func coalescedUpdates(in stage: GLLChangeBatchStage) -> Int {
+        return deferredUpdates(in: stage) - performedUpdates(in: stage) - pending[stage.rawValue].count
+    }
+    
+    @objc var coalescedUpdates: Int {
+        return GLLChangeBatchStage.allCases.reduce(0) { $0 + coalescedUpdates(in: $1) }
+    }
+}
+
+extension NSManagedObjectContext {
+    // The change batch for all objects in this context, created when first needed
+    @objc var changeBatch: GLLChangeBatch {
+        if let batch = userInfo["GLLChangeBatch"] as? GLLChangeBatch {
+            return batch
+        }
+        let batch = GLLChangeBatch(context: self)
+        userInfo["GLLChangeBatch"] = batch
+        return batch
+    }
+}
@@ -0,0 +1,123 @@
+//
+//  GLLDepthPeelEstimator.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # Guesses how many depth peel layers a frame needs.
+ *
+ * Every peel layer is a full pass over all blended meshes plus a full screen texture, so drawing all seven when no transparent mesh is in view is a waste. This projects the bounding box of every visible blended mesh to the screen and counts, on a coarse grid, how many of them can cover the same spot.
+ *
+ * A single mesh like hair or a skirt can be in front of itself many times, and a box says nothing about that. So each mesh counts for all layers, unless the caller knows a bound for its depth complexity, i.e. how often it can cover one pixel at most. With those bounds, the layers are the largest sum of them over any spot. Only then does the estimate go below the limit; without any visible blended mesh, it is zero.
+ *
+ * The boxes and bounds are conservative, so the estimate is too; it is never lower than what the meshes can need, except for the user's limit. Anything that can't be projected properly, like a box crossing the camera plane, counts as covering the whole screen.
+ */
+struct GLLDepthPeelEstimator {
+    // What the GPU surface can do at most, one texture less than it has, since the first one is for solid meshes
+    static let maximumLayers = 7
+    
+    struct Estimate: CustomStringConvertible {
+        var blendedMeshes = 0
+        // The most blended meshes that touch the same grid cell
+        var maximumOverlap = 0
+        // The largest sum of depth complexities in one grid cell, or the limit for meshes without a bound
+        var maximumDepthComplexity = 0
+        var layers = 0
+        
+        var description: String {
+            return "\(layers) peel layers for \(blendedMeshes) blended meshes, at most \(maximumOverlap) overlapping with depth complexity \(maximumDepthComplexity)"
+        }
+    }
+    
+    // The user's quality setting
+    var maximumLayers = GLLDepthPeelEstimator.maximumLayers
+    // Cells per side of the screen
+    var gridSize = 32
+    
+    /**
+     * # The layers needed for the blended meshes in view.
+     *
+     * The boxes are in world space, one per visible blended mesh; nil for those that have no box. The depth complexities, if given, are in the same order: How many surfaces of that mesh can be on top of each other at one pixel at most. Without them, every mesh can need all layers.
+     */
+    func estimate(blendedBounds: [GLLBoundingBox?], depthComplexities: [Int]? = nil, viewProjection: matrix_float4x4) -> Estimate {
+        precondition(depthComplexities == nil || depthComplexities!.count == blendedBounds.count)
+        var estimate = Estimate()
+        guard !blendedBounds.isEmpty, maximumLayers > 0 else {
+            estimate.blendedMeshes = blendedBounds.count
+            return estimate
+        }
+        
+        // Coverage as a two dimensional difference array: +1 at the start of each rectangle, -1 after its ends. Summing that up gives the count per cell, without touching every cell for every mesh. The same for the depth complexity, with the mesh's bound instead of 1.
+        let rowLength = gridSize + 1
+        var differences = Array(repeating: SIMD2<Int>(), count: rowLength * rowLength)
+        for (index, bounds) in blendedBounds.enumerated() {
+            guard let cells = cells(covering: bounds, viewProjection: viewProjection) else {
+                continue
+            }
+            estimate.blendedMeshes += 1
+            let value = SIMD2<Int>(1, min(depthComplexities?[index] ?? maximumLayers, maximumLayers))
+            differences[cells.minY * rowLength + cells.minX] &+= value
+            differences[cells.minY * rowLength + cells.maxX + 1] &-= value
+            differences[(cells.maxY + 1) * rowLength + cells.minX] &-= value
+            differences[(cells.maxY + 1) * rowLength + cells.maxX + 1] &+= value
+        }
+        
+        var rowSums = Array(repeating: SIMD2<Int>(), count: rowLength)
+        var maximum = SIMD2<Int>()
+        for y in 0 ..< gridSize {
+            var sum = SIMD2<Int>()
+            for x in 0 ..< gridSize {
+                sum &+= differences[y * rowLength + x]
+                rowSums[x] &+= sum
+                maximum = pointwiseMax(maximum, rowSums[x])
+            }
+        }
+        estimate.maximumOverlap = maximum.x
+        estimate.maximumDepthComplexity = maximum.y
+        
+        estimate.layers = min(maximumLayers, estimate.maximumDepthComplexity)
+        return estimate
+    }
+    
+    // The inclusive range of grid cells that the box can cover on screen, or nil if it is off screen
+    private func cells(covering bounds: GLLBoundingBox?, viewProjection: matrix_float4x4) -> (minX: Int, minY: Int, maxX: Int, maxY: Int)? {
+        let fullScreen = (minX: 0, minY: 0, maxX: gridSize - 1, maxY: gridSize - 1)
+        guard let bounds = bounds else {
+            return fullScreen
+        }
+        if bounds.isEmpty {
+            return nil
+        }
+        
+        var minimum = SIMD2<Float>(repeating: .infinity)
+        var maximum = SIMD2<Float>(repeating: -.infinity)
+        for corner in 0 ..< 8 {
+            let position = SIMD3<Float>(corner & 1 == 0 ? bounds.min.x : bounds.max.x,
+                                        corner & 2 == 0 ? bounds.min.y : bounds.max.y,
+                                        corner & 4 == 0 ? bounds.min.z : bounds.max.z)
+            let clip = viewProjection * SIMD4<Float>(position, 1)
+            if clip.w <= 1e-6 {
+                // On or behind the camera plane; the projection of the box has no bounds
+                return fullScreen
+            }
+            let ndc = SIMD2<Float>(clip.x, clip.y) / clip.w
+            minimum = simd_min(minimum, ndc)
+            maximum = simd_max(maximum, ndc)
+        }
+        if any(maximum .< SIMD2<Float>(repeating: -1)) || any(minimum .> SIMD2<Float>(repeating: 1)) {
+            return nil
+        }
+        
+        // Cells from the bottom left; which way is up doesn't matter for counting
+        let scale = Float(gridSize) / 2
+        let low = simd_clamp((minimum + 1) * scale, SIMD2<Float>(repeating: 0), SIMD2<Float>(repeating: Float(gridSize - 1)))
+        let high = simd_clamp((maximum + 1) * scale, SIMD2<Float>(repeating: 0), SIMD2<Float>(repeating: Float(gridSize - 1)))
+        return (minX: Int(low.x), minY: Int(low.y), maxX: Int(high.x), maxY: Int(high.y))
+    }
+}
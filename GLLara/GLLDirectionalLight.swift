@@ -38,4 +38,12 @@ public class GLLDirectionalLight: NSManagedObject {
         
         return GLLLightBuffer(diffuseColor: diffuseColor.rgbaComponents128Bit, specularColor: specularColor.rgbaComponents128Bit, direction: direction)
     }
+    
+    /**
+     * The enabled lights in the form of the light buffer, in order, so the shaders only loop over the ones that shine.
+     * There is no limit on the number; the shaders get compiled for the count that is used.
+     */
+    static func enabledUniformBlocks(_ lights: [GLLDirectionalLight]) -> [GLLLightBuffer] {
+        return lights.filter { $0.isEnabled }.map { $0.uniformBlock }
+    }
 }
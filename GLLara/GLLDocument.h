@@ -9,9 +9,11 @@
 #import <AppKit/NSPersistentDocument.h>
 #import <Foundation/Foundation.h>
 
+@class GLLChangeBatch;
 @class GLLItem;
 @class GLLItemBone;
 @class GLLModel;
+@class GLLPositionalLight;
 @class GLLView;
 @class GLLSourceListController;
 @class GLLSelection;
@@ -26,9 +28,12 @@
 - (GLLItem *)addModelAtURL:(NSURL *)url error:(NSError *__autoreleasing*)error;
 - (GLLItem *)addModel:(GLLModel *)model;
 - (GLLItem *)addImagePlane:(NSURL *)url error:(NSError *__autoreleasing*)error;
+- (GLLPositionalLight *)addPositionalLightAsSpotLight:(BOOL)spotLight;
 
 - (IBAction)openNewRenderView:(id)sender;
 - (IBAction)loadMesh:(id)sender;
+- (IBAction)addPointLight:(id)sender;
+- (IBAction)addSpotLight:(id)sender;
 
 - (IBAction)delete:(id)sender;
 - (IBAction)exportSelectedModel:(id)sender;
@@ -40,6 +45,20 @@
 @property (nonatomic, readonly) GLLSelection *selection;
 @property (nonatomic, readonly) NSArray<GLLItemBone *> *allBones;
 
+/*!
+ * @abstract Groups many changes into one.
+ * @discussion Between begin and end, transform recalculation, redraw requests
+ * and undo registration are postponed and done once per affected item when the
+ * outermost batch ends. The batch becomes a single undo step with the given
+ * name (if any). Batches can be nested.
+ */
+- (void)beginBatchEdit;
+- (void)endBatchEditWithActionName:(NSString *)actionName;
+- (void)performBatchEditWithActionName:(NSString *)actionName block:(void (^)(void))block;
+
+// Counts how many updates were deferred and coalesced so far
+@property (nonatomic, readonly) GLLChangeBatch *changeBatch;
+
 - (void)notifyTexturesNotLoaded:(NSDictionary<NSURL*,NSError*>*)textures;
 
 @end
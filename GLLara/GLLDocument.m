@@ -24,6 +24,7 @@ NSString* GLLPrefObjExportIncludesTransforms = @"objExportIncludeTransformations
 NSString* GLLPrefObjExportIncludesVertexColors = @"objExportIncludeVertexColors";
 NSString* GLLPrefPoseExportIncludesUnused = @"exportPose-includeUnused";
 NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
+NSString* GLLPrefMeshExportPosed = @"meshExportPosed";
 
 @interface GLLDocument () <NSOpenSavePanelDelegate>
 {
@@ -32,6 +33,8 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
     GLLSourceListController *sourceListController;
 }
 
+- (NSArray<GLLPositionalLight *> *)_selectedPositionalLights;
+
 @end
 
 @implementation GLLDocument
@@ -202,6 +205,37 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
     return newItem;
 }
 
+- (GLLPositionalLight *)addPositionalLightAsSpotLight:(BOOL)spotLight;
+{
+    // Goes after all other lights in the source list
+    NSFetchRequest *highestIndexRequest = [[NSFetchRequest alloc] init];
+    highestIndexRequest.entity = [NSEntityDescription entityForName:@"GLLLight" inManagedObjectContext:self.managedObjectContext];
+    highestIndexRequest.sortDescriptors = @[ [NSSortDescriptor sortDescriptorWithKey:@"index" ascending:NO] ];
+    highestIndexRequest.fetchLimit = 1;
+    NSArray *highestLights = [self.managedObjectContext executeFetchRequest:highestIndexRequest error:NULL];
+    int64_t index = 0;
+    if (highestLights.count > 0)
+        index = [[highestLights[0] valueForKey:@"index"] longLongValue] + 1;
+    
+    GLLPositionalLight *light = [NSEntityDescription insertNewObjectForEntityForName:@"GLLPositionalLight" inManagedObjectContext:self.managedObjectContext];
+    light.color = [NSColor whiteColor];
+    light.isSpotLight = spotLight;
+    light.index = index;
+    
+    if (spotLight)
+        self.undoManager.actionName = NSLocalizedString(@"Add spot light", @"add spot light undo action name");
+    else
+        self.undoManager.actionName = NSLocalizedString(@"Add point light", @"add point light undo action name");
+    
+    // Set selection next time the main loop comes around to ensure everything's set up properly by then.
+    dispatch_async(dispatch_get_main_queue(), ^(){
+        NSMutableArray *selectedLights = [self.selection mutableArrayValueForKeyPath:@"selectedLights"];
+        [selectedLights replaceObjectsInRange:NSMakeRange(0, selectedLights.count) withObjectsFromArray:@[ light ]];
+    });
+    
+    return light;
+}
+
 #pragma mark - Actions
 
 - (IBAction)openNewRenderView:(id)sender
@@ -241,6 +275,16 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
     }];
 }
 
+- (IBAction)addPointLight:(id)sender
+{
+    [self addPositionalLightAsSpotLight:NO];
+}
+
+- (IBAction)addSpotLight:(id)sender
+{
+    [self addPositionalLightAsSpotLight:YES];
+}
+
 - (IBAction)loadImagePlane:(id)sender {
     NSOpenPanel *panel = [NSOpenPanel openPanel];
     
@@ -265,6 +309,17 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
 
 - (IBAction)delete:(id)sender;
 {
+    NSArray *positionalLights = [self _selectedPositionalLights];
+    if (positionalLights.count > 0)
+    {
+        for (GLLPositionalLight *light in positionalLights)
+            [self.managedObjectContext deleteObject:light];
+        [self.managedObjectContext processPendingChanges];
+        
+        self.undoManager.actionName = NSLocalizedString(@"Delete light", @"delete light undo action name");
+        return;
+    }
+    
     NSAssert([[self.selection valueForKeyPath:@"selectedItems"] count] >= 1, @"Can only delete if at least one item is selected.");
     
     for (GLLItem *item in [self.selection valueForKeyPath:@"selectedItems"])
@@ -358,9 +413,16 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
     panel.canCreateDirectories = YES;
     panel.allowedContentTypes = @[ UTTypeFolder ];
     
+    NSButton *posedCheckbox = [NSButton checkboxWithTitle:NSLocalizedString(@"Export in current pose", @"export item accessory checkbox") target:nil action:NULL];
+    posedCheckbox.state = [[NSUserDefaults standardUserDefaults] boolForKey:GLLPrefMeshExportPosed] ? NSControlStateValueOn : NSControlStateValueOff;
+    panel.accessoryView = posedCheckbox;
+    
     [panel beginSheetModalForWindow:self.windowForSheet completionHandler:^(NSInteger result){
         if (result != NSModalResponseOK) return;
         
+        BOOL posed = posedCheckbox.state == NSControlStateValueOn;
+        [[NSUserDefaults standardUserDefaults] setBool:posed forKey:GLLPrefMeshExportPosed];
+        
         NSFileManager *manager = [NSFileManager defaultManager];
         NSError *error = nil;
         
@@ -394,15 +456,8 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
             }
         }
         
-        // Save mesh file there - both with and without ascii
-        NSString *ascii = [item writeASCIIAndReturnError:&error];
-        if (!ascii)
-        {
-            [manager removeItemAtURL:panel.URL error:NULL];
-            [self.windowForSheet presentError:error];
-            return;
-        }
-        if (![ascii writeToURL:[panel.URL URLByAppendingPathComponent:@"generic_item.mesh.ascii"] atomically:YES encoding:NSUTF8StringEncoding error:&error])
+        // Save mesh file there - both with and without ascii. Both get streamed straight to the file.
+        if (![item writeASCIIWithPosed:posed to:[panel.URL URLByAppendingPathComponent:@"generic_item.mesh.ascii"] error:&error])
         {
             [manager removeItemAtURL:panel.URL error:NULL];
             [self.windowForSheet presentError:error];
@@ -410,9 +465,9 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
         }
         
         // Ignore if writing binary fails; the mesh.ascii version includes all data already.
-        NSData *binary = [item writeBinaryAndReturnError:NULL];
-        if (!binary) return;
-        if (![binary writeToURL:[panel.URL URLByAppendingPathComponent:@"generic_item.mesh"] options:NSDataWritingAtomic error:&error]) return;
+        NSURL *binaryURL = [panel.URL URLByAppendingPathComponent:@"generic_item.mesh"];
+        if (![item writeBinaryWithPosed:posed to:binaryURL error:NULL])
+            [manager removeItemAtURL:binaryURL error:NULL];
     }];
 }
 
@@ -429,9 +484,11 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
     // Always valid
     if (item.action == @selector(openNewRenderView:)) return YES;
     else if (item.action == @selector(loadMesh:)) return YES;
+    else if (item.action == @selector(addPointLight:)) return YES;
+    else if (item.action == @selector(addSpotLight:)) return YES;
     // Conditional
     if (item.action == @selector(delete:))
-        return [[self.selection valueForKeyPath:@"selectedItems"] count] >= 1;
+        return [[self.selection valueForKeyPath:@"selectedItems"] count] >= 1 || [self _selectedPositionalLights].count >= 1;
     else if (item.action == @selector(exportSelectedModel:))
         return [[self.selection valueForKeyPath:@"selectedItems"] count] == 1;
     else if (item.action == @selector(exportSelectedPose:))
@@ -444,6 +501,28 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
         return [super validateUserInterfaceItem:item];
 }
 
+#pragma mark - Batch edits
+
+- (GLLChangeBatch *)changeBatch
+{
+    return self.managedObjectContext.changeBatch;
+}
+
+- (void)beginBatchEdit
+{
+    [self.changeBatch begin];
+}
+
+- (void)endBatchEditWithActionName:(NSString *)actionName
+{
+    [self.changeBatch endWithActionName:actionName];
+}
+
+- (void)performBatchEditWithActionName:(NSString *)actionName block:(void (^)(void))block
+{
+    [self.changeBatch performWithActionName:actionName block:block];
+}
+
 #pragma mark - Error reporting
 
 - (void)notifyTexturesNotLoaded:(NSDictionary<NSURL*,NSError*>*)textures {
@@ -475,6 +554,14 @@ NSString* GLLPrefPoseExportOnlySelected = @"exportPose-onlySelected";
     return [self.managedObjectContext executeFetchRequest:request error:NULL];
 }
 
+// Of the selected lights, the ones that can be deleted
+- (NSArray<GLLPositionalLight *> *)_selectedPositionalLights
+{
+    return [[self.selection valueForKeyPath:@"selectedLights"] filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(id light, NSDictionary *bindings){
+        return [light isKindOfClass:[GLLPositionalLight class]];
+    }]];
+}
+
 #pragma mark - Save panel delegate
 
 - (BOOL)panel:(id)sender validateURL:(NSURL *)url error:(NSError **)outError
@@ -32,6 +32,7 @@
     GLLMeshViewController *meshViewController;
     GLLLightViewController *lightViewController;
     GLLOptionalPartViewController *optionalPartViewController;
+    GLLPositionalLightViewController *positionalLightViewController;
     
     GLLLightsListController *lightsListController;
     GLLItemListController *itemListController;
@@ -70,6 +71,7 @@
     meshViewController = [[GLLMeshViewController alloc] initWithSelection:_selection managedObjectContext:_managedObjectContext];
     lightViewController = [[GLLLightViewController alloc] init];
     optionalPartViewController = [[GLLOptionalPartViewController alloc] init];
+    positionalLightViewController = [[GLLPositionalLightViewController alloc] init];
     
     selectionController = [[NSArrayController alloc] init];
     [selectionController bind:@"contentArray" toObject:self withKeyPath:@"selection.selectedObjects" options:nil];
@@ -269,6 +271,8 @@
                 [self _setRightHandController:ambientLightViewController];
             else if ([selectedManagedObjcet.entity isKindOfEntity:[NSEntityDescription entityForName:@"GLLDirectionalLight" inManagedObjectContext:self.managedObjectContext]])
                 [self _setRightHandController:lightViewController];
+            else if ([selectedManagedObjcet.entity isKindOfEntity:[NSEntityDescription entityForName:@"GLLPositionalLight" inManagedObjectContext:self.managedObjectContext]])
+                [self _setRightHandController:positionalLightViewController];
             else if ([selectedManagedObjcet.entity isKindOfEntity:[NSEntityDescription entityForName:@"GLLItem" inManagedObjectContext:self.managedObjectContext]])
                 [self _setRightHandController:itemViewController];
             else if ([selectedManagedObjcet.entity isKindOfEntity:[NSEntityDescription entityForName:@"GLLItemMesh" inManagedObjectContext:self.managedObjectContext]])
@@ -0,0 +1,181 @@
+//
+//  GLLExportSink.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # Buffered output for the exporters.
+ *
+ * Collects many small writes and hands them on in large blocks, to a file or a closure. Big parts of a file, like the vertices of a mesh, get built as separate chunks on all cores and written in order, a few at a time, so the whole file never has to be in memory.
+ */
+final class GLLExportSink {
+    /**
+     * # Bytes for one part of a file.
+     *
+     * Can be built on any thread. Text is UTF-8; floats as text use Swift's description, which is the shortest string that reads back as the same value, and fits into a small string without allocating.
+     */
+    struct Chunk {
+        private(set) var bytes: [UInt8] = []
+        
+        mutating func reserveCapacity(_ capacity: Int) {
+            bytes.reserveCapacity(capacity)
+        }
+        
+        mutating func append(contentsOf buffer: UnsafeRawBufferPointer) {
+            bytes.append(contentsOf: buffer)
+        }
+        
+        mutating func append(contentsOf data: Data) {
+            bytes.append(contentsOf: data)
+        }
+        
+        // Binary values are little endian, like in all XNALara files
+        mutating func append<T: FixedWidthInteger>(_ value: T) {
+            withUnsafeBytes(of: value.littleEndian) { bytes.append(contentsOf: $0) }
+        }
+        
+        mutating func append(_ value: Float) {
+            append(value.bitPattern)
+        }
+        
+        mutating func append(_ values: [SIMD3<Float>]) {
+            for value in values {
+                append(value.x)
+                append(value.y)
+                append(value.z)
+            }
+        }
+        
+        // Length as 7 bit groups, like .NET's BinaryWriter, then the UTF-8 bytes
+        mutating func appendPascalString(_ string: String) {
+            var length = string.utf8.count
+            repeat {
+                bytes.append(UInt8(length & 0x7F) | (length > 0x7F ? 0x80 : 0))
+                length >>= 7
+            } while length > 0
+            bytes.append(contentsOf: string.utf8)
+        }
+        
+        mutating func appendText(_ string: String) {
+            bytes.append(contentsOf: string.utf8)
+        }
+        
+        mutating func appendText(_ value: Float) {
+            bytes.append(contentsOf: value.description.utf8)
+        }
+        
+        mutating func appendText<T: BinaryInteger>(_ value: T) {
+            bytes.append(contentsOf: value.description.utf8)
+        }
+        
+        // The components with spaces between them and a newline at the end
+        mutating func appendLine<V: SIMD>(_ vector: V) where V.Scalar == Float {
+            for index in 0 ..< V.scalarCount {
+                if index > 0 {
+                    bytes.append(UInt8(ascii: " "))
+                }
+                appendText(vector[index])
+            }
+            bytes.append(UInt8(ascii: "\n"))
+        }
+        
+        mutating func appendLine<V: SIMD>(_ vector: V) where V.Scalar: BinaryInteger {
+            for index in 0 ..< V.scalarCount {
+                if index > 0 {
+                    bytes.append(UInt8(ascii: " "))
+                }
+                appendText(vector[index])
+            }
+            bytes.append(UInt8(ascii: "\n"))
+        }
+    }
+    
+    // Bytes that get collected before they are handed on
+    static let defaultCapacity = 1 << 20
+    
+    private let output: (Data) throws -> Void
+    private let capacity: Int
+    private var buffer: [UInt8] = []
+    private(set) var bytesWritten = 0
+    
+    init(capacity: Int = GLLExportSink.defaultCapacity, output: @escaping (Data) throws -> Void) {
+        precondition(capacity > 0)
+        self.capacity = capacity
+        self.output = output
+        buffer.reserveCapacity(capacity)
+    }
+    
+    // Writes to a new file at the URL, replacing what was there
+    convenience init(url: URL) throws {
+        guard FileManager.default.createFile(atPath: url.path, contents: nil) else {
+            throw NSError(domain: "exporting", code: 1, userInfo: [
+                NSLocalizedFailureErrorKey: NSLocalizedString("Could not open file for writing", comment: "Exporting")
+            ])
+        }
+        let handle = try FileHandle(forWritingTo: url)
+        self.init { data in
+            try handle.write(contentsOf: data)
+        }
+    }
+    
+    func write(_ bytes: UnsafeRawBufferPointer) throws {
+        bytesWritten += bytes.count
+        if buffer.count + bytes.count > capacity {
+            try flush()
+        }
+        if bytes.count >= capacity {
+            // Too big to be worth copying into the buffer
+            try output(Data(bytes))
+        } else {
+            buffer.append(contentsOf: bytes)
+        }
+    }
+    
+    func write(_ chunk: Chunk) throws {
+        try chunk.bytes.withUnsafeBytes { try write($0) }
+    }
+    
+    // For the small parts of a file, like headers
+    func write(_ build: (inout Chunk) -> Void) throws {
+        var chunk = Chunk()
+        build(&chunk)
+        try write(chunk)
+    }
+    
+    /**
+     * # Builds chunks in parallel and writes them in order.
+     *
+     * The closure gets the index of the chunk, from 0 to count. Only about two chunks per core exist at any time.
+     */
+    func writeChunks(count: Int, _ build: (Int, inout Chunk) -> Void) throws {
+        let batchSize = ProcessInfo.processInfo.activeProcessorCount * 2
+        var batchStart = 0
+        while batchStart < count {
+            let start = batchStart
+            var chunks = Array(repeating: Chunk(), count: min(batchSize, count - start))
+            chunks.withUnsafeMutableBufferPointer { chunks in
+                DispatchQueue.concurrentPerform(iterations: chunks.count) { index in
+                    build(start + index, &chunks[index])
+                }
+            }
+            for chunk in chunks {
+                try write(chunk)
+            }
+            batchStart += chunks.count
+        }
+    }
+    
+    // Hands on everything written so far. Has to be called at the end.
+    func flush() throws {
+        guard !buffer.isEmpty else {
+            return
+        }
+        try buffer.withUnsafeBytes { try output(Data($0)) }
+        buffer.removeAll(keepingCapacity: true)
+    }
+}
@@ -0,0 +1,315 @@
+//
+//  GLLFrustumCulling.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # An axis aligned bounding box.
+ *
+ * The empty box has min > max, so adding the first point makes it exactly that point.
+ */
+struct GLLBoundingBox: Equatable {
+    var min: SIMD3<Float>
+    var max: SIMD3<Float>
+    
+    static let empty = GLLBoundingBox(min: SIMD3<Float>(repeating: .infinity), max: SIMD3<Float>(repeating: -.infinity))
+    
+    init(min: SIMD3<Float>, max: SIMD3<Float>) {
+        self.min = min
+        self.max = max
+    }
+    
+    init<S: Sequence>(points: S) where S.Element == SIMD3<Float> {
+        self = .empty
+        for point in points {
+            add(point)
+        }
+    }
+    
+    var isEmpty: Bool {
+        return any(min .> max)
+    }
+    
+    var center: SIMD3<Float> {
+        return (min + max) * 0.5
+    }
+    
+    // Half the size in every direction
+    var extent: SIMD3<Float> {
+        return (max - min) * 0.5
+    }
+    
+    mutating func add(_ point: SIMD3<Float>) {
+        min = simd_min(min, point)
+        max = simd_max(max, point)
+    }
+    
+    mutating func formUnion(_ other: GLLBoundingBox) {
+        min = simd_min(min, other.min)
+        max = simd_max(max, other.max)
+    }
+    
+    // Larger by distance on every side
+    func expanded(by distance: Float) -> GLLBoundingBox {
+        if isEmpty || distance == 0 {
+            return self
+        }
+        return GLLBoundingBox(min: min - distance, max: max + distance)
+    }
+    
+    /**
+     * # The box around this box after an affine transform.
+     *
+     * The new extent in each direction is the sum of how much each of the old extents contributes to it, which is exactly the bounding box of the transformed corners.
+     */
+    func transformed(by transform: matrix_float4x4) -> GLLBoundingBox {
+        if isEmpty {
+            return self
+        }
+        let center4 = transform * SIMD4<Float>(center, 1)
+        let newCenter = SIMD3<Float>(center4.x, center4.y, center4.z)
+        let e = extent
+        let c0 = transform.columns.0, c1 = transform.columns.1, c2 = transform.columns.2
+        let newExtent = abs(SIMD3<Float>(c0.x, c0.y, c0.z)) * e.x
+            + abs(SIMD3<Float>(c1.x, c1.y, c1.z)) * e.y
+            + abs(SIMD3<Float>(c2.x, c2.y, c2.z)) * e.z
+        return GLLBoundingBox(min: newCenter - newExtent, max: newCenter + newExtent)
+    }
+    
+    /**
+     * # How large the box appears, as a fraction of the size of the view.
+     *
+     * The larger of width and height of the rectangle around the projected corners, where 1 is the whole view. If the box reaches behind the camera, it is infinitely large.
+     */
+    func screenSize(viewProjection: matrix_float4x4) -> Float {
+        if isEmpty {
+            return 0
+        }
+        var lower = SIMD2<Float>(repeating: .infinity)
+        var upper = SIMD2<Float>(repeating: -.infinity)
+        for corner in 0 ..< 8 {
+            let point = SIMD3<Float>(corner & 1 == 0 ? min.x : max.x, corner & 2 == 0 ? min.y : max.y, corner & 4 == 0 ? min.z : max.z)
+            let clip = viewProjection * SIMD4<Float>(point, 1)
+            if clip.w <= 0 {
+                return .infinity
+            }
+            let projected = SIMD2<Float>(clip.x, clip.y) / clip.w
+            lower = simd_min(lower, projected)
+            upper = simd_max(upper, projected)
+        }
+        // Normalized device coordinates go from -1 to 1
+        return (upper - lower).max() * 0.5
+    }
+}
+
+/**
+ * # Bounds of a mesh in its bind pose and for any pose.
+ *
+ * For every bone, this stores the box around all vertices that the bone influences. A skinned vertex is a weighted average of the vertex transformed by each of its bones, so it lies within the union of the transformed boxes of its bones. That union is a bit larger than the actual mesh, but it only takes one box transform per bone instead of skinning all vertices.
+ *
+ * The bone indices are the same as in the vertex data, i.e. indices into the model's bones, not the palette.
+ */
+struct GLLMeshBounds {
+    let bindPose: GLLBoundingBox
+    let bones: [Int]
+    let boneBoxes: [GLLBoundingBox]
+    // False if the weights of some vertex do not add up to one. Then the skinned vertex need not be inside the boxes, and the mesh cannot be culled.
+    let isConservative: Bool
+    
+    init(positions: [SIMD3<Float>], boneData: GLLCPUSkinner.BoneData) {
+        self.init(positions: positions, boneData: boneData, vertices: positions.indices)
+    }
+    
+    // Bounds of only some of the vertices, for example one meshlet
+    init<C: Collection>(positions: [SIMD3<Float>], boneData: GLLCPUSkinner.BoneData, vertices: C) where C.Element == Int {
+        let bindPose = GLLBoundingBox(points: vertices.lazy.map { positions[$0] })
+        
+        var boxes: [GLLBoundingBox] = []
+        var isConservative = true
+        func add(position: SIMD3<Float>, bone: Int) {
+            if bone >= boxes.count {
+                boxes.append(contentsOf: repeatElement(.empty, count: bone + 1 - boxes.count))
+            }
+            boxes[bone].add(position)
+        }
+        func checkWeightSum(_ sum: Float) {
+            if abs(sum - 1.0) > 1e-3 {
+                isConservative = false
+            }
+        }
+        
+        switch boneData {
+        case .none:
+            // Like the shader, use the first bone
+            boxes = [bindPose]
+        case .fixed(let indices, let weights):
+            for vertex in vertices {
+                let position = positions[vertex]
+                let index = indices[vertex]
+                let weight = weights[vertex]
+                for i in 0 ..< 4 where weight[i] > 0 {
+                    add(position: position, bone: Int(index[i]))
+                }
+                checkWeightSum(weight.sum())
+            }
+        case .variable(let offsetLength, let indices, let weights):
+            for vertex in vertices {
+                let position = positions[vertex]
+                let start = Int(offsetLength[vertex].x)
+                let end = start + Int(offsetLength[vertex].y)
+                var sum: Float = 0
+                for i in start ..< end where weights[i] > 0 {
+                    add(position: position, bone: Int(indices[i]))
+                    sum += weights[i]
+                }
+                checkWeightSum(sum)
+            }
+        }
+        
+        let usedBones = boxes.indices.filter { !boxes[$0].isEmpty }
+        self.bindPose = bindPose
+        self.bones = usedBones
+        self.boneBoxes = usedBones.map { boxes[$0] }
+        self.isConservative = isConservative
+    }
+    
+    /**
+     * # World space box in the pose given by the transforms (indexed by bone index), or nil if that can't be determined.
+     *
+     * Morph targets move vertices before skinning, so if they can move any vertex by up to morphDistance, every bone box grows by that much first.
+     */
+    func skinned(boneTransforms: UnsafeBufferPointer<matrix_float4x4>, morphDistance: Float = 0) -> GLLBoundingBox? {
+        guard isConservative else {
+            return nil
+        }
+        var result = GLLBoundingBox.empty
+        for (bone, box) in zip(bones, boneBoxes) {
+            guard bone < boneTransforms.count else {
+                return nil
+            }
+            result.formUnion(box.expanded(by: morphDistance).transformed(by: boneTransforms[bone]))
+        }
+        return result
+    }
+}
+
+/**
+ * # The six planes of a view frustum.
+ *
+ * Extracted from the combined view projection matrix. The planes point inwards. They are those of the OpenGL style clip space that the camera matrix produces, with z from -w to w; that is a bit more than Metal actually draws, so culling with them is conservative.
+ */
+struct GLLFrustum {
+    let planes: [SIMD4<Float>]
+    // Where the camera is in world space; nil for an orthographic projection, where it is infinitely far away
+    let cameraPosition: SIMD3<Float>?
+    
+    init(viewProjection: matrix_float4x4) {
+        let m = viewProjection.transpose
+        let row0 = m.columns.0, row1 = m.columns.1, row2 = m.columns.2, row3 = m.columns.3
+        planes = [row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2]
+        
+        // The camera is the one point that ends up with x, y and w all 0
+        let camera = viewProjection.inverse * SIMD4<Float>(0, 0, 1, 0)
+        if abs(camera.w) > 1e-6 && camera.w.isFinite {
+            cameraPosition = SIMD3<Float>(camera.x, camera.y, camera.z) / camera.w
+        } else {
+            cameraPosition = nil
+        }
+    }
+    
+    // False only if the box is definitely completely outside
+    func intersects(_ box: GLLBoundingBox) -> Bool {
+        if box.isEmpty {
+            return false
+        }
+        for plane in planes {
+            // The corner furthest along the plane's normal
+            let normal = SIMD3<Float>(plane.x, plane.y, plane.z)
+            let corner = box.min.replacing(with: box.max, where: normal .>= 0)
+            if simd_dot(normal, corner) + plane.w < 0 {
+                return false
+            }
+        }
+        return true
+    }
+    
+    // Same for a sphere. The planes are not normalized, so the radius gets scaled with each.
+    func intersects(center: SIMD3<Float>, radius: Float) -> Bool {
+        for plane in planes {
+            let normal = SIMD3<Float>(plane.x, plane.y, plane.z)
+            if simd_dot(normal, center) + plane.w < -radius * simd_length(normal) {
+                return false
+            }
+        }
+        return true
+    }
+}
+
+/**
+ * # Which meshes can be skipped for one frame.
+ *
+ * Culling is done once per frame and view, and the result is used for the solid pass and all depth peel passes.
+ */
+struct GLLCullingResult {
+    struct Statistics: CustomStringConvertible {
+        var meshes = 0
+        var culledMeshes = 0
+        var triangles = 0
+        var culledTriangles = 0
+        // Only in meshes that were not culled as a whole
+        var meshlets = 0
+        var culledMeshlets = 0
+        
+        mutating func add(_ other: Statistics) {
+            meshes += other.meshes
+            culledMeshes += other.culledMeshes
+            triangles += other.triangles
+            culledTriangles += other.culledTriangles
+            meshlets += other.meshlets
+            culledMeshlets += other.culledMeshlets
+        }
+        
+        mutating func add(_ meshletStatistics: GLLMeshlets.CullingStatistics) {
+            meshlets += meshletStatistics.meshlets
+            culledMeshlets += meshletStatistics.culledMeshlets
+            culledTriangles += meshletStatistics.culledTriangles
+        }
+        
+        var description: String {
+            return "culled \(culledMeshes) of \(meshes) meshes, \(culledMeshlets) of \(meshlets) meshlets, \(culledTriangles) of \(triangles) triangles"
+        }
+    }
+    
+    var visible: GLLBitSet
+    var statistics: Statistics
+    // For meshes with meshlets, the ranges of elements that are left after culling the meshlets. Nil to draw all elements.
+    var elementRanges: [[Range<Int>]?]
+    
+    /**
+     * # Tests all boxes against the frustum.
+     *
+     * Meshes without a box are always visible. The triangle counts are only needed for the statistics.
+     */
+    init(frustum: GLLFrustum, boxes: [GLLBoundingBox?], triangleCounts: [Int]) {
+        precondition(boxes.count == triangleCounts.count)
+        visible = GLLBitSet(count: boxes.count)
+        statistics = Statistics()
+        elementRanges = Array(repeating: nil, count: boxes.count)
+        for (mesh, box) in boxes.enumerated() {
+            statistics.meshes += 1
+            statistics.triangles += triangleCounts[mesh]
+            if let box = box, !frustum.intersects(box) {
+                statistics.culledMeshes += 1
+                statistics.culledTriangles += triangleCounts[mesh]
+            } else {
+                visible.insert(mesh)
+            }
+        }
+    }
+}
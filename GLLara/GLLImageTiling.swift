@@ -0,0 +1,80 @@
+//
+//  GLLImageTiling.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # Splits an image that is too large to render at once into tiles.
+ *
+ * All tiles have the same size, so one set of render targets can be used for all of them. Tiles at the right and bottom edge stick out of the image; only the part inside gets used. Every tile has its own projection, which is the part of the full image's view frustum that it covers, so culling and clipping work as usual.
+ *
+ * Tiles are ordered row by row, from the top, so a complete band of rows is done after every row of tiles and can be handed on to an encoder.
+ */
+struct GLLImageTiling {
+    struct Tile {
+        // In pixels, with y going down
+        let x: Int
+        let y: Int
+        // The part that is inside the image
+        let width: Int
+        let height: Int
+    }
+    
+    let width: Int
+    let height: Int
+    // Size of every tile as rendered
+    let tileWidth: Int
+    let tileHeight: Int
+    
+    // Small images are just one tile of exactly their size
+    init(width: Int, height: Int, maximumTileSize: Int) {
+        precondition(width > 0 && height > 0 && maximumTileSize > 0)
+        self.width = width
+        self.height = height
+        tileWidth = min(width, maximumTileSize)
+        tileHeight = min(height, maximumTileSize)
+    }
+    
+    var tilesPerRow: Int {
+        return (width + tileWidth - 1) / tileWidth
+    }
+    
+    var tileRows: Int {
+        return (height + tileHeight - 1) / tileHeight
+    }
+    
+    func tiles(inRow row: Int) -> [Tile] {
+        let y = row * tileHeight
+        return (0 ..< tilesPerRow).map { column in
+            let x = column * tileWidth
+            return Tile(x: x, y: y, width: min(tileWidth, width - x), height: min(tileHeight, height - y))
+        }
+    }
+    
+    var tiles: [Tile] {
+        return (0 ..< tileRows).flatMap { tiles(inRow: $0) }
+    }
+    
+    /**
+     * # The view projection for rendering one tile.
+     *
+     * Scales and moves the tile's part of normalized device coordinates to the full -1 to 1 range. This happens after the projection, so it works the same for any camera, and leaves depth alone.
+     */
+    func viewProjection(for tile: Tile, fullViewProjection: matrix_float4x4) -> matrix_float4x4 {
+        // The rendered area of the tile, in normalized device coordinates
+        let left = 2 * Float(tile.x) / Float(width) - 1
+        let right = 2 * Float(tile.x + tileWidth) / Float(width) - 1
+        let top = 1 - 2 * Float(tile.y) / Float(height)
+        let bottom = 1 - 2 * Float(tile.y + tileHeight) / Float(height)
+        
+        var crop = matrix_float4x4(diagonal: SIMD4<Float>(2 / (right - left), 2 / (top - bottom), 1, 1))
+        crop.columns.3 = SIMD4<Float>(-(right + left) / (right - left), -(top + bottom) / (top - bottom), 0, 1)
+        return crop * fullViewProjection
+    }
+}
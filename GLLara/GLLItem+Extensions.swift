@@ -8,6 +8,7 @@
 //
 
 import Foundation
+import simd
 
 extension GLLItem {
     @objc var rootBones: [GLLItemBone] {
@@ -21,7 +22,11 @@ extension GLLItem {
     }
     
     @objc func bone(name: String) -> GLLItemBone? {
-        return bones.first(where: { ($0 as! GLLItemBone).bone.name == name }) as? GLLItemBone
+        // The item's own bones come first in the skeleton, so the first match is one of them if there is one at all
+        guard let index = skeleton().hierarchy.index(named: name), index < bones.count else {
+            return nil
+        }
+        return skeleton().bones[index]
     }
     
     @objc var rootItem: GLLItem {
@@ -31,6 +36,30 @@ extension GLLItem {
         return self
     }
     
+    // Transform for the normals that the vertex shader applies to the tangent space
+    var normalChannelPermutation: matrix_float4x4 {
+        var permutation = matrix_float4x4()
+        permutation.columns.0 = GLLItem.permutationTableColumn(for: GLLItemChannelAssignment(rawValue: normalChannelAssignmentR)!)
+        permutation.columns.1 = GLLItem.permutationTableColumn(for: GLLItemChannelAssignment(rawValue: normalChannelAssignmentG)!)
+        permutation.columns.2 = GLLItem.permutationTableColumn(for: GLLItemChannelAssignment(rawValue: normalChannelAssignmentB)!)
+        permutation.columns.3 = vector_float4(0, 0, 0, 1)
+        return permutation
+    }
+    
+    private static func permutationTableColumn(for assignment: GLLItemChannelAssignment) -> vector_float4 {
+        switch assignment {
+        case .normalPos: return vector_float4(0, 0, 1, 0)
+        case .normalNeg: return vector_float4(0, 0, -1, 0)
+        case .tangentUPos: return vector_float4(0, 1, 0, 0)
+        case .tangentUNeg: return vector_float4(0, -1, 0, 0)
+        case .tangentVPos: return vector_float4(1, 0, 0, 0)
+        case .tangentVNeg: return vector_float4(-1, 0, 0, 0)
+        @unknown default:
+            assertionFailure()
+            return vector_float4(0, 0, 0, 0)
+        }
+    }
+    
     @objc var hasOptionalParts: Bool {
         return meshes?.first(where: { ($0 as! GLLItemMesh).mesh.optionalPartNames.count > 0 }) != nil
     }
@@ -41,6 +70,12 @@ extension GLLItem {
     }
     
     @objc func loadPose(description: String) throws {
+        let batch = managedObjectContext?.changeBatch
+        batch?.begin()
+        defer {
+            batch?.end()
+        }
+        
         let lines = description.components(separatedBy: CharacterSet.newlines)
         if description.firstIndex(of: ":") == nil {
             // Old-style loading: Same number of lines as bones, sequentally stored, no names.
@@ -49,7 +84,7 @@ extension GLLItem {
                     NSLocalizedDescriptionKey : NSLocalizedString("Pose file does not contain the right amount of bones", comment: "error loading pose old-style"),
                     NSLocalizedRecoverySuggestionErrorKey : NSLocalizedString("Poses in the old format have to contain exactly as many items as bones. Try using a newer pose.", comment: "error loading pose old-style")]);
             }
-
+            
             for i in 0 ..< lines.count {
                 let scanner = Scanner(string: lines[i])
                 if let x = scanner.scanFloat() {
@@ -69,7 +104,7 @@ extension GLLItem {
                     continue
                 }
                 _ = scanner.scanString(":")
-                guard let bone = bones.first(where: { ($0 as! GLLItemBone).bone.name == name }) as? GLLItemBone else {
+                guard let bone = bone(name: name) else {
                     continue
                 }
                 if let x = scanner.scanFloat() {
@@ -10,56 +10,74 @@ import Foundation
 
 extension GLLItem {
     
-    @objc func writeBinary() throws -> Data {
-        let stream = TROutDataStream()
-        
-        stream.appendUint32(UInt32(bones.count))
-        for bone in bones {
-            stream.appendData((bone as! GLLItemBone).bone.writeBinary())
+    /**
+     * # The bone transforms used for CPU skinning, indexed by bone index.
+     *
+     * If posed is false, these are the bind pose transforms instead.
+     */
+    func skinningTransforms(posed: Bool) -> [mat_float16] {
+        return bones.map { bone in
+            let itemBone = bone as! GLLItemBone
+            return posed ? itemBone.globalTransform : itemBone.bone.positionMatrix
         }
-        
-        var count: UInt32 = 0
-        for mesh in meshes {
-            if (mesh as! GLLItemMesh).shouldExport {
-                count += 1
-            }
-        }
-        stream.appendUint32(count)
-        for mesh in meshes {
-            let itemMesh = mesh as! GLLItemMesh
-            if itemMesh.shouldExport {
-                try stream.appendData(itemMesh.writeBinary())
-            }
+    }
+    
+    // The position of the bone as written to a mesh file. In a posed export, the bones have to move with the vertices, so that the current pose becomes the new bind pose.
+    private func exportedPosition(bone: GLLItemBone, posed: Bool) -> SIMD3<Float> {
+        guard posed else {
+            return bone.bone.position
         }
-        
-        return stream.data()!;
+        let position = simd_mul(bone.globalTransform, SIMD4<Float>(bone.bone.position, 1.0))
+        return SIMD3<Float>(position.x, position.y, position.z)
     }
     
-    @objc func writeASCII() throws -> String {
-        var string = ""
-        
-        string += "\(bones.count)\n"
-        for bone in bones {
-            string += (bone as! GLLItemBone).bone.writeASCII()
-            string += "\n"
+    // Writes the item in XNALara's binary format to a new file. The meshes get written one after the other, so only one mesh's vertex data is in memory at a time.
+    @objc func writeBinary(posed: Bool, to url: URL) throws {
+        let sink = try GLLExportSink(url: url)
+        try writeBinary(posed: posed, to: sink)
+        try sink.flush()
+    }
+    
+    func writeBinary(posed: Bool, to sink: GLLExportSink) throws {
+        let exportedMeshes = meshes.map { $0 as! GLLItemMesh }.filter { $0.shouldExport }
+        try sink.write { chunk in
+            chunk.append(UInt32(bones.count))
+            for bone in bones {
+                let itemBone = bone as! GLLItemBone
+                itemBone.bone.writeBinary(position: exportedPosition(bone: itemBone, posed: posed), to: &chunk)
+            }
+            chunk.append(UInt32(exportedMeshes.count))
         }
         
-        var count = 0
-        for mesh in meshes {
-            if (mesh as! GLLItemMesh).shouldExport {
-                count += 1
-            }
+        let transforms = posed ? skinningTransforms(posed: true) : nil
+        for itemMesh in exportedMeshes {
+            try itemMesh.writeBinary(posedWith: transforms, to: sink)
         }
-        string += "\(count)\n"
-        for mesh in meshes {
-            let itemMesh = mesh as! GLLItemMesh
-            if itemMesh.shouldExport {
-                string += try itemMesh.writeASCII()
-                string += "\n"
+    }
+    
+    @objc func writeASCII(posed: Bool, to url: URL) throws {
+        let sink = try GLLExportSink(url: url)
+        try writeASCII(posed: posed, to: sink)
+        try sink.flush()
+    }
+    
+    func writeASCII(posed: Bool, to sink: GLLExportSink) throws {
+        let exportedMeshes = meshes.map { $0 as! GLLItemMesh }.filter { $0.shouldExport }
+        try sink.write { chunk in
+            chunk.appendText("\(bones.count)\n")
+            for bone in bones {
+                let itemBone = bone as! GLLItemBone
+                itemBone.bone.writeASCII(position: exportedPosition(bone: itemBone, posed: posed), to: &chunk)
+                chunk.appendText("\n")
             }
+            chunk.appendText("\(exportedMeshes.count)\n")
         }
         
-        return string;
+        let transforms = posed ? skinningTransforms(posed: true) : nil
+        for itemMesh in exportedMeshes {
+            try itemMesh.writeASCII(posedWith: transforms, to: sink)
+            try sink.write { $0.appendText("\n") }
+        }
     }
     
 }
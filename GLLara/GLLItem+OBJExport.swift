@@ -13,33 +13,100 @@ extension GLLItem {
         return meshes.first { ($0 as! GLLItemMesh).willLoseDataWhenConvertedToOBJ } != nil
     }
     
-    @objc func writeOBJ(location: URL, transform: Bool, color: Bool) throws {
-        var string = ""
-        
-        let materialLibraryName = location.deletingPathExtension().appendingPathExtension(".mtl").lastPathComponent
-        string += "usemtl \(materialLibraryName)\r\n"
-        
-        var transforms = Array<mat_float16>(repeating: mat_float16(), count: bones.count)
-        var boneIndex = 0
-        for bone in bones {
-            if transform {
-                transforms[boneIndex] = (bone as! GLLItemBone).globalTransform
-            } else {
-                transforms[boneIndex] = (bone as! GLLItemBone).bone.positionMatrix
+    /**
+     * # The materials for OBJ export.
+     *
+     * Meshes with the same diffuse texture share one material, and all meshes without one share another. Returns the material index of each mesh, and the texture of each material.
+     */
+    private var objMaterials: (meshMaterials: [Int], textures: [URL?]) {
+        var textures: [URL?] = []
+        var materialForTexture: [URL?: Int] = [:]
+        let meshMaterials = meshes.map { mesh -> Int in
+            let texture = (mesh as! GLLItemMesh).mesh.textures["diffuseTexture"]?.url
+            if let existing = materialForTexture[texture] {
+                return existing
             }
-            boneIndex += 1
+            materialForTexture[texture] = textures.count
+            textures.append(texture)
+            return textures.count - 1
         }
+        return (meshMaterials, textures)
+    }
+    
+    // Writes the OBJ file and streams it to the location. Use writeMTL for the material library.
+    @objc func writeOBJ(location: URL, transform: Bool, color: Bool) throws {
+        let sink = try GLLExportSink(url: location)
+        try writeOBJ(materialLibraryName: location.deletingPathExtension().appendingPathExtension("mtl").lastPathComponent, transform: transform, color: color, to: sink)
+        try sink.flush()
+    }
+    
+    /**
+     * # Writes the OBJ data for all meshes.
+     *
+     * The meshes get skinned and turned into text in parallel, each into its own chunk, and written in order.
+     */
+    func writeOBJ(materialLibraryName: String, transform: Bool, color: Bool, to sink: GLLExportSink) throws {
+        // Everything from Core Data gets read here, not on the worker threads
+        let modelMeshes = meshes.map { ($0 as! GLLItemMesh).mesh }
+        let morphWeights = meshes.map { ($0 as! GLLItemMesh).morphTargetWeights }
+        let meshMaterials = objMaterials.meshMaterials
+        let transforms = skinningTransforms(posed: transform)
         
+        var baseIndices: [Int] = []
         var indexOffset = 0
-        for mesh in meshes {
-            string += (mesh as! GLLItemMesh).writeOBJ(transformations: transforms, baseIndex: indexOffset, includeColors: color)
-            indexOffset += (mesh as! GLLItemMesh).mesh.countOfVertices
+        for mesh in modelMeshes {
+            baseIndices.append(indexOffset)
+            indexOffset += mesh.countOfVertices
+        }
+        
+        try sink.write { $0.appendText("mtllib \(materialLibraryName)\n") }
+        try sink.writeChunks(count: modelMeshes.count) { index, chunk in
+            modelMeshes[index].writeOBJ(transformations: transforms, morphWeights: morphWeights[index], baseIndex: baseIndices[index], materialName: "material\(meshMaterials[index])", includeColors: color, to: &chunk)
         }
-        try string.write(to: location, atomically: true, encoding: .utf8)
     }
     
     @objc func writeMTL(location: URL) throws {
-        let content = meshes.map { ($0 as! GLLItemMesh).writeMTL(baseURL: location) }.joined(separator: "\r\n")
-        try content.write(to: location, atomically: true, encoding: .utf8)
+        let textures = objMaterials.textures
+        let sink = try GLLExportSink(url: location)
+        try sink.write { chunk in
+            for (index, texture) in textures.enumerated() {
+                if index > 0 {
+                    chunk.appendText("\r\n")
+                }
+                chunk.appendText("newmtl material\(index)\r\n")
+                // Use only first texture and only if it isn't baked into the model file
+                if let texture {
+                    chunk.appendText("map_Kd \(GLLItem.relativePath(of: texture, from: location))\r\n")
+                }
+            }
+        }
+        try sink.flush()
+    }
+    
+    // The path from the directory of the base file to the file at url
+    private static func relativePath(of url: URL, from baseURL: URL) -> String {
+        let baseComponents = baseURL.pathComponents
+        let textureComponents = url.pathComponents
+        
+        // Find where the paths diverge
+        var commonPathLength = 0
+        for i in 0 ..< min(baseComponents.count, textureComponents.count) {
+            if baseComponents[i] != textureComponents[i] {
+                break
+            } else {
+                commonPathLength = i
+            }
+        }
+        
+        var relativePathComponents: [String] = []
+        
+        // Add .. for any additional path in the base file
+        for _ in commonPathLength ..< baseComponents.count - 1 {
+            relativePathComponents.append("..")
+        }
+        
+        relativePathComponents.append(contentsOf: textureComponents.dropFirst(commonPathLength))
+        
+        return relativePathComponents.joined(separator: "/")
     }
 }
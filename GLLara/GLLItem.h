@@ -25,6 +25,7 @@ typedef NS_ENUM(int16_t, GLLItemChannelAssignment)
 @class TROutDataStream;
 @class GLLItemBone;
 @class GLLItemMesh;
+@class GLLItemSkeleton;
 @class GLLModel;
 @class GLLModelMesh;
 @class GLLScene;
@@ -70,6 +71,10 @@ typedef NS_ENUM(int16_t, GLLItemChannelAssignment)
 // Bones
 - (NSOrderedSet<GLLItemBone *> *)combinedBones;
 - (NSOrderedSet<GLLItemBone *> *)combinedUsedBones;
+// Hierarchy of the combined bones, in the same order
+- (GLLItemSkeleton *)skeleton;
+// Recalculates the global transforms of all combined bones
+- (void)updateCombinedBoneTransforms;
 
 // Children
 @property (nonatomic, readonly) NSOrderedSet<GLLItem *> *childItems;
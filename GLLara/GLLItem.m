@@ -19,10 +19,12 @@
 @interface GLLItem ()
 {
     NSOrderedSet* cachedCombinedBones;
+    GLLItemSkeleton *cachedSkeleton;
 }
 
 - (void)_standardSetValue:(id)value forKey:(NSString *)key;
 - (void)_updateTransform;
+- (void)_invalidateCombinedBones;
 
 @end
 
@@ -210,6 +212,8 @@
             [bones addObject:[NSEntityDescription insertNewObjectForEntityForName:@"GLLItemBone" inManagedObjectContext:self.managedObjectContext]];
     }
     
+    [self _invalidateCombinedBones];
+    
     // -- Trigger a rebuild of the matrices
     for (GLLItemBone *bone in bones) {
         if (!bone.parent)
@@ -285,9 +289,27 @@
     return combinedBones;
 }
 
+- (GLLItemSkeleton *)skeleton
+{
+    if (cachedSkeleton)
+        return cachedSkeleton;
+    
+    GLLItemSkeleton *skeleton = [[GLLItemSkeleton alloc] initWithBones:self.combinedBones.array];
+    if (skeleton.isComplete)
+        cachedSkeleton = skeleton;
+    return skeleton;
+}
+
+- (void)updateCombinedBoneTransforms
+{
+    // Every bone gets reached exactly once from the roots of the combined hierarchy
+    for (GLLItemBone *bone in self.skeleton.rootBones)
+        [bone updateGlobalTransform];
+}
+
 - (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey,id> *)change context:(void *)context {
     if ([keyPath isEqual:@"childItems"] && object == self) {
-        cachedCombinedBones = nil;
+        [self _invalidateCombinedBones];
     } else {
         [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
     }
@@ -302,12 +324,27 @@
     [self didChangeValueForKey:key];
 }
 
+- (void)_invalidateCombinedBones;
+{
+    // The parents include these bones in their combined bones, too
+    cachedCombinedBones = nil;
+    cachedSkeleton = nil;
+    [self.parent _invalidateCombinedBones];
+}
+
 - (void)_updateTransform;
 {
     mat_float16 scale = matrix_from_diagonal(simd_make_float4(self.scaleX, self.scaleY, self.scaleZ, 1.0f));
     mat_float16 rotateAndTranslate = simd_mat_euler(simd_make_float4(self.rotationX, self.rotationY, self.rotationZ, 0.0f), simd_make_float4(self.positionX, self.positionY, self.positionZ, 1.0f));
     
     modelTransform = simd_mul(rotateAndTranslate, scale);
+    
+    GLLItem *rootItem = self.rootItem;
+    if ([self.managedObjectContext.changeBatch deferUpdateOf:rootItem stage:GLLChangeBatchStageGlobalTransforms action:^{
+        [rootItem updateCombinedBoneTransforms];
+    }])
+        return;
+    
     [self.rootBones makeObjectsPerformSelector:@selector(updateGlobalTransform)];
 }
 
@@ -16,7 +16,6 @@
 
 @interface GLLItemBone ()
 {
-    NSArray *children;
     NSUInteger cachedBoneIndex;
 }
 
@@ -101,17 +100,23 @@
 }
 
 - (void)resetAllValues {
+    [self.managedObjectContext.changeBatch begin];
     self.rotationX = 0.0;
     self.rotationY = 0.0;
     self.rotationZ = 0.0;
     self.positionX = 0.0;
     self.positionY = 0.0;
     self.positionZ = 0.0;
+    [self.managedObjectContext.changeBatch endWithActionName:nil];
 }
 
 - (void)resetAllValuesRecursively {
+    // One batch around everything, so the whole subtree gets updated only once
+    GLLChangeBatch *batch = self.managedObjectContext.changeBatch;
+    [batch begin];
     [self resetAllValues];
     [self.children makeObjectsPerformSelector:_cmd];
+    [batch endWithActionName:nil];
 }
 
 #pragma mark - Tree structure
@@ -141,32 +146,25 @@
 
 - (NSArray<GLLItemBone *> *)children
 {
-    if (!children) {
-        NSOrderedSet<GLLItemBone *> *combinedBones = self.item.combinedBones;
-        if (combinedBones == nil) {
-            return nil;
-        }
-        NSIndexSet *childIndices = [combinedBones indexesOfObjectsPassingTest:^BOOL(GLLItemBone *bone, NSUInteger idx, BOOL *stop){
-            return bone.parent == self;
-        }];
-        children = [combinedBones objectsAtIndexes:childIndices];
-    }
-    return children;
+    // The item's skeleton includes the bones of child items, which can be children of this one
+    return [self.item.skeleton childrenOfBone:self];
 }
 
 - (NSUInteger)parentIndexInCombined
 {
-    if (self.parent)
-        return [self.item.rootItem.combinedBones indexOfObject:self.parent];
-    else
-        return NSNotFound;
+    return [self.item.rootItem.skeleton parentIndexOfBone:self];
 }
 
 - (BOOL)isChildOfAny:(id)boneSet;
 {
-    if (!self.parent) return NO;
-    if ([boneSet containsObject:self.parent]) return YES;
-    return [self.parent isChildOfAny:boneSet];
+    // Ancestors can belong to any item up to the root, so use its skeleton
+    GLLItemSkeleton *skeleton = self.item.rootItem.skeleton;
+    for (GLLItemBone *bone in boneSet)
+    {
+        if ([skeleton isBone:self descendantOfBone:bone])
+            return YES;
+    }
+    return NO;
 }
 
 #pragma mark - Private methods
@@ -198,6 +196,12 @@
 
 - (void)_updateRelativeTransform
 {
+    // In a batch, all values of the bone can change before anything needs to be recomputed
+    if ([self.managedObjectContext.changeBatch deferUpdateOf:self stage:GLLChangeBatchStageBoneTransforms action:^{
+        [self _updateRelativeTransform];
+    }])
+        return;
+    
     cachedBoneIndex = NSNotFound;
     
     mat_float16 transform = simd_mat_positional(simd_make_float4(self.positionX, self.positionY, self.positionZ, 1.0f));
@@ -205,6 +209,13 @@
     
     self.relativeTransform = transform;
     
+    // The combined update goes through all bones of all items that can be below this one
+    GLLItem *rootItem = self.item.rootItem;
+    if (rootItem && [self.managedObjectContext.changeBatch deferUpdateOf:rootItem stage:GLLChangeBatchStageGlobalTransforms action:^{
+        [rootItem updateCombinedBoneTransforms];
+    }])
+        return;
+    
     [self updateGlobalTransform];
 }
 - (void)updateGlobalTransform;
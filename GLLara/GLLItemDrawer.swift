@@ -17,26 +17,37 @@ class GLLItemDrawer {
     var meshStates: [GLLItemMeshState] = [] // Not sorted
     
     private let transformsBuffer: MTLBuffer
+    // World space bounds of every mesh state in the current pose; nil where they can't be determined
+    private(set) var meshBounds: [GLLBoundingBox?] = []
+    // Meshlets of every mesh state in the current pose; nil for meshes without meshlets
+    private var meshletPoses: [GLLMeshlets.Pose?] = []
+    // Whether the morph targets of each mesh state currently move its vertices. The normal cones don't know about that.
+    private var isMorphed: [Bool] = []
     private var observations: [NSKeyValueObservation] = []
     
     init(item: GLLItem, sceneDrawer: GLLSceneDrawer) throws {
         self.item = item
         self.sceneDrawer = sceneDrawer
         
-        // Prepare buffer
-        let matrixCount = 1 + item.bones.count
-        transformsBuffer = sceneDrawer.resourceManager.metalDevice.makeBuffer(length: matrixCount * MemoryLayout<matrix_float4x4>.stride, options: .storageModeManaged)!
+        // Prepare draw data
+        let drawData = try throwingRunAndBlockReturn {
+            try await sceneDrawer.resourceManager.drawDataAsync(model: item.model)
+        }
+        
+        // Prepare buffer. Every mesh gets its own section, with only the bones in its palette
+        let matrixCount = drawData.meshDrawData.reduce(0) { $0 + $1.modelMesh.bonePalette.matrixCount }
+        transformsBuffer = sceneDrawer.resourceManager.metalDevice.makeBuffer(length: max(matrixCount, 1) * MemoryLayout<matrix_float4x4>.stride, options: .storageModeManaged)!
         transformsBuffer.label = item.displayName + "-transforms"
         
-        // Prepare draw data
         try throwingRunAndBlock {
-            let drawData = try await sceneDrawer.resourceManager.drawDataAsync(model: item.model)
+            var paletteStart = 0
             for meshData in drawData.meshDrawData {
-                let meshState = try GLLItemMeshState(itemDrawer: self, meshData: meshData, itemMesh: item.itemMesh(for: meshData.modelMesh)!)
+                let meshState = try GLLItemMeshState(itemDrawer: self, meshData: meshData, itemMesh: item.itemMesh(for: meshData.modelMesh)!, transformsOffset: paletteStart * MemoryLayout<matrix_float4x4>.stride)
+                paletteStart += meshData.modelMesh.bonePalette.matrixCount
                 self.meshStates.append(meshState)
             }
             await withTaskGroup(of: Void.self) { taskGroup in
-                for meshState in self.meshStates {
+                for meshState in self.meshStates where !meshState.isDeferred {
                     taskGroup.addTask {
                         await meshState.updateTextures()
                     }
@@ -74,61 +85,93 @@ class GLLItemDrawer {
         return sceneDrawer!.resourceManager
     }
     
-    private func markUpdateTransforms() {
+    func markUpdateTransforms() {
         needUpdateTransforms = true
         propertiesChanged()
     }
     
-    func propertiesChanged() {
-        sceneDrawer?.needsUpdate = true
+    // Something changed that affects the render queue, e.g. a pipeline or texture
+    func structureChanged() {
+        sceneDrawer?.renderQueueNeedsRebuild = true
+        propertiesChanged()
     }
     
-    private func permutationTableColumn(for assignment: GLLItemChannelAssignment) -> vector_float4 {
-        switch assignment {
-        case .normalPos: return vector_float4(0, 0, 1, 0)
-        case .normalNeg: return vector_float4(0, 0, -1, 0)
-        case .tangentUPos: return vector_float4(0, 1, 0, 0)
-        case .tangentUNeg: return vector_float4(0, -1, 0, 0)
-        case .tangentVPos: return vector_float4(1, 0, 0, 0)
-        case .tangentVNeg: return vector_float4(-1, 0, 0, 0)
-        @unknown default:
-            assertionFailure()
-            return vector_float4(0, 0, 0, 0)
+    func propertiesChanged() {
+        guard let sceneDrawer = sceneDrawer else {
+            return
+        }
+        // Every change in a batch would trigger this; only the last one matters
+        if let batch = item.managedObjectContext?.changeBatch, batch.deferUpdate(of: sceneDrawer, stage: .redraw, action: { [weak sceneDrawer] in
+            sceneDrawer?.needsUpdate = true
+        }) {
+            return
         }
+        sceneDrawer.needsUpdate = true
     }
     
     private func updateTransforms() {
-        let bones = item.bones!
-        let boneCount = bones.count
-        let matrixCount = 1 + boneCount
-        let matrices = transformsBuffer.contents().bindMemory(to: matrix_float4x4.self, capacity: matrixCount)
+        // Transform for the normals, stored first in each palette
+        let permutation = item.normalChannelPermutation
         
-        // First matrix stores the transform for the normals
-        matrices[0].columns.0 = permutationTableColumn(for: GLLItemChannelAssignment(rawValue: item.normalChannelAssignmentR)!)
-        matrices[0].columns.1 = permutationTableColumn(for: GLLItemChannelAssignment(rawValue: item.normalChannelAssignmentG)!)
-        matrices[0].columns.2 = permutationTableColumn(for: GLLItemChannelAssignment(rawValue: item.normalChannelAssignmentB)!)
-        matrices[0].columns.3 = vector_float4(0, 0, 0, 1)
+        let boneTransforms = item.bones!.map { ($0 as! GLLItemBone).globalTransform }
         
-        for i in 0..<boneCount {
-            let bone = bones[i] as! GLLItemBone
-            matrices[1 + i] = bone.globalTransform
+        boneTransforms.withUnsafeBufferPointer { boneTransforms in
+            for meshState in meshStates {
+                let matrices = transformsBuffer.contents().advanced(by: meshState.transformsOffset).bindMemory(to: matrix_float4x4.self, capacity: meshState.bonePalette.matrixCount)
+                if let quantization = meshState.meshData.modelMesh.quantization {
+                    meshState.bonePalette.gather(permutation: quantization.normalPermutation(permutation), boneTransforms: boneTransforms, into: matrices, vertexTransform: quantization.dequantization)
+                } else {
+                    meshState.bonePalette.gather(permutation: permutation, boneTransforms: boneTransforms, into: matrices)
+                }
+            }
+            // The shader adds the morph targets before skinning, so the bounds have to grow by as much as they can move the vertices
+            isMorphed = meshStates.map { $0.meshData.modelMesh.isMorphed(weights: $0.itemMesh.morphTargetWeights) }
+            let morphDistances = meshStates.map { $0.meshData.modelMesh.morphDistance(weights: $0.itemMesh.morphTargetWeights) }
+            meshBounds = zip(meshStates, morphDistances).map { $0.meshData.modelMesh.bounds?.skinned(boneTransforms: boneTransforms, morphDistance: $1) }
+            // Deferred meshes may still be getting their meshlets in the background
+            meshletPoses = zip(meshStates, morphDistances).map { $0.isDeferred ? nil : $0.meshData.modelMesh.meshlets?.pose(boneTransforms: boneTransforms, morphDistance: $1) }
         }
-        transformsBuffer.didModifyRange(0 ..< MemoryLayout<matrix_float4x4>.stride * matrixCount)
+        transformsBuffer.didModifyRange(0 ..< transformsBuffer.length)
         
         needUpdateTransforms = false
     }
     
-    func draw(into commandEncoder: MTLRenderCommandEncoder, blended: Bool = false) {
+    // Tests the meshes in their current pose against the frustum, and the meshlets of the visible ones. The result has one entry per mesh state.
+    func cull(frustum: GLLFrustum) -> GLLCullingResult {
         if (needUpdateTransforms) {
             updateTransforms()
         }
         
-        commandEncoder.setVertexBuffer(transformsBuffer, offset: 0, index: Int(GLLVertexInputIndexTransforms.rawValue))
-        
-        for meshState in meshStates {
-            if meshState.isBlended == blended {
-                meshState.render(into: commandEncoder)
+        var result = GLLCullingResult(frustum: frustum, boxes: meshBounds, triangleCounts: meshStates.map { $0.isDeferred ? 0 : $0.meshData.elementsOrVerticesCount / 3 })
+        for (index, meshState) in meshStates.enumerated() {
+            guard result.visible[index], let pose = meshletPoses[index], let meshlets = meshState.meshData.modelMesh.meshlets else {
+                continue
+            }
+            let culling = meshlets.cull(pose: pose, frustum: frustum, cullsBackFaces: meshState.cullMode == .back && !isMorphed[index])
+            result.statistics.add(culling.statistics)
+            if culling.ranges.isEmpty {
+                result.visible.remove(index)
+            } else {
+                result.elementRanges[index] = culling.ranges
+            }
+        }
+        return result
+    }
+    
+    // Which simplified version of the meshes to draw, from how large the whole item is on screen; 0 is the full detail. Uses the bounds from the last cull.
+    func detailLevel(viewProjection: matrix_float4x4) -> Int {
+        var bounds = GLLBoundingBox.empty
+        for box in meshBounds {
+            guard let box else {
+                return 0
             }
+            bounds.formUnion(box)
         }
+        return GLLMeshSimplifier.detailLevel(screenSize: bounds.screenSize(viewProjection: viewProjection), countOfLevels: GLLMeshSimplifier.screenSizeThresholds.count)
+    }
+    
+    // The transforms buffer; each mesh state sets its own offset into it
+    func bindTransforms(into commandEncoder: MTLRenderCommandEncoder) {
+        commandEncoder.setVertexBuffer(transformsBuffer, offset: 0, index: Int(GLLVertexInputIndexTransforms.rawValue))
     }
 }
@@ -7,6 +7,7 @@
 //
 
 import Foundation
+import simd
 
 extension GLLItemMesh {
     @objc func renderParameter(name: String) -> GLLRenderParameter? {
@@ -34,4 +35,68 @@ extension GLLItemMesh {
     @objc var mesh: GLLModelMesh {
         return item.model.meshes[Int(meshIndex)]
     }
+    
+    // The weights of the mesh's morph targets for this item; the model's defaults until something else gets set
+    var morphTargetWeights: [Float] {
+        get {
+            return morphWeights?.map { $0.floatValue } ?? mesh.morphWeights
+        }
+        set {
+            morphWeights = newValue.map { NSNumber(value: $0) }
+        }
+    }
+    
+    // The UV layer that a texture uses, from the user's assignment or else from the model
+    func texCoordSet(forTexture identifier: String) -> Int {
+        guard let assignment = texture(identifier: identifier) else {
+            return 0
+        }
+        if assignment.texCoordSet < 0 {
+            if let texture = mesh.textures[identifier], texture.texCoordSet > 0 {
+                return min(texture.texCoordSet, mesh.countOfUVLayers - 1)
+            }
+        } else if assignment.texCoordSet >= 1 {
+            return min(Int(assignment.texCoordSet), mesh.countOfUVLayers - 1)
+        }
+        return 0
+    }
+    
+    private func parameterColor(name: String, defaultValue: SIMD4<Float32>) -> SIMD4<Float32> {
+        guard let parameter = renderParameter(name: name) as? GLLColorRenderParameter else {
+            return defaultValue
+        }
+        
+        return parameter.colorValue
+    }
+    
+    private func parameterFloat(name: String, defaultValue: Float32) -> Float32 {
+        guard let parameter = renderParameter(name: name) as? GLLFloatRenderParameter else {
+            return defaultValue
+        }
+        
+        return parameter.value
+    }
+    
+    // The render parameters as the fragment shader gets them
+    var fragmentParameters: GLLFragmentParameters {
+        var result = GLLFragmentParameters()
+        result.ambientColor = parameterColor(name: "ambientColor", defaultValue: vector_float4(repeating: 1.0))
+        result.diffuseColor = parameterColor(name: "diffuseColor", defaultValue: vector_float4(repeating: 1.0))
+        
+        // Specular color gets special treatment - bumpSpecularAmount gets folded into specularColor
+        let specularColorValue = parameterColor(name: "specularColor", defaultValue: vector_float4(repeating: 1.0))
+        let specularIntensityValue = parameterFloat(name: "bumpSpecularAmount", defaultValue: 1.0)
+        result.specularColor = specularColorValue * specularIntensityValue
+        
+        // Specular exponent also gets special treatment - there are two different ways to refer to it
+        let specularExponentValue = parameterFloat(name: "specularExponent", defaultValue: 0.0)
+        let bumpSpecularAmountValue = parameterFloat(name: "bumpSpecularGloss", defaultValue: 0.0)
+        result.specularExponent = max(specularExponentValue, bumpSpecularAmountValue)
+        
+        result.bump1UVScale = parameterFloat(name: "bump1UVScale", defaultValue: 1.0)
+        result.bump2UVScale = parameterFloat(name: "bump2UVScale", defaultValue: 1.0)
+        result.specularTextureScale = parameterFloat(name: "specularTextureScale", defaultValue: 1.0)
+        result.reflectionAmount = parameterFloat(name: "reflectionAmount", defaultValue: 0.0)
+        return result
+    }
 }
@@ -54,14 +54,14 @@ extension GLLItemMesh {
         return description.textureUniformsInOrder.map { texture(identifier: $0)!.textureURL! as URL }
     }
     
-    func writeASCII() throws -> String {
+    func writeASCII(posedWith transforms: [mat_float16]? = nil, to sink: GLLExportSink) throws {
         let shaderDescription = try shaderDescription()
-        return mesh.writeAscii(withName: genericName(shaderDescription: shaderDescription), texture: textureUrls(description: shaderDescription))
+        try mesh.writeAscii(withName: genericName(shaderDescription: shaderDescription), texture: textureUrls(description: shaderDescription), posedWith: transforms, morphWeights: morphTargetWeights, to: sink)
     }
     
-    func writeBinary() throws -> Data {
+    func writeBinary(posedWith transforms: [mat_float16]? = nil, to sink: GLLExportSink) throws {
         let shaderDescription = try shaderDescription()
-        return mesh.writeBinary(withName: genericName(shaderDescription: shaderDescription), texture: textureUrls(description: shaderDescription))
+        try mesh.writeBinary(withName: genericName(shaderDescription: shaderDescription), texture: textureUrls(description: shaderDescription), posedWith: transforms, morphWeights: morphTargetWeights, to: sink)
     }
     
     var shouldExport: Bool {
@@ -14,42 +14,4 @@ extension GLLItemMesh {
         return (self.mesh.textures.count > 1) || (self.mesh.textures.count == 1 && self.mesh.textures["diffuseTexture"]?.url == nil) || (self.renderParameters.count > 0)
     }
     
-    func writeMTL(baseURL: URL) -> String {
-        var result = "newmtl material\(meshIndex)\r\n"
-        
-        // Use only first texture and only if it isn't baked into the model file
-        // TODO It's probably possible to extract this texture, but does anyone care?
-        if let url = mesh.textures["diffuseTexture"]?.url {
-            let baseComponents = baseURL.pathComponents
-            let textureComponents = url.pathComponents
-            
-            // Find where the paths diverge
-            var commonPathLength = 0
-            for i in 0 ..< min(baseComponents.count, textureComponents.count) {
-                if baseComponents[i] != textureComponents[i] {
-                    break
-                } else {
-                    commonPathLength = i
-                }
-            }
-            
-            var relativePathComponents: [String] = []
-            
-            // Add .. for any additional path in the base file
-            for _ in commonPathLength ..< baseComponents.count - 1 {
-                relativePathComponents.append("..")
-            }
-            
-            relativePathComponents.append(contentsOf: textureComponents.dropFirst(commonPathLength))
-            
-            let relativePath = relativePathComponents.joined(separator: "/")
-            result += "map_Kd \(relativePath)\r\n"
-        }
-        return result
-    }
-    
-    func writeOBJ(transformations: [mat_float16], baseIndex: Int, includeColors: Bool) -> String {
-        return mesh.writeOBJ(transformations: transformations, baseIndex: baseIndex, includeColors: includeColors)
-    }
-    
 }
@@ -49,6 +49,8 @@
 
 // Local
 @property (nonatomic, retain, readwrite) GLLShaderData *shader;
+// Weights for the mesh's morph targets, one per target. Start out as the model's defaults and are not stored in the document.
+@property (nonatomic, copy) NSArray<NSNumber *> *morphWeights;
 
 // Called only internally and from child objects, in case some setting changed that requires a shader recompile
 - (void)updateShader;
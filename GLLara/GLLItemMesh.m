@@ -46,6 +46,7 @@
 @dynamic displayName;
 
 @synthesize shader;
+@synthesize morphWeights;
 
 + (NSSet *)keyPathsForValuesAffectingIsUsingBlending
 {
@@ -58,6 +59,7 @@
     
     self.cullFaceMode = self.mesh.cullFaceMode;
     self.isVisible = self.mesh.initiallyVisible;
+    self.morphWeights = self.mesh.morphWeights;
     
     // Set display name
     self.displayName = self.mesh.displayName;
@@ -101,6 +103,7 @@
     
     if (!self.displayName)
         self.displayName = self.mesh.displayName;
+    self.morphWeights = self.mesh.morphWeights;
     
     [self _setupObservingForShaderChanges];
 }
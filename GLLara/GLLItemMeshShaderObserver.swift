@@ -42,7 +42,7 @@ import Combine
     }
     
     private static func buildTree(module: GLLShaderModule?, mesh: GLLItemMesh?) -> GLLShaderModuleObserver {
-        let vertexSemantics = (mesh?.mesh.vertexDataAccessors?.accessors.map { $0.attribute.semantic }) ?? []
+        let vertexSemantics = (mesh?.mesh.vertexDataLayout?.accessors.map { $0.attribute.semantic }) ?? []
         let childArray: [GLLShaderModule] = module?.children ?? []
         let childObservers = childArray.filter { child in
             return child.matches(vertexAttributes: vertexSemantics)
@@ -22,6 +22,8 @@ class GLLItemMeshState {
     let drawer: GLLItemDrawer
     let itemMesh: GLLItemMesh
     let meshData: GLLMeshDrawData
+    // Start of this mesh's bone palette in the item's transforms buffer, in bytes
+    let transformsOffset: Int
     
     var loadedTextures: [LoadedTexture] = []
     var pipelineStateInformation: GLLPipelineStateInformation? = nil
@@ -33,24 +35,36 @@ class GLLItemMeshState {
     private var needsTextureUpdate = true
     private var argumentsEncoder: MTLArgumentEncoder? = nil
     
-    init(itemDrawer: GLLItemDrawer, meshData: GLLMeshDrawData, itemMesh: GLLItemMesh) throws {
+    // Only for meshes with morph targets. The deltas get reused every time the weights change; the buffer has the positions, then the normals.
+    private var morphDeltas = GLLMorphTargetSet.Deltas(countOfVertices: 0)
+    private var morphDeltaBuffer: MTLBuffer? = nil
+    private var needsMorphDeltaUpdate = true
+    
+    // Hidden meshes get no pipeline and no textures until they are shown for the first time. Until everything is ready for them, they don't get drawn.
+    private(set) var isDeferred: Bool
+    private var preparation: Task<Void, Never>? = nil
+    
+    init(itemDrawer: GLLItemDrawer, meshData: GLLMeshDrawData, itemMesh: GLLItemMesh, transformsOffset: Int) throws {
         drawer = itemDrawer
         self.itemMesh = itemMesh
         self.meshData = meshData
+        self.transformsOffset = transformsOffset
+        isDeferred = !itemMesh.isVisible || !meshData.isPrepared
         
         updatePipelineState()
         
         observations.append(itemMesh.observe(\.shader) { [weak self] _,_ in
             self?.needsTextureUpdate = true
             self?.updatePipelineState()
-            self?.drawer.propertiesChanged()
+            self?.drawer.structureChanged()
         })
         observations.append(itemMesh.observe(\.isVisible) { [weak self] _,_ in
+            self?.prepareIfShown()
             self?.drawer.propertiesChanged()
         })
         observations.append(itemMesh.observe(\.isUsingBlending) { [weak self] _,_ in
             self?.updatePipelineState()
-            self?.drawer.propertiesChanged()
+            self?.drawer.structureChanged()
         })
         observations.append(itemMesh.observe(\.textures) { [weak self] _,_ in
             _ = self?.updateTextureObjects()
@@ -58,9 +72,38 @@ class GLLItemMeshState {
         observations.append(itemMesh.observe(\.renderParameters) { [weak self] _,_ in
             _ = self?.updateParameterObjects()
         })
+        observations.append(itemMesh.observe(\.morphWeights) { [weak self] _,_ in
+            self?.needsMorphDeltaUpdate = true
+            // The bounds depend on the weights, too
+            self?.drawer.markUpdateTransforms()
+        })
         
         updateParameterObjects()
         updateTextureObjects()
+        prepareIfShown()
+    }
+    
+    /**
+     * # Gets a deferred mesh ready for drawing, once it is visible.
+     *
+     * Everything happens in the background: The vertex data gets finished and uploaded, if no other item has done that yet, then the textures get loaded. Only then does the mesh get a pipeline and go into the render queue.
+     */
+    private func prepareIfShown() {
+        guard isDeferred, itemMesh.isVisible, preparation == nil else {
+            return
+        }
+        preparation = Task { @MainActor [weak self] in
+            guard let self else {
+                return
+            }
+            await self.meshData.prepare()
+            await self.updateTextures()
+            self.isDeferred = false
+            self.updatePipelineState()
+            // For the meshlets, which deferred meshes only have now
+            self.drawer.markUpdateTransforms()
+            self.drawer.structureChanged()
+        }
     }
     
     private func updateTextureObjects() {
@@ -73,11 +116,11 @@ class GLLItemMeshState {
         for itemMeshTexture in newTextures {
             textureObservations.append(itemMeshTexture.observe(\.textureURL) { [weak self] _,_ in
                 self?.needsTextureUpdate = true
-                self?.drawer.propertiesChanged()
+                self?.drawer.structureChanged()
             })
             textureObservations.append(itemMeshTexture.observe(\.texCoordSet) { [weak self] _,_ in
                 self?.updatePipelineState()
-                self?.drawer.propertiesChanged()
+                self?.drawer.structureChanged()
             })
         }
     }
@@ -136,30 +179,12 @@ class GLLItemMeshState {
         }
     }
     
-    private func parameterColor(name: String, defaultValue: SIMD4<Float32>) -> SIMD4<Float32> {
-        guard let parameter = itemMesh.renderParameter(name: name) as? GLLColorRenderParameter else {
-            return defaultValue
-        }
-        
-        return parameter.colorValue
-    }
-    
-    private func assignParameterColor(name: String, defaultValue: SIMD4<Float32>, encoder: MTLArgumentEncoder, index: GLLFragmentArgumentIndex) {
-        let buffer = encoder.constantData(at: Int(index.rawValue)).bindMemory(to: SIMD4<Float32>.self, capacity: 1)
-        buffer[0] = parameterColor(name: name, defaultValue: defaultValue)
-    }
-    
-    private func parameterFloat(name: String, defaultValue: Float32) -> Float32 {
-        guard let parameter = itemMesh.renderParameter(name: name) as? GLLFloatRenderParameter else {
-            return defaultValue
-        }
-        
-        return parameter.value
+    private func assign(_ value: SIMD4<Float32>, encoder: MTLArgumentEncoder, index: GLLFragmentArgumentIndex) {
+        encoder.constantData(at: Int(index.rawValue)).bindMemory(to: SIMD4<Float32>.self, capacity: 1)[0] = value
     }
     
-    private func assignParameterFloat(name: String, defaultValue: Float32, encoder: MTLArgumentEncoder, index: GLLFragmentArgumentIndex) {
-        let buffer = encoder.constantData(at: Int(index.rawValue)).bindMemory(to: Float32.self, capacity: 1)
-        buffer[0] = parameterFloat(name: name, defaultValue: defaultValue)
+    private func assign(_ value: Float32, encoder: MTLArgumentEncoder, index: GLLFragmentArgumentIndex) {
+        encoder.constantData(at: Int(index.rawValue)).bindMemory(to: Float32.self, capacity: 1)[0] = value
     }
     
     private func updateArgumentBuffer() {
@@ -189,27 +214,19 @@ class GLLItemMeshState {
         }
         
         // Set render parameters
-        // - first the colors, ambient, diffuse, specular
-        assignParameterColor(name: "ambientColor", defaultValue: vector_float4(repeating: 1.0), encoder: encoder, index: GLLFragmentArgumentIndexAmbientColor)
-        assignParameterColor(name: "diffuseColor", defaultValue: vector_float4(repeating: 1.0), encoder: encoder, index: GLLFragmentArgumentIndexDiffuseColor)
-        
-        // Specular color gets special treatment - bumpSpecularAmount gets folded into specularColor
-        let specularColorBuffer = encoder.constantData(at: Int(GLLFragmentArgumentIndexSpecularColor.rawValue)).bindMemory(to: SIMD4<Float32>.self, capacity: 1)
-        let specularColorValue = parameterColor(name: "specularColor", defaultValue: vector_float4(repeating: 1.0))
-        let specularIntensityValue = parameterFloat(name: "bumpSpecularAmount", defaultValue: 1.0)
-        specularColorBuffer[0] = specularColorValue * specularIntensityValue
-        
-        // Specular exponent also gets special treatment - there are two different ways to refer to it
-        let specularExponentBuffer = encoder.constantData(at: Int(GLLFragmentArgumentIndexSpecularExponent.rawValue)).bindMemory(to: Float32.self, capacity: 1)
-        let specularExponentValue = parameterFloat(name: "specularExponent", defaultValue: 0.0)
-        let bumpSpecularAmountValue = parameterFloat(name: "bumpSpecularGloss", defaultValue: 0.0)
-        specularExponentBuffer[0] = max(specularExponentValue, bumpSpecularAmountValue)
-        
-        // - Then the normal floats
-        assignParameterFloat(name: "bump1UVScale", defaultValue: 1.0, encoder: encoder, index: GLLFragmentArgumentIndexBump1UVScale)
-        assignParameterFloat(name: "bump2UVScale", defaultValue: 1.0, encoder: encoder, index: GLLFragmentArgumentIndexBump2UVScale)
-        assignParameterFloat(name: "specularTextureScale", defaultValue: 1.0, encoder: encoder, index: GLLFragmentArgumentIndexSpecularTextureScale)
-        assignParameterFloat(name: "reflectionAmount", defaultValue: 0.0, encoder: encoder, index: GLLFragmentArgumentIndexReflectionAmount)
+        let parameters = itemMesh.fragmentParameters
+        assign(parameters.ambientColor, encoder: encoder, index: GLLFragmentArgumentIndexAmbientColor)
+        assign(parameters.diffuseColor, encoder: encoder, index: GLLFragmentArgumentIndexDiffuseColor)
+        assign(parameters.specularColor, encoder: encoder, index: GLLFragmentArgumentIndexSpecularColor)
+        assign(parameters.specularExponent, encoder: encoder, index: GLLFragmentArgumentIndexSpecularExponent)
+        assign(parameters.bump1UVScale, encoder: encoder, index: GLLFragmentArgumentIndexBump1UVScale)
+        assign(parameters.bump2UVScale, encoder: encoder, index: GLLFragmentArgumentIndexBump2UVScale)
+        assign(parameters.specularTextureScale, encoder: encoder, index: GLLFragmentArgumentIndexSpecularTextureScale)
+        assign(parameters.reflectionAmount, encoder: encoder, index: GLLFragmentArgumentIndexReflectionAmount)
+    }
+    
+    var bonePalette: GLLBonePalette {
+        return meshData.modelMesh.bonePalette
     }
     
     var isBlended: Bool {
@@ -272,8 +289,9 @@ class GLLItemMeshState {
         updateArgumentBuffer()
     }
         
-    private func updatePipelineState() {
-        guard let shader = itemMesh.shader else {
+    // Also called by the scene drawer when the lighting changes
+    func updatePipelineState() {
+        guard !isDeferred, let shader = itemMesh.shader else {
             pipelineStateInformation = nil
             return;
             
@@ -281,19 +299,13 @@ class GLLItemMeshState {
         
         var texCoordAssignments: [Int: Int] = [:]
         for identifier in shader.textureUniforms {
-            let index = textureIndex(for: identifier)
-            if let assignment = itemMesh.texture(identifier: identifier) {
-                if (assignment.texCoordSet < 0) {
-                    if let texture = itemMesh.mesh.textures[identifier], texture.texCoordSet > 0 {
-                        texCoordAssignments[index] = min(texture.texCoordSet, itemMesh.mesh.countOfUVLayers - 1)
-                    }
-                } else if assignment.texCoordSet >= 1{
-                    texCoordAssignments[index] = min(Int(assignment.texCoordSet), itemMesh.mesh.countOfUVLayers - 1)
-                }
+            let texCoordSet = itemMesh.texCoordSet(forTexture: identifier)
+            if texCoordSet >= 1 {
+                texCoordAssignments[textureIndex(for: identifier)] = texCoordSet
             }
         }
         
-        pipelineStateInformation = try! drawer.resourceManager.pipeline(vertex: meshData.vertexArray.optimizedFormat, shader: shader, numberOfTexCoordSets: itemMesh.mesh.countOfUVLayers, texCoordAssignments: texCoordAssignments, hasVariableBoneWeights: itemMesh.mesh.variableBoneWeights != nil)
+        pipelineStateInformation = try! drawer.resourceManager.pipeline(vertex: meshData.vertexArray.optimizedFormat, shader: shader, numberOfTexCoordSets: itemMesh.mesh.countOfUVLayers, texCoordAssignments: texCoordAssignments, hasVariableBoneWeights: itemMesh.mesh.variableBoneWeights != nil, hasQuantizedVertices: meshData.vertexArray.format.isQuantized, hasMorphTargets: meshData.modelMesh.morphTargets != nil, lighting: drawer.sceneDrawer?.lighting ?? GLLLightingConfiguration())
         
         argumentsEncoder = nil
         updateArgumentBuffer()
@@ -313,33 +325,94 @@ class GLLItemMeshState {
         }
     }
     
-    func render(into commandEncoder: MTLRenderCommandEncoder) {
-        guard let pipelineStateInformation = pipelineStateInformation, itemMesh.isVisible else {
-            return
-        }
-        
+    // Textures have to be current before the mesh goes into a render queue, because they are part of its state
+    func updateTexturesIfNeeded() {
         if needsTextureUpdate {
             runAndBlockReturn {
                 await self.updateTextures()
             }
         }
-        
+    }
+    
+    // MARK: - Drawing from the render queue
+    // Each of these sets only one part of the state, so the render queue can skip what is already set.
+    
+    func bindPipeline(into commandEncoder: MTLRenderCommandEncoder) {
+        commandEncoder.setRenderPipelineState(pipelineStateInformation!.pipelineState)
+    }
+    
+    func bindVertexArray(into commandEncoder: MTLRenderCommandEncoder) {
+        commandEncoder.setVertexBuffer(meshData.vertexArray.vertexBuffer, offset: 0, index: 10)
+    }
+    
+    func bindTextures(into commandEncoder: MTLRenderCommandEncoder) {
         /// TODO Ugly
         let textures = loadedTextures.map { $0.texture }
         commandEncoder.useResources(textures, usage: .read, stages: [.fragment])
+    }
+    
+    /**
+     * # Evaluates the morph targets with the item's weights and puts the result in the buffer.
+     *
+     * Quantized meshes have their positions relative to the bounds, so the position offsets get scaled the same way. The normals are decoded in the shader before the offsets get added, so they stay as they are.
+     */
+    private func updateMorphDeltas() {
+        guard let morphTargets = meshData.modelMesh.morphTargets else {
+            return
+        }
+        let weights = itemMesh.morphTargetWeights
+        if weights.count == morphTargets.targets.count {
+            morphTargets.evaluate(weights: weights, into: &morphDeltas)
+        } else {
+            morphDeltas = GLLMorphTargetSet.Deltas(countOfVertices: morphTargets.countOfVertices)
+        }
         
-        commandEncoder.setRenderPipelineState(pipelineStateInformation.pipelineState)
+        let sectionLength = morphTargets.countOfVertices * MemoryLayout<SIMD3<Float>>.stride
+        if morphDeltaBuffer == nil {
+            morphDeltaBuffer = drawer.resourceManager.metalDevice.makeBuffer(length: max(2 * sectionLength, 1), options: .storageModeManaged)
+            morphDeltaBuffer?.label = itemMesh.displayName + "-morph"
+        }
+        let contents = morphDeltaBuffer!.contents()
+        let positions = contents.bindMemory(to: SIMD3<Float>.self, capacity: morphTargets.countOfVertices)
+        let normals = contents.advanced(by: sectionLength).bindMemory(to: SIMD3<Float>.self, capacity: morphTargets.countOfVertices)
+        let inverseScale = meshData.modelMesh.quantization?.inverseScale ?? SIMD3<Float>(repeating: 1)
+        for vertex in 0 ..< morphTargets.countOfVertices {
+            positions[vertex] = morphDeltas.positions[vertex] * inverseScale
+            normals[vertex] = morphDeltas.normals[vertex]
+        }
+        morphDeltaBuffer!.didModifyRange(0 ..< morphDeltaBuffer!.length)
+        needsMorphDeltaUpdate = false
+    }
+    
+    // Sets the state that is different for every mesh, and draws. Level 0 is the full mesh, higher levels are simplified versions if the mesh has them. The element ranges from culling the meshlets only apply to the full mesh.
+    func draw(into commandEncoder: MTLRenderCommandEncoder, detailLevel: Int = 0, elementRanges: [Range<Int>]? = nil) {
         commandEncoder.setFragmentBuffer(fragmentArgumentBuffer, offset: 0, index: Int(GLLFragmentBufferIndexArguments.rawValue))
-        commandEncoder.setVertexBuffer(meshData.vertexArray.vertexBuffer, offset: 0, index: 10)
+        commandEncoder.setVertexBufferOffset(transformsOffset, index: Int(GLLVertexInputIndexTransforms.rawValue))
         commandEncoder.setCullMode(cullMode)
         
         if let boneDataBuffer = meshData.boneDataArray {
             commandEncoder.setVertexBuffer(boneDataBuffer, offset: 0, index: Int(GLLVertexInputIndexBoneWeightBuffer.rawValue))
             commandEncoder.setVertexBuffer(boneDataBuffer, offset: meshData.boneIndexOffset!, index: Int(GLLVertexInputIndexBoneIndexBuffer.rawValue))
         }
+        
+        if let morphTargets = meshData.modelMesh.morphTargets {
+            if needsMorphDeltaUpdate {
+                updateMorphDeltas()
+            }
+            let normalsOffset = morphTargets.countOfVertices * MemoryLayout<SIMD3<Float>>.stride
+            var baseVertex = UInt32(meshData.baseVertex)
+            commandEncoder.setVertexBuffer(morphDeltaBuffer, offset: 0, index: Int(GLLVertexInputIndexMorphPositionDeltas.rawValue))
+            commandEncoder.setVertexBuffer(morphDeltaBuffer, offset: normalsOffset, index: Int(GLLVertexInputIndexMorphNormalDeltas.rawValue))
+            commandEncoder.setVertexBytes(&baseVertex, length: MemoryLayout<UInt32>.stride, index: Int(GLLVertexInputIndexMorphBaseVertex.rawValue))
+        }
 
-        if let elementBuffer = meshData.vertexArray.elementBuffer {
-            commandEncoder.drawIndexedPrimitives(type: .triangle, indexCount: meshData.elementsOrVerticesCount, indexType: meshData.elementType, indexBuffer: elementBuffer, indexBufferOffset: meshData.indicesStart, instanceCount: 1, baseVertex: meshData.baseVertex, baseInstance: 0)
+        if let elementBuffer = meshData.vertexArray.elementBuffer, let elementRanges, detailLevel == 0 || meshData.detailLevelRanges.isEmpty {
+            for range in elementRanges {
+                commandEncoder.drawIndexedPrimitives(type: .triangle, indexCount: range.count, indexType: meshData.elementType, indexBuffer: elementBuffer, indexBufferOffset: meshData.indicesStart + range.lowerBound * meshData.vertexArray.numberOfElementBytes, instanceCount: 1, baseVertex: meshData.baseVertex, baseInstance: 0)
+            }
+        } else if let elementBuffer = meshData.vertexArray.elementBuffer {
+            let elements = meshData.elements(detailLevel: detailLevel)
+            commandEncoder.drawIndexedPrimitives(type: .triangle, indexCount: elements.count, indexType: meshData.elementType, indexBuffer: elementBuffer, indexBufferOffset: elements.indicesStart, instanceCount: 1, baseVertex: meshData.baseVertex, baseInstance: 0)
         } else {
             commandEncoder.drawPrimitives(type: .triangle, vertexStart: meshData.baseVertex, vertexCount: meshData.elementsOrVerticesCount)
         }
@@ -0,0 +1,86 @@
+//
+//  GLLItemSkeleton.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # The bone hierarchy of an item and all its child items.
+ *
+ * Built from the item's combined bones, in the same order. The item caches it and throws it away when child items change, so all queries here can be answered from precomputed data.
+ */
+@objc class GLLItemSkeleton: NSObject {
+    @objc let bones: [GLLItemBone]
+    let hierarchy: GLLSkeletonIndex
+    // False if some bones did not know their model bone yet (e.g. while a document is still loading). Such a skeleton should not be kept around.
+    @objc let isComplete: Bool
+    
+    private let indexOfBone: [ObjectIdentifier: Int]
+    private let childArrays: [[GLLItemBone]]
+    
+    @objc init(bones: [GLLItemBone]) {
+        self.bones = bones
+        
+        var indexOfBone: [ObjectIdentifier: Int] = [:]
+        indexOfBone.reserveCapacity(bones.count)
+        for (i, bone) in bones.enumerated() {
+            indexOfBone[ObjectIdentifier(bone)] = i
+        }
+        self.indexOfBone = indexOfBone
+        
+        let parentIndices = bones.map { bone in
+            bone.parent.flatMap { indexOfBone[ObjectIdentifier($0)] } ?? -1
+        }
+        let hierarchy = GLLSkeletonIndex(parentIndices: parentIndices, names: bones.map { $0.bone?.name ?? "" })
+        self.hierarchy = hierarchy
+        isComplete = bones.allSatisfy { $0.bone != nil }
+        
+        childArrays = bones.indices.map { i in
+            hierarchy.children(of: i).map { bones[Int($0)] }
+        }
+    }
+    
+    // Bones without a parent in this skeleton
+    @objc var rootBones: [GLLItemBone] {
+        return hierarchy.roots.map { bones[$0] }
+    }
+    
+    // Index in bones, or NSNotFound
+    @objc(indexOfBone:) func index(of bone: GLLItemBone) -> Int {
+        return indexOfBone[ObjectIdentifier(bone)] ?? NSNotFound
+    }
+    
+    @objc(parentIndexOfBone:) func parentIndex(of bone: GLLItemBone) -> Int {
+        guard let boneIndex = indexOfBone[ObjectIdentifier(bone)], let parent = hierarchy.parent(of: boneIndex) else {
+            return NSNotFound
+        }
+        return parent
+    }
+    
+    @objc(childrenOfBone:) func children(of bone: GLLItemBone) -> [GLLItemBone] {
+        guard let boneIndex = indexOfBone[ObjectIdentifier(bone)] else {
+            return []
+        }
+        return childArrays[boneIndex]
+    }
+    
+    @objc(isBone:descendantOfBone:) func isBone(_ bone: GLLItemBone, descendantOf ancestor: GLLItemBone) -> Bool {
+        guard let boneIndex = indexOfBone[ObjectIdentifier(bone)], let ancestorIndex = indexOfBone[ObjectIdentifier(ancestor)] else {
+            return false
+        }
+        return hierarchy.isDescendant(boneIndex, of: ancestorIndex)
+    }
+    
+    // For every bone, whether it is below any of the selected ones. Selected bones that are not part of this skeleton are ignored.
+    func descendantsMask(ofAny selected: [GLLItemBone]) -> [Bool] {
+        return hierarchy.descendantsMask(ofAny: selected.compactMap { indexOfBone[ObjectIdentifier($0)] })
+    }
+    
+    @objc func bone(name: String) -> GLLItemBone? {
+        return hierarchy.index(named: name).map { bones[$0] }
+    }
+}
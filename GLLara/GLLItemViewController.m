@@ -10,6 +10,7 @@
 
 #import <UniformTypeIdentifiers/UniformTypeIdentifiers.h>
 
+#import "GLLDocument.h"
 #import "GLLItem.h"
 #import "GLLItemMesh.h"
 #import "GLLara-Swift.h"
@@ -52,15 +53,19 @@
             return;
         }
         
-        self.undoManager.actionName = NSLocalizedString(@"Load pose", @"load pose undo action name");
+        // All selected items get updated and redrawn once, as one undo step
+        GLLDocument *document = self.view.window.windowController.document;
+        [document beginBatchEdit];
         for (GLLItem *item in self.selectedItems)
         {
             if (![item loadPoseWithDescription:file error:&error])
             {
+                [document endBatchEditWithActionName:nil];
                 [self.view.window presentError:error];
                 return;
             }
         }
+        [document endBatchEditWithActionName:NSLocalizedString(@"Load pose", @"load pose undo action name")];
     }];
 }
 - (IBAction)loadChildModel:(id)sender;
@@ -0,0 +1,270 @@
+//
+//  GLLLightClusters.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # A light at a position that only reaches so far.
+ *
+ * Spot lights are point lights that only shine into a cone. The light fades out towards its range and is gone beyond it; that is what allows sorting lights into clusters at all.
+ */
+struct GLLPointLight {
+    var position: SIMD3<Float>
+    var range: Float
+    var color: SIMD4<Float>
+    // Where a spot light shines, and the cosine of half the cone's angle. Point lights have -1, which means everywhere.
+    var spotDirection = SIMD3<Float>(0, 0, -1)
+    var spotCosine: Float = -1
+    
+    var uniformBlock: GLLPointLightBuffer {
+        return GLLPointLightBuffer(positionAndRange: SIMD4<Float>(position, range), color: color, spotDirectionAndCosine: SIMD4<Float>(simd_normalize(spotDirection), spotCosine))
+    }
+    
+    // A sphere around everything the light reaches. For narrow spot lights, that is a lot smaller than the one around the position.
+    var boundingSphere: (center: SIMD3<Float>, radius: Float) {
+        if spotCosine <= 0 {
+            return (position, range)
+        }
+        let direction = simd_normalize(spotDirection)
+        if spotCosine < Float(0.5).squareRoot() {
+            // Wide cone: The disk at its end is the widest part
+            let sine = (1 - spotCosine * spotCosine).squareRoot()
+            return (position + direction * range * spotCosine, range * sine)
+        }
+        // Narrow cone: The sphere through the tip and the rim of the disk
+        let radius = range / (2 * spotCosine)
+        return (position + direction * radius, radius)
+    }
+}
+
+// What the shaders have to do for lighting. It is part of the pipeline, so only the combinations that scenes actually use get compiled.
+struct GLLLightingConfiguration: Hashable {
+    // Only the enabled ones, which come first in the lights buffer
+    var directionalLights = 3
+    var hasClusteredLights = false
+}
+
+/**
+ * # Point and spot lights sorted into clusters of the view frustum.
+ *
+ * The screen is split into tiles, and the depth into slices that get thicker further away, since there is less to see there per unit of depth. Every cluster gets the list of lights whose range touches it, so a fragment only looks at the few lights that can reach it, instead of all of them.
+ *
+ * The lists are built on the CPU every frame, one depth slice per thread. They end up in one array of light indices; each cluster has an offset into it and a count.
+ */
+struct GLLLightClusters {
+    struct Grid {
+        var tilesX = 16
+        var tilesY = 9
+        var slices = 24
+        var near: Float
+        var far: Float
+        // Projection from view space x and y divided by depth to normalized device coordinates. The offset is zero except for tiles of a larger image.
+        var projectionScale: SIMD2<Float>
+        var projectionOffset = SIMD2<Float>(repeating: 0)
+        
+        // With the parameters of GLLCamera; the angle is in degrees
+        init(fieldOfViewY: Float, aspectRatio: Float, near: Float, far: Float) {
+            let tanHalfY = tan(fieldOfViewY * Float.pi / 360)
+            projectionScale = SIMD2<Float>(1 / (tanHalfY * aspectRatio), 1 / tanHalfY)
+            self.near = near
+            self.far = far
+        }
+        
+        // Takes scale and offset from a projection matrix, which may be cropped to a tile
+        init(projection: matrix_float4x4, near: Float, far: Float) {
+            projectionScale = SIMD2<Float>(projection.columns.0.x, projection.columns.1.y)
+            projectionOffset = SIMD2<Float>(projection.columns.2.x, projection.columns.2.y)
+            self.near = near
+            self.far = far
+        }
+        
+        var count: Int {
+            return tilesX * tilesY * slices
+        }
+        
+        func index(x: Int, y: Int, slice: Int) -> Int {
+            return (slice * tilesY + y) * tilesX + x
+        }
+        
+        // Slice from the logarithm of the depth
+        var sliceScale: Float {
+            return Float(slices) / log(far / near)
+        }
+        var sliceBias: Float {
+            return -log(near) * sliceScale
+        }
+        
+        func slice(depth: Float) -> Int {
+            return min(max(Int(floor(log(depth) * sliceScale + sliceBias)), 0), slices - 1)
+        }
+        
+        // Where the slice starts; slice `slices` is the far plane
+        func depth(slice: Int) -> Float {
+            return near * pow(far / near, Float(slice) / Float(slices))
+        }
+        
+        // The cluster of a point in view space, or nil outside of the frustum
+        func cluster(viewPosition: SIMD3<Float>) -> Int? {
+            let depth = -viewPosition.z
+            guard depth >= near && depth <= far else {
+                return nil
+            }
+            let ndc = projectionScale * SIMD2<Float>(viewPosition.x, viewPosition.y) / depth - projectionOffset
+            guard all(abs(ndc) .<= SIMD2<Float>(repeating: 1)) else {
+                return nil
+            }
+            let x = min(Int((ndc.x + 1) * 0.5 * Float(tilesX)), tilesX - 1)
+            let y = min(Int((ndc.y + 1) * 0.5 * Float(tilesY)), tilesY - 1)
+            return index(x: x, y: y, slice: slice(depth: depth))
+        }
+        
+        // View space box around a cluster
+        func bounds(x: Int, y: Int, slice: Int) -> GLLBoundingBox {
+            let nearDepth = depth(slice: slice)
+            let farDepth = depth(slice: slice + 1)
+            // Corners of the tile at depth 1
+            let ndcMin = SIMD2<Float>(Float(x) / Float(tilesX), Float(y) / Float(tilesY)) * 2 - 1
+            let ndcMax = SIMD2<Float>(Float(x + 1) / Float(tilesX), Float(y + 1) / Float(tilesY)) * 2 - 1
+            let low = (ndcMin + projectionOffset) / projectionScale
+            let high = (ndcMax + projectionOffset) / projectionScale
+            return GLLBoundingBox(min: SIMD3<Float>(simd_min(low * nearDepth, low * farDepth), -farDepth),
+                                  max: SIMD3<Float>(simd_max(high * nearDepth, high * farDepth), -nearDepth))
+        }
+    }
+    
+    let grid: Grid
+    let viewMatrix: matrix_float4x4
+    // Offset into indices and count, per cluster
+    let ranges: [SIMD2<UInt32>]
+    // Indices into the list of lights. Within a cluster, they are in the order of that list.
+    let indices: [UInt32]
+    
+    /**
+     * # Sorts the lights into the clusters.
+     *
+     * Each light's bounding sphere goes into view space, and from its depth it is clear which slices it can touch. Within each slice, the sphere gives a range of tiles, and only those get tested properly against the box of the cluster. The slices are independent, so they run in parallel; without concurrency, the result is exactly the same.
+     */
+    init(lights: [GLLPointLight], viewMatrix: matrix_float4x4, grid: Grid, concurrent: Bool = true) {
+        self.grid = grid
+        self.viewMatrix = viewMatrix
+        
+        // Which lights each slice has to look at, as view space spheres
+        var spheres: [SIMD4<Float>] = []
+        spheres.reserveCapacity(lights.count)
+        var lightsPerSlice = Array(repeating: [UInt32](), count: grid.slices)
+        for (index, light) in lights.enumerated() {
+            let sphere = light.boundingSphere
+            let center = viewMatrix * SIMD4<Float>(sphere.center, 1)
+            spheres.append(SIMD4<Float>(center.x, center.y, center.z, sphere.radius))
+            
+            let depth = -center.z
+            guard depth + sphere.radius >= grid.near && depth - sphere.radius <= grid.far else {
+                continue
+            }
+            let firstSlice = grid.slice(depth: max(depth - sphere.radius, grid.near))
+            let lastSlice = grid.slice(depth: min(depth + sphere.radius, grid.far))
+            for slice in firstSlice ... lastSlice {
+                lightsPerSlice[slice].append(UInt32(index))
+            }
+        }
+        
+        var sliceRanges = Array(repeating: [SIMD2<UInt32>](), count: grid.slices)
+        var sliceIndices = Array(repeating: [UInt32](), count: grid.slices)
+        if concurrent {
+            sliceRanges.withUnsafeMutableBufferPointer { sliceRanges in
+                sliceIndices.withUnsafeMutableBufferPointer { sliceIndices in
+                    DispatchQueue.concurrentPerform(iterations: grid.slices) { slice in
+                        GLLLightClusters.bin(slice: slice, grid: grid, spheres: spheres, candidates: lightsPerSlice[slice], ranges: &sliceRanges[slice], indices: &sliceIndices[slice])
+                    }
+                }
+            }
+        } else {
+            for slice in 0 ..< grid.slices {
+                GLLLightClusters.bin(slice: slice, grid: grid, spheres: spheres, candidates: lightsPerSlice[slice], ranges: &sliceRanges[slice], indices: &sliceIndices[slice])
+            }
+        }
+        
+        // Slices are in cluster order already, only the offsets need to move
+        var ranges: [SIMD2<UInt32>] = []
+        ranges.reserveCapacity(grid.count)
+        var indices: [UInt32] = []
+        indices.reserveCapacity(sliceIndices.reduce(0) { $0 + $1.count })
+        for slice in 0 ..< grid.slices {
+            let base = UInt32(indices.count)
+            ranges.append(contentsOf: sliceRanges[slice].map { SIMD2<UInt32>($0.x + base, $0.y) })
+            indices.append(contentsOf: sliceIndices[slice])
+        }
+        self.ranges = ranges
+        self.indices = indices
+    }
+    
+    private static func bin(slice: Int, grid: Grid, spheres: [SIMD4<Float>], candidates: [UInt32], ranges: inout [SIMD2<UInt32>], indices: inout [UInt32]) {
+        let tileCount = grid.tilesX * grid.tilesY
+        var lightsPerTile = Array(repeating: [UInt32](), count: tileCount)
+        let sliceNear = grid.depth(slice: slice)
+        let sliceFar = grid.depth(slice: slice + 1)
+        let tiles = SIMD2<Float>(Float(grid.tilesX), Float(grid.tilesY))
+        let lastTile = SIMD2<Int32>(Int32(grid.tilesX - 1), Int32(grid.tilesY - 1))
+        
+        for light in candidates {
+            let sphere = spheres[Int(light)]
+            let center = SIMD3<Float>(sphere.x, sphere.y, sphere.z)
+            let radius = sphere.w
+            
+            // Screen rectangle of the part of the sphere's box within this slice
+            let nearDepth = max(sliceNear, -center.z - radius)
+            let farDepth = min(sliceFar, -center.z + radius)
+            let low = SIMD2<Float>(center.x, center.y) - radius
+            let high = SIMD2<Float>(center.x, center.y) + radius
+            let ndcMin = grid.projectionScale * simd_min(low / nearDepth, low / farDepth) - grid.projectionOffset
+            let ndcMax = grid.projectionScale * simd_max(high / nearDepth, high / farDepth) - grid.projectionOffset
+            if any(ndcMax .< SIMD2<Float>(repeating: -1)) || any(ndcMin .> SIMD2<Float>(repeating: 1)) {
+                continue
+            }
+            let screenMin = simd_clamp(ndcMin, SIMD2<Float>(repeating: -1), SIMD2<Float>(repeating: 1))
+            let screenMax = simd_clamp(ndcMax, SIMD2<Float>(repeating: -1), SIMD2<Float>(repeating: 1))
+            let firstTile = simd_min(SIMD2<Int32>(floor((screenMin + 1) * 0.5 * tiles)), lastTile)
+            let lastTileOfLight = simd_min(SIMD2<Int32>(floor((screenMax + 1) * 0.5 * tiles)), lastTile)
+            
+            for y in Int(firstTile.y) ... Int(lastTileOfLight.y) {
+                for x in Int(firstTile.x) ... Int(lastTileOfLight.x) {
+                    let bounds = grid.bounds(x: x, y: y, slice: slice)
+                    let closest = simd_clamp(center, bounds.min, bounds.max)
+                    if simd_distance_squared(closest, center) <= radius * radius {
+                        lightsPerTile[y * grid.tilesX + x].append(light)
+                    }
+                }
+            }
+        }
+        
+        ranges.reserveCapacity(tileCount)
+        for tile in lightsPerTile {
+            ranges.append(SIMD2<UInt32>(UInt32(indices.count), UInt32(tile.count)))
+            indices.append(contentsOf: tile)
+        }
+    }
+    
+    func lights(inCluster cluster: Int) -> ArraySlice<UInt32> {
+        let range = ranges[cluster]
+        return indices[Int(range.x) ..< Int(range.x + range.y)]
+    }
+    
+    var maximumLightsPerCluster: Int {
+        return Int(ranges.map { $0.y }.max() ?? 0)
+    }
+    
+    var uniformBlock: GLLLightClusterParameters {
+        return GLLLightClusterParameters(viewMatrix: viewMatrix,
+                                         clusterCounts: SIMD4<UInt32>(UInt32(grid.tilesX), UInt32(grid.tilesY), UInt32(grid.slices), 0),
+                                         projectionScale: grid.projectionScale,
+                                         projectionOffset: grid.projectionOffset,
+                                         depthSliceScale: grid.sliceScale,
+                                         depthSliceBias: grid.sliceBias)
+    }
+}
@@ -9,7 +9,7 @@
 import Cocoa
 
 /**
- * Source list controller for a single light (whether diffuse or ambient).
+ * Source list controller for a single light (whether diffuse, ambient, point or spot).
  */
 @objc class GLLLightController : NSObject, NSOutlineViewDataSource {
     init(light: NSManagedObject, parentController: AnyObject) {
@@ -30,6 +30,9 @@ import Cocoa
     func outlineView(_ outlineView: NSOutlineView, objectValueFor tableColumn: NSTableColumn?, byItem item: Any?) -> Any? {
         if light.entity.name == "GLLAmbientLight" {
             return NSLocalizedString("Ambient", comment: "source view - lights");
+        } else if let positionalLight = light as? GLLPositionalLight {
+            let format = positionalLight.isSpotLight ? NSLocalizedString("Spot %@", comment: "source view - lights") : NSLocalizedString("Point %@", comment: "source view - lights")
+            return String(format: format, NSNumber(value: positionalLight.index))
         } else {
             return String(format: NSLocalizedString("Diffuse %@", comment: "source view - lights"), light.value(forKey: "index") as! NSNumber)
         }
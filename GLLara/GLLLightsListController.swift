@@ -16,16 +16,43 @@
         
         super.init()
         
-        let request = NSFetchRequest<NSManagedObject>(entityName: "GLLLight")
-        request.sortDescriptors = [ NSSortDescriptor(key: "index", ascending: true) ]
+        // Point and spot lights can get added and removed, and the name shows whether it is a spot light
+        observation = NotificationCenter.default.addObserver(forName: Notification.Name.NSManagedObjectContextObjectsDidChange, object: managedObjectContext, queue: OperationQueue.main) { [weak self] notification in
+            guard let self else {
+                return
+            }
+            
+            let changedObjects = [NSInsertedObjectsKey, NSDeletedObjectsKey, NSUpdatedObjectsKey].compactMap { notification.userInfo?[$0] as? Set<NSManagedObject> }
+            guard changedObjects.contains(where: { objects in objects.contains { $0 is GLLPositionalLight } }) else {
+                return
+            }
+            updateLights()
+            outlineView.reloadItem(self, reloadChildren: true)
+        }
         
-        lights = try! managedObjectContext.fetch(request).map { GLLLightController(light: $0, parentController: self) }
+        updateLights()
+    }
+    
+    deinit {
+        if let observation {
+            NotificationCenter.default.removeObserver(observation)
+        }
     }
     
     @objc let managedObjectContext: NSManagedObjectContext
     @objc let outlineView: NSOutlineView
     
     var lights: [GLLLightController] = []
+    var observation: AnyObject? = nil
+    
+    private func updateLights() {
+        let request = NSFetchRequest<NSManagedObject>(entityName: "GLLLight")
+        request.sortDescriptors = [ NSSortDescriptor(key: "index", ascending: true) ]
+        
+        // Keep the controllers of lights that are still there, so the outline view's selection stays valid
+        let existing = Dictionary(uniqueKeysWithValues: lights.map { ($0.light, $0) })
+        lights = try! managedObjectContext.fetch(request).map { existing[$0] ?? GLLLightController(light: $0, parentController: self) }
+    }
     
     @objc var allSelectableControllers: [GLLLightController] {
         return lights
@@ -0,0 +1,408 @@
+//
+//  GLLMeshBVH.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # Bounding volume hierarchy over the triangles of one mesh, for picking.
+ *
+ * It gets built once from the bind pose. When the pose changes, every triangle stays in the same leaf and only the boxes change to fit the new positions. That refit is much faster than building again; the boxes are not as tight as a new build would make them, but for finding what is under the mouse, that does not matter.
+ *
+ * Every node has up to four children, and a ray is tested against all four boxes at once. Leaves are ranges of at most four triangles in the triangle order.
+ */
+struct GLLMeshBVH {
+    struct Node {
+        // Boxes of the children, one per lane. Unused lanes have a box at infinity, which no ray hits.
+        var minX = SIMD4<Float>(repeating: .infinity)
+        var minY = SIMD4<Float>(repeating: .infinity)
+        var minZ = SIMD4<Float>(repeating: .infinity)
+        var maxX = SIMD4<Float>(repeating: .infinity)
+        var maxY = SIMD4<Float>(repeating: .infinity)
+        var maxZ = SIMD4<Float>(repeating: .infinity)
+        // For inner children the index of the node, for leaves the start in the triangle order
+        var child = SIMD4<UInt32>(repeating: 0)
+        // Triangles in leaves; 0 for inner children and unused lanes
+        var count = SIMD4<UInt32>(repeating: 0)
+        
+        func isUsed(lane: Int) -> Bool {
+            return minX[lane] != .infinity
+        }
+        
+        mutating func set(lane: Int, bounds: GLLBoundingBox) {
+            minX[lane] = bounds.min.x
+            minY[lane] = bounds.min.y
+            minZ[lane] = bounds.min.z
+            maxX[lane] = bounds.max.x
+            maxY[lane] = bounds.max.y
+            maxZ[lane] = bounds.max.z
+        }
+        
+        // Around all children
+        var bounds: GLLBoundingBox {
+            let unused = minX .== SIMD4<Float>(repeating: .infinity)
+            let lowest = -SIMD4<Float>(repeating: .infinity)
+            return GLLBoundingBox(min: SIMD3<Float>(minX.min(), minY.min(), minZ.min()),
+                                  max: SIMD3<Float>(maxX.replacing(with: lowest, where: unused).max(), maxY.replacing(with: lowest, where: unused).max(), maxZ.replacing(with: lowest, where: unused).max()))
+        }
+    }
+    
+    struct Hit {
+        var triangle: Int
+        var distance: Float
+        // Weights of the triangle's three corners at the hit point
+        var barycentrics: SIMD3<Float>
+    }
+    
+    static let maximumLeafSize = 4
+    // Triangles or nodes that one worker handles at a time
+    static let trianglesPerChunk = 4096
+    
+    let indices: [UInt32]
+    private(set) var positions: [SIMD3<Float>]
+    // Node 0 is the root; children always come after their parents
+    private(set) var nodes: [Node] = []
+    // Triangle numbers, in the order in which the leaves reference them
+    private(set) var triangleOrder: [UInt32] = []
+    
+    var countOfTriangles: Int {
+        return indices.count / 3
+    }
+    
+    /**
+     * # Builds the hierarchy.
+     *
+     * Every node splits its triangles in two with a binned surface area heuristic, and then the larger half again, until it has four children. The top two levels are built first; below them, the subtrees are independent and get built in parallel, each into its own list of nodes that gets appended at the end.
+     */
+    init(positions: [SIMD3<Float>], indices: [UInt32], concurrent: Bool = true) {
+        precondition(indices.count % 3 == 0)
+        self.positions = positions
+        self.indices = indices
+        
+        let triangleCount = indices.count / 3
+        guard triangleCount > 0 else {
+            return
+        }
+        
+        // Box and center of every triangle
+        var triangleBounds = Array(repeating: GLLBoundingBox.empty, count: triangleCount)
+        var centers = Array(repeating: SIMD3<Float>(), count: triangleCount)
+        triangleBounds.withUnsafeMutableBufferPointer { triangleBounds in
+            centers.withUnsafeMutableBufferPointer { centers in
+                let chunks = (triangleCount + GLLMeshBVH.trianglesPerChunk - 1) / GLLMeshBVH.trianglesPerChunk
+                DispatchQueue.concurrentPerform(iterations: chunks) { chunk in
+                    let start = chunk * GLLMeshBVH.trianglesPerChunk
+                    let end = min(start + GLLMeshBVH.trianglesPerChunk, triangleCount)
+                    for triangle in start ..< end {
+                        var box = GLLBoundingBox.empty
+                        box.add(positions[Int(indices[triangle * 3 + 0])])
+                        box.add(positions[Int(indices[triangle * 3 + 1])])
+                        box.add(positions[Int(indices[triangle * 3 + 2])])
+                        triangleBounds[triangle] = box
+                        centers[triangle] = box.center
+                    }
+                }
+            }
+        }
+        
+        var order = Array(0 ..< UInt32(triangleCount))
+        var nodes: [Node] = []
+        order.withUnsafeMutableBufferPointer { order in
+            var builder = Builder(bounds: triangleBounds, centers: centers, order: order, parallelDepth: concurrent ? 2 : Int.max)
+            _ = builder.build(range: 0 ..< triangleCount, depth: 0)
+            nodes = builder.nodes
+            
+            // The subtrees work on separate parts of the order, so they don't get in each other's way
+            let deferred = builder.deferred
+            var subtrees = Array(repeating: [Node](), count: deferred.count)
+            subtrees.withUnsafeMutableBufferPointer { subtrees in
+                DispatchQueue.concurrentPerform(iterations: deferred.count) { task in
+                    var subtreeBuilder = Builder(bounds: triangleBounds, centers: centers, order: order, parallelDepth: Int.max)
+                    _ = subtreeBuilder.build(range: deferred[task].range, depth: 0)
+                    subtrees[task] = subtreeBuilder.nodes
+                }
+            }
+            for (task, subtree) in zip(deferred, subtrees) {
+                let base = UInt32(nodes.count)
+                nodes[task.node].child[task.lane] = base
+                nodes.append(contentsOf: subtree.map { node in
+                    var node = node
+                    node.child = node.child.replacing(with: node.child &+ base, where: node.count .== SIMD4<UInt32>(repeating: 0))
+                    return node
+                })
+            }
+        }
+        self.nodes = nodes
+        self.triangleOrder = order
+    }
+    
+    private struct Builder {
+        let bounds: [GLLBoundingBox]
+        let centers: [SIMD3<Float>]
+        let order: UnsafeMutableBufferPointer<UInt32>
+        // Inner children at this depth are not built, but left for later
+        let parallelDepth: Int
+        
+        var nodes: [Node] = []
+        var deferred: [(node: Int, lane: Int, range: Range<Int>)] = []
+        
+        static let binCount = 12
+        
+        mutating func build(range: Range<Int>, depth: Int) -> Int {
+            let index = nodes.count
+            nodes.append(Node())
+            
+            // Split the largest part until there are four, or nothing more to split
+            var ranges = [range]
+            while ranges.count < 4, let largest = ranges.indices.filter({ ranges[$0].count > GLLMeshBVH.maximumLeafSize }).max(by: { ranges[$0].count < ranges[$1].count }) {
+                let part = ranges[largest]
+                let middle = split(part)
+                ranges.replaceSubrange(largest ... largest, with: [part.lowerBound ..< middle, middle ..< part.upperBound])
+            }
+            
+            var node = Node()
+            for (lane, part) in ranges.enumerated() {
+                var box = GLLBoundingBox.empty
+                for i in part {
+                    box.formUnion(bounds[Int(order[i])])
+                }
+                node.set(lane: lane, bounds: box)
+                
+                if part.count <= GLLMeshBVH.maximumLeafSize {
+                    node.child[lane] = UInt32(part.lowerBound)
+                    node.count[lane] = UInt32(part.count)
+                } else if depth + 1 >= parallelDepth {
+                    deferred.append((index, lane, part))
+                } else {
+                    node.child[lane] = UInt32(build(range: part, depth: depth + 1))
+                }
+            }
+            nodes[index] = node
+            return index
+        }
+        
+        // Partitions the range in place, and returns where the second part starts
+        private func split(_ range: Range<Int>) -> Int {
+            var centerBounds = GLLBoundingBox.empty
+            for i in range {
+                centerBounds.add(centers[Int(order[i])])
+            }
+            let size = centerBounds.max - centerBounds.min
+            let axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2)
+            let middle = range.lowerBound + range.count / 2
+            guard size[axis] > 0 else {
+                // All in the same spot; any split is as good as any other
+                return middle
+            }
+            
+            let binCount = Builder.binCount
+            let scale = Float(binCount) / size[axis]
+            let start = centerBounds.min[axis]
+            func bin(_ triangle: UInt32) -> Int {
+                return min(Int((centers[Int(triangle)][axis] - start) * scale), binCount - 1)
+            }
+            
+            var binBounds = Array(repeating: GLLBoundingBox.empty, count: binCount)
+            var binCounts = Array(repeating: 0, count: binCount)
+            for i in range {
+                let triangle = order[i]
+                let b = bin(triangle)
+                binCounts[b] += 1
+                binBounds[b].formUnion(bounds[Int(triangle)])
+            }
+            
+            // Cost of every plane between bins: Surface area times triangles, on both sides
+            var leftCost = Array(repeating: Float(0), count: binCount - 1)
+            var leftCount = Array(repeating: 0, count: binCount - 1)
+            var box = GLLBoundingBox.empty
+            var count = 0
+            for plane in 0 ..< binCount - 1 {
+                box.formUnion(binBounds[plane])
+                count += binCounts[plane]
+                leftCost[plane] = Builder.area(box) * Float(count)
+                leftCount[plane] = count
+            }
+            
+            var bestPlane = -1
+            var bestCost = Float.infinity
+            box = .empty
+            count = 0
+            for plane in stride(from: binCount - 2, through: 0, by: -1) {
+                box.formUnion(binBounds[plane + 1])
+                count += binCounts[plane + 1]
+                let cost = leftCost[plane] + Builder.area(box) * Float(count)
+                if leftCount[plane] > 0 && count > 0 && cost < bestCost {
+                    bestCost = cost
+                    bestPlane = plane
+                }
+            }
+            guard bestPlane >= 0 else {
+                return middle
+            }
+            
+            var left = range.lowerBound
+            var right = range.upperBound - 1
+            while left <= right {
+                if bin(order[left]) <= bestPlane {
+                    left += 1
+                } else {
+                    let swapped = order[left]
+                    order[left] = order[right]
+                    order[right] = swapped
+                    right -= 1
+                }
+            }
+            return left
+        }
+        
+        private static func area(_ box: GLLBoundingBox) -> Float {
+            if box.isEmpty {
+                return 0
+            }
+            let size = box.max - box.min
+            return size.x * size.y + size.y * size.z + size.z * size.x
+        }
+    }
+    
+    // MARK: - Refit
+    
+    /**
+     * # Fits the boxes to new positions of the same vertices.
+     *
+     * The leaves only depend on their triangles, so they get done in parallel. Inner boxes then go from the back, since children always come after their parents.
+     */
+    mutating func refit(positions newPositions: [SIMD3<Float>]) {
+        precondition(newPositions.count == positions.count)
+        positions = newPositions
+        
+        let nodeCount = nodes.count
+        let positions = self.positions
+        let indices = self.indices
+        let triangleOrder = self.triangleOrder
+        nodes.withUnsafeMutableBufferPointer { nodes in
+            let chunks = (nodeCount + GLLMeshBVH.trianglesPerChunk - 1) / GLLMeshBVH.trianglesPerChunk
+            DispatchQueue.concurrentPerform(iterations: chunks) { chunk in
+                let start = chunk * GLLMeshBVH.trianglesPerChunk
+                let end = min(start + GLLMeshBVH.trianglesPerChunk, nodeCount)
+                for index in start ..< end {
+                    for lane in 0 ..< 4 where nodes[index].count[lane] > 0 {
+                        var box = GLLBoundingBox.empty
+                        let first = Int(nodes[index].child[lane])
+                        for triangle in triangleOrder[first ..< first + Int(nodes[index].count[lane])] {
+                            box.add(positions[Int(indices[Int(triangle) * 3 + 0])])
+                            box.add(positions[Int(indices[Int(triangle) * 3 + 1])])
+                            box.add(positions[Int(indices[Int(triangle) * 3 + 2])])
+                        }
+                        nodes[index].set(lane: lane, bounds: box)
+                    }
+                }
+            }
+        }
+        
+        for index in nodes.indices.reversed() {
+            for lane in 0 ..< 4 where nodes[index].count[lane] == 0 && nodes[index].isUsed(lane: lane) {
+                let childBounds = nodes[Int(nodes[index].child[lane])].bounds
+                nodes[index].set(lane: lane, bounds: childBounds)
+            }
+        }
+    }
+    
+    // MARK: - Ray queries
+    
+    /**
+     * # The closest triangle that the ray hits, from either side.
+     *
+     * The direction does not need to be normalized; the distance is in multiples of it. Children get visited closest first, and anything further away than the best hit so far gets skipped.
+     */
+    func intersect(origin: SIMD3<Float>, direction: SIMD3<Float>, maximumDistance: Float = .infinity) -> Hit? {
+        guard !nodes.isEmpty else {
+            return nil
+        }
+        
+        // No zeros, so that there is no infinity times zero in the slab test
+        let safeDirection = direction.replacing(with: SIMD3<Float>(repeating: 1e-30), where: direction .== SIMD3<Float>(repeating: 0))
+        let inverse = 1 / safeDirection
+        let originX = SIMD4<Float>(repeating: origin.x), originY = SIMD4<Float>(repeating: origin.y), originZ = SIMD4<Float>(repeating: origin.z)
+        let inverseX = SIMD4<Float>(repeating: inverse.x), inverseY = SIMD4<Float>(repeating: inverse.y), inverseZ = SIMD4<Float>(repeating: inverse.z)
+        
+        var closest: Hit? = nil
+        var farthest = maximumDistance
+        var stack: [(node: UInt32, distance: Float)] = [(0, 0)]
+        stack.reserveCapacity(64)
+        
+        while let entry = stack.popLast() {
+            if entry.distance > farthest {
+                continue
+            }
+            let node = nodes[Int(entry.node)]
+            
+            // All four boxes at once
+            let t0x = (node.minX - originX) * inverseX, t1x = (node.maxX - originX) * inverseX
+            let t0y = (node.minY - originY) * inverseY, t1y = (node.maxY - originY) * inverseY
+            let t0z = (node.minZ - originZ) * inverseZ, t1z = (node.maxZ - originZ) * inverseZ
+            let near = simd_max(simd_max(simd_min(t0x, t1x), simd_min(t0y, t1y)), simd_max(simd_min(t0z, t1z), SIMD4<Float>(repeating: 0)))
+            let far = simd_min(simd_min(simd_max(t0x, t1x), simd_max(t0y, t1y)), simd_min(simd_max(t0z, t1z), SIMD4<Float>(repeating: farthest)))
+            let hits = near .<= far
+            if !any(hits) {
+                continue
+            }
+            
+            let pushedBefore = stack.count
+            for lane in 0 ..< 4 where hits[lane] {
+                let count = Int(node.count[lane])
+                if count == 0 {
+                    stack.append((node.child[lane], near[lane]))
+                    continue
+                }
+                let first = Int(node.child[lane])
+                for triangle in triangleOrder[first ..< first + count] {
+                    if let hit = intersect(triangle: Int(triangle), origin: origin, direction: direction, maximumDistance: farthest) {
+                        closest = hit
+                        farthest = hit.distance
+                    }
+                }
+            }
+            
+            // The closest child gets popped first
+            if stack.count - pushedBefore > 1 {
+                stack[pushedBefore...].sort { $0.distance > $1.distance }
+            }
+        }
+        return closest
+    }
+    
+    // Möller-Trumbore
+    @inline(__always) private func intersect(triangle: Int, origin: SIMD3<Float>, direction: SIMD3<Float>, maximumDistance: Float) -> Hit? {
+        let a = positions[Int(indices[triangle * 3 + 0])]
+        let b = positions[Int(indices[triangle * 3 + 1])]
+        let c = positions[Int(indices[triangle * 3 + 2])]
+        let edge1 = b - a
+        let edge2 = c - a
+        let p = simd_cross(direction, edge2)
+        let determinant = simd_dot(edge1, p)
+        if determinant == 0 {
+            return nil
+        }
+        let inverseDeterminant = 1 / determinant
+        let s = origin - a
+        let u = simd_dot(s, p) * inverseDeterminant
+        if u < 0 || u > 1 {
+            return nil
+        }
+        let q = simd_cross(s, edge1)
+        let v = simd_dot(direction, q) * inverseDeterminant
+        if v < 0 || u + v > 1 {
+            return nil
+        }
+        let distance = simd_dot(edge2, q) * inverseDeterminant
+        if distance <= 0 || distance >= maximumDistance {
+            return nil
+        }
+        return Hit(triangle: triangle, distance: distance, barycentrics: SIMD3<Float>(1 - u - v, u, v))
+    }
+}
@@ -14,46 +14,145 @@ class GLLMeshDrawData {
     let modelMesh: GLLModelMesh
     
     let elementType: MTLIndexType
-    let baseVertex: Int
-    let indicesStart: Int
-    let elementsOrVerticesCount: Int
+    // Set once the mesh has space in the vertex array, which for deferred meshes is in prepare()
+    private(set) var baseVertex = 0
+    private(set) var indicesStart = 0
+    private(set) var elementsOrVerticesCount = 0
     let vertexArray: GLLVertexArray
-    let boneDataArray: MTLBuffer?
-    let boneIndexOffset: Int?
-    let reservation: GLLVertexArray.Reservation
+    private(set) var boneDataArray: MTLBuffer?
+    private(set) var boneIndexOffset: Int?
+    private var reservation: GLLVertexArray.Reservation?
+    // Elements of the simplified versions of the mesh, right after each other in the same element buffer. They use the same vertices and base vertex as the full mesh.
+    private var detailLevelElements: Data?
+    private var detailLevelReservation: GLLVertexArray.Reservation?
+    private(set) var detailLevelRanges: [(indicesStart: Int, count: Int)] = []
     
-    init(mesh: GLLModelMesh, vertexArray array: GLLVertexArray, resourceManager: GLLResourceManager) {
+    // Meshes that start out hidden have a vertex array of their own, which only gets reserved, filled and uploaded once prepare() gets called
+    let isDeferred: Bool
+    private weak var resourceManager: GLLResourceManager?
+    private var preparation: Task<Void, Never>? = nil
+    private var preparationFinished = false
+    private let preparationLock = NSLock()
+    
+    // Call buildElementOrder(for:) for the mesh first, unless it is deferred
+    init(mesh: GLLModelMesh, vertexArray array: GLLVertexArray, resourceManager: GLLResourceManager, deferred: Bool = false) {
         modelMesh = mesh
         self.vertexArray = array
+        self.resourceManager = resourceManager
+        isDeferred = deferred
+        elementType = vertexArray.format.indexType
         
-        reservation = array.reserve(vertexCount: modelMesh.countOfVertices, elements: modelMesh.elementData, bytesPerElement: modelMesh.elementSize)
+        if !deferred {
+            reserve()
+            uploadBoneData()
+        }
+    }
+    
+    /**
+     * # Meshlets and levels of detail for the mesh, if the preferences ask for them.
+     *
+     * Meshlets cull parts of large meshes, and the simplified versions are for when the model is small on screen. Both change what goes in the element buffers, so they have to exist before the mesh reserves space in a vertex array. The levels of detail use the elements in meshlet order.
+     */
+    static func buildElementOrder(for mesh: GLLModelMesh) {
+        if UserDefaults.standard.bool(forKey: GLLPrefUseMeshletCulling) {
+            mesh.buildMeshlets()
+        }
+        if UserDefaults.standard.bool(forKey: GLLPrefUseLevelsOfDetail) {
+            mesh.generateLevelsOfDetail()
+        }
+    }
+    
+    private func reserve() {
+        let mesh = modelMesh
+        let array = vertexArray
+        let reservation = array.reserve(vertexCount: mesh.countOfVertices, elements: mesh.elementData, bytesPerElement: mesh.elementSize)
+        self.reservation = reservation
         
         indicesStart = reservation.elementBytesStart
         baseVertex = reservation.baseVertex
-        elementType = vertexArray.format.indexType
-        if vertexArray.format.hasIndices {
+        if array.format.hasIndices {
             elementsOrVerticesCount = mesh.countOfElements
         } else {
             elementsOrVerticesCount = mesh.countOfVertices
         }
         
-        if let boneIndices = mesh.variableBoneIndices, let boneWeights = mesh.variableBoneWeights {
-            let weightsSize = MemoryLayout<Float>.stride * boneWeights.count
-            let indicesSize = MemoryLayout<UInt16>.stride * boneIndices.count
-            
-            boneDataArray = resourceManager.metalDevice.makeBuffer(length: weightsSize + indicesSize, options: .storageModeShared)
-            boneDataArray!.contents().copyMemory(from: boneWeights, byteCount: weightsSize)
-            boneDataArray!.contents().advanced(by: weightsSize).copyMemory(from: boneIndices, byteCount: indicesSize)
-            boneDataArray!.label = mesh.displayName + "-bonedata"
-            boneIndexOffset = weightsSize
-        } else {
-            boneDataArray = nil
-            boneIndexOffset = nil
+        if array.format.hasIndices && !mesh.levelsOfDetail.isEmpty {
+            let elements = mesh.levelsOfDetail.flatMap { $0.indices }.withUnsafeBufferPointer { Data(buffer: $0) }
+            let levelReservation = array.reserve(vertexCount: 0, elements: elements, bytesPerElement: 4)
+            var ranges: [(indicesStart: Int, count: Int)] = []
+            var start = levelReservation.elementBytesStart
+            for level in mesh.levelsOfDetail {
+                ranges.append((start, level.indices.count))
+                start += level.indices.count * array.numberOfElementBytes
+            }
+            detailLevelElements = elements
+            detailLevelReservation = levelReservation
+            detailLevelRanges = ranges
         }
     }
     
+    private func uploadBoneData() {
+        guard let boneIndices = modelMesh.drawingVariableBoneIndices, let boneWeights = modelMesh.variableBoneWeights, let resourceManager else {
+            return
+        }
+        let weightsSize = MemoryLayout<Float>.stride * boneWeights.count
+        let indicesSize = MemoryLayout<UInt16>.stride * boneIndices.count
+        
+        boneDataArray = resourceManager.metalDevice.makeBuffer(length: weightsSize + indicesSize, options: .storageModeShared)
+        boneDataArray!.contents().copyMemory(from: boneWeights, byteCount: weightsSize)
+        boneDataArray!.contents().advanced(by: weightsSize).copyMemory(from: boneIndices, byteCount: indicesSize)
+        boneDataArray!.label = modelMesh.displayName + "-bonedata"
+        boneIndexOffset = weightsSize
+    }
+    
     func addToVertexArray() {
-        vertexArray.add(vertices: modelMesh.vertexDataAccessors!, count: modelMesh.countOfVertices, elements: modelMesh.elementData, bytesPerElement: modelMesh.elementSize, at: reservation)
+        vertexArray.add(vertices: modelMesh.drawingVertexDataAccessors, count: modelMesh.countOfVertices, elements: modelMesh.elementData, bytesPerElement: modelMesh.elementSize, quantization: modelMesh.quantization, at: reservation!)
+        if let detailLevelElements, let detailLevelReservation {
+            vertexArray.add(elements: detailLevelElements, bytesPerElement: 4, at: detailLevelReservation)
+        }
+    }
+    
+    // Where the indices for the level are and how many; 0 is the full mesh. Levels beyond the ones that exist use the least detailed one.
+    func elements(detailLevel: Int) -> (indicesStart: Int, count: Int) {
+        guard detailLevel > 0, !detailLevelRanges.isEmpty else {
+            return (indicesStart, elementsOrVerticesCount)
+        }
+        return detailLevelRanges[min(detailLevel, detailLevelRanges.count) - 1]
+    }
+    
+    // Whether the vertex data is on the GPU
+    var isPrepared: Bool {
+        return !isDeferred || preparationLock.withLock { preparationFinished }
+    }
+    
+    /**
+     * # Does the work that was skipped for a hidden mesh.
+     *
+     * That is the deferred processing of the model mesh, the meshlets and levels of detail, packing the vertices and uploading them. It happens in the background, and only once no matter how many items show the mesh; every call returns when it is done.
+     */
+    func prepare() async {
+        guard isDeferred else {
+            return
+        }
+        let task = preparationLock.withLock { () -> Task<Void, Never> in
+            if let preparation {
+                return preparation
+            }
+            let task = Task.detached(priority: .userInitiated) { [self] in
+                modelMesh.finishDeferredProcessing()
+                GLLMeshDrawData.buildElementOrder(for: modelMesh)
+                reserve()
+                addToVertexArray()
+                vertexArray.upload()
+                uploadBoneData()
+                preparationLock.withLock {
+                    preparationFinished = true
+                }
+            }
+            preparation = task
+            return task
+        }
+        await task.value
     }
     
 }
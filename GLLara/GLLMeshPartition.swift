@@ -0,0 +1,91 @@
+//
+//  GLLMeshPartition.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # Splits the triangles of a mesh into parts by boxes.
+ *
+ * A triangle belongs to every part whose box contains at least one of its corners, so parts can overlap, and some triangles may end up in no part at all. This is the rule XNALara uses for its mesh splitters.
+ *
+ * All boxes get handled in one go: Every vertex is tested against all boxes once, and then every triangle just combines the results of its corners. Each part only keeps the vertices that its triangles use, with the indices rewritten to match.
+ */
+struct GLLMeshPartition {
+    struct Part {
+        // Original index of every vertex in the part, in the order the triangles first use them
+        var vertices: [UInt32] = []
+        // Triangles, as indices into vertices
+        var indices: [UInt32] = []
+    }
+    
+    // One bit per box in the vertex masks
+    static let maximumBoxCount = 64
+    
+    let parts: [Part]
+    
+    init(positions: [SIMD3<Float>], indices: [UInt32], boxes: [GLLBoundingBox], concurrent: Bool = true) {
+        precondition(boxes.count <= GLLMeshPartition.maximumBoxCount)
+        precondition(indices.count % 3 == 0)
+        
+        // Which boxes contain each vertex
+        let vertexCount = positions.count
+        var masks = Array(repeating: UInt64(0), count: vertexCount)
+        masks.withUnsafeMutableBufferPointer { masks in
+            GLLCPUSkinner.forEachChunk(count: vertexCount, concurrent: concurrent) { _, range in
+                for vertex in range {
+                    var mask = UInt64(0)
+                    for (bit, box) in boxes.enumerated() where all(positions[vertex] .>= box.min .& positions[vertex] .<= box.max) {
+                        mask |= 1 << UInt64(bit)
+                    }
+                    masks[vertex] = mask
+                }
+            }
+        }
+        
+        // Which triangles go in each part, per chunk, so the order stays the same as in the original
+        let triangleCount = indices.count / 3
+        var chunkTriangles = Array(repeating: Array(repeating: [UInt32](), count: boxes.count), count: GLLCPUSkinner.chunkCount(triangleCount))
+        chunkTriangles.withUnsafeMutableBufferPointer { chunkTriangles in
+            GLLCPUSkinner.forEachChunk(count: triangleCount, concurrent: concurrent) { chunk, range in
+                var triangles = Array(repeating: [UInt32](), count: boxes.count)
+                for triangle in range {
+                    var mask = masks[Int(indices[triangle * 3 + 0])] | masks[Int(indices[triangle * 3 + 1])] | masks[Int(indices[triangle * 3 + 2])]
+                    while mask != 0 {
+                        triangles[mask.trailingZeroBitCount].append(UInt32(triangle))
+                        mask &= mask - 1
+                    }
+                }
+                chunkTriangles[chunk] = triangles
+            }
+        }
+        
+        // Compact every part on its own
+        var parts = Array(repeating: Part(), count: boxes.count)
+        parts.withUnsafeMutableBufferPointer { parts in
+            GLLCPUSkinner.perform(iterations: boxes.count, concurrent: concurrent) { box in
+                var part = Part()
+                var remap = Array(repeating: UInt32.max, count: vertexCount)
+                for triangles in chunkTriangles {
+                    for triangle in triangles[box] {
+                        for corner in 0 ..< 3 {
+                            let vertex = Int(indices[Int(triangle) * 3 + corner])
+                            if remap[vertex] == UInt32.max {
+                                remap[vertex] = UInt32(part.vertices.count)
+                                part.vertices.append(UInt32(vertex))
+                            }
+                            part.indices.append(remap[vertex])
+                        }
+                    }
+                }
+                parts[box] = part
+            }
+        }
+        self.parts = parts
+    }
+}
@@ -0,0 +1,569 @@
+//
+//  GLLMeshSimplifier.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # Simplified versions of a mesh, for drawing it when it is small on screen.
+ *
+ * Collapses edges in the order of the quadric error metric (Garland and Heckbert), with an extra cost for changing normals, texture coordinates and bone weights. Every collapse moves one vertex onto one of its neighbours, so the simplified meshes are just new lists of indices into the original vertices, and can share the vertex buffer with the full mesh.
+ *
+ * Vertices on an edge that is not shared by exactly two triangles never move. That is the outline of the mesh, but also every UV seam and hard edge, since the vertices on the two sides of those are different ones. The seams stay closed and the texture does not get smeared across them, at the cost of keeping more triangles along them.
+ *
+ * One run collapses all the way down and writes out the current triangles whenever it reaches the target of the next level.
+ */
+struct GLLMeshSimplifier {
+    struct Level: Equatable {
+        var indices: [UInt32]
+        // Largest distance between a vertex that got moved and the surface around its original position, in the units of the model
+        var error: Float
+        
+        var countOfTriangles: Int {
+            return indices.count / 3
+        }
+    }
+    
+    // Fraction of the triangles that every level keeps
+    static let targetRatios: [Float] = [0.5, 0.25, 0.125]
+    // Smaller meshes are cheap enough to always draw in full
+    static let minimumTriangles = 256
+    // A level has to get rid of at least this fraction of the triangles of the one before it, or it is not worth having
+    static let minimumReduction: Float = 0.1
+    // No collapse moves a vertex further away from its surface than this fraction of the diagonal of the mesh
+    static let maximumRelativeError: Float = 0.05
+    
+    // How much a difference in the attributes costs, as a fraction of the squared diagonal of the mesh. A normal that turns by 10° costs about as much as moving a vertex by 1% of the diagonal.
+    static let normalWeight: Double = 0.004
+    static let texCoordWeight: Double = 0.1
+    static let boneWeightWeight: Double = 0.02
+    
+    let countOfTriangles: Int
+    let levels: [Level]
+    
+    init(positions: [SIMD3<Float>], normals: [SIMD3<Float>] = [], texCoords: [[SIMD2<Float>]] = [], boneData: GLLCPUSkinner.BoneData = .none, indices: [UInt32], targetRatios: [Float] = GLLMeshSimplifier.targetRatios) {
+        precondition(normals.isEmpty || normals.count == positions.count)
+        precondition(texCoords.allSatisfy { $0.count == positions.count })
+        
+        countOfTriangles = indices.count / 3
+        guard countOfTriangles > 0 else {
+            levels = []
+            return
+        }
+        
+        var collapser = Collapser(positions: positions, normals: normals, texCoords: texCoords, boneData: boneData, indices: indices)
+        var levels: [Level] = []
+        var previousCount = countOfTriangles
+        for ratio in targetRatios.sorted(by: >) {
+            let target = Int((Float(countOfTriangles) * ratio).rounded(.down))
+            collapser.collapse(downTo: target)
+            let level = Level(indices: collapser.currentIndices, error: collapser.error)
+            guard Float(level.countOfTriangles) <= Float(previousCount) * (1 - GLLMeshSimplifier.minimumReduction) else {
+                // Nothing left that can be collapsed; the next levels would be the same
+                break
+            }
+            levels.append(level)
+            previousCount = level.countOfTriangles
+        }
+        self.levels = levels
+    }
+    
+    // MARK: - Quadrics
+    
+    // Sum of squared distances to planes, weighted by the area of the triangle the plane came from. Symmetric matrix, vector and constant of pᵀAp + 2bᵀp + c.
+    private struct Quadric {
+        var a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0
+        var b = SIMD3<Double>(repeating: 0)
+        var c = 0.0
+        var area = 0.0
+        
+        init() {
+        }
+        
+        init(normal n: SIMD3<Double>, point: SIMD3<Double>, area: Double) {
+            let d = -simd_dot(n, point)
+            a00 = n.x * n.x * area
+            a01 = n.x * n.y * area
+            a02 = n.x * n.z * area
+            a11 = n.y * n.y * area
+            a12 = n.y * n.z * area
+            a22 = n.z * n.z * area
+            b = n * d * area
+            c = d * d * area
+            self.area = area
+        }
+        
+        static func +(lhs: Quadric, rhs: Quadric) -> Quadric {
+            var result = lhs
+            result.a00 += rhs.a00
+            result.a01 += rhs.a01
+            result.a02 += rhs.a02
+            result.a11 += rhs.a11
+            result.a12 += rhs.a12
+            result.a22 += rhs.a22
+            result.b += rhs.b
+            result.c += rhs.c
+            result.area += rhs.area
+            return result
+        }
+        
+        func error(_ p: SIMD3<Double>) -> Double {
+            let quadratic = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z + 2 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+            return Swift.max(quadratic + 2 * simd_dot(b, p) + c, 0)
+        }
+    }
+    
+    // MARK: - Collapsing
+    
+    private struct Candidate: Comparable {
+        var cost: Double
+        var vertex: Int32
+        var version: UInt32
+        
+        static func <(lhs: Candidate, rhs: Candidate) -> Bool {
+            return lhs.cost < rhs.cost
+        }
+    }
+    
+    // Binary min heap. Entries do not get removed when they become outdated; they have an old version number instead and get skipped.
+    private struct Heap {
+        private var entries: [Candidate] = []
+        
+        var isEmpty: Bool {
+            return entries.isEmpty
+        }
+        
+        mutating func push(_ candidate: Candidate) {
+            entries.append(candidate)
+            var child = entries.count - 1
+            while child > 0 {
+                let parent = (child - 1) / 2
+                if entries[child] >= entries[parent] {
+                    break
+                }
+                entries.swapAt(child, parent)
+                child = parent
+            }
+        }
+        
+        mutating func pop() -> Candidate? {
+            guard let first = entries.first else {
+                return nil
+            }
+            let last = entries.removeLast()
+            if !entries.isEmpty {
+                entries[0] = last
+                var parent = 0
+                while true {
+                    let left = parent * 2 + 1
+                    let right = left + 1
+                    var smallest = parent
+                    if left < entries.count && entries[left] < entries[smallest] {
+                        smallest = left
+                    }
+                    if right < entries.count && entries[right] < entries[smallest] {
+                        smallest = right
+                    }
+                    if smallest == parent {
+                        break
+                    }
+                    entries.swapAt(parent, smallest)
+                    parent = smallest
+                }
+            }
+            return first
+        }
+    }
+    
+    private struct Collapser {
+        let positions: [SIMD3<Double>]
+        let normals: [SIMD3<Float>]
+        let texCoords: [[SIMD2<Float>]]
+        // Bones and weights of every vertex, without the ones with weight 0; the bones of vertex i are boneOffsets[i] ..< boneOffsets[i + 1]
+        var boneOffsets: [Int] = []
+        var boneIndices: [UInt16] = []
+        var boneWeights: [Float] = []
+        let squaredDiagonal: Double
+        let maximumError: Double
+        
+        var triangles: [SIMD3<UInt32>]
+        var isRemoved: [Bool]
+        var countOfLiveTriangles: Int
+        var vertexTriangles: [[Int32]]
+        var quadrics: [Quadric]
+        var isLocked: [Bool]
+        var versions: [UInt32]
+        var heap = Heap()
+        // Largest geometric error of any collapse so far
+        var error: Float = 0
+        
+        init(positions floatPositions: [SIMD3<Float>], normals: [SIMD3<Float>], texCoords: [[SIMD2<Float>]], boneData: GLLCPUSkinner.BoneData, indices: [UInt32]) {
+            let vertexCount = floatPositions.count
+            positions = floatPositions.map { SIMD3<Double>($0) }
+            self.normals = normals
+            self.texCoords = texCoords
+            let bounds = GLLBoundingBox(points: floatPositions)
+            squaredDiagonal = bounds.isEmpty ? 0 : Double(simd_distance_squared(bounds.min, bounds.max))
+            maximumError = Double(GLLMeshSimplifier.maximumRelativeError) * squaredDiagonal.squareRoot()
+            
+            triangles = stride(from: 0, to: indices.count - 2, by: 3).map { SIMD3<UInt32>(indices[$0], indices[$0 + 1], indices[$0 + 2]) }
+            isRemoved = triangles.map { $0.x == $0.y || $0.y == $0.z || $0.z == $0.x }
+            countOfLiveTriangles = isRemoved.lazy.filter { !$0 }.count
+            vertexTriangles = Array(repeating: [], count: vertexCount)
+            quadrics = Array(repeating: Quadric(), count: vertexCount)
+            isLocked = Array(repeating: false, count: vertexCount)
+            versions = Array(repeating: 0, count: vertexCount)
+            
+            // Edges that do not have exactly two triangles; their vertices stay where they are
+            var edgeTriangles: [UInt64: Int32] = [:]
+            edgeTriangles.reserveCapacity(triangles.count * 3 / 2)
+            for (index, triangle) in triangles.enumerated() where !isRemoved[index] {
+                let p0 = positions[Int(triangle.x)], p1 = positions[Int(triangle.y)], p2 = positions[Int(triangle.z)]
+                let cross = simd_cross(p1 - p0, p2 - p0)
+                let length = simd_length(cross)
+                if length > 0 {
+                    let quadric = Quadric(normal: cross / length, point: p0, area: length * 0.5)
+                    for corner in 0 ..< 3 {
+                        quadrics[Int(triangle[corner])] = quadrics[Int(triangle[corner])] + quadric
+                    }
+                }
+                for corner in 0 ..< 3 {
+                    vertexTriangles[Int(triangle[corner])].append(Int32(index))
+                    let a = triangle[corner], b = triangle[(corner + 1) % 3]
+                    edgeTriangles[UInt64(Swift.min(a, b)) << 32 | UInt64(Swift.max(a, b)), default: 0] += 1
+                }
+            }
+            for (edge, count) in edgeTriangles where count != 2 {
+                isLocked[Int(edge >> 32)] = true
+                isLocked[Int(edge & 0xFFFFFFFF)] = true
+            }
+            // Vertices in the same place as another one are on a seam, even if the seam is not an edge (for example a single vertex where two UV islands touch)
+            var firstAtPosition: [SIMD3<Float>: Int] = [:]
+            for (vertex, position) in floatPositions.enumerated() where !vertexTriangles[vertex].isEmpty {
+                if let other = firstAtPosition[position] {
+                    isLocked[vertex] = true
+                    isLocked[other] = true
+                } else {
+                    firstAtPosition[position] = vertex
+                }
+            }
+            
+            switch boneData {
+            case .none:
+                break
+            case .fixed(indices: let indices, weights: let weights):
+                boneOffsets.reserveCapacity(vertexCount + 1)
+                for vertex in 0 ..< vertexCount {
+                    boneOffsets.append(boneIndices.count)
+                    for i in 0 ..< 4 where weights[vertex][i] > 0 {
+                        boneIndices.append(indices[vertex][i])
+                        boneWeights.append(weights[vertex][i])
+                    }
+                }
+                boneOffsets.append(boneIndices.count)
+            case .variable(offsetLength: let offsetLength, indices: let indices, weights: let weights):
+                boneOffsets.reserveCapacity(vertexCount + 1)
+                for vertex in 0 ..< vertexCount {
+                    boneOffsets.append(boneIndices.count)
+                    let start = Int(offsetLength[vertex].x)
+                    for i in start ..< start + Int(offsetLength[vertex].y) where weights[i] > 0 {
+                        boneIndices.append(indices[i])
+                        boneWeights.append(weights[i])
+                    }
+                }
+                boneOffsets.append(boneIndices.count)
+            }
+            
+            for vertex in 0 ..< vertexCount {
+                pushBestCollapse(of: vertex)
+            }
+        }
+        
+        var currentIndices: [UInt32] {
+            var result: [UInt32] = []
+            result.reserveCapacity(countOfLiveTriangles * 3)
+            for (index, triangle) in triangles.enumerated() where !isRemoved[index] {
+                result.append(contentsOf: [triangle.x, triangle.y, triangle.z])
+            }
+            return result
+        }
+        
+        // Weighted squared difference of everything but the position, scaled like a squared distance
+        func attributeCost(from u: Int, to v: Int) -> Double {
+            var result = 0.0
+            if !normals.isEmpty {
+                result += GLLMeshSimplifier.normalWeight * Double(simd_distance_squared(normals[u], normals[v]))
+            }
+            for layer in texCoords {
+                result += GLLMeshSimplifier.texCoordWeight * Double(simd_distance_squared(layer[u], layer[v]))
+            }
+            if !boneOffsets.isEmpty {
+                result += GLLMeshSimplifier.boneWeightWeight * boneWeightDifference(u, v)
+            }
+            return result * squaredDiagonal
+        }
+        
+        func boneWeightDifference(_ u: Int, _ v: Int) -> Double {
+            let rangeU = boneOffsets[u] ..< boneOffsets[u + 1]
+            let rangeV = boneOffsets[v] ..< boneOffsets[v + 1]
+            return Double(GLLMeshSimplifier.boneWeightDifference(indices: boneIndices[rangeU], weights: boneWeights[rangeU], otherIndices: boneIndices[rangeV], otherWeights: boneWeights[rangeV]))
+        }
+        
+        // Geometric part of the cost, and the total cost
+        func cost(from u: Int, to v: Int) -> (geometric: Double, total: Double) {
+            let quadric = quadrics[u] + quadrics[v]
+            let geometric = quadric.error(positions[v])
+            return (geometric, geometric + quadrics[u].area * attributeCost(from: u, to: v))
+        }
+        
+        func neighbours(of vertex: Int) -> [Int] {
+            var result: [Int] = []
+            for triangle in vertexTriangles[vertex] {
+                for corner in 0 ..< 3 {
+                    let other = Int(triangles[Int(triangle)][corner])
+                    if other != vertex && !result.contains(other) {
+                        result.append(other)
+                    }
+                }
+            }
+            return result
+        }
+        
+        mutating func pushBestCollapse(of u: Int) {
+            versions[u] &+= 1
+            guard !isLocked[u] && !vertexTriangles[u].isEmpty else {
+                return
+            }
+            var best = Double.infinity
+            for v in neighbours(of: u) {
+                best = Swift.min(best, cost(from: u, to: v).total)
+            }
+            if best.isFinite {
+                heap.push(Candidate(cost: best, vertex: Int32(u), version: versions[u]))
+            }
+        }
+        
+        // Whether moving u onto v keeps the mesh manifold and does not turn any triangle around
+        func isValid(from u: Int, to v: Int) -> Bool {
+            // The only neighbours they have in common must be the third corners of the triangles on the edge between them; otherwise the collapse would join two parts of the surface
+            let neighboursOfV = neighbours(of: v)
+            var shared = 0
+            for other in neighbours(of: u) where neighboursOfV.contains(other) {
+                shared += 1
+            }
+            let edgeTriangles = vertexTriangles[u].filter { any(triangles[Int($0)] .== UInt32(v)) }.count
+            if shared != edgeTriangles {
+                return false
+            }
+            
+            for triangle in vertexTriangles[u] {
+                var corners = triangles[Int(triangle)]
+                if any(corners .== UInt32(v)) {
+                    continue
+                }
+                let before = simd_cross(positions[Int(corners.y)] - positions[Int(corners.x)], positions[Int(corners.z)] - positions[Int(corners.x)])
+                corners.replace(with: UInt32(v), where: corners .== UInt32(u))
+                let after = simd_cross(positions[Int(corners.y)] - positions[Int(corners.x)], positions[Int(corners.z)] - positions[Int(corners.x)])
+                if simd_dot(before, after) <= 0 {
+                    return false
+                }
+            }
+            return true
+        }
+        
+        mutating func collapse(downTo target: Int) {
+            while countOfLiveTriangles > target, let candidate = heap.pop() {
+                let u = Int(candidate.vertex)
+                guard candidate.version == versions[u] else {
+                    continue
+                }
+                
+                // Find the cheapest neighbour that still works
+                var best: (v: Int, geometric: Double, total: Double)? = nil
+                for v in neighbours(of: u) {
+                    let costs = cost(from: u, to: v)
+                    if costs.total < best?.total ?? .infinity && isValid(from: u, to: v) {
+                        best = (v, costs.geometric, costs.total)
+                    }
+                }
+                guard let best else {
+                    // Stays until a neighbour changes
+                    continue
+                }
+                if best.total > candidate.cost {
+                    // The cheapest one was not valid; try again in the right order
+                    heap.push(Candidate(cost: best.total, vertex: Int32(u), version: versions[u]))
+                    continue
+                }
+                let distance = (best.geometric / Swift.max(quadrics[u].area + quadrics[best.v].area, .leastNormalMagnitude)).squareRoot()
+                if distance > maximumError {
+                    continue
+                }
+                
+                perform(from: u, to: best.v)
+                error = Swift.max(error, Float(distance))
+            }
+        }
+        
+        mutating func perform(from u: Int, to v: Int) {
+            for triangle in vertexTriangles[u] {
+                if any(triangles[Int(triangle)] .== UInt32(v)) {
+                    isRemoved[Int(triangle)] = true
+                    countOfLiveTriangles -= 1
+                    for corner in 0 ..< 3 {
+                        let other = Int(triangles[Int(triangle)][corner])
+                        if other != u {
+                            vertexTriangles[other].removeAll { $0 == triangle }
+                        }
+                    }
+                } else {
+                    triangles[Int(triangle)].replace(with: UInt32(v), where: triangles[Int(triangle)] .== UInt32(u))
+                    vertexTriangles[v].append(triangle)
+                }
+            }
+            vertexTriangles[u] = []
+            quadrics[v] = quadrics[v] + quadrics[u]
+            versions[u] &+= 1
+            
+            pushBestCollapse(of: v)
+            for neighbour in neighbours(of: v) {
+                pushBestCollapse(of: neighbour)
+            }
+        }
+    }
+    
+    // Sum of the squared differences in the weight of every bone that either list uses. Weights have the same indices as their bones. A bone can appear more than once in a list; then its weights add up.
+    static func boneWeightDifference(indices: ArraySlice<UInt16>, weights: ArraySlice<Float>, otherIndices: ArraySlice<UInt16>, otherWeights: ArraySlice<Float>) -> Float {
+        func weight(of bone: UInt16, indices: ArraySlice<UInt16>, weights: ArraySlice<Float>) -> Float {
+            var result: Float = 0
+            for i in indices.indices where indices[i] == bone {
+                result += weights[i]
+            }
+            return result
+        }
+        var result: Float = 0
+        for i in indices.indices where !indices[..<i].contains(indices[i]) {
+            let difference = weight(of: indices[i], indices: indices, weights: weights) - weight(of: indices[i], indices: otherIndices, weights: otherWeights)
+            result += difference * difference
+        }
+        for i in otherIndices.indices where !otherIndices[..<i].contains(otherIndices[i]) && !indices.contains(otherIndices[i]) {
+            let otherWeight = weight(of: otherIndices[i], indices: otherIndices, weights: otherWeights)
+            result += otherWeight * otherWeight
+        }
+        return result
+    }
+    
+    // MARK: - Choosing a level
+    
+    // Fraction of the view below which the levels get used, one per level. Compared with the larger of width and height of the item on screen.
+    static let screenSizeThresholds: [Float] = [0.25, 0.125, 0.0625]
+    
+    // 0 is the full mesh, 1 the first simplified level and so on
+    static func detailLevel(screenSize: Float, countOfLevels: Int) -> Int {
+        var level = 0
+        while level < Swift.min(countOfLevels, screenSizeThresholds.count) && screenSize < screenSizeThresholds[level] {
+            level += 1
+        }
+        return level
+    }
+    
+    // MARK: - Cache
+    
+    // Change when the simplification changes, so old results do not get used anymore
+    static let cacheVersion: UInt32 = 1
+    
+    // FNV-1a over all the input, as hex. Not Hasher, since that is different on every launch.
+    static func cacheKey(positions: [SIMD3<Float>], normals: [SIMD3<Float>], texCoords: [[SIMD2<Float>]], boneData: GLLCPUSkinner.BoneData, indices: [UInt32]) -> String {
+        var hash: UInt64 = 0xcbf29ce484222325
+        func add<T>(_ array: [T]) {
+            array.withUnsafeBytes { bytes in
+                for byte in bytes {
+                    hash = (hash ^ UInt64(byte)) &* 0x100000001b3
+                }
+            }
+        }
+        add([cacheVersion, UInt32(positions.count), UInt32(indices.count)])
+        add(positions)
+        add(normals)
+        for layer in texCoords {
+            add(layer)
+        }
+        switch boneData {
+        case .none:
+            break
+        case .fixed(indices: let boneIndices, weights: let weights):
+            add(boneIndices)
+            add(weights)
+        case .variable(offsetLength: let offsetLength, indices: let boneIndices, weights: let weights):
+            add(offsetLength)
+            add(boneIndices)
+            add(weights)
+        }
+        add(indices)
+        return String(format: "%016llx", hash)
+    }
+    
+    // Number of levels, then for each the number of indices, the error and the indices
+    static func encode(levels: [Level]) -> Data {
+        var result = Data()
+        func append<T>(_ value: T) {
+            Swift.withUnsafeBytes(of: value) { result.append(contentsOf: $0) }
+        }
+        append(cacheVersion)
+        append(UInt32(levels.count))
+        for level in levels {
+            append(UInt32(level.indices.count))
+            append(level.error)
+            level.indices.withUnsafeBytes { result.append(contentsOf: $0) }
+        }
+        return result
+    }
+    
+    // Nil if the data is damaged or does not fit the vertices
+    static func decode(_ data: Data, countOfVertices: Int) -> [Level]? {
+        return data.withUnsafeBytes { bytes -> [Level]? in
+            var offset = 0
+            func read<T>(_ type: T.Type) -> T? {
+                guard offset + MemoryLayout<T>.size <= bytes.count else {
+                    return nil
+                }
+                let result = bytes.loadUnaligned(fromByteOffset: offset, as: T.self)
+                offset += MemoryLayout<T>.size
+                return result
+            }
+            guard read(UInt32.self) == cacheVersion, let count = read(UInt32.self) else {
+                return nil
+            }
+            var levels: [Level] = []
+            for _ in 0 ..< count {
+                guard let indexCount = read(UInt32.self), let error = read(Float.self), offset + Int(indexCount) * 4 <= bytes.count else {
+                    return nil
+                }
+                let indices = (0 ..< Int(indexCount)).map { bytes.loadUnaligned(fromByteOffset: offset + $0 * 4, as: UInt32.self) }
+                offset += Int(indexCount) * 4
+                guard indices.allSatisfy({ Int($0) < countOfVertices }) else {
+                    return nil
+                }
+                levels.append(Level(indices: indices, error: error))
+            }
+            return offset == bytes.count ? levels : nil
+        }
+    }
+    
+    // MARK: - Report
+    
+    // One line per mesh with the triangles and error of every level, for the log
+    static func report(meshNames: [String], countsOfTriangles: [Int], levels: [[Level]]) -> String {
+        var result = ""
+        for (name, (count, meshLevels)) in zip(meshNames, zip(countsOfTriangles, levels)) where !meshLevels.isEmpty {
+            let levelDescriptions = meshLevels.map { String(format: "%d (error %g)", $0.countOfTriangles, $0.error) }
+            result += "\(name): \(count) triangles → " + levelDescriptions.joined(separator: ", ") + "\n"
+        }
+        return result
+    }
+}
@@ -0,0 +1,453 @@
+//
+//  GLLMeshlets.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # A mesh split into small clusters of triangles that can be culled on their own.
+ *
+ * Very large meshes are usually only partly in view, or partly facing away from the camera, but frustum culling can only skip them as a whole. The meshlets are small enough that they often are completely outside the frustum or completely facing away.
+ *
+ * The builder reorders the triangles so that every meshlet is one contiguous range of them. Culling then turns the visible meshlets into a few ranges in the element buffer of the mesh, which get drawn as they are; there is no separate index buffer.
+ *
+ * Each meshlet has a bounding sphere and a normal cone. For skinned meshes, the sphere and cone can only be used for meshlets that move with a single bone; the others use the per-bone boxes from GLLMeshBounds and can't be culled for facing away.
+ */
+struct GLLMeshlets {
+    struct Meshlet {
+        // In the reordered triangles; elements are three times that
+        var triangleStart: Int
+        var triangleCount: Int
+        var vertexCount: Int
+        
+        var center: SIMD3<Float>
+        var radius: Float
+        
+        // All triangles face away from any point from which the apex is seen in a direction within acos(coneCutoff) of the axis. Only set if the normals are less than 90° apart.
+        var cone: Cone?
+        // The bone that moves all vertices of the meshlet, if there is one
+        var rigidBone: Int?
+        
+        var elements: Range<Int> {
+            return triangleStart * 3 ..< (triangleStart + triangleCount) * 3
+        }
+    }
+    
+    struct Cone {
+        var apex: SIMD3<Float>
+        var axis: SIMD3<Float>
+        var cutoff: Float
+        
+        func isBackfacing(from camera: SIMD3<Float>) -> Bool {
+            let direction = apex - camera
+            let length = simd_length(direction)
+            return length > 0 && simd_dot(direction, axis) >= cutoff * length
+        }
+    }
+    
+    static let maximumVertices = 64
+    static let maximumTriangles = 124
+    // Below that, culling the whole mesh is good enough
+    static let minimumTriangles = 4096
+    // At most that many draw calls per mesh; the smallest gaps between visible ranges get drawn as well to get there
+    static let maximumRanges = 16
+    // Normals that are more than that far apart can't form a useful cone
+    static let minimumConeDot: Float = 0.1
+    
+    let meshlets: [Meshlet]
+    // The triangles of the mesh, in the order of the meshlets
+    let indices: [UInt32]
+    // Per meshlet, for meshlets that do not move with a single bone
+    let bounds: [GLLMeshBounds?]
+    
+    var countOfTriangles: Int {
+        return indices.count / 3
+    }
+    
+    /**
+     * # Splits the triangles into meshlets.
+     *
+     * A meshlet starts with the first unused triangle next to the previous meshlet, or the first unused one overall. Then it keeps adding the unused triangle next to it that needs the fewest new vertices, until the next one would go over one of the limits or there are no more neighbours.
+     */
+    init(positions: [SIMD3<Float>], boneData: GLLCPUSkinner.BoneData = .none, indices originalIndices: [UInt32]) {
+        let triangleCount = originalIndices.count / 3
+        let vertexCount = positions.count
+        
+        // Triangles of every vertex; the ones of vertex v are vertexTriangles[vertexTriangleStarts[v] ..< vertexTriangleStarts[v + 1]]
+        var vertexTriangleStarts = Array(repeating: 0, count: vertexCount + 1)
+        for index in originalIndices.prefix(triangleCount * 3) {
+            vertexTriangleStarts[Int(index) + 1] += 1
+        }
+        for vertex in 0 ..< vertexCount {
+            vertexTriangleStarts[vertex + 1] += vertexTriangleStarts[vertex]
+        }
+        var vertexTriangles = Array(repeating: Int32(0), count: triangleCount * 3)
+        var fill = vertexTriangleStarts
+        for (element, index) in originalIndices.prefix(triangleCount * 3).enumerated() {
+            vertexTriangles[fill[Int(index)]] = Int32(element / 3)
+            fill[Int(index)] += 1
+        }
+        
+        var isUsed = Array(repeating: false, count: triangleCount)
+        // Number of the meshlet that last used the vertex, so it does not need to be reset
+        var vertexMeshlet = Array(repeating: -1, count: vertexCount)
+        var isCandidate = Array(repeating: -1, count: triangleCount)
+        var nextUnused = 0
+        
+        var meshlets: [Meshlet] = []
+        var orderedTriangles: [Int] = []
+        orderedTriangles.reserveCapacity(triangleCount)
+        var meshletVertices: [Int] = []
+        var candidates: [Int] = []
+        var previousCandidates: [Int] = []
+        var bounds: [GLLMeshBounds?] = []
+        
+        func corners(_ triangle: Int) -> SIMD3<Int> {
+            return SIMD3<Int>(Int(originalIndices[triangle * 3]), Int(originalIndices[triangle * 3 + 1]), Int(originalIndices[triangle * 3 + 2]))
+        }
+        
+        while orderedTriangles.count < triangleCount {
+            let number = meshlets.count
+            let start = orderedTriangles.count
+            meshletVertices.removeAll(keepingCapacity: true)
+            candidates.removeAll(keepingCapacity: true)
+            
+            func newVertices(_ triangle: Int) -> Int {
+                let c = corners(triangle)
+                var result = 0
+                for i in 0 ..< 3 where vertexMeshlet[c[i]] != number && (i == 0 || c[i] != c[0]) && (i < 2 || c[i] != c[1]) {
+                    result += 1
+                }
+                return result
+            }
+            
+            func add(_ triangle: Int) {
+                isUsed[triangle] = true
+                orderedTriangles.append(triangle)
+                let c = corners(triangle)
+                for i in 0 ..< 3 where vertexMeshlet[c[i]] != number {
+                    vertexMeshlet[c[i]] = number
+                    meshletVertices.append(c[i])
+                    for neighbour in vertexTriangles[vertexTriangleStarts[c[i]] ..< vertexTriangleStarts[c[i] + 1]] where !isUsed[Int(neighbour)] && isCandidate[Int(neighbour)] != number {
+                        isCandidate[Int(neighbour)] = number
+                        candidates.append(Int(neighbour))
+                    }
+                }
+            }
+            
+            // Start next to the previous meshlet, so that meshlets next to each other on screen are also next to each other in the elements
+            var seed = previousCandidates.first { !isUsed[$0] }
+            if seed == nil {
+                while isUsed[nextUnused] {
+                    nextUnused += 1
+                }
+                seed = nextUnused
+            }
+            add(seed!)
+            
+            while orderedTriangles.count - start < GLLMeshlets.maximumTriangles {
+                var best: Int? = nil
+                var bestNew = Int.max
+                var index = 0
+                while index < candidates.count {
+                    let candidate = candidates[index]
+                    if isUsed[candidate] {
+                        candidates.swapAt(index, candidates.count - 1)
+                        candidates.removeLast()
+                        continue
+                    }
+                    let new = newVertices(candidate)
+                    if new < bestNew && meshletVertices.count + new <= GLLMeshlets.maximumVertices {
+                        best = candidate
+                        bestNew = new
+                        if new == 0 {
+                            break
+                        }
+                    }
+                    index += 1
+                }
+                guard let best else {
+                    break
+                }
+                add(best)
+            }
+            
+            let triangles = orderedTriangles[start...]
+            let meshlet = GLLMeshlets.describe(triangles: triangles, vertices: meshletVertices, start: start, positions: positions, boneData: boneData, corners: corners)
+            meshlets.append(meshlet)
+            bounds.append(meshlet.rigidBone == nil ? GLLMeshBounds(positions: positions, boneData: boneData, vertices: meshletVertices) : nil)
+            swap(&candidates, &previousCandidates)
+        }
+        
+        self.meshlets = meshlets
+        self.bounds = bounds
+        var indices: [UInt32] = []
+        indices.reserveCapacity(triangleCount * 3)
+        for triangle in orderedTriangles {
+            indices.append(contentsOf: originalIndices[triangle * 3 ..< triangle * 3 + 3])
+        }
+        self.indices = indices
+    }
+    
+    // Bounds, cone and bone of one meshlet
+    private static func describe(triangles: ArraySlice<Int>, vertices: [Int], start: Int, positions: [SIMD3<Float>], boneData: GLLCPUSkinner.BoneData, corners: (Int) -> SIMD3<Int>) -> Meshlet {
+        let box = GLLBoundingBox(points: vertices.lazy.map { positions[$0] })
+        let center = box.center
+        let radius = vertices.reduce(Float(0)) { max($0, simd_distance(positions[$1], center)) }
+        
+        var normals: [(normal: SIMD3<Float>, point: SIMD3<Float>)] = []
+        var axis = SIMD3<Float>(repeating: 0)
+        for triangle in triangles {
+            let c = corners(triangle)
+            let cross = simd_cross(positions[c.y] - positions[c.x], positions[c.z] - positions[c.x])
+            let length = simd_length(cross)
+            if length > 0 && length.isFinite {
+                normals.append((cross / length, positions[c.x]))
+                axis += cross / length
+            }
+        }
+        
+        var cone: Cone? = nil
+        let axisLength = simd_length(axis)
+        if axisLength > 0 && !normals.isEmpty {
+            axis /= axisLength
+            let minimumDot = normals.reduce(Float(1)) { min($0, simd_dot($1.normal, axis)) }
+            if minimumDot >= minimumConeDot {
+                // Move the apex back along the axis until it is behind the planes of all triangles
+                var distance: Float = 0
+                for (normal, point) in normals {
+                    distance = max(distance, simd_dot(center - point, normal) / simd_dot(axis, normal))
+                }
+                cone = Cone(apex: center - axis * distance, axis: axis, cutoff: (1 - minimumDot * minimumDot).squareRoot())
+            }
+        }
+        
+        return Meshlet(triangleStart: start, triangleCount: triangles.count, vertexCount: vertices.count, center: center, radius: radius, cone: cone, rigidBone: rigidBone(vertices: vertices, boneData: boneData))
+    }
+    
+    // The bone with all the weight for every vertex, if there is one. Without bone data, everything moves with the first bone, like in the shader.
+    private static func rigidBone(vertices: [Int], boneData: GLLCPUSkinner.BoneData) -> Int? {
+        var result: Int? = nil
+        func check(bone: Int, weight: Float) -> Bool {
+            guard abs(weight - 1) < 1e-3 && (result == nil || result == bone) else {
+                return false
+            }
+            result = bone
+            return true
+        }
+        switch boneData {
+        case .none:
+            return 0
+        case .fixed(indices: let indices, weights: let weights):
+            for vertex in vertices {
+                var bone: Int? = nil
+                var weight: Float = 0
+                for i in 0 ..< 4 where weights[vertex][i] > 0 {
+                    if bone != nil && bone != Int(indices[vertex][i]) {
+                        return nil
+                    }
+                    bone = Int(indices[vertex][i])
+                    weight += weights[vertex][i]
+                }
+                guard let bone, check(bone: bone, weight: weight) else {
+                    return nil
+                }
+            }
+        case .variable(offsetLength: let offsetLength, indices: let indices, weights: let weights):
+            for vertex in vertices {
+                var bone: Int? = nil
+                var weight: Float = 0
+                let start = Int(offsetLength[vertex].x)
+                for i in start ..< start + Int(offsetLength[vertex].y) where weights[i] > 0 {
+                    if bone != nil && bone != Int(indices[i]) {
+                        return nil
+                    }
+                    bone = Int(indices[i])
+                    weight += weights[i]
+                }
+                guard let bone, check(bone: bone, weight: weight) else {
+                    return nil
+                }
+            }
+        }
+        return result
+    }
+    
+    // MARK: - Statistics
+    
+    struct Statistics: CustomStringConvertible {
+        var meshlets = 0
+        var triangles = 0
+        // Sum over all meshlets; vertices on the border between meshlets count more than once
+        var vertices = 0
+        var withCone = 0
+        var rigid = 0
+        
+        var averageTriangles: Float {
+            return meshlets > 0 ? Float(triangles) / Float(meshlets) : 0
+        }
+        
+        var averageVertices: Float {
+            return meshlets > 0 ? Float(vertices) / Float(meshlets) : 0
+        }
+        
+        var description: String {
+            return String(format: "%d meshlets with on average %.1f triangles and %.1f vertices, %d with a normal cone, %d on a single bone", meshlets, averageTriangles, averageVertices, withCone, rigid)
+        }
+    }
+    
+    var statistics: Statistics {
+        var result = Statistics()
+        result.meshlets = meshlets.count
+        for meshlet in meshlets {
+            result.triangles += meshlet.triangleCount
+            result.vertices += meshlet.vertexCount
+            result.withCone += meshlet.cone == nil ? 0 : 1
+            result.rigid += meshlet.rigidBone == nil ? 0 : 1
+        }
+        return result
+    }
+    
+    // MARK: - Culling
+    
+    // Where the meshlets are in one pose
+    struct Pose {
+        // Centers and radius in world space, for the meshlets that move with a single bone
+        var spheres: [SIMD4<Float>?]
+        var cones: [Cone?]
+        // For all others; nil if nothing is known and they have to be drawn
+        var boxes: [GLLBoundingBox?]
+    }
+    
+    // The transforms are indexed by bone index. Spheres and boxes get larger by morphDistance, as far as morph targets can move the vertices before skinning.
+    func pose(boneTransforms: UnsafeBufferPointer<matrix_float4x4>, morphDistance: Float = 0) -> Pose {
+        var result = Pose(spheres: Array(repeating: nil, count: meshlets.count), cones: Array(repeating: nil, count: meshlets.count), boxes: Array(repeating: nil, count: meshlets.count))
+        for (index, meshlet) in meshlets.enumerated() {
+            guard let bone = meshlet.rigidBone else {
+                result.boxes[index] = bounds[index]?.skinned(boneTransforms: boneTransforms, morphDistance: morphDistance)
+                continue
+            }
+            guard bone < boneTransforms.count else {
+                continue
+            }
+            let transform = boneTransforms[bone]
+            let x = SIMD3<Float>(transform.columns.0.x, transform.columns.0.y, transform.columns.0.z)
+            let y = SIMD3<Float>(transform.columns.1.x, transform.columns.1.y, transform.columns.1.z)
+            let z = SIMD3<Float>(transform.columns.2.x, transform.columns.2.y, transform.columns.2.z)
+            let scales = SIMD3<Float>(simd_length(x), simd_length(y), simd_length(z))
+            let center = transform * SIMD4<Float>(meshlet.center, 1)
+            result.spheres[index] = SIMD4<Float>(center.x, center.y, center.z, (meshlet.radius + morphDistance) * scales.max())
+            
+            // Cones only survive rotations, translations and uniform scales
+            guard let cone = meshlet.cone, scales.max() - scales.min() < 1e-3 * scales.max(), simd_dot(simd_cross(x, y), z) > 0 else {
+                continue
+            }
+            let apex = transform * SIMD4<Float>(cone.apex, 1)
+            let axis = transform * SIMD4<Float>(cone.axis, 0)
+            result.cones[index] = Cone(apex: SIMD3<Float>(apex.x, apex.y, apex.z), axis: simd_normalize(SIMD3<Float>(axis.x, axis.y, axis.z)), cutoff: cone.cutoff)
+        }
+        return result
+    }
+    
+    struct CullingStatistics: CustomStringConvertible {
+        var meshlets = 0
+        var outsideFrustum = 0
+        var backfacing = 0
+        var triangles = 0
+        var culledTriangles = 0
+        // Draw calls after merging
+        var ranges = 0
+        
+        var culledMeshlets: Int {
+            return outsideFrustum + backfacing
+        }
+        
+        var cullRate: Float {
+            return triangles > 0 ? Float(culledTriangles) / Float(triangles) : 0
+        }
+        
+        mutating func add(_ other: CullingStatistics) {
+            meshlets += other.meshlets
+            outsideFrustum += other.outsideFrustum
+            backfacing += other.backfacing
+            triangles += other.triangles
+            culledTriangles += other.culledTriangles
+            ranges += other.ranges
+        }
+        
+        var description: String {
+            return String(format: "culled %d of %d meshlets (%d outside, %d facing away), %.1f%% of the triangles, in %d ranges", culledMeshlets, meshlets, outsideFrustum, backfacing, cullRate * 100, ranges)
+        }
+    }
+    
+    struct Culling {
+        var visible: GLLBitSet
+        // Elements to draw, sorted
+        var ranges: [Range<Int>]
+        var statistics: CullingStatistics
+    }
+    
+    /**
+     * # Tests all meshlets against the frustum and the camera position.
+     *
+     * Meshlets are only tested for facing away if the mesh culls back faces, and the camera position is known. The visible ones become element ranges, where neighbours are merged; if there are more than maximumRanges, the smallest gaps between them get filled, since drawing a few triangles too many is cheaper than another draw call.
+     */
+    func cull(pose: Pose, frustum: GLLFrustum, cullsBackFaces: Bool) -> Culling {
+        var visible = GLLBitSet(count: meshlets.count)
+        var statistics = CullingStatistics()
+        statistics.meshlets = meshlets.count
+        let camera = cullsBackFaces ? frustum.cameraPosition : nil
+        for (index, meshlet) in meshlets.enumerated() {
+            statistics.triangles += meshlet.triangleCount
+            if let sphere = pose.spheres[index], !frustum.intersects(center: SIMD3<Float>(sphere.x, sphere.y, sphere.z), radius: sphere.w) {
+                statistics.outsideFrustum += 1
+                statistics.culledTriangles += meshlet.triangleCount
+            } else if let box = pose.boxes[index], !frustum.intersects(box) {
+                statistics.outsideFrustum += 1
+                statistics.culledTriangles += meshlet.triangleCount
+            } else if let camera, let cone = pose.cones[index], cone.isBackfacing(from: camera) {
+                statistics.backfacing += 1
+                statistics.culledTriangles += meshlet.triangleCount
+            } else {
+                visible.insert(index)
+            }
+        }
+        
+        var ranges: [Range<Int>] = []
+        visible.forEachMember { index in
+            let elements = meshlets[index].elements
+            if let last = ranges.last, last.upperBound == elements.lowerBound {
+                ranges[ranges.count - 1] = last.lowerBound ..< elements.upperBound
+            } else {
+                ranges.append(elements)
+            }
+        }
+        ranges = GLLMeshlets.merge(ranges: ranges, maximumCount: GLLMeshlets.maximumRanges)
+        statistics.ranges = ranges.count
+        return Culling(visible: visible, ranges: ranges, statistics: statistics)
+    }
+    
+    // Fills the smallest gaps between sorted ranges until there are at most maximumCount
+    static func merge(ranges: [Range<Int>], maximumCount: Int) -> [Range<Int>] {
+        guard ranges.count > maximumCount, maximumCount > 0 else {
+            return ranges
+        }
+        let gaps = (1 ..< ranges.count).map { ranges[$0].lowerBound - ranges[$0 - 1].upperBound }
+        // Close every gap up to this size; with equal gaps, that may close a few more than needed
+        let largestClosed = gaps.sorted()[ranges.count - maximumCount - 1]
+        var result: [Range<Int>] = [ranges[0]]
+        for index in 1 ..< ranges.count {
+            if gaps[index - 1] <= largestClosed {
+                result[result.count - 1] = result[result.count - 1].lowerBound ..< ranges[index].upperBound
+            } else {
+                result.append(ranges[index])
+            }
+        }
+        return result
+    }
+}
@@ -0,0 +1,482 @@
+//
+//  GLLMeshoptDecoder.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # Decodes meshoptimizer's vertex and index compression.
+ *
+ * This is what EXT_meshopt_compression uses, e.g. in files made by gltfpack. Vertices are stored byte by byte: the first byte of every vertex in a block, then the second and so on, each as the zigzag coded difference to the same byte of the vertex before, packed into groups of 16 with 0, 2, 4 or 8 bits per value. Triangles are coded relative to recently used edges and vertices. Filters turn the decoded bytes into normals, rotations or floats afterwards.
+ *
+ * The extension only allows version 0 of the vertex format and versions 0 and 1 of the index formats. All functions return false if the data is invalid or too short, and nil where they return data.
+ */
+enum GLLMeshoptDecoder {
+    enum Mode: String {
+        case attributes = "ATTRIBUTES"
+        case triangles = "TRIANGLES"
+        case indices = "INDICES"
+    }
+    
+    enum Filter: String {
+        case none = "NONE"
+        case octahedral = "OCTAHEDRAL"
+        case quaternion = "QUATERNION"
+        case exponential = "EXPONENTIAL"
+    }
+    
+    // A whole buffer view of the extension, with count elements of size bytes each
+    static func decode(count: Int, size: Int, mode: Mode, filter: Filter = .none, from source: UnsafeRawBufferPointer) -> Data? {
+        guard count >= 0 && size > 0 else {
+            return nil
+        }
+        var result = Data(count: count * size)
+        let isValid = result.withUnsafeMutableBytes { destination -> Bool in
+            switch mode {
+            case .attributes:
+                return decodeVertexBuffer(destination, count: count, size: size, from: source) && applyFilter(filter, to: destination, count: count, size: size)
+            case .triangles:
+                return filter == .none && decodeIndexBuffer(destination, count: count, size: size, from: source)
+            case .indices:
+                return filter == .none && decodeIndexSequence(destination, count: count, size: size, from: source)
+            }
+        }
+        return isValid ? result : nil
+    }
+    
+    // MARK: - Vertices
+    
+    private static let byteGroupSize = 16
+    private static let vertexBlockMaxSize = 256
+    private static let tailMinimumSize = 32
+    
+    private static let twoBitShifts = SIMD16<UInt8>(6, 4, 2, 0, 6, 4, 2, 0, 6, 4, 2, 0, 6, 4, 2, 0)
+    private static let fourBitShifts = SIMD16<UInt8>(4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0, 4, 0)
+    
+    // The vertices in a block, so that one byte of all of them fits in 8 KB, in whole groups
+    static func vertexBlockSize(size: Int) -> Int {
+        return min((8192 / size) & ~(byteGroupSize - 1), vertexBlockMaxSize)
+    }
+    
+    static func decodeVertexBuffer(_ destination: UnsafeMutableRawBufferPointer, count: Int, size: Int, from source: UnsafeRawBufferPointer) -> Bool {
+        guard size > 0 && size <= 256 && size % 4 == 0, destination.count >= count * size, source.count >= 1 + size, source[0] == 0xA0 else {
+            return false
+        }
+        
+        // The tail at the end holds the values that the first vertex is relative to
+        var lastVertex = Array(source[(source.count - size)...])
+        let blockSize = vertexBlockSize(size: size)
+        let groups = UnsafeMutableRawBufferPointer.allocate(byteCount: vertexBlockMaxSize, alignment: 16)
+        defer {
+            groups.deallocate()
+        }
+        
+        var position = 1
+        var blockStart = 0
+        while blockStart < count {
+            let blockCount = min(blockSize, count - blockStart)
+            let alignedCount = (blockCount + byteGroupSize - 1) & ~(byteGroupSize - 1)
+            for byte in 0 ..< size {
+                guard let next = decodeBytes(source, at: position, into: groups, count: alignedCount) else {
+                    return false
+                }
+                position = next
+                
+                // Undo zigzag and differences for eight vertices at a time, as bytes in a 64 bit word
+                var previous = lastVertex[byte]
+                for vertex in stride(from: 0, to: blockCount, by: 8) {
+                    let deltas = unzigzag(groups.loadUnaligned(fromByteOffset: vertex, as: UInt64.self))
+                    let values = addBytes(runningSum(deltas), UInt64(previous) &* 0x0101010101010101)
+                    for i in 0 ..< min(8, blockCount - vertex) {
+                        destination[(blockStart + vertex + i) * size + byte] = UInt8(truncatingIfNeeded: values >> (i * 8))
+                    }
+                    previous = UInt8(truncatingIfNeeded: values >> 56)
+                }
+            }
+            for byte in 0 ..< size {
+                lastVertex[byte] = destination[(blockStart + blockCount - 1) * size + byte]
+            }
+            blockStart += blockCount
+        }
+        
+        // Everything has to be used, up to the tail
+        return source.count - position == max(size, tailMinimumSize)
+    }
+    
+    // One byte of all vertices in a block. Returns where the next data starts.
+    private static func decodeBytes(_ source: UnsafeRawBufferPointer, at start: Int, into groups: UnsafeMutableRawBufferPointer, count: Int) -> Int? {
+        let groupCount = count / byteGroupSize
+        let headerSize = (groupCount + 3) / 4
+        guard source.count - start >= headerSize else {
+            return nil
+        }
+        var position = start + headerSize
+        for group in 0 ..< groupCount {
+            let bits = (source[start + group / 4] >> ((group % 4) * 2)) & 3
+            guard let next = decodeGroup(source, at: position, bits: bits, into: groups, at: group * byteGroupSize) else {
+                return nil
+            }
+            position = next
+        }
+        return position
+    }
+    
+    // 16 values with 0, 2, 4 or 8 bits each. With 2 and 4 bits, the largest value means that the real value follows as a whole byte after the group.
+    private static func decodeGroup(_ source: UnsafeRawBufferPointer, at start: Int, bits: UInt8, into groups: UnsafeMutableRawBufferPointer, at offset: Int) -> Int? {
+        var values = SIMD16<UInt8>()
+        var position = start
+        switch bits {
+        case 0:
+            break
+        case 3:
+            guard source.count - start >= byteGroupSize else {
+                return nil
+            }
+            values = source.loadUnaligned(fromByteOffset: start, as: SIMD16<UInt8>.self)
+            position += byteGroupSize
+        default:
+            let bitCount = bits == 1 ? 2 : 4
+            let packedSize = bitCount * 2
+            guard source.count - start >= packedSize else {
+                return nil
+            }
+            var packed = SIMD16<UInt8>()
+            for i in 0 ..< byteGroupSize {
+                packed[i] = source[start + i * bitCount / 8]
+            }
+            let sentinel: UInt8 = bitCount == 2 ? 3 : 15
+            values = (packed &>> (bitCount == 2 ? twoBitShifts : fourBitShifts)) & sentinel
+            position += packedSize
+            
+            let isExplicit = values .== sentinel
+            if any(isExplicit) {
+                for i in 0 ..< byteGroupSize where isExplicit[i] {
+                    guard position < source.count else {
+                        return nil
+                    }
+                    values[i] = source[position]
+                    position += 1
+                }
+            }
+        }
+        groups.storeBytes(of: values, toByteOffset: offset, as: SIMD16<UInt8>.self)
+        return position
+    }
+    
+    // Zigzag coding on all eight bytes: 0, 1, 2, 3 become 0, -1, 1, -2
+    @inline(__always)
+    private static func unzigzag(_ bytes: UInt64) -> UInt64 {
+        let signs = (bytes & 0x0101010101010101) &* 0xFF
+        return signs ^ ((bytes >> 1) & 0x7F7F7F7F7F7F7F7F)
+    }
+    
+    // Adds all eight bytes separately, without carrying from one into the next
+    @inline(__always)
+    private static func addBytes(_ a: UInt64, _ b: UInt64) -> UInt64 {
+        return ((a & 0x7F7F7F7F7F7F7F7F) &+ (b & 0x7F7F7F7F7F7F7F7F)) ^ ((a ^ b) & 0x8080808080808080)
+    }
+    
+    // Every byte becomes the sum of itself and all lower bytes
+    @inline(__always)
+    private static func runningSum(_ bytes: UInt64) -> UInt64 {
+        var result = addBytes(bytes, bytes << 8)
+        result = addBytes(result, result << 16)
+        return addBytes(result, result << 32)
+    }
+    
+    // MARK: - Indices
+    
+    private static func decodeVByte(_ source: UnsafeRawBufferPointer, at position: inout Int) -> UInt32 {
+        let lead = source[position]
+        position += 1
+        if lead < 128 {
+            return UInt32(lead)
+        }
+        var result = UInt32(lead & 127)
+        var shift: UInt32 = 7
+        for _ in 0 ..< 4 {
+            let group = source[position]
+            position += 1
+            result |= UInt32(group & 127) << shift
+            shift += 7
+            if group < 128 {
+                break
+            }
+        }
+        return result
+    }
+    
+    @inline(__always)
+    private static func unzigzag(_ value: UInt32) -> UInt32 {
+        return (value >> 1) ^ (0 &- (value & 1))
+    }
+    
+    @inline(__always)
+    private static func store(_ index: UInt32, at element: Int, size: Int, into destination: UnsafeMutableRawBufferPointer) {
+        if size == 2 {
+            destination.storeBytes(of: UInt16(truncatingIfNeeded: index), toByteOffset: element * 2, as: UInt16.self)
+        } else {
+            destination.storeBytes(of: index, toByteOffset: element * 4, as: UInt32.self)
+        }
+    }
+    
+    /**
+     * # Triangles, coded with a FIFO of recent edges and one of recent vertices.
+     *
+     * Each triangle has a code byte. Below 0xF0, it names an edge from the FIFO and where the third vertex comes from; above that, all three vertices are new, from the vertex FIFO or explicit, as given by a table at the end of the data or an extra byte.
+     */
+    static func decodeIndexBuffer(_ destination: UnsafeMutableRawBufferPointer, count: Int, size: Int, from source: UnsafeRawBufferPointer) -> Bool {
+        guard count % 3 == 0, size == 2 || size == 4, destination.count >= count * size, source.count >= 1 + count / 3 + 16, source[0] & 0xF0 == 0xE0, source[0] & 0x0F <= 1 else {
+            return false
+        }
+        let maximumFifoVertex = source[0] & 0x0F >= 1 ? 13 : 15
+        
+        var edgeStarts = SIMD16<UInt32>(repeating: .max)
+        var edgeEnds = SIMD16<UInt32>(repeating: .max)
+        var vertices = SIMD16<UInt32>(repeating: .max)
+        var edgeOffset = 0
+        var vertexOffset = 0
+        var next: UInt32 = 0
+        var last: UInt32 = 0
+        
+        func pushEdge(_ a: UInt32, _ b: UInt32) {
+            edgeStarts[edgeOffset] = a
+            edgeEnds[edgeOffset] = b
+            edgeOffset = (edgeOffset + 1) & 15
+        }
+        func pushVertex(_ vertex: UInt32, advance: Bool = true) {
+            vertices[vertexOffset] = vertex
+            if advance {
+                vertexOffset = (vertexOffset + 1) & 15
+            }
+        }
+        
+        // Triangle codes at the start, then the variable length data, then the table
+        var code = 1
+        var position = 1 + count / 3
+        let dataEnd = source.count - 16
+        func explicitIndex() -> UInt32 {
+            last = last &+ unzigzag(decodeVByte(source, at: &position))
+            return last
+        }
+        
+        for triangle in stride(from: 0, to: count, by: 3) {
+            // A triangle reads at most 16 bytes, and the table is 16 bytes long
+            guard position <= dataEnd else {
+                return false
+            }
+            let triangleCode = source[code]
+            code += 1
+            
+            let a: UInt32, b: UInt32, c: UInt32
+            if triangleCode < 0xF0 {
+                // Edge from the FIFO plus one vertex
+                let edge = (edgeOffset - 1 - Int(triangleCode >> 4)) & 15
+                a = edgeStarts[edge]
+                b = edgeEnds[edge]
+                let vertexCode = Int(triangleCode & 15)
+                if vertexCode < maximumFifoVertex {
+                    c = vertexCode == 0 ? next : vertices[(vertexOffset - 1 - vertexCode) & 15]
+                    if vertexCode == 0 {
+                        next &+= 1
+                    }
+                    pushVertex(c, advance: vertexCode == 0)
+                } else {
+                    // 13 and 14 are one less and one more than the last explicit index
+                    if vertexCode == 15 {
+                        c = explicitIndex()
+                    } else {
+                        c = vertexCode == 13 ? last &- 1 : last &+ 1
+                        last = c
+                    }
+                    pushVertex(c)
+                }
+                pushEdge(c, b)
+                pushEdge(a, c)
+            } else {
+                // Vertices are new (0), from the FIFO, or, only with an extra byte, explicit (15)
+                let aux: UInt8
+                let hasExplicit = triangleCode >= 0xFE
+                if hasExplicit {
+                    aux = source[position]
+                    position += 1
+                    if aux == 0 {
+                        next = 0
+                    }
+                } else {
+                    aux = source[dataEnd + Int(triangleCode & 15)]
+                }
+                let aCode = triangleCode == 0xFF ? 15 : 0
+                let bCode = Int(aux >> 4)
+                let cCode = Int(aux & 15)
+                func vertex(code: Int) -> UInt32 {
+                    if code == 0 {
+                        next &+= 1
+                        return next &- 1
+                    }
+                    return vertices[(vertexOffset - code) & 15]
+                }
+                
+                // All new vertices get their numbers first, then the explicit ones get read
+                var newA = aCode == 0 ? vertex(code: 0) : 0
+                var newB = vertex(code: bCode)
+                var newC = vertex(code: cCode)
+                if hasExplicit {
+                    if aCode == 15 {
+                        newA = explicitIndex()
+                    }
+                    if bCode == 15 {
+                        newB = explicitIndex()
+                    }
+                    if cCode == 15 {
+                        newC = explicitIndex()
+                    }
+                }
+                a = newA
+                b = newB
+                c = newC
+                pushVertex(a)
+                pushVertex(b, advance: bCode == 0 || (hasExplicit && bCode == 15))
+                pushVertex(c, advance: cCode == 0 || (hasExplicit && cCode == 15))
+                pushEdge(b, a)
+                pushEdge(c, b)
+                pushEdge(a, c)
+            }
+            store(a, at: triangle, size: size, into: destination)
+            store(b, at: triangle + 1, size: size, into: destination)
+            store(c, at: triangle + 2, size: size, into: destination)
+        }
+        
+        return position == dataEnd
+    }
+    
+    // Any index list, each index relative to one of the last two
+    static func decodeIndexSequence(_ destination: UnsafeMutableRawBufferPointer, count: Int, size: Int, from source: UnsafeRawBufferPointer) -> Bool {
+        guard size == 2 || size == 4, destination.count >= count * size, source.count >= 1 + count + 4, source[0] & 0xF0 == 0xD0, source[0] & 0x0F <= 1 else {
+            return false
+        }
+        var position = 1
+        let dataEnd = source.count - 4
+        var last = SIMD2<UInt32>()
+        for element in 0 ..< count {
+            // An index reads at most five bytes, and there are four after the end
+            guard position < dataEnd else {
+                return false
+            }
+            let value = decodeVByte(source, at: &position)
+            let baseline = Int(value & 1)
+            let index = last[baseline] &+ unzigzag(value >> 1)
+            last[baseline] = index
+            store(index, at: element, size: size, into: destination)
+        }
+        return position == dataEnd
+    }
+    
+    // MARK: - Filters
+    
+    static func applyFilter(_ filter: Filter, to data: UnsafeMutableRawBufferPointer, count: Int, size: Int) -> Bool {
+        switch filter {
+        case .none:
+            return true
+        case .octahedral:
+            if size == 4 {
+                decodeOctahedral(data, count: count, as: Int8.self)
+            } else if size == 8 {
+                decodeOctahedral(data, count: count, as: Int16.self)
+            } else {
+                return false
+            }
+        case .quaternion:
+            guard size == 8 else {
+                return false
+            }
+            decodeQuaternions(data, count: count)
+        case .exponential:
+            guard size % 4 == 0 else {
+                return false
+            }
+            decodeExponential(data, count: count * size / 4)
+        }
+        return true
+    }
+    
+    /**
+     * # Octahedral unit vectors, four at a time.
+     *
+     * x and y are the octahedral coordinates, z is what 1 is in the same bits. The result is the normalized vector in the same type; the fourth component stays as it is.
+     */
+    private static func decodeOctahedral<T: FixedWidthInteger & SignedInteger>(_ data: UnsafeMutableRawBufferPointer, count: Int, as type: T.Type) {
+        let maximum = Float(T.max)
+        let componentSize = MemoryLayout<T>.size
+        for first in stride(from: 0, to: count, by: 4) {
+            let lanes = min(4, count - first)
+            var x = SIMD4<Float>(), y = SIMD4<Float>(), z = SIMD4<Float>()
+            for lane in 0 ..< lanes {
+                let start = (first + lane) * 4 * componentSize
+                x[lane] = Float(data.loadUnaligned(fromByteOffset: start, as: T.self))
+                y[lane] = Float(data.loadUnaligned(fromByteOffset: start + componentSize, as: T.self))
+                z[lane] = Float(data.loadUnaligned(fromByteOffset: start + 2 * componentSize, as: T.self))
+            }
+            let absoluteX = x.replacing(with: -x, where: x .< 0)
+            let absoluteY = y.replacing(with: -y, where: y .< 0)
+            z = z - absoluteX - absoluteY
+            
+            // Fold back the lower half
+            let t = pointwiseMin(z, SIMD4<Float>())
+            x += t.replacing(with: -t, where: x .< 0)
+            y += t.replacing(with: -t, where: y .< 0)
+            
+            let length = (x * x + y * y + z * z).squareRoot()
+            let scale = (maximum / length).replacing(with: 0, where: length .== 0)
+            x = (x * scale).rounded(.toNearestOrAwayFromZero)
+            y = (y * scale).rounded(.toNearestOrAwayFromZero)
+            z = (z * scale).rounded(.toNearestOrAwayFromZero)
+            for lane in 0 ..< lanes {
+                let start = (first + lane) * 4 * componentSize
+                data.storeBytes(of: T(x[lane]), toByteOffset: start, as: T.self)
+                data.storeBytes(of: T(y[lane]), toByteOffset: start + componentSize, as: T.self)
+                data.storeBytes(of: T(z[lane]), toByteOffset: start + 2 * componentSize, as: T.self)
+            }
+        }
+    }
+    
+    /**
+     * # Unit quaternions as four shorts.
+     *
+     * The largest component is left out and calculated from the others; the lowest two bits of the fourth short say which one it is, the rest is the scale of the other three.
+     */
+    private static func decodeQuaternions(_ data: UnsafeMutableRawBufferPointer, count: Int) {
+        let scale = 1 / Float(2).squareRoot()
+        for element in 0 ..< count {
+            let start = element * 8
+            let encoded = data.loadUnaligned(fromByteOffset: start, as: SIMD4<Int16>.self)
+            let componentScale = scale / Float(Int32(encoded.w) | 3)
+            let xyz = SIMD3<Float>(Float(encoded.x), Float(encoded.y), Float(encoded.z)) * componentScale
+            let w = max(1 - (xyz * xyz).sum(), 0).squareRoot()
+            let quantized = (SIMD4<Float>(xyz, w) * 32767).rounded(.toNearestOrAwayFromZero).clamped(lowerBound: SIMD4(repeating: -32767), upperBound: SIMD4(repeating: 32767))
+            
+            let largest = Int(encoded.w & 3)
+            var decoded = SIMD4<Int16>()
+            decoded[(largest + 1) & 3] = Int16(quantized.x)
+            decoded[(largest + 2) & 3] = Int16(quantized.y)
+            decoded[(largest + 3) & 3] = Int16(quantized.z)
+            decoded[largest] = Int16(quantized.w)
+            data.storeBytes(of: decoded, toByteOffset: start, as: SIMD4<Int16>.self)
+        }
+    }
+    
+    // Floats with a 24 bit mantissa and an 8 bit exponent, both signed
+    private static func decodeExponential(_ data: UnsafeMutableRawBufferPointer, count: Int) {
+        for i in 0 ..< count {
+            let value = data.loadUnaligned(fromByteOffset: i * 4, as: Int32.self)
+            let mantissa = (value << 8) >> 8
+            let exponent = value >> 24
+            let power = Float(bitPattern: UInt32(truncatingIfNeeded: exponent + 127) << 23)
+            data.storeBytes(of: power * Float(mantissa), toByteOffset: i * 4, as: Float.self)
+        }
+    }
+}
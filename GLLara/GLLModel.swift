@@ -8,9 +8,13 @@
 
 import Foundation
 import UniformTypeIdentifiers
+import os
 
 let GLLModelLoadingErrorDomain = "GLL Model loading error domain";
 
+// Statistics about how models got processed while loading. Only logged at debug level, so they don't show up unless asked for.
+let GLLModelLoadingLog = Logger(subsystem: Bundle.main.bundleIdentifier ?? "GLLara", category: "Model loading")
+
 enum GLLModelLoadingErrorCode: Int {
     case prematureEndOfFile
     case indexOutOfRange
@@ -25,7 +29,12 @@ enum GLLModelLoadingErrorCode: Int {
  * A GLLModel corresponds to one mesh file (which actually contains many meshes; this is a bit confusing) and describes its graphics contexts. It contains some default transformations, but does not store poses and the like.
  */
 @objc class GLLModel: NSObject {
-    @objc var bones: [GLLModelBone] = []
+    @objc var bones: [GLLModelBone] = [] {
+        didSet {
+            skeletonIndex = GLLSkeletonIndex(parentIndices: bones.map { $0.parentIndex }, names: bones.map { $0.name })
+        }
+    }
+    private(set) var skeletonIndex = GLLSkeletonIndex(parentIndices: [], names: [])
     @objc var meshes: [GLLModelMesh] = []
     
     static let cachedModels = NSCache<NSString, GLLModel>()
@@ -89,6 +98,6 @@ enum GLLModelLoadingErrorCode: Int {
     }
     
     @objc func bone(name: String) -> GLLModelBone? {
-        return bones.first { $0.name == name }
+        return skeletonIndex.index(named: name).map { bones[$0] }
     }
 }
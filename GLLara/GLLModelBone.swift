@@ -61,26 +61,22 @@ import Foundation
         }
     }
     
-    // Export
-    func writeASCII() -> String {
-        var result = ""
+    // Export. The position can be overridden for exporting a posed item.
+    func writeASCII(position: simd_float3? = nil, to chunk: inout GLLExportSink.Chunk) {
+        let position = position ?? self.position
         
-        result.append("\(name)\n")
-        result.append("\(parentIndex)\n")
-        result.append("\(position.x) \(position.y) \(position.z)\n")
-        
-        return result
+        chunk.appendText("\(name)\n")
+        chunk.appendText("\(parentIndex)\n")
+        chunk.appendLine(position)
     }
     
-    func writeBinary() -> Data {
-        let stream = TROutDataStream()
-        
-        stream.appendPascalString(name)
-        stream.appendUint16(UInt16(truncating: parentIndex as NSNumber))
-        stream.appendFloat32(position.x)
-        stream.appendFloat32(position.y)
-        stream.appendFloat32(position.z)
+    func writeBinary(position: simd_float3? = nil, to chunk: inout GLLExportSink.Chunk) {
+        let position = position ?? self.position
         
-        return stream.data()
+        chunk.appendPascalString(name)
+        chunk.append(UInt16(truncatingIfNeeded: parentIndex))
+        chunk.append(position.x)
+        chunk.append(position.y)
+        chunk.append(position.z)
     }
 }
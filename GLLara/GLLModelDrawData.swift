@@ -7,6 +7,7 @@
 //
 
 import Foundation
+import os
 
 class GLLModelDrawData {
     
@@ -19,9 +20,25 @@ class GLLModelDrawData {
         self.model = model
         self.resourceManager = resourceManager
         
+        // Meshlets and levels of detail have to exist before the vertex arrays get reserved. Hidden meshes only get them once they are prepared.
+        await withTaskGroup(of: Void.self) { group in
+            for mesh in model.meshes where mesh.initiallyVisible {
+                group.addTask {
+                    GLLMeshDrawData.buildElementOrder(for: mesh)
+                }
+            }
+        }
+        
         var vertexArrayMap: [GLLVertexFormat: GLLVertexArray] = [:]
         
         meshDrawData = model.meshes.map { mesh in
+            // Hidden meshes get packed and uploaded on their own, once they are needed
+            if !mesh.initiallyVisible {
+                let array = GLLVertexArray(format: mesh.vertexFormat!)
+                array.debugLabel += "-" + mesh.displayName
+                return GLLMeshDrawData(mesh: mesh, vertexArray: array, resourceManager: resourceManager, deferred: true)
+            }
+            
             let array: GLLVertexArray
             if let existing = vertexArrayMap[mesh.vertexFormat!] {
                 array = existing
@@ -33,9 +50,10 @@ class GLLModelDrawData {
             
             return GLLMeshDrawData(mesh: mesh, vertexArray: array, resourceManager: resourceManager)
         }
+        GLLModelLoadingLog.debug("\(self.statisticsReport, privacy: .public)")
         
         await withTaskGroup(of: Void.self) { group in
-            for datum in meshDrawData {
+            for datum in meshDrawData where !datum.isDeferred {
                 group.addTask {
                     datum.addToVertexArray()
                 }
@@ -51,4 +69,30 @@ class GLLModelDrawData {
         }
     }
     
+    /**
+     * # Bone palettes, meshlets, levels of detail and quantization of the meshes, as text.
+     *
+     * Only for the meshes that are on the GPU, since deferred meshes get their meshlets and levels of detail once they are prepared.
+     */
+    var statisticsReport: String {
+        let meshes = meshDrawData.filter { $0.isPrepared }.map { $0.modelMesh }
+        var result = GLLBonePalette.report(meshNames: meshes.map { $0.displayName }, palettes: meshes.map { $0.bonePalette }, totalBones: model.bones.count)
+        for mesh in meshes {
+            if let meshlets = mesh.meshlets {
+                result += "\(mesh.displayName): \(meshlets.statistics)\n"
+            }
+        }
+        result += GLLMeshSimplifier.report(meshNames: meshes.map { $0.displayName }, countsOfTriangles: meshes.map { $0.countOfUsedElements / 3 }, levels: meshes.map { $0.levelsOfDetail })
+        let quantizedMeshes = meshes.filter { $0.quantization != nil }
+        if !quantizedMeshes.isEmpty {
+            let strides = quantizedMeshes.map { mesh -> (original: Int, quantized: Int) in
+                let format = mesh.vertexFormat!
+                let unquantized = GLLVertexFormat(attributes: format.attributes, countOfVertices: mesh.countOfVertices, hasIndices: format.hasIndices)
+                return (GLLVertexArray(format: unquantized).stride, GLLVertexArray(format: format).stride)
+            }
+            result += GLLVertexQuantization.report(meshNames: quantizedMeshes.map { $0.displayName }, errors: quantizedMeshes.map { $0.quantizationErrors! }, strides: strides)
+        }
+        return result
+    }
+    
 }
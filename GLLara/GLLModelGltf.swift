@@ -70,13 +70,32 @@ extension ColorRGB: Codable {
 }
 
 struct Accessor: Codable {
-    var bufferView: Int
+    struct Sparse: Codable {
+        struct Indices: Codable {
+            var bufferView: Int
+            var byteOffset: Int?
+            var componentType: Int
+        }
+        
+        struct Values: Codable {
+            var bufferView: Int
+            var byteOffset: Int?
+        }
+        
+        var count: Int
+        var indices: Indices
+        var values: Values
+    }
+    
+    var bufferView: Int?
     var byteOffset: Int?
     var componentType: Int
+    var normalized: Bool?
     var count: Int
     var type: String
     var min: [Double]?
     var max: [Double]?
+    var sparse: Sparse?
 }
 
 struct Asset: Codable {
@@ -84,10 +103,30 @@ struct Asset: Codable {
 }
 
 struct BufferView: Codable {
+    // EXT_meshopt_compression. The view's own buffer is only a fallback then, and may not have any data.
+    struct MeshoptCompression: Codable {
+        var buffer: Int
+        var byteOffset: Int?
+        var byteLength: Int
+        var byteStride: Int
+        var count: Int
+        var mode: String
+        var filter: String?
+    }
+    
+    struct Extensions: Codable {
+        var meshoptCompression: MeshoptCompression?
+        
+        enum CodingKeys: String, CodingKey {
+            case meshoptCompression = "EXT_meshopt_compression"
+        }
+    }
+    
     var buffer: Int
-    var byteOffset: Int
+    var byteOffset: Int?
     var byteLength: Int?
     var byteStride: Int?
+    var extensions: Extensions?
 }
 
 struct Buffer: Codable {
@@ -213,6 +252,14 @@ extension MaterialExtensions: Codable {
 struct Mesh: Codable {
     var name: String?
     var primitives: [Primitive]
+    // Default morph target weights
+    var weights: [Double]?
+    var extras: MeshExtras?
+}
+
+// Not in the spec, but the common way to name morph targets
+struct MeshExtras: Codable {
+    var targetNames: [String]?
 }
 
 struct PbrMetallicRoughness: Codable {
@@ -228,6 +275,8 @@ struct Primitive: Codable, Equatable {
     var indices: Int?
     var material: Int?
     var mode: Int?
+    // Morph targets, with only POSITION, NORMAL and TANGENT as attributes
+    var targets: [[String: Int]]?
 }
 
 struct Node: Codable {
@@ -295,51 +344,142 @@ struct GltfDocument: Codable {
 
 class LoadedBuffer {
     let data: Data
+    // Where the buffer is in data. For binary files, data is the whole mapped file and this is its BIN chunk, so nothing gets copied.
+    let range: Range<Int>
     
-    init(data: Data) {
+    init(data: Data, range: Range<Int>? = nil) {
         self.data = data
+        self.range = range ?? 0 ..< data.count
     }
 }
 
 class LoadedBufferView {
     let buffer: LoadedBuffer
+    // In buffer.data, i.e. including the start of the buffer
     let range: Range<Int>
+    let byteStride: Int?
     
-    init(buffer: LoadedBuffer, range: Range<Int>) {
+    init(buffer: LoadedBuffer, range: Range<Int>, byteStride: Int?) {
         self.buffer = buffer
         self.range = range
+        self.byteStride = byteStride
     }
 }
 
 class LoadedUnboundAccessor {
-    let view: LoadedBufferView
+    // Nil if the accessor has no buffer view, which means it is all zeros apart from sparse values
+    let view: LoadedBufferView?
     let accessor: Accessor
     
-    init(view: LoadedBufferView, accessor: Accessor) {
+    init(view: LoadedBufferView?, accessor: Accessor) {
         self.view = view
         self.accessor = accessor
     }
 }
 
+/**
+ * # The buffers of a file.
+ *
+ * All buffers that the meshes use get loaded up front, at the same time, since decoding data URIs can take a while. After that nothing changes anymore, so the primitives can be loaded from several threads.
+ */
 struct LoadData {
     let file: GltfDocument
     let baseUrl: URL
     
-    var buffers: [LoadedBuffer?]
-    var bufferViews: [LoadedBufferView?]
-    var unboundAccessors: [LoadedUnboundAccessor?]
+    // Nil for buffers that no mesh needs
+    var buffers: [Result<LoadedBuffer, Error>?]
+    // The decoded data of compressed buffer views, nil for all others
+    var decompressedViews: [Result<LoadedBuffer, Error>?]
     
-    init(file: GltfDocument, baseUrl: URL, binaryData: Data?) {
+    init(file: GltfDocument, baseUrl: URL, binaryData: Data?, binaryRange: Range<Int>? = nil) {
         self.file = file
         self.baseUrl = baseUrl
+        self.buffers = []
+        self.decompressedViews = []
         
-        self.buffers = Array<LoadedBuffer?>.init(repeating: nil, count: file.buffers?.count ?? 0)
-        self.bufferViews = Array<LoadedBufferView?>.init(repeating: nil, count: file.bufferViews?.count ?? 0)
-        self.unboundAccessors = Array<LoadedUnboundAccessor?>.init(repeating: nil, count: file.accessors?.count ?? 0)
+        let fileBuffers = file.buffers ?? []
+        let neededViews = LoadData.neededViews(file: file)
+        let neededBuffers = LoadData.neededBuffers(file: file, views: neededViews)
+        let loader = self
+        var buffers = Array<Result<LoadedBuffer, Error>?>(repeating: nil, count: fileBuffers.count)
+        buffers.withUnsafeMutableBufferPointer { buffers in
+            DispatchQueue.concurrentPerform(iterations: buffers.count) { index in
+                guard neededBuffers.contains(index) else {
+                    return
+                }
+                if index == 0, fileBuffers[index].uri == nil, let binary = binaryData {
+                    buffers[index] = .success(LoadedBuffer(data: binary, range: binaryRange))
+                } else if let uri = fileBuffers[index].uri {
+                    buffers[index] = Result { LoadedBuffer(data: try loader.loadData(uriString: uri)) }
+                } else {
+                    buffers[index] = .failure(NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "Buffer without URI where it shouldn't be"]))
+                }
+            }
+        }
+        self.buffers = buffers
         
-        if let binary = binaryData, buffers.count > 0 {
-            buffers[0] = LoadedBuffer(data: binary)
+        // Compressed views get decoded once, also in parallel, since one view is often shared by several accessors
+        let decompressor = self
+        let fileViews = file.bufferViews ?? []
+        var decompressedViews = Array<Result<LoadedBuffer, Error>?>(repeating: nil, count: fileViews.count)
+        decompressedViews.withUnsafeMutableBufferPointer { decompressedViews in
+            DispatchQueue.concurrentPerform(iterations: decompressedViews.count) { index in
+                guard neededViews.contains(index), let compression = fileViews[index].extensions?.meshoptCompression else {
+                    return
+                }
+                decompressedViews[index] = Result { try decompressor.decompress(compression) }
+            }
+        }
+        self.decompressedViews = decompressedViews
+    }
+    
+    // The buffer views that the primitives of all meshes refer to
+    private static func neededViews(file: GltfDocument) -> IndexSet {
+        let accessors = file.accessors ?? []
+        let viewCount = file.bufferViews?.count ?? 0
+        var result = IndexSet()
+        for primitive in file.meshes?.flatMap({ $0.primitives }) ?? [] {
+            let accessorIndices = Array(primitive.attributes.values) + (primitive.indices.map { [$0] } ?? []) + (primitive.targets ?? []).flatMap { $0.values }
+            for accessorIndex in accessorIndices where accessorIndex >= 0 && accessorIndex < accessors.count {
+                let accessor = accessors[accessorIndex]
+                for viewIndex in [accessor.bufferView, accessor.sparse?.indices.bufferView, accessor.sparse?.values.bufferView].compactMap({ $0 }) where viewIndex >= 0 && viewIndex < viewCount {
+                    result.insert(viewIndex)
+                }
+            }
+        }
+        return result
+    }
+    
+    // The buffers of those views. For compressed views that is the one with the compressed data, not the fallback.
+    private static func neededBuffers(file: GltfDocument, views: IndexSet) -> IndexSet {
+        let fileViews = file.bufferViews ?? []
+        var result = IndexSet()
+        for viewIndex in views {
+            let buffer = fileViews[viewIndex].extensions?.meshoptCompression?.buffer ?? fileViews[viewIndex].buffer
+            if buffer >= 0 {
+                result.insert(buffer)
+            }
+        }
+        return result
+    }
+    
+    private func decompress(_ compression: BufferView.MeshoptCompression) throws -> LoadedBuffer {
+        guard let mode = GLLMeshoptDecoder.Mode(rawValue: compression.mode), let filter = GLLMeshoptDecoder.Filter(rawValue: compression.filter ?? "NONE") else {
+            throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The compression of a buffer view is not supported."])
+        }
+        let buffer = try getBuffer(for: compression.buffer)
+        let startIndex = buffer.range.lowerBound + (compression.byteOffset ?? 0)
+        let endIndex = startIndex + compression.byteLength
+        guard compression.byteOffset ?? 0 >= 0 && startIndex <= endIndex && endIndex <= buffer.range.upperBound else {
+            throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file is missing some data."])
         }
+        let decoded = buffer.data.withUnsafeBytes { bytes in
+            GLLMeshoptDecoder.decode(count: compression.count, size: compression.byteStride, mode: mode, filter: filter, from: UnsafeRawBufferPointer(rebasing: bytes[startIndex ..< endIndex]))
+        }
+        guard let decoded = decoded else {
+            throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.indexOutOfRange.rawValue), userInfo: [NSLocalizedDescriptionKey: "A compressed buffer view is invalid."])
+        }
+        return LoadedBuffer(data: decoded)
     }
     
     func makeURI(from uriString: String) -> URL {
@@ -352,18 +492,26 @@ struct LoadData {
     }
     
     func loadData(uriString: String) throws -> Data {
-        let uri = makeURI(from: uriString)
-        
-        if uri.scheme == "data" && uri.absoluteString.contains(";base64,") {
-            let components = uri.absoluteString.components(separatedBy: ";base64,")
-            if components.count == 0 {
-                throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The data URI is incomplete."])
+        if uriString.hasPrefix("data:") {
+            // Decoded straight from the string's bytes, without going through URL or splitting the string
+            var uriString = uriString
+            let data = uriString.withUTF8 { bytes -> Data? in
+                let marker = Array(";base64,".utf8)
+                guard bytes.count >= marker.count, let markerStart = (0 ... bytes.count - marker.count).first(where: { start in marker.indices.allSatisfy { bytes[start + $0] == marker[$0] } }) else {
+                    return nil
+                }
+                let encoded = UnsafeRawBufferPointer(rebasing: UnsafeRawBufferPointer(bytes)[(markerStart + marker.count)...])
+                var decoder = GLLBase64Decoder(expectedCount: encoded.count)
+                decoder.decode(encoded)
+                return decoder.finish()
             }
-            guard let encodedString = components.last, let data = Data(base64Encoded: encodedString, options: .ignoreUnknownCharacters) else {
+            guard let data = data else {
                 throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The data URI is invalid."])
             }
             return data
         }
+        
+        let uri = makeURI(from: uriString)
         guard uri.isFileURL else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "Loading data via the internet is disabled for security reasons."])
 
@@ -372,69 +520,102 @@ struct LoadData {
         return try Data(contentsOf: uri, options: .mappedIfSafe)
     }
     
-    mutating func getBuffer(for index: Int) throws -> LoadedBuffer {
+    func getBuffer(for index: Int) throws -> LoadedBuffer {
         guard let fileBuffers = file.buffers else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file doesn't contain any buffers"])
         }
-        guard index < fileBuffers.count else {
+        guard index >= 0 && index < fileBuffers.count, let loadedBuffer = buffers[index] else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file doesn't contain a needed buffer"])
         }
-        if let loadedBuffer = buffers[index] {
-            return loadedBuffer;
-        }
-        
-        let buffer = fileBuffers[index]
-        guard let uri = buffer.uri else {
-            throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "Buffer without URI where it shouldn't be"])
-        }
-        
-        let data = try loadData(uriString: uri)
-        let loadedBuffer = LoadedBuffer(data: data)
-        buffers[index] = loadedBuffer
-        return loadedBuffer
+        return try loadedBuffer.get()
     }
     
-    mutating func getBufferView(for index: Int) throws -> LoadedBufferView {
+    func getBufferView(for index: Int) throws -> LoadedBufferView {
         guard let fileViews = file.bufferViews else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file doesn't contain any buffer views"])
         }
-        guard index < fileViews.count else {
+        guard index >= 0 && index < fileViews.count else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file doesn't contain a needed buffer view"])
         }
-        if let loadedView = bufferViews[index] {
-            return loadedView
-        }
         
         let view = fileViews[index]
+        if view.extensions?.meshoptCompression != nil, let decompressed = decompressedViews[index] {
+            let buffer = try decompressed.get()
+            return LoadedBufferView(buffer: buffer, range: buffer.range, byteStride: view.byteStride)
+        }
+        
         let buffer = try getBuffer(for: view.buffer)
+        let byteOffset = view.byteOffset ?? 0
+        let startIndex = buffer.range.lowerBound + byteOffset
         let endIndex: Int
         if let byteLength = view.byteLength {
-            endIndex = view.byteOffset + byteLength
+            endIndex = startIndex + byteLength
         } else {
-            endIndex = buffer.data.count
+            endIndex = buffer.range.upperBound
         }
-        let loadedView = LoadedBufferView(buffer: buffer, range: view.byteOffset ..< endIndex)
-        bufferViews[index] = loadedView
-        return loadedView
+        guard byteOffset >= 0 && startIndex <= endIndex && endIndex <= buffer.range.upperBound else {
+            throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file is missing some data."])
+        }
+        return LoadedBufferView(buffer: buffer, range: startIndex ..< endIndex, byteStride: view.byteStride)
     }
     
-    mutating func getUnboundAccessor(for index: Int) throws -> LoadedUnboundAccessor {
+    func getUnboundAccessor(for index: Int) throws -> LoadedUnboundAccessor {
         guard let fileAccessors = file.accessors else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file doesn't contain any accessors"])
         }
-        guard index < fileAccessors.count else {
+        guard index >= 0 && index < fileAccessors.count else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file doesn't contain a needed accessor"])
         }
-        if let loadedAccessor = unboundAccessors[index] {
-            return loadedAccessor
+        
+        let accessor = fileAccessors[index]
+        let view = try accessor.bufferView.map { try getBufferView(for: $0) }
+        return LoadedUnboundAccessor(view: view, accessor: accessor)
+    }
+    
+    // Bytes in the view's buffer data, starting at offset within the view. Without length, they go to the end of the view.
+    func byteRange(offset: Int?, length: Int? = nil, in view: LoadedBufferView) throws -> Range<Int> {
+        let startIndex = view.range.lowerBound + (offset ?? 0)
+        let endIndex = length.map { startIndex + $0 } ?? view.range.upperBound
+        guard offset ?? 0 >= 0 && startIndex <= endIndex && endIndex <= view.range.upperBound else {
+            throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file is missing some data."])
+        }
+        return startIndex ..< endIndex
+    }
+    
+    /**
+     * # All values of an accessor as floats.
+     *
+     * For accessors that can't be used as they are in the file: normalized integers, sparse accessors and ones without buffer view.
+     */
+    func floats(for loadedAccessor: LoadedUnboundAccessor) throws -> [Float] {
+        let accessor = loadedAccessor.accessor
+        guard let componentCount = GLLAccessorDecoder.componentCount(type: accessor.type), let decoder = GLLAccessorDecoder(componentType: accessor.componentType, componentCount: componentCount, count: accessor.count, isNormalized: accessor.normalized ?? false, byteStride: loadedAccessor.view?.byteStride) else {
+            throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
         }
         
+        var floats: [Float]
+        if let view = loadedAccessor.view {
+            let range = try byteRange(offset: accessor.byteOffset, length: decoder.byteLength, in: view)
+            floats = view.buffer.data.withUnsafeBytes { decoder.floats(from: UnsafeRawBufferPointer(rebasing: $0[range])) }
+        } else {
+            floats = Array(repeating: 0, count: accessor.count * componentCount)
+        }
         
-        let accessor = fileAccessors[index]
-        let view = try getBufferView(for: accessor.bufferView)
-        let loadedAccessor = LoadedUnboundAccessor(view: view, accessor: accessor)
-        unboundAccessors[index] = loadedAccessor
-        return loadedAccessor
+        if let sparse = accessor.sparse {
+            let indicesView = try getBufferView(for: sparse.indices.bufferView)
+            let valuesView = try getBufferView(for: sparse.values.bufferView)
+            let indicesRange = try byteRange(offset: sparse.indices.byteOffset, in: indicesView)
+            let valuesRange = try byteRange(offset: sparse.values.byteOffset, in: valuesView)
+            let applied = indicesView.buffer.data.withUnsafeBytes { indices in
+                valuesView.buffer.data.withUnsafeBytes { values in
+                    decoder.applySparse(count: sparse.count, indexComponentType: sparse.indices.componentType, indices: UnsafeRawBufferPointer(rebasing: indices[indicesRange]), values: UnsafeRawBufferPointer(rebasing: values[valuesRange]), to: &floats)
+                }
+            }
+            guard applied else {
+                throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.indexOutOfRange.rawValue), userInfo: [NSLocalizedDescriptionKey: "The sparse data of an accessor is invalid."])
+            }
+        }
+        return floats
     }
 }
 
@@ -514,9 +695,10 @@ class GLLModelGltf: GLLModel {
                     throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.indexOutOfRange.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file cannot be loaded because the file size is incorrect."])
                 }
                 let jsonEnd = Int(20 + chunkLengthJson)
-                let jsonData = try data.checkedSubdata(in: 20 ..< jsonEnd)
+                // Only views into the mapped file, no copies
+                let jsonData = data[20 ..< jsonEnd]
                 
-                let binaryData: Data?
+                let binaryRange: Range<Int>?
                 if jsonEnd < data.count {
                     let chunkLengthBinary = try data.readUInt32(at: jsonEnd)
                     let chunkTypeBinary = try data.readUInt32(at: jsonEnd + 4)
@@ -524,12 +706,15 @@ class GLLModelGltf: GLLModel {
                         throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The binary glTF container format version is not supported."])
                     }
                     let binaryEnd = jsonEnd + 8 + Int(chunkLengthBinary)
-                    binaryData = try data.checkedSubdata(in: jsonEnd + 8 ..< binaryEnd)
+                    if binaryEnd > data.count {
+                        throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [NSLocalizedDescriptionKey: "The file is missing some data."])
+                    }
+                    binaryRange = jsonEnd + 8 ..< binaryEnd
                 } else {
-                    binaryData = nil
+                    binaryRange = nil
                 }
                 
-                try self.init(jsonData: jsonData, baseUrl: url, binaryData: binaryData)
+                try self.init(jsonData: jsonData, baseUrl: url, binaryData: binaryRange != nil ? data : nil, binaryRange: binaryRange)
             } else {
                 throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The binary glTF container format version is not supported."])
             }
@@ -570,7 +755,51 @@ class GLLModelGltf: GLLModel {
         return (semantic, layer)
     }
     
-    private func load(primitive: Primitive, fromMesh mesh: Mesh, loadData: inout LoadData, document: GltfDocument) throws {
+    // The Metal format for an accessor's components; nil if there is none
+    private func vertexFormat(componentType: Int, componentCount: Int, normalized: Bool) -> MTLVertexFormat? {
+        let formats: [MTLVertexFormat]
+        switch (componentType, normalized) {
+        case (0x1400, false): // Byte
+            formats = [.char, .char2, .char3, .char4]
+        case (0x1400, true):
+            formats = [.charNormalized, .char2Normalized, .char3Normalized, .char4Normalized]
+        case (0x1401, false): // Unsigned byte
+            formats = [.uchar, .uchar2, .uchar3, .uchar4]
+        case (0x1401, true):
+            formats = [.ucharNormalized, .uchar2Normalized, .uchar3Normalized, .uchar4Normalized]
+        case (0x1402, false): // Short
+            formats = [.short, .short2, .short3, .short4]
+        case (0x1402, true):
+            formats = [.shortNormalized, .short2Normalized, .short3Normalized, .short4Normalized]
+        case (0x1403, false): // Unsigned short
+            formats = [.ushort, .ushort2, .ushort3, .ushort4]
+        case (0x1403, true):
+            formats = [.ushortNormalized, .ushort2Normalized, .ushort3Normalized, .ushort4Normalized]
+        case (0x1405, false): // Unsigned int
+            formats = [.uint, .uint2, .uint3, .uint4]
+        case (0x1406, false): // Float
+            formats = [.float, .float2, .float3, .float4]
+        default:
+            return nil
+        }
+        guard componentCount >= 1 && componentCount <= 4 else {
+            return nil
+        }
+        return formats[componentCount - 1]
+    }
+    
+    // Everything a mesh needs from the file. Loading these can happen on several threads at once, creating the meshes cannot.
+    private struct LoadedPrimitive {
+        var countOfVertices: Int
+        var countOfUVLayers: Int
+        var accessors: [GLLVertexAttribAccessor]
+        var elementData: Data?
+        var elementSize: Int
+        var countOfElements: Int
+        var morphTargets: GLLMorphTargetSet?
+    }
+    
+    private func load(primitive: Primitive, targetNames: [String], loadData: LoadData) throws -> LoadedPrimitive {
         var countOfVertices: Int? = nil
         var uvLayers = IndexSet()
         
@@ -586,108 +815,14 @@ class GLLModelGltf: GLLModel {
                 uvLayers.insert(layer)
             }
             
-            let format: MTLVertexFormat
-            switch fileAccessor.accessor.type {
-            case "SCALAR":
-                switch fileAccessor.accessor.componentType {
-                case 0x1400: // Byte
-                    format = .char
-                case 0x1401:
-                    format = .uchar
-                case 0x1402:
-                    format = .short
-                case 0x1403:
-                    format = .ushort
-                case 0x1404:
-                    format = .int
-                case 0x1405:
-                    format = .uint
-                case 0x1406:
-                    format = .float
-                default:
-                    throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
-                }
-            case "VEC2":
-                switch fileAccessor.accessor.componentType {
-                case 0x1400: // Byte
-                    format = .char2
-                case 0x1401:
-                    format = .uchar2
-                case 0x1402:
-                    format = .short2
-                case 0x1403:
-                    format = .ushort2
-                case 0x1404:
-                    format = .int2
-                case 0x1405:
-                    format = .uint2
-                case 0x1406:
-                    format = .float2
-                default:
-                    throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
-                }
-            case "VEC3":
-                switch fileAccessor.accessor.componentType {
-                case 0x1400: // Byte
-                    format = .char3
-                case 0x1401:
-                    format = .uchar3
-                case 0x1402:
-                    format = .short3
-                case 0x1403:
-                    format = .ushort3
-                case 0x1404:
-                    format = .int3
-                case 0x1405:
-                    format = .uint3
-                case 0x1406:
-                    format = .float3
-                default:
-                    throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
-                }
-            case "VEC4":
-                switch fileAccessor.accessor.componentType {
-                case 0x1400: // Byte
-                    format = .char4
-                case 0x1401:
-                    format = .uchar4
-                case 0x1402:
-                    format = .short4
-                case 0x1403:
-                    format = .ushort4
-                case 0x1404:
-                    format = .int4
-                case 0x1405:
-                    format = .uint4
-                case 0x1406:
-                    format = .float4
-                default:
-                    throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
-                }
-            case "MAT2":
-                switch fileAccessor.accessor.componentType {
-                default:
-                    // TODO Consider splitting into multiple attributes
-                    // In general accessors with these types are not intended for vertices, but for bones and similar.
-                    throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
-                }
-            case "MAT3":
-                switch fileAccessor.accessor.componentType {
-                default:
-                    // TODO Consider splitting into multiple attributes.
-                    // In general accessors with these types are not intended for vertices, but for bones and similar.
-                    throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
-                }
-            case "MAT4":
-                switch fileAccessor.accessor.componentType {
-                default:
-                    // TODO Consider splitting into multiple attributes
-                    // In general accessors with these types are not intended for vertices, but for bones and similar.
-                    throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
-                }
-            default:
+            guard let componentCount = GLLAccessorDecoder.componentCount(type: fileAccessor.accessor.type) else {
                 throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute size value is not supported."])
             }
+            // In general accessors with matrix types are not intended for vertices, but for bones and similar.
+            let isNormalized = fileAccessor.accessor.normalized ?? false
+            guard !fileAccessor.accessor.type.hasPrefix("MAT"), let format = vertexFormat(componentType: fileAccessor.accessor.componentType, componentCount: componentCount, normalized: isNormalized) else {
+                throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute type value is not supported."])
+            }
             
             if let existingCount = countOfVertices {
                 if existingCount != fileAccessor.accessor.count {
@@ -697,10 +832,24 @@ class GLLModelGltf: GLLModel {
                 countOfVertices = fileAccessor.accessor.count
             }
             
-            let underlyingView = document.bufferViews![fileAccessor.accessor.bufferView]
-            let vertexAttrib = GLLVertexAttrib(semantic: semantic, layer: layer, format: format)
-            let vertexAccessor = GLLVertexAttribAccessor(attribute: vertexAttrib, dataBuffer: fileAccessor.view.buffer.data, offset: fileAccessor.accessor.byteOffset ?? 0 + fileAccessor.view.range.first!, stride: underlyingView.byteStride ?? 0)
-            accessors.append(vertexAccessor)
+            // Positions have to be floats for bounds, skinning and so on. Other integers (from KHR_mesh_quantization) are meant to be scaled by the node transform, which this doesn't use, so they become floats too. Normalized integers stay as they are, and Metal turns them into floats.
+            let isFloat = fileAccessor.accessor.componentType == GLLAccessorDecoder.ComponentType.float.rawValue
+            let canUseDirectly = isFloat || (semantic != .position && (isNormalized || semantic == .boneIndices))
+            if let view = fileAccessor.view, fileAccessor.accessor.sparse == nil, canUseDirectly {
+                // Used straight from the file
+                let vertexAttrib = GLLVertexAttrib(semantic: semantic, layer: layer, format: format)
+                let stride = view.byteStride ?? vertexAttrib.sizeInBytes
+                let length = fileAccessor.accessor.count == 0 ? 0 : (fileAccessor.accessor.count - 1) * stride + vertexAttrib.sizeInBytes
+                let range = try loadData.byteRange(offset: fileAccessor.accessor.byteOffset, length: length, in: view)
+                accessors.append(GLLVertexAttribAccessor(attribute: vertexAttrib, dataBuffer: view.buffer.data, offset: range.lowerBound, stride: stride))
+            } else {
+                // Sparse and missing data and the integers from above get converted to floats, all at once
+                let floats = try loadData.floats(for: fileAccessor)
+                let floatFormats: [MTLVertexFormat] = [.float, .float2, .float3, .float4]
+                let vertexAttrib = GLLVertexAttrib(semantic: semantic, layer: layer, format: floatFormats[componentCount - 1])
+                let data = floats.withUnsafeBytes { Data($0) }
+                accessors.append(GLLVertexAttribAccessor(attribute: vertexAttrib, dataBuffer: data, offset: 0, stride: vertexAttrib.sizeInBytes))
+            }
         }
         guard let finalCountOfVertices = countOfVertices else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The vertex size value is wonky."])
@@ -709,6 +858,69 @@ class GLLModelGltf: GLLModel {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "Only sets of triangles are supported."])
         }
         
+        var loaded = LoadedPrimitive(countOfVertices: finalCountOfVertices, countOfUVLayers: uvLayers.count, accessors: accessors, elementData: nil, elementSize: 0, countOfElements: 0, morphTargets: nil)
+        if let fileTargets = primitive.targets, !fileTargets.isEmpty {
+            let targets = try fileTargets.enumerated().map { (index, attributes) in
+                try loadMorphTarget(attributes: attributes, name: index < targetNames.count ? targetNames[index] : "target \(index)", countOfVertices: finalCountOfVertices, loadData: loadData)
+            }
+            loaded.morphTargets = GLLMorphTargetSet(countOfVertices: finalCountOfVertices, targets: targets)
+        }
+        if let indicesKey = primitive.indices {
+            let elements = try loadData.getUnboundAccessor(for: indicesKey)
+            switch elements.accessor.componentType {
+            case 0x1400: // Byte (treating as if it was unsigned)
+                loaded.elementSize = 1
+            case 0x1401: // Unsigned byte
+                loaded.elementSize = 1
+            case 0x1402: // Short (treating it as unsigned)
+                loaded.elementSize = 2
+            case 0x1403: // Unsigned short
+                loaded.elementSize = 2
+            case 0x1404: // Int (treating it as unsigned
+                loaded.elementSize = 4
+            case 0x1405: // Unsigned int
+                loaded.elementSize = 4
+            default:
+                throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The element data type is not supported."])
+            }
+            guard let view = elements.view, elements.accessor.sparse == nil else {
+                throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The element data type is not supported."])
+            }
+            // Only the accessor's part of the view, as its own data starting at 0, since the elements get changed later
+            let range = try loadData.byteRange(offset: elements.accessor.byteOffset, length: elements.accessor.count * loaded.elementSize, in: view)
+            loaded.elementData = view.buffer.data.subdata(in: range)
+            loaded.countOfElements = elements.accessor.count
+        }
+        return loaded
+    }
+    
+    // Tangent offsets get ignored; the tangents get skinned, but not morphed
+    private func loadMorphTarget(attributes: [String: Int], name: String, countOfVertices: Int, loadData: LoadData) throws -> GLLMorphTargetSet.Target {
+        func offsets(for attributeKey: String) throws -> [SIMD3<Float>] {
+            guard let attributeIndex = attributes[attributeKey] else {
+                return []
+            }
+            let fileAccessor = try loadData.getUnboundAccessor(for: attributeIndex)
+            guard fileAccessor.accessor.type == "VEC3" else {
+                throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "A vertex attribute size value is not supported."])
+            }
+            guard fileAccessor.accessor.count == countOfVertices else {
+                throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The vertex size value is wonky."])
+            }
+            let floats = try loadData.floats(for: fileAccessor)
+            return (0 ..< countOfVertices).map { SIMD3<Float>(floats[$0 * 3], floats[$0 * 3 + 1], floats[$0 * 3 + 2]) }
+        }
+        
+        let normalOffsets = try offsets(for: "NORMAL")
+        var positionOffsets = try offsets(for: "POSITION")
+        if positionOffsets.isEmpty {
+            positionOffsets = Array(repeating: SIMD3<Float>(), count: countOfVertices)
+        }
+        return GLLMorphTargetSet.Target(name: name, positionOffsets: positionOffsets, normalOffsets: normalOffsets)
+    }
+    
+    private func makeMesh(from loaded: LoadedPrimitive, primitive: Primitive, fromMesh mesh: Mesh, document: GltfDocument) {
+        let accessors = loaded.accessors
         let modelMesh = GLLModelMesh(asPartOfModel: self)
         modelMesh.name = mesh.name ?? "mesh"
         if mesh.primitives.count > 1, let primitiveIndex = mesh.primitives.firstIndex(of: primitive) {
@@ -717,8 +929,8 @@ class GLLModelGltf: GLLModel {
         modelMesh.displayName = modelMesh.name
         modelMesh.textures = [:]
         modelMesh.shader = self.parameters.shader(base: "glTFDefault")
-        modelMesh.countOfVertices = finalCountOfVertices
-        modelMesh.countOfUVLayers = uvLayers.count
+        modelMesh.countOfVertices = loaded.countOfVertices
+        modelMesh.countOfUVLayers = loaded.countOfUVLayers
         modelMesh.vertexDataAccessors = GLLVertexAttribAccessorSet(accessors: accessors)
         modelMesh.renderParameterValues = [:]
         
@@ -745,42 +957,26 @@ class GLLModelGltf: GLLModel {
             modelMesh.renderParameterValues["baseColorFactor"] = baseColor.toNSColor;
         }
         
-        if let indicesKey = primitive.indices {
-            let elements = try loadData.getUnboundAccessor(for: indicesKey)
-            modelMesh.elementData = elements.view.buffer.data.subdata(in: elements.view.range)
-            switch elements.accessor.componentType {
-            case 0x1400: // Byte (treating as if it was unsigned)
-                modelMesh.elementSize = 1
-            case 0x1401: // Unsigned byte
-                modelMesh.elementSize = 1
-            case 0x1402: // Short (treating it as unsigned)
-                modelMesh.elementSize = 2
-            case 0x1403: // Unsigned short
-                modelMesh.elementSize = 2
-            case 0x1404: // Int (treating it as unsigned
-                modelMesh.elementSize = 4
-            case 0x1405: // Unsigned int
-                modelMesh.elementSize = 4
-            default:
-                throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.fileTypeNotSupported.rawValue), userInfo: [NSLocalizedDescriptionKey: "The element data type is not supported."])
-            }
-            modelMesh.countOfElements = elements.accessor.count
-        } else {
-            modelMesh.elementData = nil
-            modelMesh.elementSize = 0
-            modelMesh.countOfElements = 0
+        modelMesh.elementData = loaded.elementData
+        modelMesh.elementSize = loaded.elementSize
+        modelMesh.countOfElements = loaded.countOfElements
+        
+        if let morphTargets = loaded.morphTargets {
+            modelMesh.morphTargets = morphTargets
+            let weights = (mesh.weights ?? []).prefix(morphTargets.targets.count).map { Float($0) }
+            modelMesh.morphWeights = weights + Array(repeating: 0, count: morphTargets.targets.count - weights.count)
         }
         
-        modelMesh.vertexFormat = modelMesh.vertexDataAccessors!.vertexFormat(vertexCount: modelMesh.countOfVertices, hasIndices: modelMesh.elementData != nil)
+        modelMesh.updateVertexFormat(hasIndices: modelMesh.elementData != nil)
                             
         self.meshes.append(modelMesh)
     }
     
-    init(jsonData: Data, baseUrl: URL, binaryData: Data? = nil) throws {
+    init(jsonData: Data, baseUrl: URL, binaryData: Data? = nil, binaryRange: Range<Int>? = nil) throws {
         let decoder = JSONDecoder()
         let document = try decoder.decode(GltfDocument.self, from: jsonData)
         
-        var loadData = LoadData(file: document, baseUrl: baseUrl, binaryData: binaryData)
+        let loadData = LoadData(file: document, baseUrl: baseUrl, binaryData: binaryData, binaryRange: binaryRange)
         
         super.init()
         
@@ -790,13 +986,18 @@ class GLLModelGltf: GLLModel {
         self.bones = []
         self.meshes = []
         
-        // Load meshes
+        // Load meshes. The data of all primitives gets read in parallel, then the meshes get created in order.
         if let meshes = document.meshes {
-            for mesh in meshes {
-                for primitive in mesh.primitives {
-                    try load(primitive: primitive, fromMesh: mesh, loadData: &loadData, document: document)
+            let primitives = meshes.flatMap { mesh in mesh.primitives.map { (mesh: mesh, primitive: $0) } }
+            var results = Array<Result<LoadedPrimitive, Error>?>(repeating: nil, count: primitives.count)
+            results.withUnsafeMutableBufferPointer { results in
+                DispatchQueue.concurrentPerform(iterations: results.count) { index in
+                    results[index] = Result { try self.load(primitive: primitives[index].primitive, targetNames: primitives[index].mesh.extras?.targetNames ?? [], loadData: loadData) }
                 }
             }
+            for (primitive, result) in zip(primitives, results) {
+                try makeMesh(from: result!.get(), primitive: primitive.primitive, fromMesh: primitive.mesh, document: document)
+            }
         }
         
         // Set up the one and only bone we have for now
@@ -0,0 +1,100 @@
+//
+//  GLLModelMesh+BonePalette.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+extension GLLModelMesh {
+    
+    /**
+     * # Finds the used bones and sets up the vertex format for drawing.
+     *
+     * Has to be called once the vertex data is final, apart from deferred tangents. Also calculates the bounds. The vertex data itself keeps the global bone indices, which the exporters and CPU skinning need; only the data for the GPU gets the local indices, see drawingVertexDataAccessors.
+     */
+    func updateVertexFormat(hasIndices: Bool = true) {
+        let accessors = vertexDataLayout!
+        let boneIndexAccessor = accessors.accessor(semantic: .boneIndices)
+        
+        if let indices = variableBoneIndices {
+            bonePalette = GLLBonePalette(indices: indices)
+        } else if let boneIndexAccessor, boneIndexAccessor.attribute.format == .ushort4 {
+            bonePalette = GLLBonePalette(indices: boneIndexAccessor.simdArray(count: countOfVertices, type: SIMD4<UInt16>.self))
+        } else if boneIndexAccessor != nil {
+            // Unknown index format; leave the indices as they are
+            bonePalette = GLLBonePalette(boneCount: model?.bones.count ?? 0)
+        } else {
+            bonePalette = GLLBonePalette()
+        }
+        
+        let attributes = accessors.accessors.map { accessor -> GLLVertexAttrib in
+            if accessor.attribute.semantic == .boneIndices && accessor.attribute.format == .ushort4 && bonePalette.fitsInUInt8 {
+                return GLLVertexAttrib(semantic: .boneIndices, layer: accessor.attribute.layer, format: .uchar4)
+            }
+            return accessor.attribute
+        }
+        
+        // The shader can only unpack the whole layout, so positions and normals both have to be there. Normals and tangents can be floats or normalized integers (from quantized glTF files); both get the octahedral encoding.
+        let positionAccessor = accessors.accessor(semantic: .position)
+        let normalAccessor = accessors.accessor(semantic: .normal)
+        let canEncodeDirections = accessors.accessors.allSatisfy { accessor in
+            switch accessor.attribute.semantic {
+            case .normal:
+                return accessor.attribute.format == .float3 || accessor.attribute.normalizedComponents != nil
+            case .tangent0:
+                return accessor.attribute.format == .float4 || accessor.attribute.normalizedComponents != nil
+            default:
+                return true
+            }
+        }
+        if UserDefaults.standard.bool(forKey: GLLPrefQuantizeVertices), let positionAccessor, positionAccessor.attribute.format == .float3, normalAccessor != nil, canEncodeDirections, countOfVertices > 0 {
+            quantization = GLLVertexQuantization(positions: positionAccessor.simdArray(count: countOfVertices, type: SIMD3<Float>.self))
+        } else {
+            quantization = nil
+        }
+        vertexFormat = GLLVertexFormat(attributes: attributes, countOfVertices: countOfVertices, hasIndices: hasIndices, isQuantized: quantization != nil)
+        
+        if let positionAccessor {
+            bounds = GLLMeshBounds(positions: positionAccessor.simdArray(count: countOfVertices, type: SIMD3<Float>.self), boneData: cpuBoneData)
+        } else {
+            bounds = nil
+        }
+    }
+    
+    // How far the quantized positions and normals are from the originals; nil if the mesh is not quantized
+    var quantizationErrors: GLLVertexQuantization.Errors? {
+        guard let quantization, let accessors = vertexDataLayout else {
+            return nil
+        }
+        let positions = accessors.accessor(semantic: .position)!.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        let normals = accessors.accessor(semantic: .normal)!.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        return quantization.errors(positions: positions, normals: normals)
+    }
+    
+    // The vertex data in vertexFormat, with the bone indices rewritten to refer to the bone palette.
+    var drawingVertexDataAccessors: GLLVertexAttribAccessorSet {
+        let accessors = vertexDataAccessors!
+        guard let boneIndexAccessor = accessors.accessor(semantic: .boneIndices), boneIndexAccessor.attribute.format == .ushort4 else {
+            return accessors
+        }
+        
+        let globalIndices = boneIndexAccessor.simdArray(count: countOfVertices, type: SIMD4<UInt16>.self)
+        let localAccessor: GLLVertexAttribAccessor
+        if bonePalette.fitsInUInt8 {
+            let data = bonePalette.remapped8Bit(globalIndices).withUnsafeBufferPointer { Data(buffer: $0) }
+            localAccessor = GLLVertexAttribAccessor(semantic: .boneIndices, format: .uchar4, dataBuffer: data, offset: 0, stride: MemoryLayout<SIMD4<UInt8>>.stride)
+        } else {
+            let data = bonePalette.remapped(globalIndices).withUnsafeBufferPointer { Data(buffer: $0) }
+            localAccessor = GLLVertexAttribAccessor(semantic: .boneIndices, format: .ushort4, dataBuffer: data, offset: 0, stride: MemoryLayout<SIMD4<UInt16>>.stride)
+        }
+        return accessors.combining(with: GLLVertexAttribAccessorSet(accessors: [localAccessor]))
+    }
+    
+    // The indices into the variable bone weights, rewritten to refer to the bone palette.
+    var drawingVariableBoneIndices: [UInt16]? {
+        return variableBoneIndices.map { bonePalette.remapped($0) }
+    }
+}
@@ -0,0 +1,62 @@
+//
+//  GLLModelMesh+LevelsOfDetail.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import os
+
+extension GLLModelMesh {
+    
+    /**
+     * # Sets levelsOfDetail, either from the cache or by simplifying the mesh.
+     *
+     * Simplifying a large mesh takes a while, so the result gets stored in the caches folder, under a hash of everything the simplifier looks at. Changing the model file changes the hash; old entries just stay around until the system cleans up the caches.
+     */
+    func generateLevelsOfDetail() {
+        guard countOfUsedElements / 3 >= GLLMeshSimplifier.minimumTriangles, let accessors = vertexDataLayout, let positionAccessor = accessors.accessor(semantic: .position), positionAccessor.attribute.format == .float3 else {
+            return
+        }
+        
+        let positions = positionAccessor.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        var normals: [SIMD3<Float>] = []
+        if let normalAccessor = accessors.accessor(semantic: .normal), normalAccessor.attribute.format == .float3 {
+            normals = normalAccessor.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        }
+        let texCoords = (0 ..< countOfUVLayers).compactMap { layer -> [SIMD2<Float>]? in
+            guard let texCoordAccessor = accessors.accessor(semantic: .texCoord0, layer: layer), texCoordAccessor.attribute.format == .float2 else {
+                return nil
+            }
+            return texCoordAccessor.simdArray(count: countOfVertices, type: SIMD2<Float>.self)
+        }
+        let boneData = hasBoneWeights ? cpuBoneData : .none
+        let indices = usedElements
+        
+        let cacheFile = GLLModelMesh.levelsOfDetailCache?.appendingPathComponent(GLLMeshSimplifier.cacheKey(positions: positions, normals: normals, texCoords: texCoords, boneData: boneData, indices: indices))
+        if let cacheFile, let data = try? Data(contentsOf: cacheFile), let levels = GLLMeshSimplifier.decode(data, countOfVertices: countOfVertices) {
+            levelsOfDetail = levels
+            return
+        }
+        
+        let simplifier = GLLMeshSimplifier(positions: positions, normals: normals, texCoords: texCoords, boneData: boneData, indices: indices)
+        levelsOfDetail = simplifier.levels
+        if let cacheFile {
+            do {
+                try FileManager.default.createDirectory(at: cacheFile.deletingLastPathComponent(), withIntermediateDirectories: true)
+                try GLLMeshSimplifier.encode(levels: simplifier.levels).write(to: cacheFile, options: .atomic)
+            } catch {
+                GLLModelLoadingLog.error("Could not cache levels of detail for \(self.name, privacy: .public): \(error.localizedDescription, privacy: .public)")
+            }
+        }
+    }
+    
+    private static var levelsOfDetailCache: URL? {
+        guard let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first else {
+            return nil
+        }
+        return caches.appendingPathComponent(Bundle.main.bundleIdentifier ?? "GLLara").appendingPathComponent("LevelsOfDetail")
+    }
+}
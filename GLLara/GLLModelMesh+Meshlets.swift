@@ -0,0 +1,29 @@
+//
+//  GLLModelMesh+Meshlets.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+extension GLLModelMesh {
+    
+    /**
+     * # Splits a large mesh into meshlets.
+     *
+     * Puts the elements in the order of the meshlets, so this has to happen before anything else uses the elements for drawing.
+     */
+    func buildMeshlets() {
+        guard elementData != nil, countOfElements / 3 >= GLLMeshlets.minimumTriangles, let positionAccessor = vertexDataLayout?.accessor(semantic: .position), positionAccessor.attribute.format == .float3 else {
+            return
+        }
+        let positions = positionAccessor.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        let result = GLLMeshlets(positions: positions, boneData: hasBoneWeights ? cpuBoneData : .none, indices: usedElements)
+        meshlets = result
+        elementData = result.indices.withUnsafeBufferPointer { Data(buffer: $0) }
+        elementSize = 4
+        countOfElements = result.indices.count
+    }
+}
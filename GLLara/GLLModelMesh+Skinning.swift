@@ -0,0 +1,97 @@
+//
+//  GLLModelMesh+Skinning.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+extension GLLModelMesh {
+    
+    /**
+     * # A CPU skinner for the vertices of this mesh.
+     *
+     * Gathers the vertex data from the accessors once. Create it once per export and reuse it for all poses.
+     */
+    var cpuSkinner: GLLCPUSkinner {
+        let accessors = vertexDataAccessors!
+        let positions = accessors.accessor(semantic: .position)!.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        let normals = accessors.accessor(semantic: .normal)!.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        
+        var tangents: [[SIMD4<Float>]] = []
+        for layer in 0 ..< countOfUVLayers {
+            guard let tangentAccessor = accessors.accessor(semantic: .tangent0, layer: layer) else {
+                break
+            }
+            tangents.append(tangentAccessor.simdArray(count: countOfVertices, type: SIMD4<Float>.self))
+        }
+        
+        return GLLCPUSkinner(positions: positions, normals: normals, tangents: tangents, boneData: cpuBoneData)
+    }
+    
+    // The bone indices and weights of all vertices, with global bone indices
+    var cpuBoneData: GLLCPUSkinner.BoneData {
+        let accessors = vertexDataLayout!
+        if let offsetLengthAccessor = accessors.accessor(semantic: .boneDataOffsetLength), let indices = variableBoneIndices, let weights = variableBoneWeights {
+            return .variable(offsetLength: offsetLengthAccessor.simdArray(count: countOfVertices, type: SIMD2<UInt16>.self), indices: indices, weights: weights)
+        } else if let indexAccessor = accessors.accessor(semantic: .boneIndices), let weightAccessor = accessors.accessor(semantic: .boneWeights) {
+            return .fixed(indices: indexAccessor.simdArray(count: countOfVertices, type: SIMD4<UInt16>.self), weights: weightAccessor.simdArray(count: countOfVertices, type: SIMD4<Float>.self))
+        } else {
+            return .none
+        }
+    }
+    
+    /**
+     * # The summed offsets of the morph targets.
+     *
+     * The weights belong to the item mesh; the model mesh only has the defaults from the file. Nil if there is nothing to add, so skinning can skip it.
+     */
+    func morphDeltas(weights: [Float]) -> GLLMorphTargetSet.Deltas? {
+        guard let morphTargets, isMorphed(weights: weights) else {
+            return nil
+        }
+        return morphTargets.evaluate(weights: weights)
+    }
+    
+    // Whether morphDeltas would return anything, without evaluating the targets
+    func isMorphed(weights: [Float]) -> Bool {
+        guard let morphTargets, weights.count == morphTargets.targets.count else {
+            return false
+        }
+        return weights.contains { $0 != 0 }
+    }
+    
+    // How far the morph targets with these weights can move any vertex, for growing the bounds. 0 under the same conditions where morphDeltas is nil.
+    func morphDistance(weights: [Float]) -> Float {
+        guard let morphTargets, weights.count == morphTargets.targets.count else {
+            return 0
+        }
+        return morphTargets.maximumPositionDelta(weights: weights)
+    }
+    
+    /**
+     * # Vertex data with positions, normals and tangents in the given pose.
+     *
+     * All other attributes are shared with the original vertex data. The transforms are indexed by bone index.
+     */
+    func posedVertexDataAccessors(transforms: [matrix_float4x4], morphWeights: [Float] = []) -> GLLVertexAttribAccessorSet {
+        let skinned = cpuSkinner.skin(transforms: transforms, morphDeltas: morphDeltas(weights: morphWeights))
+        
+        // Stored as packed float3, not SIMD3 with its padding
+        let positionData = skinned.positions.flatMap { [$0.x, $0.y, $0.z] }.withUnsafeBufferPointer { Data(buffer: $0) }
+        let normalData = skinned.normals.flatMap { [$0.x, $0.y, $0.z] }.withUnsafeBufferPointer { Data(buffer: $0) }
+        
+        var accessors: [GLLVertexAttribAccessor] = [
+            GLLVertexAttribAccessor(semantic: .position, format: .float3, dataBuffer: positionData, offset: 0, stride: 3 * MemoryLayout<Float>.stride),
+            GLLVertexAttribAccessor(semantic: .normal, format: .float3, dataBuffer: normalData, offset: 0, stride: 3 * MemoryLayout<Float>.stride)
+        ]
+        for (layer, tangents) in skinned.tangents.enumerated() {
+            let tangentData = tangents.withUnsafeBufferPointer { Data(buffer: $0) }
+            accessors.append(GLLVertexAttribAccessor(semantic: .tangent0, layer: layer, format: .float4, dataBuffer: tangentData, offset: 0, stride: MemoryLayout<SIMD4<Float>>.stride))
+        }
+        
+        return vertexDataAccessors!.combining(with: GLLVertexAttribAccessorSet(accessors: accessors))
+    }
+}
@@ -0,0 +1,100 @@
+//
+//  GLLModelMesh+Welding.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import os
+
+extension GLLModelMesh {
+    
+    /**
+     * # Removes duplicate vertices, unused vertices and triangles without area.
+     *
+     * Vertices get merged if all their attributes, including the bones and their weights, are the same within GLLVertexWelder.defaultTolerance. Sets the new count of vertices and elements, and returns the vertex data that goes with them.
+     *
+     * This has to happen before the tangents get calculated. Tangents that are already in the file are not compared, since they get replaced anyway.
+     */
+    func weld(vertexData: GLLVertexAttribAccessorSet) -> GLLVertexAttribAccessorSet {
+        guard countOfVertices > 0 else {
+            return vertexData
+        }
+        
+        var vertices = GLLVertexWelder.Vertices(count: countOfVertices)
+        for accessor in vertexData.accessors where accessor.dataBuffer != nil {
+            switch (accessor.attribute.semantic, accessor.attribute.format) {
+            case (.tangent0, _), (.padding, _):
+                continue
+            case (.boneDataOffsetLength, _):
+                vertices.append(bytes: variableBoneDataIdentifiers(offsetLength: accessor), perVertex: 4)
+            case (_, .float), (_, .float2), (_, .float3), (_, .float4):
+                let components = accessor.attribute.sizeInBytes / MemoryLayout<Float>.stride
+                vertices.append(floats: weldingFloats(accessor, components: components), perVertex: components, tolerance: GLLVertexWelder.defaultTolerance)
+            default:
+                var bytes: [UInt8] = []
+                bytes.reserveCapacity(countOfVertices * accessor.attribute.sizeInBytes)
+                for vertex in 0 ..< countOfVertices {
+                    accessor.withBytes(element: vertex) { bytes.append(contentsOf: $0) }
+                }
+                vertices.append(bytes: bytes, perVertex: accessor.attribute.sizeInBytes)
+            }
+        }
+        
+        var positions: [SIMD3<Float>]? = nil
+        if let positionAccessor = vertexData.accessor(semantic: .position), positionAccessor.attribute.format == .float3 {
+            positions = positionAccessor.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        }
+        
+        let welder = GLLVertexWelder(vertices: vertices, indices: usedElements, positions: positions)
+        guard welder.statistics.changedAnything else {
+            return vertexData
+        }
+        GLLModelLoadingLog.debug("Welded \(self.name, privacy: .public): \(welder.statistics, privacy: .public)")
+        
+        let result = compactVertexData(vertexData, keeping: welder.vertices, into: self)
+        countOfVertices = welder.vertices.count
+        elementData = welder.indices.withUnsafeBufferPointer { Data(buffer: $0) }
+        elementSize = 4
+        countOfElements = welder.indices.count
+        return result
+    }
+    
+    private func weldingFloats(_ accessor: GLLVertexAttribAccessor, components: Int) -> [Float] {
+        var result: [Float] = []
+        result.reserveCapacity(countOfVertices * components)
+        for vertex in 0 ..< countOfVertices {
+            accessor.withBytes(element: vertex) { bytes in
+                for component in 0 ..< components {
+                    result.append(bytes.loadUnaligned(fromByteOffset: component * MemoryLayout<Float>.stride, as: Float.self))
+                }
+            }
+        }
+        return result
+    }
+    
+    private struct BoneList: Hashable {
+        var indices: ArraySlice<UInt16>
+        var weights: ArraySlice<Float>
+    }
+    
+    // The offsets into the variable bone data are different for every vertex, even if the bones are the same; so compare a number per distinct list of bones and weights instead.
+    private func variableBoneDataIdentifiers(offsetLength accessor: GLLVertexAttribAccessor) -> [UInt8] {
+        guard let indices = variableBoneIndices, let weights = variableBoneWeights else {
+            return Array(repeating: 0, count: countOfVertices * 4)
+        }
+        var identifiers: [BoneList: UInt32] = [:]
+        var result: [UInt8] = []
+        result.reserveCapacity(countOfVertices * 4)
+        for offsetLength in accessor.simdArray(count: countOfVertices, type: SIMD2<UInt16>.self) {
+            let range = Int(offsetLength.x) ..< Int(offsetLength.x) + Int(offsetLength.y)
+            let list = BoneList(indices: indices[range], weights: weights[range])
+            let identifier = identifiers[list] ?? UInt32(identifiers.count)
+            identifiers[list] = identifier
+            Swift.withUnsafeBytes(of: identifier) { result.append(contentsOf: $0) }
+        }
+        return result
+    }
+}
@@ -0,0 +1,250 @@
+//
+//  GLLModelMesh+XNALaraExport.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+extension GLLModelMesh {
+    
+    // Number of vertices or triangles that go into one chunk of the output
+    static let exportElementsPerChunk = 8192
+    
+    // Everything the XNALara formats store per vertex, as plain arrays
+    private struct ExportVertices {
+        var positions: [SIMD3<Float>]
+        var normals: [SIMD3<Float>]
+        var colors: [SIMD4<UInt8>]
+        // One array per UV layer
+        var texCoords: [[SIMD2<Float>]]
+        var tangents: [[SIMD4<Float>]]
+        // Empty if the mesh has no bone weights
+        var boneIndices: [SIMD4<UInt16>]
+        var boneWeights: [SIMD4<Float>]
+    }
+    
+    /**
+     * # The vertex data in the form the XNALara formats want.
+     *
+     * Reads each attribute in one go, so quantized data gets turned back into floats. If transforms are given, the positions, normals and tangents are skinned, after the morph targets with the given weights got added.
+     */
+    private func exportVertices(posedWith transforms: [matrix_float4x4]?, morphWeights: [Float]) -> ExportVertices {
+        let accessors = vertexDataAccessors!
+        let count = countOfVertices
+        
+        var positions: [SIMD3<Float>]
+        var normals: [SIMD3<Float>]
+        var tangents: [[SIMD4<Float>]]
+        if let transforms {
+            let skinned = cpuSkinner.skin(transforms: transforms, morphDeltas: morphDeltas(weights: morphWeights))
+            positions = skinned.positions
+            normals = skinned.normals
+            tangents = skinned.tangents
+        } else {
+            positions = accessors.accessor(semantic: .position)!.simdArray(count: count, type: SIMD3<Float>.self)
+            normals = accessors.accessor(semantic: .normal)!.simdArray(count: count, type: SIMD3<Float>.self)
+            tangents = []
+            for layer in 0 ..< countOfUVLayers {
+                guard let tangentAccessor = accessors.accessor(semantic: .tangent0, layer: layer), tangentAccessor.dataBuffer != nil else {
+                    break
+                }
+                tangents.append(tangentAccessor.simdArray(count: count, type: SIMD4<Float>.self))
+            }
+        }
+        // The file needs tangents for every layer; XNALara calculates its own anyway
+        while tangents.count < countOfUVLayers {
+            tangents.append(Array(repeating: SIMD4<Float>(), count: count))
+        }
+        
+        let texCoords = (0 ..< countOfUVLayers).map { layer in
+            accessors.accessor(semantic: .texCoord0, layer: layer)?.simdArray(count: count, type: SIMD2<Float>.self) ?? Array(repeating: SIMD2<Float>(), count: count)
+        }
+        
+        var boneIndices: [SIMD4<UInt16>] = []
+        var boneWeights: [SIMD4<Float>] = []
+        if hasBoneWeights {
+            (boneIndices, boneWeights) = exportBoneData
+        }
+        
+        return ExportVertices(positions: positions, normals: normals, colors: exportColors, texCoords: texCoords, tangents: tangents, boneIndices: boneIndices, boneWeights: boneWeights)
+    }
+    
+    // Colors as 8 bit values, whatever they are stored as. Also used for OBJ.
+    var exportColors: [SIMD4<UInt8>] {
+        guard let accessor = vertexDataAccessors!.accessor(semantic: .color) else {
+            return Array(repeating: SIMD4<UInt8>(repeating: 255), count: countOfVertices)
+        }
+        let format = accessor.attribute.format
+        if format == .uchar4Normalized || format == .uchar4 {
+            return accessor.simdArray(count: countOfVertices, type: SIMD4<UInt8>.self)
+        }
+        
+        let floats: [SIMD4<Float>]
+        if format == .float3 || accessor.attribute.normalizedComponents?.count == 3 {
+            floats = accessor.simdArray(count: countOfVertices, type: SIMD3<Float>.self).map { SIMD4<Float>($0, 1) }
+        } else {
+            floats = accessor.simdArray(count: countOfVertices, type: SIMD4<Float>.self)
+        }
+        return floats.map { SIMD4<UInt8>($0.clamped(lowerBound: SIMD4<Float>(repeating: 0), upperBound: SIMD4<Float>(repeating: 1)) * 255, rounding: .toNearestOrEven) }
+    }
+    
+    // Four bones per vertex. Meshes with variable bones per vertex keep their four strongest ones.
+    private var exportBoneData: ([SIMD4<UInt16>], [SIMD4<Float>]) {
+        switch cpuBoneData {
+        case .none:
+            return (Array(repeating: SIMD4<UInt16>(), count: countOfVertices), Array(repeating: SIMD4<Float>(1, 0, 0, 0), count: countOfVertices))
+        case .fixed(let indices, let weights):
+            return (indices, weights)
+        case .variable(let offsetLength, let indices, let weights):
+            var resultIndices: [SIMD4<UInt16>] = []
+            var resultWeights: [SIMD4<Float>] = []
+            resultIndices.reserveCapacity(countOfVertices)
+            resultWeights.reserveCapacity(countOfVertices)
+            for vertex in 0 ..< countOfVertices {
+                let range = Int(offsetLength[vertex].x) ..< Int(offsetLength[vertex].x) + Int(offsetLength[vertex].y)
+                var bestIndices = SIMD4<UInt16>()
+                var bestWeights = SIMD4<Float>()
+                for i in range {
+                    // Sorted insert into the four slots
+                    var slot = 4
+                    while slot > 0 && weights[i] > bestWeights[slot - 1] {
+                        slot -= 1
+                    }
+                    guard slot < 4 else {
+                        continue
+                    }
+                    for moved in stride(from: 3, to: slot, by: -1) {
+                        bestIndices[moved] = bestIndices[moved - 1]
+                        bestWeights[moved] = bestWeights[moved - 1]
+                    }
+                    bestIndices[slot] = indices[i]
+                    bestWeights[slot] = weights[i]
+                }
+                let sum = bestWeights.sum()
+                if sum > 0 {
+                    bestWeights /= sum
+                } else {
+                    bestIndices = SIMD4<UInt16>(range.isEmpty ? 0 : indices[range.lowerBound], 0, 0, 0)
+                    bestWeights = SIMD4<Float>(1, 0, 0, 0)
+                }
+                resultIndices.append(bestIndices)
+                resultWeights.append(bestWeights)
+            }
+            return (resultIndices, resultWeights)
+        }
+    }
+    
+    // Number of chunks for that many vertices or triangles
+    private static func exportChunkCount(_ count: Int) -> Int {
+        return (count + exportElementsPerChunk - 1) / exportElementsPerChunk
+    }
+    
+    private static func exportChunkRange(_ chunk: Int, count: Int) -> Range<Int> {
+        let start = chunk * exportElementsPerChunk
+        return start ..< min(start + exportElementsPerChunk, count)
+    }
+    
+    // Writes the mesh in XNALara's ASCII format. If transforms are given, the vertices are written in that pose and with the morph target weights instead of the bind pose.
+    func writeAscii(withName name: String, texture textures: [URL], posedWith transforms: [matrix_float4x4]? = nil, morphWeights: [Float] = [], to sink: GLLExportSink) throws {
+        let vertices = exportVertices(posedWith: transforms, morphWeights: morphWeights)
+        let count = countOfVertices
+        
+        try sink.write { chunk in
+            chunk.appendText("\(name)\n\(countOfUVLayers)\n\(textures.count)\n")
+            for texture in textures {
+                chunk.appendText("\(texture.lastPathComponent)\n0\n")
+            }
+            chunk.appendText("\(count)\n")
+        }
+        
+        try sink.writeChunks(count: GLLModelMesh.exportChunkCount(count)) { index, chunk in
+            for i in GLLModelMesh.exportChunkRange(index, count: count) {
+                chunk.appendLine(vertices.positions[i])
+                chunk.appendLine(vertices.normals[i])
+                chunk.appendLine(vertices.colors[i])
+                for layer in 0 ..< vertices.texCoords.count {
+                    chunk.appendLine(vertices.texCoords[layer][i])
+                }
+                if !vertices.boneIndices.isEmpty {
+                    chunk.appendLine(vertices.boneIndices[i])
+                    chunk.appendLine(vertices.boneWeights[i])
+                }
+            }
+        }
+        
+        // One triangle per line
+        let elements = usedElements
+        let triangles = elements.count / 3
+        try sink.write { $0.appendText("\(triangles)\n") }
+        try sink.writeChunks(count: GLLModelMesh.exportChunkCount(triangles)) { index, chunk in
+            for triangle in GLLModelMesh.exportChunkRange(index, count: triangles) {
+                chunk.appendLine(SIMD3<UInt32>(elements[triangle * 3], elements[triangle * 3 + 1], elements[triangle * 3 + 2]))
+            }
+        }
+    }
+    
+    // Writes the mesh in XNALara's binary format. If transforms are given, the vertices are written in that pose and with the morph target weights instead of the bind pose.
+    func writeBinary(withName name: String, texture textures: [URL], posedWith transforms: [matrix_float4x4]? = nil, morphWeights: [Float] = [], to sink: GLLExportSink) throws {
+        let vertices = exportVertices(posedWith: transforms, morphWeights: morphWeights)
+        let count = countOfVertices
+        
+        try sink.write { chunk in
+            chunk.appendPascalString(name)
+            chunk.append(UInt32(countOfUVLayers))
+            chunk.append(UInt32(textures.count))
+            for texture in textures {
+                chunk.appendPascalString(texture.lastPathComponent)
+                chunk.append(UInt32(0))
+            }
+            chunk.append(UInt32(count))
+        }
+        
+        // Position, normal, color, tex coords, tangents and optionally bones, one vertex after the other
+        let vertexSize = 12 + 12 + 4 + countOfUVLayers * (8 + 16) + (vertices.boneIndices.isEmpty ? 0 : 8 + 16)
+        try sink.writeChunks(count: GLLModelMesh.exportChunkCount(count)) { index, chunk in
+            let range = GLLModelMesh.exportChunkRange(index, count: count)
+            chunk.reserveCapacity(range.count * vertexSize)
+            for i in range {
+                let position = vertices.positions[i]
+                chunk.append(position.x)
+                chunk.append(position.y)
+                chunk.append(position.z)
+                let normal = vertices.normals[i]
+                chunk.append(normal.x)
+                chunk.append(normal.y)
+                chunk.append(normal.z)
+                withUnsafeBytes(of: vertices.colors[i]) { chunk.append(contentsOf: $0) }
+                for layer in 0 ..< vertices.texCoords.count {
+                    let texCoord = vertices.texCoords[layer][i]
+                    chunk.append(texCoord.x)
+                    chunk.append(texCoord.y)
+                }
+                for layer in 0 ..< vertices.tangents.count {
+                    let tangent = vertices.tangents[layer][i]
+                    chunk.append(tangent.x)
+                    chunk.append(tangent.y)
+                    chunk.append(tangent.z)
+                    chunk.append(tangent.w)
+                }
+                if !vertices.boneIndices.isEmpty {
+                    let boneIndices = vertices.boneIndices[i]
+                    for component in 0 ..< 4 {
+                        chunk.append(boneIndices[component])
+                    }
+                    let boneWeights = vertices.boneWeights[i]
+                    for component in 0 ..< 4 {
+                        chunk.append(boneWeights[component])
+                    }
+                }
+            }
+        }
+        
+        let elements = usedElements
+        let triangles = elements.count / 3
+        try sink.write { $0.append(UInt32(triangles)) }
+        try elements.withUnsafeBytes { try sink.write(UnsafeRawBufferPointer(rebasing: $0[0 ..< triangles * 3 * MemoryLayout<UInt32>.stride])) }
+    }
+}
@@ -124,11 +124,13 @@ import simd
         try validate(vertexData: fileAccessors!, indexData: elementData)
         
         // Always recalculate tangents, the ones in the model file can be 0
-        let tangents = calculateTangents(for: fileAccessors!)
-        vertexDataAccessors = fileAccessors!.combining(with: tangents)
+        setVertexDataDeferringTangents(weld(vertexData: fileAccessors!))
         
-        vertexFormat = vertexDataAccessors!.vertexFormat(vertexCount: countOfVertices, hasIndices: true)
+        updateVertexFormat()
         loadRenderParameters()
+        if initiallyVisible {
+            finishDeferredProcessing()
+        }
         
         fileAccessors = nil
     }
@@ -258,9 +260,8 @@ import simd
         
         try validate(vertexData: fileAccessors, indexData: elementData!)
         
-        let tangents = calculateTangents(for: fileAccessors)
-        vertexDataAccessors = fileAccessors.combining(with: tangents)
-        vertexFormat = vertexDataAccessors!.vertexFormat(vertexCount: countOfVertices, hasIndices: true)
+        setVertexDataDeferringTangents(weld(vertexData: fileAccessors))
+        updateVertexFormat()
         
         guard scanner.isValid else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [ NSLocalizedDescriptionKey : NSLocalizedString("The file is missing some data.", comment: "Premature end of file error"),
@@ -268,6 +269,9 @@ import simd
         }
         
         loadRenderParameters()
+        if initiallyVisible {
+            finishDeferredProcessing()
+        }
     }
     
     @objc weak var model: GLLModel?
@@ -286,9 +290,70 @@ import simd
      * Vertex buffer
      */
     @objc var countOfVertices: Int = 0
-    @objc var vertexDataAccessors: GLLVertexAttribAccessorSet?
+    @objc var vertexDataAccessors: GLLVertexAttribAccessorSet? {
+        get {
+            return deferredProcessingLock.withLock {
+                if needsTangents, let accessors = storedVertexDataAccessors {
+                    storedVertexDataAccessors = accessors.combining(with: calculateTangents(for: accessors))
+                    needsTangents = false
+                }
+                return storedVertexDataAccessors
+            }
+        }
+        set {
+            deferredProcessingLock.withLock {
+                storedVertexDataAccessors = newValue
+                needsTangents = false
+            }
+        }
+    }
+    
+    /*
+     * Meshes that start out hidden, of which some models have dozens, only get their tangents calculated once something needs the vertex data, usually because they get shown. Until then, the vertex data has tangent attributes without any data, so the format, shader, bounds and bone palette can be set up as usual.
+     */
+    private var storedVertexDataAccessors: GLLVertexAttribAccessorSet?
+    private var needsTangents = false
+    private let deferredProcessingLock = NSLock()
+    
+    // The vertex data without doing the deferred processing. Everything but the tangents is final.
+    var vertexDataLayout: GLLVertexAttribAccessorSet? {
+        return deferredProcessingLock.withLock { storedVertexDataAccessors }
+    }
+    
+    var hasDeferredProcessing: Bool {
+        return deferredProcessingLock.withLock { needsTangents }
+    }
+    
+    func setVertexDataDeferringTangents(_ accessors: GLLVertexAttribAccessorSet) {
+        let placeholders = (0 ..< countOfUVLayers).map { layer in
+            GLLVertexAttribAccessor(semantic: .tangent0, layer: layer, format: .float4, dataBuffer: nil, offset: 0, stride: MemoryLayout<SIMD4<Float>>.stride)
+        }
+        deferredProcessingLock.withLock {
+            storedVertexDataAccessors = accessors.combining(with: GLLVertexAttribAccessorSet(accessors: placeholders))
+            needsTangents = true
+        }
+    }
     
+    // Does whatever was deferred. Can be called from any thread, any number of times.
+    func finishDeferredProcessing() {
+        _ = vertexDataAccessors
+    }
+    
+    // The format used for drawing; bone indices in it are local to bonePalette
     var vertexFormat: GLLVertexFormat?
+    // Set if vertexFormat is quantized
+    var quantization: GLLVertexQuantization?
+    var bonePalette = GLLBonePalette()
+    // Bounds for culling; nil if there are no positions
+    var bounds: GLLMeshBounds? = nil
+    // Simplified versions that use the same vertices, from most to least detailed. Empty if there are none.
+    var levelsOfDetail: [GLLMeshSimplifier.Level] = []
+    // Only for large meshes; the elements are in the order of the meshlets
+    var meshlets: GLLMeshlets? = nil
+    // Blend shapes, e.g. from glTF; nil if there are none
+    var morphTargets: GLLMorphTargetSet? = nil
+    // Weights that the file asks for by default, one per target. Each item mesh starts out with these.
+    @objc var morphWeights: [Float] = []
     
     // Element data. Arranged as triangles, often but not necessarily UInt32
     var elementData: Data?
@@ -316,6 +381,17 @@ import simd
         return countOfElements
     }
     
+    // All elements that elementAt would return, at once
+    var usedElements: [UInt32] {
+        guard let elementData else {
+            return (0 ..< UInt32(countOfVertices)).map { $0 }
+        }
+        if elementSize == 4 {
+            return elementData.withUnsafeBytes { Array($0.bindMemory(to: UInt32.self).prefix(countOfElements)) }
+        }
+        return (0 ..< countOfElements).map { UInt32(element(at: $0)) }
+    }
+    
     var countOfUVLayers: Int = 0
     var hasBoneWeights: Bool {
         return self.model?.hasBones ?? false
@@ -335,52 +411,105 @@ import simd
     var variableBoneWeights: [Float]? = nil
     
     /*
-     * XNALara insists that some meshes need to be split; apparently only for cosmetic reasons. I shall oblige, but in a way that is not specific to exactly one thing, thank you very much. Note that this mesh keeps the bone indices of the original.
+     * XNALara insists that some meshes need to be split; apparently only for cosmetic reasons. I shall oblige, but in a way that is not specific to exactly one thing, thank you very much. Note that the parts keep the bone indices of the original.
+     *
+     * All splitters get handled in one pass over the triangles, and every part only gets the vertices its triangles actually use.
      */
-    func partialMesh(fromSplitter splitter: GLLMeshSplitter) -> GLLModelMesh {
-        var newElements = Data()
-        
-        let positionData = vertexDataAccessors!.accessor(semantic: .position)!
-        
-        for triangle in 0..<(countOfUsedElements/3) {
-            let index = triangle * 3
-            
-            let min = splitter.minSimd
-            let max = splitter.maxSimd
-            
-            // Find out if one corner is completely in the box. If yes, then this triangle becomes part of the split mesh.
-            var anyCornerInBox = false
-            for i in 0..<3 {
-                let corner = positionData.simd3Element(at: element(at: index + i), base: Float32.self)
-                if all(corner .>= min .& corner .<= max) {
-                    anyCornerInBox = true
-                }
+    func partialMeshes(fromSplitters splitters: [GLLMeshSplitter]) -> [GLLModelMesh] {
+        let positions = vertexDataLayout!.accessor(semantic: .position)!.simdArray(count: countOfVertices, type: SIMD3<Float>.self)
+        let boxes = splitters.map { GLLBoundingBox(min: $0.minSimd, max: $0.maxSimd) }
+        let partition = GLLMeshPartition(positions: positions, indices: usedElements, boxes: boxes)
+        
+        return zip(splitters, partition.parts).map { splitter, part in
+            let result = GLLModelMesh(asPartOfModel: model!)
+            result.countOfUVLayers = countOfUVLayers
+            let vertexData = compactVertexData(vertexDataLayout!, keeping: part.vertices, into: result)
+            if hasDeferredProcessing {
+                // Tangents only from the triangles of this part
+                result.setVertexDataDeferringTangents(vertexData)
+            } else {
+                result.vertexDataAccessors = vertexData
             }
+            result.countOfVertices = part.vertices.count
+            result.elementData = part.indices.withUnsafeBufferPointer { Data(buffer: $0) }
+            result.elementSize = 4
+            result.countOfElements = part.indices.count
+            result.versionCode = versionCode
+            result.updateVertexFormat()
             
-            if !anyCornerInBox {
-                continue
+            result.name = splitter.splitPartName
+            result.textures = self.textures
+            result.loadRenderParameters() // Result may have different mesh group or shader. In fact, for the one and only object class where this entire feature is needed, this is guaranteed.
+            return result
+        }
+    }
+    
+    // Copies the given vertices, in that order, into new vertex data for the other mesh (which may be this one), and sets its variable bone data. Attributes that share a buffer here still share one there. Tangents that have not been calculated yet stay that way.
+    func compactVertexData(_ original: GLLVertexAttribAccessorSet, keeping vertices: [UInt32], into result: GLLModelMesh) -> GLLVertexAttribAccessorSet {
+        var buffers: [(data: Data, stride: Int, base: Int)] = []
+        var compactedBuffers: [Data] = []
+        let bufferIndices = original.accessors.map { accessor -> Int? in
+            guard let data = accessor.dataBuffer else {
+                return nil
+            }
+            if let existing = buffers.firstIndex(where: { $0.stride == accessor.stride && $0.data == data }) {
+                return existing
             }
             
-            for corner in 0..<3 {
-                let index = element(at: index + corner)
-                _ = Swift.withUnsafeBytes(of: index) {
-                    newElements.append(contentsOf: $0)
+            // Copy whole vertices, starting from the first attribute in the buffer
+            let base = original.accessors.filter { $0.stride == accessor.stride && $0.dataBuffer == data }.map { $0.dataOffset }.min()!
+            var compacted = Data(count: vertices.count * accessor.stride)
+            compacted.withUnsafeMutableBytes { target in
+                data.withUnsafeBytes { source in
+                    for (newIndex, vertex) in vertices.enumerated() {
+                        let start = base + Int(vertex) * accessor.stride
+                        let length = min(accessor.stride, source.count - start)
+                        target.baseAddress!.advanced(by: newIndex * accessor.stride).copyMemory(from: source.baseAddress!.advanced(by: start), byteCount: length)
+                    }
                 }
             }
+            buffers.append((data, accessor.stride, base))
+            compactedBuffers.append(compacted)
+            return buffers.count - 1
         }
         
-        let result = GLLModelMesh(asPartOfModel: model!)
-        result.vertexFormat = vertexFormat
-        result.vertexDataAccessors = vertexDataAccessors
-        result.countOfVertices = countOfVertices
-        result.elementData = newElements
-        result.countOfElements = newElements.count / 4
+        // Variable bone data only keeps what the remaining vertices use, too
+        if let offsetLengthIndex = original.accessors.firstIndex(where: { $0.attribute.semantic == .boneDataOffsetLength }), let bufferIndex = bufferIndices[offsetLengthIndex], let boneIndices = variableBoneIndices, let boneWeights = variableBoneWeights {
+            let accessor = original.accessors[offsetLengthIndex]
+            let offset = accessor.dataOffset - buffers[bufferIndex].base
+            var newIndices: [UInt16] = []
+            var newWeights: [Float] = []
+            compactedBuffers[bufferIndex].withUnsafeMutableBytes { bytes in
+                for vertex in 0 ..< vertices.count {
+                    let offsetLength = bytes.baseAddress!.advanced(by: offset + vertex * accessor.stride)
+                    let start = Int(offsetLength.loadUnaligned(as: UInt16.self))
+                    let length = Int(offsetLength.loadUnaligned(fromByteOffset: 2, as: UInt16.self))
+                    offsetLength.storeBytes(of: UInt16(newIndices.count), as: UInt16.self)
+                    newIndices.append(contentsOf: boneIndices[start ..< start + length])
+                    newWeights.append(contentsOf: boneWeights[start ..< start + length])
+                }
+            }
+            result.variableBoneIndices = newIndices
+            result.variableBoneWeights = newWeights
+        }
         
-        result.countOfUVLayers = countOfUVLayers
-        result.name = splitter.splitPartName
-        result.textures = self.textures
-        result.loadRenderParameters() // Result may have different mesh group or shader. In fact, for the one and only object class where this entire feature is needed, this is guaranteed.
-        return result
+        return GLLVertexAttribAccessorSet(accessors: zip(original.accessors, bufferIndices).map { accessor, bufferIndex in
+            guard let bufferIndex else {
+                return accessor
+            }
+            return GLLVertexAttribAccessor(attribute: accessor.attribute, dataBuffer: compactedBuffers[bufferIndex], offset: accessor.dataOffset - buffers[bufferIndex].base, stride: accessor.stride)
+        })
+    }
+    
+    // Size of all vertex buffers, as they get uploaded for drawing
+    var vertexDataSize: Int {
+        var buffers: [Data] = []
+        for accessor in vertexDataLayout?.accessors ?? [] {
+            if let data = accessor.dataBuffer, !buffers.contains(data) {
+                buffers.append(data)
+            }
+        }
+        return buffers.reduce(0) { $0 + $1.count } + (variableBoneIndices?.count ?? 0) * MemoryLayout<UInt16>.stride + (variableBoneWeights?.count ?? 0) * MemoryLayout<Float>.stride
     }
     
     /*
@@ -507,102 +636,6 @@ import simd
         return .counterClockWise
     }
     
-    @objc func writeAscii(withName name: String, texture textures: [URL]) -> String {
-        let positionAccessor = vertexDataAccessors!.accessor(semantic: .position)!
-        let normalAccessor = vertexDataAccessors!.accessor(semantic: .normal)!
-        let colorAccessor = vertexDataAccessors!.accessor(semantic: .color)!
-        let boneIndexAccessor = vertexDataAccessors!.accessor(semantic: .boneIndices)
-        let boneWeightAccessor = vertexDataAccessors!.accessor(semantic: .boneWeights)
-        
-        var result = ""
-        result.append("\(name)\n")
-        result.append("\(countOfUVLayers)\n")
-        result.append("\(textures.count)\n")
-        for texture in textures {
-            result.append("\(texture.lastPathComponent)\n0\n")
-        }
-        
-        result.append("\(countOfVertices)")
-        for i in 0..<countOfVertices {
-            let position = positionAccessor.typedElementArray(at: i, type: Float32.self)
-            result.append("\(position[0]) \(position[1]) \(position[2])\n")
-            let normal = normalAccessor.typedElementArray(at: i, type: Float32.self)
-            result.append("\(normal[0]) \(normal[1]) \(normal[2])\n")
-            let colors = colorAccessor.typedElementArray(at: i, type: UInt8.self)
-            result.append("\(colors[0]) \(colors[1]) \(colors[2]) \(colors[3])\n")
-            
-            for uvLayer in 0..<countOfUVLayers {
-                let texCoordAccessor = vertexDataAccessors!.accessor(semantic: .texCoord0, layer: uvLayer)!
-                
-                let texCoords = texCoordAccessor.typedElementArray(at: uvLayer, type: Float32.self)
-                result.append("\(texCoords[0]) \(texCoords[1])\n")
-            }
-            if hasBoneWeights {
-                let boneIndices = boneIndexAccessor!.typedElementArray(at: i, type: UInt16.self)
-                result.append("\(boneIndices[0]) \(boneIndices[1]) \(boneIndices[2]) \(boneIndices[3])\n")
-                let boneWeights = boneWeightAccessor!.typedElementArray(at: i, type: Float32.self)
-                result.append("\(boneWeights[0]) \(boneWeights[1]) \(boneWeights[2]) \(boneWeights[3])\n")
-            }
-            result.append("\n")
-        }
-        
-        result.append("\(countOfUsedElements/3)\n")
-        for i in 0..<countOfUsedElements {
-            result.append("\(element(at: i))")
-        }
-        result.append("\n")
-        
-        return result
-    }
-    @objc func writeBinary(withName name: String, texture textures: [URL]) -> Data {
-        let stream = TROutDataStream()
-        stream.appendPascalString(name)
-        stream.appendUint32(UInt32(countOfUVLayers))
-        stream.appendUint32(UInt32(textures.count))
-        
-        for texture in textures {
-            stream.appendPascalString(texture.lastPathComponent)
-            stream.appendUint32(0)
-        }
-        
-        stream.appendUint32(UInt32(countOfVertices))
-        if hasTangentsInFile {
-            // Just put it out directly
-            stream.appendData(vertexDataAccessors!.accessors.first!.dataBuffer)
-        } else {
-            // Long way round: Combine all the elements, no matter where they're from
-            let positionData = vertexDataAccessors!.accessor(semantic: .position)!
-            let normalData = vertexDataAccessors!.accessor(semantic: .normal)!
-            let colorData = vertexDataAccessors!.accessor(semantic: .color)!
-            let boneIndexData = vertexDataAccessors!.accessor(semantic: .boneIndices)
-            let boneWeightData = vertexDataAccessors!.accessor(semantic: .boneWeights)
-
-            for i in 0..<countOfVertices {
-                stream.appendData(positionData.elementData(at: i))
-                stream.appendData(positionData.elementData(at: i))
-                stream.appendData(normalData.elementData(at: i))
-                stream.appendData(colorData.elementData(at: i))
-                for layer in 0..<countOfUVLayers {
-                    let texCoordData = vertexDataAccessors!.accessor(semantic: .texCoord0, layer:layer)!
-                    stream.appendData(texCoordData.elementData(at: i))
-                }
-                for layer in 0..<countOfUVLayers {
-                    let tangentData = vertexDataAccessors!.accessor(semantic: .tangent0, layer:layer)!
-                    stream.appendData(tangentData.elementData(at: i))
-                }
-                if let boneIndexData = boneIndexData, let boneWeightData = boneWeightData {
-                    stream.appendData(boneIndexData.elementData(at: i))
-                    stream.appendData(boneWeightData.elementData(at: i))
-                }
-            }
-        }
-        stream.appendUint32(UInt32(countOfUsedElements/3))
-        for i in 0..<countOfUsedElements {
-            stream.appendUint32(UInt32(element(at: i)))
-        }
-        return stream.data()
-    }
-    
     // Finalize loading. In particular, load render parameters.
     private func loadRenderParameters() {
         let meshParams = model!.parameters.params(forMesh: name)
@@ -619,7 +652,7 @@ import simd
             initiallyVisible = false
             return
         }
-        shader = model!.parameters.shader(xnaData: xnaLaraShaderData, vertexAccessors: vertexDataAccessors!, alphaBlending: usesAlphaBlending)
+        shader = model!.parameters.shader(xnaData: xnaLaraShaderData, vertexAccessors: vertexDataLayout!, alphaBlending: usesAlphaBlending)
         
         if shader == nil {
             print("No shader for \(name), using default")
@@ -14,15 +14,16 @@ class GLLModelMeshObj: GLLModelMesh {
         countOfUVLayers = 1
         
         self.countOfVertices = countOfVertices
-        
-        let tangents = calculateTangents(for: fileVertexAccessors)
-        vertexDataAccessors = fileVertexAccessors.combining(with: tangents)
-        
         self.elementData = elementData
         self.countOfElements = elementData.count / 4
         
+        // Tangents need the final elements
+        let vertexData = weld(vertexData: fileVertexAccessors)
+        let tangents = calculateTangents(for: vertexData)
+        vertexDataAccessors = vertexData.combining(with: tangents)
+        
         // Previous actions may have disturbed vertex format (because it also depends on count of vertices) so uncache it.
-        vertexFormat = vertexDataAccessors!.vertexFormat(vertexCount: countOfVertices, hasIndices: true)
+        updateVertexFormat()
         
         // Setup material
         // Three options: Diffuse, DiffuseSpecular, DiffuseNormal, DiffuseSpecularNormal
@@ -7,6 +7,7 @@
 //
 
 import Foundation
+import os
 
 class GLLModelXNALara: GLLModel {
     convenience init(binaryFromFile file: URL!, parent: GLLModel!) throws {
@@ -114,17 +115,7 @@ class GLLModelXNALara: GLLModel {
             }
         }
         
-        var splitMeshes: [GLLModelMesh] = []
-        splitMeshes.reserveCapacity(unprocessedMeshes.count)
-        for mesh in unprocessedMeshes {
-            let params = self.parameters.params(forMesh: mesh.name)
-            if params.splitters.isEmpty {
-                splitMeshes.append(mesh)
-            } else {
-                splitMeshes.append(contentsOf: params.splitters.map { mesh.partialMesh(fromSplitter: $0) })
-            }
-        }
-        self.meshes = splitMeshes
+        self.meshes = unprocessedMeshes.flatMap { split(mesh: $0) }
         
         guard stream.isValid else {
             throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.prematureEndOfFile.rawValue), userInfo: [
@@ -175,12 +166,7 @@ class GLLModelXNALara: GLLModel {
         var meshes: [GLLModelMesh] = []
         for _ in 0..<numMeshes {
             let mesh = try GLLModelMesh(fromScanner: scanner, partOfModel: self)
-            let params = self.parameters.params(forMesh: mesh.name)
-            if params.splitters.isEmpty {
-                meshes.append(mesh)
-            } else {
-                meshes.append(contentsOf: params.splitters.map { mesh.partialMesh(fromSplitter: $0) })
-            }
+            meshes.append(contentsOf: split(mesh: mesh))
         }
         self.meshes = meshes
         
@@ -192,6 +178,21 @@ class GLLModelXNALara: GLLModel {
         }
     }
     
+    // Applies the mesh splitters from the model parameters, if there are any for this mesh
+    private func split(mesh: GLLModelMesh) -> [GLLModelMesh] {
+        let splitters = self.parameters.params(forMesh: mesh.name).splitters
+        if splitters.isEmpty {
+            return [mesh]
+        }
+        
+        let parts = mesh.partialMeshes(fromSplitters: splitters)
+        // Before, every part had all of the vertices
+        let sharedSize = mesh.vertexDataSize * parts.count
+        let compactedSize = parts.reduce(0) { $0 + $1.vertexDataSize }
+        GLLModelLoadingLog.debug("Split \(mesh.name, privacy: .public) into \(parts.count) parts with \(compactedSize) bytes of vertex data, saving \(sharedSize - compactedSize) bytes")
+        return parts
+    }
+    
     func assignBoneChildren() throws {
         for i in 0 ..< bones.count {
             let bone = bones[i]
@@ -219,16 +220,10 @@ class GLLModelXNALara: GLLModel {
             parent.children.append(bone)
         }
         
-        for bone in bones {
-            var ancestor: GLLModelBone? = bone.parent
-            while ancestor != nil {
-                if ancestor == bone {
-                    throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.circularReference.rawValue), userInfo: [
-                        NSLocalizedDescriptionKey : String(format:NSLocalizedString("Bone \"%@\" has itself as an ancestor.", comment: "Found a circle in the bone relationships."), bone.name),
-                        NSLocalizedRecoverySuggestionErrorKey : NSLocalizedString("The bones would form an infinite loop.", comment: "Found a circle in a bone relationship")])
-                }
-                ancestor = ancestor?.parent
-            }
+        if let boneIndex = skeletonIndex.boneInCycle {
+            throw NSError(domain: GLLModelLoadingErrorDomain, code: Int(GLLModelLoadingErrorCode.circularReference.rawValue), userInfo: [
+                NSLocalizedDescriptionKey : String(format:NSLocalizedString("Bone \"%@\" has itself as an ancestor.", comment: "Found a circle in the bone relationships."), bones[boneIndex].name),
+                NSLocalizedRecoverySuggestionErrorKey : NSLocalizedString("The bones would form an infinite loop.", comment: "Found a circle in a bone relationship")])
         }
     }
 }
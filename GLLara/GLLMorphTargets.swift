@@ -0,0 +1,184 @@
+//
+//  GLLMorphTargets.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # The morph targets (blend shapes) of a mesh.
+ *
+ * A target moves some vertices by a fixed offset, scaled by its weight; the result is the base mesh plus the weighted sum of all targets. Facial expressions usually move only a small part of a mesh, so each target only stores the vertices that it moves, as 16 bit integers relative to its largest offset.
+ *
+ * Evaluating works on chunks of vertices on all cores. Every target knows where its vertices for each chunk start, so the chunks don't have to search, and targets with a weight of zero get skipped entirely. It does not depend on Metal; the result gets added to the vertices before skinning.
+ */
+final class GLLMorphTargetSet {
+    struct Target {
+        let name: String
+        // Ascending
+        let indices: [UInt32]
+        let positionOffsets: [SIMD3<Int16>]
+        // Empty if the target doesn't change normals
+        let normalOffsets: [SIMD3<Int16>]
+        // From the integers back to the offsets
+        let positionScale: Float
+        let normalScale: Float
+        // Length of the longest position offset, so culling knows how far the target can move the mesh
+        let largestPositionOffset: Float
+        // Where in indices the vertices of each chunk start, plus the end
+        fileprivate let chunkStarts: [Int]
+        
+        /**
+         * # Builds a target from offsets for all vertices.
+         *
+         * Vertices whose offsets are zero after quantization get left out. Normal offsets can be empty.
+         */
+        init(name: String, positionOffsets: [SIMD3<Float>], normalOffsets: [SIMD3<Float>] = []) {
+            precondition(normalOffsets.isEmpty || normalOffsets.count == positionOffsets.count)
+            self.name = name
+            
+            let positionScale = Target.scale(for: positionOffsets)
+            let normalScale = Target.scale(for: normalOffsets)
+            var indices: [UInt32] = []
+            var quantizedPositions: [SIMD3<Int16>] = []
+            var quantizedNormals: [SIMD3<Int16>] = []
+            for vertex in 0 ..< positionOffsets.count {
+                let position = Target.quantize(positionOffsets[vertex], scale: positionScale)
+                let normal = normalOffsets.isEmpty ? SIMD3<Int16>() : Target.quantize(normalOffsets[vertex], scale: normalScale)
+                if position == SIMD3<Int16>() && normal == SIMD3<Int16>() {
+                    continue
+                }
+                indices.append(UInt32(vertex))
+                quantizedPositions.append(position)
+                if !normalOffsets.isEmpty {
+                    quantizedNormals.append(normal)
+                }
+            }
+            self.indices = indices
+            self.positionOffsets = quantizedPositions
+            self.normalOffsets = quantizedNormals
+            self.positionScale = positionScale
+            self.normalScale = normalScale
+            self.largestPositionOffset = quantizedPositions.reduce(Float(0)) { Swift.max($0, simd_length(SIMD3<Float>($1))) } * positionScale
+            
+            let chunks = (positionOffsets.count + GLLMorphTargetSet.verticesPerChunk - 1) / GLLMorphTargetSet.verticesPerChunk
+            var chunkStarts: [Int] = []
+            chunkStarts.reserveCapacity(chunks + 1)
+            var position = 0
+            for chunk in 0 ..< chunks {
+                while position < indices.count && Int(indices[position]) < chunk * GLLMorphTargetSet.verticesPerChunk {
+                    position += 1
+                }
+                chunkStarts.append(position)
+            }
+            chunkStarts.append(indices.count)
+            self.chunkStarts = chunkStarts
+        }
+        
+        // Number of vertices that this target moves
+        var count: Int {
+            return indices.count
+        }
+        
+        private static func scale(for offsets: [SIMD3<Float>]) -> Float {
+            let largest = offsets.reduce(Float(0)) { Swift.max($0, simd_reduce_max(simd_abs($1))) }
+            return largest > 0 ? largest / Float(Int16.max) : 1
+        }
+        
+        private static func quantize(_ offset: SIMD3<Float>, scale: Float) -> SIMD3<Int16> {
+            return SIMD3<Int16>(offset / scale, rounding: .toNearestOrEven)
+        }
+    }
+    
+    /**
+     * # The summed offsets of all targets for every vertex.
+     *
+     * Keep one per item and pass it in again and again; evaluating then doesn't allocate anything.
+     */
+    struct Deltas {
+        var positions: [SIMD3<Float>]
+        var normals: [SIMD3<Float>]
+        
+        init(countOfVertices: Int) {
+            positions = Array(repeating: SIMD3<Float>(), count: countOfVertices)
+            normals = Array(repeating: SIMD3<Float>(), count: countOfVertices)
+        }
+    }
+    
+    let countOfVertices: Int
+    let targets: [Target]
+    
+    // Same reasoning as for the CPU skinner
+    static let verticesPerChunk = 4096
+    
+    init(countOfVertices: Int, targets: [Target]) {
+        precondition(targets.allSatisfy { $0.chunkStarts.count == (countOfVertices + GLLMorphTargetSet.verticesPerChunk - 1) / GLLMorphTargetSet.verticesPerChunk + 1 })
+        self.countOfVertices = countOfVertices
+        self.targets = targets
+    }
+    
+    // One weight per target. Overwrites everything in deltas.
+    func evaluate(weights: [Float], into deltas: inout Deltas) {
+        precondition(weights.count == targets.count)
+        if deltas.positions.count != countOfVertices || deltas.normals.count != countOfVertices {
+            deltas = Deltas(countOfVertices: countOfVertices)
+        }
+        
+        let active = targets.indices.filter { weights[$0] != 0 }
+        let chunks = (countOfVertices + GLLMorphTargetSet.verticesPerChunk - 1) / GLLMorphTargetSet.verticesPerChunk
+        deltas.positions.withUnsafeMutableBufferPointer { positions in
+            deltas.normals.withUnsafeMutableBufferPointer { normals in
+                DispatchQueue.concurrentPerform(iterations: chunks) { chunk in
+                    let start = chunk * GLLMorphTargetSet.verticesPerChunk
+                    let end = min(start + GLLMorphTargetSet.verticesPerChunk, countOfVertices)
+                    for vertex in start ..< end {
+                        positions[vertex] = SIMD3<Float>()
+                        normals[vertex] = SIMD3<Float>()
+                    }
+                    for target in active {
+                        accumulate(target: targets[target], weight: weights[target], chunk: chunk, positions: positions, normals: normals)
+                    }
+                }
+            }
+        }
+    }
+    
+    // The furthest that the targets with these weights can move any vertex. The sum of the largest offsets, so it is conservative, but it does not need the deltas.
+    func maximumPositionDelta(weights: [Float]) -> Float {
+        precondition(weights.count == targets.count)
+        return zip(targets, weights).reduce(Float(0)) { $0 + abs($1.1) * $1.0.largestPositionOffset }
+    }
+    
+    // Convenience for a single evaluation
+    func evaluate(weights: [Float]) -> Deltas {
+        var deltas = Deltas(countOfVertices: countOfVertices)
+        evaluate(weights: weights, into: &deltas)
+        return deltas
+    }
+    
+    private func accumulate(target: Target, weight: Float, chunk: Int, positions: UnsafeMutableBufferPointer<SIMD3<Float>>, normals: UnsafeMutableBufferPointer<SIMD3<Float>>) {
+        let range = target.chunkStarts[chunk] ..< target.chunkStarts[chunk + 1]
+        // The weight and the scale in one factor
+        let positionFactor = weight * target.positionScale
+        let normalFactor = weight * target.normalScale
+        target.indices.withUnsafeBufferPointer { indices in
+            target.positionOffsets.withUnsafeBufferPointer { offsets in
+                for i in range {
+                    positions[Int(indices[i])] += SIMD3<Float>(offsets[i]) * positionFactor
+                }
+            }
+            guard !target.normalOffsets.isEmpty else {
+                return
+            }
+            target.normalOffsets.withUnsafeBufferPointer { offsets in
+                for i in range {
+                    normals[Int(indices[i])] += SIMD3<Float>(offsets[i]) * normalFactor
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+//
+//  GLLObjWriter.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # The vertex and face lines of OBJ files.
+ *
+ * Works on plain arrays and writes into export chunks, so it can run for several meshes at once and does not need a model. Floats use the export chunk's shortest round-trip text.
+ */
+enum GLLObjWriter {
+    /**
+     * # Writes v, vn, vt and optionally vc lines for every vertex.
+     *
+     * Texture coordinates get flipped vertically, so the images don't have to be. Colors are optional; if they are empty, there are no vc lines.
+     */
+    static func appendVertices(positions: [SIMD3<Float>], normals: [SIMD3<Float>], texCoords: [SIMD2<Float>], colors: [SIMD4<UInt8>] = [], to chunk: inout GLLExportSink.Chunk) {
+        precondition(normals.count == positions.count && texCoords.count == positions.count)
+        precondition(colors.isEmpty || colors.count == positions.count)
+        for i in 0 ..< positions.count {
+            chunk.appendText("v ")
+            chunk.appendLine(positions[i])
+            chunk.appendText("vn ")
+            chunk.appendLine(normals[i])
+            chunk.appendText("vt ")
+            chunk.appendLine(SIMD2<Float>(texCoords[i].x, 1 - texCoords[i].y))
+            if !colors.isEmpty {
+                chunk.appendText("vc ")
+                chunk.appendLine(SIMD4<Float>(colors[i]) / 255)
+            }
+        }
+    }
+    
+    /**
+     * # Writes an f line for each triangle.
+     *
+     * OBJ indices start at 1 and count the vertices of all earlier meshes, which baseIndex says. The corners get written in the order 0, 2, 1. Every corner uses the same index for position, texture coordinate, normal and (if there are colors) color.
+     */
+    static func appendFaces(elements: ArraySlice<UInt32>, baseIndex: Int, includeColors: Bool, to chunk: inout GLLExportSink.Chunk) {
+        let references = includeColors ? 4 : 3
+        func appendCorner(_ element: UInt32) {
+            let index = Int(element) + baseIndex + 1
+            for reference in 0 ..< references {
+                chunk.appendText(reference == 0 ? " " : "/")
+                chunk.appendText(index)
+            }
+        }
+        
+        var triangle = elements.startIndex
+        while triangle + 2 < elements.endIndex {
+            chunk.appendText("f")
+            appendCorner(elements[triangle])
+            appendCorner(elements[triangle + 2])
+            appendCorner(elements[triangle + 1])
+            chunk.appendText("\n")
+            triangle += 3
+        }
+    }
+}
@@ -0,0 +1,43 @@
+//
+//  GLLPositionalLight.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import CoreData
+
+/**
+ * @abstract A point or spot light that the user placed in the scene.
+ * @discussion Scenes can have any number of them. They are not part of the
+ * normal light buffer; the scene drawer sorts the enabled ones into clusters
+ * of the view instead. Angles are in radians, like for the directional
+ * lights, and the spot angle is the full opening angle of the cone.
+ */
+@objc(GLLPositionalLight)
+public class GLLPositionalLight: NSManagedObject {
+    @NSManaged public var isEnabled: Bool
+    @NSManaged public var isSpotLight: Bool
+    @NSManaged public var positionX: Float32
+    @NSManaged public var positionY: Float32
+    @NSManaged public var positionZ: Float32
+    @NSManaged public var range: Float32
+    @NSManaged public var color: NSColor!
+    @NSManaged public var latitude: Float32
+    @NSManaged public var longitude: Float32
+    @NSManaged public var spotAngle: Float32
+    @NSManaged public var index: Int64
+    
+    // The light for the clusters and shaders
+    var pointLight: GLLPointLight {
+        var light = GLLPointLight(position: SIMD3<Float32>(positionX, positionY, positionZ), range: range, color: color?.rgbaComponents128Bit ?? SIMD4<Float32>(repeating: 1))
+        if isSpotLight {
+            let direction = simd_mul(simd_mat_euler(SIMD4<Float32>(x: latitude, y: longitude, z: 0, w: 0), SIMD4<Float32>(x: 0, y: 0, z: 0, w: 1)), SIMD4<Float32>(x: 0, y: 0, z: -1, w: 0))
+            light.spotDirection = SIMD3<Float32>(direction.x, direction.y, direction.z)
+            light.spotCosine = cos(spotAngle / 2)
+        }
+        return light
+    }
+}
@@ -0,0 +1,21 @@
+//
+//  GLLPositionalLightViewController.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Cocoa
+
+@objc class GLLPositionalLightViewController: NSViewController {
+    
+    convenience init() {
+        self.init(nibName: "GLLPositionalLightView", bundle: nil)
+    }
+    
+    @IBAction override func showContextHelp(_ sender: Any?) {
+        let locBookName = Bundle.main.object(forInfoDictionaryKey: "CFBundleHelpBookName") as! NSString?
+        NSHelpManager.shared.openHelpAnchor("positionallight", inBook: locBookName as NSHelpManager.BookName?)
+    }
+}
@@ -12,8 +12,10 @@ let GLLPrefUseAnisotropy = "UseAnisotropy"
 let GLLPrefAnisotropyAmount = "AnisotropyAmount"
 let GLLPrefUseMSAA = "UseMultisampling"
 let GLLPrefMSAAAmount = "MultiSamplingAmount"
+let GLLPrefMaximumDepthPeelLayers = "MaximumDepthPeelLayers"
 let GLLPrefObjExportIncludesTransforms = "objExportIncludeTransformations"
 let GLLPrefObjExportIncludesVertexColors = "objExportIncludeVertexColors"
+let GLLPrefMeshExportPosed = "meshExportPosed"
 let GLLPrefPoseExportIncludesUnused = "exportPose-includeUnused"
 let GLLPrefPoseExportOnlySelected = "exportPose-onlySelected"
 let GLLPrefShowSkeleton = "showsSkeleton"
@@ -32,3 +34,6 @@ let GLLPrefControllerCameraRotationSpeed = "controllerCameraRotationSpeed"
 let GLLPrefControllerBoneMovementSpeed = "controllerBoneMovementSpeed"
 let GLLPrefControllerBoneRotationSpeed = "controllerBoneRotationSpeed"
 let GLLPrefHideUnusedBones = "hideUnusedBones"
+let GLLPrefQuantizeVertices = "quantizeVertices"
+let GLLPrefUseLevelsOfDetail = "useLevelsOfDetail"
+let GLLPrefUseMeshletCulling = "useMeshletCulling"
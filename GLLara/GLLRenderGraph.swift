@@ -0,0 +1,193 @@
+//
+//  GLLRenderGraph.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # The passes of a frame and the render targets they use.
+ *
+ * Passes are listed in the order they get encoded. From which passes use a target, the graph knows when it is first and last needed; targets whose lifetimes don't overlap can share the same memory. The planner places all targets in one block of memory, which then becomes a Metal heap.
+ *
+ * This only knows names, formats and sizes, no Metal objects, so it can be tested without a GPU.
+ */
+struct GLLRenderGraph {
+    struct Resource {
+        enum Format {
+            case bgra8
+            case depth32
+            
+            var bytesPerPixel: Int {
+                return 4
+            }
+        }
+        
+        let name: String
+        let format: Format
+    }
+    
+    struct Pass {
+        let name: String
+        let reads: [Int]
+        let writes: [Int]
+    }
+    
+    private(set) var resources: [Resource] = []
+    private(set) var passes: [Pass] = []
+    
+    mutating func addResource(_ name: String, format: Resource.Format) -> Int {
+        resources.append(Resource(name: name, format: format))
+        return resources.count - 1
+    }
+    
+    mutating func addPass(_ name: String, reads: [Int] = [], writes: [Int] = []) {
+        passes.append(Pass(name: name, reads: reads, writes: writes))
+    }
+    
+    // First and last pass that uses each resource; nil for resources that no pass uses
+    var lifetimes: [ClosedRange<Int>?] {
+        var lifetimes = [ClosedRange<Int>?](repeating: nil, count: resources.count)
+        for (index, pass) in passes.enumerated() {
+            for resource in pass.reads + pass.writes {
+                if let lifetime = lifetimes[resource] {
+                    lifetimes[resource] = lifetime.lowerBound ... index
+                } else {
+                    lifetimes[resource] = index ... index
+                }
+            }
+        }
+        return lifetimes
+    }
+    
+    // MARK: - Memory planning
+    
+    struct Plan {
+        struct Allocation {
+            let offset: Int
+            let size: Int
+        }
+        
+        // One per resource, nil for unused ones
+        let allocations: [Allocation?]
+        // Size of the memory block that holds everything
+        let peakBytes: Int
+        // What separate allocations would need
+        let unaliasedBytes: Int
+    }
+    
+    /**
+     * # Places the resources in one block of memory.
+     *
+     * Biggest first, each one at the lowest offset that does not overlap any already placed resource that is alive at the same time. That is not always optimal, but close for the handful of targets a frame has.
+     */
+    func plan(sizes: [(size: Int, alignment: Int)]) -> Plan {
+        precondition(sizes.count == resources.count)
+        let lifetimes = self.lifetimes
+        
+        let order = resources.indices.filter { lifetimes[$0] != nil }.sorted {
+            sizes[$0].size != sizes[$1].size ? sizes[$0].size > sizes[$1].size : $0 < $1
+        }
+        var allocations = [Plan.Allocation?](repeating: nil, count: resources.count)
+        var placed: [Int] = []
+        var peakBytes = 0
+        var unaliasedBytes = 0
+        for resource in order {
+            let lifetime = lifetimes[resource]!
+            let size = sizes[resource].size
+            let alignment = max(sizes[resource].alignment, 1)
+            let conflicts = placed.filter { lifetimes[$0]!.overlaps(lifetime) }.map { allocations[$0]! }
+            
+            // The best spot starts either at the beginning or right after something that is in the way
+            var candidates = [0] + conflicts.map { ($0.offset + $0.size + alignment - 1) / alignment * alignment }
+            candidates.sort()
+            let offset = candidates.first { candidate in
+                conflicts.allSatisfy { candidate + size <= $0.offset || $0.offset + $0.size <= candidate }
+            }!
+            
+            allocations[resource] = Plan.Allocation(offset: offset, size: size)
+            placed.append(resource)
+            peakBytes = max(peakBytes, offset + size)
+            unaliasedBytes += size
+        }
+        return Plan(allocations: allocations, peakBytes: peakBytes, unaliasedBytes: unaliasedBytes)
+    }
+    
+    // For testing and statistics; the GPU asks Metal for the actual sizes
+    func plan(width: Int, height: Int, alignment: Int = 65536) -> Plan {
+        return plan(sizes: resources.map { resource in
+            let bytes = width * height * resource.format.bytesPerPixel
+            return (size: (bytes + alignment - 1) / alignment * alignment, alignment: alignment)
+        })
+    }
+    
+    /**
+     * # Rounds a heap size up, so that similar sizes end up the same.
+     *
+     * There are four sizes between two powers of two. Resizing a window a bit usually stays within one of them, and then the heap that is already there can be used again.
+     */
+    static func bucketSize(for bytes: Int) -> Int {
+        let minimumBucket = 1 << 20
+        if bytes <= minimumBucket {
+            return minimumBucket
+        }
+        let powerOfTwo = 1 << (Int.bitWidth - 1 - (bytes - 1).leadingZeroBitCount)
+        let step = powerOfTwo / 4
+        return (bytes + step - 1) / step * step
+    }
+    
+    // MARK: - Depth peeling
+    
+    // Indices of the resources in the depth peeling graph
+    struct DepthPeelingResources {
+        var solidColor = 0
+        var solidDepth = 0
+        // Empty without peel layers
+        var peelDepth: [Int] = []
+        // Index 0 is the solid color, so the others match the layer numbers
+        var peelColor: [Int] = []
+        // Only when not drawing to a view
+        var output: Int? = nil
+    }
+    
+    /**
+     * # The passes that GLLViewDrawer encodes.
+     *
+     * Solid meshes first, then for every peel layer copying the solid depth and drawing the blended meshes behind the previous layer, then combining everything. Drawing into a view writes to the drawable, which does not belong to the graph; for files, there is an output target that gets copied to the CPU afterwards.
+     *
+     * All peel colors have to stay until the combine, but the depth buffers are done before then, so the output target can go where they were.
+     */
+    static func depthPeeling(layers: Int, offscreenOutput: Bool) -> (graph: GLLRenderGraph, resources: DepthPeelingResources) {
+        var graph = GLLRenderGraph()
+        var resources = DepthPeelingResources()
+        resources.solidColor = graph.addResource("color-res-0", format: .bgra8)
+        resources.solidDepth = graph.addResource("depth-solid", format: .depth32)
+        if layers > 0 {
+            resources.peelDepth = (0 ..< 2).map { graph.addResource("depth-\($0)", format: .depth32) }
+            resources.peelColor = [resources.solidColor] + (1 ... layers).map { graph.addResource("color-res-\($0)", format: .bgra8) }
+        }
+        if offscreenOutput {
+            resources.output = graph.addResource("output", format: .bgra8)
+        }
+        
+        graph.addPass("Draw solids", writes: [resources.solidColor, resources.solidDepth])
+        if layers > 0 {
+            graph.addPass("Clear Depth Buffer 0", writes: [resources.peelDepth[0]])
+            var lastWrittenDepthBuffer = 0
+            for i in 1 ... layers {
+                let backDepthBuffer = 1 - lastWrittenDepthBuffer
+                graph.addPass("Initialize Depth Buffer \(i)", reads: [resources.solidDepth], writes: [resources.peelDepth[backDepthBuffer]])
+                graph.addPass("Depth Peel Layer \(i)", reads: [resources.peelDepth[lastWrittenDepthBuffer], resources.peelDepth[backDepthBuffer]], writes: [resources.peelColor[i], resources.peelDepth[backDepthBuffer]])
+                lastWrittenDepthBuffer = backDepthBuffer
+            }
+        }
+        graph.addPass("Final combine", reads: [resources.solidColor] + resources.peelColor.dropFirst(), writes: resources.output.map { [$0] } ?? [])
+        if let output = resources.output {
+            graph.addPass("Read back", reads: [output])
+        }
+        return (graph, resources)
+    }
+}
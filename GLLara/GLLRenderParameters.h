@@ -15,6 +15,7 @@
 
 #include <simd/simd.h>
 
+// One directional light. The enabled ones get their own buffer, as many as the scene has.
 typedef struct GLLLightBuffer {
     vector_float4 diffuseColor;
     vector_float4 specularColor;
@@ -24,9 +25,28 @@ typedef struct GLLLightBuffer {
 typedef struct GLLLightsBuffer {
     vector_float4 cameraPosition;
     vector_float4 ambientColor;
-    GLLLightBuffer lights[3];
 } GLLLightsBuffer;
 
+typedef struct GLLPointLightBuffer {
+    // World space position, and how far the light reaches
+    vector_float4 positionAndRange;
+    vector_float4 color;
+    // Direction of a spot light, and cosine of half its angle; -1 for point lights
+    vector_float4 spotDirectionAndCosine;
+} GLLPointLightBuffer;
+
+typedef struct GLLLightClusterParameters {
+    matrix_float4x4 viewMatrix;
+    // Tiles horizontally and vertically, and depth slices
+    vector_uint4 clusterCounts;
+    // From view space x and y divided by depth to normalized device coordinates
+    vector_float2 projectionScale;
+    vector_float2 projectionOffset;
+    // From the logarithm of the depth to the depth slice
+    float depthSliceScale;
+    float depthSliceBias;
+} GLLLightClusterParameters;
+
 #ifdef __cplusplus
 enum GLLFunctionConstant {
 #else
@@ -54,6 +74,9 @@ typedef NS_ENUM(NSInteger, GLLFunctionConstant) {
     GLLFunctionConstantNumberOfTexCoordSets,
     
     GLLFunctionConstantHasDepthPeelFrontBuffer,
+    GLLFunctionConstantHasClusteredLights,
+    GLLFunctionConstantHasQuantizedVertices,
+    GLLFunctionConstantHasMorphTargets,
     
     GLLFunctionConstantMax
 };
@@ -0,0 +1,133 @@
+//
+//  GLLRenderQueue.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # The GPU state that a draw call needs, as small numbers.
+ *
+ * Sorting by this puts draws with the same pipeline next to each other, then those with the same vertex buffer, and so on, so replaying them needs as few state changes as possible.
+ */
+struct GLLRenderStateKey: Hashable, Comparable {
+    var pipeline: Int
+    var vertexArray: Int
+    var textures: Int
+    var transforms: Int
+    
+    static func < (lhs: GLLRenderStateKey, rhs: GLLRenderStateKey) -> Bool {
+        return (lhs.pipeline, lhs.vertexArray, lhs.textures, lhs.transforms) < (rhs.pipeline, rhs.vertexArray, rhs.textures, rhs.transforms)
+    }
+}
+
+// Receives the draws of a render queue, with the state changes that are actually needed. Each call gets the drawable whose state should be used.
+protocol GLLRenderQueueSink {
+    mutating func setPipeline(for drawable: Int)
+    mutating func setVertexArray(for drawable: Int)
+    mutating func setTextures(for drawable: Int)
+    mutating func setTransforms(for drawable: Int)
+    mutating func draw(_ drawable: Int)
+}
+
+/**
+ * # Draws of a scene, sorted by state.
+ *
+ * Built only when the structure of the scene changes (items, shaders, textures), and replayed for every pass of every frame. The drawables are just numbers for whoever built the queue.
+ *
+ * Blended draws get sorted too; depth peeling takes care of the order in which they appear.
+ */
+struct GLLRenderQueue {
+    struct Entry {
+        var key: GLLRenderStateKey
+        var drawable: Int
+    }
+    
+    private(set) var solid: [Entry] = []
+    private(set) var blended: [Entry] = []
+    
+    init() {
+    }
+    
+    init(entries: [(key: GLLRenderStateKey, drawable: Int, isBlended: Bool)]) {
+        for entry in entries {
+            if entry.isBlended {
+                blended.append(Entry(key: entry.key, drawable: entry.drawable))
+            } else {
+                solid.append(Entry(key: entry.key, drawable: entry.drawable))
+            }
+        }
+        // Stable, so drawables with the same state keep their order
+        solid = GLLRenderQueue.sorted(solid)
+        blended = GLLRenderQueue.sorted(blended)
+    }
+    
+    private static func sorted(_ entries: [Entry]) -> [Entry] {
+        return entries.enumerated().sorted { a, b in
+            a.element.key != b.element.key ? a.element.key < b.element.key : a.offset < b.offset
+        }.map { $0.element }
+    }
+    
+    /**
+     * # Sends one list to the sink.
+     *
+     * State only gets set where it differs from the previous visible draw. Invisible draws are skipped and don't change the state.
+     */
+    func replay<Sink: GLLRenderQueueSink>(blended: Bool, into sink: inout Sink, isVisible: (Int) -> Bool = { _ in true }) {
+        var current: GLLRenderStateKey? = nil
+        for entry in blended ? self.blended : self.solid {
+            guard isVisible(entry.drawable) else {
+                continue
+            }
+            let key = entry.key
+            if key.pipeline != current?.pipeline {
+                sink.setPipeline(for: entry.drawable)
+            }
+            if key.vertexArray != current?.vertexArray {
+                sink.setVertexArray(for: entry.drawable)
+            }
+            if key.textures != current?.textures {
+                sink.setTextures(for: entry.drawable)
+            }
+            if key.transforms != current?.transforms {
+                sink.setTransforms(for: entry.drawable)
+            }
+            sink.draw(entry.drawable)
+            current = key
+        }
+    }
+}
+
+/**
+ * # Turns objects into the numbers used in render state keys.
+ *
+ * Equal objects (or sets of objects) get equal numbers, in order of first use.
+ */
+struct GLLRenderStateNumbering {
+    private var objects: [ObjectIdentifier: Int] = [:]
+    private var sets: [[ObjectIdentifier]: Int] = [:]
+    
+    mutating func number(for object: AnyObject) -> Int {
+        let identifier = ObjectIdentifier(object)
+        if let existing = objects[identifier] {
+            return existing
+        }
+        let new = objects.count
+        objects[identifier] = new
+        return new
+    }
+    
+    // The order of the objects does not matter
+    mutating func number(forSet set: [AnyObject]) -> Int {
+        let identifiers = set.map { ObjectIdentifier($0) }.sorted()
+        if let existing = sets[identifiers] {
+            return existing
+        }
+        let new = sets.count
+        sets[identifiers] = new
+        return new
+    }
+}
@@ -0,0 +1,53 @@
+//
+//  GLLRenderTargetPool.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import Metal
+
+/**
+ * # Heaps for render targets, kept for reuse.
+ *
+ * Render targets get placed into a heap by offset, as GLLRenderGraph planned them. Heap sizes are rounded to buckets, so a window that gets a bit larger can usually stay in the heap it has, and one that was given back can be used by the next surface of about the same size.
+ *
+ * The heaps track hazards, so targets that share memory are still drawn in the right order without more fences. All users should draw on the same command queue for that.
+ */
+final class GLLRenderTargetPool {
+    let device: MTLDevice
+    // Not more than this many heaps stay around when nobody uses them
+    var maximumIdleHeaps = 2
+    
+    private var idleHeaps: [MTLHeap] = []
+    
+    init(device: MTLDevice) {
+        self.device = device
+    }
+    
+    // A heap with at least that many bytes; the smallest idle one that fits, or a new one
+    func heap(size: Int) -> MTLHeap {
+        if let index = idleHeaps.indices.filter({ idleHeaps[$0].size >= size }).min(by: { idleHeaps[$0].size < idleHeaps[$1].size }) {
+            return idleHeaps.remove(at: index)
+        }
+        
+        let descriptor = MTLHeapDescriptor()
+        descriptor.type = .placement
+        descriptor.storageMode = .private
+        descriptor.hazardTrackingMode = .tracked
+        descriptor.size = GLLRenderGraph.bucketSize(for: size)
+        let heap = device.makeHeap(descriptor: descriptor)!
+        heap.label = "render-targets"
+        return heap
+    }
+    
+    // The heap can be given out again; its textures must not be used any more
+    func recycle(_ heap: MTLHeap) {
+        idleHeaps.append(heap)
+        if idleHeaps.count > maximumIdleHeaps {
+            idleHeaps.removeFirst()
+        }
+    }
+}
@@ -16,6 +16,8 @@
 
 #include "GLLara-Swift.h"
 
+NSString* GLLPrefForceSoftwareRendering = @"ForceSoftwareRendering";
+
 @interface GLLRenderWindowController ()
 {
     GLLRenderAccessoryViewController *savePanelAccessoryViewController;
@@ -150,7 +152,15 @@
         bool transparentBackground = [saveData[@"transparentBackground"] boolValue];
         
         NSError *writeError = nil;
-        if (![self.renderView.viewDrawer writeImageTo:savePanel.URL fileType:self->savePanelAccessoryViewController.selectedFileType size:CGSizeMake(width, height) transparentBackground:transparentBackground error:&writeError]) {
+        if ([[NSUserDefaults standardUserDefaults] boolForKey:GLLPrefForceSoftwareRendering]) {
+            // Renders on the CPU, straight from the document
+            GLLSoftwareSceneRenderer *renderer = [[GLLSoftwareSceneRenderer alloc] initWithManagedObjectContext:self.camera.managedObjectContext camera:self.camera];
+            if (![renderer writeImageTo:savePanel.URL fileType:self->savePanelAccessoryViewController.selectedFileType size:CGSizeMake(width, height) transparentBackground:transparentBackground error:&writeError]) {
+                [self presentError:writeError];
+            } else if (renderer.replacedTextures.count > 0) {
+                [(GLLDocument *) self.document notifyTexturesNotLoaded:renderer.replacedTextures];
+            }
+        } else if (![self.renderView.viewDrawer writeImageTo:savePanel.URL fileType:self->savePanelAccessoryViewController.selectedFileType size:CGSizeMake(width, height) transparentBackground:transparentBackground error:&writeError]) {
             [self presentError:writeError];
         }
     }];
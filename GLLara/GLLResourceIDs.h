@@ -19,6 +19,9 @@ typedef enum GLLVertexInputIndex {
     GLLVertexInputIndexVertices,
     GLLVertexInputIndexBoneIndexBuffer,
     GLLVertexInputIndexBoneWeightBuffer,
+    GLLVertexInputIndexMorphPositionDeltas,
+    GLLVertexInputIndexMorphNormalDeltas,
+    GLLVertexInputIndexMorphBaseVertex,
 } GLLVertexInputIndex;
 
 typedef enum GLLFragmentArgumentIndex {
@@ -50,7 +53,12 @@ typedef enum GLLFragmentArgumentIndex {
 
 typedef enum GLLFragmentBufferIndex {
     GLLFragmentBufferIndexArguments = 1,
-    GLLFragmentBufferIndexLights = 3
+    GLLFragmentBufferIndexLights = 3,
+    GLLFragmentBufferIndexPointLights,
+    GLLFragmentBufferIndexLightClusterRanges,
+    GLLFragmentBufferIndexLightClusterIndices,
+    GLLFragmentBufferIndexLightClusterParameters,
+    GLLFragmentBufferIndexDirectionalLights
 } GLLFragmentBufferIndex;
 
 #endif /* GLLResourceIDs_h */
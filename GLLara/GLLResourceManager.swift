@@ -154,20 +154,24 @@ import Combine
         }
     }
     
-    func pipeline(vertex: GLLVertexAttribAccessorSet, shader: GLLShaderData, numberOfTexCoordSets: Int, texCoordAssignments: [Int:Int], hasVariableBoneWeights: Bool = false) throws -> GLLPipelineStateInformation {
+    func pipeline(vertex: GLLVertexAttribAccessorSet, shader: GLLShaderData, numberOfTexCoordSets: Int, texCoordAssignments: [Int:Int], hasVariableBoneWeights: Bool = false, hasQuantizedVertices: Bool = false, hasMorphTargets: Bool = false, lighting: GLLLightingConfiguration = GLLLightingConfiguration()) throws -> GLLPipelineStateInformation {
         // TODO Does this work?
         let key: [String : AnyHashable] = [
             "shader": shader,
             "vertexDescriptor": vertex.vertexDescriptor,
             "numTexCoords": numberOfTexCoordSets,
             "assignments": texCoordAssignments,
-            "variableBoneWeights": hasVariableBoneWeights
+            "variableBoneWeights": hasVariableBoneWeights,
+            "quantizedVertices": hasQuantizedVertices,
+            "morphTargets": hasMorphTargets,
+            "lighting": lighting
         ]
         
         return try pipelinesLock.withLock {
             return try value(key: key, from: &pipelines) {
-                let vertexFunction = try function(name: shader.vertexName!, shader: shader, numberOfTexCoordSets: numberOfTexCoordSets, texCoordAssignments: texCoordAssignments, hasVariableBoneWeights: hasVariableBoneWeights)
-                let fragmentFunction = try function(name: shader.fragmentName!, shader: shader, numberOfTexCoordSets: numberOfTexCoordSets, texCoordAssignments: texCoordAssignments, hasVariableBoneWeights: hasVariableBoneWeights)
+                // Lighting only matters for the fragment function, so the vertex function does not have to be compiled again for it
+                let vertexFunction = try function(name: shader.vertexName!, shader: shader, numberOfTexCoordSets: numberOfTexCoordSets, texCoordAssignments: texCoordAssignments, hasVariableBoneWeights: hasVariableBoneWeights, hasQuantizedVertices: hasQuantizedVertices, hasMorphTargets: hasMorphTargets, lighting: GLLLightingConfiguration())
+                let fragmentFunction = try function(name: shader.fragmentName!, shader: shader, numberOfTexCoordSets: numberOfTexCoordSets, texCoordAssignments: texCoordAssignments, hasVariableBoneWeights: hasVariableBoneWeights, hasQuantizedVertices: hasQuantizedVertices, hasMorphTargets: hasMorphTargets, lighting: lighting)
                 
                 let descriptor = MTLRenderPipelineDescriptor()
                 
@@ -200,14 +204,17 @@ import Combine
     private var pipelines: [AnyHashable: GLLPipelineStateInformation] = [:]
     private var functions: [AnyHashable: MTLFunction] = [:]
     
-    private func function(name: String, shader: GLLShaderData, numberOfTexCoordSets: Int, texCoordAssignments: [Int:Int], hasVariableBoneWeights: Bool) throws -> MTLFunction {
+    private func function(name: String, shader: GLLShaderData, numberOfTexCoordSets: Int, texCoordAssignments: [Int:Int], hasVariableBoneWeights: Bool, hasQuantizedVertices: Bool, hasMorphTargets: Bool, lighting: GLLLightingConfiguration) throws -> MTLFunction {
         // TODO does this work?
         let key: [String : AnyHashable] = [
             "name": name,
             "shader": shader,
             "numTexCoords": numberOfTexCoordSets,
             "assignments": texCoordAssignments,
-            "variableBoneWeights": hasVariableBoneWeights
+            "variableBoneWeights": hasVariableBoneWeights,
+            "quantizedVertices": hasQuantizedVertices,
+            "morphTargets": hasMorphTargets,
+            "lighting": lighting
         ]
         
         return try value(key: key, from: &functions) {
@@ -226,6 +233,12 @@ import Combine
             // Not handled as a feature because it's part of the model file
             var variableBoneWeights = hasVariableBoneWeights
             constantValues.setConstantValue(&variableBoneWeights, type: .bool, index: GLLFunctionConstant.hasVariableBoneWeights.rawValue)
+            // Same for the vertex layout
+            var quantizedVertices = hasQuantizedVertices
+            constantValues.setConstantValue(&quantizedVertices, type: .bool, index: GLLFunctionConstant.hasQuantizedVertices.rawValue)
+            // And for the buffers with the morph target offsets
+            var morphTargets = hasMorphTargets
+            constantValues.setConstantValue(&morphTargets, type: .bool, index: GLLFunctionConstant.hasMorphTargets.rawValue)
             
             // Assign value for tex coord
             var numTexCoords32 = Int32(numberOfTexCoordSets)
@@ -240,9 +253,11 @@ import Combine
             }
             constantValues.setConstantValues(indexValuesArray, type: .int, range: 100 ..< 100 + indexValuesArray.count)
             
-            // Set number of active lights - TODO adjust to what it should really be
-            var lights = Int32(3)
+            // Set number of active lights; disabled directional lights are not in the buffer
+            var lights = Int32(lighting.directionalLights)
             constantValues.setConstantValue(&lights, type: .int, index: GLLFunctionConstant.numberOfUsedLights.rawValue)
+            var clusteredLights = lighting.hasClusteredLights
+            constantValues.setConstantValue(&clusteredLights, type: .bool, index: GLLFunctionConstant.hasClusteredLights.rawValue)
             
             var depthPeelActive: Bool = shader.alphaBlending
             constantValues.setConstantValue(&depthPeelActive, type: .bool, index: GLLFunctionConstant.hasDepthPeelFrontBuffer.rawValue)
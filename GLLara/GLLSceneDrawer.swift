@@ -10,6 +10,20 @@ import Cocoa
 import CoreData
 import Combine
 
+// Culling result for one frame; the visible set has one entry per drawable of the render queue
+struct GLLSceneVisibility {
+    var visibleDrawables = GLLBitSet(count: 0)
+    var statistics = GLLCullingResult.Statistics()
+    // World space boxes of the visible blended meshes, for estimating the depth peel layers
+    var blendedBounds: [GLLBoundingBox?] = []
+    // For the same meshes, how many of their surfaces can be on top of each other at most. Each triangle covers a pixel only once, so the triangle count is a safe bound; it only matters for small meshes like image planes.
+    var blendedDepthComplexities: [Int] = []
+    // Level of detail for every drawable, from the size of its item on screen
+    var detailLevels: [Int] = []
+    // Elements left after culling the meshlets, for every drawable; nil to draw all
+    var elementRanges: [[Range<Int>]?] = []
+}
+
 @objc class GLLSceneDrawer: NSObject, ObservableObject {
     
     @objc init(document: GLLDocument) {
@@ -41,6 +55,12 @@ import Combine
                     }
                 }
             }
+            
+            // Any change to a light, including adding or removing it, means building the list again
+            let changedObjects = [NSInsertedObjectsKey, NSDeletedObjectsKey, NSUpdatedObjectsKey, NSRefreshedObjectsKey].compactMap { notification.userInfo?[$0] as? NSSet }
+            if changedObjects.contains(where: { objects in objects.contains { $0 is GLLPositionalLight } }) {
+                self.updatePointLights()
+            }
             self.needsUpdate = true
         }
         
@@ -56,6 +76,7 @@ import Combine
             addDrawer(for: item)
         }
         
+        updatePointLights()
     }
     
     deinit {
@@ -86,10 +107,125 @@ import Combine
         }
     }
     
-    func draw(into commandEncoder: MTLRenderCommandEncoder, blended: Bool) {
+    /**
+     * # Finds the meshes that are in view.
+     *
+     * Meant to be done once per frame and view; the result is then used for all passes. Also rebuilds the render queue if needed.
+     */
+    func cull(viewProjection: matrix_float4x4) -> GLLSceneVisibility {
+        if renderQueueNeedsRebuild {
+            rebuildRenderQueue()
+        }
+        
+        let frustum = GLLFrustum(viewProjection: viewProjection)
+        var visibility = GLLSceneVisibility()
+        var visibleMeshes: [ObjectIdentifier: GLLBitSet] = [:]
+        var detailLevels: [ObjectIdentifier: Int] = [:]
+        var elementRanges: [ObjectIdentifier: [[Range<Int>]?]] = [:]
+        for itemDrawer in itemDrawers {
+            let result = itemDrawer.cull(frustum: frustum)
+            visibleMeshes[ObjectIdentifier(itemDrawer)] = result.visible
+            elementRanges[ObjectIdentifier(itemDrawer)] = result.elementRanges
+            detailLevels[ObjectIdentifier(itemDrawer)] = itemDrawer.detailLevel(viewProjection: viewProjection)
+            visibility.statistics.add(result.statistics)
+        }
+        visibility.detailLevels = queuedMeshes.map { detailLevels[ObjectIdentifier($0.itemDrawer)] ?? 0 }
+        visibility.elementRanges = queuedMeshes.map { elementRanges[ObjectIdentifier($0.itemDrawer)]?[$0.index] ?? nil }
+        
+        visibility.visibleDrawables = GLLBitSet(count: queuedMeshes.count)
+        for (drawable, queued) in queuedMeshes.enumerated() {
+            if queued.meshState.itemMesh.isVisible && visibleMeshes[ObjectIdentifier(queued.itemDrawer)]?[queued.index] ?? true {
+                visibility.visibleDrawables.insert(drawable)
+                if queued.meshState.isBlended {
+                    visibility.blendedBounds.append(queued.itemDrawer.meshBounds[queued.index])
+                    visibility.blendedDepthComplexities.append(queued.meshState.itemMesh.mesh.countOfUsedElements / 3)
+                }
+            }
+        }
+        return visibility
+    }
+    
+    func draw(into commandEncoder: MTLRenderCommandEncoder, blended: Bool, visibility: GLLSceneVisibility) {
+        var sink = GLLMetalRenderQueueSink(encoder: commandEncoder, meshes: queuedMeshes, detailLevels: visibility.detailLevels, elementRanges: visibility.elementRanges)
+        renderQueue.replay(blended: blended, into: &sink) { visibility.visibleDrawables[$0] }
+    }
+    
+    // MARK: - Lights
+    
+    // Point and spot lights: The enabled positional lights of the document
+    private(set) var pointLights: [GLLPointLight] = [] {
+        didSet {
+            updateLighting()
+            needsUpdate = true
+        }
+    }
+    
+    private func updatePointLights() {
+        guard let managedObjectContext else {
+            return
+        }
+        let request = NSFetchRequest<GLLPositionalLight>(entityName: "GLLPositionalLight")
+        request.predicate = NSPredicate(format: "isEnabled == YES")
+        request.sortDescriptors = [NSSortDescriptor(key: "index", ascending: true)]
+        pointLights = (try? managedObjectContext.fetch(request))?.map { $0.pointLight } ?? []
+    }
+    
+    // Set by the view drawers, which all see the same lights
+    var enabledDirectionalLights = 3 {
+        didSet {
+            updateLighting()
+        }
+    }
+    
+    private(set) var lighting = GLLLightingConfiguration()
+    
+    // The shaders depend on what lights there are, so changing that means new pipelines
+    private func updateLighting() {
+        let newLighting = GLLLightingConfiguration(directionalLights: enabledDirectionalLights, hasClusteredLights: !pointLights.isEmpty)
+        guard newLighting != lighting else {
+            return
+        }
+        lighting = newLighting
+        for itemDrawer in itemDrawers {
+            for meshState in itemDrawer.meshStates {
+                meshState.updatePipelineState()
+            }
+        }
+        renderQueueNeedsRebuild = true
+    }
+    
+    // MARK: - Render queue
+    
+    // Set when meshes are added or removed, or change their pipeline or textures
+    var renderQueueNeedsRebuild = true
+    private var renderQueue = GLLRenderQueue()
+    // The drawables in the render queue are indices into this
+    private var queuedMeshes: [GLLQueuedMesh] = []
+    
+    private func rebuildRenderQueue() {
+        var numbering = GLLRenderStateNumbering()
+        var entries: [(key: GLLRenderStateKey, drawable: Int, isBlended: Bool)] = []
+        queuedMeshes.removeAll()
+        
         for itemDrawer in itemDrawers {
-            itemDrawer.draw(into: commandEncoder, blended: blended)
+            for (index, meshState) in itemDrawer.meshStates.enumerated() {
+                // Hidden meshes that were never shown have no pipeline, and don't need textures yet
+                guard let pipelineStateInformation = meshState.pipelineStateInformation else {
+                    continue
+                }
+                meshState.updateTexturesIfNeeded()
+                
+                let key = GLLRenderStateKey(pipeline: numbering.number(for: pipelineStateInformation.pipelineState as AnyObject),
+                                            vertexArray: numbering.number(for: meshState.meshData.vertexArray),
+                                            textures: numbering.number(forSet: meshState.loadedTextures.map { $0.texture as AnyObject }),
+                                            transforms: numbering.number(for: itemDrawer))
+                entries.append((key, queuedMeshes.count, meshState.isBlended))
+                queuedMeshes.append(GLLQueuedMesh(itemDrawer: itemDrawer, meshState: meshState, index: index))
+            }
         }
+        
+        renderQueue = GLLRenderQueue(entries: entries)
+        renderQueueNeedsRebuild = false
     }
     
     func drawSelection(int commandEncoder: MTLRenderCommandEncoder) {
@@ -98,7 +234,11 @@ import Combine
     
     @Published var needsUpdate = false
     
-    private var itemDrawers: [GLLItemDrawer] = []
+    private(set) var itemDrawers: [GLLItemDrawer] = [] {
+        didSet {
+            renderQueueNeedsRebuild = true
+        }
+    }
     private let skeletonDrawer: GLLSkeletonDrawer
     private var drawStateNotificationObserver: Any? = nil
     private var managedObjectContextObserver: Any? = nil
@@ -120,3 +260,38 @@ import Combine
     }
     
 }
+
+private struct GLLQueuedMesh {
+    let itemDrawer: GLLItemDrawer
+    let meshState: GLLItemMeshState
+    // Index of the mesh state in its item drawer
+    let index: Int
+}
+
+// Sends the render queue to Metal
+private struct GLLMetalRenderQueueSink: GLLRenderQueueSink {
+    let encoder: MTLRenderCommandEncoder
+    let meshes: [GLLQueuedMesh]
+    let detailLevels: [Int]
+    let elementRanges: [[Range<Int>]?]
+    
+    func setPipeline(for drawable: Int) {
+        meshes[drawable].meshState.bindPipeline(into: encoder)
+    }
+    
+    func setVertexArray(for drawable: Int) {
+        meshes[drawable].meshState.bindVertexArray(into: encoder)
+    }
+    
+    func setTextures(for drawable: Int) {
+        meshes[drawable].meshState.bindTextures(into: encoder)
+    }
+    
+    func setTransforms(for drawable: Int) {
+        meshes[drawable].itemDrawer.bindTransforms(into: encoder)
+    }
+    
+    func draw(_ drawable: Int) {
+        meshes[drawable].meshState.draw(into: encoder, detailLevel: drawable < detailLevels.count ? detailLevels[drawable] : 0, elementRanges: drawable < elementRanges.count ? elementRanges[drawable] : nil)
+    }
+}
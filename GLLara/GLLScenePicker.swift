@@ -0,0 +1,84 @@
+//
+//  GLLScenePicker.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # Finds the mesh under the mouse.
+ *
+ * Every model mesh gets a GLLMeshBVH of its bind pose the first time it is needed. For each pick, the visible meshes get morphed and skinned to the current pose on the CPU, exactly like the software renderer does it, and a copy of the BVH is refit to that.
+ */
+final class GLLScenePicker {
+    struct Result {
+        let itemMesh: GLLItemMesh
+        let triangle: Int
+        // Of the triangle's three corners, at the hit point
+        let barycentrics: SIMD3<Float>
+        let distance: Float
+        // The bone that moves the hit point the most; nil if the item has no bones
+        let bone: GLLItemBone?
+    }
+    
+    private struct MeshData {
+        // Keeps the mesh alive, so the identifier stays unique
+        let mesh: GLLModelMesh
+        let skinner: GLLCPUSkinner
+        let bvh: GLLMeshBVH
+    }
+    private var meshData: [ObjectIdentifier: MeshData] = [:]
+    
+    private func data(for mesh: GLLModelMesh) -> MeshData {
+        if let data = meshData[ObjectIdentifier(mesh)] {
+            return data
+        }
+        
+        // Tangents are not needed here, so they are left out of the skinning
+        let fullSkinner = mesh.cpuSkinner
+        let skinner = GLLCPUSkinner(positions: fullSkinner.positions, normals: fullSkinner.normals, boneData: fullSkinner.boneData)
+        let data = MeshData(mesh: mesh, skinner: skinner, bvh: GLLMeshBVH(positions: skinner.positions, indices: mesh.usedElements))
+        meshData[ObjectIdentifier(mesh)] = data
+        return data
+    }
+    
+    // The closest visible mesh that the ray hits
+    func pick(items: [GLLItem], origin: SIMD3<Float>, direction: SIMD3<Float>) -> Result? {
+        var closest: Result? = nil
+        for item in items {
+            let transforms = item.skinningTransforms(posed: true)
+            guard !transforms.isEmpty else {
+                continue
+            }
+            
+            for case let itemMesh as GLLItemMesh in item.meshes {
+                guard itemMesh.isVisible, let shader = itemMesh.shader else {
+                    continue
+                }
+                let data = data(for: itemMesh.mesh)
+                
+                // Without skinning, the shader uses the first bone for everything
+                var boneData = data.skinner.boneData
+                if !(shader.activeBoolConstants as IndexSet).contains(GLLFunctionConstant.useSkinning.rawValue) && itemMesh.mesh.variableBoneWeights == nil {
+                    boneData = .none
+                }
+                var bvh = data.bvh
+                let morphDeltas = itemMesh.mesh.morphDeltas(weights: itemMesh.morphTargetWeights)
+                bvh.refit(positions: GLLCPUSkinner(positions: data.skinner.positions, normals: data.skinner.normals, boneData: boneData).skin(transforms: transforms, morphDeltas: morphDeltas).positions)
+                
+                guard let hit = bvh.intersect(origin: origin, direction: direction, maximumDistance: closest?.distance ?? .infinity) else {
+                    continue
+                }
+                let corners = SIMD3<UInt32>(bvh.indices[hit.triangle * 3 + 0], bvh.indices[hit.triangle * 3 + 1], bvh.indices[hit.triangle * 3 + 2])
+                let boneIndex = boneData.dominantBone(corners: corners, barycentrics: hit.barycentrics)
+                let bone = boneIndex < item.bones.count ? item.bones.object(at: boneIndex) as? GLLItemBone : nil
+                closest = Result(itemMesh: itemMesh, triangle: hit.triangle, barycentrics: hit.barycentrics, distance: hit.distance, bone: bone)
+            }
+        }
+        return closest
+    }
+}
@@ -15,16 +15,27 @@ class GLLSkeletonDrawer: NSObject {
     let pipeline: MTLRenderPipelineState
     let depthState: MTLDepthStencilState
     
-    var defaultColor = NSColor.yellow.withAlphaComponent(0.5)
-    var selectedColor = NSColor.red.withAlphaComponent(0.5)
-    var childOfSelectedColor = NSColor.green.withAlphaComponent(0.5)
+    var defaultColor = NSColor.yellow.withAlphaComponent(0.5) {
+        didSet { layoutNeedsUpdate = true }
+    }
+    var selectedColor = NSColor.red.withAlphaComponent(0.5) {
+        didSet { layoutNeedsUpdate = true }
+    }
+    var childOfSelectedColor = NSColor.green.withAlphaComponent(0.5) {
+        didSet { layoutNeedsUpdate = true }
+    }
     
     private var verticesBuffer: MTLBuffer
     private var elementsBuffer: MTLBuffer
     
+    // Colors and elements need to be rewritten; only after the selection or displayed bones changed
+    private var layoutNeedsUpdate = true
+    // Positions need to be rewritten
     private var buffersNeedUpdate = true
     
-    private var numberOfPoints = 0
+    private var layout = GLLSkeletonOverlayLayout()
+    // The bone for every slot in the layout
+    private var layoutBones: [GLLItemBone] = []
     
     init(resourceManager: GLLResourceManager) {
         device = resourceManager.metalDevice
@@ -56,6 +67,7 @@ class GLLSkeletonDrawer: NSObject {
         
         settingsChangedNotification = NotificationCenter.default.addObserver(forName: UserDefaults.didChangeNotification, object: nil, queue: OperationQueue.main) { [weak self] _ in
             self?.displayedBones.removeAll()
+            self?.layoutNeedsUpdate = true
         }
     }
     
@@ -101,7 +113,7 @@ class GLLSkeletonDrawer: NSObject {
                 }
             }
             displayedBones.removeAll()
-            buffersNeedUpdate = true
+            layoutNeedsUpdate = true
         }
     }
     
@@ -112,95 +124,93 @@ class GLLSkeletonDrawer: NSObject {
                              UInt8(color.alphaComponent * 255.0))
     }
     
-    private func updateBuffers() {
-        if selection.isEmpty {
-            return
-        }
-        if displayedBones.isEmpty {
-            let hideUnused = UserDefaults.standard.bool(forKey: GLLPrefHideUnusedBones)
-            for item in selection.keys {
-                if hideUnused {
-                    displayedBones[item] = item.combinedUsedBones()!
-                } else {
-                    displayedBones[item] = item.combinedBones()!
+    private func updateLayout() {
+        layout = GLLSkeletonOverlayLayout()
+        layoutBones.removeAll()
+        
+        let hideUnused = UserDefaults.standard.bool(forKey: GLLPrefHideUnusedBones)
+        for (item, selectedBones) in selection {
+            if displayedBones[item] == nil {
+                displayedBones[item] = hideUnused ? item.combinedUsedBones()! : item.combinedBones()!
+            }
+            let bones = displayedBones[item]!.array as! [GLLItemBone]
+            
+            var slotOfBone: [ObjectIdentifier: Int] = [:]
+            slotOfBone.reserveCapacity(bones.count)
+            for (slot, bone) in bones.enumerated() {
+                slotOfBone[ObjectIdentifier(bone)] = slot
+            }
+            let parents = bones.map { bone in
+                bone.parent.flatMap { slotOfBone[ObjectIdentifier($0)] } ?? -1
+            }
+            
+            // Bones can only be below selected bones of the same root item
+            let skeleton = item.skeleton()!
+            let isChildOfSelectedBone = skeleton.descendantsMask(ofAny: selectedBones)
+            var isSelected = GLLBitSet(count: bones.count)
+            var isChildOfSelected = GLLBitSet(count: bones.count)
+            for bone in selectedBones {
+                if let slot = slotOfBone[ObjectIdentifier(bone)] {
+                    isSelected.insert(slot)
+                }
+            }
+            for (slot, bone) in bones.enumerated() {
+                let boneIndex = skeleton.index(of: bone)
+                if boneIndex != NSNotFound && isChildOfSelectedBone[boneIndex] {
+                    isChildOfSelected.insert(slot)
                 }
             }
+            
+            layout.appendItem(parents: parents, isSelected: isSelected, isChildOfSelected: isChildOfSelected)
+            layoutBones.append(contentsOf: bones)
         }
         
-        let numberOfBones = selection.keys.reduce(0, { count, item in count + displayedBones[item]!.count })
-        numberOfPoints = 2*numberOfBones
-        
-        if numberOfPoints > bufferCapacity {
+        if layout.count > bufferCapacity {
             // Double or increase to new count, whichever is larger
-            let newCount = max(numberOfPoints, bufferCapacity*2)
+            let newCount = max(layout.count, bufferCapacity*2)
             verticesBuffer = device.makeBuffer(length: GLLSkeletonDrawer.vertexCapacity(for: newCount), options: .storageModeManaged)!
             verticesBuffer.label = "skeleton-vertices"
             elementsBuffer = device.makeBuffer(length: GLLSkeletonDrawer.elementCapacity(for: newCount), options: .storageModeManaged)!
             elementsBuffer.label = "skeleton-elements"
         }
         
-        // Update vertices
-        let vertices = verticesBuffer.contents().bindMemory(to: GLLSkeletonDrawerVertex.self, capacity: verticesBuffer.length)
-        var offset = 0
-        let elements = elementsBuffer.contents().bindMemory(to: UInt16.self, capacity: elementsBuffer.length)
-        
-        let colorSelected = toRgba8(color: selectedColor)
-        let colorChild = toRgba8(color: childOfSelectedColor)
-        let colorDefault = toRgba8(color: defaultColor)
+        let colors = GLLSkeletonOverlayLayout.Colors(selected: toRgba8(color: selectedColor), childOfSelected: toRgba8(color: childOfSelectedColor), normal: toRgba8(color: defaultColor))
+        let vertices = verticesBuffer.contents().bindMemory(to: GLLSkeletonDrawerVertex.self, capacity: layout.count)
+        let elements = elementsBuffer.contents().bindMemory(to: UInt16.self, capacity: layout.elementCount)
+        layout.writeStaticData(colors: colors, vertices: vertices, elements: elements)
+        elementsBuffer.didModifyRange(0 ..< layout.elementCount * MemoryLayout<UInt16>.stride)
         
-        var elementsBase = 0
-        for item in selection.keys {
-            var relativeOffset = 0
-            let bones = displayedBones[item]!
-            for element in bones {
-                let bone = element as! GLLItemBone
-                
-                let position = bone.globalPosition
-                vertices[offset].position.x = position.x
-                vertices[offset].position.y = position.y
-                vertices[offset].position.z = position.z
-                
-                if selection.values.contains(where: { $0.contains(bone) }) {
-                    vertices[offset].color = colorSelected;
-                } else if bone.isChild(ofAny: self.selectedBones) {
-                    vertices[offset].color = colorChild
-                } else {
-                    vertices[offset].color = colorDefault
-                }
-                
-                let start = UInt16(relativeOffset + elementsBase);
-                elements[offset * 2 + 0] = start
-                let parentIndex = bones.index(of: bone.parent as Any)
-                if parentIndex != NSNotFound {
-                    elements[offset * 2 + 1] = UInt16(parentIndex + elementsBase)
-                } else {
-                    // Has no parent, copy over
-                    elements[offset * 2 + 1] = start
-                }
-                
-                relativeOffset += 1
-                offset += 1
-            }
-            elementsBase += bones.count
+        layoutNeedsUpdate = false
+        buffersNeedUpdate = true
+    }
+    
+    private func updateBuffers() {
+        let vertices = verticesBuffer.contents().bindMemory(to: GLLSkeletonDrawerVertex.self, capacity: layout.count)
+        layout.writePositions(vertices: vertices) { slot in
+            let position = layoutBones[slot].globalPosition
+            return vector_float3(position.x, position.y, position.z)
         }
-        verticesBuffer.didModifyRange(0 ..< offset * MemoryLayout<GLLSkeletonDrawerVertex>.stride)
-        elementsBuffer.didModifyRange(0 ..< offset * 2 * MemoryLayout<UInt16>.stride)
+        // Colors were written into the same range, so this covers them as well
+        verticesBuffer.didModifyRange(0 ..< layout.count * MemoryLayout<GLLSkeletonDrawerVertex>.stride)
         
         buffersNeedUpdate = false;
     }
     
     func draw(into commandEncoder: MTLRenderCommandEncoder) {
+        if layoutNeedsUpdate {
+            updateLayout()
+        }
         if buffersNeedUpdate {
             updateBuffers()
         }
-        guard numberOfPoints > 0 else {
+        guard layout.count > 0 else {
             return
         }
         
         commandEncoder.setRenderPipelineState(pipeline)
         commandEncoder.setVertexBuffer(verticesBuffer, offset: 0, index: Int(GLLVertexInputIndexVertices.rawValue))
         commandEncoder.setDepthStencilState(depthState)
-        commandEncoder.drawIndexedPrimitives(type: .line, indexCount: numberOfPoints, indexType: .uint16, indexBuffer: elementsBuffer, indexBufferOffset: 0)
+        commandEncoder.drawIndexedPrimitives(type: .line, indexCount: layout.elementCount, indexType: .uint16, indexBuffer: elementsBuffer, indexBufferOffset: 0)
     }
     
 }
@@ -0,0 +1,149 @@
+//
+//  GLLSkeletonIndex.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # Immutable lookup structure for a bone hierarchy.
+ *
+ * Bones are identified by their index. The children of all bones are stored in one array (compressed sparse row layout), in ascending order. The bones are also numbered in depth first order; all descendants of a bone then have numbers in an interval directly after the bone itself, so checking whether one bone is below another is a comparison of two numbers.
+ *
+ * Bones whose parent index is invalid are treated as roots. Bones in a cycle cannot be reached from any root; they get appended at the end, without any children or ancestors.
+ */
+struct GLLSkeletonIndex {
+    // Parent for every bone, -1 for roots
+    let parents: [Int32]
+    // Bones in depth first order; parents always come before their children
+    let preorder: [Int32]
+    let roots: [Int]
+    // Some bone that is its own ancestor, if there is such a cycle
+    let boneInCycle: Int?
+    
+    // Children of bone i are childList[childStarts[i] ..< childStarts[i + 1]]
+    private let childStarts: [Int32]
+    private let childList: [Int32]
+    // Position of every bone in preorder, and the end of its subtree there
+    private let enter: [Int32]
+    private let exit: [Int32]
+    // First bone with every name
+    private let namedIndices: [String: Int]
+    
+    init(parentIndices: [Int], names: [String]) {
+        precondition(names.count == parentIndices.count)
+        let count = parentIndices.count
+        
+        let parents = parentIndices.enumerated().map { (bone, parent) in
+            (parent >= 0 && parent < count && parent != bone) ? Int32(parent) : -1
+        }
+        
+        // Count children, then fill them in; going in bone order keeps them sorted
+        var childStarts = Array(repeating: Int32(0), count: count + 1)
+        for parent in parents where parent >= 0 {
+            childStarts[Int(parent) + 1] += 1
+        }
+        for i in 0 ..< count {
+            childStarts[i + 1] += childStarts[i]
+        }
+        var childList = Array(repeating: Int32(0), count: Int(childStarts[count]))
+        var fill = childStarts
+        for (bone, parent) in parents.enumerated() where parent >= 0 {
+            childList[Int(fill[Int(parent)])] = Int32(bone)
+            fill[Int(parent)] += 1
+        }
+        
+        let roots = parents.indices.filter { parents[$0] < 0 }
+        
+        var preorder: [Int32] = []
+        preorder.reserveCapacity(count)
+        var enter = Array(repeating: Int32(-1), count: count)
+        var exit = Array(repeating: Int32(-1), count: count)
+        
+        // Iterative, so deep chains don't overflow the stack. The second value marks whether the bone is done
+        var stack: [(Int32, Bool)] = roots.reversed().map { (Int32($0), false) }
+        while let (bone, isFinished) = stack.popLast() {
+            if isFinished {
+                exit[Int(bone)] = Int32(preorder.count)
+                continue
+            }
+            enter[Int(bone)] = Int32(preorder.count)
+            preorder.append(bone)
+            stack.append((bone, true))
+            for child in childList[Int(childStarts[Int(bone)]) ..< Int(childStarts[Int(bone) + 1])].reversed() {
+                stack.append((child, false))
+            }
+        }
+        
+        // Unreachable bones are in a cycle or below one. Going up often enough from any of them ends up in the cycle itself
+        boneInCycle = enter.firstIndex(of: -1).map { unreachable in
+            (0 ..< count).reduce(unreachable) { bone, _ in Int(parents[bone]) }
+        }
+        for bone in 0 ..< count where enter[bone] < 0 {
+            enter[bone] = Int32(preorder.count)
+            preorder.append(Int32(bone))
+            exit[bone] = Int32(preorder.count)
+        }
+        
+        self.parents = parents
+        self.preorder = preorder
+        self.roots = roots
+        self.childStarts = childStarts
+        self.childList = childList
+        self.enter = enter
+        self.exit = exit
+        self.namedIndices = Dictionary(names.enumerated().map { ($1, $0) }, uniquingKeysWith: { first, _ in first })
+    }
+    
+    var count: Int {
+        return parents.count
+    }
+    
+    func parent(of bone: Int) -> Int? {
+        let parent = parents[bone]
+        return parent >= 0 ? Int(parent) : nil
+    }
+    
+    func children(of bone: Int) -> ArraySlice<Int32> {
+        return childList[Int(childStarts[bone]) ..< Int(childStarts[bone + 1])]
+    }
+    
+    // The bone and all its descendants, parents before children
+    func subtree(of bone: Int) -> ArraySlice<Int32> {
+        return preorder[Int(enter[bone]) ..< Int(exit[bone])]
+    }
+    
+    // Whether ancestor is a real ancestor of bone, i.e. a bone is not its own descendant
+    func isDescendant(_ bone: Int, of ancestor: Int) -> Bool {
+        return enter[ancestor] < enter[bone] && enter[bone] < exit[ancestor]
+    }
+    
+    /**
+     * # For every bone, whether it is below any of the given bones.
+     *
+     * The selected bones themselves are only marked if they are below another selected bone. Runs in time linear in the number of bones plus selected bones, independent of the depth of the hierarchy.
+     */
+    func descendantsMask(ofAny selected: [Int]) -> [Bool] {
+        // Coverage changes along the depth first order; add one where a subtree starts, remove where it ends
+        var coverageChange = Array(repeating: Int32(0), count: count + 1)
+        for ancestor in selected {
+            coverageChange[Int(enter[ancestor]) + 1] += 1
+            coverageChange[Int(exit[ancestor])] -= 1
+        }
+        
+        var mask = Array(repeating: false, count: count)
+        var coverage = Int32(0)
+        for position in 0 ..< count {
+            coverage += coverageChange[position]
+            mask[Int(preorder[position])] = coverage > 0
+        }
+        return mask
+    }
+    
+    func index(named name: String) -> Int? {
+        return namedIndices[name]
+    }
+}
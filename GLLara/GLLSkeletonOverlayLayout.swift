@@ -0,0 +1,77 @@
+//
+//  GLLSkeletonOverlayLayout.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+
+/**
+ * # Everything about the skeleton overlay that does not depend on the pose.
+ *
+ * Every displayed bone gets one vertex (its slot) and one line to its parent. Which slot the parent has, and which color a bone gets, only changes when the selection or the displayed bones change, so it gets computed only then. After a pose change, only the positions have to be written again.
+ */
+struct GLLSkeletonOverlayLayout {
+    struct Colors {
+        var selected: vector_uchar4
+        var childOfSelected: vector_uchar4
+        var normal: vector_uchar4
+    }
+    
+    // For every slot, the slot of the parent bone, or the slot itself if the parent is not displayed
+    private(set) var parentSlots: [UInt16] = []
+    private(set) var isSelected = GLLBitSet(count: 0)
+    private(set) var isChildOfSelected = GLLBitSet(count: 0)
+    
+    var count: Int {
+        return parentSlots.count
+    }
+    
+    var elementCount: Int {
+        return 2 * count
+    }
+    
+    /**
+     * # Adds the bones of one item.
+     *
+     * The parents are indices into the bones of this item, -1 if the bone has no parent or it is not displayed. The bit sets have to have one entry for every bone of this item.
+     */
+    mutating func appendItem(parents: [Int], isSelected selected: GLLBitSet, isChildOfSelected childOfSelected: GLLBitSet) {
+        precondition(selected.count == parents.count && childOfSelected.count == parents.count)
+        let base = count
+        precondition(base + parents.count <= Int(UInt16.max) + 1, "Too many bones for 16 bit elements")
+        
+        parentSlots.reserveCapacity(base + parents.count)
+        for (bone, parent) in parents.enumerated() {
+            parentSlots.append(UInt16(base + (parent >= 0 ? parent : bone)))
+        }
+        
+        isSelected.append(contentsOf: selected)
+        isChildOfSelected.append(contentsOf: childOfSelected)
+    }
+    
+    // Writes colors and elements. Positions are left alone.
+    func writeStaticData(colors: Colors, vertices: UnsafeMutablePointer<GLLSkeletonDrawerVertex>, elements: UnsafeMutablePointer<UInt16>) {
+        for slot in 0 ..< count {
+            if isSelected.contains(slot) {
+                vertices[slot].color = colors.selected
+            } else if isChildOfSelected.contains(slot) {
+                vertices[slot].color = colors.childOfSelected
+            } else {
+                vertices[slot].color = colors.normal
+            }
+            
+            elements[slot * 2 + 0] = UInt16(slot)
+            elements[slot * 2 + 1] = parentSlots[slot]
+        }
+    }
+    
+    // Writes only the positions, the rest of the vertex stays as it is.
+    func writePositions(vertices: UnsafeMutablePointer<GLLSkeletonDrawerVertex>, position: (Int) -> vector_float3) {
+        for slot in 0 ..< count {
+            vertices[slot].position = position(slot)
+        }
+    }
+}
@@ -0,0 +1,554 @@
+//
+//  GLLSoftwareRasterizer.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # A mesh for the software renderer.
+ *
+ * The vertices are already posed and in world space, i.e. the skinning part of the vertex shader has been done by GLLCPUSkinner. Everything else the vertex shader does happens in the rasterizer.
+ */
+struct GLLSoftwareDrawable {
+    enum CullMode {
+        case none
+        // Faces that are counter-clockwise on screen, like Metal's default
+        case back
+        case front
+    }
+    
+    var positions: [SIMD3<Float>]
+    var normals: [SIMD3<Float>]
+    // Per vertex, only needed for bump mapping. Like on the GPU, the columns get interpolated without normalizing them.
+    var tangentToWorld: [matrix_float3x3] = []
+    // One array per UV layer, at most four
+    var texCoords: [[SIMD2<Float>]] = []
+    // Empty means white
+    var colors: [SIMD4<Float>] = []
+    var indices: [UInt32]
+    var material: GLLSoftwareMaterial
+    var cullMode: CullMode = .back
+}
+
+/**
+ * # The result of the software renderer.
+ *
+ * RGBA from 0 to 1, top row first, like a Metal texture.
+ */
+struct GLLSoftwareImage {
+    let width: Int
+    let height: Int
+    var pixels: [SIMD4<Float>]
+    
+    init(width: Int, height: Int, pixels: [SIMD4<Float>]) {
+        precondition(pixels.count == width * height)
+        self.width = width
+        self.height = height
+        self.pixels = pixels
+    }
+    
+    subscript(x: Int, y: Int) -> SIMD4<Float> {
+        return pixels[y * width + x]
+    }
+    
+    // Eight bits per channel in BGRA order, which is what GLLViewDrawer reads back from the GPU
+    var bgra8Data: Data {
+        var data = Data(count: width * height * 4)
+        data.withUnsafeMutableBytes { bytes in
+            for (i, pixel) in pixels.enumerated() {
+                let quantized = (GLLSoftwareRasterizer.quantize(pixel) * 255).rounded()
+                bytes[i*4 + 0] = UInt8(quantized.z)
+                bytes[i*4 + 1] = UInt8(quantized.y)
+                bytes[i*4 + 2] = UInt8(quantized.x)
+                bytes[i*4 + 3] = UInt8(quantized.w)
+            }
+        }
+        return data
+    }
+}
+
+/**
+ * # Draws scenes on the CPU, for machines without a GPU.
+ *
+ * Produces the same image as GLLViewDrawer: solid meshes with a depth buffer, then up to seven layers of depth peeling for blended meshes, combined back to front. The clip space is Metal's, so depth goes from 0 to 1 and the near half of what the camera matrix calls the view volume gets clipped, like on the GPU.
+ *
+ * The screen is split into tiles, and every triangle gets sorted into the tiles that it touches. The tiles get rendered on all cores at the same time; each one does the solid pass, all peel layers and the combining on its own, so they need no synchronization. Within a tile, coverage and depth get tested for eight pixels at once, and only the pixels that pass get shaded.
+ */
+final class GLLSoftwareRasterizer {
+    struct Statistics {
+        var triangles = 0
+        var culledTriangles = 0
+        var clippedTriangles = 0
+        var shadedFragments = 0
+        // The most peel layers that any tile actually needed
+        var depthPeelLayers = 0
+    }
+    
+    let width: Int
+    let height: Int
+    let tileSize: Int
+    // Same as the GPU, which has eight color textures, one of them for the solid meshes
+    var depthPeelLayerCount = 7
+    var clearColor = SIMD4<Float>(0.2, 0.2, 0.2, 1.0)
+    private(set) var statistics = Statistics()
+    
+    static let defaultTileSize = 32
+    // Triangles that one worker sets up at a time
+    private static let trianglesPerChunk = 4096
+    
+    init(width: Int, height: Int, tileSize: Int = GLLSoftwareRasterizer.defaultTileSize) {
+        precondition(width > 0 && height > 0 && tileSize > 0)
+        self.width = width
+        self.height = height
+        self.tileSize = tileSize
+    }
+    
+    private var tilesPerRow: Int {
+        return (width + tileSize - 1) / tileSize
+    }
+    
+    private var tileRows: Int {
+        return (height + tileSize - 1) / tileSize
+    }
+    
+    func render(drawables: [GLLSoftwareDrawable], viewProjection: matrix_float4x4, lights: GLLSoftwareLights) -> GLLSoftwareImage {
+        statistics = Statistics()
+        
+        let shaders = drawables.map { GLLSoftwareShader(material: $0.material, lights: lights, numberOfTexCoordSets: $0.texCoords.count) }
+        
+        // Vertex stage and triangle setup
+        var solid: [SetupTriangle] = []
+        var blended: [SetupTriangle] = []
+        for (index, drawable) in drawables.enumerated() {
+            let triangles = setUp(drawable: drawable, index: index, viewProjection: viewProjection)
+            if drawable.material.isBlended {
+                blended.append(contentsOf: triangles)
+            } else {
+                solid.append(contentsOf: triangles)
+            }
+        }
+        
+        // Binning, in submission order so ties in depth go the same way as on the GPU
+        let solidBins = bin(solid)
+        let blendedBins = bin(blended)
+        
+        // Rasterizing
+        var pixels = Array(repeating: SIMD4<Float>(), count: width * height)
+        var tileStatistics = Array(repeating: Statistics(), count: tilesPerRow * tileRows)
+        pixels.withUnsafeMutableBufferPointer { pixels in
+            tileStatistics.withUnsafeMutableBufferPointer { tileStatistics in
+                DispatchQueue.concurrentPerform(iterations: tilesPerRow * tileRows) { tile in
+                    var tileRenderer = TileRenderer(rasterizer: self, tile: tile, drawables: drawables, shaders: shaders)
+                    tileRenderer.render(solid: solid, solidBin: solidBins[tile], blended: blended, blendedBin: blendedBins[tile], into: pixels)
+                    tileStatistics[tile] = tileRenderer.statistics
+                }
+            }
+        }
+        for tile in tileStatistics {
+            statistics.shadedFragments += tile.shadedFragments
+            statistics.depthPeelLayers = max(statistics.depthPeelLayers, tile.depthPeelLayers)
+        }
+        
+        return GLLSoftwareImage(width: width, height: height, pixels: pixels)
+    }
+    
+    // MARK: - Triangle setup
+    
+    // A triangle in screen space, ready for rasterizing. After clipping, one triangle of the drawable can become several of these.
+    fileprivate struct SetupTriangle {
+        var drawable: Int
+        // Of the original triangle in the drawable
+        var vertices: SIMD3<UInt32>
+        // Columns are the barycentric coordinates of the corners within the original triangle. The identity unless clipped.
+        var corners: matrix_float3x3
+        // Edge functions, positive inside
+        var edgeA: SIMD3<Float>
+        var edgeB: SIMD3<Float>
+        var edgeC: SIMD3<Float>
+        // Whether pixel centers exactly on an edge count as inside
+        var includesEdge: SIMD3<Float>
+        var inverseArea: Float
+        var depth: SIMD3<Float>
+        var inverseW: SIMD3<Float>
+        // Inclusive pixel bounds
+        var minX: Int
+        var minY: Int
+        var maxX: Int
+        var maxY: Int
+    }
+    
+    private struct ClipVertex {
+        var position: SIMD4<Float>
+        var barycentric: SIMD3<Float>
+    }
+    
+    private func setUp(drawable: GLLSoftwareDrawable, index: Int, viewProjection: matrix_float4x4) -> [SetupTriangle] {
+        let triangleCount = drawable.indices.count / 3
+        let chunks = (triangleCount + GLLSoftwareRasterizer.trianglesPerChunk - 1) / GLLSoftwareRasterizer.trianglesPerChunk
+        
+        // The vertex shader, minus skinning
+        var clipPositions = Array(repeating: SIMD4<Float>(), count: drawable.positions.count)
+        clipPositions.withUnsafeMutableBufferPointer { clipPositions in
+            let vertexChunks = (drawable.positions.count + GLLCPUSkinner.verticesPerChunk - 1) / GLLCPUSkinner.verticesPerChunk
+            DispatchQueue.concurrentPerform(iterations: vertexChunks) { chunk in
+                let start = chunk * GLLCPUSkinner.verticesPerChunk
+                let end = min(start + GLLCPUSkinner.verticesPerChunk, drawable.positions.count)
+                for vertex in start ..< end {
+                    clipPositions[vertex] = viewProjection * SIMD4<Float>(drawable.positions[vertex], 1)
+                }
+            }
+        }
+        
+        var chunkResults = Array(repeating: [SetupTriangle](), count: chunks)
+        var chunkStatistics = Array(repeating: Statistics(), count: chunks)
+        chunkResults.withUnsafeMutableBufferPointer { chunkResults in
+            chunkStatistics.withUnsafeMutableBufferPointer { chunkStatistics in
+                DispatchQueue.concurrentPerform(iterations: chunks) { chunk in
+                    let start = chunk * GLLSoftwareRasterizer.trianglesPerChunk
+                    let end = min(start + GLLSoftwareRasterizer.trianglesPerChunk, triangleCount)
+                    var triangles: [SetupTriangle] = []
+                    var statistics = Statistics()
+                    for triangle in start ..< end {
+                        let vertices = SIMD3<UInt32>(drawable.indices[triangle*3 + 0], drawable.indices[triangle*3 + 1], drawable.indices[triangle*3 + 2])
+                        setUp(triangle: vertices, drawable: index, cullMode: drawable.cullMode, clipPositions: clipPositions, into: &triangles, statistics: &statistics)
+                    }
+                    chunkResults[chunk] = triangles
+                    chunkStatistics[chunk] = statistics
+                }
+            }
+        }
+        
+        for chunk in chunkStatistics {
+            statistics.triangles += chunk.triangles
+            statistics.culledTriangles += chunk.culledTriangles
+            statistics.clippedTriangles += chunk.clippedTriangles
+        }
+        return Array(chunkResults.joined())
+    }
+    
+    private func setUp(triangle vertices: SIMD3<UInt32>, drawable: Int, cullMode: GLLSoftwareDrawable.CullMode, clipPositions: [SIMD4<Float>], into triangles: inout [SetupTriangle], statistics: inout Statistics) {
+        statistics.triangles += 1
+        
+        var polygon = [
+            ClipVertex(position: clipPositions[Int(vertices.x)], barycentric: SIMD3<Float>(1, 0, 0)),
+            ClipVertex(position: clipPositions[Int(vertices.y)], barycentric: SIMD3<Float>(0, 1, 0)),
+            ClipVertex(position: clipPositions[Int(vertices.z)], barycentric: SIMD3<Float>(0, 0, 1))
+        ]
+        
+        // Completely outside one of the side planes
+        let positions = polygon.map { $0.position }
+        if positions.allSatisfy({ $0.x > $0.w }) || positions.allSatisfy({ $0.x < -$0.w }) || positions.allSatisfy({ $0.y > $0.w }) || positions.allSatisfy({ $0.y < -$0.w }) {
+            statistics.culledTriangles += 1
+            return
+        }
+        
+        // Clip against near (z >= 0) and far (z <= w). The sides get handled by the pixel bounds.
+        if positions.contains(where: { $0.z < 0 || $0.z > $0.w }) {
+            polygon = GLLSoftwareRasterizer.clip(polygon) { $0.z }
+            polygon = GLLSoftwareRasterizer.clip(polygon) { $0.w - $0.z }
+            if polygon.count < 3 {
+                statistics.culledTriangles += 1
+                return
+            }
+            statistics.clippedTriangles += 1
+        }
+        
+        for i in 1 ..< polygon.count - 1 {
+            if let triangle = setUp(corners: (polygon[0], polygon[i], polygon[i + 1]), vertices: vertices, drawable: drawable, cullMode: cullMode) {
+                triangles.append(triangle)
+            } else if polygon.count == 3 {
+                statistics.culledTriangles += 1
+            }
+        }
+    }
+    
+    // Sutherland-Hodgman against one plane; distance is positive inside
+    private static func clip(_ polygon: [ClipVertex], distance: (SIMD4<Float>) -> Float) -> [ClipVertex] {
+        var result: [ClipVertex] = []
+        for i in 0 ..< polygon.count {
+            let current = polygon[i]
+            let next = polygon[(i + 1) % polygon.count]
+            let currentDistance = distance(current.position)
+            let nextDistance = distance(next.position)
+            if currentDistance >= 0 {
+                result.append(current)
+            }
+            if (currentDistance >= 0) != (nextDistance >= 0) {
+                // Always from the inside to the outside, so neighbouring triangles get the exact same point on their shared edge
+                let (inside, outside) = currentDistance >= 0 ? (current, next) : (next, current)
+                let insideDistance = max(currentDistance, nextDistance)
+                let t = insideDistance / (insideDistance - min(currentDistance, nextDistance))
+                result.append(ClipVertex(position: simd_mix(inside.position, outside.position, SIMD4<Float>(repeating: t)), barycentric: simd_mix(inside.barycentric, outside.barycentric, SIMD3<Float>(repeating: t))))
+            }
+        }
+        return result
+    }
+    
+    private func setUp(corners: (ClipVertex, ClipVertex, ClipVertex), vertices: SIMD3<UInt32>, drawable: Int, cullMode: GLLSoftwareDrawable.CullMode) -> SetupTriangle? {
+        let w = SIMD3<Float>(corners.0.position.w, corners.1.position.w, corners.2.position.w)
+        guard all(w .> 0) else {
+            return nil
+        }
+        let inverseW = 1 / w
+        
+        // Viewport transform; y goes down on screen
+        let x = SIMD3<Float>(corners.0.position.x, corners.1.position.x, corners.2.position.x) * inverseW
+        let y = SIMD3<Float>(corners.0.position.y, corners.1.position.y, corners.2.position.y) * inverseW
+        let screenX = (x * 0.5 + 0.5) * Float(width)
+        let screenY = (0.5 - y * 0.5) * Float(height)
+        let depth = SIMD3<Float>(corners.0.position.z, corners.1.position.z, corners.2.position.z) * inverseW
+        
+        // Positive for faces that are clockwise on screen, which are the front faces
+        let area = (screenX[1] - screenX[0]) * (screenY[2] - screenY[0]) - (screenX[2] - screenX[0]) * (screenY[1] - screenY[0])
+        guard area != 0 && area.isFinite else {
+            return nil
+        }
+        switch cullMode {
+        case .back where area < 0:
+            return nil
+        case .front where area > 0:
+            return nil
+        default:
+            break
+        }
+        
+        // Edge i is the one opposite corner i, and is zero on it
+        let nextX = SIMD3<Float>(screenX[1], screenX[2], screenX[0])
+        let nextY = SIMD3<Float>(screenY[1], screenY[2], screenY[0])
+        let lastX = SIMD3<Float>(screenX[2], screenX[0], screenX[1])
+        let lastY = SIMD3<Float>(screenY[2], screenY[0], screenY[1])
+        let orientation: Float = area > 0 ? 1 : -1
+        let edgeA = -(lastY - nextY) * orientation
+        let edgeB = (lastX - nextX) * orientation
+        // Two triangles that share an edge have to get exactly opposite values on it, so the constant gets calculated from the same end point for both
+        let fromNext = (nextX .< lastX) .| ((nextX .== lastX) .& (nextY .< lastY))
+        let baseX = lastX.replacing(with: nextX, where: fromNext)
+        let baseY = lastY.replacing(with: nextY, where: fromNext)
+        let edgeC = -(edgeA * baseX + edgeB * baseY)
+        // Top left rule: Of two triangles sharing an edge, exactly one gets the pixels on it
+        let includesEdge = SIMD3<Float>(repeating: 1).replacing(with: 0, where: .!((edgeA .> 0) .| ((edgeA .== 0) .& (edgeB .> 0))))
+        
+        let minX = max(Int(screenX.min().rounded(.down)), 0)
+        let minY = max(Int(screenY.min().rounded(.down)), 0)
+        let maxX = min(Int(screenX.max().rounded(.up)), width - 1)
+        let maxY = min(Int(screenY.max().rounded(.up)), height - 1)
+        guard minX <= maxX && minY <= maxY else {
+            return nil
+        }
+        
+        return SetupTriangle(drawable: drawable,
+                             vertices: vertices,
+                             corners: matrix_float3x3(columns: (corners.0.barycentric, corners.1.barycentric, corners.2.barycentric)),
+                             edgeA: edgeA, edgeB: edgeB, edgeC: edgeC,
+                             includesEdge: includesEdge,
+                             inverseArea: 1 / abs(area),
+                             depth: depth,
+                             inverseW: inverseW,
+                             minX: minX, minY: minY, maxX: maxX, maxY: maxY)
+    }
+    
+    // For every tile, the indices of the triangles that touch it
+    private func bin(_ triangles: [SetupTriangle]) -> [[Int]] {
+        var bins = Array(repeating: [Int](), count: tilesPerRow * tileRows)
+        for (index, triangle) in triangles.enumerated() {
+            for tileY in (triangle.minY / tileSize) ... (triangle.maxY / tileSize) {
+                for tileX in (triangle.minX / tileSize) ... (triangle.maxX / tileSize) {
+                    bins[tileY * tilesPerRow + tileX].append(index)
+                }
+            }
+        }
+        return bins
+    }
+    
+    // MARK: - Tiles
+    
+    private struct TileRenderer {
+        let rasterizer: GLLSoftwareRasterizer
+        let drawables: [GLLSoftwareDrawable]
+        let shaders: [GLLSoftwareShader]
+        let originX: Int
+        let originY: Int
+        let tileWidth: Int
+        let tileHeight: Int
+        var statistics = Statistics()
+        
+        // Where the current pass writes to
+        private var color: [SIMD4<Float>]
+        private var depth: [Float]
+        // Only fragments behind this get drawn while peeling
+        private var frontDepth: [Float]
+        
+        init(rasterizer: GLLSoftwareRasterizer, tile: Int, drawables: [GLLSoftwareDrawable], shaders: [GLLSoftwareShader]) {
+            self.rasterizer = rasterizer
+            self.drawables = drawables
+            self.shaders = shaders
+            originX = (tile % rasterizer.tilesPerRow) * rasterizer.tileSize
+            originY = (tile / rasterizer.tilesPerRow) * rasterizer.tileSize
+            tileWidth = min(rasterizer.tileSize, rasterizer.width - originX)
+            tileHeight = min(rasterizer.tileSize, rasterizer.height - originY)
+            color = Array(repeating: SIMD4<Float>(), count: tileWidth * tileHeight)
+            depth = Array(repeating: 1, count: tileWidth * tileHeight)
+            frontDepth = Array(repeating: 0, count: tileWidth * tileHeight)
+        }
+        
+        mutating func render(solid: [SetupTriangle], solidBin: [Int], blended: [SetupTriangle], blendedBin: [Int], into pixels: UnsafeMutableBufferPointer<SIMD4<Float>>) {
+            // Solid pass; the render targets are eight bit per channel
+            for index in solidBin {
+                rasterize(solid[index], peeling: false)
+            }
+            let solidColor = color.map(GLLSoftwareRasterizer.quantize)
+            let solidDepth = depth
+            
+            // Peel passes: Each finds the nearest blended fragment behind the one of the previous layer, but in front of the solid ones
+            var layers: [[SIMD4<Float>]] = []
+            if !blendedBin.isEmpty {
+                for _ in 0 ..< rasterizer.depthPeelLayerCount {
+                    color = Array(repeating: SIMD4<Float>(), count: tileWidth * tileHeight)
+                    depth = solidDepth
+                    let fragmentsBefore = statistics.shadedFragments
+                    for index in blendedBin {
+                        rasterize(blended[index], peeling: true)
+                    }
+                    if statistics.shadedFragments == fragmentsBefore {
+                        // Nothing left, and the layers after this would be empty as well
+                        break
+                    }
+                    layers.append(color.map(GLLSoftwareRasterizer.quantize))
+                    frontDepth = depth
+                }
+            }
+            statistics.depthPeelLayers = layers.count
+            
+            // Combine like the final pass: solid first, then the peel layers from back to front. Alpha is the maximum.
+            for y in 0 ..< tileHeight {
+                for x in 0 ..< tileWidth {
+                    let pixel = y * tileWidth + x
+                    var result = rasterizer.clearColor
+                    result = GLLSoftwareRasterizer.blend(solidColor[pixel], over: result)
+                    for layer in layers.reversed() {
+                        result = GLLSoftwareRasterizer.blend(layer[pixel], over: result)
+                    }
+                    pixels[(originY + y) * rasterizer.width + originX + x] = result
+                }
+            }
+        }
+        
+        private mutating func rasterize(_ triangle: SetupTriangle, peeling: Bool) {
+            let minX = max(triangle.minX, originX)
+            let maxX = min(triangle.maxX, originX + tileWidth - 1)
+            let minY = max(triangle.minY, originY)
+            let maxY = min(triangle.maxY, originY + tileHeight - 1)
+            guard minX <= maxX && minY <= maxY else {
+                return
+            }
+            
+            let laneOffsets = SIMD8<Float>(0.5, 1.5, 2.5, 3.5, 4.5, 5.5, 6.5, 7.5)
+            for y in minY ... maxY {
+                let centerY = Float(y) + 0.5
+                for x in stride(from: minX, through: maxX, by: 8) {
+                    let lanes = min(8, maxX - x + 1)
+                    let centerX = Float(x) + laneOffsets
+                    
+                    // Coverage for eight pixels
+                    var covered = SIMDMask<SIMD8<Int32>>(repeating: true)
+                    var barycentric = (SIMD8<Float>(), SIMD8<Float>(), SIMD8<Float>())
+                    for edge in 0 ..< 3 {
+                        let value = triangle.edgeA[edge] * centerX + (triangle.edgeB[edge] * centerY + triangle.edgeC[edge])
+                        covered .&= (value .> 0) .| ((value .== 0) .& (triangle.includesEdge[edge] != 0))
+                        switch edge {
+                        case 0: barycentric.0 = value * triangle.inverseArea
+                        case 1: barycentric.1 = value * triangle.inverseArea
+                        default: barycentric.2 = value * triangle.inverseArea
+                        }
+                    }
+                    if lanes < 8 {
+                        covered .&= SIMD8<Int32>(0, 1, 2, 3, 4, 5, 6, 7) .< Int32(lanes)
+                    }
+                    guard any(covered) else {
+                        continue
+                    }
+                    
+                    // Depth test for the same eight pixels
+                    let fragmentDepth = barycentric.0 * triangle.depth[0] + barycentric.1 * triangle.depth[1] + barycentric.2 * triangle.depth[2]
+                    let rowStart = (y - originY) * tileWidth + (x - originX)
+                    var currentDepth = SIMD8<Float>(repeating: 0)
+                    var currentFront = SIMD8<Float>(repeating: 0)
+                    for lane in 0 ..< lanes {
+                        currentDepth[lane] = depth[rowStart + lane]
+                        currentFront[lane] = frontDepth[rowStart + lane]
+                    }
+                    covered .&= fragmentDepth .< currentDepth
+                    if peeling {
+                        covered .&= fragmentDepth .> currentFront
+                    }
+                    guard any(covered) else {
+                        continue
+                    }
+                    
+                    for lane in 0 ..< lanes where covered[lane] {
+                        let screenBarycentric = SIMD3<Float>(barycentric.0[lane], barycentric.1[lane], barycentric.2[lane])
+                        color[rowStart + lane] = shade(triangle, screenBarycentric: screenBarycentric)
+                        depth[rowStart + lane] = fragmentDepth[lane]
+                        statistics.shadedFragments += 1
+                    }
+                }
+            }
+        }
+        
+        private func shade(_ triangle: SetupTriangle, screenBarycentric: SIMD3<Float>) -> SIMD4<Float> {
+            // Perspective correct, then back to the original triangle
+            let weighted = screenBarycentric * triangle.inverseW
+            let barycentric = triangle.corners * (weighted / weighted.sum())
+            
+            let drawable = drawables[triangle.drawable]
+            let a = Int(triangle.vertices.x), b = Int(triangle.vertices.y), c = Int(triangle.vertices.z)
+            @inline(__always) func interpolate(_ values: [SIMD2<Float>]) -> SIMD2<Float> {
+                return values[a] * barycentric.x + values[b] * barycentric.y + values[c] * barycentric.z
+            }
+            
+            var fragment = GLLSoftwareFragment()
+            fragment.worldPosition = drawable.positions[a] * barycentric.x + drawable.positions[b] * barycentric.y + drawable.positions[c] * barycentric.z
+            fragment.normalWorld = drawable.normals[a] * barycentric.x + drawable.normals[b] * barycentric.y + drawable.normals[c] * barycentric.z
+            if !drawable.colors.isEmpty {
+                fragment.color = drawable.colors[a] * barycentric.x + drawable.colors[b] * barycentric.y + drawable.colors[c] * barycentric.z
+            }
+            if !drawable.tangentToWorld.isEmpty {
+                fragment.tangentToWorld = drawable.tangentToWorld[a] * barycentric.x + drawable.tangentToWorld[b] * barycentric.y + drawable.tangentToWorld[c] * barycentric.z
+            }
+            let texCoords = drawable.texCoords
+            if texCoords.count > 0 {
+                fragment.texCoords.0 = interpolate(texCoords[0])
+            }
+            if texCoords.count > 1 {
+                fragment.texCoords.1 = interpolate(texCoords[1])
+            }
+            if texCoords.count > 2 {
+                fragment.texCoords.2 = interpolate(texCoords[2])
+            }
+            if texCoords.count > 3 {
+                fragment.texCoords.3 = interpolate(texCoords[3])
+            }
+            
+            return shaders[triangle.drawable].shade(fragment)
+        }
+    }
+    
+    // MARK: - Blending
+    
+    // What storing in a bgra8Unorm texture does
+    fileprivate static func quantize(_ color: SIMD4<Float>) -> SIMD4<Float> {
+        return (simd_clamp(color, SIMD4<Float>(repeating: 0), SIMD4<Float>(repeating: 1)) * 255).rounded(.toNearestOrAwayFromZero) / 255
+    }
+    
+    // The blend state of the square pipeline in GLLResourceManager
+    static func blend(_ source: SIMD4<Float>, over destination: SIMD4<Float>) -> SIMD4<Float> {
+        var result = source * source.w + destination * (1 - source.w)
+        result.w = max(source.w, destination.w)
+        return result
+    }
+}
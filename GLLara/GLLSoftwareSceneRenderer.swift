@@ -0,0 +1,353 @@
+//
+//  GLLSoftwareSceneRenderer.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import CoreData
+import CoreGraphics
+import ImageIO
+import Accelerate
+import UniformTypeIdentifiers
+
+/**
+ * # Renders a scene to a file without a GPU.
+ *
+ * Does what GLLViewDrawer's writeImage does, but with GLLSoftwareRasterizer. It only needs the managed object context and a camera, not a document window or Metal device, so it works on machines without a graphics card. The render window uses it when the ForceSoftwareRendering preference is set.
+ */
+@objc class GLLSoftwareSceneRenderer: NSObject {
+    let managedObjectContext: NSManagedObjectContext
+    let camera: GLLCamera
+    
+    // What the rasterizer did for the last image
+    private(set) var statistics = GLLSoftwareRasterizer.Statistics()
+    
+    // Textures only get loaded once, even if several meshes use them
+    private var textureCache: [URL: GLLSoftwareTexture] = [:]
+    
+    // Textures that could not be loaded and were replaced with the defaults, like GLLItemDrawer's. The caller should tell the user.
+    @objc private(set) var replacedTextures: [URL: NSError] = [:]
+    
+    @objc init(managedObjectContext: NSManagedObjectContext, camera: GLLCamera) {
+        self.managedObjectContext = managedObjectContext
+        self.camera = camera
+    }
+    
+    @objc func writeImage(to url: URL, fileType: UTType, size: CGSize, transparentBackground: Bool) throws {
+        let width = Int(size.width)
+        let height = Int(size.height)
+        
+        // Streamed like in GLLViewDrawer, so posters don't need the whole image in memory
+        if let format = GLLStreamingImageEncoder.Format(fileType: fileType) {
+            let encoder = try GLLStreamingImageEncoder(format: format, width: width, height: height, url: url)
+            try renderImageTiles(width: width, height: height, transparentBackground: transparentBackground) { rows, bytesPerRow, count in
+                try encoder.append(bgra8Rows: rows, bytesPerRow: bytesPerRow, count: count)
+            }
+            try encoder.finish()
+            return
+        }
+        
+        let image = try renderImage(width: width, height: height, transparentBackground: transparentBackground)
+        try GLLViewDrawer.writeImage(bgra8Data: image.bgra8Data, width: image.width, height: image.height, to: url, fileType: fileType)
+    }
+    
+    func renderImage(width: Int, height: Int, transparentBackground: Bool) throws -> GLLSoftwareImage {
+        let rasterizer = GLLSoftwareRasterizer(width: width, height: height)
+        rasterizer.clearColor = transparentBackground ? SIMD4<Float>(repeating: 0) : SIMD4<Float>(0.2, 0.2, 0.2, 1.0)
+        
+        let viewProjection = camera.viewProjectionMatrix(forAspectRatio: Float(width) / Float(height))
+        let image = rasterizer.render(drawables: try drawables(), viewProjection: viewProjection, lights: try lights())
+        statistics = rasterizer.statistics
+        return image
+    }
+    
+    // Same as GLLViewDrawer's: Bands of BGRA rows from the top, only valid during the call
+    func renderImageTiles(width: Int, height: Int, transparentBackground: Bool, band: (UnsafeRawBufferPointer, Int, Int) throws -> Void) throws {
+        let tiling = GLLImageTiling(width: width, height: height, maximumTileSize: GLLViewDrawer.maximumImageTileSize)
+        let fullViewProjection = camera.viewProjectionMatrix(forAspectRatio: Float(width) / Float(height))
+        let drawables = try drawables()
+        let lights = try lights()
+        
+        let rasterizer = GLLSoftwareRasterizer(width: tiling.tileWidth, height: tiling.tileHeight)
+        rasterizer.clearColor = transparentBackground ? SIMD4<Float>(repeating: 0) : SIMD4<Float>(0.2, 0.2, 0.2, 1.0)
+        
+        let bytesPerRow = width * 4
+        var bandData = Data(count: bytesPerRow * tiling.tileHeight)
+        statistics = GLLSoftwareRasterizer.Statistics()
+        for row in 0 ..< tiling.tileRows {
+            let tiles = tiling.tiles(inRow: row)
+            for tile in tiles {
+                let tileData = rasterizer.render(drawables: drawables, viewProjection: tiling.viewProjection(for: tile, fullViewProjection: fullViewProjection), lights: lights).bgra8Data
+                bandData.withUnsafeMutableBytes { bandBytes in
+                    tileData.withUnsafeBytes { tileBytes in
+                        for y in 0 ..< tile.height {
+                            let source = UnsafeRawBufferPointer(rebasing: tileBytes[y * tiling.tileWidth * 4 ..< (y * tiling.tileWidth + tile.width) * 4])
+                            UnsafeMutableRawBufferPointer(rebasing: bandBytes[y * bytesPerRow + tile.x * 4 ..< y * bytesPerRow + (tile.x + tile.width) * 4]).copyMemory(from: source)
+                        }
+                    }
+                }
+                statistics.triangles += rasterizer.statistics.triangles
+                statistics.culledTriangles += rasterizer.statistics.culledTriangles
+                statistics.clippedTriangles += rasterizer.statistics.clippedTriangles
+                statistics.shadedFragments += rasterizer.statistics.shadedFragments
+                statistics.depthPeelLayers = max(statistics.depthPeelLayers, rasterizer.statistics.depthPeelLayers)
+            }
+            
+            try bandData.withUnsafeBytes { bytes in
+                try band(bytes, bytesPerRow, tiles[0].height)
+            }
+        }
+    }
+    
+    // MARK: - Scene
+    
+    /**
+     * The ambient and directional lights, packed the same way GLLViewDrawer does it.
+     *
+     * The CPU path is directional-only. GLLSoftwareShading has no clustered lighting, so the document's positional lights are not in the file.
+     */
+    private func lights() throws -> GLLSoftwareLights {
+        let ambientRequest = NSFetchRequest<GLLAmbientLight>()
+        ambientRequest.entity = NSEntityDescription.entity(forEntityName: "GLLAmbientLight", in: managedObjectContext)
+        let ambientLight = try managedObjectContext.fetch(ambientRequest)[0]
+        
+        let directionalLightRequest = NSFetchRequest<GLLDirectionalLight>()
+        directionalLightRequest.entity = NSEntityDescription.entity(forEntityName: "GLLDirectionalLight", in: managedObjectContext)
+        directionalLightRequest.sortDescriptors = [NSSortDescriptor(key: "index", ascending: true)]
+        let directionalLights = try managedObjectContext.fetch(directionalLightRequest)
+        
+        var lightData = GLLLightsBuffer()
+        lightData.cameraPosition = camera.cameraWorldPosition
+        lightData.ambientColor = ambientLight.color.rgbaComponents128Bit
+        return GLLSoftwareLights(lightData, directionalLights: GLLDirectionalLight.enabledUniformBlocks(directionalLights))
+    }
+    
+    private func drawables() throws -> [GLLSoftwareDrawable] {
+        let allItemsRequest = NSFetchRequest<GLLItem>()
+        allItemsRequest.entity = NSEntityDescription.entity(forEntityName: "GLLItem", in: managedObjectContext)
+        let allItems = try managedObjectContext.fetch(allItemsRequest)
+        
+        replacedTextures = [:]
+        var drawables: [GLLSoftwareDrawable] = []
+        for item in allItems {
+            let transforms = item.skinningTransforms(posed: true)
+            for mesh in item.meshes {
+                let itemMesh = mesh as! GLLItemMesh
+                guard itemMesh.isVisible, let shader = itemMesh.shader else {
+                    continue
+                }
+                drawables.append(drawable(for: itemMesh, shader: shader, transforms: transforms))
+            }
+        }
+        return drawables
+    }
+    
+    // Does the vertex shader's work up to the view projection, and gathers the fragment shader's inputs
+    private func drawable(for itemMesh: GLLItemMesh, shader: GLLShaderData, transforms: [matrix_float4x4]) -> GLLSoftwareDrawable {
+        let mesh = itemMesh.mesh
+        let accessors = mesh.vertexDataAccessors!
+        let features = Set((shader.activeBoolConstants as IndexSet).compactMap { GLLFunctionConstant(rawValue: $0) })
+        
+        // Without skinning, the shader uses the first bone for everything
+        var skinner = mesh.cpuSkinner
+        if !features.contains(.useSkinning) && mesh.variableBoneWeights == nil {
+            skinner = GLLCPUSkinner(positions: skinner.positions, normals: skinner.normals, tangents: skinner.tangents, boneData: .none)
+        }
+        let skinned = skinner.skin(transforms: transforms, morphDeltas: mesh.morphDeltas(weights: itemMesh.morphTargetWeights))
+        
+        var material = GLLSoftwareMaterial(features: features, isBlended: shader.alphaBlending)
+        material.parameters = itemMesh.fragmentParameters
+        for identifier in shader.textureUniforms {
+            guard let slot = GLLSoftwareMaterial.TextureSlot(identifier: identifier) else {
+                continue
+            }
+            material.set(texture: texture(for: itemMesh, identifier: identifier), for: slot, texCoordSet: itemMesh.texCoordSet(forTexture: identifier))
+        }
+        
+        var drawable = GLLSoftwareDrawable(positions: skinned.positions, normals: skinned.normals, indices: (0 ..< mesh.countOfUsedElements).map { UInt32(mesh.element(at: $0)) }, material: material)
+        
+        for layer in 0 ..< min(mesh.countOfUVLayers, 4) {
+            guard let texCoordAccessor = accessors.accessor(semantic: .texCoord0, layer: layer) else {
+                break
+            }
+            drawable.texCoords.append(texCoordAccessor.simdArray(count: mesh.countOfVertices, type: SIMD2<Float>.self))
+        }
+        
+        if let colorAccessor = accessors.accessor(semantic: .color) {
+            if colorAccessor.attribute.format == .float4 {
+                drawable.colors = colorAccessor.simdArray(count: mesh.countOfVertices, type: SIMD4<Float>.self)
+            } else {
+                drawable.colors = colorAccessor.simdArray(count: mesh.countOfVertices, type: SIMD4<UInt8>.self).map { SIMD4<Float>($0) / 255.0 }
+            }
+        }
+        
+        // Like the vertex shader, this uses the unposed normal and tangent with the first bone only
+        if features.contains(.calculateTangentWorld) && !drawable.texCoords.isEmpty && !skinner.tangents.isEmpty {
+            let bone = transforms[0]
+            let boneUpperLeft = matrix_float3x3(columns: (upperLeft(bone.columns.0), upperLeft(bone.columns.1), upperLeft(bone.columns.2)))
+            let permutation = itemMesh.item.normalChannelPermutation
+            let permutationUpperLeft = matrix_float3x3(columns: (upperLeft(permutation.columns.0), upperLeft(permutation.columns.1), upperLeft(permutation.columns.2)))
+            drawable.tangentToWorld = zip(skinner.normals, skinner.tangents[0]).map { normal, tangent in
+                let normal = simd_normalize(normal)
+                let tangentU = simd_normalize(upperLeft(tangent))
+                let tangentV = simd_normalize(simd_cross(normal, tangentU) * (tangent.w < 0 ? -1 : 1))
+                return boneUpperLeft * matrix_float3x3(columns: (tangentU, tangentV, normal)) * permutationUpperLeft
+            }
+        }
+        
+        switch GLLCullFaceMode(rawValue: Int(itemMesh.cullFaceMode))! {
+        case .counterClockWise:
+            drawable.cullMode = .back
+        case .clockWise:
+            drawable.cullMode = .front
+        case .none:
+            drawable.cullMode = .none
+        @unknown default:
+            fatalError()
+        }
+        return drawable
+    }
+    
+    private func upperLeft(_ column: SIMD4<Float>) -> SIMD3<Float> {
+        return SIMD3<Float>(column.x, column.y, column.z)
+    }
+    
+    // MARK: - Textures
+    
+    // Same order as GLLItemMeshState: The user's file, then the model's data, then the default for that texture
+    private func texture(for itemMesh: GLLItemMesh, identifier: String) -> GLLSoftwareTexture {
+        if let url = itemMesh.texture(identifier: identifier)?.textureURL {
+            do {
+                return try texture(url: url as URL)
+            } catch {
+                replacedTextures[url as URL] = error as NSError
+            }
+        } else if let data = itemMesh.mesh.textures[identifier]?.data {
+            do {
+                return try GLLSoftwareTexture(data: data)
+            } catch {
+                // Same URL as GLLItemMeshState shows for embedded textures
+                replacedTextures[itemMesh.mesh.model!.baseURL] = error as NSError
+            }
+        }
+        return (try? texture(url: itemMesh.mesh.model!.parameters.defaultValue(forTexture: identifier))) ?? .white
+    }
+    
+    private func texture(url: URL) throws -> GLLSoftwareTexture {
+        if let texture = textureCache[url] {
+            return texture
+        }
+        let texture = try GLLSoftwareTexture(contentsOf: url)
+        textureCache[url] = texture
+        return texture
+    }
+}
+
+extension GLLSoftwareTexture {
+    init(contentsOf url: URL) throws {
+        try self.init(data: Data(contentsOf: url, options: [.mappedIfSafe]))
+    }
+    
+    /**
+     * # Loads the same file types as GLLTexture.
+     *
+     * DDS files get decoded here, including the block compressed formats; everything else goes through ImageIO. Only the first mipmap level gets used.
+     */
+    init(data: Data) throws {
+        guard data.count >= 4 else {
+            throw NSError(domain: "Textures", code: 12, userInfo: [
+                NSLocalizedDescriptionKey: NSLocalizedString("Texture file couldn't be opened because it is too short.", comment: "Data count smaller 4")
+            ])
+        }
+        
+        if data.starts(with: "DDS ".utf8) {
+            try self.init(ddsFile: GLLDDSFile(data: data))
+        } else {
+            try self.init(cgCompatibleData: data)
+        }
+    }
+    
+    private init(ddsFile: GLLDDSFile) throws {
+        let width = ddsFile.width
+        let height = ddsFile.height
+        guard let data = ddsFile.data(mipmapLevel: 0) else {
+            throw NSError(domain: "Textures", code: 12, userInfo: [
+                NSLocalizedDescriptionKey: NSLocalizedString("DDS File couldn't be opened: No data for mipmap level 0", comment: "Can't find load mipmap level")
+            ])
+        }
+        
+        switch ddsFile.dataFormat {
+        case .dxt1:
+            self.init(width: width, height: height, blocks: data, format: .bc1)
+        case .dxt3:
+            self.init(width: width, height: height, blocks: data, format: .bc2)
+        case .dxt5:
+            self.init(width: width, height: height, blocks: data, format: .bc3)
+        default:
+            let bytes = Array(data)
+            let texels = (0 ..< width * height).map { i in
+                GLLSoftwareTexture.texel(uncompressed: bytes, index: i, format: ddsFile.dataFormat)
+            }
+            self.init(width: width, height: height, texels: texels)
+        }
+    }
+    
+    private static func texel(uncompressed bytes: [UInt8], index i: Int, format: GLLDDSFile.DataFormat) -> SIMD4<Float> {
+        @inline(__always) func bits(_ value: UInt16, shift: UInt16, count: UInt16) -> Float {
+            let mask = UInt16(1 << count) - 1
+            return Float((value >> shift) & mask) / Float(mask)
+        }
+        
+        switch format {
+        case .bgr8:
+            return SIMD4<Float>(Float(bytes[i*3 + 2]), Float(bytes[i*3 + 1]), Float(bytes[i*3 + 0]), 255) / 255
+        case .bgra8:
+            return SIMD4<Float>(Float(bytes[i*4 + 2]), Float(bytes[i*4 + 1]), Float(bytes[i*4 + 0]), Float(bytes[i*4 + 3])) / 255
+        case .bgrx8:
+            return SIMD4<Float>(Float(bytes[i*4 + 2]), Float(bytes[i*4 + 1]), Float(bytes[i*4 + 0]), 255) / 255
+        case .rgba8:
+            return SIMD4<Float>(Float(bytes[i*4 + 0]), Float(bytes[i*4 + 1]), Float(bytes[i*4 + 2]), Float(bytes[i*4 + 3])) / 255
+        case .rgb565:
+            let value = UInt16(bytes[i*2 + 0]) | UInt16(bytes[i*2 + 1]) << 8
+            return SIMD4<Float>(bits(value, shift: 11, count: 5), bits(value, shift: 5, count: 6), bits(value, shift: 0, count: 5), 1)
+        case .argb1555:
+            let value = UInt16(bytes[i*2 + 0]) | UInt16(bytes[i*2 + 1]) << 8
+            return SIMD4<Float>(bits(value, shift: 10, count: 5), bits(value, shift: 5, count: 5), bits(value, shift: 0, count: 5), bits(value, shift: 15, count: 1))
+        case .argb4:
+            let value = UInt16(bytes[i*2 + 0]) | UInt16(bytes[i*2 + 1]) << 8
+            return SIMD4<Float>(bits(value, shift: 8, count: 4), bits(value, shift: 4, count: 4), bits(value, shift: 0, count: 4), bits(value, shift: 12, count: 4))
+        case .dxt1, .dxt3, .dxt5:
+            preconditionFailure("Block compressed data has no single texels")
+        }
+    }
+    
+    private init(cgCompatibleData data: Data) throws {
+        guard let source = CGImageSourceCreateWithData(data as CFData, nil), CGImageSourceGetStatus(source) == .statusComplete, let image = CGImageSourceCreateImageAtIndex(source, 0, nil) else {
+            throw NSError(domain: "Textures", code: 13, userInfo: [
+                NSLocalizedDescriptionKey: NSLocalizedString("Texture file could not be loaded because the data is invalid.", comment: "texture status invalidData")
+            ])
+        }
+        
+        // Unpremultiplied ARGB, like GLLTexture
+        let format = vImage_CGImageFormat(bitsPerComponent: 8, bitsPerPixel: 32, colorSpace: CGColorSpaceCreateDeviceRGB(), bitmapInfo: CGBitmapInfo(rawValue: CGImageAlphaInfo.first.rawValue | CGBitmapInfo.byteOrderDefault.rawValue))!
+        let buffer = try vImage_Buffer(cgImage: image, format: format)
+        defer {
+            buffer.free()
+        }
+        
+        let width = Int(buffer.width)
+        let height = Int(buffer.height)
+        var texels = Array(repeating: SIMD4<Float>(), count: width * height)
+        let bytes = buffer.data.assumingMemoryBound(to: UInt8.self)
+        for y in 0 ..< height {
+            let row = bytes + y * buffer.rowBytes
+            for x in 0 ..< width {
+                texels[y * width + x] = SIMD4<Float>(Float(row[x*4 + 1]), Float(row[x*4 + 2]), Float(row[x*4 + 3]), Float(row[x*4 + 0])) / 255
+            }
+        }
+        self.init(width: width, height: height, texels: texels)
+    }
+}
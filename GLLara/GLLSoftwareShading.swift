@@ -0,0 +1,285 @@
+//
+//  GLLSoftwareShading.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # The render parameter values that the fragment shader uses.
+ *
+ * Some parameters get folded together before they reach the shader; this is the result. Used for the argument buffer and the software renderer alike.
+ */
+struct GLLFragmentParameters {
+    var ambientColor = SIMD4<Float>(repeating: 1)
+    var diffuseColor = SIMD4<Float>(repeating: 1)
+    var specularColor = SIMD4<Float>(repeating: 1)
+    var specularExponent: Float = 0
+    var bump1UVScale: Float = 1
+    var bump2UVScale: Float = 1
+    var specularTextureScale: Float = 1
+    var reflectionAmount: Float = 0
+}
+
+// The lights as the fragment shader sees them
+struct GLLSoftwareLights {
+    var cameraPosition: SIMD3<Float>
+    var ambientColor: SIMD4<Float>
+    var lights: [GLLLightBuffer]
+    
+    init(cameraPosition: SIMD3<Float>, ambientColor: SIMD4<Float>, lights: [GLLLightBuffer]) {
+        self.cameraPosition = cameraPosition
+        self.ambientColor = ambientColor
+        self.lights = lights
+    }
+    
+    init(_ buffer: GLLLightsBuffer, directionalLights: [GLLLightBuffer]) {
+        self.init(cameraPosition: SIMD3<Float>(buffer.cameraPosition.x, buffer.cameraPosition.y, buffer.cameraPosition.z), ambientColor: buffer.ambientColor, lights: directionalLights)
+    }
+}
+
+/**
+ * # What the software renderer knows about a mesh's shader.
+ *
+ * The features are the same function constants that the Metal pipeline gets. Textures and their tex coord sets are indexed by slot.
+ */
+struct GLLSoftwareMaterial {
+    enum TextureSlot: Int, CaseIterable {
+        case diffuse
+        case specular
+        case emission
+        case bump
+        case bump1
+        case bump2
+        case mask
+        case lightmap
+        case reflection
+        
+        // The names used in shader descriptions and model files
+        init?(identifier: String) {
+            switch identifier {
+            case "diffuseTexture": self = .diffuse
+            case "specularTexture": self = .specular
+            case "emissionTexture": self = .emission
+            case "bumpTexture": self = .bump
+            case "bump1Texture": self = .bump1
+            case "bump2Texture": self = .bump2
+            case "maskTexture": self = .mask
+            case "lightmapTexture": self = .lightmap
+            case "reflectionTexture": self = .reflection
+            default: return nil
+            }
+        }
+    }
+    
+    var features: Set<GLLFunctionConstant>
+    var isBlended: Bool
+    var parameters = GLLFragmentParameters()
+    private(set) var textures: [GLLSoftwareTexture] = Array(repeating: .white, count: TextureSlot.allCases.count)
+    private(set) var texCoordSets: [Int] = Array(repeating: 0, count: TextureSlot.allCases.count)
+    
+    init(features: Set<GLLFunctionConstant>, isBlended: Bool = false) {
+        self.features = features
+        self.isBlended = isBlended
+    }
+    
+    mutating func set(texture: GLLSoftwareTexture, for slot: TextureSlot, texCoordSet: Int = 0) {
+        textures[slot.rawValue] = texture
+        texCoordSets[slot.rawValue] = texCoordSet
+    }
+    
+    func texture(_ slot: TextureSlot) -> GLLSoftwareTexture {
+        return textures[slot.rawValue]
+    }
+    
+    func texCoordSet(_ slot: TextureSlot) -> Int {
+        return texCoordSets[slot.rawValue]
+    }
+}
+
+// The interpolated vertex outputs for one pixel
+struct GLLSoftwareFragment {
+    var worldPosition = SIMD3<Float>()
+    var color = SIMD4<Float>(repeating: 1)
+    var texCoords = (SIMD2<Float>(), SIMD2<Float>(), SIMD2<Float>(), SIMD2<Float>())
+    var normalWorld = SIMD3<Float>()
+    var tangentToWorld = matrix_float3x3()
+    
+    func texCoord(set: Int) -> SIMD2<Float> {
+        switch set {
+        case 1: return texCoords.1
+        case 2: return texCoords.2
+        case 3: return texCoords.3
+        default: return texCoords.0
+        }
+    }
+}
+
+/**
+ * # xnaLaraFragment from XnaLaraShader.metal, on the CPU.
+ *
+ * Any change to the shader needs to be made here as well. The features get looked up once, so shading a pixel only checks bools.
+ */
+struct GLLSoftwareShader {
+    let material: GLLSoftwareMaterial
+    let lights: GLLSoftwareLights
+    
+    private let hasNormal: Bool
+    private let calculateTangentToWorld: Bool
+    private let hasDiffuseTexture: Bool
+    private let hasNormalDetailMap: Bool
+    private let isShadeless: Bool
+    private let hasReflection: Bool
+    private let hasSpecularLighting: Bool
+    private let hasSpecularTexture: Bool
+    private let hasSpecularTextureScale: Bool
+    private let hasDiffuseLighting: Bool
+    private let hasLightmap: Bool
+    private let hasEmission: Bool
+    private let hasVertexColor: Bool
+    
+    init(material: GLLSoftwareMaterial, lights: GLLSoftwareLights, numberOfTexCoordSets: Int) {
+        self.material = material
+        self.lights = lights
+        
+        let features = material.features
+        let hasTexCoord0 = numberOfTexCoordSets >= 1
+        hasNormal = features.contains(.hasNormal)
+        // Without tex coords there are no tangents, and the vertex shader does not set up the matrix
+        calculateTangentToWorld = features.contains(.calculateTangentWorld) && hasTexCoord0
+        hasDiffuseTexture = features.contains(.hasDiffuseTexture) && hasTexCoord0
+        hasNormalDetailMap = features.contains(.hasNormalDetailMap)
+        isShadeless = features.contains(.isShadeless)
+        hasReflection = features.contains(.hasReflection)
+        hasSpecularLighting = features.contains(.hasSpecularLighting)
+        hasSpecularTexture = features.contains(.hasSpecularTexture)
+        hasSpecularTextureScale = features.contains(.hasSpecularTextureScale)
+        hasDiffuseLighting = features.contains(.hasDiffuseLighting)
+        hasLightmap = features.contains(.hasLightmap)
+        hasEmission = features.contains(.hasEmission)
+        hasVertexColor = features.contains(.hasVertexColor)
+    }
+    
+    private func sample(_ slot: GLLSoftwareMaterial.TextureSlot, _ fragment: GLLSoftwareFragment, scale: Float = 1) -> SIMD4<Float> {
+        return material.texture(slot).sample(fragment.texCoord(set: material.texCoordSet(slot)) * scale)
+    }
+    
+    private func xyz(_ vector: SIMD4<Float>) -> SIMD3<Float> {
+        return SIMD3<Float>(vector.x, vector.y, vector.z)
+    }
+    
+    func shade(_ fragment: GLLSoftwareFragment) -> SIMD4<Float> {
+        let parameters = material.parameters
+        
+        // Calculate diffuse color
+        var diffuseTextureColor = SIMD4<Float>(repeating: 1)
+        if hasDiffuseTexture {
+            diffuseTextureColor = sample(.diffuse, fragment)
+        }
+        var usedDiffuseColor = diffuseTextureColor
+        if hasVertexColor {
+            usedDiffuseColor *= fragment.color
+        }
+        
+        // If Shadeless then return just this diffuse color
+        if isShadeless {
+            return usedDiffuseColor
+        }
+        
+        // Calculate normal
+        var normal = SIMD3<Float>()
+        if hasNormal {
+            if calculateTangentToWorld {
+                var normalMapColor = xyz(sample(.bump, fragment))
+                if hasNormalDetailMap {
+                    let maskColor = sample(.mask, fragment)
+                    
+                    let detailNormalMap1 = xyz(sample(.bump1, fragment, scale: parameters.bump1UVScale))
+                    normalMapColor += detailNormalMap1 * maskColor.x * 0.5
+                    
+                    let detailNormalMap2 = xyz(sample(.bump2, fragment, scale: parameters.bump2UVScale))
+                    normalMapColor += detailNormalMap2 * maskColor.y * 0.5
+                    
+                    normalMapColor /= (1 + maskColor.x * 0.5 + maskColor.y * 0.5)
+                }
+                let normalFromMap = normalMapColor * 2 - 1
+                normal = simd_normalize(fragment.tangentToWorld * normalFromMap)
+            } else {
+                normal = fragment.normalWorld
+            }
+        }
+        
+        // Calculate camera direction
+        var cameraDirection = SIMD3<Float>()
+        if hasReflection || hasSpecularLighting {
+            cameraDirection = simd_normalize(lights.cameraPosition - fragment.worldPosition)
+        }
+        
+        // Separate specular color
+        var specularColor = parameters.specularColor
+        if hasSpecularTexture {
+            specularColor *= sample(.specular, fragment, scale: hasSpecularTextureScale ? parameters.specularTextureScale : 1)
+        }
+        
+        // Total color: Add in ambient
+        var color = lights.ambientColor * parameters.ambientColor * usedDiffuseColor
+        
+        for light in lights.lights {
+            let direction = xyz(light.direction)
+            
+            // Diffuse term
+            let diffuseFactor = max(simd_dot(-normal, direction), 0)
+            if hasDiffuseLighting {
+                color += usedDiffuseColor * parameters.diffuseColor * light.diffuseColor * diffuseFactor
+            }
+            
+            // Specular term
+            if hasSpecularLighting {
+                let reflectedLightDirection = simd_reflect(direction, normal)
+                var specularFactor = pow(max(simd_dot(cameraDirection, reflectedLightDirection), 0), parameters.specularExponent)
+                if diffuseFactor <= 0.001 {
+                    specularFactor = 0
+                }
+                color += light.specularColor * specularColor * specularFactor
+            }
+        }
+        
+        // Lightmap
+        if hasLightmap {
+            color *= sample(.lightmap, fragment)
+        }
+        
+        // Reflection
+        if hasReflection {
+            let reflectionDirection = simd_normalize(simd_reflect(cameraDirection, normal))
+            
+            // Same mapping of the sphere to XNALara's square as in the shader
+            let tanAlpha = reflectionDirection.x / reflectionDirection.y
+            let cotAlpha = reflectionDirection.y / reflectionDirection.x
+            let scaleFactor = (min(1, tanAlpha * tanAlpha) + min(1, cotAlpha * cotAlpha)).squareRoot()
+            let reflectionTexCoord = scaleFactor * SIMD2<Float>(reflectionDirection.x, reflectionDirection.y)
+            let reflectionColor = material.texture(.reflection).sample(reflectionTexCoord * 0.5 + 0.5)
+            
+            color = simd_mix(color, reflectionColor, SIMD4<Float>(repeating: parameters.reflectionAmount))
+        }
+        
+        // Emission
+        if hasEmission {
+            color += sample(.emission, fragment)
+        }
+        
+        if material.isBlended {
+            // Apply alpha from diffuse texture
+            color.w = diffuseTextureColor.w
+        } else {
+            // Solid
+            color.w = 1
+        }
+        
+        return color
+    }
+}
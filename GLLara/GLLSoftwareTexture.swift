@@ -0,0 +1,174 @@
+//
+//  GLLSoftwareTexture.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # A texture for the software renderer.
+ *
+ * Stores RGBA as floats from 0 to 1, rows from top to bottom, and samples like the sampler in GLLResourceManager: bilinear and repeating. There are no mipmaps, so strongly minified textures alias a bit more than on the GPU.
+ */
+struct GLLSoftwareTexture {
+    let width: Int
+    let height: Int
+    let texels: [SIMD4<Float>]
+    
+    // What a mesh uses if a texture is missing
+    static let white = GLLSoftwareTexture(color: SIMD4<Float>(repeating: 1))
+    
+    init(width: Int, height: Int, texels: [SIMD4<Float>]) {
+        precondition(width > 0 && height > 0)
+        precondition(texels.count == width * height)
+        self.width = width
+        self.height = height
+        self.texels = texels
+    }
+    
+    init(color: SIMD4<Float>) {
+        self.init(width: 1, height: 1, texels: [color])
+    }
+    
+    // From 8 bits per channel, in RGBA order
+    init(width: Int, height: Int, rgba8: [UInt8]) {
+        precondition(rgba8.count == width * height * 4)
+        let texels = (0 ..< width * height).map { i in
+            SIMD4<Float>(Float(rgba8[i*4 + 0]), Float(rgba8[i*4 + 1]), Float(rgba8[i*4 + 2]), Float(rgba8[i*4 + 3])) / 255.0
+        }
+        self.init(width: width, height: height, texels: texels)
+    }
+    
+    func texel(x: Int, y: Int) -> SIMD4<Float> {
+        return texels[y * width + x]
+    }
+    
+    func sample(_ coord: SIMD2<Float>) -> SIMD4<Float> {
+        guard coord.x.isFinite && coord.y.isFinite else {
+            return texels[0]
+        }
+        // Repeat first, so the integer conversion below can't overflow. Texel centers are at half coordinates.
+        let wrapped = coord - coord.rounded(.down)
+        let x = wrapped.x * Float(width) - 0.5
+        let y = wrapped.y * Float(height) - 0.5
+        let floorX = x.rounded(.down)
+        let floorY = y.rounded(.down)
+        let fractionX = x - floorX
+        let fractionY = y - floorY
+        
+        let x0 = GLLSoftwareTexture.wrap(Int(floorX), width)
+        let x1 = GLLSoftwareTexture.wrap(Int(floorX) + 1, width)
+        let y0 = GLLSoftwareTexture.wrap(Int(floorY), height)
+        let y1 = GLLSoftwareTexture.wrap(Int(floorY) + 1, height)
+        
+        let top = simd_mix(texel(x: x0, y: y0), texel(x: x1, y: y0), SIMD4<Float>(repeating: fractionX))
+        let bottom = simd_mix(texel(x: x0, y: y1), texel(x: x1, y: y1), SIMD4<Float>(repeating: fractionX))
+        return simd_mix(top, bottom, SIMD4<Float>(repeating: fractionY))
+    }
+    
+    private static func wrap(_ value: Int, _ size: Int) -> Int {
+        let result = value % size
+        return result < 0 ? result + size : result
+    }
+    
+    // MARK: - Block compressed data
+    
+    // The DXT formats that DDS files use
+    enum BlockFormat {
+        case bc1
+        case bc2
+        case bc3
+        
+        var bytesPerBlock: Int {
+            return self == .bc1 ? 8 : 16
+        }
+    }
+    
+    /**
+     * # Decodes block compressed data.
+     *
+     * Each block of 4x4 texels has two 5:6:5 colors and two bit indices per texel that pick one of them or a mix of them. BC2 adds four bits of alpha per texel, BC3 two alpha values and three bit indices to pick between mixes of them. Blocks that go past the edge of the texture get cut off.
+     */
+    init(width: Int, height: Int, blocks: Data, format: BlockFormat) {
+        let blocksPerRow = max(1, (width + 3) / 4)
+        let blockRows = max(1, (height + 3) / 4)
+        precondition(blocks.count >= blocksPerRow * blockRows * format.bytesPerBlock)
+        
+        var texels = Array(repeating: SIMD4<Float>(), count: width * height)
+        blocks.withUnsafeBytes { bytes in
+            for blockY in 0 ..< blockRows {
+                for blockX in 0 ..< blocksPerRow {
+                    let start = (blockY * blocksPerRow + blockX) * format.bytesPerBlock
+                    let block = UnsafeRawBufferPointer(rebasing: bytes[start ..< start + format.bytesPerBlock])
+                    let decoded = GLLSoftwareTexture.decode(block: block, format: format)
+                    for y in 0 ..< 4 where blockY * 4 + y < height {
+                        for x in 0 ..< 4 where blockX * 4 + x < width {
+                            texels[(blockY * 4 + y) * width + blockX * 4 + x] = decoded[y * 4 + x]
+                        }
+                    }
+                }
+            }
+        }
+        self.init(width: width, height: height, texels: texels)
+    }
+    
+    private static func color(from565 value: UInt16) -> SIMD4<Float> {
+        let red = Float((value >> 11) & 0x1F) / 31.0
+        let green = Float((value >> 5) & 0x3F) / 63.0
+        let blue = Float(value & 0x1F) / 31.0
+        return SIMD4<Float>(red, green, blue, 1)
+    }
+    
+    // The 16 texels of one block, row by row
+    static func decode(block: UnsafeRawBufferPointer, format: BlockFormat) -> [SIMD4<Float>] {
+        let colorStart = format == .bc1 ? 0 : 8
+        let color0Value = block.loadUnaligned(fromByteOffset: colorStart + 0, as: UInt16.self).littleEndian
+        let color1Value = block.loadUnaligned(fromByteOffset: colorStart + 2, as: UInt16.self).littleEndian
+        let colorIndices = block.loadUnaligned(fromByteOffset: colorStart + 4, as: UInt32.self).littleEndian
+        
+        let color0 = color(from565: color0Value)
+        let color1 = color(from565: color1Value)
+        let palette: [SIMD4<Float>]
+        if color0Value > color1Value || format != .bc1 {
+            palette = [color0, color1, (2 * color0 + color1) / 3, (color0 + 2 * color1) / 3]
+        } else {
+            // Only BC1 has the mode with transparent black
+            palette = [color0, color1, (color0 + color1) / 2, SIMD4<Float>()]
+        }
+        
+        var result = (0 ..< 16).map { palette[Int((colorIndices >> (2 * UInt32($0))) & 0x3)] }
+        
+        switch format {
+        case .bc1:
+            break
+        case .bc2:
+            let alphaBits = block.loadUnaligned(fromByteOffset: 0, as: UInt64.self).littleEndian
+            for i in 0 ..< 16 {
+                result[i].w = Float((alphaBits >> (4 * UInt64(i))) & 0xF) / 15.0
+            }
+        case .bc3:
+            let alpha0 = Float(block[0]) / 255.0
+            let alpha1 = Float(block[1]) / 255.0
+            var alphas = [alpha0, alpha1]
+            if block[0] > block[1] {
+                alphas += (1 ... 6).map { (Float(7 - $0) * alpha0 + Float($0) * alpha1) / 7 }
+            } else {
+                alphas += (1 ... 4).map { (Float(5 - $0) * alpha0 + Float($0) * alpha1) / 5 }
+                alphas += [0, 1]
+            }
+            // 48 bits of indices, three per texel
+            var alphaBits: UInt64 = 0
+            for i in 0 ..< 6 {
+                alphaBits |= UInt64(block[2 + i]) << (8 * UInt64(i))
+            }
+            for i in 0 ..< 16 {
+                result[i].w = alphas[Int((alphaBits >> (3 * UInt64(i))) & 0x7)]
+            }
+        }
+        return result
+    }
+}
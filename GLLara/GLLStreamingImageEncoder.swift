@@ -0,0 +1,340 @@
+//
+//  GLLStreamingImageEncoder.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import Compression
+import UniformTypeIdentifiers
+
+/**
+ * # Writes PNG or TIFF files one band of rows at a time.
+ *
+ * ImageIO wants the whole image in memory before it writes anything, which does not work for poster sized renders. This encoder only ever holds the rows it is given, plus the compressor's buffer for PNG.
+ *
+ * Rows come in as eight bit BGRA, top row first, which is what the renderers read back, and get written as RGBA with straight alpha. The output goes to a closure, so it can go to a file or into memory.
+ */
+final class GLLStreamingImageEncoder {
+    enum Format {
+        case png
+        case tiff
+        
+        // Nil for the types that can't be streamed
+        init?(fileType: UTType) {
+            if fileType.conforms(to: .png) {
+                self = .png
+            } else if fileType.conforms(to: .tiff) {
+                self = .tiff
+            } else {
+                return nil
+            }
+        }
+    }
+    
+    let format: Format
+    let width: Int
+    let height: Int
+    private(set) var rowsWritten = 0
+    
+    private let output: (Data) throws -> Void
+    private var compressor: OutputFilter? = nil
+    private var adler32 = GLLStreamingImageEncoder.Adler32()
+    private var tiffRowsPerStrip = 1
+    
+    init(format: Format, width: Int, height: Int, output: @escaping (Data) throws -> Void) throws {
+        precondition(width > 0 && height > 0)
+        self.format = format
+        self.width = width
+        self.height = height
+        self.output = output
+        
+        switch format {
+        case .png:
+            try startPNG()
+        case .tiff:
+            try startTIFF()
+        }
+    }
+    
+    // Writes to a new file at the URL, replacing what was there
+    convenience init(format: Format, width: Int, height: Int, url: URL) throws {
+        guard FileManager.default.createFile(atPath: url.path, contents: nil) else {
+            throw NSError(domain: "exporting", code: 1, userInfo: [
+                NSLocalizedFailureErrorKey: NSLocalizedString("Could not open file for writing", comment: "Exporting")
+            ])
+        }
+        let handle = try FileHandle(forWritingTo: url)
+        try self.init(format: format, width: width, height: height) { data in
+            try handle.write(contentsOf: data)
+        }
+    }
+    
+    func append(bgra8Rows rows: UnsafeRawBufferPointer, bytesPerRow: Int, count: Int) throws {
+        precondition(rowsWritten + count <= height, "More rows than the image has")
+        precondition(rows.count >= bytesPerRow * (count - 1) + width * 4)
+        
+        for row in 0 ..< count {
+            let source = UnsafeRawBufferPointer(rebasing: rows[row * bytesPerRow ..< row * bytesPerRow + width * 4])
+            switch format {
+            case .png:
+                try appendPNG(row: source)
+            case .tiff:
+                try output(GLLStreamingImageEncoder.rgba(fromBGRA: source))
+            }
+        }
+        rowsWritten += count
+    }
+    
+    // Must be called after the last row
+    func finish() throws {
+        precondition(rowsWritten == height, "Not all rows written")
+        switch format {
+        case .png:
+            try finishPNG()
+        case .tiff:
+            try finishTIFF()
+        }
+    }
+    
+    private static func rgba(fromBGRA source: UnsafeRawBufferPointer) -> Data {
+        var result = Data(count: source.count)
+        result.withUnsafeMutableBytes { bytes in
+            for i in stride(from: 0, to: source.count, by: 4) {
+                bytes[i + 0] = source[i + 2]
+                bytes[i + 1] = source[i + 1]
+                bytes[i + 2] = source[i + 0]
+                bytes[i + 3] = source[i + 3]
+            }
+        }
+        return result
+    }
+    
+    // MARK: - PNG
+    
+    private func writePNGChunk(type: String, data: Data) throws {
+        let typeData = type.data(using: .ascii)!
+        var crc = GLLStreamingImageEncoder.CRC32()
+        crc.update(typeData)
+        crc.update(data)
+        
+        var chunk = Data(capacity: data.count + 12)
+        chunk.appendBigEndian(UInt32(data.count))
+        chunk.append(typeData)
+        chunk.append(data)
+        chunk.appendBigEndian(crc.value)
+        try output(chunk)
+    }
+    
+    private func startPNG() throws {
+        try output(Data([0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A]))
+        
+        var header = Data()
+        header.appendBigEndian(UInt32(width))
+        header.appendBigEndian(UInt32(height))
+        // Eight bit RGBA, deflate, adaptive filtering, no interlacing
+        header.append(contentsOf: [8, 6, 0, 0, 0])
+        try writePNGChunk(type: "IHDR", data: header)
+        
+        // The compressor only does raw deflate, so the zlib header and checksum are added here. The header goes into the first data chunk.
+        var isFirstChunk = true
+        compressor = try OutputFilter(.compress, using: .zlib) { [unowned self] (compressed: Data?) in
+            guard var compressed = compressed, !compressed.isEmpty else {
+                return
+            }
+            if isFirstChunk {
+                compressed.insert(contentsOf: [0x78, 0x9C], at: compressed.startIndex)
+                isFirstChunk = false
+            }
+            try self.writePNGChunk(type: "IDAT", data: compressed)
+        }
+    }
+    
+    // Every row uses the sub filter, which stores the difference to the pixel on the left. Cheap, and much better than nothing for rendered images.
+    private func appendPNG(row source: UnsafeRawBufferPointer) throws {
+        var filtered = Data(count: width * 4 + 1)
+        filtered.withUnsafeMutableBytes { bytes in
+            bytes[0] = 1
+            for x in 0 ..< width {
+                let pixel = x * 4
+                let rgba = (source[pixel + 2], source[pixel + 1], source[pixel + 0], source[pixel + 3])
+                if x == 0 {
+                    bytes[1 + 0] = rgba.0
+                    bytes[1 + 1] = rgba.1
+                    bytes[1 + 2] = rgba.2
+                    bytes[1 + 3] = rgba.3
+                } else {
+                    let left = pixel - 4
+                    bytes[1 + pixel + 0] = rgba.0 &- source[left + 2]
+                    bytes[1 + pixel + 1] = rgba.1 &- source[left + 1]
+                    bytes[1 + pixel + 2] = rgba.2 &- source[left + 0]
+                    bytes[1 + pixel + 3] = rgba.3 &- source[left + 3]
+                }
+            }
+        }
+        adler32.update(filtered)
+        try compressor!.write(filtered)
+    }
+    
+    private func finishPNG() throws {
+        try compressor!.finalize()
+        compressor = nil
+        
+        var checksum = Data()
+        checksum.appendBigEndian(adler32.value)
+        try writePNGChunk(type: "IDAT", data: checksum)
+        try writePNGChunk(type: "IEND", data: Data())
+    }
+    
+    // MARK: - TIFF
+    
+    private var tiffImageBytes: Int {
+        return width * height * 4
+    }
+    
+    private var tiffStripCount: Int {
+        return (height + tiffRowsPerStrip - 1) / tiffRowsPerStrip
+    }
+    
+    /**
+     * # Uncompressed little endian TIFF.
+     *
+     * Since the size of everything is known in advance, the directory can go after the image data without having to go back and patch the header. Strips are about 64 KB, so readers don't need to load the whole image either.
+     */
+    private func startTIFF() throws {
+        guard 8 + tiffImageBytes + 1024 + 8 * height < Int(UInt32.max) else {
+            throw NSError(domain: "exporting", code: 2, userInfo: [
+                NSLocalizedFailureErrorKey: NSLocalizedString("The image is too large for a TIFF file", comment: "Exporting")
+            ])
+        }
+        tiffRowsPerStrip = max(1, 65536 / (width * 4))
+        
+        var header = Data([0x49, 0x49, 42, 0])
+        header.appendLittleEndian(UInt32(8 + tiffImageBytes))
+        try output(header)
+    }
+    
+    private func finishTIFF() throws {
+        enum FieldType: UInt16 {
+            case short = 3
+            case long = 4
+        }
+        let stripCount = tiffStripCount
+        let bytesPerStrip = tiffRowsPerStrip * width * 4
+        let stripOffsets = (0 ..< stripCount).map { UInt32(8 + $0 * bytesPerStrip) }
+        let stripByteCounts = (0 ..< stripCount).map { UInt32(min(bytesPerStrip, tiffImageBytes - $0 * bytesPerStrip)) }
+        
+        // Values that don't fit into an entry go after the directory
+        let entryCount = 11
+        let directoryStart = 8 + tiffImageBytes
+        var extraDataOffset = directoryStart + 2 + entryCount * 12 + 4
+        var extraData = Data()
+        var directory = Data()
+        directory.appendLittleEndian(UInt16(entryCount))
+        
+        func entry(_ tag: UInt16, _ type: FieldType, _ values: [UInt32]) {
+            directory.appendLittleEndian(tag)
+            directory.appendLittleEndian(type.rawValue)
+            directory.appendLittleEndian(UInt32(values.count))
+            
+            var valueData = Data()
+            for value in values {
+                if type == .short {
+                    valueData.appendLittleEndian(UInt16(value))
+                } else {
+                    valueData.appendLittleEndian(value)
+                }
+            }
+            if valueData.count <= 4 {
+                valueData.append(contentsOf: Array(repeating: UInt8(0), count: 4 - valueData.count))
+                directory.append(valueData)
+            } else {
+                directory.appendLittleEndian(UInt32(extraDataOffset))
+                extraData.append(valueData)
+                extraDataOffset += valueData.count
+            }
+        }
+        
+        // Sorted by tag, as the format requires
+        entry(256, .long, [UInt32(width)]) // Image width
+        entry(257, .long, [UInt32(height)]) // Image length
+        entry(258, .short, [8, 8, 8, 8]) // Bits per sample
+        entry(259, .short, [1]) // No compression
+        entry(262, .short, [2]) // RGB
+        entry(273, .long, stripOffsets)
+        entry(277, .short, [4]) // Samples per pixel
+        entry(278, .long, [UInt32(tiffRowsPerStrip)])
+        entry(279, .long, stripByteCounts)
+        entry(284, .short, [1]) // Interleaved
+        entry(338, .short, [2]) // Alpha is not premultiplied
+        directory.appendLittleEndian(UInt32(0)) // No further images
+        
+        try output(directory + extraData)
+    }
+    
+    // MARK: - Checksums
+    
+    struct CRC32 {
+        private static let table: [UInt32] = (0 ..< 256).map { index in
+            var value = UInt32(index)
+            for _ in 0 ..< 8 {
+                value = (value & 1) != 0 ? (0xEDB88320 ^ (value >> 1)) : (value >> 1)
+            }
+            return value
+        }
+        
+        private var state: UInt32 = 0xFFFFFFFF
+        
+        var value: UInt32 {
+            return state ^ 0xFFFFFFFF
+        }
+        
+        mutating func update<D: DataProtocol>(_ data: D) {
+            for region in data.regions {
+                for byte in region {
+                    state = CRC32.table[Int((state ^ UInt32(byte)) & 0xFF)] ^ (state >> 8)
+                }
+            }
+        }
+    }
+    
+    struct Adler32 {
+        private var a: UInt32 = 1
+        private var b: UInt32 = 0
+        
+        var value: UInt32 {
+            return (b << 16) | a
+        }
+        
+        mutating func update<D: DataProtocol>(_ data: D) {
+            // The sums can go 5552 bytes before they need to be reduced, without overflowing
+            for region in data.regions {
+                var bytesSinceReduce = 0
+                for byte in region {
+                    a += UInt32(byte)
+                    b += a
+                    bytesSinceReduce += 1
+                    if bytesSinceReduce == 5552 {
+                        a %= 65521
+                        b %= 65521
+                        bytesSinceReduce = 0
+                    }
+                }
+                a %= 65521
+                b %= 65521
+            }
+        }
+    }
+}
+
+private extension Data {
+    mutating func appendBigEndian<T: FixedWidthInteger>(_ value: T) {
+        Swift.withUnsafeBytes(of: value.bigEndian) { append(contentsOf: $0) }
+    }
+    
+    mutating func appendLittleEndian<T: FixedWidthInteger>(_ value: T) {
+        Swift.withUnsafeBytes(of: value.littleEndian) { append(contentsOf: $0) }
+    }
+}
@@ -24,7 +24,7 @@ class GLLVertexArray {
     init(format: GLLVertexFormat) {
         self.format = format
         
-        let optimizedAttributes = format.attributes.compactMap { GLLVertexArray.optimizedVersion(attribute: $0) }
+        let optimizedAttributes = format.attributes.compactMap { GLLVertexArray.optimizedVersion(attribute: $0, quantized: format.isQuantized) }
         let stride = optimizedAttributes.map { $0.sizeInBytes }.reduce(0) { $0 + $1 }
         
         var writingAccessors: [GLLVertexAttribAccessor] = []
@@ -85,7 +85,9 @@ class GLLVertexArray {
         }
     }
     
-    func add(vertices: GLLVertexAttribAccessorSet, count: Int, elements: Data?, bytesPerElement: Int, at reservation: Reservation) {
+    // Quantized formats need the quantization of the mesh that the vertices belong to
+    func add(vertices: GLLVertexAttribAccessorSet, count: Int, elements: Data?, bytesPerElement: Int, quantization: GLLVertexQuantization? = nil, at reservation: Reservation) {
+        precondition(!format.isQuantized || quantization != nil)
         lock.withLock {
             if vertexData == nil {
                 vertexData = UnsafeMutableRawBufferPointer.allocate(byteCount: totalVertexByteCount, alignment: 16)
@@ -103,16 +105,71 @@ class GLLVertexArray {
             return vertices.accessor(semantic: attribute.semantic, layer: attribute.layer)!
         }
         
+        // Normals and tangents that are already normalized integers in the file still need the octahedral encoding, so read them as floats first
+        let octahedralInputs = zip(optimizedFormat.accessors, sortedReadAccessors).map { writeAccessor, readAccessor -> [SIMD4<Float>]? in
+            let semantic = writeAccessor.attribute.semantic
+            guard format.isQuantized, semantic == .normal || semantic == .tangent0, readAccessor.attribute.normalizedComponents != nil else {
+                return nil
+            }
+            return readAccessor.simdArray(count: count, type: SIMD4<Float>.self)
+        }
+        
         for i in 0..<count {
             for accessorIndex in 0 ..< sortedReadAccessors.count {
                 let writeAccessor = optimizedFormat.accessors[accessorIndex]
                 let attribute = writeAccessor.attribute
                 let readAccessor = sortedReadAccessors[accessorIndex]
                 
+                if let floats = octahedralInputs[accessorIndex] {
+                    let vertex = newBytes.advanced(by: writeAccessor.offset(element: i))
+                    if attribute.semantic == .normal {
+                        let encoded = GLLVertexQuantization.octahedral(SIMD3<Float>(floats[i].x, floats[i].y, floats[i].z))
+                        Swift.withUnsafeBytes(of: encoded) { vertex.copyMemory(from: $0.baseAddress!, byteCount: $0.count) }
+                    } else {
+                        let encoded = GLLVertexQuantization.tangent(floats[i])
+                        Swift.withUnsafeBytes(of: encoded) { vertex.copyMemory(from: $0.baseAddress!, byteCount: $0.count) }
+                    }
+                    continue
+                }
+                
                 readAccessor.withBytes(element: i) { originalVertex in
                     let vertex = newBytes.advanced(by: writeAccessor.offset(element: i))
                     // Need to do some processing
-                    if attribute.semantic == .normal && attribute.format == .int1010102Normalized {
+                    let readFormat = readAccessor.attribute.format
+                    if attribute.format == GLLVertexArray.paddedFormats[readFormat] || (attribute.format == readFormat && readAccessor.attribute.normalizedComponents != nil) {
+                        // Already quantized in the file (e.g. glTF with KHR_mesh_quantization). Copy and pad to four bytes.
+                        vertex.copyMemory(from: originalVertex.baseAddress!, byteCount: originalVertex.count)
+                        if attribute.sizeInBytes > originalVertex.count {
+                            vertex.advanced(by: originalVertex.count).initializeMemory(as: UInt8.self, repeating: 0, count: attribute.sizeInBytes - originalVertex.count)
+                        }
+                    } else if attribute.semantic == .position && attribute.format == .ushort4Normalized {
+                        // Position. Relative to the bounds of the mesh
+                        let position = originalVertex.bindMemory(to: Float32.self)
+                        let quantized = quantization!.position(SIMD3<Float>(position[0], position[1], position[2]))
+                        Swift.withUnsafeBytes(of: quantized) { vertex.copyMemory(from: $0.baseAddress!, byteCount: $0.count) }
+                    } else if attribute.semantic == .normal && attribute.format == .short2Normalized {
+                        // Normal. Octahedral encoding
+                        let normal = originalVertex.bindMemory(to: Float32.self)
+                        let encoded = GLLVertexQuantization.octahedral(SIMD3<Float>(normal[0], normal[1], normal[2]))
+                        Swift.withUnsafeBytes(of: encoded) { vertex.copyMemory(from: $0.baseAddress!, byteCount: $0.count) }
+                    } else if attribute.semantic == .tangent0 && attribute.format == .short4Normalized {
+                        // Tangent. Octahedral encoding with the sign of the bitangent
+                        let tangent = originalVertex.bindMemory(to: Float32.self)
+                        let encoded = GLLVertexQuantization.tangent(SIMD4<Float>(tangent[0], tangent[1], tangent[2], tangent[3]))
+                        Swift.withUnsafeBytes(of: encoded) { vertex.copyMemory(from: $0.baseAddress!, byteCount: $0.count) }
+                    } else if attribute.semantic == .boneWeights && attribute.format == .uchar4Normalized {
+                        // Bone weights. Eight bits that add up to exactly one
+                        let weights = originalVertex.bindMemory(to: Float32.self)
+                        let quantized = GLLVertexQuantization.weights(SIMD4<Float>(weights[0], weights[1], weights[2], weights[3]))
+                        Swift.withUnsafeBytes(of: quantized) { vertex.copyMemory(from: $0.baseAddress!, byteCount: $0.count) }
+                    } else if attribute.semantic == .color && attribute.format == .half4 {
+                        // Float colors. Half float keeps values outside of 0 to 1
+                        let color = originalVertex.bindMemory(to: Float32.self)
+                        let newColor = vertex.bindMemory(to: UInt16.self, capacity: 4)
+                        for j in 0..<4 {
+                            newColor[j] = halfFloat(value: color[j])
+                        }
+                    } else if attribute.semantic == .normal && attribute.format == .int1010102Normalized {
                         // Normal. Compress from float[3] to int_2_10_10_10_rev format
                         let normal = originalVertex.bindMemory(to: Float32.self)
                         var value = UInt32(0)
@@ -173,25 +230,41 @@ class GLLVertexArray {
             }
         }
         
+        if let elements = elements {
+            copy(elements: elements, bytesPerElement: bytesPerElement, to: reservation.elementBytesStart)
+        }
+    }
+    
+    // Only elements, for additional index lists that use vertices which were already added. The reservation has to be for no vertices.
+    func add(elements: Data, bytesPerElement: Int, at reservation: Reservation) {
+        lock.withLock {
+            if elementData == nil && totalElementByteCount > 0 {
+                elementData = UnsafeMutableRawBufferPointer.allocate(byteCount: totalElementByteCount, alignment: 16)
+            }
+        }
+        copy(elements: elements, bytesPerElement: bytesPerElement, to: reservation.elementBytesStart)
+    }
+    
+    private func copy(elements: Data, bytesPerElement: Int, to elementBytesStart: Int) {
         // Compress elements
-        if self.format.hasIndices, let elements = elements {
+        if self.format.hasIndices {
             elements.withUnsafeBytes { newElements in
                 let ourElementBytes = numberOfElementBytes
                 if bytesPerElement == ourElementBytes {
                     // Straight copy
-                    elementData!.baseAddress!.advanced(by: reservation.elementBytesStart).copyMemory(from: newElements.baseAddress!, byteCount: elements.count)
+                    elementData!.baseAddress!.advanced(by: elementBytesStart).copyMemory(from: newElements.baseAddress!, byteCount: elements.count)
                 } else {
                     let additionalCount = elements.count / bytesPerElement
                     if ourElementBytes <= bytesPerElement {
                         // Downsample. Assumes little endian. RIP PPC :(
                         for i in 0..<additionalCount {
-                            elementData!.baseAddress!.advanced(by: reservation.elementBytesStart + i*ourElementBytes).copyMemory(from: newElements.baseAddress!.advanced(by: i*bytesPerElement), byteCount: ourElementBytes)
+                            elementData!.baseAddress!.advanced(by: elementBytesStart + i*ourElementBytes).copyMemory(from: newElements.baseAddress!.advanced(by: i*bytesPerElement), byteCount: ourElementBytes)
                         }
                     } else {
                         // Upsample. Assumes little endian. RIP PPC :(
                         // Also assumes elementData is zero-initialized
                         for i in 0..<additionalCount {
-                            elementData!.baseAddress!.advanced(by: reservation.elementBytesStart + i*ourElementBytes).copyMemory(from: newElements.baseAddress!.advanced(by: i*bytesPerElement), byteCount: bytesPerElement)
+                            elementData!.baseAddress!.advanced(by: elementBytesStart + i*ourElementBytes).copyMemory(from: newElements.baseAddress!.advanced(by: i*bytesPerElement), byteCount: bytesPerElement)
                         }
                     }
                 }
@@ -199,12 +272,48 @@ class GLLVertexArray {
         }
     }
     
+    // Normalized formats that are not a multiple of four bytes long, and what they get padded to. Metal needs the offsets of all attributes to be aligned to four bytes.
+    private static let paddedFormats: [MTLVertexFormat: MTLVertexFormat] = [
+        .charNormalized: .char4Normalized,
+        .char2Normalized: .char4Normalized,
+        .char3Normalized: .char4Normalized,
+        .ucharNormalized: .uchar4Normalized,
+        .uchar2Normalized: .uchar4Normalized,
+        .uchar3Normalized: .uchar4Normalized,
+        .shortNormalized: .short2Normalized,
+        .short3Normalized: .short4Normalized,
+        .ushortNormalized: .ushort2Normalized,
+        .ushort3Normalized: .ushort4Normalized
+    ]
+    
     // Returns nil if the optimal choice is to throw the data out entirely (in the case of padding)
-    private static func optimizedVersion(attribute: GLLVertexAttrib) -> GLLVertexAttrib? {
+    private static func optimizedVersion(attribute: GLLVertexAttrib, quantized: Bool) -> GLLVertexAttrib? {
         if attribute.semantic == .padding {
             return nil
         }
         
+        // Before the padding, since the shader expects octahedral normals and tangents in quantized layouts, even if the file already had them as normalized integers
+        if quantized {
+            switch (attribute.semantic, attribute.format) {
+            case (.position, .float3):
+                return GLLVertexAttrib(semantic: .position, layer: attribute.layer, format: .ushort4Normalized)
+            case (.normal, .float3), (.normal, _) where attribute.normalizedComponents != nil:
+                return GLLVertexAttrib(semantic: .normal, layer: attribute.layer, format: .short2Normalized)
+            case (.tangent0, .float4), (.tangent0, _) where attribute.normalizedComponents != nil:
+                return GLLVertexAttrib(semantic: .tangent0, layer: attribute.layer, format: .short4Normalized)
+            case (.boneWeights, .float4):
+                return GLLVertexAttrib(semantic: .boneWeights, layer: attribute.layer, format: .uchar4Normalized)
+            case (.color, .float4):
+                return GLLVertexAttrib(semantic: .color, layer: attribute.layer, format: .half4)
+            default:
+                break
+            }
+        }
+        
+        if let padded = paddedFormats[attribute.format] {
+            return GLLVertexAttrib(semantic: attribute.semantic, layer: attribute.layer, format: padded)
+        }
+        
         /*// Change Normal (if float[3]) to vec4 with 2_10_10_10_rev encoding
         // (this adds a W component which gets ignored by the shader)
         if attribute.semantic == .normal && attribute.size == .vec3 && attribute.type == .float {
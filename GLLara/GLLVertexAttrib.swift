@@ -135,6 +135,46 @@ struct GLLVertexAttrib: Hashable, Comparable {
         }
     }
     
+    // The glTF component type and count of normalized integer formats, so the CPU can turn them back into floats. Nil for everything else.
+    var normalizedComponents: (type: GLLAccessorDecoder.ComponentType, count: Int)? {
+        switch format {
+        case .charNormalized:
+            return (.byte, 1)
+        case .char2Normalized:
+            return (.byte, 2)
+        case .char3Normalized:
+            return (.byte, 3)
+        case .char4Normalized:
+            return (.byte, 4)
+        case .ucharNormalized:
+            return (.unsignedByte, 1)
+        case .uchar2Normalized:
+            return (.unsignedByte, 2)
+        case .uchar3Normalized:
+            return (.unsignedByte, 3)
+        case .uchar4Normalized:
+            return (.unsignedByte, 4)
+        case .shortNormalized:
+            return (.short, 1)
+        case .short2Normalized:
+            return (.short, 2)
+        case .short3Normalized:
+            return (.short, 3)
+        case .short4Normalized:
+            return (.short, 4)
+        case .ushortNormalized:
+            return (.unsignedShort, 1)
+        case .ushort2Normalized:
+            return (.unsignedShort, 2)
+        case .ushort3Normalized:
+            return (.unsignedShort, 3)
+        case .ushort4Normalized:
+            return (.unsignedShort, 4)
+        default:
+            return nil
+        }
+    }
+    
     var identifier: Int {
         if (self.semantic == .tangent0 || self.semantic == .texCoord0) {
            return self.semantic.rawValue + 2 * self.layer;
@@ -10,9 +10,10 @@ import Foundation
 
 struct GLLVertexFormat: Hashable {
     
-    init(attributes: [GLLVertexAttrib], countOfVertices: Int, hasIndices: Bool) {
+    init(attributes: [GLLVertexAttrib], countOfVertices: Int, hasIndices: Bool, isQuantized: Bool = false) {
         self.attributes = attributes
         self.hasIndices = hasIndices
+        self.isQuantized = isQuantized
         
         if hasIndices && countOfVertices < Int(UInt16.max) {
             indexType = .uint16
@@ -25,6 +26,8 @@ struct GLLVertexFormat: Hashable {
     let attributes: [GLLVertexAttrib]
     let indexType: MTLIndexType
     let hasIndices: Bool
+    // Whether GLLVertexArray packs the data with GLLVertexQuantization
+    let isQuantized: Bool
     
     var stride: Int {
         return attributes.reduce(0) { $0 + $1.sizeInBytes }
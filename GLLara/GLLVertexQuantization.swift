@@ -0,0 +1,174 @@
+//
+//  GLLVertexQuantization.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # The packed vertex layout for one mesh.
+ *
+ * Positions are stored as 16-bit normalized values relative to the bounds of the mesh. Instead of unpacking them in the shader, the dequantization matrix gets multiplied onto every bone matrix of the mesh. That would also scale the normals, so the shader needs the inverse of the scale; it gets it in the last column of the normal permutation matrix, which it otherwise does not use.
+ *
+ * Normals and tangents use the octahedral encoding with two 16-bit components; tangents have the sign for the bitangent in a third one. Bone weights get 8 bits each, rounded so that they still add up to exactly 255.
+ */
+struct GLLVertexQuantization: Equatable {
+    let bounds: GLLBoundingBox
+    // Size of the bounds, with 1 along axes where there is no size, so it can always be inverted
+    let scale: SIMD3<Float>
+    
+    init(bounds: GLLBoundingBox) {
+        self.bounds = bounds
+        let size = bounds.max - bounds.min
+        scale = size.replacing(with: 1, where: size .<= 0)
+    }
+    
+    init<S: Sequence>(positions: S) where S.Element == SIMD3<Float> {
+        self.init(bounds: GLLBoundingBox(points: positions))
+    }
+    
+    // From the normalized positions to the original ones
+    var dequantization: matrix_float4x4 {
+        return matrix_float4x4(columns: (SIMD4<Float>(scale.x, 0, 0, 0), SIMD4<Float>(0, scale.y, 0, 0), SIMD4<Float>(0, 0, scale.z, 0), SIMD4<Float>(bounds.min, 1)))
+    }
+    
+    var inverseScale: SIMD3<Float> {
+        return 1 / scale
+    }
+    
+    // The permutation for the normals with the inverse scale in the last column, for the shader
+    func normalPermutation(_ permutation: matrix_float4x4) -> matrix_float4x4 {
+        var result = permutation
+        result.columns.3 = SIMD4<Float>(inverseScale, 1)
+        return result
+    }
+    
+    /*
+     * Encoding
+     */
+    func position(_ position: SIMD3<Float>) -> SIMD4<UInt16> {
+        let normalized = simd_clamp((position - bounds.min) / scale, SIMD3<Float>(repeating: 0), SIMD3<Float>(repeating: 1))
+        let quantized = SIMD3<UInt16>((normalized * Float(UInt16.max)).rounded(.toNearestOrAwayFromZero))
+        return SIMD4<UInt16>(quantized, UInt16.max)
+    }
+    
+    func decodePosition(_ quantized: SIMD4<UInt16>) -> SIMD3<Float> {
+        let normalized = SIMD3<Float>(SIMD3<UInt16>(quantized.x, quantized.y, quantized.z)) / Float(UInt16.max)
+        let result = dequantization * SIMD4<Float>(normalized, 1)
+        return SIMD3<Float>(result.x, result.y, result.z)
+    }
+    
+    // Tries the four nearest grid points and keeps the one that decodes closest to the original direction
+    static func octahedral(_ vector: SIMD3<Float>) -> SIMD2<Int16> {
+        let length = abs(vector.x) + abs(vector.y) + abs(vector.z)
+        guard length > 0 && length.isFinite else {
+            return SIMD2<Int16>(0, 0)
+        }
+        var projected = SIMD2<Float>(vector.x, vector.y) / length
+        if vector.z < 0 {
+            let signs = SIMD2<Float>(repeating: -1).replacing(with: 1, where: projected .>= 0)
+            projected = (1 - abs(SIMD2<Float>(projected.y, projected.x))) * signs
+        }
+        
+        let scaled = projected * Float(Int16.max)
+        let direction = simd_normalize(vector)
+        var best = SIMD2<Int16>(0, 0)
+        var bestDot = -Float.infinity
+        for candidate in [SIMD2<Float>(scaled.x.rounded(.down), scaled.y.rounded(.down)), SIMD2<Float>(scaled.x.rounded(.up), scaled.y.rounded(.down)), SIMD2<Float>(scaled.x.rounded(.down), scaled.y.rounded(.up)), SIMD2<Float>(scaled.x.rounded(.up), scaled.y.rounded(.up))] {
+            let clamped = SIMD2<Int16>(simd_clamp(candidate, SIMD2<Float>(repeating: -Float(Int16.max)), SIMD2<Float>(repeating: Float(Int16.max))))
+            let dot = simd_dot(decodeOctahedral(clamped), direction)
+            if dot > bestDot {
+                best = clamped
+                bestDot = dot
+            }
+        }
+        return best
+    }
+    
+    // Same as octahedralDecode in the shader
+    static func decodeOctahedral(_ encoded: SIMD2<Int16>) -> SIMD3<Float> {
+        let projected = simd_clamp(SIMD2<Float>(encoded) / Float(Int16.max), SIMD2<Float>(repeating: -1), SIMD2<Float>(repeating: 1))
+        var result = SIMD3<Float>(projected.x, projected.y, 1 - abs(projected.x) - abs(projected.y))
+        if result.z < 0 {
+            let signs = SIMD2<Float>(repeating: -1).replacing(with: 1, where: SIMD2<Float>(result.x, result.y) .>= 0)
+            let folded = (1 - abs(SIMD2<Float>(result.y, result.x))) * signs
+            result.x = folded.x
+            result.y = folded.y
+        }
+        return simd_normalize(result)
+    }
+    
+    // Direction in x and y, sign of the bitangent in z
+    static func tangent(_ tangent: SIMD4<Float>) -> SIMD4<Int16> {
+        let encoded = octahedral(SIMD3<Float>(tangent.x, tangent.y, tangent.z))
+        return SIMD4<Int16>(encoded.x, encoded.y, tangent.w < 0 ? -Int16.max : Int16.max, 0)
+    }
+    
+    // Largest remainder rounding, so the sum is always exactly 255 and the shader needs no normalization
+    static func weights(_ weights: SIMD4<Float>) -> SIMD4<UInt8> {
+        let clamped = weights.replacing(with: 0, where: .!(weights .> 0) .| .!(weights .< .infinity))
+        let sum = clamped.sum()
+        guard sum > 0 else {
+            return SIMD4<UInt8>(255, 0, 0, 0)
+        }
+        let scaled = clamped / sum * 255
+        var quantized = scaled.rounded(.down)
+        var remaining = 255 - Int(quantized.sum())
+        var remainders = scaled - quantized
+        while remaining > 0 {
+            var largest = 0
+            for i in 1 ..< 4 where remainders[i] > remainders[largest] {
+                largest = i
+            }
+            quantized[largest] += 1
+            remainders[largest] = -1
+            remaining -= 1
+        }
+        return SIMD4<UInt8>(quantized)
+    }
+    
+    /*
+     * Error against the original data
+     */
+    struct Errors: CustomStringConvertible {
+        // Largest distance between an original and a decoded position
+        var position: Float = 0
+        // Largest angle between an original and a decoded normal, in degrees
+        var normalDegrees: Float = 0
+        var size = SIMD3<Float>(repeating: 0)
+        
+        var description: String {
+            let relative = position / Swift.max(size.max(), .leastNormalMagnitude)
+            return String(format: "position error ≤ %g (%.4f%% of the size), normal error ≤ %.4f°", position, relative * 100, normalDegrees)
+        }
+    }
+    
+    func errors(positions: [SIMD3<Float>], normals: [SIMD3<Float>]) -> Errors {
+        var result = Errors()
+        result.size = bounds.max - bounds.min
+        for position in positions {
+            result.position = Swift.max(result.position, simd_distance(position, decodePosition(self.position(position))))
+        }
+        for normal in normals where simd_length_squared(normal) > 0 {
+            let decoded = GLLVertexQuantization.decodeOctahedral(GLLVertexQuantization.octahedral(normal))
+            // More precise than acos for the tiny angles here
+            let direction = simd_normalize(normal)
+            let angle = atan2(simd_length(simd_cross(decoded, direction)), simd_dot(decoded, direction))
+            result.normalDegrees = Swift.max(result.normalDegrees, angle * 180 / Float.pi)
+        }
+        return result
+    }
+    
+    // One line per mesh with the errors and the vertex size before and after, for the log.
+    static func report(meshNames: [String], errors: [Errors], strides: [(original: Int, quantized: Int)]) -> String {
+        var result = ""
+        for (name, (error, stride)) in zip(meshNames, zip(errors, strides)) {
+            result += "\(name): \(error), \(stride.original) → \(stride.quantized) bytes per vertex\n"
+        }
+        return result
+    }
+}
@@ -0,0 +1,273 @@
+//
+//  GLLVertexWelder.swift
+//  GLLara
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import Foundation
+import simd
+
+/**
+ * # Merges duplicate vertices and removes what is not needed.
+ *
+ * Model files often have the same vertex more than once, triangles with no area, and vertices that no triangle uses. This finds all of that, and says which vertices to keep and what the new indices are. It has to be done before the tangents get calculated, since those depend on which triangles share a vertex.
+ *
+ * Vertices get compared through a grid: Every float gets divided by its tolerance and rounded down, and two vertices are the same if they end up in the same cell, and all their other data is identical. So vertices that are merged are always within the tolerance; ones that are close to each other but on different sides of a cell border stay separate. With a tolerance of 0, floats have to be exactly equal, only treating 0 and -0 the same.
+ *
+ * The lookup is done with a hash table per partition of the hash values, so the partitions can be done in parallel.
+ */
+struct GLLVertexWelder {
+    struct Vertices {
+        var count: Int
+        // Compared with the tolerance for their column
+        var floatsPerVertex: Int
+        var floats: [Float]
+        var tolerances: [Float]
+        // Compared exactly
+        var bytesPerVertex: Int
+        var bytes: [UInt8]
+        
+        init(count: Int) {
+            self.count = count
+            floatsPerVertex = 0
+            floats = []
+            tolerances = []
+            bytesPerVertex = 0
+            bytes = []
+        }
+        
+        // Adds more columns to every vertex
+        mutating func append(floats newFloats: [Float], perVertex: Int, tolerance: Float) {
+            precondition(newFloats.count == count * perVertex)
+            floats = GLLVertexWelder.interleave(floats, floatsPerVertex, newFloats, perVertex, count: count)
+            floatsPerVertex += perVertex
+            tolerances.append(contentsOf: repeatElement(tolerance, count: perVertex))
+        }
+        
+        mutating func append(bytes newBytes: [UInt8], perVertex: Int) {
+            precondition(newBytes.count == count * perVertex)
+            bytes = GLLVertexWelder.interleave(bytes, bytesPerVertex, newBytes, perVertex, count: count)
+            bytesPerVertex += perVertex
+        }
+    }
+    
+    struct Statistics: CustomStringConvertible {
+        var originalVertices = 0
+        var originalTriangles = 0
+        var mergedVertices = 0
+        var unreferencedVertices = 0
+        var degenerateTriangles = 0
+        
+        var vertices: Int {
+            return originalVertices - mergedVertices - unreferencedVertices
+        }
+        var triangles: Int {
+            return originalTriangles - degenerateTriangles
+        }
+        var changedAnything: Bool {
+            return vertices != originalVertices || triangles != originalTriangles
+        }
+        
+        var description: String {
+            return "\(originalVertices) → \(vertices) vertices (\(mergedVertices) merged, \(unreferencedVertices) unused), \(originalTriangles * 3) → \(triangles * 3) indices (\(degenerateTriangles) degenerate triangles)"
+        }
+    }
+    
+    // For positions, normals, texture coordinates and weights in the usual ranges
+    static let defaultTolerance: Float = 1e-6
+    static let partitionCount = 64
+    
+    // Original index of every vertex that is left, in the original order
+    let vertices: [UInt32]
+    // Triangles that are left, as indices into vertices
+    let indices: [UInt32]
+    let statistics: Statistics
+    
+    /**
+     * # Welds the vertices.
+     *
+     * If positions are given, triangles where they show that the area is exactly 0 are removed, too. Triangles that use the same vertex more than once after merging always are.
+     */
+    init(vertices: Vertices, indices: [UInt32], positions: [SIMD3<Float>]? = nil, concurrent: Bool = true) {
+        precondition(indices.count % 3 == 0)
+        precondition(positions == nil || positions!.count == vertices.count)
+        
+        let count = vertices.count
+        // Grid cell of every float
+        var cells = Array(repeating: Int64(0), count: vertices.floats.count)
+        cells.withUnsafeMutableBufferPointer { cells in
+            GLLCPUSkinner.forEachChunk(count: cells.count, concurrent: concurrent) { _, range in
+                for i in range {
+                    cells[i] = GLLVertexWelder.cell(vertices.floats[i], tolerance: vertices.tolerances[i % vertices.floatsPerVertex])
+                }
+            }
+        }
+        
+        var hashes = Array(repeating: UInt64(0), count: count)
+        hashes.withUnsafeMutableBufferPointer { hashes in
+            GLLCPUSkinner.forEachChunk(count: count, concurrent: concurrent) { _, range in
+                for vertex in range {
+                    var hash = UInt64(0xcbf29ce484222325)
+                    for i in vertex * vertices.floatsPerVertex ..< (vertex + 1) * vertices.floatsPerVertex {
+                        hash = (hash ^ UInt64(bitPattern: cells[i])) &* 0x100000001b3
+                    }
+                    for i in vertex * vertices.bytesPerVertex ..< (vertex + 1) * vertices.bytesPerVertex {
+                        hash = (hash ^ UInt64(vertices.bytes[i])) &* 0x100000001b3
+                    }
+                    // Mix so the top bits, which pick the partition, depend on everything
+                    hash ^= hash >> 29
+                    hash = hash &* 0xbf58476d1ce4e5b9
+                    hash ^= hash >> 32
+                    hashes[vertex] = hash
+                }
+            }
+        }
+        
+        func equal(_ a: Int, _ b: Int) -> Bool {
+            let floatsPerVertex = vertices.floatsPerVertex
+            for i in 0 ..< floatsPerVertex where cells[a * floatsPerVertex + i] != cells[b * floatsPerVertex + i] {
+                return false
+            }
+            let bytesPerVertex = vertices.bytesPerVertex
+            for i in 0 ..< bytesPerVertex where vertices.bytes[a * bytesPerVertex + i] != vertices.bytes[b * bytesPerVertex + i] {
+                return false
+            }
+            return true
+        }
+        
+        // Sort the vertices into partitions by hash, keeping them in order within each
+        let partitionCount = GLLVertexWelder.partitionCount
+        let partitionShift = UInt64(64 - partitionCount.trailingZeroBitCount)
+        var partitionStarts = Array(repeating: 0, count: partitionCount + 1)
+        for hash in hashes {
+            partitionStarts[Int(hash >> partitionShift) + 1] += 1
+        }
+        for partition in 0 ..< partitionCount {
+            partitionStarts[partition + 1] += partitionStarts[partition]
+        }
+        var partitioned = Array(repeating: UInt32(0), count: count)
+        var fill = partitionStarts
+        for vertex in 0 ..< count {
+            let partition = Int(hashes[vertex] >> partitionShift)
+            partitioned[fill[partition]] = UInt32(vertex)
+            fill[partition] += 1
+        }
+        
+        // Within each partition, the first of every group of equal vertices represents all of them
+        var representatives = Array(repeating: UInt32(0), count: count)
+        representatives.withUnsafeMutableBufferPointer { representatives in
+            GLLCPUSkinner.perform(iterations: partitionCount, concurrent: concurrent) { partition in
+                let members = partitioned[partitionStarts[partition] ..< partitionStarts[partition + 1]]
+                guard !members.isEmpty else {
+                    return
+                }
+                // Open addressing, at most half full
+                var capacity = 1
+                while capacity < members.count * 2 {
+                    capacity *= 2
+                }
+                var table = Array(repeating: UInt32.max, count: capacity)
+                for member in members {
+                    let vertex = Int(member)
+                    var slot = Int(truncatingIfNeeded: hashes[vertex]) & (capacity - 1)
+                    while true {
+                        let existing = table[slot]
+                        if existing == UInt32.max {
+                            table[slot] = member
+                            representatives[vertex] = member
+                            break
+                        }
+                        if hashes[Int(existing)] == hashes[vertex] && equal(Int(existing), vertex) {
+                            representatives[vertex] = existing
+                            break
+                        }
+                        slot = (slot + 1) & (capacity - 1)
+                    }
+                }
+            }
+        }
+        
+        // Rewrite the triangles, and drop the ones that have no area
+        let triangleCount = indices.count / 3
+        var chunkIndices = Array(repeating: [UInt32](), count: GLLCPUSkinner.chunkCount(triangleCount))
+        chunkIndices.withUnsafeMutableBufferPointer { chunkIndices in
+            GLLCPUSkinner.forEachChunk(count: triangleCount, concurrent: concurrent) { chunk, range in
+                var kept: [UInt32] = []
+                kept.reserveCapacity(range.count * 3)
+                for triangle in range {
+                    let a = representatives[Int(indices[triangle * 3 + 0])]
+                    let b = representatives[Int(indices[triangle * 3 + 1])]
+                    let c = representatives[Int(indices[triangle * 3 + 2])]
+                    if a == b || b == c || a == c {
+                        continue
+                    }
+                    if let positions {
+                        let cross = simd_cross(positions[Int(b)] - positions[Int(a)], positions[Int(c)] - positions[Int(a)])
+                        if cross == SIMD3<Float>(repeating: 0) {
+                            continue
+                        }
+                    }
+                    kept.append(contentsOf: [a, b, c])
+                }
+                chunkIndices[chunk] = kept
+            }
+        }
+        var newIndices = Array(chunkIndices.joined())
+        
+        // Keep only vertices that are still used, in their original order
+        var newIndexOfVertex = Array(repeating: UInt32.max, count: count)
+        for index in newIndices {
+            newIndexOfVertex[Int(index)] = 0
+        }
+        var keptVertices: [UInt32] = []
+        for vertex in 0 ..< count where newIndexOfVertex[vertex] == 0 {
+            newIndexOfVertex[vertex] = UInt32(keptVertices.count)
+            keptVertices.append(UInt32(vertex))
+        }
+        newIndices.withUnsafeMutableBufferPointer { newIndices in
+            GLLCPUSkinner.forEachChunk(count: newIndices.count, concurrent: concurrent) { _, range in
+                for i in range {
+                    newIndices[i] = newIndexOfVertex[Int(newIndices[i])]
+                }
+            }
+        }
+        
+        var statistics = Statistics()
+        statistics.originalVertices = count
+        statistics.originalTriangles = triangleCount
+        statistics.mergedVertices = (0 ..< count).reduce(0) { $0 + (representatives[$1] != UInt32($1) ? 1 : 0) }
+        statistics.unreferencedVertices = count - statistics.mergedVertices - keptVertices.count
+        statistics.degenerateTriangles = triangleCount - newIndices.count / 3
+        
+        self.vertices = keptVertices
+        self.indices = newIndices
+        self.statistics = statistics
+    }
+    
+    private static func cell(_ value: Float, tolerance: Float) -> Int64 {
+        if value == 0 {
+            return 0
+        }
+        let scaled = tolerance > 0 ? (value / tolerance).rounded(.down) : .infinity
+        guard abs(scaled) < 9e18 else {
+            // Exact comparison; also for values too large for the grid, and NaN
+            return Int64(value.bitPattern)
+        }
+        return Int64(scaled)
+    }
+    
+    private static func interleave<T>(_ a: [T], _ aPerVertex: Int, _ b: [T], _ bPerVertex: Int, count: Int) -> [T] {
+        if aPerVertex == 0 {
+            return b
+        }
+        var result: [T] = []
+        result.reserveCapacity(a.count + b.count)
+        for vertex in 0 ..< count {
+            result.append(contentsOf: a[vertex * aPerVertex ..< (vertex + 1) * aPerVertex])
+            result.append(contentsOf: b[vertex * bPerVertex ..< (vertex + 1) * bPerVertex])
+        }
+        return result
+    }
+}
@@ -205,8 +205,9 @@ import Combine
     
     override func mouseDown(with event: NSEvent) {
         if self.showSelection, let document = self.document, var selectedBones = document.selection.selectedBones {
-            // Try to find the bone that corresponds to this event.
-            if let bone = closestBone(atScreenPoint: convert(event.locationInWindow, from: nil), from: document.allBones) {
+            // Try to find the bone that corresponds to this event. If there is none close by, take the one that moves the mesh under the mouse.
+            let point = convert(event.locationInWindow, from: nil)
+            if let bone = closestBone(atScreenPoint: point, from: document.allBones) ?? pickMesh(atScreenPoint: point)?.bone {
                
                 if event.modifierFlags.isSuperset(of: [.shift, .command]) {
                     // Add to/remove from the selection
@@ -784,7 +785,7 @@ import Combine
             
             let screenXY = (screen2D * 0.5 + 0.5) * size
             
-            let distanceToRay = simd_length(screenXY)
+            let distanceToRay = simd_distance(screenXY, simd_float2(Float(point.x), Float(point.y)))
             if distanceToRay > 10 {
                 continue
             }
@@ -798,6 +799,28 @@ import Combine
         return closestBone
     }
     
+    private let picker = GLLScenePicker()
+    
+    private func pickMesh(atScreenPoint point: NSPoint) -> GLLScenePicker.Result? {
+        guard let camera = camera, let managedObjectContext = document?.managedObjectContext else {
+            return nil
+        }
+        
+        // From the near to the far plane, through the point
+        let inverseViewProjection = camera.viewProjectionMatrix.inverse
+        let ndc = simd_float2(Float(point.x / bounds.width), Float(point.y / bounds.height)) * 2 - 1
+        let nearPoint = inverseViewProjection * simd_float4(ndc.x, ndc.y, -1, 1)
+        let farPoint = inverseViewProjection * simd_float4(ndc.x, ndc.y, 1, 1)
+        let origin = simd_float3(nearPoint.x, nearPoint.y, nearPoint.z) / nearPoint.w
+        let target = simd_float3(farPoint.x, farPoint.y, farPoint.z) / farPoint.w
+        
+        let allItemsRequest = NSFetchRequest<GLLItem>()
+        allItemsRequest.entity = NSEntityDescription.entity(forEntityName: "GLLItem", in: managedObjectContext)
+        let allItems = (try? managedObjectContext.fetch(allItemsRequest)) ?? []
+        
+        return picker.pick(items: allItems, origin: origin, direction: simd_normalize(target - origin))
+    }
+    
     private func turnAroundCamera(deltaX: Float, deltaY: Float) {
         guard let camera = camera, !camera.cameraLocked else {
             return
@@ -21,6 +21,8 @@ import UniformTypeIdentifiers
         // Prepare light buffer.
         lightBuffer = device.makeBuffer(length: MemoryLayout<GLLLightsBuffer>.size, options: .storageModeManaged)!
         lightBuffer.label = "global-lights"
+        directionalLightBuffer = device.makeBuffer(length: 3 * MemoryLayout<GLLLightBuffer>.stride, options: .storageModeManaged)!
+        directionalLightBuffer.label = "directional-lights"
         
         // Load existing lights
         let ambientRequest = NSFetchRequest<GLLAmbientLight>()
@@ -47,7 +49,8 @@ import UniformTypeIdentifiers
         let size = view.drawableSize
         camera.actualWindowWidth = Float(size.width)
         camera.actualWindowHeight = Float(size.height)
-        surface = Surface(width: Int(size.width), height: Int(size.height), device: device)
+        renderTargetPool = GLLRenderTargetPool(device: device)
+        surface = Surface(width: Int(size.width), height: Int(size.height), pool: renderTargetPool)
         
         super.init()
         
@@ -67,12 +70,12 @@ import UniformTypeIdentifiers
         }
         notificationObservers.append(NotificationCenter.default.addObserver(forName: UserDefaults.didChangeNotification, object: nil, queue: OperationQueue.main) { [weak self] notification in
             self?.updateScaleFactor()
+            self?.updateDepthPeelLayerLimit()
         })
         updateScaleFactor()
+        updateDepthPeelLayerLimit()
         
         view.delegate = self
-        
-        assert(directionalLights.count == 3, "Only exactly four lights supported at the moment")
     }
     
     let sceneDrawer: GLLSceneDrawer
@@ -80,10 +83,12 @@ import UniformTypeIdentifiers
     weak var view: GLLView?
     
     private let ambientLight: GLLAmbientLight
-    private let directionalLights: [GLLDirectionalLight] // Always three, mutations aren't checked
+    private let directionalLights: [GLLDirectionalLight] // Mutations aren't checked
     private let device = GLLResourceManager.shared.metalDevice
     private let commandQueue: MTLCommandQueue
     private var lightBuffer: MTLBuffer
+    // The enabled directional lights; grows when there are more of them
+    private var directionalLightBuffer: MTLBuffer
     private var needsUpdateLights = true
     private var keyValueObservers: [NSKeyValueObservation] = []
     private var notificationObservers: [NSObjectProtocol] = []
@@ -98,75 +103,114 @@ import UniformTypeIdentifiers
         }
         if newScaleFactor != internalBufferScaleFactor {
             internalBufferScaleFactor = newScaleFactor
-            // Recreate textures
+            // Plan the textures again; the memory usually stays
             if let view = view {
                 let size = view.drawableSize
-                surface = Surface(width: Int(size.width * internalBufferScaleFactor), height: Int(size.height * internalBufferScaleFactor), device: device)
+                surface.resize(width: Int(size.width * internalBufferScaleFactor), height: Int(size.height * internalBufferScaleFactor))
             }
         }
     }
     
-    // Depth peeling
-    private struct Surface {
-        var colorTextures: [MTLTexture] = []
-        var solidDepthTexture: MTLTexture
-        var peelDepthTextures: [MTLTexture] = []
+    private func updateDepthPeelLayerLimit() {
+        let limit = min(max(UserDefaults.standard.integer(forKey: GLLPrefMaximumDepthPeelLayers), 0), GLLDepthPeelEstimator.maximumLayers)
+        if limit != depthPeelEstimator.maximumLayers {
+            depthPeelEstimator.maximumLayers = limit
+            view?.unpause()
+        }
+    }
+    
+    /**
+     * # The render targets for depth peeling.
+     *
+     * All of them live in one heap from the render target pool, placed as the render graph planned them, so the ones that are not needed at the same time share memory. Peel layers are only added when a frame first needs them; resizing plans again, and keeps the heap if the new plan fits into it.
+     */
+    private final class Surface {
+        // Texture 0 is for the solid meshes, the others are one per peel layer
+        private(set) var colorTextures: [MTLTexture] = []
+        private(set) var solidDepthTexture: MTLTexture! = nil
+        private(set) var peelDepthTextures: [MTLTexture] = []
+        // Only for rendering to a file
+        private(set) var outputTexture: MTLTexture? = nil
+        
+        private(set) var clearDepthBuffer0PassDescriptor: MTLRenderPassDescriptor? = nil
+        private(set) var solidRenderPassDescriptor = MTLRenderPassDescriptor()
+        
+        private(set) var width: Int
+        private(set) var height: Int
+        let offscreenOutput: Bool
+        // What the current targets need, and what they would need without sharing memory
+        private(set) var plan = GLLRenderGraph.Plan(allocations: [], peakBytes: 0, unaliasedBytes: 0)
+        
+        private let pool: GLLRenderTargetPool
+        private var heap: MTLHeap? = nil
+        
+        init(width: Int, height: Int, pool: GLLRenderTargetPool, offscreenOutput: Bool = false) {
+            self.width = width
+            self.height = height
+            self.pool = pool
+            self.offscreenOutput = offscreenOutput
+            allocate(peelLayers: 0)
+        }
         
-        var clearDepthBuffer0PassDescriptor: MTLRenderPassDescriptor
-        var solidRenderPassDescriptor: MTLRenderPassDescriptor
+        deinit {
+            if let heap = heap {
+                pool.recycle(heap)
+            }
+        }
         
-        let width: Int
-        let height: Int
+        var peelLayerCount: Int {
+            return colorTextures.count - 1
+        }
         
-        init(width: Int, height: Int, device: MTLDevice) {
+        // Creates what is needed for that many peel layers. Textures are kept once they exist, so a scene that needs more layers now and then doesn't allocate every time.
+        func preparePeelLayers(_ count: Int) {
+            if count > peelLayerCount {
+                allocate(peelLayers: count)
+            }
+        }
+        
+        func resize(width: Int, height: Int) {
+            if width == self.width && height == self.height {
+                return
+            }
             self.width = width
             self.height = height
-            
-            colorTextures.removeAll()
-            let depthPeelLayerCount = 8
-            for i in 0..<depthPeelLayerCount {
-                let resolvedTextureDescriptor = MTLTextureDescriptor()
-                resolvedTextureDescriptor.width = width
-                resolvedTextureDescriptor.height = height
-                resolvedTextureDescriptor.allowGPUOptimizedContents = true
-                resolvedTextureDescriptor.textureType = .type2D
-                resolvedTextureDescriptor.pixelFormat = .bgra8Unorm
-                resolvedTextureDescriptor.storageMode = .private
-                resolvedTextureDescriptor.usage = [ .shaderRead, .renderTarget ]
-                
-                let texture = device.makeTexture(descriptor: resolvedTextureDescriptor)!
-                texture.label = "color-res-\(i)"
-                colorTextures.append(texture)
+            allocate(peelLayers: peelLayerCount)
+        }
+        
+        private func allocate(peelLayers: Int) {
+            let device = pool.device
+            let (graph, resources) = GLLRenderGraph.depthPeeling(layers: peelLayers, offscreenOutput: offscreenOutput)
+            let descriptors = graph.resources.map { resource -> MTLTextureDescriptor in
+                switch resource.format {
+                case .bgra8:
+                    return Surface.colorTextureDescriptor(width: width, height: height)
+                case .depth32:
+                    return Surface.depthTextureDescriptor(width: width, height: height)
+                }
             }
+            plan = graph.plan(sizes: descriptors.map { descriptor in
+                let sizeAndAlign = device.heapTextureSizeAndAlign(descriptor: descriptor)
+                return (size: sizeAndAlign.size, alignment: sizeAndAlign.align)
+            })
             
-            let depthTextureDescriptor = MTLTextureDescriptor()
-            depthTextureDescriptor.width = width
-            depthTextureDescriptor.height = height
-            depthTextureDescriptor.allowGPUOptimizedContents = true
-            depthTextureDescriptor.textureType = .type2DMultisample
-            depthTextureDescriptor.pixelFormat = .depth32Float
-            depthTextureDescriptor.storageMode = .private
-            depthTextureDescriptor.textureType = .type2D
-            depthTextureDescriptor.usage = [ .shaderRead, .renderTarget ]
-            
-            solidDepthTexture = device.makeTexture(descriptor: depthTextureDescriptor)!
-            solidDepthTexture.label = "depth-solid"
-            
-            peelDepthTextures.removeAll()
-            for i in 0..<2 {
-                let depthTexture = device.makeTexture(descriptor: depthTextureDescriptor)!
-                depthTexture.label = "depth-\(i)"
-                peelDepthTextures.append(depthTexture)
+            if heap == nil || heap!.size < plan.peakBytes {
+                if let heap = heap {
+                    pool.recycle(heap)
+                }
+                heap = pool.heap(size: plan.peakBytes)
+            }
+            let textures = graph.resources.indices.map { index -> MTLTexture in
+                let texture = heap!.makeTexture(descriptor: descriptors[index], offset: plan.allocations[index]!.offset)!
+                texture.label = graph.resources[index].name
+                return texture
             }
             
-            clearDepthBuffer0PassDescriptor = MTLRenderPassDescriptor()
-            clearDepthBuffer0PassDescriptor.depthAttachment.texture = peelDepthTextures[0]
-            clearDepthBuffer0PassDescriptor.depthAttachment.loadAction = .clear
-            clearDepthBuffer0PassDescriptor.depthAttachment.storeAction = .store
-            clearDepthBuffer0PassDescriptor.depthAttachment.clearDepth = 0.0
-            clearDepthBuffer0PassDescriptor.renderTargetWidth = solidDepthTexture.width
-            clearDepthBuffer0PassDescriptor.renderTargetHeight = solidDepthTexture.height
-
+            colorTextures = [textures[resources.solidColor]] + resources.peelColor.dropFirst().map { textures[$0] }
+            solidDepthTexture = textures[resources.solidDepth]
+            peelDepthTextures = resources.peelDepth.map { textures[$0] }
+            outputTexture = resources.output.map { textures[$0] }
+            
             solidRenderPassDescriptor = MTLRenderPassDescriptor()
             solidRenderPassDescriptor.colorAttachments[0].clearColor = MTLClearColorMake(0.0, 0.0, 0.0, 0.0)
             solidRenderPassDescriptor.colorAttachments[0].texture = colorTextures[0]
@@ -177,9 +221,47 @@ import UniformTypeIdentifiers
             solidRenderPassDescriptor.depthAttachment.storeAction = .store
             solidRenderPassDescriptor.renderTargetWidth = solidDepthTexture.width
             solidRenderPassDescriptor.renderTargetHeight = solidDepthTexture.height
+            
+            clearDepthBuffer0PassDescriptor = nil
+            if peelLayers > 0 {
+                let descriptor = MTLRenderPassDescriptor()
+                descriptor.depthAttachment.texture = peelDepthTextures[0]
+                descriptor.depthAttachment.loadAction = .clear
+                descriptor.depthAttachment.storeAction = .store
+                descriptor.depthAttachment.clearDepth = 0.0
+                descriptor.renderTargetWidth = solidDepthTexture.width
+                descriptor.renderTargetHeight = solidDepthTexture.height
+                clearDepthBuffer0PassDescriptor = descriptor
+            }
+        }
+        
+        private static func colorTextureDescriptor(width: Int, height: Int) -> MTLTextureDescriptor {
+            let resolvedTextureDescriptor = MTLTextureDescriptor()
+            resolvedTextureDescriptor.width = width
+            resolvedTextureDescriptor.height = height
+            resolvedTextureDescriptor.allowGPUOptimizedContents = true
+            resolvedTextureDescriptor.textureType = .type2D
+            resolvedTextureDescriptor.pixelFormat = .bgra8Unorm
+            resolvedTextureDescriptor.storageMode = .private
+            resolvedTextureDescriptor.usage = [ .shaderRead, .renderTarget ]
+            return resolvedTextureDescriptor
+        }
+        
+        private static func depthTextureDescriptor(width: Int, height: Int) -> MTLTextureDescriptor {
+            let depthTextureDescriptor = MTLTextureDescriptor()
+            depthTextureDescriptor.width = width
+            depthTextureDescriptor.height = height
+            depthTextureDescriptor.allowGPUOptimizedContents = true
+            depthTextureDescriptor.textureType = .type2DMultisample
+            depthTextureDescriptor.pixelFormat = .depth32Float
+            depthTextureDescriptor.storageMode = .private
+            depthTextureDescriptor.textureType = .type2D
+            depthTextureDescriptor.usage = [ .shaderRead, .renderTarget ]
+            return depthTextureDescriptor
         }
     }
     private var surface: Surface
+    private let renderTargetPool: GLLRenderTargetPool
     
     private var solidFence: MTLFence
     private var initializeDepthBufferFence: MTLFence
@@ -189,6 +271,19 @@ import UniformTypeIdentifiers
     
     private let hud = HUD()
     
+    // What frustum culling did in the last frame
+    private(set) var cullingStatistics = GLLCullingResult.Statistics()
+    
+    private var depthPeelEstimator = GLLDepthPeelEstimator()
+    // How many depth peel layers the last frame drew, and why
+    private(set) var depthPeelStatistics = GLLDepthPeelEstimator.Estimate()
+    // How the point and spot lights were sorted in the last frame, nil without any
+    private(set) var lastLightClusters: GLLLightClusters? = nil
+    // Memory of the view's render targets, with and without sharing
+    var renderTargetPlan: GLLRenderGraph.Plan {
+        return surface.plan
+    }
+    
     private func updateLights() {
         var lightData = GLLLightsBuffer()
         // Camera position
@@ -197,31 +292,105 @@ import UniformTypeIdentifiers
         // Ambient
         lightData.ambientColor = ambientLight.color.rgbaComponents128Bit
         
-        // Diffuse + Specular
-        lightData.lights.0 = directionalLights[0].uniformBlock
-        lightData.lights.1 = directionalLights[1].uniformBlock
-        lightData.lights.2 = directionalLights[2].uniformBlock
-        
         lightBuffer.contents().copyMemory(from: &lightData, byteCount: MemoryLayout<GLLLightsBuffer>.size)
         lightBuffer.didModifyRange(0 ..< MemoryLayout<GLLLightsBuffer>.size)
         
+        // Diffuse + Specular. Only the enabled lights, so the shaders don't have to do anything for the others.
+        let enabledLights = GLLDirectionalLight.enabledUniformBlocks(directionalLights)
+        let length = enabledLights.count * MemoryLayout<GLLLightBuffer>.stride
+        if length > directionalLightBuffer.length {
+            directionalLightBuffer = device.makeBuffer(length: length, options: .storageModeManaged)!
+            directionalLightBuffer.label = "directional-lights"
+        }
+        if length > 0 {
+            enabledLights.withUnsafeBytes { directionalLightBuffer.contents().copyMemory(from: $0.baseAddress!, byteCount: length) }
+            directionalLightBuffer.didModifyRange(0 ..< length)
+        }
+        sceneDrawer.enabledDirectionalLights = enabledLights.count
+        
         needsUpdateLights = false
     }
     
+    // Clusters for the scene's point and spot lights in this view, or nil if there are none
+    private func updateLightClusters(viewProjection: matrix_float4x4) -> LightClusterBuffers? {
+        let pointLights = sceneDrawer.pointLights
+        if pointLights.isEmpty {
+            lastLightClusters = nil
+            return nil
+        }
+        
+        // Taking the projection out of the view projection works for tiles of a larger image as well
+        let viewMatrix = camera.viewMatrix
+        let grid = GLLLightClusters.Grid(projection: viewProjection * viewMatrix.inverse, near: camera.nearDistance, far: camera.farDistance)
+        let clusters = GLLLightClusters(lights: pointLights, viewMatrix: viewMatrix, grid: grid)
+        lastLightClusters = clusters
+        
+        // New buffers every frame, so the GPU can still read the ones from the last frame
+        let lightData = pointLights.map { $0.uniformBlock }
+        let indices = clusters.indices.isEmpty ? [UInt32(0)] : clusters.indices
+        return LightClusterBuffers(lights: device.makeBuffer(bytes: lightData, length: lightData.count * MemoryLayout<GLLPointLightBuffer>.stride, options: .storageModeShared)!,
+                                   ranges: device.makeBuffer(bytes: clusters.ranges, length: clusters.ranges.count * MemoryLayout<SIMD2<UInt32>>.stride, options: .storageModeShared)!,
+                                   indices: device.makeBuffer(bytes: indices, length: indices.count * MemoryLayout<UInt32>.stride, options: .storageModeShared)!,
+                                   parameters: clusters.uniformBlock)
+    }
+    
+    private struct LightClusterBuffers {
+        let lights: MTLBuffer
+        let ranges: MTLBuffer
+        let indices: MTLBuffer
+        var parameters: GLLLightClusterParameters
+    }
+    
+    private func bindLights(into commandEncoder: MTLRenderCommandEncoder, clusters: LightClusterBuffers?) {
+        commandEncoder.setVertexBuffer(lightBuffer, offset: 0, index: Int(GLLVertexInputIndexLights.rawValue))
+        commandEncoder.setFragmentBuffer(lightBuffer, offset: 0, index: Int(GLLFragmentBufferIndexLights.rawValue))
+        commandEncoder.setFragmentBuffer(directionalLightBuffer, offset: 0, index: Int(GLLFragmentBufferIndexDirectionalLights.rawValue))
+        
+        guard var clusters = clusters else {
+            return
+        }
+        commandEncoder.setFragmentBuffer(clusters.lights, offset: 0, index: Int(GLLFragmentBufferIndexPointLights.rawValue))
+        commandEncoder.setFragmentBuffer(clusters.ranges, offset: 0, index: Int(GLLFragmentBufferIndexLightClusterRanges.rawValue))
+        commandEncoder.setFragmentBuffer(clusters.indices, offset: 0, index: Int(GLLFragmentBufferIndexLightClusterIndices.rawValue))
+        commandEncoder.setFragmentBytes(&clusters.parameters, length: MemoryLayout<GLLLightClusterParameters>.size, index: Int(GLLFragmentBufferIndexLightClusterParameters.rawValue))
+    }
+    
     // MARK: - Image rendering
     // Basic support for render to file
+    
+    // Largest size of the render targets for render to file. Larger images get rendered in tiles.
+    static let maximumImageTileSize = 2048
+    
     @objc func writeImage(to url: URL, fileType: UTType, size: CGSize, transparentBackground: Bool) throws {
-        // TODO Not yet implemented for metal
-        let dataSize = Int(size.width) * Int(size.height) * 4;
+        let width = Int(size.width)
+        let height = Int(size.height)
+        let clearColor = transparentBackground ? MTLClearColorMake(0.0, 0.0, 0.0, 0.0) : MTLClearColorMake(0.2, 0.2, 0.2, 1.0)
+        
+        // PNG and TIFF get written while rendering, so the full image never has to be in memory
+        if let format = GLLStreamingImageEncoder.Format(fileType: fileType) {
+            let encoder = try GLLStreamingImageEncoder(format: format, width: width, height: height, url: url)
+            try renderImageTiles(width: width, height: height, clearColor: clearColor) { rows, bytesPerRow, count in
+                try encoder.append(bgra8Rows: rows, bytesPerRow: bytesPerRow, count: count)
+            }
+            try encoder.finish()
+            return
+        }
+        
+        let dataSize = width * height * 4;
         var imageData = Data(count: dataSize);
         imageData.withUnsafeMutableBytes { bytes in
-            renderImage(size: size, toColorBuffer: bytes, clearColor: transparentBackground ? MTLClearColorMake(0.0, 0.0, 0.0, 0.0) : MTLClearColorMake(0.2, 0.2, 0.2, 1.0))
+            renderImage(size: size, toColorBuffer: bytes, clearColor: clearColor)
         }
         
+        try GLLViewDrawer.writeImage(bgra8Data: imageData, width: width, height: height, to: url, fileType: fileType)
+    }
+    
+    // Writes what renderImage produced. Also used by the software renderer.
+    static func writeImage(bgra8Data imageData: Data, width: Int, height: Int, to url: URL, fileType: UTType) throws {
         let dataProvider = CGDataProvider(data: imageData as CFData)!
         
         let colorSpace = CGColorSpace(name: CGColorSpace.sRGB)!
-        let image = CGImage(width: Int(size.width), height: Int(size.height), bitsPerComponent: 8, bitsPerPixel: 32, bytesPerRow: 4 * Int(size.width), space: colorSpace, bitmapInfo: CGBitmapInfo(rawValue: CGImageAlphaInfo.first.rawValue + CGImageByteOrderInfo.order32Little.rawValue), provider: dataProvider, decode: nil, shouldInterpolate: true, intent: .defaultIntent)!
+        let image = CGImage(width: width, height: height, bitsPerComponent: 8, bitsPerPixel: 32, bytesPerRow: 4 * width, space: colorSpace, bitmapInfo: CGBitmapInfo(rawValue: CGImageAlphaInfo.first.rawValue + CGImageByteOrderInfo.order32Little.rawValue), provider: dataProvider, decode: nil, shouldInterpolate: true, intent: .defaultIntent)!
         
         guard let imageDestination = CGImageDestinationCreateWithURL(url as CFURL, fileType.identifier as CFString, 1, nil) else {
             throw NSError(domain: "exporting", code: 1, userInfo: [
@@ -238,40 +407,72 @@ import UniformTypeIdentifiers
     }
     
     func renderImage(size: CGSize, toColorBuffer colorData: UnsafeMutableRawBufferPointer, clearColor: MTLClearColor) {
-        // TODO Not yet implemented in swift and for metal
-        
-        let surface = Surface(width: Int(size.width), height: Int(size.height), device: GLLResourceManager.shared.metalDevice)
-        let queue = device.makeCommandQueue()!
-        queue.label = "Write to file queue"
-        let commandBuffer = queue.makeCommandBuffer()!
-        commandBuffer.label = "Write to file command buffer"
-        
-        let outputTextureDescriptor = MTLTextureDescriptor()
-        outputTextureDescriptor.width = Int(size.width)
-        outputTextureDescriptor.height = Int(size.height)
-        outputTextureDescriptor.textureType = .type2D
-        outputTextureDescriptor.pixelFormat = .bgra8Unorm
-        outputTextureDescriptor.usage = [ .renderTarget ]
-        // TODO Settings here to improve readback performance. May not be optimal in all cases.
-        outputTextureDescriptor.allowGPUOptimizedContents = false
-        outputTextureDescriptor.storageMode = .shared
-        
-        let outputTexture = device.makeTexture(descriptor: outputTextureDescriptor)!
+        let width = Int(size.width)
+        var nextRow = 0
+        try! renderImageTiles(width: width, height: Int(size.height), clearColor: clearColor) { rows, bytesPerRow, count in
+            let destination = UnsafeMutableRawBufferPointer(rebasing: colorData[nextRow * width * 4 ..< (nextRow + count) * width * 4])
+            destination.copyMemory(from: UnsafeRawBufferPointer(rebasing: rows[0 ..< count * bytesPerRow]))
+            nextRow += count
+        }
+    }
+    
+    /**
+     * # Renders the image in tiles, handing out bands of finished rows from the top.
+     *
+     * The render targets only ever have the size of one tile, and the CPU side only holds one band of rows, so memory stays bounded for any image size. The band is BGRA and only valid during the call.
+     */
+    func renderImageTiles(width: Int, height: Int, clearColor: MTLClearColor, band: (UnsafeRawBufferPointer, Int, Int) throws -> Void) throws {
+        let tiling = GLLImageTiling(width: width, height: height, maximumTileSize: GLLViewDrawer.maximumImageTileSize)
+        let fullViewProjection = camera.viewProjectionMatrix(forAspectRatio: Float(width) / Float(height))
+        
+        // Tiles get estimated one by one, but they all have the same targets, so they are all made now. The heap is given back to the pool at the end.
+        let surface = Surface(width: tiling.tileWidth, height: tiling.tileHeight, pool: renderTargetPool, offscreenOutput: true)
+        surface.preparePeelLayers(depthPeelEstimator.maximumLayers)
+        let outputTexture = surface.outputTexture!
+        
+        // The output texture is private and shares memory with the depth buffers, so it gets copied here for reading
+        let readbackBytesPerRow = tiling.tileWidth * 4
+        let readbackBuffer = device.makeBuffer(length: readbackBytesPerRow * tiling.tileHeight, options: .storageModeShared)!
+        readbackBuffer.label = "Write to file readback"
         
         let outputRenderDescriptor = MTLRenderPassDescriptor()
         outputRenderDescriptor.colorAttachments[0].clearColor = clearColor
         outputRenderDescriptor.colorAttachments[0].loadAction = .clear
         outputRenderDescriptor.colorAttachments[0].storeAction = .store
         outputRenderDescriptor.colorAttachments[0].texture = outputTexture
-        outputRenderDescriptor.renderTargetWidth = Int(size.width)
-        outputRenderDescriptor.renderTargetHeight = Int(size.height)
-        
-        draw(commandBuffer: commandBuffer, viewRenderPassDescriptor: outputRenderDescriptor, surface: surface, includeUI: false)
-        
-        commandBuffer.commit()
-        commandBuffer.waitUntilCompleted()
-        
-        outputTexture.getBytes(colorData.baseAddress!, bytesPerRow: Int(size.width) * 4, from: MTLRegionMake2D(0, 0, Int(size.width), Int(size.height)), mipmapLevel: 0)
+        outputRenderDescriptor.renderTargetWidth = tiling.tileWidth
+        outputRenderDescriptor.renderTargetHeight = tiling.tileHeight
+        
+        let bytesPerRow = width * 4
+        var bandData = Data(count: bytesPerRow * tiling.tileHeight)
+        for row in 0 ..< tiling.tileRows {
+            let tiles = tiling.tiles(inRow: row)
+            for tile in tiles {
+                // Same queue as the view, since the heaps could be shared with it
+                let commandBuffer = commandQueue.makeCommandBuffer()!
+                commandBuffer.label = "Write to file command buffer"
+                
+                draw(commandBuffer: commandBuffer, viewRenderPassDescriptor: outputRenderDescriptor, surface: surface, includeUI: false, viewProjection: tiling.viewProjection(for: tile, fullViewProjection: fullViewProjection))
+                
+                let readbackEncoder = commandBuffer.makeBlitCommandEncoder()!
+                readbackEncoder.label = "Read back"
+                readbackEncoder.copy(from: outputTexture, sourceSlice: 0, sourceLevel: 0, sourceOrigin: MTLOrigin(x: 0, y: 0, z: 0), sourceSize: MTLSize(width: tile.width, height: tile.height, depth: 1), to: readbackBuffer, destinationOffset: 0, destinationBytesPerRow: readbackBytesPerRow, destinationBytesPerImage: readbackBytesPerRow * tile.height)
+                readbackEncoder.endEncoding()
+                
+                commandBuffer.commit()
+                commandBuffer.waitUntilCompleted()
+                
+                bandData.withUnsafeMutableBytes { bytes in
+                    for y in 0 ..< tile.height {
+                        (bytes.baseAddress! + y * bytesPerRow + tile.x * 4).copyMemory(from: readbackBuffer.contents() + y * readbackBytesPerRow, byteCount: tile.width * 4)
+                    }
+                }
+            }
+            
+            try bandData.withUnsafeBytes { bytes in
+                try band(bytes, bytesPerRow, tiles[0].height)
+            }
+        }
     }
     
     // MARK: - MTKViewDelegate
@@ -284,19 +485,28 @@ import UniformTypeIdentifiers
             return;
         }
         
-        // Recreate textures
-        surface = Surface(width: Int(size.width * internalBufferScaleFactor), height: Int(size.height * internalBufferScaleFactor), device: device)
+        // Plan the textures again; the memory usually stays
+        surface.resize(width: Int(size.width * internalBufferScaleFactor), height: Int(size.height * internalBufferScaleFactor))
     }
     
-    private func draw(commandBuffer: MTLCommandBuffer, viewRenderPassDescriptor: MTLRenderPassDescriptor, surface: Surface, includeUI: Bool = true, screenScale: Double = 2.0) {
+    // The view projection is normally the camera's, but tiles of a larger image need their own
+    private func draw(commandBuffer: MTLCommandBuffer, viewRenderPassDescriptor: MTLRenderPassDescriptor, surface: Surface, includeUI: Bool = true, screenScale: Double = 2.0, viewProjection customViewProjection: matrix_float4x4? = nil) {
         
         sceneDrawer.needsUpdate = false
         
-        var viewProjection = camera.viewProjectionMatrix(forAspectRatio: Float(surface.width) / Float(surface.height))
+        var viewProjection = customViewProjection ?? camera.viewProjectionMatrix(forAspectRatio: Float(surface.width) / Float(surface.height))
         
         if needsUpdateLights {
             updateLights()
         }
+        let lightClusters = updateLightClusters(viewProjection: viewProjection)
+        
+        // Step 0: Find what is in view, once for all passes, and how many layers the blended part of that needs
+        let visibility = sceneDrawer.cull(viewProjection: viewProjection)
+        cullingStatistics = visibility.statistics
+        depthPeelStatistics = depthPeelEstimator.estimate(blendedBounds: visibility.blendedBounds, depthComplexities: visibility.blendedDepthComplexities, viewProjection: viewProjection)
+        let peelLayers = depthPeelStatistics.layers
+        surface.preparePeelLayers(peelLayers)
         
         // Step 1: Render everything solid, with depth buffer 0 as normal depth buffer, to texture 0.
         let solidPassEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: surface.solidRenderPassDescriptor)!
@@ -305,10 +515,9 @@ import UniformTypeIdentifiers
         solidPassEncoder.setDepthStencilState(sceneDrawer.resourceManager.normalDepthStencilState)
         solidPassEncoder.setFragmentSamplerState(sceneDrawer.resourceManager.metalSampler, index: 0)
         solidPassEncoder.setVertexBytes(&viewProjection, length: MemoryLayout<float4x4>.size, index: Int(GLLVertexInputIndexViewProjection.rawValue))
-        solidPassEncoder.setVertexBuffer(lightBuffer, offset: 0, index: Int(GLLVertexInputIndexLights.rawValue))
-        solidPassEncoder.setFragmentBuffer(lightBuffer, offset: 0, index: Int(GLLFragmentBufferIndexLights.rawValue))
+        bindLights(into: solidPassEncoder, clusters: lightClusters)
         
-        sceneDrawer.draw(into: solidPassEncoder, blended: false)
+        sceneDrawer.draw(into: solidPassEncoder, blended: false, visibility: visibility)
         
         solidPassEncoder.updateFence(solidFence, after: [.fragment])
         solidPassEncoder.endEncoding()
@@ -318,11 +527,14 @@ import UniformTypeIdentifiers
         // - Use previous depth buffer as peel front buffer (only things behind it get drawn)
         // - Use other depth buffer as normal depth buffer, but initialized to depth buffer from solid
         // - Draw alpha, into multisample texture, resolving to resolved texture i
+        // Only as many layers as estimated, and none at all without blended meshes.
         
-        let clearDepthBuffer0Pass = commandBuffer.makeRenderCommandEncoder(descriptor: surface.clearDepthBuffer0PassDescriptor)!
-        clearDepthBuffer0Pass.label = "Clear Depth Buffer 0"
-        clearDepthBuffer0Pass.updateFence(lastBufferDoneFence, after: [.fragment])
-        clearDepthBuffer0Pass.endEncoding()
+        if peelLayers > 0 {
+            let clearDepthBuffer0Pass = commandBuffer.makeRenderCommandEncoder(descriptor: surface.clearDepthBuffer0PassDescriptor!)!
+            clearDepthBuffer0Pass.label = "Clear Depth Buffer 0"
+            clearDepthBuffer0Pass.updateFence(lastBufferDoneFence, after: [.fragment])
+            clearDepthBuffer0Pass.endEncoding()
+        }
         
         let depthPeelPassDescriptor = MTLRenderPassDescriptor()
         depthPeelPassDescriptor.colorAttachments[0].clearColor = MTLClearColorMake(0.0, 0.0, 0.0, 0.0)
@@ -335,9 +547,9 @@ import UniformTypeIdentifiers
 
         
         var lastWrittenDepthBuffer = 0
-        for i in 1 ..< surface.colorTextures.count {
+        for i in stride(from: 1, through: peelLayers, by: 1) {
             let backDepthBuffer = 1 - lastWrittenDepthBuffer
-            let isLast = i + 1 == surface.colorTextures.count
+            let isLast = i == peelLayers
             
             let initializeDepthBufferEncoder = commandBuffer.makeBlitCommandEncoder()!
             initializeDepthBufferEncoder.label = "Initialize Depth Buffer \(i)"
@@ -362,12 +574,11 @@ import UniformTypeIdentifiers
             depthPeelPassEncoder.setDepthStencilState(sceneDrawer.resourceManager.normalDepthStencilState)
             depthPeelPassEncoder.setFragmentSamplerState(sceneDrawer.resourceManager.metalSampler, index: 0)
             depthPeelPassEncoder.setVertexBytes(&viewProjection, length: MemoryLayout<float4x4>.size, index: Int(GLLVertexInputIndexViewProjection.rawValue))
-            depthPeelPassEncoder.setVertexBuffer(lightBuffer, offset: 0, index: Int(GLLVertexInputIndexLights.rawValue))
-            depthPeelPassEncoder.setFragmentBuffer(lightBuffer, offset: 0, index: Int(GLLFragmentBufferIndexLights.rawValue))
+            bindLights(into: depthPeelPassEncoder, clusters: lightClusters)
             
             depthPeelPassEncoder.setFragmentTexture(surface.peelDepthTextures[lastWrittenDepthBuffer], index: Int(GLLFragmentArgumentIndexTextureDepthPeelFront.rawValue))
             
-            sceneDrawer.draw(into: depthPeelPassEncoder, blended: true)
+            sceneDrawer.draw(into: depthPeelPassEncoder, blended: true, visibility: visibility)
             
             depthPeelPassEncoder.updateFence(lastBufferDoneFence, after: [ .fragment ])
             depthPeelPassEncoder.endEncoding()
@@ -379,15 +590,15 @@ import UniformTypeIdentifiers
         let combineCommandEncoder = commandBuffer.makeRenderCommandEncoder(descriptor: viewRenderPassDescriptor)!
         
         combineCommandEncoder.label = "Final combine"
-        combineCommandEncoder.waitForFence(lastBufferDoneFence, before: [.vertex])
+        combineCommandEncoder.waitForFence(peelLayers > 0 ? lastBufferDoneFence : solidFence, before: [.vertex])
         combineCommandEncoder.setRenderPipelineState(sceneDrawer.resourceManager.squarePipelineState)
         combineCommandEncoder.setVertexBuffer(sceneDrawer.resourceManager.squareVertexArray, offset: 0, index: 0)
         
         // Order: 0, n-1, n-2, ..., 1
         combineCommandEncoder.setFragmentTexture(surface.colorTextures[0], index: 0)
         combineCommandEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
-        for i in 1 ..< surface.colorTextures.count {
-            combineCommandEncoder.setFragmentTexture(surface.colorTextures[surface.colorTextures.count - i], index: 0)
+        for i in stride(from: peelLayers, through: 1, by: -1) {
+            combineCommandEncoder.setFragmentTexture(surface.colorTextures[i], index: 0)
             combineCommandEncoder.drawPrimitives(type: .triangleStrip, vertexStart: 0, vertexCount: 4)
         }
         
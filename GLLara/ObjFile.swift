@@ -12,6 +12,8 @@ import Foundation
  * A fairly normal OBJ loader, extended for XNALara compatibilitiy.
  *
  * This has been updated to support colors
+ *
+ * Large files (mainly photogrammetry exports) are split at line boundaries into chunks that get parsed at the same time. Each chunk only knows how many vertices it has seen itself, so negative (relative) indices and material ranges get fixed up once all chunks are done.
  */
 struct ObjFile {
     
@@ -28,23 +30,8 @@ struct ObjFile {
         var materialName: String
     }
     
-    // Vertex data as saved in the OBJ-file.
-    private var vertices: [SIMD3<Float32>] = []
-    private var normals: [SIMD3<Float32>] = []
-    private var texCoords: [SIMD2<Float32>] = []
-    private var colors: [SIMD4<Float32>] = []
-    
-    // Indices as saved in the OBJ-file.
-    struct IndexSet: Hashable {
-        var vertex: Int = -1
-        var normal: Int? = nil
-        var texCoord: Int? = nil
-        var color: Int? = nil // Color is an XNA-Lara extension
-    }
-    private var originalIndices: [IndexSet] = []
-    
-    // Mapping from a/b/c to single indices
-    private var vertexDataForIndexSet: [IndexSet: Int] = [:]
+    // Indices of one face corner as saved in the OBJ-file, zero-based: vertex, normal, tex coord and color (an XNA-Lara extension). -1 if not present.
+    typealias Corner = SIMD4<Int32>
     
     // Vertex buffer, used by OpenGL
     var vertexData: [VertexData] = []
@@ -56,248 +43,284 @@ struct ObjFile {
     var materialRanges: [MaterialRange] = []
     var materialLibraries: [URL] = []
     
-    private class ObjDataStream {
-        static let LF = UInt8(10)
-        static let CR = UInt8(13)
-        static let SPACE = UInt8(32)
-        static let MINUS = Character("-").asciiValue!
-        static let DIGIT_0 = Character("0").asciiValue!
-        static let DIGIT_9 = Character("9").asciiValue!
-        static let SLASH = Character("/").asciiValue!
-        static let LOWERCASE_C = Character("c").asciiValue!
-        static let LOWERCASE_F = Character("f").asciiValue!
-        static let LOWERCASE_M = Character("m").asciiValue!
-        static let LOWERCASE_N = Character("n").asciiValue!
-        static let LOWERCASE_U = Character("u").asciiValue!
-        static let LOWERCASE_T = Character("t").asciiValue!
-        static let LOWERCASE_V = Character("v").asciiValue!
+    // Smaller files are parsed in one piece
+    static let minimumChunkSize = 1 << 20
+    
+    private static let LF = UInt8(10)
+    private static let CR = UInt8(13)
+    private static let SPACE = UInt8(32)
+    private static let TAB = UInt8(9)
+    private static let MINUS = Character("-").asciiValue!
+    private static let PLUS = Character("+").asciiValue!
+    private static let DOT = Character(".").asciiValue!
+    private static let DIGIT_0 = Character("0").asciiValue!
+    private static let DIGIT_9 = Character("9").asciiValue!
+    private static let SLASH = Character("/").asciiValue!
+    private static let LOWERCASE_C = Character("c").asciiValue!
+    private static let LOWERCASE_E = Character("e").asciiValue!
+    private static let UPPERCASE_E = Character("E").asciiValue!
+    private static let LOWERCASE_F = Character("f").asciiValue!
+    private static let LOWERCASE_M = Character("m").asciiValue!
+    private static let LOWERCASE_N = Character("n").asciiValue!
+    private static let LOWERCASE_U = Character("u").asciiValue!
+    private static let LOWERCASE_T = Character("t").asciiValue!
+    private static let LOWERCASE_V = Character("v").asciiValue!
+    
+    // Exactly representable as Double, so a mantissa with up to 15 digits times or divided by one of these is correctly rounded
+    private static let powersOfTen: [Double] = (0 ... 22).map { pow(10.0, Double($0)) }
+    
+    private struct ObjDataStream {
+        let bytes: UnsafeBufferPointer<UInt8>
+        var position: Int
+        let end: Int
         
-        let data: Data
-        var currentIndex: Data.Index
-        let end: Data.Index
+        var atEnd: Bool {
+            return position >= end
+        }
         
-        init(data: Data) {
-            self.data = data
-            self.currentIndex = data.startIndex
-            self.end = data.endIndex
-            if atEnd {
-                current = nil
-            } else {
-                current = data[currentIndex]
-            }
+        // Only valid if not at end
+        var current: UInt8 {
+            return bytes[position]
         }
         
-        func advance() {
-            currentIndex = currentIndex.advanced(by: 1)
-            if atEnd {
-                current = nil
-            } else {
-                current = data[currentIndex]
-            }
+        var atEndOfLine: Bool {
+            return atEnd || current == ObjFile.LF || current == ObjFile.CR
         }
         
-        var current: UInt8!
-        var atEnd: Bool {
-            return currentIndex == end
+        var atSpace: Bool {
+            return !atEnd && (current == ObjFile.SPACE || current == ObjFile.TAB)
         }
         
-        func has(string: String) -> Bool {
-            let view = string.utf8
-            var viewIndex = view.startIndex
-            while viewIndex < view.endIndex {
-                if atEnd || current != view[viewIndex] {
-                    return false
-                }
-                advance()
-                viewIndex = view.index(after: viewIndex)
+        mutating func advance() {
+            position += 1
+        }
+        
+        // True and skipped if the string is next, followed by a space
+        mutating func has(keyword: StaticString) -> Bool {
+            let count = keyword.utf8CodeUnitCount
+            guard end - position > count else {
+                return false
             }
+            let keywordBytes = UnsafeBufferPointer(start: keyword.utf8Start, count: count)
+            for i in 0 ..< count where bytes[position + i] != keywordBytes[i] {
+                return false
+            }
+            guard bytes[position + count] == ObjFile.SPACE || bytes[position + count] == ObjFile.TAB else {
+                return false
+            }
+            position += count
             return true
         }
         
-        func skipSpace() {
-            while !atEnd && current == ObjDataStream.SPACE {
+        mutating func skipSpace() {
+            while atSpace {
                 advance()
             }
         }
         
-        func skipWhitespace() {
-            while !atEnd && (current == ObjDataStream.SPACE || current == ObjDataStream.CR || current == ObjDataStream.LF) {
+        mutating func skipWhitespace() {
+            while !atEnd && (current == ObjFile.SPACE || current == ObjFile.TAB || current == ObjFile.CR || current == ObjFile.LF) {
                 advance()
             }
         }
         
-        func skipToEndOfLine() {
-            while !atEnd && current != ObjDataStream.LF && current != ObjDataStream.CR {
+        mutating func skipToEndOfLine() {
+            while !atEndOfLine {
                 advance()
             }
         }
         
-        func stringToEndOfLine() -> String {
-            let start = currentIndex
-            while !atEnd && current != ObjDataStream.LF && current != ObjDataStream.CR {
-                advance()
-            }
-            return String(data: data[start..<currentIndex], encoding: .windowsCP1252)!
+        mutating func stringToEndOfLine() -> String {
+            let start = position
+            skipToEndOfLine()
+            return String(bytes: UnsafeBufferPointer(rebasing: bytes[start ..< position]), encoding: .windowsCP1252)!
         }
         
-        func stringToWhitespace() -> String {
-            let start = currentIndex
-            while !atEnd && current != ObjDataStream.SPACE && current != ObjDataStream.LF && current != ObjDataStream.CR {
+        // Nil if there are no digits
+        mutating func parseInt() -> Int? {
+            var signum = 1
+            if !atEnd && (current == ObjFile.MINUS || current == ObjFile.PLUS) {
+                signum = current == ObjFile.MINUS ? -1 : 1
                 advance()
             }
-            return String(data: data[start..<currentIndex], encoding: .windowsCP1252)!
+            var value = 0
+            var hasDigits = false
+            while !atEnd && current >= ObjFile.DIGIT_0 && current <= ObjFile.DIGIT_9 {
+                // Anything this large is out of range anyway
+                value = min(value * 10 + Int(current - ObjFile.DIGIT_0), Int(Int32.max) * 10)
+                hasDigits = true
+                advance()
+            }
+            return hasDigits ? signum * value : nil
         }
         
-        func parseInt() -> Int {
-            var value = 0
-            var signum = 1
-            while !atEnd && current == ObjDataStream.MINUS {
-                signum *= -1
+        /**
+         * # Reads a decimal number without going through a string.
+         *
+         * Numbers with up to 15 significant digits and small exponents, which is everything exporters actually write, are computed directly. Everything else (including nan and inf) goes to the system's parser.
+         */
+        mutating func parseFloat() -> Float {
+            let start = position
+            var negative = false
+            if !atEnd && (current == ObjFile.MINUS || current == ObjFile.PLUS) {
+                negative = current == ObjFile.MINUS
+                advance()
+            }
+            var mantissa: UInt64 = 0
+            var significantDigits = 0
+            var exponent = 0
+            var hasDigits = false
+            while !atEnd && current >= ObjFile.DIGIT_0 && current <= ObjFile.DIGIT_9 {
+                if significantDigits < 19 {
+                    mantissa = mantissa * 10 + UInt64(current - ObjFile.DIGIT_0)
+                    significantDigits += mantissa == 0 ? 0 : 1
+                } else {
+                    exponent += 1
+                }
+                hasDigits = true
+                advance()
+            }
+            if !atEnd && current == ObjFile.DOT {
+                advance()
+                while !atEnd && current >= ObjFile.DIGIT_0 && current <= ObjFile.DIGIT_9 {
+                    if significantDigits < 19 {
+                        mantissa = mantissa * 10 + UInt64(current - ObjFile.DIGIT_0)
+                        significantDigits += mantissa == 0 ? 0 : 1
+                        exponent -= 1
+                    }
+                    hasDigits = true
+                    advance()
+                }
+            }
+            if hasDigits && !atEnd && (current == ObjFile.LOWERCASE_E || current == ObjFile.UPPERCASE_E) {
                 advance()
+                exponent += parseInt() ?? 0
             }
-            while !atEnd && current >= ObjDataStream.DIGIT_0 && current <= ObjDataStream.DIGIT_9 {
-                value = value * 10 + Int(current - ObjDataStream.DIGIT_0)
+            
+            if hasDigits && significantDigits <= 15 && abs(exponent) < ObjFile.powersOfTen.count {
+                var value = Double(mantissa)
+                if exponent < 0 {
+                    value /= ObjFile.powersOfTen[-exponent]
+                } else {
+                    value *= ObjFile.powersOfTen[exponent]
+                }
+                return Float(negative ? -value : value)
+            }
+            
+            position = start
+            while !atEndOfLine && !atSpace {
                 advance()
             }
-            return signum * value
+            return Float(String(decoding: UnsafeBufferPointer(rebasing: bytes[start ..< position]), as: UTF8.self)) ?? 0
         }
         
-        func parseVector<T: SIMD<Float>>(into values: inout [T]) {
+        // Missing values at the end of the line stay 0
+        mutating func parseVector<T: SIMD>(into values: inout [T]) where T.Scalar == Float {
             var value = T()
             for i in 0 ..< value.scalarCount {
                 skipSpace()
-                
-                let string = stringToWhitespace()
-                value[i] = Float(string)!
+                if atEndOfLine {
+                    break
+                }
+                value[i] = parseFloat()
             }
             values.append(value)
+            skipToEndOfLine()
         }
-
     }
     
-    private mutating func parseFace(stream: ObjDataStream) {
-        stream.advance()
-        var indexSets: [IndexSet] = []
-        while !stream.atEnd {
+    // Everything from one chunk of the file
+    private struct Chunk {
+        var vertices: [SIMD3<Float32>] = []
+        var normals: [SIMD3<Float32>] = []
+        var texCoords: [SIMD2<Float32>] = []
+        var colors: [SIMD4<Float32>] = []
+        
+        // Already split into triangles
+        var corners: [Corner] = []
+        // Corners where some indices were negative. Those are relative to the start of the chunk until they get fixed up; the bits say which ones, in the order of the indices in Corner.
+        var relativeCorners: [(corner: Int, indices: UInt8)] = []
+        
+        // usemtl, with the number of the corner where the material starts
+        var materials: [(start: Int, name: String)] = []
+        var materialLibraries: [String] = []
+        
+        // In the order of the indices in Corner
+        var counts: SIMD4<Int32> {
+            return SIMD4<Int32>(Int32(vertices.count), Int32(normals.count), Int32(texCoords.count), Int32(colors.count))
+        }
+    }
+    
+    private static func parseFace(stream: inout ObjDataStream, into chunk: inout Chunk, faceCorners: inout [(corner: Corner, relative: UInt8)]) {
+        faceCorners.removeAll(keepingCapacity: true)
+        let counts = chunk.counts
+        while true {
             stream.skipSpace()
-            
-            if stream.atEnd || stream.current == ObjDataStream.CR || stream.current == ObjDataStream.LF {
+            if stream.atEndOfLine {
                 break
             }
             
-            var set = IndexSet()
-            // Scan vertex
-            set.vertex = stream.parseInt()
-            if stream.atEnd {
+            // Parse vertex, then tex coord, normal and color if present. The order in the file is not the order in Corner.
+            var values = SIMD4<Int>(repeating: 0)
+            let positionInCorner = SIMD4<Int>(0, 2, 1, 3)
+            guard let vertex = stream.parseInt() else {
                 // Invalid
                 stream.skipToEndOfLine()
-                break
-            } else if stream.current == ObjDataStream.SLASH {
-                // Standard case: Have tex coord, normal
-                stream.advance()
-                
-                // Scan tex coord
-                set.texCoord = stream.parseInt()
-                if stream.atEnd || stream.current != ObjDataStream.SLASH {
-                    // Invalid
-                    stream.skipToEndOfLine()
+                return
+            }
+            values[0] = vertex
+            for index in 1 ..< 4 {
+                guard !stream.atEnd && stream.current == ObjFile.SLASH else {
                     break
                 }
                 stream.advance()
-                
-                // Scan normal
-                set.normal = stream.parseInt()
-                
-                // Scan color if present
-                if !stream.atEnd && stream.current == ObjDataStream.SLASH {
-                    stream.advance()
-                    set.color = stream.parseInt()
-                }
-            } else {
-                // Only vertices
-                stream.advance()
-            }
-            
-            // Postprocess
-            if set.vertex > 0 {
-                set.vertex -= 1
-            } else {
-                set.vertex += vertices.count
+                // Empty for v//vn
+                values[positionInCorner[index]] = stream.parseInt() ?? 0
             }
-            
-            if let normal = set.normal {
-                if normal > 0 {
-                    set.normal = normal - 1
-                } else {
-                    set.normal = normal + normals.count
-                }
-            }
-            
-            if let texCoord = set.texCoord {
-                if texCoord > 0 {
-                    set.texCoord = texCoord - 1
-                } else {
-                    set.texCoord = texCoord + texCoords.count
-                }
+            guard stream.atEndOfLine || stream.atSpace else {
+                // Invalid
+                stream.skipToEndOfLine()
+                return
             }
             
-            if let color = set.color {
-                if color > 0 {
-                    set.color = color - 1
-                } else {
-                    set.color = color + colors.count
+            // Postprocess: Positive ones are one-based, negative ones count back from the last one so far
+            var corner = Corner(repeating: -1)
+            var relative: UInt8 = 0
+            for index in 0 ..< 4 {
+                let value = values[index]
+                if value > 0 {
+                    corner[index] = Int32(clamping: value - 1)
+                } else if value < 0 {
+                    corner[index] = Int32(clamping: value + Int(counts[index]))
+                    relative |= 1 << index
                 }
             }
-            indexSets.append(set)
+            faceCorners.append((corner, relative))
         }
         
-        if indexSets.count < 3 {
+        if faceCorners.count < 3 {
             // Invalid
             return
         }
-        // Treat the face as a triangle fan. And reverse order while we're at it.
-        for i in 2..<indexSets.count {
-            originalIndices.append(indexSets[0])
-            originalIndices.append(indexSets[i])
-            originalIndices.append(indexSets[i-1])
-        }
-    }
-    
-    private mutating func unifiedIndex(for set: IndexSet) -> Int {
-        if let index = vertexDataForIndexSet.index(forKey: set) {
-            return vertexDataForIndexSet[index].value
-        }
-        var data = VertexData()
-        
-        data.vert = vertices[set.vertex]
-        if let normal = set.normal {
-            data.norm = normals[normal]
-        }
-        if let texCoord = set.texCoord {
-            data.tex = texCoords[texCoord]
-        }
-        if let color = set.color {
-            data.color = colors[color]
+        func append(_ faceCorner: (corner: Corner, relative: UInt8)) {
+            if faceCorner.relative != 0 {
+                chunk.relativeCorners.append((chunk.corners.count, faceCorner.relative))
+            }
+            chunk.corners.append(faceCorner.corner)
         }
-        let currentCount = vertexData.count
-        vertexData.append(data)
-        vertexDataForIndexSet[set] = currentCount
-        return currentCount
-    }
-    
-    private mutating func fillIndices() {
-        for indexSet in originalIndices {
-            indices.append(unifiedIndex(for: indexSet))
+        // Treat the face as a triangle fan. And reverse order while we're at it.
+        for i in 2 ..< faceCorners.count {
+            append(faceCorners[0])
+            append(faceCorners[i])
+            append(faceCorners[i - 1])
         }
     }
     
-    init(from location: URL) throws {
-        let data = try Data(contentsOf: location, options: .mappedIfSafe)
-        let stream = ObjDataStream(data: data)
+    private static func parse(bytes: UnsafeBufferPointer<UInt8>, range: Range<Int>) -> Chunk {
+        var stream = ObjDataStream(bytes: bytes, position: range.lowerBound, end: range.upperBound)
+        var chunk = Chunk()
+        var faceCorners: [(corner: Corner, relative: UInt8)] = []
         
-        var activeMaterial = ""
-        var activeMaterialStart = 0
-        var hasFirstMaterial = false
         while !stream.atEnd {
             stream.skipWhitespace()
             if stream.atEnd {
@@ -305,67 +328,256 @@ struct ObjFile {
             }
             
             switch stream.current {
-            case ObjDataStream.LOWERCASE_F:
-                parseFace(stream: stream)
-                break
-            case ObjDataStream.LOWERCASE_V:
+            case ObjFile.LOWERCASE_F:
                 stream.advance()
-                switch stream.current {
-                case ObjDataStream.LOWERCASE_N: // Normals
-                    stream.advance()
-                    stream.parseVector(into: &normals)
+                if stream.atSpace {
+                    parseFace(stream: &stream, into: &chunk, faceCorners: &faceCorners)
+                } else {
+                    stream.skipToEndOfLine()
+                }
+            case ObjFile.LOWERCASE_V:
+                stream.advance()
+                if stream.atSpace { // Vertex
+                    stream.parseVector(into: &chunk.vertices)
                     break
-                case ObjDataStream.LOWERCASE_T: // Tex coords
+                }
+                switch stream.atEnd ? 0 : stream.current {
+                case ObjFile.LOWERCASE_N: // Normals
                     stream.advance()
-                    stream.parseVector(into: &texCoords)
-                    break
-                case ObjDataStream.LOWERCASE_C: // Colors
+                    stream.parseVector(into: &chunk.normals)
+                case ObjFile.LOWERCASE_T: // Tex coords
                     stream.advance()
-                    stream.parseVector(into: &colors)
-                    break
-                case ObjDataStream.SPACE: // Vertex
+                    stream.parseVector(into: &chunk.texCoords)
+                case ObjFile.LOWERCASE_C: // Colors
                     stream.advance()
-                    stream.parseVector(into: &vertices)
-                    break
+                    stream.parseVector(into: &chunk.colors)
                 default:
                     stream.skipToEndOfLine()
-                    break
                 }
-                break
-            case ObjDataStream.LOWERCASE_M:
-                if stream.has(string: "mtllib") {
-                    let mtllibPath = stream.stringToEndOfLine()
-                    materialLibraries.append(objPathUrl(from: mtllibPath, relativeTo: location))
+            case ObjFile.LOWERCASE_M:
+                if stream.has(keyword: "mtllib") {
+                    chunk.materialLibraries.append(stream.stringToEndOfLine())
                 } else {
                     stream.skipToEndOfLine()
                 }
-                break
-            case ObjDataStream.LOWERCASE_U:
-                if stream.has(string: "usemtl") {
-                    if hasFirstMaterial {
-                        // End previous material run
-                        materialRanges.append(MaterialRange(start: activeMaterialStart, end: originalIndices.count, materialName: activeMaterial))
-                    } else {
-                        hasFirstMaterial = true
-                    }
-                    
-                    stream.advance()
-                    activeMaterial = stream.stringToEndOfLine()
-                    activeMaterialStart = originalIndices.count
+            case ObjFile.LOWERCASE_U:
+                if stream.has(keyword: "usemtl") {
+                    stream.skipSpace()
+                    chunk.materials.append((chunk.corners.count, stream.stringToEndOfLine()))
                 } else {
                     stream.skipToEndOfLine()
                 }
-                break
             default:
                 stream.skipToEndOfLine()
-                break
+            }
+        }
+        return chunk
+    }
+    
+    // Splits the bytes into about that many ranges that each end at the end of a line
+    private static func lineChunks(bytes: UnsafeBufferPointer<UInt8>, count: Int) -> [Range<Int>] {
+        var ranges: [Range<Int>] = []
+        var start = 0
+        for i in 1 ... max(count, 1) {
+            var end = max(start, bytes.count / count * i)
+            if i == count {
+                end = bytes.count
+            }
+            while end < bytes.count && bytes[end] != ObjFile.LF && bytes[end] != ObjFile.CR {
+                end += 1
+            }
+            if end > start {
+                ranges.append(start ..< end)
+            }
+            start = end
+        }
+        return ranges
+    }
+    
+    /**
+     * # Open addressing hash table from corners to vertex numbers.
+     *
+     * A large OBJ file has tens of millions of corners, and most of them appear several times. A Dictionary spends most of its time hashing and in its generic machinery; this stores the corners as plain 16 byte values next to each other, and looks for them with linear probing.
+     */
+    struct CornerTable {
+        private var keys: [Corner]
+        // -1 for empty slots
+        private var values: [Int32]
+        private var mask: Int
+        private(set) var count = 0
+        
+        init(minimumCapacity: Int) {
+            var capacity = 16
+            while capacity < minimumCapacity * 2 {
+                capacity *= 2
+            }
+            keys = Array(repeating: Corner(repeating: 0), count: capacity)
+            values = Array(repeating: -1, count: capacity)
+            mask = capacity - 1
+        }
+        
+        private static func hash(_ corner: Corner) -> Int {
+            let low = UInt64(UInt32(bitPattern: corner.x)) | UInt64(UInt32(bitPattern: corner.y)) << 32
+            let high = UInt64(UInt32(bitPattern: corner.z)) | UInt64(UInt32(bitPattern: corner.w)) << 32
+            var hash = low &* 0x9E3779B97F4A7C15 ^ high &* 0xC2B2AE3D27D4EB4F
+            hash ^= hash >> 31
+            hash = hash &* 0x94D049BB133111EB
+            hash ^= hash >> 29
+            return Int(truncatingIfNeeded: hash)
+        }
+        
+        // The number stored for the corner; if it is not in the table yet, it gets stored with the new number
+        mutating func index(of corner: Corner, insertingAs newIndex: Int) -> Int {
+            if (count + 1) * 2 > values.count {
+                grow()
+            }
+            var slot = CornerTable.hash(corner) & mask
+            while true {
+                let value = values[slot]
+                if value < 0 {
+                    keys[slot] = corner
+                    values[slot] = Int32(newIndex)
+                    count += 1
+                    return newIndex
+                }
+                if keys[slot] == corner {
+                    return Int(value)
+                }
+                slot = (slot + 1) & mask
             }
         }
         
+        private mutating func grow() {
+            let oldKeys = keys
+            let oldValues = values
+            keys = Array(repeating: Corner(repeating: 0), count: oldValues.count * 2)
+            values = Array(repeating: -1, count: oldValues.count * 2)
+            mask = values.count - 1
+            for (key, value) in zip(oldKeys, oldValues) where value >= 0 {
+                var slot = CornerTable.hash(key) & mask
+                while values[slot] >= 0 {
+                    slot = (slot + 1) & mask
+                }
+                keys[slot] = key
+                values[slot] = value
+            }
+        }
+    }
+    
+    init(from location: URL) throws {
+        let data = try Data(contentsOf: location, options: .mappedIfSafe)
+        try self.init(data: data, baseURL: location)
+    }
+    
+    /**
+     * # Parses the contents of a file.
+     *
+     * Material libraries are relative to the base URL. The chunk count is only there for testing; by default, it depends on the size of the file and the number of processors.
+     */
+    init(data: Data, baseURL: URL, chunkCount: Int? = nil) throws {
+        var chunks: [Chunk] = data.withUnsafeBytes { rawBytes in
+            let bytes = rawBytes.bindMemory(to: UInt8.self)
+            let count = chunkCount ?? min(ProcessInfo.processInfo.activeProcessorCount * 4, bytes.count / ObjFile.minimumChunkSize)
+            let ranges = ObjFile.lineChunks(bytes: bytes, count: max(count, 1))
+            var chunks = Array(repeating: Chunk(), count: ranges.count)
+            chunks.withUnsafeMutableBufferPointer { chunks in
+                DispatchQueue.concurrentPerform(iterations: ranges.count) { index in
+                    chunks[index] = ObjFile.parse(bytes: bytes, range: ranges[index])
+                }
+            }
+            return chunks
+        }
+        
+        // Where each chunk starts in the whole file
+        var offsets: [SIMD4<Int32>] = []
+        var cornerOffsets: [Int] = []
+        var totals = SIMD4<Int32>(repeating: 0)
+        var countOfCorners = 0
+        for chunk in chunks {
+            offsets.append(totals)
+            cornerOffsets.append(countOfCorners)
+            totals &+= chunk.counts
+            countOfCorners += chunk.corners.count
+        }
+        
+        // Make relative indices absolute
+        chunks.withUnsafeMutableBufferPointer { chunks in
+            DispatchQueue.concurrentPerform(iterations: chunks.count) { index in
+                let offset = offsets[index]
+                for (corner, relativeIndices) in chunks[index].relativeCorners {
+                    for i in 0 ..< 4 where relativeIndices & (1 << i) != 0 {
+                        chunks[index].corners[corner][i] += offset[i]
+                    }
+                }
+                chunks[index].relativeCorners = []
+            }
+        }
+        
+        var activeMaterial = ""
+        var activeMaterialStart = 0
+        var hasFirstMaterial = false
+        for (chunk, cornerOffset) in zip(chunks, cornerOffsets) {
+            materialLibraries.append(contentsOf: chunk.materialLibraries.map { objPathUrl(from: $0, relativeTo: baseURL) })
+            for (start, name) in chunk.materials {
+                if hasFirstMaterial {
+                    // End previous material run
+                    materialRanges.append(MaterialRange(start: activeMaterialStart, end: cornerOffset + start, materialName: activeMaterial))
+                } else {
+                    hasFirstMaterial = true
+                }
+                activeMaterial = name
+                activeMaterialStart = cornerOffset + start
+            }
+        }
         // Wrap up final material group
-        materialRanges.append(MaterialRange(start: activeMaterialStart, end: originalIndices.count, materialName: activeMaterial))
+        materialRanges.append(MaterialRange(start: activeMaterialStart, end: countOfCorners, materialName: activeMaterial))
+        
+        // Mapping from a/b/c to single indices. This depends on the order, so it is the one part that runs on one thread.
+        var table = CornerTable(minimumCapacity: Int(max(totals.x, totals.y, totals.z)))
+        var uniqueCorners: [Corner] = []
+        uniqueCorners.reserveCapacity(Int(max(totals.x, totals.y, totals.z)))
+        indices.reserveCapacity(countOfCorners)
+        for chunk in chunks {
+            for corner in chunk.corners {
+                guard corner.x >= 0, all((corner .< totals) .| (corner .== -1)) else {
+                    throw NSError(domain: "GLLModel", code: 11, userInfo: [
+                        NSLocalizedDescriptionKey : NSLocalizedString("A face refers to a vertex that does not exist.", comment: "OBJ index out of range error (short description)"),
+                        NSLocalizedRecoverySuggestionErrorKey : NSLocalizedString("The file may be damaged or incomplete.", comment: "OBJ index out of range error (long description)")
+                    ])
+                }
+                let index = table.index(of: corner, insertingAs: uniqueCorners.count)
+                if index == uniqueCorners.count {
+                    uniqueCorners.append(corner)
+                }
+                indices.append(index)
+            }
+        }
         
-        fillIndices()
+        let vertices = chunks.flatMap { $0.vertices }
+        let normals = chunks.flatMap { $0.normals }
+        let texCoords = chunks.flatMap { $0.texCoords }
+        let colors = chunks.flatMap { $0.colors }
+        chunks = []
+        
+        vertexData = Array(repeating: VertexData(), count: uniqueCorners.count)
+        let blockSize = 1 << 16
+        vertexData.withUnsafeMutableBufferPointer { vertexData in
+            DispatchQueue.concurrentPerform(iterations: (uniqueCorners.count + blockSize - 1) / blockSize) { block in
+                for i in block * blockSize ..< min((block + 1) * blockSize, uniqueCorners.count) {
+                    let corner = uniqueCorners[i]
+                    vertexData[i].vert = vertices[Int(corner.x)]
+                    if corner.y >= 0 {
+                        vertexData[i].norm = normals[Int(corner.y)]
+                    }
+                    if corner.z >= 0 {
+                        vertexData[i].tex = texCoords[Int(corner.z)]
+                    }
+                    if corner.w >= 0 {
+                        vertexData[i].color = colors[Int(corner.w)]
+                    }
+                }
+            }
+        }
     }
 }
 
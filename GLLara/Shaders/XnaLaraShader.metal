@@ -33,6 +33,11 @@ constant bool hasVertexColor [[ function_constant(GLLFunctionConstantHasVertexCo
 constant bool hasVariableBoneWeights [[ function_constant(GLLFunctionConstantHasVariableBoneWeights) ]];
 
 constant bool hasDepthPeelFrontBuffer [[ function_constant(GLLFunctionConstantHasDepthPeelFrontBuffer) ]];
+constant bool hasClusteredLights [[ function_constant(GLLFunctionConstantHasClusteredLights) ]];
+// Positions relative to the mesh bounds, octahedral normals and tangents; see GLLVertexQuantization
+constant bool hasQuantizedVertices [[ function_constant(GLLFunctionConstantHasQuantizedVertices) ]];
+// Summed offsets of the morph targets for every vertex, from the CPU; see GLLMorphTargetSet
+constant bool hasMorphTargets [[ function_constant(GLLFunctionConstantHasMorphTargets) ]];
 
 // TODO Probably need same for tangents when adding GLTF support
 constant int numberOfTexCoordSets [[ function_constant(GLLFunctionConstantNumberOfTexCoordSets) ]];
@@ -93,16 +98,33 @@ float3x3 upperLeft(float4x4 a) {
     return float3x3(a.columns[0].xyz, a.columns[1].xyz, a.columns[2].xyz);
 }
 
+float3 octahedralDecode(float2 encoded) {
+    float3 result = float3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (result.z < 0) {
+        result.xy = (1.0 - abs(result.yx)) * select(float2(-1.0), float2(1.0), result.xy >= 0.0);
+    }
+    return normalize(result);
+}
+
 vertex XnaLaraRasterizerData xnaLaraVertex(
     XnaLaraInputData in [[ stage_in ]],
     const device float4x4 *bones [[ buffer(GLLVertexInputIndexTransforms) ]],
     constant float4x4 & viewProjection [[ buffer(GLLVertexInputIndexViewProjection) ]],
     const device ushort* boneIndices [[ buffer(GLLVertexInputIndexBoneIndexBuffer), function_constant(hasVariableBoneWeights) ]],
-    const device float* boneWeights [[ buffer(GLLVertexInputIndexBoneWeightBuffer), function_constant(hasVariableBoneWeights) ]]
+    const device float* boneWeights [[ buffer(GLLVertexInputIndexBoneWeightBuffer), function_constant(hasVariableBoneWeights) ]],
+    const device float3* morphPositionDeltas [[ buffer(GLLVertexInputIndexMorphPositionDeltas), function_constant(hasMorphTargets) ]],
+    const device float3* morphNormalDeltas [[ buffer(GLLVertexInputIndexMorphNormalDeltas), function_constant(hasMorphTargets) ]],
+    constant uint & morphBaseVertex [[ buffer(GLLVertexInputIndexMorphBaseVertex), function_constant(hasMorphTargets) ]],
+    uint vertexID [[ vertex_id ]]
                                            ) {
     XnaLaraRasterizerData out;
     
+    // The deltas are per mesh, the vertex IDs for the whole vertex array. Both get added before skinning.
+    const uint morphIndex = hasMorphTargets ? vertexID - morphBaseVertex : 0;
+    const float3 inPosition = hasMorphTargets ? in.position + morphPositionDeltas[morphIndex] : in.position;
+    
     // Bones 0 is the permute for the normal values (TODO should it be?)
+    // The others are the mesh's bone palette; all bone indices are local to it, and local 1 is always the model's bone 0.
     float4x4 boneTransform;
     if (hasVariableBoneWeights) {
         boneTransform = float4x4(0);
@@ -119,7 +141,7 @@ vertex XnaLaraRasterizerData xnaLaraVertex(
     } else {
         boneTransform = bones[1];
     }
-    auto worldPosition = boneTransform * float4(in.position, 1.0);
+    auto worldPosition = boneTransform * float4(inPosition, 1.0);
     out.position = viewProjection * worldPosition;
     out.worldPosition = worldPosition.xyz;
     
@@ -128,18 +150,22 @@ vertex XnaLaraRasterizerData xnaLaraVertex(
     }
     
     if (hasNormal) {
+        // The bone matrices of quantized meshes also scale the positions up from the bounds; the normals have to undo that
+        const float3 inverseScale = hasQuantizedVertices ? bones[0].columns[3].xyz : float3(1.0);
+        const float3 decodedNormal = hasQuantizedVertices ? octahedralDecode(in.normal.xy) : in.normal;
+        const float3 inNormal = hasMorphTargets ? decodedNormal + morphNormalDeltas[morphIndex] : decodedNormal;
         if (calculateTangentToWorld && hasTexCoord0) {
-            float3 normal = normalize(in.normal);
-            float3 tangentU = normalize(in.tangent.xyz);
-            float3 tangentV = normalize(cross(normal, tangentU) * sign(in.tangent.w));
+            float3 normal = normalize(inNormal);
+            float3 tangentU = hasQuantizedVertices ? octahedralDecode(in.tangent.xy) : normalize(in.tangent.xyz);
+            float3 tangentV = normalize(cross(normal, tangentU) * sign(hasQuantizedVertices ? in.tangent.z : in.tangent.w));
             
             // TODO Should this be 'bone' instead of 'bones.transforms[0]'?
-            float3x3 tangentToWorld = upperLeft(bones[1]) * float3x3(tangentU, tangentV, normal) * upperLeft(bones[0]);
+            float3x3 tangentToWorld = upperLeft(bones[1]) * float3x3(tangentU * inverseScale, tangentV * inverseScale, normal * inverseScale) * upperLeft(bones[0]);
             out.tangentToWorld0 = tangentToWorld.columns[0];
             out.tangentToWorld1 = tangentToWorld.columns[1];
             out.tangentToWorld2 = tangentToWorld.columns[2];
         } else {
-            out.normalWorld = upperLeft(boneTransform) * in.normal;
+            out.normalWorld = upperLeft(boneTransform) * (inNormal * inverseScale);
         }
     }
     
@@ -200,9 +226,36 @@ struct XnaLaraFragmentArguments {
     float reflectionAmount [[ id(GLLFragmentArgumentIndexReflectionAmount) ]];
 };
 
+// Diffuse and specular from one light; the direction is the one the light shines in
+float4 lightContribution(float3 normal, float3 direction, float4 diffuseLight, float4 specularLight, float3 cameraDirection, float4 usedDiffuseColor, float4 specularColor, device XnaLaraFragmentArguments & arguments) {
+    float4 color = float4(0);
+    
+    // Diffuse term
+    float diffuseFactor = max(dot(-normal, direction), 0.0f);
+    if (hasDiffuseLighting) {
+        color += usedDiffuseColor * arguments.diffuseColor * diffuseLight * diffuseFactor;
+    }
+    
+    // Specular term
+    if (hasSpecularLighting) {
+        float3 reflectedLightDirection = reflect(direction, normal);
+        float specularFactor = pow(max(dot(cameraDirection, reflectedLightDirection), 0.0f), arguments.specularExponent);
+        if (diffuseFactor <= 0.001f) {
+            specularFactor = 0.0f;
+        }
+        color += specularLight * specularColor * specularFactor;
+    }
+    return color;
+}
+
 fragment float4 xnaLaraFragment(XnaLaraRasterizerData in [[ stage_in ]],
         device XnaLaraFragmentArguments & arguments [[ buffer(GLLFragmentBufferIndexArguments) ]],
         device GLLLightsBuffer & lights [[ buffer(GLLFragmentBufferIndexLights) ]],
+        const device GLLLightBuffer *directionalLights [[ buffer(GLLFragmentBufferIndexDirectionalLights) ]],
+        const device GLLPointLightBuffer *pointLights [[ buffer(GLLFragmentBufferIndexPointLights), function_constant(hasClusteredLights) ]],
+        const device uint2 *clusterRanges [[ buffer(GLLFragmentBufferIndexLightClusterRanges), function_constant(hasClusteredLights) ]],
+        const device uint *clusterLightIndices [[ buffer(GLLFragmentBufferIndexLightClusterIndices), function_constant(hasClusteredLights) ]],
+        constant GLLLightClusterParameters & clusters [[ buffer(GLLFragmentBufferIndexLightClusterParameters), function_constant(hasClusteredLights) ]],
         sampler textureSampler [[ sampler(0) ]],
         depth2d<float> depthPeelFrontBuffer [[ texture(GLLFragmentArgumentIndexTextureDepthPeelFront), function_constant(hasDepthPeelFrontBuffer) ]],
         uint currentSample [[ sample_id ]]) {
@@ -276,22 +329,36 @@ fragment float4 xnaLaraFragment(XnaLaraRasterizerData in [[ stage_in ]],
     float4 color = lights.ambientColor * arguments.ambientColor * usedDiffuseColor;
     
     for (int i = 0; i < numberOfUsedLights; i++) {
-        const device auto& light = lights.lights[i];
-        
-        // Diffuse term
-        float diffuseFactor = max(dot(-normal, light.direction.xyz), 0.0f);
-        if (hasDiffuseLighting) {
-            color += usedDiffuseColor * arguments.diffuseColor * light.diffuseColor * diffuseFactor;
-        }
+        const device auto& light = directionalLights[i];
+        color += lightContribution(normal, light.direction.xyz, light.diffuseColor, light.specularColor, cameraDirection, usedDiffuseColor, specularColor, arguments);
+    }
+    
+    // Point and spot lights, only the ones from the cluster this fragment is in
+    if (hasClusteredLights) {
+        float3 viewPosition = (clusters.viewMatrix * float4(in.worldPosition, 1)).xyz;
+        float depth = -viewPosition.z;
+        float2 ndc = clusters.projectionScale * viewPosition.xy / depth - clusters.projectionOffset;
+        int3 counts = int3(clusters.clusterCounts.xyz);
+        int3 cluster = int3(int2(floor((ndc * 0.5 + 0.5) * float2(counts.xy))), int(floor(log(depth) * clusters.depthSliceScale + clusters.depthSliceBias)));
+        cluster = clamp(cluster, int3(0), counts - 1);
+        uint2 range = clusterRanges[(cluster.z * counts.y + cluster.y) * counts.x + cluster.x];
         
-        // Specular term
-        if (hasSpecularLighting) {
-            float3 reflectedLightDirection = reflect(light.direction.xyz, normal);
-            float specularFactor = pow(max(dot(cameraDirection, reflectedLightDirection), 0.0f), arguments.specularExponent);
-            if (diffuseFactor <= 0.001f) {
-                specularFactor = 0.0f;
+        for (uint i = 0; i < range.y; i++) {
+            const device auto& light = pointLights[clusterLightIndices[range.x + i]];
+            float3 toFragment = in.worldPosition - light.positionAndRange.xyz;
+            float distance = length(toFragment);
+            float3 direction = toFragment / max(distance, 1e-5f);
+            
+            // Fades out smoothly towards the range, and for spot lights towards the edge of the cone
+            float falloff = saturate(1.0f - distance / light.positionAndRange.w);
+            float attenuation = falloff * falloff;
+            float spotCosine = light.spotDirectionAndCosine.w;
+            if (spotCosine > -1.0f) {
+                attenuation *= smoothstep(spotCosine, mix(spotCosine, 1.0f, 0.1f), dot(direction, light.spotDirectionAndCosine.xyz));
             }
-            color += light.specularColor * specularColor * specularFactor;
+            
+            float4 lightColor = light.color * attenuation;
+            color += lightContribution(normal, direction, lightColor, lightColor, cameraDirection, usedDiffuseColor, specularColor, arguments);
         }
     }
     
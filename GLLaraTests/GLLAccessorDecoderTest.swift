@@ -0,0 +1,104 @@
+//
+//  GLLAccessorDecoderTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLAccessorDecoderTest: XCTestCase {
+    
+    func bytes<T>(_ values: [T]) -> [UInt8] {
+        return values.withUnsafeBytes { Array($0) }
+    }
+    
+    func floats(_ decoder: GLLAccessorDecoder, _ bytes: [UInt8]) -> [Float] {
+        return bytes.withUnsafeBytes { decoder.floats(from: $0) }
+    }
+    
+    func testInvalidTypes() {
+        XCTAssertNil(GLLAccessorDecoder(componentType: 0x1404, componentCount: 1, count: 1))
+        XCTAssertNil(GLLAccessorDecoder(componentType: 0x1406, componentCount: 3, count: 1, isNormalized: true))
+        XCTAssertNil(GLLAccessorDecoder(componentType: 0x1406, componentCount: 3, count: 1, byteStride: 8))
+        XCTAssertNil(GLLAccessorDecoder.componentCount(type: "VEC5"))
+        XCTAssertEqual(GLLAccessorDecoder.componentCount(type: "MAT4"), 16)
+    }
+    
+    func testNormalized() {
+        let signedBytes = GLLAccessorDecoder(componentType: 0x1400, componentCount: 4, count: 1, isNormalized: true)!
+        XCTAssertEqual(floats(signedBytes, bytes([Int8(-128), -127, 0, 127])), [-1, -1, 0, 1])
+        
+        let unsignedBytes = GLLAccessorDecoder(componentType: 0x1401, componentCount: 2, count: 2, isNormalized: true)!
+        XCTAssertEqual(floats(unsignedBytes, bytes([UInt8(0), 255, 51, 102])), [0, 1, 0.2, 0.4])
+        
+        let signedShorts = GLLAccessorDecoder(componentType: 0x1402, componentCount: 3, count: 1, isNormalized: true)!
+        XCTAssertEqual(floats(signedShorts, bytes([Int16.min, 0, Int16.max])), [-1, 0, 1])
+        
+        let unsignedShorts = GLLAccessorDecoder(componentType: 0x1403, componentCount: 2, count: 1, isNormalized: true)!
+        XCTAssertEqual(floats(unsignedShorts, bytes([UInt16(0), UInt16.max])), [0, 1])
+        
+        // Not normalized, the values stay as they are
+        let joints = GLLAccessorDecoder(componentType: 0x1401, componentCount: 4, count: 1)!
+        XCTAssertEqual(floats(joints, bytes([UInt8(0), 3, 17, 255])), [0, 3, 17, 255])
+    }
+    
+    func testStride() {
+        // Position and normal interleaved, and the accessor for the normals starts at 12 bytes
+        let interleaved: [Float] = [0, 1, 2, 0, 0, 1, 3, 4, 5, 0, 1, 0, 6, 7, 8, 1, 0, 0]
+        let positions = GLLAccessorDecoder(componentType: 0x1406, componentCount: 3, count: 3, byteStride: 24)!
+        let normals = GLLAccessorDecoder(componentType: 0x1406, componentCount: 3, count: 3, byteStride: 24)!
+        XCTAssertEqual(positions.byteLength, 60)
+        XCTAssertEqual(floats(positions, bytes(interleaved)), [0, 1, 2, 3, 4, 5, 6, 7, 8])
+        XCTAssertEqual(floats(normals, Array(bytes(interleaved).dropFirst(12))), [0, 0, 1, 0, 1, 0, 1, 0, 0])
+        
+        // Short tex coords padded to four bytes each
+        let texCoords = GLLAccessorDecoder(componentType: 0x1403, componentCount: 1, count: 3, isNormalized: true, byteStride: 4)!
+        XCTAssertEqual(floats(texCoords, bytes([UInt16.max, 7, 0, 7, UInt16.max])), [1, 0, 1])
+    }
+    
+    func testIntegers() {
+        let shorts = GLLAccessorDecoder(componentType: 0x1403, componentCount: 1, count: 3)!
+        XCTAssertEqual(bytes([UInt16(4), 65535, 0]).withUnsafeBytes { shorts.integers(from: $0) }, [4, 65535, 0])
+        let ints = GLLAccessorDecoder(componentType: 0x1405, componentCount: 1, count: 2)!
+        XCTAssertEqual(bytes([UInt32(100_000), 7]).withUnsafeBytes { ints.integers(from: $0) }, [100_000, 7])
+    }
+    
+    func testSparse() {
+        let decoder = GLLAccessorDecoder(componentType: 0x1406, componentCount: 2, count: 4)!
+        var values: [Float] = Array(repeating: 0, count: 8)
+        let indices = bytes([UInt16(3), 1])
+        let replacements = bytes([Float(5), 6, 7, 8])
+        let applied = indices.withUnsafeBytes { indices in
+            replacements.withUnsafeBytes { replacements in
+                decoder.applySparse(count: 2, indexComponentType: 0x1403, indices: indices, values: replacements, to: &values)
+            }
+        }
+        XCTAssertTrue(applied)
+        XCTAssertEqual(values, [0, 0, 7, 8, 0, 0, 5, 6])
+        
+        // Index past the end, or signed index type
+        let tooLarge = bytes([UInt16(4)])
+        XCTAssertFalse(tooLarge.withUnsafeBytes { indices in
+            replacements.withUnsafeBytes { decoder.applySparse(count: 1, indexComponentType: 0x1403, indices: indices, values: $0, to: &values) }
+        })
+        XCTAssertFalse(indices.withUnsafeBytes { indices in
+            replacements.withUnsafeBytes { decoder.applySparse(count: 2, indexComponentType: 0x1402, indices: indices, values: $0, to: &values) }
+        })
+    }
+    
+    /**
+     * Normalized short normals for a million vertices, interleaved with other data
+     */
+    func testPerformanceNormalizedShorts() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 50)
+        let count = 1_000_000
+        let data = (0 ..< count * 8).map { _ in Int16.random(in: Int16.min ... Int16.max, using: &generator) }
+        let decoder = GLLAccessorDecoder(componentType: 0x1402, componentCount: 3, count: count, isNormalized: true, byteStride: 16)!
+        measure {
+            let result = data.withUnsafeBytes { decoder.floats(from: $0) }
+            XCTAssertEqual(result.count, count * 3)
+        }
+    }
+}
@@ -0,0 +1,78 @@
+//
+//  GLLBase64DecoderTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLBase64DecoderTest: XCTestCase {
+    
+    func randomData(count: Int, generator: inout GLLCPUSkinnerTest.Generator) -> Data {
+        return Data((0 ..< count).map { _ in UInt8.random(in: 0 ... 255, using: &generator) })
+    }
+    
+    func testSameAsFoundation() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 46)
+        // Every length of the last group, with and without the fast path
+        for count in [0, 1, 2, 3, 4, 5, 11, 12, 13, 14, 47, 48, 49, 1000, 1001, 1002] {
+            let data = randomData(count: count, generator: &generator)
+            let encoded = data.base64EncodedString()
+            XCTAssertEqual(GLLBase64Decoder.decode(encoded), data, "\(count) bytes")
+            // Without padding
+            XCTAssertEqual(GLLBase64Decoder.decode(encoded.replacingOccurrences(of: "=", with: "")), data, "\(count) bytes")
+        }
+    }
+    
+    func testPieces() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 47)
+        let data = randomData(count: 3000, generator: &generator)
+        let encoded = Array(data.base64EncodedString().utf8)
+        for _ in 0 ..< 20 {
+            var splits = (0 ..< 5).map { _ in Int.random(in: 0 ... encoded.count, using: &generator) }.sorted()
+            splits.insert(0, at: 0)
+            splits.append(encoded.count)
+            var decoder = GLLBase64Decoder()
+            encoded.withUnsafeBytes { bytes in
+                for (start, end) in zip(splits, splits.dropFirst()) {
+                    decoder.decode(UnsafeRawBufferPointer(rebasing: bytes[start ..< end]))
+                }
+            }
+            XCTAssertEqual(decoder.finish(), data)
+        }
+    }
+    
+    func testSkipsLineBreaks() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 48)
+        let data = randomData(count: 500, generator: &generator)
+        let encoded = data.base64EncodedString(options: [.lineLength64Characters, .endLineWithCarriageReturn, .endLineWithLineFeed])
+        XCTAssertEqual(GLLBase64Decoder.decode(encoded), data)
+        XCTAssertEqual(GLLBase64Decoder.decode(" SGVs\tbG8=\n"), "Hello".data(using: .utf8))
+    }
+    
+    func testInvalid() {
+        // One character alone is not a byte
+        XCTAssertNil(GLLBase64Decoder.decode("SGVsb"))
+        // Padding in the wrong places
+        XCTAssertNil(GLLBase64Decoder.decode("S==="))
+        XCTAssertNil(GLLBase64Decoder.decode("SGVsbG8=SGVs"))
+        XCTAssertNil(GLLBase64Decoder.decode("=SGVs"))
+        XCTAssertNil(GLLBase64Decoder.decode("SGV=="))
+        XCTAssertEqual(GLLBase64Decoder.decode("SGVsbA=="), "Hell".data(using: .utf8))
+        XCTAssertEqual(GLLBase64Decoder.decode(""), Data())
+    }
+    
+    /**
+     * A data URI buffer of 48 MB, as some exporters write them.
+     */
+    func testPerformanceDecode() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 49)
+        let data = randomData(count: 36_000_000, generator: &generator)
+        let encoded = data.base64EncodedString()
+        measure {
+            XCTAssertEqual(GLLBase64Decoder.decode(encoded)?.count, data.count)
+        }
+    }
+}
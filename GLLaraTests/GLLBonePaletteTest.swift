@@ -0,0 +1,94 @@
+//
+//  GLLBonePaletteTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLBonePaletteTest: XCTestCase {
+    
+    func testPaletteContainsUsedBonesAndBoneZero() {
+        let palette = GLLBonePalette(indices: [SIMD4<UInt16>(7, 3, 3, 120), SIMD4<UInt16>(3, 7, 42, 7)])
+        
+        XCTAssertEqual(palette.bones, [0, 3, 7, 42, 120])
+        XCTAssertEqual(palette.matrixCount, 6)
+        XCTAssertTrue(palette.fitsInUInt8)
+        XCTAssertEqual(palette.localIndex(of: 0), 0)
+        XCTAssertEqual(palette.localIndex(of: 42), 3)
+        
+        XCTAssertEqual(palette.remapped8Bit([SIMD4<UInt16>(7, 3, 3, 120)]), [SIMD4<UInt8>(2, 1, 1, 4)])
+        XCTAssertEqual(GLLBonePalette(indices: [UInt16(120), 5]).remapped([UInt16(120), 5]), [2, 1])
+        XCTAssertEqual(GLLBonePalette().bones, [0])
+    }
+    
+    func testLargePaletteNeedsSixteenBits() {
+        let indices = (0 ..< 100).map { SIMD4<UInt16>(UInt16($0 * 4), UInt16($0 * 4 + 1), UInt16($0 * 4 + 2), UInt16($0 * 4 + 3)) }
+        let palette = GLLBonePalette(indices: indices)
+        
+        XCTAssertEqual(palette.count, 400)
+        XCTAssertFalse(palette.fitsInUInt8)
+        XCTAssertEqual(palette.remapped(indices), indices)
+    }
+    
+    func testGather() {
+        let transforms = (0 ..< 10).map { matrix_float4x4(diagonal: SIMD4<Float>(repeating: Float($0 + 1))) }
+        let permutation = matrix_float4x4(diagonal: SIMD4<Float>(-1, 1, -1, 1))
+        let palette = GLLBonePalette(indices: [SIMD4<UInt16>(9, 4, 4, 4), SIMD4<UInt16>(12, 4, 4, 4)])
+        
+        let gathered = palette.gather(permutation: permutation, boneTransforms: transforms)
+        
+        XCTAssertEqual(gathered, [permutation, transforms[0], transforms[4], transforms[9], matrix_identity_float4x4])
+    }
+    
+    func testLocalIndicesSkinLikeGlobalOnes() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 27)
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: GLLCPUSkinnerTest.boneCount, generator: &generator)
+        
+        // Only a few bones in use, like a typical mesh
+        let usedBones: [UInt16] = [2, 5, 11, 17, 23, 40, 59]
+        let vertexCount = 1000
+        let positions = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) }
+        let normals = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) }
+        let indices = (0 ..< vertexCount).map { _ in SIMD4<UInt16>(usedBones.randomElement(using: &generator)!, usedBones.randomElement(using: &generator)!, usedBones.randomElement(using: &generator)!, usedBones.randomElement(using: &generator)!) }
+        let weights = (0 ..< vertexCount).map { _ in SIMD4<Float>(GLLCPUSkinnerTest.randomWeights(count: 4, generator: &generator)) }
+        
+        let palette = GLLBonePalette(indices: indices)
+        XCTAssertEqual(palette.count, usedBones.count + 1)
+        
+        let global = GLLCPUSkinner(positions: positions, normals: normals, boneData: .fixed(indices: indices, weights: weights)).skin(transforms: transforms)
+        
+        // Without the permutation at the start, the gathered matrices are indexed by local index
+        let gathered = Array(palette.gather(permutation: matrix_identity_float4x4, boneTransforms: transforms).dropFirst())
+        let localIndices = palette.remapped8Bit(indices).map { SIMD4<UInt16>(truncatingIfNeeded: $0) }
+        let local = GLLCPUSkinner(positions: positions, normals: normals, boneData: .fixed(indices: localIndices, weights: weights)).skin(transforms: gathered)
+        
+        XCTAssertEqual(global.positions, local.positions)
+        XCTAssertEqual(global.normals, local.normals)
+    }
+    
+    func testPerformanceGather() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 3)
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: 300, generator: &generator)
+        let palettes = (0 ..< 40).map { _ in
+            GLLBonePalette(indices: (0 ..< 40).map { _ in SIMD4<UInt16>(UInt16.random(in: 0 ..< 300, using: &generator), UInt16.random(in: 0 ..< 300, using: &generator), UInt16.random(in: 0 ..< 300, using: &generator), UInt16.random(in: 0 ..< 300, using: &generator)) })
+        }
+        let matrixCount = palettes.reduce(0) { $0 + $1.matrixCount }
+        let destination = UnsafeMutablePointer<matrix_float4x4>.allocate(capacity: matrixCount)
+        defer { destination.deallocate() }
+        
+        measure {
+            transforms.withUnsafeBufferPointer { transforms in
+                for _ in 0 ..< 1000 {
+                    var start = 0
+                    for palette in palettes {
+                        palette.gather(permutation: matrix_identity_float4x4, boneTransforms: transforms, into: destination.advanced(by: start))
+                        start += palette.matrixCount
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,189 @@
+//
+//  GLLCPUSkinnerTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLCPUSkinnerTest: XCTestCase {
+    
+    static let boneCount = 60
+    
+    // Deterministic pseudo random numbers, so failures can be reproduced
+    struct Generator: RandomNumberGenerator {
+        var state: UInt64
+        mutating func next() -> UInt64 {
+            state = state &* 6364136223846793005 &+ 1442695040888963407
+            return state
+        }
+    }
+    
+    static func randomTransforms(count: Int, generator: inout Generator) -> [matrix_float4x4] {
+        return (0 ..< count).map { _ in
+            let angles = SIMD3<Float>(Float.random(in: -Float.pi ... Float.pi, using: &generator), Float.random(in: -Float.pi ... Float.pi, using: &generator), Float.random(in: -Float.pi ... Float.pi, using: &generator))
+            var transform = GLLItemBone.rotationMatrix(angles: angles)
+            transform.columns.3 = SIMD4<Float>(Float.random(in: -2 ... 2, using: &generator), Float.random(in: -2 ... 2, using: &generator), Float.random(in: -2 ... 2, using: &generator), 1)
+            return transform
+        }
+    }
+    
+    static func randomVector(generator: inout Generator) -> SIMD3<Float> {
+        return SIMD3<Float>(Float.random(in: -1 ... 1, using: &generator), Float.random(in: -1 ... 1, using: &generator), Float.random(in: -1 ... 1, using: &generator))
+    }
+    
+    static func randomWeights(count: Int, generator: inout Generator) -> [Float] {
+        let weights = (0 ..< count).map { _ in Float.random(in: 0 ... 1, using: &generator) }
+        let sum = weights.reduce(0, +)
+        return weights.map { $0 / sum }
+    }
+    
+    // Scalar reimplementation of xnaLaraVertex, written to be obviously correct rather than fast
+    static func referenceTransform(indices: [Int], weights: [Float], transforms: [matrix_float4x4]) -> [[Float]] {
+        var result = Array(repeating: Array(repeating: Float(0), count: 4), count: 4)
+        for (index, weight) in zip(indices, weights) {
+            let transform = transforms[index]
+            let columns = [transform.columns.0, transform.columns.1, transform.columns.2, transform.columns.3]
+            for column in 0 ..< 4 {
+                for row in 0 ..< 4 {
+                    result[column][row] += columns[column][row] * weight
+                }
+            }
+        }
+        return result
+    }
+    
+    static func referenceApply(_ matrix: [[Float]], _ vector: SIMD3<Float>, w: Float) -> SIMD3<Float> {
+        var result = SIMD3<Float>(repeating: 0)
+        for row in 0 ..< 3 {
+            result[row] = matrix[0][row] * vector.x + matrix[1][row] * vector.y + matrix[2][row] * vector.z + matrix[3][row] * w
+        }
+        return result
+    }
+    
+    static func assertEqual(_ a: SIMD3<Float>, _ b: SIMD3<Float>, accuracy: Float = 1e-4, file: StaticString = #filePath, line: UInt = #line) {
+        if any(abs(a - b) .> SIMD3<Float>(repeating: accuracy)) {
+            XCTAssertEqual(a.x, b.x, accuracy: accuracy, file: file, line: line)
+            XCTAssertEqual(a.y, b.y, accuracy: accuracy, file: file, line: line)
+            XCTAssertEqual(a.z, b.z, accuracy: accuracy, file: file, line: line)
+        }
+    }
+    
+    func testKnownVertices() throws {
+        // Half way between two translations, and rotation only for the normal
+        var left = matrix_identity_float4x4
+        left.columns.3 = SIMD4<Float>(-2, 0, 0, 1)
+        var right = GLLItemBone.rotationMatrix(angles: SIMD3<Float>(0, 0, Float.pi / 2))
+        right.columns.3 = SIMD4<Float>(2, 4, 0, 1)
+        
+        let skinner = GLLCPUSkinner(positions: [SIMD3<Float>(1, 0, 0), SIMD3<Float>(1, 0, 0)],
+                                    normals: [SIMD3<Float>(1, 0, 0), SIMD3<Float>(1, 0, 0)],
+                                    tangents: [[SIMD4<Float>(0, 1, 0, -1), SIMD4<Float>(0, 1, 0, 1)]],
+                                    boneData: .fixed(indices: [SIMD4<UInt16>(0, 1, 0, 0), SIMD4<UInt16>(1, 0, 0, 0)],
+                                                     weights: [SIMD4<Float>(0.5, 0.5, 0, 0), SIMD4<Float>(1, 0, 0, 0)]))
+        let output = skinner.skin(transforms: [left, right])
+        
+        GLLCPUSkinnerTest.assertEqual(output.positions[0], SIMD3<Float>(0.5, 2.5, 0))
+        GLLCPUSkinnerTest.assertEqual(output.normals[0], SIMD3<Float>(0.5, 0.5, 0))
+        GLLCPUSkinnerTest.assertEqual(output.positions[1], SIMD3<Float>(2, 5, 0))
+        GLLCPUSkinnerTest.assertEqual(output.normals[1], SIMD3<Float>(0, 1, 0))
+        GLLCPUSkinnerTest.assertEqual(SIMD3<Float>(output.tangents[0][1].x, output.tangents[0][1].y, output.tangents[0][1].z), SIMD3<Float>(-1, 0, 0))
+        XCTAssertEqual(output.tangents[0][0].w, -1)
+        XCTAssertEqual(output.tangents[0][1].w, 1)
+    }
+    
+    func testFixedWeightsMatchReference() throws {
+        var generator = Generator(state: 26)
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: GLLCPUSkinnerTest.boneCount, generator: &generator)
+        
+        // More than one chunk, and not a multiple of the chunk size
+        let vertexCount = GLLCPUSkinner.verticesPerChunk * 2 + 17
+        let positions = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) }
+        let normals = (0 ..< vertexCount).map { _ in normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)) }
+        let tangents = (0 ..< vertexCount).map { _ in SIMD4<Float>(normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)), Bool.random(using: &generator) ? 1 : -1) }
+        let indices = (0 ..< vertexCount).map { _ in SIMD4<UInt16>((0 ..< 4).map { _ in UInt16.random(in: 0 ..< UInt16(GLLCPUSkinnerTest.boneCount), using: &generator) }) }
+        let weights = (0 ..< vertexCount).map { _ in SIMD4<Float>(GLLCPUSkinnerTest.randomWeights(count: 4, generator: &generator)) }
+        
+        let skinner = GLLCPUSkinner(positions: positions, normals: normals, tangents: [tangents], boneData: .fixed(indices: indices, weights: weights))
+        let output = skinner.skin(transforms: transforms)
+        
+        for vertex in 0 ..< vertexCount {
+            let index = indices[vertex]
+            let weight = weights[vertex]
+            let matrix = GLLCPUSkinnerTest.referenceTransform(indices: [Int(index.x), Int(index.y), Int(index.z), Int(index.w)], weights: [weight.x, weight.y, weight.z, weight.w], transforms: transforms)
+            
+            GLLCPUSkinnerTest.assertEqual(output.positions[vertex], GLLCPUSkinnerTest.referenceApply(matrix, positions[vertex], w: 1))
+            GLLCPUSkinnerTest.assertEqual(output.normals[vertex], GLLCPUSkinnerTest.referenceApply(matrix, normals[vertex], w: 0))
+            let tangent = tangents[vertex]
+            let skinnedTangent = output.tangents[0][vertex]
+            GLLCPUSkinnerTest.assertEqual(SIMD3<Float>(skinnedTangent.x, skinnedTangent.y, skinnedTangent.z), GLLCPUSkinnerTest.referenceApply(matrix, SIMD3<Float>(tangent.x, tangent.y, tangent.z), w: 0))
+            XCTAssertEqual(skinnedTangent.w, tangent.w)
+        }
+    }
+    
+    func testVariableWeightsMatchReference() throws {
+        var generator = Generator(state: 4)
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: GLLCPUSkinnerTest.boneCount, generator: &generator)
+        
+        let vertexCount = 5000
+        let positions = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) }
+        let normals = (0 ..< vertexCount).map { _ in normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)) }
+        var offsetLength: [SIMD2<UInt16>] = []
+        var indices: [UInt16] = []
+        var weights: [Float] = []
+        for _ in 0 ..< vertexCount {
+            // Up to 8 bones, like real files with variable bones per vertex. The offsets stay well below UInt16.max.
+            let count = Int.random(in: 1 ... 8, using: &generator)
+            offsetLength.append(SIMD2<UInt16>(UInt16(indices.count), UInt16(count)))
+            for _ in 0 ..< count {
+                indices.append(UInt16.random(in: 0 ..< UInt16(GLLCPUSkinnerTest.boneCount), using: &generator))
+            }
+            weights.append(contentsOf: GLLCPUSkinnerTest.randomWeights(count: count, generator: &generator))
+        }
+        
+        let skinner = GLLCPUSkinner(positions: positions, normals: normals, boneData: .variable(offsetLength: offsetLength, indices: indices, weights: weights))
+        let output = skinner.skin(transforms: transforms)
+        XCTAssertTrue(output.tangents.isEmpty)
+        
+        for vertex in 0 ..< vertexCount {
+            let range = Int(offsetLength[vertex].x) ..< Int(offsetLength[vertex].x) + Int(offsetLength[vertex].y)
+            let matrix = GLLCPUSkinnerTest.referenceTransform(indices: indices[range].map { Int($0) }, weights: Array(weights[range]), transforms: transforms)
+            
+            GLLCPUSkinnerTest.assertEqual(output.positions[vertex], GLLCPUSkinnerTest.referenceApply(matrix, positions[vertex], w: 1))
+            GLLCPUSkinnerTest.assertEqual(output.normals[vertex], GLLCPUSkinnerTest.referenceApply(matrix, normals[vertex], w: 0))
+        }
+    }
+    
+    func testNoBonesUsesFirstTransform() throws {
+        var generator = Generator(state: 1)
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: 3, generator: &generator)
+        let position = GLLCPUSkinnerTest.randomVector(generator: &generator)
+        
+        let skinner = GLLCPUSkinner(positions: [position], normals: [SIMD3<Float>(0, 0, 1)], boneData: .none)
+        let output = skinner.skin(transforms: transforms)
+        
+        let matrix = GLLCPUSkinnerTest.referenceTransform(indices: [0], weights: [1], transforms: transforms)
+        GLLCPUSkinnerTest.assertEqual(output.positions[0], GLLCPUSkinnerTest.referenceApply(matrix, position, w: 1))
+    }
+    
+    func testPerformanceFixedWeights() throws {
+        var generator = Generator(state: 2026)
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: GLLCPUSkinnerTest.boneCount, generator: &generator)
+        
+        let vertexCount = 1_000_000
+        let positions = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) }
+        let normals = (0 ..< vertexCount).map { _ in normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)) }
+        let tangents = normals.map { SIMD4<Float>($0.y, $0.z, $0.x, 1) }
+        let indices = (0 ..< vertexCount).map { _ in SIMD4<UInt16>((0 ..< 4).map { _ in UInt16.random(in: 0 ..< UInt16(GLLCPUSkinnerTest.boneCount), using: &generator) }) }
+        let weights = (0 ..< vertexCount).map { _ in SIMD4<Float>(GLLCPUSkinnerTest.randomWeights(count: 4, generator: &generator)) }
+        
+        let skinner = GLLCPUSkinner(positions: positions, normals: normals, tangents: [tangents], boneData: .fixed(indices: indices, weights: weights))
+        
+        measure {
+            _ = skinner.skin(transforms: transforms)
+        }
+    }
+    
+}
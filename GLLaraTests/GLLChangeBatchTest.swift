@@ -0,0 +1,94 @@
+//
+//  GLLChangeBatchTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLChangeBatchTest: XCTestCase {
+    
+    func testNoBatch() {
+        let batch = GLLChangeBatch(context: nil)
+        XCTAssertFalse(batch.isActive)
+        XCTAssertFalse(batch.deferUpdate(of: self, stage: .redraw, action: { XCTFail() }))
+        XCTAssertEqual(batch.deferredUpdates(in: .redraw), 0)
+    }
+    
+    func testCoalescing() {
+        let batch = GLLChangeBatch(context: nil)
+        let bone = NSObject()
+        let otherBone = NSObject()
+        var updates: [String] = []
+        
+        batch.begin()
+        for _ in 0 ..< 6 {
+            XCTAssertTrue(batch.deferUpdate(of: bone, stage: .boneTransforms, action: { updates.append("bone") }))
+        }
+        XCTAssertTrue(batch.deferUpdate(of: otherBone, stage: .boneTransforms, action: { updates.append("other bone") }))
+        XCTAssertTrue(updates.isEmpty)
+        batch.end()
+        
+        XCTAssertEqual(updates, ["bone", "other bone"])
+        XCTAssertEqual(batch.deferredUpdates(in: .boneTransforms), 7)
+        XCTAssertEqual(batch.performedUpdates(in: .boneTransforms), 2)
+        XCTAssertEqual(batch.coalescedUpdates(in: .boneTransforms), 5)
+        XCTAssertEqual(batch.coalescedUpdates, 5)
+        XCTAssertEqual(batch.completedBatches, 1)
+        XCTAssertFalse(batch.isActive)
+    }
+    
+    func testNesting() {
+        let batch = GLLChangeBatch(context: nil)
+        var redraws = 0
+        
+        batch.begin()
+        batch.begin()
+        XCTAssertTrue(batch.deferUpdate(of: self, stage: .redraw, action: { redraws += 1 }))
+        batch.end()
+        // Still in the outer one
+        XCTAssertEqual(redraws, 0)
+        XCTAssertTrue(batch.deferUpdate(of: self, stage: .redraw, action: { redraws += 1 }))
+        batch.end()
+        
+        XCTAssertEqual(redraws, 1)
+        XCTAssertEqual(batch.completedBatches, 1)
+    }
+    
+    func testLaterStagesDuringReplay() {
+        // Like a skeleton: Updating bones schedules one update for the item, which schedules one redraw
+        let batch = GLLChangeBatch(context: nil)
+        let item = NSObject()
+        let drawer = NSObject()
+        let bones = (0 ..< 10).map { _ in NSObject() }
+        var log: [String] = []
+        
+        batch.perform(actionName: nil) {
+            for bone in bones {
+                for _ in 0 ..< 6 {
+                    _ = batch.deferUpdate(of: bone, stage: .boneTransforms) {
+                        log.append("bone")
+                        // A bone stage update can't be postponed while the bone stage is running
+                        XCTAssertFalse(batch.deferUpdate(of: bone, stage: .boneTransforms, action: { log.append("immediate") }))
+                        XCTAssertTrue(batch.deferUpdate(of: item, stage: .globalTransforms) {
+                            log.append("item")
+                            XCTAssertTrue(batch.deferUpdate(of: drawer, stage: .redraw, action: { log.append("redraw") }))
+                        })
+                    }
+                }
+            }
+        }
+        
+        XCTAssertEqual(log, Array(repeating: "bone", count: 10) + ["item", "redraw"])
+        XCTAssertEqual(batch.performedUpdates(in: .boneTransforms), 10)
+        XCTAssertEqual(batch.performedUpdates(in: .globalTransforms), 1)
+        XCTAssertEqual(batch.coalescedUpdates(in: .boneTransforms), 50)
+        XCTAssertEqual(batch.coalescedUpdates(in: .globalTransforms), 9)
+        XCTAssertEqual(batch.coalescedUpdates(in: .redraw), 0)
+        
+        // Afterwards, everything happens immediately again
+        XCTAssertFalse(batch.deferUpdate(of: item, stage: .globalTransforms, action: {}))
+    }
+}
@@ -0,0 +1,152 @@
+//
+//  GLLClusteredLightsRenderingTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+@testable import GLLara
+
+class GLLClusteredLightsRenderingTest: XCTestCase {
+    
+    static let imageSize = 64
+    
+    var directory: URL!
+    var document: GLLDocument!
+    var camera: GLLCamera!
+    var sceneDrawer: GLLSceneDrawer!
+    var viewDrawer: GLLViewDrawer!
+    
+    override func setUpWithError() throws {
+        try XCTSkipIf(MTLCreateSystemDefaultDevice() == nil, "Needs a Metal device")
+        
+        directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        let textureURL = try XCTUnwrap(Bundle(for: GLLClusteredLightsRenderingTest.self).url(forResource: "testDiffusetexture.png", withExtension: nil))
+        try FileManager.default.copyItem(at: textureURL, to: directory.appendingPathComponent("testDiffusetexture.png"))
+        
+        let writer = GLLTestObjectWriter()
+        writer.numBones = 2
+        writer.numMeshes = 1
+        writer.setNumUVLayers(1, forMesh: 0)
+        writer.addTextureFilename("testDiffusetexture.png", uvLayer: 0, toMesh: 0)
+        writer.setRenderGroup(5, renderParameterValues: [], forMesh: 0)
+        let modelURL = directory.appendingPathComponent("clustered.mesh.ascii")
+        try writer.testFileString.write(to: modelURL, atomically: true, encoding: .utf8)
+        
+        document = try GLLDocument(type: "de.ferroequinologist.gllara.scene")
+        _ = try document.addModel(at: modelURL)
+        let context = document.managedObjectContext!
+        
+        // Only the positional light, so everything that is lit is lit by the clusters
+        let directionalLights = try context.fetch(NSFetchRequest<GLLDirectionalLight>(entityName: "GLLDirectionalLight"))
+        for light in directionalLights {
+            light.isEnabled = false
+        }
+        let ambientLight = try XCTUnwrap(context.fetch(NSFetchRequest<GLLAmbientLight>(entityName: "GLLAmbientLight")).first)
+        ambientLight.color = NSColor.black
+        
+        camera = try XCTUnwrap(context.fetch(NSFetchRequest<GLLCamera>(entityName: "GLLCamera")).first)
+        camera.positionX = 0.5
+        camera.positionY = 0
+        camera.positionZ = 0
+        camera.distance = 4
+        camera.latitude = -0.5
+        camera.longitude = 0.6
+        camera.fieldOfViewY = 0.7
+        context.processPendingChanges()
+        
+        sceneDrawer = GLLSceneDrawer(document: document)
+        let view = GLLView(frame: CGRect(x: 0, y: 0, width: GLLClusteredLightsRenderingTest.imageSize, height: GLLClusteredLightsRenderingTest.imageSize), device: nil)
+        viewDrawer = GLLViewDrawer(sceneDrawer: sceneDrawer, camera: camera, view: view)
+    }
+    
+    override func tearDownWithError() throws {
+        viewDrawer = nil
+        sceneDrawer = nil
+        camera = nil
+        document = nil
+        if let directory {
+            try FileManager.default.removeItem(at: directory)
+        }
+    }
+    
+    // Adds a light the way the menu item does, without the undo and selection
+    func addPositionalLight(spotLight: Bool) -> GLLPositionalLight {
+        let context = document.managedObjectContext!
+        let light = NSEntityDescription.insertNewObject(forEntityName: "GLLPositionalLight", into: context) as! GLLPositionalLight
+        light.index = 4
+        light.color = NSColor.white
+        light.isSpotLight = spotLight
+        light.range = 5
+        light.latitude = -.pi / 4
+        light.longitude = 0.6
+        light.spotAngle = .pi / 2
+        // A bit away from the cubes, pointed at them
+        let direction = light.pointLight.spotDirection
+        light.positionX = 0.5 - 2 * direction.x
+        light.positionY = -2 * direction.y
+        light.positionZ = -2 * direction.z
+        context.processPendingChanges()
+        return light
+    }
+    
+    // Lets the main queue deliver the change notification to the scene drawer
+    func waitForPointLights(_ count: Int) {
+        let updated = expectation(for: NSPredicate { [unowned self] _, _ in sceneDrawer.pointLights.count == count }, evaluatedWith: nil)
+        wait(for: [updated], timeout: 10)
+    }
+    
+    // The sum of all color channels of a rendered image
+    func renderedBrightness() -> Int {
+        let size = GLLClusteredLightsRenderingTest.imageSize
+        var imageData = Data(count: size * size * 4)
+        imageData.withUnsafeMutableBytes { bytes in
+            viewDrawer.renderImage(size: CGSize(width: size, height: size), toColorBuffer: bytes, clearColor: MTLClearColorMake(0, 0, 0, 0))
+        }
+        // BGRA, the alpha is the same with and without light
+        return imageData.enumerated().reduce(0) { $1.offset % 4 == 3 ? $0 : $0 + Int($1.element) }
+    }
+    
+    func testNoClustersWithoutPositionalLights() {
+        XCTAssertEqual(sceneDrawer.pointLights.count, 0)
+        XCTAssertFalse(sceneDrawer.lighting.hasClusteredLights)
+        _ = renderedBrightness()
+        XCTAssertNil(viewDrawer.lastLightClusters)
+    }
+    
+    func testPointLightLightsScene() {
+        let dark = renderedBrightness()
+        
+        let light = addPositionalLight(spotLight: false)
+        waitForPointLights(1)
+        XCTAssertTrue(sceneDrawer.lighting.hasClusteredLights)
+        XCTAssertEqual(sceneDrawer.lighting.directionalLights, 0)
+        
+        let lit = renderedBrightness()
+        XCTAssertNotNil(viewDrawer.lastLightClusters)
+        XCTAssertGreaterThan(lit, dark)
+        
+        // Turning it off again goes back to the shaders without clusters
+        light.isEnabled = false
+        document.managedObjectContext!.processPendingChanges()
+        waitForPointLights(0)
+        XCTAssertFalse(sceneDrawer.lighting.hasClusteredLights)
+        XCTAssertEqual(renderedBrightness(), dark)
+        XCTAssertNil(viewDrawer.lastLightClusters)
+    }
+    
+    func testSpotLightLightsScene() {
+        let dark = renderedBrightness()
+        
+        _ = addPositionalLight(spotLight: true)
+        waitForPointLights(1)
+        XCTAssertGreaterThan(sceneDrawer.pointLights[0].spotCosine, 0)
+        
+        XCTAssertGreaterThan(renderedBrightness(), dark)
+        XCTAssertNotNil(viewDrawer.lastLightClusters)
+    }
+    
+}
@@ -0,0 +1,319 @@
+//
+//  GLLDeferredMeshTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+import Metal
+@testable import GLLara
+
+class GLLDeferredMeshTest: XCTestCase {
+    
+    var directory: URL!
+    // The item drawers only keep a weak reference to their scene drawer
+    var sceneDrawers: [GLLSceneDrawer] = []
+    
+    override func setUpWithError() throws {
+        directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        let texture = try XCTUnwrap(Bundle(for: GLLDeferredMeshTest.self).url(forResource: "testDiffusetexture.png", withExtension: nil))
+        try FileManager.default.copyItem(at: texture, to: directory.appendingPathComponent("testDiffusetexture.png"))
+    }
+    
+    override func tearDownWithError() throws {
+        sceneDrawers.removeAll()
+        try FileManager.default.removeItem(at: directory)
+    }
+    
+    /**
+     * # The test object with a shown mesh and an optional part.
+     *
+     * The optional part uses a texture that does not exist, so whether it got loaded shows in the loaded textures of its mesh state.
+     */
+    func modelURL(hidingSecondMesh: Bool) throws -> URL {
+        let writer = GLLTestObjectWriter()
+        writer.numBones = 2
+        writer.numMeshes = 2
+        for mesh in 0 ..< 2 {
+            writer.setNumUVLayers(1, forMesh: UInt(mesh))
+            writer.setRenderGroup(5, renderParameterValues: [], forMesh: UInt(mesh))
+        }
+        writer.addTextureFilename("testDiffusetexture.png", uvLayer: 0, toMesh: 0)
+        writer.addTextureFilename("missing.png", uvLayer: 0, toMesh: 1)
+        writer.setOptionalPartVisible(!hidingSecondMesh, forMesh: 1)
+        let url = directory.appendingPathComponent(hidingSecondMesh ? "hidden.mesh.ascii" : "shown.mesh.ascii")
+        try writer.testFileString.write(to: url, atomically: true, encoding: .utf8)
+        return url
+    }
+    
+    func tangents(of mesh: GLLModelMesh) -> [SIMD4<Float>] {
+        return mesh.vertexDataAccessors!.accessor(semantic: .tangent0, layer: 0)!.simdArray(count: mesh.countOfVertices, type: SIMD4<Float>.self)
+    }
+    
+    // MARK: - Model meshes, without GPU
+    
+    func testHiddenMeshDefersTangents() throws {
+        let url = try modelURL(hidingSecondMesh: true)
+        let model = try GLLModelXNALara(asciiFrom: String(contentsOf: url), baseURL: url, parent: nil)
+        XCTAssertEqual(model.meshes.count, 2)
+        XCTAssertTrue(model.meshes[0].initiallyVisible)
+        XCTAssertFalse(model.meshes[0].hasDeferredProcessing)
+        
+        let hidden = model.meshes[1]
+        XCTAssertFalse(hidden.initiallyVisible)
+        XCTAssertTrue(hidden.hasDeferredProcessing)
+        // The layout already has the tangent attribute, just no data for it
+        let placeholder = try XCTUnwrap(hidden.vertexDataLayout?.accessor(semantic: .tangent0, layer: 0))
+        XCTAssertNil(placeholder.dataBuffer)
+        
+        // Same tangents as if it had been visible from the start
+        let shownURL = try modelURL(hidingSecondMesh: false)
+        let shownModel = try GLLModelXNALara(asciiFrom: String(contentsOf: shownURL), baseURL: shownURL, parent: nil)
+        XCTAssertTrue(shownModel.meshes[1].initiallyVisible)
+        hidden.finishDeferredProcessing()
+        XCTAssertFalse(hidden.hasDeferredProcessing)
+        XCTAssertEqual(tangents(of: hidden), tangents(of: shownModel.meshes[1]))
+    }
+    
+    func testConcurrentDeferredProcessing() throws {
+        let url = try modelURL(hidingSecondMesh: true)
+        let model = try GLLModelXNALara(asciiFrom: String(contentsOf: url), baseURL: url, parent: nil)
+        let hidden = model.meshes[1]
+        
+        // Everyone gets the finished tangents, no matter who calculated them
+        let lock = NSLock()
+        var results: [[SIMD4<Float>]] = []
+        DispatchQueue.concurrentPerform(iterations: 32) { iteration in
+            if iteration % 2 == 0 {
+                hidden.finishDeferredProcessing()
+            }
+            _ = hidden.hasDeferredProcessing
+            _ = hidden.vertexDataLayout
+            let result = tangents(of: hidden)
+            lock.withLock {
+                results.append(result)
+            }
+        }
+        XCTAssertFalse(hidden.hasDeferredProcessing)
+        XCTAssertEqual(results.count, 32)
+        for result in results {
+            XCTAssertEqual(result, results[0])
+        }
+        XCTAssertTrue(results[0].contains { $0 != SIMD4<Float>() })
+    }
+    
+    // MARK: - Drawing
+    
+    // Adds the model to the document and returns the item drawer for it, from a new scene drawer
+    func itemDrawer(document: GLLDocument, url: URL) throws -> GLLItemDrawer {
+        try XCTSkipIf(MTLCreateSystemDefaultDevice() == nil, "Needs a Metal device")
+        let item = try document.addModel(at: url)
+        document.managedObjectContext!.processPendingChanges()
+        let sceneDrawer = GLLSceneDrawer(document: document)
+        sceneDrawers.append(sceneDrawer)
+        return try XCTUnwrap(sceneDrawer.itemDrawers.first { $0.item == item })
+    }
+    
+    // Lets the main actor run until the mesh state is out of the deferred state
+    func waitUntilPrepared(_ meshState: GLLItemMeshState) {
+        let prepared = expectation(for: NSPredicate { _, _ in !meshState.isDeferred }, evaluatedWith: nil)
+        wait(for: [prepared], timeout: 10)
+    }
+    
+    func testHiddenMeshIsNotPrepared() throws {
+        let document = try GLLDocument(type: "de.ferroequinologist.gllara.scene")
+        let itemDrawer = try self.itemDrawer(document: document, url: modelURL(hidingSecondMesh: true))
+        
+        let shown = itemDrawer.meshStates[0]
+        XCTAssertFalse(shown.isDeferred)
+        XCTAssertNotNil(shown.pipelineStateInformation)
+        XCTAssertFalse(shown.loadedTextures.isEmpty)
+        
+        let hidden = itemDrawer.meshStates[1]
+        XCTAssertFalse(hidden.itemMesh.isVisible)
+        XCTAssertTrue(hidden.isDeferred)
+        XCTAssertNil(hidden.pipelineStateInformation)
+        XCTAssertTrue(hidden.loadedTextures.isEmpty)
+        XCTAssertFalse(hidden.meshData.isPrepared)
+        XCTAssertNil(hidden.meshData.vertexArray.vertexBuffer)
+        XCTAssertTrue(hidden.meshData.modelMesh.hasDeferredProcessing)
+        // Not in the shared vertex array of the shown mesh
+        XCTAssertFalse(hidden.meshData.vertexArray === shown.meshData.vertexArray)
+        
+        // Still nothing when the scene gets drawn
+        _ = sceneDrawers.last!.cull(viewProjection: matrix_identity_float4x4)
+        XCTAssertTrue(hidden.isDeferred)
+        XCTAssertFalse(hidden.meshData.isPrepared)
+    }
+    
+    func testShowingPreparesOnce() throws {
+        let document = try GLLDocument(type: "de.ferroequinologist.gllara.scene")
+        let url = try modelURL(hidingSecondMesh: true)
+        let itemDrawer = try self.itemDrawer(document: document, url: url)
+        let meshState = itemDrawer.meshStates[1]
+        
+        meshState.itemMesh.isVisible = true
+        waitUntilPrepared(meshState)
+        XCTAssertTrue(meshState.meshData.isPrepared)
+        XCTAssertFalse(meshState.meshData.modelMesh.hasDeferredProcessing)
+        XCTAssertNotNil(meshState.pipelineStateInformation)
+        XCTAssertTrue(meshState.loadedTextures.contains { $0.originalTexture?.lastPathComponent == "missing.png" && $0.errorThatCausedReplacement != nil })
+        let vertexBuffer = try XCTUnwrap(meshState.meshData.vertexArray.vertexBuffer)
+        
+        // Hiding and showing again does not do it again
+        meshState.itemMesh.isVisible = false
+        meshState.itemMesh.isVisible = true
+        RunLoop.main.run(until: Date(timeIntervalSinceNow: 0.1))
+        XCTAssertFalse(meshState.isDeferred)
+        XCTAssertTrue(meshState.meshData.vertexArray.vertexBuffer === vertexBuffer)
+        
+        // Neither does another item with the same model; its mesh state starts out deferred, but the data is ready
+        let otherDrawer = try self.itemDrawer(document: document, url: url)
+        let otherState = otherDrawer.meshStates[1]
+        XCTAssertTrue(otherState.meshData === meshState.meshData)
+        XCTAssertTrue(otherState.isDeferred)
+        otherState.itemMesh.isVisible = true
+        waitUntilPrepared(otherState)
+        XCTAssertTrue(otherState.meshData.vertexArray.vertexBuffer === vertexBuffer)
+    }
+    
+    func testConcurrentPrepare() throws {
+        let document = try GLLDocument(type: "de.ferroequinologist.gllara.scene")
+        let itemDrawer = try self.itemDrawer(document: document, url: modelURL(hidingSecondMesh: true))
+        let meshData = itemDrawer.meshStates[1].meshData
+        
+        let group = DispatchGroup()
+        for _ in 0 ..< 16 {
+            group.enter()
+            Task.detached {
+                await meshData.prepare()
+                XCTAssertTrue(meshData.isPrepared)
+                group.leave()
+            }
+        }
+        XCTAssertEqual(group.wait(timeout: .now() + 10), .success)
+        let vertexBuffer = try XCTUnwrap(meshData.vertexArray.vertexBuffer)
+        
+        // A late call finds it done
+        let late = DispatchGroup()
+        late.enter()
+        Task.detached {
+            await meshData.prepare()
+            late.leave()
+        }
+        XCTAssertEqual(late.wait(timeout: .now() + 10), .success)
+        XCTAssertTrue(meshData.vertexArray.vertexBuffer === vertexBuffer)
+    }
+    
+    func testConcurrentShowAndHide() throws {
+        let document = try GLLDocument(type: "de.ferroequinologist.gllara.scene")
+        let itemDrawer = try self.itemDrawer(document: document, url: modelURL(hidingSecondMesh: true))
+        let meshState = itemDrawer.meshStates[1]
+        let modelMesh = meshState.meshData.modelMesh
+        
+        // Other threads want the vertex data, e.g. for exporting, while the mesh gets shown and hidden on the main thread
+        let readers = DispatchGroup()
+        DispatchQueue.global().async(group: readers) {
+            DispatchQueue.concurrentPerform(iterations: 64) { iteration in
+                if iteration % 4 == 0 {
+                    modelMesh.finishDeferredProcessing()
+                }
+                _ = modelMesh.hasDeferredProcessing
+                _ = modelMesh.vertexDataLayout
+                _ = modelMesh.vertexDataAccessors
+            }
+        }
+        for toggle in 0 ..< 20 {
+            meshState.itemMesh.isVisible = toggle % 2 == 0
+            RunLoop.main.run(until: Date(timeIntervalSinceNow: 0.001))
+        }
+        meshState.itemMesh.isVisible = true
+        XCTAssertEqual(readers.wait(timeout: .now() + 10), .success)
+        
+        waitUntilPrepared(meshState)
+        XCTAssertTrue(meshState.meshData.isPrepared)
+        XCTAssertFalse(modelMesh.hasDeferredProcessing)
+        XCTAssertNotNil(meshState.pipelineStateInformation)
+        XCTAssertNotNil(meshState.meshData.vertexArray.vertexBuffer)
+    }
+    
+    // MARK: - Performance
+    
+    /**
+     * # A binary model of large grids, each its own mesh.
+     *
+     * The meshes after the first visibleMeshes are optional parts that start out hidden, like the clothing options of many models.
+     */
+    static func gridModel(meshes: Int, visibleMeshes: Int, gridSize: Int) -> Data {
+        var chunk = GLLExportSink.Chunk()
+        // One bone at the origin
+        chunk.append(UInt32(1))
+        chunk.appendPascalString("root")
+        chunk.append(Int16(-1))
+        for _ in 0 ..< 3 {
+            chunk.append(Float(0))
+        }
+        
+        chunk.append(UInt32(meshes))
+        for mesh in 0 ..< meshes {
+            chunk.appendPascalString(mesh < visibleMeshes ? "5_mesh\(mesh)" : "5_-part\(mesh)")
+            chunk.append(UInt32(1)) // UV layers
+            chunk.append(UInt32(0)) // Textures
+            chunk.append(UInt32(gridSize * gridSize))
+            for y in 0 ..< gridSize {
+                for x in 0 ..< gridSize {
+                    let texCoord = SIMD2<Float>(Float(x), Float(y)) / Float(gridSize - 1)
+                    for value in [texCoord.x, texCoord.y, Float(mesh)] + [0, 0, 1] {
+                        chunk.append(value)
+                    }
+                    chunk.append(UInt32.max) // Color
+                    chunk.append(texCoord.x)
+                    chunk.append(texCoord.y)
+                    for _ in 0 ..< 4 {
+                        chunk.append(Float(0)) // Tangent, calculated anyway
+                    }
+                    for _ in 0 ..< 4 {
+                        chunk.append(UInt16(0))
+                    }
+                    for weight: Float in [1, 0, 0, 0] {
+                        chunk.append(weight)
+                    }
+                }
+            }
+            
+            chunk.append(UInt32((gridSize - 1) * (gridSize - 1) * 2))
+            for y in 0 ..< gridSize - 1 {
+                for x in 0 ..< gridSize - 1 {
+                    let corner = UInt32(y * gridSize + x)
+                    for index in [corner, corner + 1, corner + UInt32(gridSize), corner + 1, corner + UInt32(gridSize) + 1, corner + UInt32(gridSize)] {
+                        chunk.append(index)
+                    }
+                }
+            }
+        }
+        return Data(chunk.bytes)
+    }
+    
+    // Loads 48 meshes, of which the given number are visible. The file gets written as generic_item, so the model parameters come from the mesh names.
+    func measureLoading(visibleMeshes: Int) throws {
+        let data = GLLDeferredMeshTest.gridModel(meshes: 48, visibleMeshes: visibleMeshes, gridSize: 96)
+        let url = directory.appendingPathComponent("generic_item.mesh")
+        try data.write(to: url)
+        
+        measure {
+            _ = try! GLLModelXNALara(binaryFrom: data, baseURL: url, parent: nil)
+        }
+    }
+    
+    func testPerformanceLoadAllVisible() throws {
+        try measureLoading(visibleMeshes: 48)
+    }
+    
+    func testPerformanceLoadMostlyHidden() throws {
+        try measureLoading(visibleMeshes: 4)
+    }
+    
+}
@@ -0,0 +1,111 @@
+//
+//  GLLDepthPeelEstimatorTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLDepthPeelEstimatorTest: XCTestCase {
+    
+    // The boxes are in clip space directly, with w = 1
+    let identity = matrix_float4x4(diagonal: SIMD4<Float>(repeating: 1))
+    
+    func box(from minimum: SIMD2<Float>, to maximum: SIMD2<Float>) -> GLLBoundingBox {
+        return GLLBoundingBox(min: SIMD3<Float>(minimum, 0.2), max: SIMD3<Float>(maximum, 0.8))
+    }
+    
+    func testNoBlendedMeshesNeedNoLayers() {
+        let estimate = GLLDepthPeelEstimator().estimate(blendedBounds: [], viewProjection: identity)
+        XCTAssertEqual(estimate.layers, 0)
+        XCTAssertEqual(estimate.blendedMeshes, 0)
+    }
+    
+    func testSelfOverlappingMeshNeedsAllLayers() {
+        // Like hair: One mesh, but without a bound it can be in front of itself any number of times
+        let hair = box(from: SIMD2<Float>(-0.3, -0.3), to: SIMD2<Float>(0.3, 0.3))
+        var estimator = GLLDepthPeelEstimator()
+        let estimate = estimator.estimate(blendedBounds: [hair], viewProjection: identity)
+        XCTAssertEqual(estimate.blendedMeshes, 1)
+        XCTAssertEqual(estimate.maximumOverlap, 1)
+        XCTAssertEqual(estimate.layers, GLLDepthPeelEstimator.maximumLayers)
+        
+        // A bound that is too large changes nothing
+        XCTAssertEqual(estimator.estimate(blendedBounds: [hair], depthComplexities: [20000], viewProjection: identity).layers, GLLDepthPeelEstimator.maximumLayers)
+        
+        estimator.maximumLayers = 4
+        XCTAssertEqual(estimator.estimate(blendedBounds: [hair], viewProjection: identity).layers, 4)
+    }
+    
+    func testSeparateMeshesDoNotAddUp() {
+        let left = box(from: SIMD2<Float>(-0.9, -0.5), to: SIMD2<Float>(-0.5, 0.5))
+        let right = box(from: SIMD2<Float>(0.5, -0.5), to: SIMD2<Float>(0.9, 0.5))
+        let estimate = GLLDepthPeelEstimator().estimate(blendedBounds: [left, right], depthComplexities: [2, 3], viewProjection: identity)
+        XCTAssertEqual(estimate.blendedMeshes, 2)
+        XCTAssertEqual(estimate.maximumOverlap, 1)
+        XCTAssertEqual(estimate.maximumDepthComplexity, 3)
+        XCTAssertEqual(estimate.layers, 3)
+    }
+    
+    func testOverlappingMeshesAddUp() {
+        let boxes = [
+            box(from: SIMD2<Float>(-0.5, -0.5), to: SIMD2<Float>(0.5, 0.5)),
+            box(from: SIMD2<Float>(0, 0), to: SIMD2<Float>(0.8, 0.8)),
+            box(from: SIMD2<Float>(-0.2, -0.2), to: SIMD2<Float>(0.2, 0.2))
+        ]
+        // Image planes, two triangles each
+        let planes = [2, 2, 2]
+        var estimator = GLLDepthPeelEstimator()
+        let estimate = estimator.estimate(blendedBounds: boxes, depthComplexities: planes, viewProjection: identity)
+        XCTAssertEqual(estimate.maximumOverlap, 3)
+        XCTAssertEqual(estimate.layers, 6)
+        
+        // A fourth one goes over what the GPU can do
+        let four = estimator.estimate(blendedBounds: boxes + [boxes[0]], depthComplexities: planes + [2], viewProjection: identity)
+        XCTAssertEqual(four.layers, GLLDepthPeelEstimator.maximumLayers)
+        
+        // And the user's setting limits it further
+        estimator.maximumLayers = 3
+        XCTAssertEqual(estimator.estimate(blendedBounds: boxes, depthComplexities: planes, viewProjection: identity).layers, 3)
+        estimator.maximumLayers = 0
+        XCTAssertEqual(estimator.estimate(blendedBounds: boxes, depthComplexities: planes, viewProjection: identity).layers, 0)
+    }
+    
+    func testOffScreenMeshesDoNotCount() {
+        let visible = box(from: SIMD2<Float>(-0.5, -0.5), to: SIMD2<Float>(0.5, 0.5))
+        let offScreen = box(from: SIMD2<Float>(1.5, -0.5), to: SIMD2<Float>(2.5, 0.5))
+        let estimate = GLLDepthPeelEstimator().estimate(blendedBounds: [visible, offScreen, .empty], viewProjection: identity)
+        XCTAssertEqual(estimate.blendedMeshes, 1)
+        XCTAssertEqual(estimate.maximumOverlap, 1)
+    }
+    
+    func testUnknownBoundsCoverEverything() {
+        let corner = box(from: SIMD2<Float>(0.8, 0.8), to: SIMD2<Float>(0.9, 0.9))
+        
+        // No box at all
+        XCTAssertEqual(GLLDepthPeelEstimator().estimate(blendedBounds: [corner, nil], viewProjection: identity).maximumOverlap, 2)
+        
+        // A box that goes through the camera plane; w is z here
+        let perspective = matrix_float4x4(columns: (SIMD4<Float>(1, 0, 0, 0), SIMD4<Float>(0, 1, 0, 0), SIMD4<Float>(0, 0, 1, 1), SIMD4<Float>(0, 0, 0, 0)))
+        let aroundCamera = GLLBoundingBox(min: SIMD3<Float>(-5, -5, -1), max: SIMD3<Float>(-4, -4, 1))
+        let cornerInFront = GLLBoundingBox(min: SIMD3<Float>(0.8, 0.8, 1), max: SIMD3<Float>(0.9, 0.9, 1))
+        XCTAssertEqual(GLLDepthPeelEstimator().estimate(blendedBounds: [cornerInFront, aroundCamera], viewProjection: perspective).maximumOverlap, 2)
+    }
+    
+    func testEstimatePerformance() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 50)
+        let boxes: [GLLBoundingBox?] = (0 ..< 2000).map { _ in
+            let center = SIMD2<Float>(Float.random(in: -1 ... 1, using: &generator), Float.random(in: -1 ... 1, using: &generator))
+            return box(from: center - 0.1, to: center + 0.1)
+        }
+        let estimator = GLLDepthPeelEstimator()
+        
+        measure {
+            for _ in 0 ..< 100 {
+                _ = estimator.estimate(blendedBounds: boxes, viewProjection: identity)
+            }
+        }
+    }
+}
@@ -0,0 +1,104 @@
+//
+//  GLLExportSinkTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLExportSinkTest: XCTestCase {
+    
+    func testSmallBufferKeepsOrder() throws {
+        var output = Data()
+        var blocks = 0
+        let sink = GLLExportSink(capacity: 16) { data in
+            XCTAssertLessThanOrEqual(data.count, 16 * 4)
+            output.append(data)
+            blocks += 1
+        }
+        
+        var expected = Data()
+        for i in 0 ..< 100 {
+            // Sizes below, at and above the capacity
+            let bytes = (0 ..< (i % 40)).map { UInt8(truncatingIfNeeded: i + $0) }
+            try bytes.withUnsafeBytes { try sink.write($0) }
+            expected.append(contentsOf: bytes)
+        }
+        try sink.flush()
+        
+        XCTAssertEqual(output, expected)
+        XCTAssertEqual(sink.bytesWritten, expected.count)
+        XCTAssertGreaterThan(blocks, 1)
+    }
+    
+    func testParallelChunksInOrder() throws {
+        var output = Data()
+        let sink = GLLExportSink { output.append($0) }
+        
+        let count = 1000
+        try sink.writeChunks(count: count) { index, chunk in
+            chunk.appendLine(SIMD2<Int32>(Int32(index), Int32(-index)))
+        }
+        try sink.flush()
+        
+        let expected = (0 ..< count).map { "\($0) \(-$0)\n" }.joined()
+        XCTAssertEqual(String(data: output, encoding: .utf8), expected)
+    }
+    
+    func testFloatsRoundTrip() throws {
+        var chunk = GLLExportSink.Chunk()
+        chunk.appendLine(SIMD3<Float>(0.1, 1, -2.5e-7))
+        XCTAssertEqual(String(decoding: chunk.bytes, as: UTF8.self), "0.1 1.0 -2.5e-07\n")
+        
+        var generator = GLLCPUSkinnerTest.Generator(state: 49)
+        for _ in 0 ..< 10000 {
+            let value = Float(bitPattern: UInt32.random(in: 0 ..< 0x7F800000, using: &generator)) * (Bool.random(using: &generator) ? 1 : -1)
+            var chunk = GLLExportSink.Chunk()
+            chunk.appendText(value)
+            let text = String(decoding: chunk.bytes, as: UTF8.self)
+            XCTAssertEqual(Float(text), value, text)
+        }
+    }
+    
+    func testBinaryValues() throws {
+        var chunk = GLLExportSink.Chunk()
+        chunk.append(UInt32(0x04030201))
+        chunk.append(UInt16(0x0605))
+        chunk.append(Float(1))
+        XCTAssertEqual(chunk.bytes, [0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x00, 0x00, 0x80, 0x3F])
+    }
+    
+    func testPascalStringLength() throws {
+        var short = GLLExportSink.Chunk()
+        short.appendPascalString("bone")
+        XCTAssertEqual(short.bytes, [4] + Array("bone".utf8))
+        
+        // Lengths from 128 on need a second byte
+        var long = GLLExportSink.Chunk()
+        let name = String(repeating: "a", count: 200)
+        long.appendPascalString(name)
+        XCTAssertEqual(Array(long.bytes.prefix(2)), [0xC8, 0x01])
+        XCTAssertEqual(long.bytes.count, 202)
+    }
+    
+    func testPerformanceAsciiVertices() throws {
+        var generator = GLLCPUSkinnerTest.Generator(state: 2026)
+        let vertexCount = 2_000_000
+        let positions = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) * 10 }
+        let chunkSize = 8192
+        
+        measure {
+            // Thrown away, like writing to a file but without the disk
+            let sink = GLLExportSink { _ in }
+            try! sink.writeChunks(count: (vertexCount + chunkSize - 1) / chunkSize) { index, chunk in
+                for i in index * chunkSize ..< min((index + 1) * chunkSize, vertexCount) {
+                    chunk.appendLine(positions[i])
+                }
+            }
+            try! sink.flush()
+        }
+    }
+    
+}
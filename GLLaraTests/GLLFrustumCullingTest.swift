@@ -0,0 +1,126 @@
+//
+//  GLLFrustumCullingTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLFrustumCullingTest: XCTestCase {
+    
+    // Same as simd_frustumMatrix: 90° field of view, looking down -z, from 1 to 100
+    let projection = matrix_float4x4(columns: (SIMD4<Float>(1, 0, 0, 0), SIMD4<Float>(0, 1, 0, 0), SIMD4<Float>(0, 0, -101.0 / 99.0, -1), SIMD4<Float>(0, 0, -200.0 / 99.0, 0)))
+    
+    func box(_ center: SIMD3<Float>, size: Float = 1) -> GLLBoundingBox {
+        return GLLBoundingBox(min: center - size / 2, max: center + size / 2)
+    }
+    
+    func testTransformedBox() {
+        let unit = GLLBoundingBox(min: SIMD3<Float>(-1, -1, -1), max: SIMD3<Float>(1, 1, 1))
+        
+        // 45° around z makes the box wider by √2 in x and y
+        var transform = GLLItemBone.rotationMatrix(angles: SIMD3<Float>(0, 0, Float.pi / 4))
+        transform.columns.3 = SIMD4<Float>(10, 0, 0, 1)
+        let transformed = unit.transformed(by: transform)
+        GLLCPUSkinnerTest.assertEqual(transformed.min, SIMD3<Float>(10 - 2.0.squareRoot(), -(2.0.squareRoot()), -1))
+        GLLCPUSkinnerTest.assertEqual(transformed.max, SIMD3<Float>(10 + 2.0.squareRoot(), 2.0.squareRoot(), 1))
+        
+        XCTAssertTrue(GLLBoundingBox.empty.isEmpty)
+        XCTAssertTrue(GLLBoundingBox.empty.transformed(by: transform).isEmpty)
+    }
+    
+    func testFrustum() {
+        let frustum = GLLFrustum(viewProjection: projection)
+        
+        XCTAssertTrue(frustum.intersects(box(SIMD3<Float>(0, 0, -10))))
+        // Behind, too near, too far
+        XCTAssertFalse(frustum.intersects(box(SIMD3<Float>(0, 0, 10))))
+        XCTAssertFalse(frustum.intersects(box(SIMD3<Float>(0, 0, -0.2), size: 0.2)))
+        XCTAssertFalse(frustum.intersects(box(SIMD3<Float>(0, 0, -200))))
+        // Left and right of the 90° cone
+        XCTAssertFalse(frustum.intersects(box(SIMD3<Float>(-20, 0, -10))))
+        XCTAssertFalse(frustum.intersects(box(SIMD3<Float>(0, 20, -10))))
+        // Crossing the edge counts as visible
+        XCTAssertTrue(frustum.intersects(box(SIMD3<Float>(-10, 0, -10), size: 2)))
+        XCTAssertFalse(frustum.intersects(.empty))
+    }
+    
+    func testScreenSize() {
+        // 2 wide at 9 to 11 away; the front face covers 2/9 of the 2 units of the view
+        XCTAssertEqual(box(SIMD3<Float>(0, 0, -10), size: 2).screenSize(viewProjection: projection), 1 / 9, accuracy: 1e-5)
+        XCTAssertEqual(box(SIMD3<Float>(0, 0, -50), size: 2).screenSize(viewProjection: projection), 1 / 49, accuracy: 1e-5)
+        // Partly behind the camera
+        XCTAssertEqual(box(SIMD3<Float>(0, 0, 0), size: 2).screenSize(viewProjection: projection), .infinity)
+        XCTAssertEqual(GLLBoundingBox.empty.screenSize(viewProjection: projection), 0)
+    }
+    
+    func testSkinnedBoundsContainSkinnedVertices() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 31)
+        let vertexCount = 2000
+        let boneCount = 20
+        
+        let positions = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) * 5 }
+        var indices: [SIMD4<UInt16>] = []
+        var weights: [SIMD4<Float>] = []
+        for _ in 0 ..< vertexCount {
+            indices.append(SIMD4<UInt16>((0 ..< 4).map { _ in UInt16.random(in: 0 ..< UInt16(boneCount), using: &generator) }))
+            weights.append(SIMD4<Float>(GLLCPUSkinnerTest.randomWeights(count: 4, generator: &generator)))
+        }
+        let boneData = GLLCPUSkinner.BoneData.fixed(indices: indices, weights: weights)
+        let bounds = GLLMeshBounds(positions: positions, boneData: boneData)
+        XCTAssertTrue(bounds.isConservative)
+        XCTAssertEqual(bounds.bindPose, GLLBoundingBox(points: positions))
+        
+        let skinner = GLLCPUSkinner(positions: positions, normals: positions, boneData: boneData)
+        for _ in 0 ..< 5 {
+            let transforms = GLLCPUSkinnerTest.randomTransforms(count: boneCount, generator: &generator)
+            let box = transforms.withUnsafeBufferPointer { bounds.skinned(boneTransforms: $0) }!
+            for position in skinner.skin(transforms: transforms).positions {
+                XCTAssertTrue(all(position .>= box.min - 1e-4) && all(position .<= box.max + 1e-4))
+            }
+        }
+    }
+    
+    func testUnnormalizedWeightsAreNeverCulled() {
+        let positions = [SIMD3<Float>(0, 0, 0), SIMD3<Float>(1, 0, 0)]
+        let bounds = GLLMeshBounds(positions: positions, boneData: .fixed(indices: [SIMD4<UInt16>(0, 0, 0, 0), SIMD4<UInt16>(1, 0, 0, 0)], weights: [SIMD4<Float>(1, 0, 0, 0), SIMD4<Float>(0.5, 0, 0, 0)]))
+        XCTAssertFalse(bounds.isConservative)
+        XCTAssertNil([matrix_identity_float4x4, matrix_identity_float4x4].withUnsafeBufferPointer { bounds.skinned(boneTransforms: $0) })
+        
+        let unskinned = GLLMeshBounds(positions: positions, boneData: .none)
+        XCTAssertEqual(unskinned.bones, [0])
+    }
+    
+    func testStatistics() {
+        let frustum = GLLFrustum(viewProjection: projection)
+        let boxes: [GLLBoundingBox?] = [box(SIMD3<Float>(0, 0, -10)), box(SIMD3<Float>(0, 0, 10)), nil, box(SIMD3<Float>(50, 0, -10))]
+        let result = GLLCullingResult(frustum: frustum, boxes: boxes, triangleCounts: [100, 200, 300, 400])
+        
+        var visible: [Int] = []
+        result.visible.forEachMember { visible.append($0) }
+        XCTAssertEqual(visible, [0, 2])
+        XCTAssertEqual(result.statistics.meshes, 4)
+        XCTAssertEqual(result.statistics.culledMeshes, 2)
+        XCTAssertEqual(result.statistics.triangles, 1000)
+        XCTAssertEqual(result.statistics.culledTriangles, 600)
+    }
+    
+    func testPerformanceSkinnedBounds() {
+        // 100 meshes with 100 bones each, roughly a large scene
+        var generator = GLLCPUSkinnerTest.Generator(state: 131)
+        let positions = (0 ..< 5000).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) }
+        let indices = (0 ..< 5000).map { i in SIMD4<UInt16>(UInt16(i % 100), 0, 0, 0) }
+        let bounds = GLLMeshBounds(positions: positions, boneData: .fixed(indices: indices, weights: Array(repeating: SIMD4<Float>(1, 0, 0, 0), count: 5000)))
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: 100, generator: &generator)
+        let frustum = GLLFrustum(viewProjection: projection)
+        
+        measure {
+            transforms.withUnsafeBufferPointer { transforms in
+                let boxes = (0 ..< 100).map { _ in bounds.skinned(boneTransforms: transforms) }
+                _ = GLLCullingResult(frustum: frustum, boxes: boxes, triangleCounts: Array(repeating: 1000, count: 100))
+            }
+        }
+    }
+}
@@ -0,0 +1,84 @@
+//
+//  GLLImageTilingTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+import simd
+
+class GLLImageTilingTest: XCTestCase {
+    
+    func testTilesCoverImageOnce() {
+        let tiling = GLLImageTiling(width: 100, height: 70, maximumTileSize: 32)
+        XCTAssertEqual(tiling.tileWidth, 32)
+        XCTAssertEqual(tiling.tileHeight, 32)
+        XCTAssertEqual(tiling.tilesPerRow, 4)
+        XCTAssertEqual(tiling.tileRows, 3)
+        
+        var coverage = Array(repeating: 0, count: 100 * 70)
+        for tile in tiling.tiles {
+            for y in tile.y ..< tile.y + tile.height {
+                for x in tile.x ..< tile.x + tile.width {
+                    coverage[y * 100 + x] += 1
+                }
+            }
+        }
+        XCTAssertEqual(coverage, Array(repeating: 1, count: 100 * 70))
+    }
+    
+    func testSingleTileIsUnchanged() {
+        let tiling = GLLImageTiling(width: 300, height: 200, maximumTileSize: 2048)
+        XCTAssertEqual(tiling.tiles.count, 1)
+        XCTAssertEqual(tiling.tileWidth, 300)
+        XCTAssertEqual(tiling.tileHeight, 200)
+        
+        var generator = GLLCPUSkinnerTest.Generator(state: 40)
+        let full = GLLCPUSkinnerTest.randomTransforms(count: 1, generator: &generator)[0]
+        let tile = tiling.viewProjection(for: tiling.tiles[0], fullViewProjection: full)
+        for column in 0 ..< 4 {
+            XCTAssertLessThan(simd_distance(tile[column], full[column]), 1e-5)
+        }
+    }
+    
+    func testTileCornersMapToEdges() {
+        let tiling = GLLImageTiling(width: 100, height: 50, maximumTileSize: 40)
+        let identity = matrix_float4x4(diagonal: SIMD4<Float>(repeating: 1))
+        for tile in tiling.tiles {
+            let viewProjection = tiling.viewProjection(for: tile, fullViewProjection: identity)
+            // Corners of the rendered area in the full image's normalized device coordinates
+            let topLeft = SIMD4<Float>(2 * Float(tile.x) / 100 - 1, 1 - 2 * Float(tile.y) / 50, 0.5, 1)
+            let bottomRight = SIMD4<Float>(2 * Float(tile.x + tiling.tileWidth) / 100 - 1, 1 - 2 * Float(tile.y + tiling.tileHeight) / 50, 0.5, 1)
+            XCTAssertLessThan(simd_distance(viewProjection * topLeft, SIMD4<Float>(-1, 1, 0.5, 1)), 1e-5)
+            XCTAssertLessThan(simd_distance(viewProjection * bottomRight, SIMD4<Float>(1, -1, 0.5, 1)), 1e-5)
+        }
+    }
+    
+    func testTiledRenderingMatchesFullRendering() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 41)
+        let drawables = GLLSoftwareRasterizerTest.randomTriangles(count: 100, blendedFraction: 0.5, generator: &generator)
+        let identity = matrix_float4x4(diagonal: SIMD4<Float>(repeating: 1))
+        
+        let width = 128
+        let height = 64
+        let full = GLLSoftwareRasterizer(width: width, height: height).render(drawables: drawables, viewProjection: identity, lights: GLLSoftwareRasterizerTest.noLights)
+        
+        let tiling = GLLImageTiling(width: width, height: height, maximumTileSize: 32)
+        let rasterizer = GLLSoftwareRasterizer(width: tiling.tileWidth, height: tiling.tileHeight)
+        var assembled = Array(repeating: SIMD4<Float>(), count: width * height)
+        for tile in tiling.tiles {
+            let image = rasterizer.render(drawables: drawables, viewProjection: tiling.viewProjection(for: tile, fullViewProjection: identity), lights: GLLSoftwareRasterizerTest.noLights)
+            for y in 0 ..< tile.height {
+                for x in 0 ..< tile.width {
+                    assembled[(tile.y + y) * width + tile.x + x] = image[x: x, y: y]
+                }
+            }
+        }
+        
+        // Rounding in the extra matrix can move an edge across a pixel center now and then, but no more than that
+        let mismatches = zip(full.pixels, assembled).filter { simd_reduce_max(abs($0 - $1)) > 1e-4 }.count
+        XCTAssertLessThanOrEqual(mismatches, width * height / 200)
+    }
+}
@@ -0,0 +1,158 @@
+//
+//  GLLLightClustersTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLLightClustersTest: XCTestCase {
+    
+    let grid = GLLLightClusters.Grid(fieldOfViewY: 60, aspectRatio: 16.0 / 9.0, near: 0.1, far: 100)
+    // Camera a bit back from the origin, looking down -z
+    let viewMatrix = matrix_float4x4(columns: (SIMD4<Float>(1, 0, 0, 0), SIMD4<Float>(0, 1, 0, 0), SIMD4<Float>(0, 0, 1, 0), SIMD4<Float>(0, 0, -5, 1)))
+    
+    // A third of them are spot lights
+    func randomLights(count: Int, generator: inout GLLCPUSkinnerTest.Generator) -> [GLLPointLight] {
+        return (0 ..< count).map { index in
+            let position = SIMD3<Float>(Float.random(in: -20 ... 20, using: &generator), Float.random(in: -15 ... 15, using: &generator), Float.random(in: -60 ... 8, using: &generator))
+            var light = GLLPointLight(position: position, range: Float.random(in: 1 ... 8, using: &generator), color: SIMD4<Float>(1, 1, 1, 1))
+            if index % 3 == 0 {
+                light.spotDirection = SIMD3<Float>(Float.random(in: -1 ... 1, using: &generator), Float.random(in: -1 ... 1, using: &generator), Float.random(in: -1 ... 1, using: &generator)) + SIMD3<Float>(0, 0, 0.01)
+                light.spotCosine = Float.random(in: 0.3 ... 0.95, using: &generator)
+            }
+            return light
+        }
+    }
+    
+    func testSlices() {
+        XCTAssertEqual(grid.slice(depth: grid.near), 0)
+        XCTAssertEqual(grid.slice(depth: grid.far), grid.slices - 1)
+        XCTAssertEqual(grid.depth(slice: grid.slices), grid.far, accuracy: 1e-3)
+        for slice in 0 ..< grid.slices {
+            let middle = (grid.depth(slice: slice) + grid.depth(slice: slice + 1)) / 2
+            XCTAssertEqual(grid.slice(depth: middle), slice)
+        }
+        
+        // Closer slices are thinner
+        XCTAssertLessThan(grid.depth(slice: 1) - grid.depth(slice: 0), grid.depth(slice: 11) - grid.depth(slice: 10))
+    }
+    
+    func testSpotLightSpheres() {
+        let point = GLLPointLight(position: SIMD3<Float>(1, 2, 3), range: 4, color: SIMD4<Float>(1, 1, 1, 1))
+        XCTAssertEqual(point.boundingSphere.center, point.position)
+        XCTAssertEqual(point.boundingSphere.radius, 4)
+        
+        for cosine: Float in [0.2, 0.7, 0.98] {
+            var spot = point
+            spot.spotDirection = SIMD3<Float>(0, 1, 0)
+            spot.spotCosine = cosine
+            let sphere = spot.boundingSphere
+            XCTAssertLessThan(sphere.radius, spot.range)
+            
+            // Tip, far end and rim of the cone are all inside
+            let sine = (1 - cosine * cosine).squareRoot()
+            for corner in [spot.position, spot.position + SIMD3<Float>(0, 4, 0), spot.position + 4 * SIMD3<Float>(sine, cosine, 0)] {
+                XCTAssertLessThanOrEqual(simd_distance(corner, sphere.center), sphere.radius * 1.0001)
+            }
+        }
+    }
+    
+    func testMatchesBruteForce() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 37)
+        let lights = randomLights(count: 100, generator: &generator)
+        let clusters = GLLLightClusters(lights: lights, viewMatrix: viewMatrix, grid: grid)
+        XCTAssertEqual(clusters.ranges.count, grid.count)
+        
+        for slice in 0 ..< grid.slices {
+            for y in 0 ..< grid.tilesY {
+                for x in 0 ..< grid.tilesX {
+                    let bounds = grid.bounds(x: x, y: y, slice: slice)
+                    let expected = lights.indices.filter { index in
+                        let sphere = lights[index].boundingSphere
+                        let center = viewMatrix * SIMD4<Float>(sphere.center, 1)
+                        let closest = simd_clamp(SIMD3<Float>(center.x, center.y, center.z), bounds.min, bounds.max)
+                        return simd_distance_squared(closest, SIMD3<Float>(center.x, center.y, center.z)) <= sphere.radius * sphere.radius
+                    }.map { UInt32($0) }
+                    XCTAssertEqual(Array(clusters.lights(inCluster: grid.index(x: x, y: y, slice: slice))), expected)
+                }
+            }
+        }
+    }
+    
+    func testConcurrentMatchesSerial() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 38)
+        let lights = randomLights(count: 256, generator: &generator)
+        let concurrent = GLLLightClusters(lights: lights, viewMatrix: viewMatrix, grid: grid, concurrent: true)
+        let serial = GLLLightClusters(lights: lights, viewMatrix: viewMatrix, grid: grid, concurrent: false)
+        XCTAssertEqual(concurrent.ranges, serial.ranges)
+        XCTAssertEqual(concurrent.indices, serial.indices)
+    }
+    
+    func testLitPointsFindTheirLights() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 39)
+        let lights = randomLights(count: 64, generator: &generator)
+        let clusters = GLLLightClusters(lights: lights, viewMatrix: viewMatrix, grid: grid)
+        let inverseView = viewMatrix.inverse
+        
+        var litPoints = 0
+        for _ in 0 ..< 5000 {
+            let ndc = SIMD2<Float>(Float.random(in: -0.99 ... 0.99, using: &generator), Float.random(in: -0.99 ... 0.99, using: &generator))
+            let depth = grid.near * pow(grid.far / grid.near, Float.random(in: 0.01 ... 0.99, using: &generator))
+            let viewPosition = SIMD3<Float>((ndc + grid.projectionOffset) / grid.projectionScale * depth, -depth)
+            let world = inverseView * SIMD4<Float>(viewPosition, 1)
+            let worldPosition = SIMD3<Float>(world.x, world.y, world.z)
+            
+            let cluster = grid.cluster(viewPosition: viewPosition)!
+            let listed = Set(clusters.lights(inCluster: cluster))
+            for (index, light) in lights.enumerated() {
+                let toPoint = worldPosition - light.position
+                guard simd_length(toPoint) < light.range else {
+                    continue
+                }
+                if light.spotCosine > -1 && simd_dot(simd_normalize(toPoint), simd_normalize(light.spotDirection)) < light.spotCosine {
+                    continue
+                }
+                litPoints += 1
+                XCTAssertTrue(listed.contains(UInt32(index)), "Light \(index) missing in cluster \(cluster)")
+            }
+        }
+        XCTAssertGreaterThan(litPoints, 0)
+    }
+    
+    func testLightsOutsideOfViewAreSkipped() {
+        let behind = GLLPointLight(position: SIMD3<Float>(0, 0, 10), range: 2, color: SIMD4<Float>(1, 1, 1, 1))
+        let tooFar = GLLPointLight(position: SIMD3<Float>(0, 0, -200), range: 2, color: SIMD4<Float>(1, 1, 1, 1))
+        let aside = GLLPointLight(position: SIMD3<Float>(50, 0, -10), range: 2, color: SIMD4<Float>(1, 1, 1, 1))
+        let clusters = GLLLightClusters(lights: [behind, tooFar, aside], viewMatrix: viewMatrix, grid: grid)
+        XCTAssertTrue(clusters.indices.isEmpty)
+        XCTAssertEqual(clusters.maximumLightsPerCluster, 0)
+        
+        // A spot light at the camera, pointing backwards
+        var spot = GLLPointLight(position: SIMD3<Float>(0, 0, 5), range: 6, color: SIMD4<Float>(1, 1, 1, 1))
+        spot.spotDirection = SIMD3<Float>(0, 0, 1)
+        spot.spotCosine = 0.9
+        XCTAssertTrue(GLLLightClusters(lights: [spot], viewMatrix: viewMatrix, grid: grid).indices.isEmpty)
+    }
+    
+    func measureBinning(lights count: Int) {
+        var generator = GLLCPUSkinnerTest.Generator(state: 40)
+        let lights = randomLights(count: count, generator: &generator)
+        
+        measure {
+            for _ in 0 ..< 100 {
+                _ = GLLLightClusters(lights: lights, viewMatrix: viewMatrix, grid: grid)
+            }
+        }
+    }
+    
+    func testBinning64LightsPerformance() {
+        measureBinning(lights: 64)
+    }
+    
+    func testBinning256LightsPerformance() {
+        measureBinning(lights: 256)
+    }
+}
@@ -0,0 +1,239 @@
+//
+//  GLLMeshBVHTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLMeshBVHTest: XCTestCase {
+    
+    // Small triangles all over a box, like a messy mesh
+    func randomSoup(triangles: Int, generator: inout GLLCPUSkinnerTest.Generator) -> (positions: [SIMD3<Float>], indices: [UInt32]) {
+        var positions: [SIMD3<Float>] = []
+        for _ in 0 ..< triangles {
+            let center = GLLCPUSkinnerTest.randomVector(generator: &generator) * 10
+            for _ in 0 ..< 3 {
+                positions.append(center + GLLCPUSkinnerTest.randomVector(generator: &generator))
+            }
+        }
+        return (positions, (0 ..< UInt32(positions.count)).map { $0 })
+    }
+    
+    /**
+     * # A closed tube made of a grid, skinned to a chain of bones.
+     *
+     * Stands in for a character body; with the default size, it has as many triangles as the largest models we have.
+     */
+    func skinnedTube(rings: Int = 500, segments: Int = 250, bones: Int = 20) -> (positions: [SIMD3<Float>], indices: [UInt32], boneData: GLLCPUSkinner.BoneData) {
+        var positions: [SIMD3<Float>] = []
+        var boneIndices: [SIMD4<UInt16>] = []
+        var boneWeights: [SIMD4<Float>] = []
+        for ring in 0 ..< rings {
+            let height = Float(ring) / Float(rings - 1) * 2
+            let bone = min(Int(height / 2 * Float(bones)), bones - 1)
+            let next = min(bone + 1, bones - 1)
+            let blend = height / 2 * Float(bones) - Float(bone)
+            for segment in 0 ..< segments {
+                let angle = Float(segment) / Float(segments) * 2 * Float.pi
+                positions.append(SIMD3<Float>(cos(angle) * 0.2, height, sin(angle) * 0.2))
+                boneIndices.append(SIMD4<UInt16>(UInt16(bone), UInt16(next), 0, 0))
+                boneWeights.append(SIMD4<Float>(1 - blend, blend, 0, 0))
+            }
+        }
+        var indices: [UInt32] = []
+        for ring in 0 ..< rings - 1 {
+            for segment in 0 ..< segments {
+                let a = UInt32(ring * segments + segment)
+                let b = UInt32(ring * segments + (segment + 1) % segments)
+                let c = a + UInt32(segments)
+                let d = b + UInt32(segments)
+                indices.append(contentsOf: [a, b, c, b, d, c])
+            }
+        }
+        return (positions, indices, .fixed(indices: boneIndices, weights: boneWeights))
+    }
+    
+    func bruteForce(positions: [SIMD3<Float>], indices: [UInt32], origin: SIMD3<Float>, direction: SIMD3<Float>) -> GLLMeshBVH.Hit? {
+        // A hierarchy with a single leaf tests all triangles directly
+        var closest: GLLMeshBVH.Hit? = nil
+        for triangle in 0 ..< indices.count / 3 {
+            let single = GLLMeshBVH(positions: positions, indices: Array(indices[triangle * 3 ..< triangle * 3 + 3]))
+            if let hit = single.intersect(origin: origin, direction: direction), hit.distance < (closest?.distance ?? .infinity) {
+                closest = GLLMeshBVH.Hit(triangle: triangle, distance: hit.distance, barycentrics: hit.barycentrics)
+            }
+        }
+        return closest
+    }
+    
+    func randomRay(generator: inout GLLCPUSkinnerTest.Generator) -> (origin: SIMD3<Float>, direction: SIMD3<Float>) {
+        let origin = GLLCPUSkinnerTest.randomVector(generator: &generator) * 15
+        let target = GLLCPUSkinnerTest.randomVector(generator: &generator) * 5
+        return (origin, simd_normalize(target - origin))
+    }
+    
+    func assertSameHit(_ hit: GLLMeshBVH.Hit?, _ expected: GLLMeshBVH.Hit?, file: StaticString = #filePath, line: UInt = #line) {
+        XCTAssertEqual(hit?.triangle, expected?.triangle, file: file, line: line)
+        if let hit = hit, let expected = expected {
+            XCTAssertEqual(hit.distance, expected.distance, accuracy: 1e-4, file: file, line: line)
+            GLLCPUSkinnerTest.assertEqual(hit.barycentrics, expected.barycentrics, file: file, line: line)
+        }
+    }
+    
+    func testEveryTriangleInOneLeaf() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 60)
+        let soup = randomSoup(triangles: 1000, generator: &generator)
+        let bvh = GLLMeshBVH(positions: soup.positions, indices: soup.indices)
+        XCTAssertEqual(bvh.triangleOrder.sorted(), (0 ..< 1000).map { UInt32($0) })
+        
+        var referenced = 0
+        for (index, node) in bvh.nodes.enumerated() {
+            for lane in 0 ..< 4 where node.isUsed(lane: lane) {
+                if node.count[lane] > 0 {
+                    XCTAssertLessThanOrEqual(Int(node.count[lane]), GLLMeshBVH.maximumLeafSize)
+                    referenced += Int(node.count[lane])
+                } else {
+                    XCTAssertGreaterThan(Int(node.child[lane]), index)
+                }
+            }
+        }
+        XCTAssertEqual(referenced, 1000)
+    }
+    
+    func testMatchesBruteForce() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 61)
+        let soup = randomSoup(triangles: 500, generator: &generator)
+        let bvh = GLLMeshBVH(positions: soup.positions, indices: soup.indices)
+        
+        var hits = 0
+        for _ in 0 ..< 200 {
+            let ray = randomRay(generator: &generator)
+            let expected = bruteForce(positions: soup.positions, indices: soup.indices, origin: ray.origin, direction: ray.direction)
+            assertSameHit(bvh.intersect(origin: ray.origin, direction: ray.direction), expected)
+            hits += expected == nil ? 0 : 1
+        }
+        XCTAssertGreaterThan(hits, 20)
+    }
+    
+    func testConcurrentBuildMatchesSerial() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 62)
+        let soup = randomSoup(triangles: 5000, generator: &generator)
+        let concurrent = GLLMeshBVH(positions: soup.positions, indices: soup.indices, concurrent: true)
+        let serial = GLLMeshBVH(positions: soup.positions, indices: soup.indices, concurrent: false)
+        XCTAssertEqual(concurrent.triangleOrder, serial.triangleOrder)
+        XCTAssertEqual(concurrent.nodes.count, serial.nodes.count)
+        
+        for _ in 0 ..< 200 {
+            let ray = randomRay(generator: &generator)
+            assertSameHit(concurrent.intersect(origin: ray.origin, direction: ray.direction), serial.intersect(origin: ray.origin, direction: ray.direction))
+        }
+    }
+    
+    func testRefitMatchesBruteForce() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 63)
+        let soup = randomSoup(triangles: 500, generator: &generator)
+        var bvh = GLLMeshBVH(positions: soup.positions, indices: soup.indices)
+        
+        // Every triangle moves on its own, so the old boxes are all wrong
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: 8, generator: &generator)
+        let moved = soup.positions.enumerated().map { index, position -> SIMD3<Float> in
+            let transformed = transforms[(index / 3) % transforms.count] * SIMD4<Float>(position, 1)
+            return SIMD3<Float>(transformed.x, transformed.y, transformed.z)
+        }
+        bvh.refit(positions: moved)
+        
+        let root = bvh.nodes[0].bounds
+        for position in moved {
+            XCTAssertTrue(all(position .>= root.min) && all(position .<= root.max))
+        }
+        for _ in 0 ..< 200 {
+            let ray = randomRay(generator: &generator)
+            assertSameHit(bvh.intersect(origin: ray.origin, direction: ray.direction), bruteForce(positions: moved, indices: soup.indices, origin: ray.origin, direction: ray.direction))
+        }
+    }
+    
+    func testMaximumDistance() {
+        let positions = [SIMD3<Float>(-1, -1, -5), SIMD3<Float>(1, -1, -5), SIMD3<Float>(0, 1, -5)]
+        let bvh = GLLMeshBVH(positions: positions, indices: [0, 1, 2])
+        let hit = bvh.intersect(origin: SIMD3<Float>(0, 0, 0), direction: SIMD3<Float>(0, 0, -1))
+        XCTAssertEqual(hit?.distance ?? 0, 5, accuracy: 1e-5)
+        XCTAssertNil(bvh.intersect(origin: SIMD3<Float>(0, 0, 0), direction: SIMD3<Float>(0, 0, -1), maximumDistance: 4))
+        XCTAssertNil(bvh.intersect(origin: SIMD3<Float>(0, 0, 0), direction: SIMD3<Float>(0, 0, 1)))
+        XCTAssertNil(GLLMeshBVH(positions: [], indices: []).intersect(origin: SIMD3<Float>(0, 0, 0), direction: SIMD3<Float>(0, 0, 1)))
+    }
+    
+    func testDominantBone() {
+        let fixed = GLLCPUSkinner.BoneData.fixed(indices: [SIMD4<UInt16>(3, 5, 0, 0), SIMD4<UInt16>(5, 0, 0, 0), SIMD4<UInt16>(7, 0, 0, 0)],
+                                                 weights: [SIMD4<Float>(0.6, 0.4, 0, 0), SIMD4<Float>(1, 0, 0, 0), SIMD4<Float>(1, 0, 0, 0)])
+        let corners = SIMD3<UInt32>(0, 1, 2)
+        XCTAssertEqual(fixed.dominantBone(corners: corners, barycentrics: SIMD3<Float>(1, 0, 0)), 3)
+        // Bone 5 has 0.4 from the first corner and all of the second
+        XCTAssertEqual(fixed.dominantBone(corners: corners, barycentrics: SIMD3<Float>(0.5, 0.3, 0.2)), 5)
+        XCTAssertEqual(fixed.dominantBone(corners: corners, barycentrics: SIMD3<Float>(0, 0, 1)), 7)
+        
+        let variable = GLLCPUSkinner.BoneData.variable(offsetLength: [SIMD2<UInt16>(0, 2), SIMD2<UInt16>(2, 1), SIMD2<UInt16>(3, 1)], indices: [9, 2, 9, 4], weights: [0.5, 0.5, 1, 1])
+        XCTAssertEqual(variable.dominantBone(corners: corners, barycentrics: SIMD3<Float>(0.4, 0.3, 0.3)), 9)
+        // A tie goes to the lower index
+        XCTAssertEqual(variable.dominantBone(corners: corners, barycentrics: SIMD3<Float>(1, 0, 0)), 2)
+        
+        XCTAssertEqual(GLLCPUSkinner.BoneData.none.dominantBone(corners: corners, barycentrics: SIMD3<Float>(1, 0, 0)), 0)
+    }
+    
+    func testPickSkinnedTube() {
+        let tube = skinnedTube(rings: 50, segments: 30, bones: 4)
+        let skinner = GLLCPUSkinner(positions: tube.positions, normals: tube.positions, boneData: tube.boneData)
+        var bvh = GLLMeshBVH(positions: tube.positions, indices: tube.indices)
+        
+        // Move the top half far to the side
+        var transforms = Array(repeating: matrix_float4x4(diagonal: SIMD4<Float>(repeating: 1)), count: 4)
+        transforms[3].columns.3 = SIMD4<Float>(10, 0, 0, 1)
+        bvh.refit(positions: skinner.skin(transforms: transforms).positions)
+        
+        // Where the top was, there is nothing now
+        XCTAssertNil(bvh.intersect(origin: SIMD3<Float>(0, 1.9, 5), direction: SIMD3<Float>(0, 0, -1)))
+        let hit = bvh.intersect(origin: SIMD3<Float>(10, 1.9, 5), direction: SIMD3<Float>(0, 0, -1))
+        XCTAssertNotNil(hit)
+        XCTAssertEqual(hit?.distance ?? 0, 4.8, accuracy: 1e-2)
+        let triangle = hit!.triangle
+        let corners = SIMD3<UInt32>(tube.indices[triangle * 3], tube.indices[triangle * 3 + 1], tube.indices[triangle * 3 + 2])
+        XCTAssertEqual(tube.boneData.dominantBone(corners: corners, barycentrics: hit!.barycentrics), 3)
+    }
+    
+    // MARK: - Performance
+    
+    func testBuildPerformance() {
+        let tube = skinnedTube()
+        measure {
+            _ = GLLMeshBVH(positions: tube.positions, indices: tube.indices)
+        }
+    }
+    
+    func testRefitPerformance() {
+        let tube = skinnedTube()
+        var bvh = GLLMeshBVH(positions: tube.positions, indices: tube.indices)
+        let moved = tube.positions.map { $0 * 1.1 }
+        measure {
+            bvh.refit(positions: moved)
+        }
+    }
+    
+    func testIntersectPerformance() {
+        let tube = skinnedTube()
+        let bvh = GLLMeshBVH(positions: tube.positions, indices: tube.indices)
+        var generator = GLLCPUSkinnerTest.Generator(state: 64)
+        let rays = (0 ..< 100_000).map { _ -> (SIMD3<Float>, SIMD3<Float>) in
+            let origin = SIMD3<Float>(Float.random(in: -1 ... 1, using: &generator), Float.random(in: 0 ... 2, using: &generator), 5)
+            return (origin, simd_normalize(SIMD3<Float>(0, Float.random(in: 0 ... 2, using: &generator), 0) - origin))
+        }
+        
+        XCTAssertTrue(rays.contains { bvh.intersect(origin: $0.0, direction: $0.1) != nil })
+        
+        measure {
+            for ray in rays {
+                _ = bvh.intersect(origin: ray.0, direction: ray.1)
+            }
+        }
+    }
+}
@@ -0,0 +1,91 @@
+//
+//  GLLMeshPartitionTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLMeshPartitionTest: XCTestCase {
+    
+    // The splitters for thorwireframe in lara.modelparams.plist
+    let laraBoxes = [
+        GLLBoundingBox(min: SIMD3<Float>(-.infinity, 1.25, -.infinity), max: SIMD3<Float>(0, .infinity, .infinity)),
+        GLLBoundingBox(min: SIMD3<Float>(0, 1.25, -.infinity), max: SIMD3<Float>(.infinity, .infinity, .infinity)),
+        GLLBoundingBox(min: SIMD3<Float>(repeating: -.infinity), max: SIMD3<Float>(.infinity, 1.25, .infinity))
+    ]
+    // Position, normal, color, one UV layer with tangent, bone indices and weights, as in a generic item
+    let xnaLaraVertexSize = 12 + 12 + 4 + 8 + 16 + 8 + 16
+    
+    func randomMesh(vertices: Int, triangles: Int, generator: inout GLLCPUSkinnerTest.Generator) -> (positions: [SIMD3<Float>], indices: [UInt32]) {
+        // Rings around a tube between 0 and 2 high, like a character
+        let positions = (0 ..< vertices).map { index -> SIMD3<Float> in
+            let angle = Float(index % 100) / 100 * 2 * Float.pi
+            let center = SIMD3<Float>(cos(angle) * 0.3, Float(index) / Float(vertices) * 2, sin(angle) * 0.3)
+            return center + GLLCPUSkinnerTest.randomVector(generator: &generator) * 0.01
+        }
+        // Corners are close together in the order, and so also in space
+        let indices = (0 ..< triangles * 3).map { index -> UInt32 in
+            let base = (index / 3) * vertices / triangles
+            return UInt32((base + Int.random(in: 0 ..< 16, using: &generator)) % vertices)
+        }
+        return (positions, indices)
+    }
+    
+    func testMatchesBruteForce() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 70)
+        let mesh = randomMesh(vertices: 3000, triangles: 5000, generator: &generator)
+        let boxes = laraBoxes + [GLLBoundingBox(min: SIMD3<Float>(-0.5, 0.5, -0.5), max: SIMD3<Float>(0.5, 1.5, 0.5)), GLLBoundingBox(min: SIMD3<Float>(5, 5, 5), max: SIMD3<Float>(6, 6, 6))]
+        let partition = GLLMeshPartition(positions: mesh.positions, indices: mesh.indices, boxes: boxes)
+        XCTAssertEqual(partition.parts.count, boxes.count)
+        
+        for (box, part) in zip(boxes, partition.parts) {
+            var expected: [UInt32] = []
+            for triangle in 0 ..< mesh.indices.count / 3 {
+                let corners = mesh.indices[triangle * 3 ..< triangle * 3 + 3]
+                if corners.contains(where: { all(mesh.positions[Int($0)] .>= box.min .& mesh.positions[Int($0)] .<= box.max) }) {
+                    expected.append(contentsOf: corners)
+                }
+            }
+            XCTAssertEqual(part.indices.map { part.vertices[Int($0)] }, expected)
+            
+            // Every vertex only once, and only those that get used
+            XCTAssertEqual(Set(part.vertices).count, part.vertices.count)
+            XCTAssertEqual(Set(part.vertices), Set(expected))
+        }
+        XCTAssertTrue(partition.parts.last!.vertices.isEmpty)
+    }
+    
+    func testConcurrentMatchesSerial() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 71)
+        let mesh = randomMesh(vertices: 20000, triangles: 40000, generator: &generator)
+        let concurrent = GLLMeshPartition(positions: mesh.positions, indices: mesh.indices, boxes: laraBoxes, concurrent: true)
+        let serial = GLLMeshPartition(positions: mesh.positions, indices: mesh.indices, boxes: laraBoxes, concurrent: false)
+        for (a, b) in zip(concurrent.parts, serial.parts) {
+            XCTAssertEqual(a.vertices, b.vertices)
+            XCTAssertEqual(a.indices, b.indices)
+        }
+    }
+    
+    func testSavedVertexMemory() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 72)
+        let mesh = randomMesh(vertices: 60000, triangles: 100000, generator: &generator)
+        let partition = GLLMeshPartition(positions: mesh.positions, indices: mesh.indices, boxes: laraBoxes)
+        
+        let sharedSize = mesh.positions.count * xnaLaraVertexSize * laraBoxes.count
+        let compactedSize = partition.parts.reduce(0) { $0 + $1.vertices.count * xnaLaraVertexSize }
+        
+        // The parts only overlap at the edges of the boxes
+        XCTAssertLessThan(compactedSize, sharedSize / 2)
+    }
+    
+    func testPartitionPerformance() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 73)
+        let mesh = randomMesh(vertices: 150000, triangles: 250000, generator: &generator)
+        measure {
+            _ = GLLMeshPartition(positions: mesh.positions, indices: mesh.indices, boxes: laraBoxes)
+        }
+    }
+}
@@ -0,0 +1,197 @@
+//
+//  GLLMeshSimplifierTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLMeshSimplifierTest: XCTestCase {
+    
+    // A closed torus without any seams, so nothing is locked
+    func torus(segments: Int, rings: Int) -> (positions: [SIMD3<Float>], normals: [SIMD3<Float>], indices: [UInt32]) {
+        var positions: [SIMD3<Float>] = []
+        var normals: [SIMD3<Float>] = []
+        for segment in 0 ..< segments {
+            let u = Float(segment) / Float(segments) * 2 * Float.pi
+            for ring in 0 ..< rings {
+                let v = Float(ring) / Float(rings) * 2 * Float.pi
+                let normal = SIMD3<Float>(cos(u) * cos(v), sin(u) * cos(v), sin(v))
+                positions.append(SIMD3<Float>(cos(u), sin(u), 0) + normal * 0.3)
+                normals.append(normal)
+            }
+        }
+        var indices: [UInt32] = []
+        for segment in 0 ..< segments {
+            for ring in 0 ..< rings {
+                let a = UInt32(segment * rings + ring)
+                let b = UInt32(((segment + 1) % segments) * rings + ring)
+                let c = UInt32(((segment + 1) % segments) * rings + (ring + 1) % rings)
+                let d = UInt32(segment * rings + (ring + 1) % rings)
+                indices.append(contentsOf: [a, b, c, a, c, d])
+            }
+        }
+        return (positions, normals, indices)
+    }
+    
+    // Every edge of a closed mesh belongs to exactly two triangles
+    func assertClosed(_ indices: [UInt32], file: StaticString = #filePath, line: UInt = #line) {
+        var edges: [SIMD2<UInt32>: Int] = [:]
+        for triangle in stride(from: 0, to: indices.count, by: 3) {
+            XCTAssertNotEqual(indices[triangle], indices[triangle + 1], file: file, line: line)
+            XCTAssertNotEqual(indices[triangle + 1], indices[triangle + 2], file: file, line: line)
+            XCTAssertNotEqual(indices[triangle + 2], indices[triangle], file: file, line: line)
+            for corner in 0 ..< 3 {
+                let a = indices[triangle + corner], b = indices[triangle + (corner + 1) % 3]
+                edges[SIMD2<UInt32>(min(a, b), max(a, b)), default: 0] += 1
+            }
+        }
+        XCTAssertTrue(edges.values.allSatisfy { $0 == 2 }, file: file, line: line)
+    }
+    
+    func testTorusLevels() {
+        let mesh = torus(segments: 64, rings: 32)
+        let simplifier = GLLMeshSimplifier(positions: mesh.positions, normals: mesh.normals, indices: mesh.indices)
+        
+        XCTAssertEqual(simplifier.countOfTriangles, 4096)
+        XCTAssertEqual(simplifier.levels.count, 3)
+        var previousError: Float = 0
+        for (level, ratio) in zip(simplifier.levels, GLLMeshSimplifier.targetRatios) {
+            XCTAssertLessThanOrEqual(level.countOfTriangles, Int(4096 * ratio))
+            XCTAssertGreaterThanOrEqual(level.error, previousError)
+            previousError = level.error
+            assertClosed(level.indices)
+            XCTAssertTrue(level.indices.allSatisfy { Int($0) < mesh.positions.count })
+        }
+        // Diagonal is about 3.4
+        XCTAssertLessThan(simplifier.levels.last!.error, 0.1)
+        XCTAssertTrue(GLLMeshSimplifier.report(meshNames: ["Torus"], countsOfTriangles: [simplifier.countOfTriangles], levels: [simplifier.levels]).contains("Torus"))
+    }
+    
+    func testKeepsBordersAndSeams() {
+        // A flat grid, where the middle column exists twice, like at a UV seam
+        let size = 32
+        let seam = size / 2
+        var positions: [SIMD3<Float>] = []
+        var texCoords: [SIMD2<Float>] = []
+        var vertexIndex: [SIMD2<Int>: UInt32] = [:]
+        var seamCopies: [Int: UInt32] = [:]
+        for y in 0 ... size {
+            for x in 0 ... size {
+                vertexIndex[SIMD2<Int>(x, y)] = UInt32(positions.count)
+                positions.append(SIMD3<Float>(Float(x), Float(y), 0) * 0.1)
+                texCoords.append(SIMD2<Float>(Float(x), Float(y)) / Float(size))
+                if x == seam {
+                    seamCopies[y] = UInt32(positions.count)
+                    positions.append(SIMD3<Float>(Float(x), Float(y), 0) * 0.1)
+                    texCoords.append(SIMD2<Float>(0.9, Float(y) / Float(size)))
+                }
+            }
+        }
+        func index(_ x: Int, _ y: Int, rightOfSeam: Bool) -> UInt32 {
+            if x == seam && rightOfSeam {
+                return seamCopies[y]!
+            }
+            return vertexIndex[SIMD2<Int>(x, y)]!
+        }
+        var indices: [UInt32] = []
+        for y in 0 ..< size {
+            for x in 0 ..< size {
+                let right = x >= seam
+                indices.append(contentsOf: [index(x, y, rightOfSeam: right), index(x + 1, y, rightOfSeam: right), index(x + 1, y + 1, rightOfSeam: right)])
+                indices.append(contentsOf: [index(x, y, rightOfSeam: right), index(x + 1, y + 1, rightOfSeam: right), index(x, y + 1, rightOfSeam: right)])
+            }
+        }
+        
+        let simplifier = GLLMeshSimplifier(positions: positions, texCoords: [texCoords], indices: indices)
+        XCTAssertFalse(simplifier.levels.isEmpty)
+        var mustStay = Set(seamCopies.values)
+        for y in 0 ... size {
+            mustStay.insert(index(seam, y, rightOfSeam: false))
+            mustStay.insert(index(0, y, rightOfSeam: false))
+            mustStay.insert(index(size, y, rightOfSeam: false))
+        }
+        for x in 0 ... size {
+            mustStay.insert(index(x, 0, rightOfSeam: false))
+            mustStay.insert(index(x, size, rightOfSeam: false))
+        }
+        for level in simplifier.levels {
+            XCTAssertTrue(mustStay.isSubset(of: Set(level.indices)))
+            // Everything stays in the plane
+            XCTAssertEqual(level.error, 0, accuracy: 1e-5)
+        }
+    }
+    
+    func testBoneWeightDifference() {
+        func difference(_ indices: [UInt16], _ weights: [Float], _ otherIndices: [UInt16], _ otherWeights: [Float]) -> Float {
+            return GLLMeshSimplifier.boneWeightDifference(indices: indices[...], weights: weights[...], otherIndices: otherIndices[...], otherWeights: otherWeights[...])
+        }
+        XCTAssertEqual(difference([1, 2], [0.5, 0.5], [1, 2], [0.5, 0.5]), 0)
+        // Order does not matter
+        XCTAssertEqual(difference([1, 2], [0.25, 0.75], [2, 1], [0.75, 0.25]), 0)
+        // Completely different bones
+        XCTAssertEqual(difference([1], [1], [2], [1]), 2)
+        XCTAssertEqual(difference([1, 2], [0.5, 0.5], [2, 3], [0.5, 0.5]), 0.5)
+        // The same bone twice counts once, with both weights
+        XCTAssertEqual(difference([1, 1], [0.5, 0.5], [1], [1]), 0)
+        XCTAssertEqual(difference([], [], [4, 4], [0.5, 0.5]), 1)
+    }
+    
+    func testSkinningIsKeptApart() {
+        let mesh = torus(segments: 64, rings: 32)
+        // Every segment is on its own bone, except that all of one half are on the same one
+        let boneIndices = (0 ..< mesh.positions.count).map { vertex -> SIMD4<UInt16> in
+            let segment = vertex / 32
+            return SIMD4<UInt16>(segment < 32 ? 0 : UInt16(segment), 0, 0, 0)
+        }
+        let weights = Array(repeating: SIMD4<Float>(1, 0, 0, 0), count: mesh.positions.count)
+        let simplifier = GLLMeshSimplifier(positions: mesh.positions, normals: mesh.normals, boneData: .fixed(indices: boneIndices, weights: weights), indices: mesh.indices, targetRatios: [0.75])
+        
+        // The half on one bone is where the collapses are cheap, so it loses more of its vertices
+        let used = Set(simplifier.levels[0].indices)
+        let usedOnOneBone = used.filter { $0 < 32 * 32 }.count
+        XCTAssertLessThan(usedOnOneBone, used.count - usedOnOneBone)
+    }
+    
+    func testSmallMeshesHaveNoLevels() {
+        let simplifier = GLLMeshSimplifier(positions: [SIMD3<Float>(0, 0, 0), SIMD3<Float>(1, 0, 0), SIMD3<Float>(0, 1, 0)], indices: [0, 1, 2])
+        XCTAssertTrue(simplifier.levels.isEmpty)
+        XCTAssertTrue(GLLMeshSimplifier(positions: [], indices: []).levels.isEmpty)
+    }
+    
+    func testDetailLevelFromScreenSize() {
+        XCTAssertEqual(GLLMeshSimplifier.detailLevel(screenSize: .infinity, countOfLevels: 3), 0)
+        XCTAssertEqual(GLLMeshSimplifier.detailLevel(screenSize: 0.5, countOfLevels: 3), 0)
+        XCTAssertEqual(GLLMeshSimplifier.detailLevel(screenSize: 0.2, countOfLevels: 3), 1)
+        XCTAssertEqual(GLLMeshSimplifier.detailLevel(screenSize: 0.1, countOfLevels: 3), 2)
+        XCTAssertEqual(GLLMeshSimplifier.detailLevel(screenSize: 0.01, countOfLevels: 3), 3)
+        XCTAssertEqual(GLLMeshSimplifier.detailLevel(screenSize: 0.01, countOfLevels: 1), 1)
+        XCTAssertEqual(GLLMeshSimplifier.detailLevel(screenSize: 0.01, countOfLevels: 0), 0)
+    }
+    
+    func testCacheRoundTrip() {
+        let mesh = torus(segments: 32, rings: 16)
+        let simplifier = GLLMeshSimplifier(positions: mesh.positions, normals: mesh.normals, indices: mesh.indices)
+        let data = GLLMeshSimplifier.encode(levels: simplifier.levels)
+        XCTAssertEqual(GLLMeshSimplifier.decode(data, countOfVertices: mesh.positions.count), simplifier.levels)
+        XCTAssertEqual(GLLMeshSimplifier.decode(GLLMeshSimplifier.encode(levels: []), countOfVertices: 0), [])
+        
+        // Damaged or for a different mesh
+        XCTAssertNil(GLLMeshSimplifier.decode(data.dropLast(), countOfVertices: mesh.positions.count))
+        XCTAssertNil(GLLMeshSimplifier.decode(data, countOfVertices: 10))
+        XCTAssertNil(GLLMeshSimplifier.decode(Data(), countOfVertices: mesh.positions.count))
+        
+        let key = GLLMeshSimplifier.cacheKey(positions: mesh.positions, normals: mesh.normals, texCoords: [], boneData: .none, indices: mesh.indices)
+        XCTAssertEqual(key, GLLMeshSimplifier.cacheKey(positions: mesh.positions, normals: mesh.normals, texCoords: [], boneData: .none, indices: mesh.indices))
+        XCTAssertNotEqual(key, GLLMeshSimplifier.cacheKey(positions: mesh.positions, normals: mesh.normals, texCoords: [], boneData: .none, indices: mesh.indices.reversed()))
+    }
+    
+    func testSimplificationPerformance() {
+        let mesh = torus(segments: 256, rings: 128)
+        measure {
+            _ = GLLMeshSimplifier(positions: mesh.positions, normals: mesh.normals, indices: mesh.indices)
+        }
+    }
+}
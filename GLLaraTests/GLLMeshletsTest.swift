@@ -0,0 +1,234 @@
+//
+//  GLLMeshletsTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLMeshletsTest: XCTestCase {
+    
+    // Same as in GLLFrustumCullingTest: 90° field of view, looking down -z, from 1 to 100
+    let projection = matrix_float4x4(columns: (SIMD4<Float>(1, 0, 0, 0), SIMD4<Float>(0, 1, 0, 0), SIMD4<Float>(0, 0, -101.0 / 99.0, -1), SIMD4<Float>(0, 0, -200.0 / 99.0, 0)))
+    
+    // A torus around the z axis, with the vertices of one segment next to each other
+    func torus(segments: Int, rings: Int) -> (positions: [SIMD3<Float>], indices: [UInt32]) {
+        var positions: [SIMD3<Float>] = []
+        for segment in 0 ..< segments {
+            let u = Float(segment) / Float(segments) * 2 * Float.pi
+            for ring in 0 ..< rings {
+                let v = Float(ring) / Float(rings) * 2 * Float.pi
+                positions.append(SIMD3<Float>(cos(u), sin(u), 0) * (1 + 0.3 * cos(v)) + SIMD3<Float>(0, 0, 0.3 * sin(v)))
+            }
+        }
+        var indices: [UInt32] = []
+        for segment in 0 ..< segments {
+            for ring in 0 ..< rings {
+                let a = UInt32(segment * rings + ring)
+                let b = UInt32(((segment + 1) % segments) * rings + ring)
+                let c = UInt32(((segment + 1) % segments) * rings + (ring + 1) % rings)
+                let d = UInt32(segment * rings + (ring + 1) % rings)
+                indices.append(contentsOf: [a, b, c, a, c, d])
+            }
+        }
+        return (positions, indices)
+    }
+    
+    func translation(_ offset: SIMD3<Float>) -> matrix_float4x4 {
+        var result = matrix_identity_float4x4
+        result.columns.3 = SIMD4<Float>(offset, 1)
+        return result
+    }
+    
+    // True if no part of the triangle can be seen from the camera
+    func isBackfacing(_ a: SIMD3<Float>, _ b: SIMD3<Float>, _ c: SIMD3<Float>, from camera: SIMD3<Float>) -> Bool {
+        return simd_dot(camera - a, simd_cross(b - a, c - a)) <= 1e-5
+    }
+    
+    func testLimitsAndOrder() {
+        let mesh = torus(segments: 64, rings: 32)
+        let meshlets = GLLMeshlets(positions: mesh.positions, indices: mesh.indices)
+        
+        XCTAssertEqual(meshlets.countOfTriangles, 4096)
+        var nextTriangle = 0
+        for meshlet in meshlets.meshlets {
+            XCTAssertGreaterThan(meshlet.triangleCount, 0)
+            XCTAssertLessThanOrEqual(meshlet.triangleCount, GLLMeshlets.maximumTriangles)
+            XCTAssertLessThanOrEqual(meshlet.vertexCount, GLLMeshlets.maximumVertices)
+            // One after the other
+            XCTAssertEqual(meshlet.triangleStart, nextTriangle)
+            nextTriangle += meshlet.triangleCount
+            
+            let vertices = Set(meshlets.indices[meshlet.elements])
+            XCTAssertEqual(vertices.count, meshlet.vertexCount)
+            for vertex in vertices {
+                XCTAssertLessThanOrEqual(simd_distance(mesh.positions[Int(vertex)], meshlet.center), meshlet.radius * 1.0001)
+            }
+            XCTAssertEqual(meshlet.rigidBone, 0)
+        }
+        XCTAssertEqual(nextTriangle, 4096)
+        
+        // The same triangles, with the same winding, just in a different order
+        func triangles(_ indices: [UInt32]) -> [SIMD3<UInt32>] {
+            return stride(from: 0, to: indices.count, by: 3).map { SIMD3<UInt32>(indices[$0], indices[$0 + 1], indices[$0 + 2]) }
+        }
+        XCTAssertEqual(Set(triangles(meshlets.indices)), Set(triangles(mesh.indices)))
+        XCTAssertEqual(meshlets.indices.count, mesh.indices.count)
+        
+        let statistics = meshlets.statistics
+        XCTAssertEqual(statistics.meshlets, meshlets.meshlets.count)
+        XCTAssertEqual(statistics.triangles, 4096)
+        XCTAssertEqual(statistics.rigid, statistics.meshlets)
+        // On a regular grid, a meshlet should get close to the limits
+        XCTAssertGreaterThan(statistics.averageTriangles, 48)
+        XCTAssertGreaterThan(statistics.withCone, statistics.meshlets / 2)
+    }
+    
+    func testConesAreConservative() {
+        let mesh = torus(segments: 64, rings: 32)
+        let meshlets = GLLMeshlets(positions: mesh.positions, indices: mesh.indices)
+        var generator = GLLCPUSkinnerTest.Generator(state: 44)
+        
+        var culled = 0
+        for _ in 0 ..< 20 {
+            let camera = simd_normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)) * 4
+            for meshlet in meshlets.meshlets {
+                guard let cone = meshlet.cone, cone.isBackfacing(from: camera) else {
+                    continue
+                }
+                culled += 1
+                for element in stride(from: meshlet.elements.lowerBound, to: meshlet.elements.upperBound, by: 3) {
+                    let corners = meshlets.indices[element ..< element + 3].map { mesh.positions[Int($0)] }
+                    XCTAssertTrue(isBackfacing(corners[0], corners[1], corners[2], from: camera))
+                }
+            }
+        }
+        XCTAssertGreaterThan(culled, 0)
+    }
+    
+    func testCameraPosition() {
+        let frustum = GLLFrustum(viewProjection: projection * translation(SIMD3<Float>(-1, -2, -5)))
+        XCTAssertNotNil(frustum.cameraPosition)
+        GLLCPUSkinnerTest.assertEqual(frustum.cameraPosition!, SIMD3<Float>(1, 2, 5))
+        
+        let orthographic = matrix_float4x4(diagonal: SIMD4<Float>(0.1, 0.1, -0.01, 1))
+        XCTAssertNil(GLLFrustum(viewProjection: orthographic).cameraPosition)
+    }
+    
+    func testCullRates() {
+        let mesh = torus(segments: 64, rings: 32)
+        let meshlets = GLLMeshlets(positions: mesh.positions, indices: mesh.indices)
+        let pose = [matrix_identity_float4x4].withUnsafeBufferPointer { meshlets.pose(boneTransforms: $0) }
+        
+        // Looking at the torus from above; the underside faces away
+        let above = GLLFrustum(viewProjection: projection * translation(SIMD3<Float>(0, 0, -5)))
+        let fromAbove = meshlets.cull(pose: pose, frustum: above, cullsBackFaces: true)
+        XCTAssertEqual(fromAbove.statistics.outsideFrustum, 0)
+        XCTAssertGreaterThan(fromAbove.statistics.backfacing, 0)
+        XCTAssertGreaterThan(fromAbove.statistics.cullRate, 0.05)
+        XCTAssertLessThanOrEqual(fromAbove.ranges.count, GLLMeshlets.maximumRanges)
+        
+        // Every visible meshlet gets drawn
+        fromAbove.visible.forEachMember { index in
+            let elements = meshlets.meshlets[index].elements
+            XCTAssertTrue(fromAbove.ranges.contains { $0.lowerBound <= elements.lowerBound && elements.upperBound <= $0.upperBound })
+        }
+        
+        // Without back face culling, everything in view stays
+        let twoSided = meshlets.cull(pose: pose, frustum: above, cullsBackFaces: false)
+        XCTAssertEqual(twoSided.statistics.culledMeshlets, 0)
+        XCTAssertEqual(twoSided.ranges, [0 ..< mesh.indices.count])
+        
+        // Close up to one side, so that a lot is out of view
+        let side = GLLFrustum(viewProjection: projection * translation(SIMD3<Float>(-1.2, 0, -1.2)))
+        let fromSide = meshlets.cull(pose: pose, frustum: side, cullsBackFaces: true)
+        XCTAssertGreaterThan(fromSide.statistics.outsideFrustum, 0)
+        XCTAssertGreaterThan(fromSide.statistics.cullRate, fromAbove.statistics.cullRate)
+        
+        // Completely behind the camera
+        let behind = GLLFrustum(viewProjection: projection * translation(SIMD3<Float>(0, 0, 5)))
+        let fromBehind = meshlets.cull(pose: pose, frustum: behind, cullsBackFaces: true)
+        XCTAssertTrue(fromBehind.visible.isEmpty)
+        XCTAssertTrue(fromBehind.ranges.isEmpty)
+        XCTAssertEqual(fromBehind.statistics.cullRate, 1)
+        
+        var total = GLLCullingResult.Statistics()
+        total.add(fromSide.statistics)
+        XCTAssertEqual(total.culledMeshlets, fromSide.statistics.culledMeshlets)
+        XCTAssertEqual(total.culledTriangles, fromSide.statistics.culledTriangles)
+    }
+    
+    func testMergeRanges() {
+        let ranges = [0 ..< 3, 6 ..< 9, 10 ..< 12, 20 ..< 30]
+        XCTAssertEqual(GLLMeshlets.merge(ranges: ranges, maximumCount: 4), ranges)
+        XCTAssertEqual(GLLMeshlets.merge(ranges: ranges, maximumCount: 3), [0 ..< 3, 6 ..< 12, 20 ..< 30])
+        XCTAssertEqual(GLLMeshlets.merge(ranges: ranges, maximumCount: 2), [0 ..< 12, 20 ..< 30])
+        XCTAssertEqual(GLLMeshlets.merge(ranges: ranges, maximumCount: 1), [0 ..< 30])
+        XCTAssertEqual(GLLMeshlets.merge(ranges: [], maximumCount: 1), [])
+    }
+    
+    func testSkinnedPoses() {
+        let mesh = torus(segments: 64, rings: 32)
+        // Half on bone 0, half on bone 1, with a few segments in between on both
+        var indices: [SIMD4<UInt16>] = []
+        var weights: [SIMD4<Float>] = []
+        for vertex in 0 ..< mesh.positions.count {
+            let segment = vertex / 32
+            if segment < 28 {
+                indices.append(SIMD4<UInt16>(0, 0, 0, 0))
+                weights.append(SIMD4<Float>(1, 0, 0, 0))
+            } else if segment < 36 {
+                indices.append(SIMD4<UInt16>(0, 1, 0, 0))
+                weights.append(SIMD4<Float>(0.5, 0.5, 0, 0))
+            } else {
+                indices.append(SIMD4<UInt16>(1, 0, 0, 0))
+                weights.append(SIMD4<Float>(1, 0, 0, 0))
+            }
+        }
+        let boneData = GLLCPUSkinner.BoneData.fixed(indices: indices, weights: weights)
+        let meshlets = GLLMeshlets(positions: mesh.positions, boneData: boneData, indices: mesh.indices)
+        let statistics = meshlets.statistics
+        XCTAssertGreaterThan(statistics.rigid, 0)
+        XCTAssertLessThan(statistics.rigid, statistics.meshlets)
+        for (meshlet, bounds) in zip(meshlets.meshlets, meshlets.bounds) {
+            XCTAssertEqual(meshlet.rigidBone == nil, bounds != nil)
+        }
+        
+        let skinner = GLLCPUSkinner(positions: mesh.positions, normals: mesh.positions, boneData: boneData)
+        var generator = GLLCPUSkinnerTest.Generator(state: 45)
+        for _ in 0 ..< 5 {
+            let transforms = GLLCPUSkinnerTest.randomTransforms(count: 2, generator: &generator)
+            let pose = transforms.withUnsafeBufferPointer { meshlets.pose(boneTransforms: $0) }
+            let skinned = skinner.skin(transforms: transforms).positions
+            let camera = simd_normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)) * 6
+            
+            for (index, meshlet) in meshlets.meshlets.enumerated() {
+                let corners = meshlets.indices[meshlet.elements].map { skinned[Int($0)] }
+                if let sphere = pose.spheres[index] {
+                    for corner in corners {
+                        XCTAssertLessThanOrEqual(simd_distance(corner, SIMD3<Float>(sphere.x, sphere.y, sphere.z)), sphere.w * 1.0001 + 1e-5)
+                    }
+                } else {
+                    let box = pose.boxes[index]!
+                    for corner in corners {
+                        XCTAssertTrue(all(corner .>= box.min - 1e-4) && all(corner .<= box.max + 1e-4))
+                    }
+                }
+                if let cone = pose.cones[index], cone.isBackfacing(from: camera) {
+                    for triangle in stride(from: 0, to: corners.count, by: 3) {
+                        XCTAssertTrue(isBackfacing(corners[triangle], corners[triangle + 1], corners[triangle + 2], from: camera))
+                    }
+                }
+            }
+        }
+    }
+    
+    func testPerformanceBuildMeshlets() {
+        let mesh = torus(segments: 256, rings: 128)
+        measure {
+            _ = GLLMeshlets(positions: mesh.positions, indices: mesh.indices)
+        }
+    }
+}
@@ -0,0 +1,293 @@
+//
+//  GLLMeshoptDecoderTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLMeshoptDecoderTest: XCTestCase {
+    
+    /**
+     * # Simple version of meshoptimizer's vertex encoder.
+     *
+     * Picks the cheapest bit count for every group, so all four kinds and the extra bytes show up, but doesn't try anything else.
+     */
+    static func encodeVertices(_ data: [UInt8], count: Int, size: Int) -> [UInt8] {
+        var result: [UInt8] = [0xA0]
+        var last = count > 0 ? Array(data.prefix(size)) : Array(repeating: 0, count: size)
+        let firstVertex = last
+        let blockSize = GLLMeshoptDecoder.vertexBlockSize(size: size)
+        for blockStart in stride(from: 0, to: count, by: blockSize) {
+            let blockCount = min(blockSize, count - blockStart)
+            let alignedCount = (blockCount + 15) & ~15
+            for byte in 0 ..< size {
+                var deltas = Array(repeating: UInt8(0), count: alignedCount)
+                var previous = last[byte]
+                for i in 0 ..< blockCount {
+                    let value = data[(blockStart + i) * size + byte]
+                    let delta = Int8(bitPattern: value &- previous)
+                    deltas[i] = UInt8(bitPattern: (delta << 1) ^ (delta >> 7))
+                    previous = value
+                }
+                
+                let groupCount = alignedCount / 16
+                var header = Array(repeating: UInt8(0), count: (groupCount + 3) / 4)
+                var groups: [UInt8] = []
+                for group in 0 ..< groupCount {
+                    let values = Array(deltas[group * 16 ..< group * 16 + 16])
+                    let costs = [
+                        values.allSatisfy { $0 == 0 } ? 0 : Int.max,
+                        4 + values.filter { $0 >= 3 }.count,
+                        8 + values.filter { $0 >= 15 }.count,
+                        16
+                    ]
+                    let bits = costs.firstIndex(of: costs.min()!)!
+                    header[group / 4] |= UInt8(bits) << ((group % 4) * 2)
+                    switch bits {
+                    case 0:
+                        break
+                    case 3:
+                        groups.append(contentsOf: values)
+                    default:
+                        let bitCount = bits * 2
+                        let sentinel = UInt8((1 << bitCount) - 1)
+                        var packed = Array(repeating: UInt8(0), count: bitCount * 2)
+                        for (i, value) in values.enumerated() {
+                            let shift = 8 - bitCount - (i * bitCount) % 8
+                            packed[i * bitCount / 8] |= min(value, sentinel) << shift
+                        }
+                        groups.append(contentsOf: packed)
+                        groups.append(contentsOf: values.filter { $0 >= sentinel })
+                    }
+                }
+                result.append(contentsOf: header)
+                result.append(contentsOf: groups)
+            }
+            for byte in 0 ..< size {
+                last[byte] = data[(blockStart + blockCount - 1) * size + byte]
+            }
+        }
+        
+        // Tail: padding, then what the first vertex is relative to
+        result.append(contentsOf: Array(repeating: 0, count: max(32 - size, 0)))
+        result.append(contentsOf: firstVertex)
+        return result
+    }
+    
+    func appendVByte(_ value: UInt32, to result: inout [UInt8]) {
+        var value = value
+        while value >= 128 {
+            result.append(UInt8(value & 127) | 128)
+            value >>= 7
+        }
+        result.append(UInt8(value))
+    }
+    
+    func zigzag(_ value: UInt32) -> UInt32 {
+        let signed = Int32(bitPattern: value)
+        return UInt32(bitPattern: (signed << 1) ^ (signed >> 31))
+    }
+    
+    // Each index relative to whichever of the last two is closer
+    func encodeIndexSequence(_ indices: [UInt32]) -> [UInt8] {
+        var result: [UInt8] = [0xD1]
+        var last: [UInt32] = [0, 0]
+        for index in indices {
+            let distances = last.map { zigzag(index &- $0) }
+            let baseline = distances[1] < distances[0] ? 1 : 0
+            appendVByte(distances[baseline] << 1 | UInt32(baseline), to: &result)
+            last[baseline] = index
+        }
+        result.append(contentsOf: [0, 0, 0, 0])
+        return result
+    }
+    
+    // Every triangle as three explicit indices. Valid, if not small.
+    func encodeTriangles(_ indices: [UInt32]) -> [UInt8] {
+        var codes: [UInt8] = []
+        var data: [UInt8] = []
+        var last: UInt32 = 0
+        for triangle in stride(from: 0, to: indices.count, by: 3) {
+            codes.append(0xFF)
+            data.append(0xFF)
+            for index in indices[triangle ..< triangle + 3] {
+                appendVByte(zigzag(index &- last), to: &data)
+                last = index
+            }
+        }
+        return [0xE1] + codes + data + Array(repeating: 0, count: 16)
+    }
+    
+    func decode(count: Int, size: Int, mode: GLLMeshoptDecoder.Mode, filter: GLLMeshoptDecoder.Filter = .none, _ encoded: [UInt8]) -> Data? {
+        return encoded.withUnsafeBytes { GLLMeshoptDecoder.decode(count: count, size: size, mode: mode, filter: filter, from: $0) }
+    }
+    
+    func testVertexRoundTrip() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 51)
+        for size in [4, 8, 12, 16, 64] {
+            for count in [0, 1, 15, 17, 300, 1000] {
+                // Half slowly changing values, half noise
+                var data: [UInt8] = []
+                var smooth = Array(repeating: UInt8(0), count: size)
+                for _ in 0 ..< count {
+                    for byte in 0 ..< size {
+                        if byte % 2 == 0 {
+                            smooth[byte] &+= UInt8.random(in: 0 ... 9, using: &generator)
+                            data.append(smooth[byte])
+                        } else {
+                            data.append(UInt8.random(in: 0 ... 255, using: &generator))
+                        }
+                    }
+                }
+                let encoded = GLLMeshoptDecoderTest.encodeVertices(data, count: count, size: size)
+                XCTAssertEqual(decode(count: count, size: size, mode: .attributes, encoded), Data(data), "\(count) vertices of \(size) bytes")
+            }
+        }
+    }
+    
+    func testVertexInvalid() {
+        let data = (0 ..< 64).map { UInt8($0 * 3 % 256) }
+        let encoded = GLLMeshoptDecoderTest.encodeVertices(data, count: 16, size: 4)
+        XCTAssertNotNil(decode(count: 16, size: 4, mode: .attributes, encoded))
+        // Wrong header, wrong size, missing or extra bytes
+        XCTAssertNil(decode(count: 16, size: 4, mode: .attributes, [0xA1] + encoded.dropFirst()))
+        XCTAssertNil(decode(count: 8, size: 6, mode: .attributes, encoded))
+        XCTAssertNil(decode(count: 16, size: 4, mode: .attributes, Array(encoded.dropLast(5))))
+        XCTAssertNil(decode(count: 16, size: 4, mode: .attributes, encoded + [0]))
+    }
+    
+    func testIndexBuffer() {
+        // From meshoptimizer's tests; uses the table, the FIFOs and a restart
+        let encoded: [UInt8] = [0xe0, 0xf0, 0x10, 0xfe, 0xff, 0xf0, 0x0c, 0xff, 0x02, 0x02, 0x02, 0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00]
+        let expected: [UInt32] = [0, 1, 2, 2, 1, 3, 4, 6, 5, 7, 8, 9]
+        let decoded = decode(count: 12, size: 4, mode: .triangles, encoded)
+        XCTAssertEqual(decoded.map { Array($0.withUnsafeBytes { $0.bindMemory(to: UInt32.self) }) }, expected)
+        
+        let short = decode(count: 12, size: 2, mode: .triangles, encoded)
+        XCTAssertEqual(short.map { Array($0.withUnsafeBytes { $0.bindMemory(to: UInt16.self) }) }, expected.map { UInt16($0) })
+        
+        // Too short, or not a multiple of three
+        XCTAssertNil(decode(count: 12, size: 4, mode: .triangles, Array(encoded.dropLast())))
+        XCTAssertNil(decode(count: 11, size: 4, mode: .triangles, encoded))
+    }
+    
+    func testIndexRoundTrip() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 52)
+        let indices = (0 ..< 3000).map { _ in UInt32.random(in: 0 ..< 70_000, using: &generator) }
+        let triangles = decode(count: indices.count, size: 4, mode: .triangles, encodeTriangles(indices))
+        XCTAssertEqual(triangles.map { Array($0.withUnsafeBytes { $0.bindMemory(to: UInt32.self) }) }, indices)
+        
+        let sequence = decode(count: indices.count, size: 4, mode: .indices, encodeIndexSequence(indices))
+        XCTAssertEqual(sequence.map { Array($0.withUnsafeBytes { $0.bindMemory(to: UInt32.self) }) }, indices)
+        
+        let shortIndices = indices.map { $0 % 65536 }
+        let shorts = decode(count: indices.count, size: 2, mode: .indices, encodeIndexSequence(shortIndices))
+        XCTAssertEqual(shorts.map { Array($0.withUnsafeBytes { $0.bindMemory(to: UInt16.self) }) }, shortIndices.map { UInt16($0) })
+    }
+    
+    func testOctahedralFilter() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 53)
+        let normals = (0 ..< 101).map { _ in simd_normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)) }
+        
+        for bits in [8, 16] {
+            let maximum = Float((1 << (bits - 1)) - 1)
+            var encoded: [Int16] = []
+            for normal in normals {
+                let projected = normal / (abs(normal.x) + abs(normal.y) + abs(normal.z))
+                let u = projected.z >= 0 ? projected.x : (1 - abs(projected.y)) * (projected.x >= 0 ? 1 : -1)
+                let v = projected.z >= 0 ? projected.y : (1 - abs(projected.x)) * (projected.y >= 0 ? 1 : -1)
+                encoded.append(contentsOf: [Int16((u * maximum).rounded()), Int16((v * maximum).rounded()), Int16(maximum), 7])
+            }
+            let bytes = bits == 8 ? encoded.map { UInt8(bitPattern: Int8($0)) } : encoded.withUnsafeBytes { Array($0) }
+            let decoded = bytes.withUnsafeBytes { buffer -> [Int16] in
+                var data = Data(buffer)
+                XCTAssertTrue(data.withUnsafeMutableBytes { GLLMeshoptDecoder.applyFilter(.octahedral, to: $0, count: normals.count, size: bits / 2) })
+                return bits == 8 ? data.map { Int16(Int8(bitPattern: $0)) } : data.withUnsafeBytes { Array($0.bindMemory(to: Int16.self)) }
+            }
+            for (i, normal) in normals.enumerated() {
+                let result = SIMD3<Float>(Float(decoded[i * 4]), Float(decoded[i * 4 + 1]), Float(decoded[i * 4 + 2])) / maximum
+                GLLCPUSkinnerTest.assertEqual(result, normal, accuracy: bits == 8 ? 0.03 : 0.001)
+                XCTAssertEqual(decoded[i * 4 + 3], 7)
+            }
+        }
+    }
+    
+    func testQuaternionFilter() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 54)
+        var quaternions: [SIMD4<Float>] = []
+        var encoded: [Int16] = []
+        for _ in 0 ..< 100 {
+            var quaternion = simd_normalize(SIMD4<Float>(GLLCPUSkinnerTest.randomVector(generator: &generator), Float.random(in: -1 ... 1, using: &generator)))
+            let largest = (0 ..< 4).max { abs(quaternion[$0]) < abs(quaternion[$1]) }!
+            if quaternion[largest] < 0 {
+                quaternion = -quaternion
+            }
+            quaternions.append(quaternion)
+            let scale = Float(2).squareRoot() * 8191
+            for component in 1 ... 3 {
+                encoded.append(Int16((quaternion[(largest + component) & 3] * scale).rounded()))
+            }
+            encoded.append(Int16((2047 << 2) | largest))
+        }
+        let data = decode(count: quaternions.count, size: 8, mode: .attributes, filter: .quaternion, GLLMeshoptDecoderTest.encodeVertices(encoded.withUnsafeBytes { Array($0) }, count: quaternions.count, size: 8))
+        XCTAssertNotNil(data)
+        let decoded = data.map { Array($0.withUnsafeBytes { $0.bindMemory(to: SIMD4<Int16>.self) }) } ?? []
+        for (quaternion, result) in zip(quaternions, decoded) {
+            let difference = SIMD4<Float>(result) / 32767 - quaternion
+            XCTAssertLessThan(simd_length(difference), 0.001)
+        }
+    }
+    
+    func testExponentialFilter() {
+        let values: [(mantissa: Int32, exponent: Int32, result: Float)] = [(3, 0, 3), (-5, -2, -1.25), (1 << 20, -20, 1), (7, 4, 112), (0, 10, 0), (-(1 << 23), -23, -1)]
+        var data = Data(values.map { ($0.exponent << 24) | ($0.mantissa & 0xFFFFFF) }.withUnsafeBytes { Array($0) })
+        XCTAssertTrue(data.withUnsafeMutableBytes { GLLMeshoptDecoder.applyFilter(.exponential, to: $0, count: values.count, size: 4) })
+        XCTAssertEqual(data.withUnsafeBytes { Array($0.bindMemory(to: Float.self)) }, values.map { $0.result })
+        
+        // Filters only fit some sizes
+        XCTAssertFalse(data.withUnsafeMutableBytes { GLLMeshoptDecoder.applyFilter(.quaternion, to: $0, count: 3, size: 4) })
+    }
+    
+    /**
+     * A million vertices with positions, normals and tex coords as gltfpack would quantize them, 16 bytes each
+     */
+    func testPerformanceVertices() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 55)
+        let count = 1_000_000
+        var data: [UInt8] = []
+        data.reserveCapacity(count * 16)
+        var smooth = Array(repeating: UInt8(0), count: 16)
+        for _ in 0 ..< count {
+            for byte in 0 ..< 16 {
+                smooth[byte] &+= UInt8.random(in: 0 ... (byte % 2 == 0 ? 3 : 40), using: &generator)
+                data.append(smooth[byte])
+            }
+        }
+        let encoded = GLLMeshoptDecoderTest.encodeVertices(data, count: count, size: 16)
+        measure {
+            XCTAssertEqual(decode(count: count, size: 16, mode: .attributes, encoded)?.count, data.count)
+        }
+    }
+    
+    func testPerformanceIndices() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 56)
+        let indices = (0 ..< 3_000_000).map { i in UInt32(i / 6) + UInt32.random(in: 0 ..< 8, using: &generator) }
+        let encoded = encodeIndexSequence(indices)
+        measure {
+            XCTAssertEqual(decode(count: indices.count, size: 4, mode: .indices, encoded)?.count, indices.count * 4)
+        }
+    }
+    
+    func testPerformanceOctahedralFilter() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 57)
+        let count = 1_000_000
+        let original = Data((0 ..< count * 8).map { _ in UInt8.random(in: 0 ... 255, using: &generator) })
+        measure {
+            var data = original
+            XCTAssertTrue(data.withUnsafeMutableBytes { GLLMeshoptDecoder.applyFilter(.octahedral, to: $0, count: count, size: 8) })
+        }
+    }
+}
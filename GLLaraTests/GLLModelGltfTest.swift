@@ -0,0 +1,173 @@
+//
+//  GLLModelGltfTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+import Metal
+@testable import GLLara
+
+class GLLModelGltfTest: XCTestCase {
+    
+    /**
+     * # A glTF file built in memory.
+     *
+     * All data goes into buffer 0, the binary chunk of a GLB file. Compressed views name buffer 1 as their fallback, which has no data, as meshoptimizer's gltfpack writes them.
+     */
+    struct Fixture {
+        var binary = Data()
+        var bufferViews: [[String: Any]] = []
+        var accessors: [[String: Any]] = []
+        
+        static func bytes<T>(_ values: [T]) -> [UInt8] {
+            return values.withUnsafeBytes { Array($0) }
+        }
+        
+        // Returns the offset in the binary data. Everything starts at four bytes.
+        private mutating func append(_ bytes: [UInt8]) -> Int {
+            let offset = binary.count
+            binary.append(contentsOf: bytes)
+            binary.append(contentsOf: Array(repeating: UInt8(0), count: (4 - binary.count % 4) % 4))
+            return offset
+        }
+        
+        mutating func addView(_ bytes: [UInt8], byteStride: Int? = nil) -> Int {
+            var view: [String: Any] = ["buffer": 0, "byteOffset": append(bytes), "byteLength": bytes.count]
+            view["byteStride"] = byteStride
+            bufferViews.append(view)
+            return bufferViews.count - 1
+        }
+        
+        mutating func addCompressedView(_ bytes: [UInt8], count: Int, byteStride: Int) -> Int {
+            let encoded = GLLMeshoptDecoderTest.encodeVertices(bytes, count: count, size: byteStride)
+            let compression: [String: Any] = ["buffer": 0, "byteOffset": append(encoded), "byteLength": encoded.count, "byteStride": byteStride, "count": count, "mode": "ATTRIBUTES"]
+            bufferViews.append(["buffer": 1, "byteLength": bytes.count, "byteStride": byteStride, "extensions": ["EXT_meshopt_compression": compression]])
+            return bufferViews.count - 1
+        }
+        
+        mutating func addAccessor(view: Int?, componentType: GLLAccessorDecoder.ComponentType, normalized: Bool = false, count: Int, type: String, sparse: [String: Any]? = nil) -> Int {
+            var accessor: [String: Any] = ["componentType": componentType.rawValue, "normalized": normalized, "count": count, "type": type]
+            accessor["bufferView"] = view
+            accessor["sparse"] = sparse
+            accessors.append(accessor)
+            return accessors.count - 1
+        }
+        
+        func model(meshes: [[String: Any]]) throws -> GLLModelGltf {
+            let document: [String: Any] = [
+                "asset": ["version": "2.0"],
+                "extensionsUsed": ["EXT_meshopt_compression", "KHR_mesh_quantization"],
+                "buffers": [["byteLength": binary.count], ["byteLength": 0]],
+                "bufferViews": bufferViews,
+                "accessors": accessors,
+                "meshes": meshes
+            ]
+            let jsonData = try JSONSerialization.data(withJSONObject: document)
+            return try GLLModelGltf(jsonData: jsonData, baseUrl: FileManager.default.temporaryDirectory, binaryData: binary)
+        }
+    }
+    
+    static let quadPositions: [Float] = [0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0]
+    static let quadIndices: [UInt16] = [0, 1, 2, 0, 2, 3]
+    
+    override func tearDownWithError() throws {
+        UserDefaults.standard.removeObject(forKey: GLLPrefQuantizeVertices)
+    }
+    
+    func testQuantizedMeshoptAttributes() throws {
+        UserDefaults.standard.set(true, forKey: GLLPrefQuantizeVertices)
+        
+        // Normals as bytes, padded to four, and texture coordinates as unsigned shorts
+        let normals: [Int8] = [0, 0, 127, 0, 127, 0, 0, 0, 0, -127, 0, 0, 73, 73, 73, 0]
+        let texCoords: [UInt16] = [0, 0, 65535, 0, 65535, 65535, 0, 32768]
+        
+        var fixture = Fixture()
+        let positions = fixture.addAccessor(view: fixture.addView(Fixture.bytes(GLLModelGltfTest.quadPositions)), componentType: .float, count: 4, type: "VEC3")
+        let indices = fixture.addAccessor(view: fixture.addView(Fixture.bytes(GLLModelGltfTest.quadIndices)), componentType: .unsignedShort, count: 6, type: "SCALAR")
+        let normalAccessor = fixture.addAccessor(view: fixture.addCompressedView(Fixture.bytes(normals), count: 4, byteStride: 4), componentType: .byte, normalized: true, count: 4, type: "VEC3")
+        let texCoordAccessor = fixture.addAccessor(view: fixture.addCompressedView(Fixture.bytes(texCoords), count: 4, byteStride: 4), componentType: .unsignedShort, normalized: true, count: 4, type: "VEC2")
+        let model = try fixture.model(meshes: [["primitives": [["attributes": ["POSITION": positions, "NORMAL": normalAccessor, "TEXCOORD_0": texCoordAccessor], "indices": indices]]]])
+        
+        let mesh = try XCTUnwrap(model.meshes.first)
+        let accessors = try XCTUnwrap(mesh.vertexDataAccessors)
+        let loadedNormals = try XCTUnwrap(accessors.accessor(semantic: .normal))
+        let loadedTexCoords = try XCTUnwrap(accessors.accessor(semantic: .texCoord0))
+        XCTAssertEqual(loadedNormals.attribute.format, .char3Normalized)
+        XCTAssertEqual(loadedNormals.stride, 4)
+        XCTAssertEqual(loadedTexCoords.attribute.format, .ushort2Normalized)
+        
+        let expectedNormals = (0 ..< 4).map { SIMD3<Float>(Float(normals[$0 * 4]), Float(normals[$0 * 4 + 1]), Float(normals[$0 * 4 + 2])) / 127 }
+        let expectedTexCoords = (0 ..< 4).map { SIMD2<Float>(Float(texCoords[$0 * 2]), Float(texCoords[$0 * 2 + 1])) / 65535 }
+        let dequantizedNormals = loadedNormals.simdArray(count: 4, type: SIMD3<Float>.self)
+        let dequantizedTexCoords = loadedTexCoords.simdArray(count: 4, type: SIMD2<Float>.self)
+        for i in 0 ..< 4 {
+            XCTAssertLessThan(simd_distance(dequantizedNormals[i], expectedNormals[i]), 1e-5)
+            XCTAssertLessThan(simd_distance(dequantizedTexCoords[i], expectedTexCoords[i]), 1e-5)
+        }
+        
+        // Quantizing turns the normals into the octahedral encoding the shader expects, instead of passing them through. The texture coordinates stay as they are.
+        let vertexFormat = try XCTUnwrap(mesh.vertexFormat)
+        XCTAssertTrue(vertexFormat.isQuantized)
+        let vertexArray = GLLVertexArray(format: vertexFormat)
+        let packedNormals = try XCTUnwrap(vertexArray.optimizedFormat.accessor(semantic: .normal))
+        let packedTexCoords = try XCTUnwrap(vertexArray.optimizedFormat.accessor(semantic: .texCoord0))
+        XCTAssertEqual(packedNormals.attribute.format, .short2Normalized)
+        XCTAssertEqual(packedTexCoords.attribute.format, .ushort2Normalized)
+        
+        try XCTSkipIf(MTLCreateSystemDefaultDevice() == nil, "Needs a Metal device")
+        let reservation = vertexArray.reserve(vertexCount: mesh.countOfVertices, elements: mesh.elementData, bytesPerElement: mesh.elementSize)
+        vertexArray.add(vertices: mesh.drawingVertexDataAccessors, count: mesh.countOfVertices, elements: mesh.elementData, bytesPerElement: mesh.elementSize, quantization: mesh.quantization, at: reservation)
+        vertexArray.upload()
+        let contents = UnsafeRawPointer(try XCTUnwrap(vertexArray.vertexBuffer).contents())
+        for i in 0 ..< 4 {
+            let normal = contents.loadUnaligned(fromByteOffset: packedNormals.offset(element: i), as: SIMD2<Int16>.self)
+            XCTAssertGreaterThan(simd_dot(GLLVertexQuantization.decodeOctahedral(normal), simd_normalize(expectedNormals[i])), 0.9999)
+            
+            let texCoord = contents.loadUnaligned(fromByteOffset: packedTexCoords.offset(element: i), as: SIMD2<UInt16>.self)
+            XCTAssertEqual(texCoord, SIMD2<UInt16>(texCoords[i * 2], texCoords[i * 2 + 1]))
+        }
+    }
+    
+    func testMorphTargets() throws {
+        var fixture = Fixture()
+        let positions = fixture.addAccessor(view: fixture.addView(Fixture.bytes(GLLModelGltfTest.quadPositions)), componentType: .float, count: 4, type: "VEC3")
+        let indices = fixture.addAccessor(view: fixture.addView(Fixture.bytes(GLLModelGltfTest.quadIndices)), componentType: .unsignedShort, count: 6, type: "SCALAR")
+        let normals = fixture.addAccessor(view: fixture.addView(Fixture.bytes(Array(repeating: [Float(0), 0, 1], count: 4).flatMap { $0 })), componentType: .float, count: 4, type: "VEC3")
+        
+        // A dense target that moves every vertex up
+        let raise = fixture.addAccessor(view: fixture.addView(Fixture.bytes(Array(repeating: [Float(0), 0, 0.5], count: 4).flatMap { $0 })), componentType: .float, count: 4, type: "VEC3")
+        // And a sparse one that only moves the third vertex and its normal; it has no buffer view, so everything else is zero
+        let sparseIndices = fixture.addView(Fixture.bytes([UInt16(2)]))
+        let sparse: [String: Any] = ["count": 1, "indices": ["bufferView": sparseIndices, "componentType": GLLAccessorDecoder.ComponentType.unsignedShort.rawValue], "values": ["bufferView": fixture.addView(Fixture.bytes([Float(1), 0, 0]))]]
+        let sparseNormals: [String: Any] = ["count": 1, "indices": ["bufferView": sparseIndices, "componentType": GLLAccessorDecoder.ComponentType.unsignedShort.rawValue], "values": ["bufferView": fixture.addView(Fixture.bytes([Float(0), 0.5, 0]))]]
+        let stretch = fixture.addAccessor(view: nil, componentType: .float, count: 4, type: "VEC3", sparse: sparse)
+        let stretchNormals = fixture.addAccessor(view: nil, componentType: .float, count: 4, type: "VEC3", sparse: sparseNormals)
+        
+        // Only the first target has a default weight
+        let primitive: [String: Any] = ["attributes": ["POSITION": positions, "NORMAL": normals], "indices": indices, "targets": [["POSITION": raise], ["POSITION": stretch, "NORMAL": stretchNormals]]]
+        let model = try fixture.model(meshes: [["primitives": [primitive], "weights": [0.25], "extras": ["targetNames": ["raise", "stretch"]]]])
+        
+        let mesh = try XCTUnwrap(model.meshes.first)
+        let morphTargets = try XCTUnwrap(mesh.morphTargets)
+        XCTAssertEqual(morphTargets.targets.map { $0.name }, ["raise", "stretch"])
+        XCTAssertEqual(mesh.morphWeights, [0.25, 0])
+        XCTAssertEqual(morphTargets.targets[0].count, 4)
+        XCTAssertTrue(morphTargets.targets[0].normalOffsets.isEmpty)
+        XCTAssertEqual(morphTargets.targets[1].indices, [2])
+        XCTAssertEqual(morphTargets.targets[1].normalOffsets.count, 1)
+        
+        let deltas = try XCTUnwrap(mesh.morphDeltas(weights: [1, 0.5]))
+        XCTAssertLessThan(simd_distance(deltas.positions[0], SIMD3<Float>(0, 0, 0.5)), 1e-4)
+        XCTAssertLessThan(simd_distance(deltas.positions[2], SIMD3<Float>(0.5, 0, 0.5)), 1e-4)
+        XCTAssertLessThan(simd_distance(deltas.normals[2], SIMD3<Float>(0, 0.25, 0)), 1e-4)
+        XCTAssertEqual(deltas.normals[0], SIMD3<Float>())
+        
+        // Nothing to add without weights, or with weights for a different number of targets
+        XCTAssertNil(mesh.morphDeltas(weights: [0, 0]))
+        XCTAssertNil(mesh.morphDeltas(weights: [1]))
+    }
+    
+}
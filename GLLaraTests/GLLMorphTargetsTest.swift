@@ -0,0 +1,173 @@
+//
+//  GLLMorphTargetsTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLMorphTargetsTest: XCTestCase {
+    
+    typealias Generator = GLLCPUSkinnerTest.Generator
+    
+    // Offsets for a random part of the vertices, zero for the rest
+    static func randomOffsets(vertexCount: Int, movedFraction: Float, generator: inout Generator) -> [SIMD3<Float>] {
+        return (0 ..< vertexCount).map { _ in
+            Float.random(in: 0 ..< 1, using: &generator) < movedFraction ? GLLCPUSkinnerTest.randomVector(generator: &generator) * 0.1 : SIMD3<Float>()
+        }
+    }
+    
+    // Plain sum of the offsets that were put in, without any quantization
+    static func referenceDeltas(offsets: [[SIMD3<Float>]], weights: [Float], vertexCount: Int) -> [SIMD3<Float>] {
+        var result = Array(repeating: SIMD3<Float>(), count: vertexCount)
+        for (target, weight) in zip(offsets, weights) {
+            for vertex in 0 ..< vertexCount {
+                result[vertex] += target[vertex] * weight
+            }
+        }
+        return result
+    }
+    
+    func testOnlyMovedVerticesAreStored() throws {
+        let offsets: [SIMD3<Float>] = [SIMD3<Float>(), SIMD3<Float>(1, 0, 0), SIMD3<Float>(), SIMD3<Float>(0, -0.5, 0.25), SIMD3<Float>()]
+        let target = GLLMorphTargetSet.Target(name: "smile", positionOffsets: offsets)
+        
+        XCTAssertEqual(target.count, 2)
+        XCTAssertEqual(target.indices, [1, 3])
+        XCTAssertTrue(target.normalOffsets.isEmpty)
+        XCTAssertEqual(target.positionOffsets[0], SIMD3<Int16>(Int16.max, 0, 0))
+        
+        // A vertex that only changes its normal still counts
+        let normals: [SIMD3<Float>] = [SIMD3<Float>(), SIMD3<Float>(), SIMD3<Float>(0, 0, 1), SIMD3<Float>(), SIMD3<Float>()]
+        let withNormals = GLLMorphTargetSet.Target(name: "frown", positionOffsets: offsets, normalOffsets: normals)
+        XCTAssertEqual(withNormals.indices, [1, 2, 3])
+        XCTAssertEqual(withNormals.normalOffsets.count, 3)
+    }
+    
+    func testEmptyTarget() throws {
+        let target = GLLMorphTargetSet.Target(name: "nothing", positionOffsets: Array(repeating: SIMD3<Float>(), count: 10))
+        XCTAssertEqual(target.count, 0)
+        
+        let set = GLLMorphTargetSet(countOfVertices: 10, targets: [target])
+        let deltas = set.evaluate(weights: [1])
+        XCTAssertTrue(deltas.positions.allSatisfy { $0 == SIMD3<Float>() })
+    }
+    
+    func testEvaluateMatchesReference() throws {
+        var generator = Generator(state: 48)
+        
+        // More than one chunk, and not a multiple of the chunk size
+        let vertexCount = GLLMorphTargetSet.verticesPerChunk * 2 + 17
+        let positionOffsets = (0 ..< 8).map { _ in GLLMorphTargetsTest.randomOffsets(vertexCount: vertexCount, movedFraction: 0.3, generator: &generator) }
+        let normalOffsets = (0 ..< 8).map { _ in GLLMorphTargetsTest.randomOffsets(vertexCount: vertexCount, movedFraction: 0.3, generator: &generator) }
+        // Some targets without normals
+        let targets = (0 ..< 8).map { GLLMorphTargetSet.Target(name: "target \($0)", positionOffsets: positionOffsets[$0], normalOffsets: $0 % 2 == 0 ? normalOffsets[$0] : []) }
+        let set = GLLMorphTargetSet(countOfVertices: vertexCount, targets: targets)
+        
+        // Including zero and negative weights
+        let weights: [Float] = [1, 0, 0.5, -0.25, 0, 0.75, 1, 0.1]
+        let deltas = set.evaluate(weights: weights)
+        let expectedPositions = GLLMorphTargetsTest.referenceDeltas(offsets: positionOffsets, weights: weights, vertexCount: vertexCount)
+        let expectedNormals = GLLMorphTargetsTest.referenceDeltas(offsets: (0 ..< 8).map { $0 % 2 == 0 ? normalOffsets[$0] : Array(repeating: SIMD3<Float>(), count: vertexCount) }, weights: weights, vertexCount: vertexCount)
+        
+        for vertex in 0 ..< vertexCount {
+            GLLCPUSkinnerTest.assertEqual(deltas.positions[vertex], expectedPositions[vertex], accuracy: 1e-4)
+            GLLCPUSkinnerTest.assertEqual(deltas.normals[vertex], expectedNormals[vertex], accuracy: 1e-4)
+        }
+    }
+    
+    func testReusedDeltasGetOverwritten() throws {
+        var generator = Generator(state: 7)
+        let vertexCount = 1000
+        let offsets = GLLMorphTargetsTest.randomOffsets(vertexCount: vertexCount, movedFraction: 0.5, generator: &generator)
+        let set = GLLMorphTargetSet(countOfVertices: vertexCount, targets: [GLLMorphTargetSet.Target(name: "blink", positionOffsets: offsets)])
+        
+        var deltas = GLLMorphTargetSet.Deltas(countOfVertices: vertexCount)
+        set.evaluate(weights: [1], into: &deltas)
+        XCTAssertTrue(deltas.positions.contains { $0 != SIMD3<Float>() })
+        
+        set.evaluate(weights: [0], into: &deltas)
+        XCTAssertTrue(deltas.positions.allSatisfy { $0 == SIMD3<Float>() })
+        
+        // Wrong size gets replaced
+        var wrongSize = GLLMorphTargetSet.Deltas(countOfVertices: 3)
+        set.evaluate(weights: [0.5], into: &wrongSize)
+        XCTAssertEqual(wrongSize.positions.count, vertexCount)
+        XCTAssertEqual(wrongSize.normals.count, vertexCount)
+    }
+    
+    func testSkinningAddsDeltas() throws {
+        var generator = Generator(state: 12)
+        let transforms = GLLCPUSkinnerTest.randomTransforms(count: 4, generator: &generator)
+        
+        let vertexCount = 5000
+        let positions = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) }
+        let normals = (0 ..< vertexCount).map { _ in normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)) }
+        let indices = (0 ..< vertexCount).map { _ in SIMD4<UInt16>((0 ..< 4).map { _ in UInt16.random(in: 0 ..< 4, using: &generator) }) }
+        let weights = (0 ..< vertexCount).map { _ in SIMD4<Float>(GLLCPUSkinnerTest.randomWeights(count: 4, generator: &generator)) }
+        let boneData = GLLCPUSkinner.BoneData.fixed(indices: indices, weights: weights)
+        
+        let target = GLLMorphTargetSet.Target(name: "jaw", positionOffsets: GLLMorphTargetsTest.randomOffsets(vertexCount: vertexCount, movedFraction: 0.4, generator: &generator), normalOffsets: GLLMorphTargetsTest.randomOffsets(vertexCount: vertexCount, movedFraction: 0.4, generator: &generator))
+        let deltas = GLLMorphTargetSet(countOfVertices: vertexCount, targets: [target]).evaluate(weights: [0.6])
+        
+        let morphed = GLLCPUSkinner(positions: positions, normals: normals, boneData: boneData).skin(transforms: transforms, morphDeltas: deltas)
+        let expected = GLLCPUSkinner(positions: zip(positions, deltas.positions).map { $0 + $1 }, normals: zip(normals, deltas.normals).map { $0 + $1 }, boneData: boneData).skin(transforms: transforms)
+        
+        for vertex in 0 ..< vertexCount {
+            GLLCPUSkinnerTest.assertEqual(morphed.positions[vertex], expected.positions[vertex])
+            GLLCPUSkinnerTest.assertEqual(morphed.normals[vertex], expected.normals[vertex])
+        }
+    }
+    
+    func testMorphedBoundsContainMorphedVertices() throws {
+        var generator = Generator(state: 19)
+        let vertexCount = 2000
+        let boneCount = 10
+        
+        let positions = (0 ..< vertexCount).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) * 5 }
+        let indices = (0 ..< vertexCount).map { _ in SIMD4<UInt16>((0 ..< 4).map { _ in UInt16.random(in: 0 ..< UInt16(boneCount), using: &generator) }) }
+        let weights = (0 ..< vertexCount).map { _ in SIMD4<Float>(GLLCPUSkinnerTest.randomWeights(count: 4, generator: &generator)) }
+        let boneData = GLLCPUSkinner.BoneData.fixed(indices: indices, weights: weights)
+        let bounds = GLLMeshBounds(positions: positions, boneData: boneData)
+        
+        let targets = (0 ..< 3).map { GLLMorphTargetSet.Target(name: "target \($0)", positionOffsets: GLLMorphTargetsTest.randomOffsets(vertexCount: vertexCount, movedFraction: 0.3, generator: &generator)) }
+        let set = GLLMorphTargetSet(countOfVertices: vertexCount, targets: targets)
+        XCTAssertEqual(set.maximumPositionDelta(weights: [0, 0, 0]), 0)
+        
+        let morphWeights: [Float] = [1, -0.5, 0.75]
+        let deltas = set.evaluate(weights: morphWeights)
+        let distance = set.maximumPositionDelta(weights: morphWeights)
+        XCTAssertGreaterThan(distance, 0)
+        XCTAssertTrue(deltas.positions.allSatisfy { simd_length($0) <= distance + 1e-4 })
+        
+        let skinner = GLLCPUSkinner(positions: positions, normals: positions, boneData: boneData)
+        for _ in 0 ..< 5 {
+            let transforms = GLLCPUSkinnerTest.randomTransforms(count: boneCount, generator: &generator)
+            let box = try XCTUnwrap(transforms.withUnsafeBufferPointer { bounds.skinned(boneTransforms: $0, morphDistance: distance) })
+            for position in skinner.skin(transforms: transforms, morphDeltas: deltas).positions {
+                XCTAssertTrue(all(position .>= box.min - 1e-4) && all(position .<= box.max + 1e-4))
+            }
+        }
+    }
+    
+    func testPerformanceFiftyActiveTargets() throws {
+        var generator = Generator(state: 2026)
+        
+        // A detailed head with a full set of facial expressions, each moving about a fifth of it
+        let vertexCount = 40_000
+        let targetCount = 50
+        let targets = (0 ..< targetCount).map { index in
+            GLLMorphTargetSet.Target(name: "expression \(index)", positionOffsets: GLLMorphTargetsTest.randomOffsets(vertexCount: vertexCount, movedFraction: 0.2, generator: &generator), normalOffsets: GLLMorphTargetsTest.randomOffsets(vertexCount: vertexCount, movedFraction: 0.2, generator: &generator))
+        }
+        let set = GLLMorphTargetSet(countOfVertices: vertexCount, targets: targets)
+        let weights = (0 ..< targetCount).map { _ in Float.random(in: 0.1 ... 1, using: &generator) }
+        var deltas = GLLMorphTargetSet.Deltas(countOfVertices: vertexCount)
+        
+        measure {
+            set.evaluate(weights: weights, into: &deltas)
+        }
+    }
+    
+}
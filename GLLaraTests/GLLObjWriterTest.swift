@@ -0,0 +1,77 @@
+//
+//  GLLObjWriterTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLObjWriterTest: XCTestCase {
+    
+    func testTriangle() throws {
+        var chunk = GLLExportSink.Chunk()
+        GLLObjWriter.appendVertices(positions: [SIMD3<Float>(0, 0, 0), SIMD3<Float>(1, 0, 0), SIMD3<Float>(0, 1.5, 0)], normals: Array(repeating: SIMD3<Float>(0, 0, 1), count: 3), texCoords: [SIMD2<Float>(0, 0), SIMD2<Float>(1, 0.25), SIMD2<Float>(0, 1)], to: &chunk)
+        GLLObjWriter.appendFaces(elements: [0, 1, 2], baseIndex: 10, includeColors: false, to: &chunk)
+        
+        let expected = """
+        v 0.0 0.0 0.0
+        vn 0.0 0.0 1.0
+        vt 0.0 1.0
+        v 1.0 0.0 0.0
+        vn 0.0 0.0 1.0
+        vt 1.0 0.75
+        v 0.0 1.5 0.0
+        vn 0.0 0.0 1.0
+        vt 0.0 0.0
+        f 11/11/11 13/13/13 12/12/12
+        
+        """
+        XCTAssertEqual(String(decoding: chunk.bytes, as: UTF8.self), expected)
+    }
+    
+    func testColors() throws {
+        var chunk = GLLExportSink.Chunk()
+        GLLObjWriter.appendVertices(positions: [SIMD3<Float>()], normals: [SIMD3<Float>()], texCoords: [SIMD2<Float>()], colors: [SIMD4<UInt8>(255, 0, 51, 255)], to: &chunk)
+        GLLObjWriter.appendFaces(elements: [0, 0, 0, 0, 0], baseIndex: 0, includeColors: true, to: &chunk)
+        
+        let lines = String(decoding: chunk.bytes, as: UTF8.self).split(separator: "\n")
+        XCTAssertEqual(lines[3], "vc 1.0 0.0 0.2 1.0")
+        // The incomplete triangle at the end gets left out
+        XCTAssertEqual(lines.count, 5)
+        XCTAssertEqual(lines[4], "f 1/1/1/1 1/1/1/1 1/1/1/1")
+    }
+    
+    func testPerformanceParallelMeshes() throws {
+        var generator = GLLCPUSkinnerTest.Generator(state: 2026)
+        
+        // A scene of many meshes of different sizes, about a million vertices in total
+        let meshes = (0 ..< 64).map { _ -> (positions: [SIMD3<Float>], normals: [SIMD3<Float>], texCoords: [SIMD2<Float>], elements: [UInt32]) in
+            let count = Int.random(in: 2000 ..< 30000, using: &generator)
+            let positions = (0 ..< count).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) * 10 }
+            let normals = (0 ..< count).map { _ in normalize(GLLCPUSkinnerTest.randomVector(generator: &generator)) }
+            let texCoords = (0 ..< count).map { _ in SIMD2<Float>(Float.random(in: 0 ... 1, using: &generator), Float.random(in: 0 ... 1, using: &generator)) }
+            let elements = (0 ..< count * 2 * 3).map { _ in UInt32.random(in: 0 ..< UInt32(count), using: &generator) }
+            return (positions, normals, texCoords, elements)
+        }
+        var baseIndices: [Int] = []
+        var indexOffset = 0
+        for mesh in meshes {
+            baseIndices.append(indexOffset)
+            indexOffset += mesh.positions.count
+        }
+        
+        measure {
+            // Thrown away, like writing to a file but without the disk
+            let sink = GLLExportSink { _ in }
+            try! sink.writeChunks(count: meshes.count) { index, chunk in
+                let mesh = meshes[index]
+                GLLObjWriter.appendVertices(positions: mesh.positions, normals: mesh.normals, texCoords: mesh.texCoords, to: &chunk)
+                GLLObjWriter.appendFaces(elements: mesh.elements[...], baseIndex: baseIndices[index], includeColors: false, to: &chunk)
+            }
+            try! sink.flush()
+        }
+    }
+    
+}
@@ -0,0 +1,113 @@
+//
+//  GLLRenderGraphTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLRenderGraphTest: XCTestCase {
+    
+    // Resources that are alive at the same time must not share any bytes
+    func assertValid(_ plan: GLLRenderGraph.Plan, for graph: GLLRenderGraph, file: StaticString = #filePath, line: UInt = #line) {
+        let lifetimes = graph.lifetimes
+        for a in graph.resources.indices {
+            XCTAssertEqual(plan.allocations[a] == nil, lifetimes[a] == nil, file: file, line: line)
+            guard let allocationA = plan.allocations[a] else {
+                continue
+            }
+            XCTAssertLessThanOrEqual(allocationA.offset + allocationA.size, plan.peakBytes, file: file, line: line)
+            for b in graph.resources.indices where b > a {
+                guard let allocationB = plan.allocations[b], lifetimes[a]!.overlaps(lifetimes[b]!) else {
+                    continue
+                }
+                let disjoint = allocationA.offset + allocationA.size <= allocationB.offset || allocationB.offset + allocationB.size <= allocationA.offset
+                XCTAssertTrue(disjoint, "\(graph.resources[a].name) and \(graph.resources[b].name) overlap", file: file, line: line)
+            }
+        }
+    }
+    
+    func testDepthPeelingLifetimes() {
+        let (graph, resources) = GLLRenderGraph.depthPeeling(layers: 2, offscreenOutput: true)
+        let lifetimes = graph.lifetimes
+        let passNames = graph.passes.map { $0.name }
+        let combine = passNames.firstIndex(of: "Final combine")!
+        
+        XCTAssertEqual(lifetimes[resources.solidColor], 0 ... combine)
+        XCTAssertEqual(lifetimes[resources.solidDepth], 0 ... passNames.firstIndex(of: "Initialize Depth Buffer 2")!)
+        XCTAssertEqual(lifetimes[resources.peelColor[1]], passNames.firstIndex(of: "Depth Peel Layer 1")! ... combine)
+        XCTAssertEqual(lifetimes[resources.output!], combine ... passNames.firstIndex(of: "Read back")!)
+        for depth in resources.peelDepth {
+            XCTAssertLessThan(lifetimes[depth]!.upperBound, combine)
+        }
+    }
+    
+    func testOutputSharesMemoryWithDepth() {
+        let (graph, resources) = GLLRenderGraph.depthPeeling(layers: 3, offscreenOutput: true)
+        let plan = graph.plan(width: 2048, height: 2048)
+        assertValid(plan, for: graph)
+        
+        let output = plan.allocations[resources.output!]!
+        let depths = ([resources.solidDepth] + resources.peelDepth).map { plan.allocations[$0]! }
+        XCTAssertTrue(depths.contains { $0.offset == output.offset })
+        XCTAssertEqual(plan.unaliasedBytes - plan.peakBytes, output.size)
+    }
+    
+    func testPeakBytesForAllConfigurations() {
+        for offscreenOutput in [false, true] {
+            for layers in 0 ... GLLDepthPeelEstimator.maximumLayers {
+                let (graph, _) = GLLRenderGraph.depthPeeling(layers: layers, offscreenOutput: offscreenOutput)
+                let plan = graph.plan(width: 1920, height: 1080)
+                assertValid(plan, for: graph)
+                XCTAssertLessThanOrEqual(plan.peakBytes, plan.unaliasedBytes)
+                if offscreenOutput {
+                    XCTAssertLessThan(plan.peakBytes, plan.unaliasedBytes)
+                }
+            }
+        }
+        
+        // Without blended meshes, there is nothing for the peel passes
+        let (solidOnly, _) = GLLRenderGraph.depthPeeling(layers: 0, offscreenOutput: false)
+        XCTAssertEqual(solidOnly.resources.count, 2)
+    }
+    
+    func testRandomGraphs() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 51)
+        for _ in 0 ..< 50 {
+            var graph = GLLRenderGraph()
+            let resourceCount = Int.random(in: 1 ... 12, using: &generator)
+            for i in 0 ..< resourceCount {
+                _ = graph.addResource("resource-\(i)", format: Bool.random(using: &generator) ? .bgra8 : .depth32)
+            }
+            for i in 0 ..< Int.random(in: 1 ... 20, using: &generator) {
+                let reads = (0 ..< Int.random(in: 0 ... 2, using: &generator)).map { _ in Int.random(in: 0 ..< resourceCount, using: &generator) }
+                let writes = (0 ..< Int.random(in: 0 ... 2, using: &generator)).map { _ in Int.random(in: 0 ..< resourceCount, using: &generator) }
+                graph.addPass("pass-\(i)", reads: reads, writes: writes)
+            }
+            let sizes = graph.resources.map { _ in (size: Int.random(in: 1 ... 100, using: &generator) * 256, alignment: 256) }
+            
+            let plan = graph.plan(sizes: sizes)
+            assertValid(plan, for: graph)
+            for allocation in plan.allocations.compactMap({ $0 }) {
+                XCTAssertEqual(allocation.offset % 256, 0)
+            }
+        }
+    }
+    
+    func testBucketSizes() {
+        XCTAssertEqual(GLLRenderGraph.bucketSize(for: 1), 1 << 20)
+        for bytes in [(1 << 20) + 1, 3_000_000, 1 << 26, (1 << 26) + 1, 91_238_400] {
+            let bucket = GLLRenderGraph.bucketSize(for: bytes)
+            XCTAssertGreaterThanOrEqual(bucket, bytes)
+            XCTAssertLessThanOrEqual(Double(bucket), Double(bytes) * 1.25)
+        }
+        
+        // Making a window a little smaller keeps the heap it has
+        let (graph, _) = GLLRenderGraph.depthPeeling(layers: 7, offscreenOutput: false)
+        let large = GLLRenderGraph.bucketSize(for: graph.plan(width: 1920, height: 1080).peakBytes)
+        let smaller = GLLRenderGraph.bucketSize(for: graph.plan(width: 1900, height: 1060).peakBytes)
+        XCTAssertEqual(large, smaller)
+    }
+}
@@ -0,0 +1,140 @@
+//
+//  GLLRenderQueueTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLRenderQueueTest: XCTestCase {
+    
+    // Records what a real encoder would get
+    struct RecordingSink: GLLRenderQueueSink {
+        var calls: [String] = []
+        var stateChanges = 0
+        var draws: [Int] = []
+        
+        mutating func setPipeline(for drawable: Int) {
+            calls.append("pipeline \(drawable)")
+            stateChanges += 1
+        }
+        mutating func setVertexArray(for drawable: Int) {
+            calls.append("vertex array \(drawable)")
+            stateChanges += 1
+        }
+        mutating func setTextures(for drawable: Int) {
+            calls.append("textures \(drawable)")
+            stateChanges += 1
+        }
+        mutating func setTransforms(for drawable: Int) {
+            calls.append("transforms \(drawable)")
+            stateChanges += 1
+        }
+        mutating func draw(_ drawable: Int) {
+            calls.append("draw \(drawable)")
+            draws.append(drawable)
+        }
+    }
+    
+    func key(_ pipeline: Int, _ vertexArray: Int, _ textures: Int, _ transforms: Int) -> GLLRenderStateKey {
+        return GLLRenderStateKey(pipeline: pipeline, vertexArray: vertexArray, textures: textures, transforms: transforms)
+    }
+    
+    func testSortsAndSkipsRedundantState() {
+        let queue = GLLRenderQueue(entries: [
+            (key(1, 0, 0, 0), 0, false),
+            (key(0, 0, 1, 0), 1, false),
+            (key(1, 0, 0, 0), 2, false),
+            (key(0, 0, 1, 0), 3, true),
+            (key(0, 0, 0, 0), 4, false),
+        ])
+        
+        var sink = RecordingSink()
+        queue.replay(blended: false, into: &sink)
+        XCTAssertEqual(sink.calls, [
+            "pipeline 4", "vertex array 4", "textures 4", "transforms 4", "draw 4",
+            "textures 1", "draw 1",
+            "pipeline 0", "textures 0", "draw 0",
+            // Same state as 0
+            "draw 2"
+        ])
+        
+        var blendedSink = RecordingSink()
+        queue.replay(blended: true, into: &blendedSink)
+        XCTAssertEqual(blendedSink.draws, [3])
+    }
+    
+    func testInvisibleDrawsDontChangeState() {
+        let queue = GLLRenderQueue(entries: [
+            (key(0, 0, 0, 0), 0, false),
+            (key(0, 0, 1, 0), 1, false),
+            (key(0, 1, 0, 0), 2, false),
+        ])
+        
+        var sink = RecordingSink()
+        queue.replay(blended: false, into: &sink) { $0 != 1 }
+        // Drawable 1 comes between 0 and 2 in the sorted order, but since it is skipped the textures of 0 are still set for 2
+        XCTAssertEqual(sink.calls, ["pipeline 0", "vertex array 0", "textures 0", "transforms 0", "draw 0", "vertex array 2", "draw 2"])
+    }
+    
+    func testNumbering() {
+        var numbering = GLLRenderStateNumbering()
+        let a = NSObject(), b = NSObject(), c = NSObject()
+        
+        XCTAssertEqual(numbering.number(for: a), 0)
+        XCTAssertEqual(numbering.number(for: b), 1)
+        XCTAssertEqual(numbering.number(for: a), 0)
+        
+        XCTAssertEqual(numbering.number(forSet: [a, b]), 0)
+        XCTAssertEqual(numbering.number(forSet: [b, a]), 0)
+        XCTAssertEqual(numbering.number(forSet: [a, c]), 1)
+        XCTAssertEqual(numbering.number(forSet: []), 2)
+    }
+    
+    func testFewerStateChangesThanInsertionOrder() {
+        // Several items with many meshes each, a handful of shaders, and textures shared between some meshes
+        var generator = GLLCPUSkinnerTest.Generator(state: 32)
+        var entries: [(key: GLLRenderStateKey, drawable: Int, isBlended: Bool)] = []
+        for item in 0 ..< 10 {
+            for _ in 0 ..< 40 {
+                let pipeline = Int.random(in: 0 ..< 6, using: &generator)
+                let textures = Int.random(in: 0 ..< 20, using: &generator)
+                entries.append((key(pipeline, item, textures, item), entries.count, pipeline >= 4))
+            }
+        }
+        let queue = GLLRenderQueue(entries: entries)
+        
+        // What the old code did: every draw sets everything
+        let unsortedStateChanges = entries.count * 4
+        
+        var solid = RecordingSink()
+        queue.replay(blended: false, into: &solid)
+        var blended = RecordingSink()
+        queue.replay(blended: true, into: &blended)
+        
+        XCTAssertEqual(solid.draws.count + blended.draws.count, entries.count)
+        XCTAssertEqual(Set(solid.draws + blended.draws).count, entries.count)
+        // At most one change per pipeline, and per item within a pipeline, plus textures
+        XCTAssertLessThan(solid.stateChanges + blended.stateChanges, unsortedStateChanges / 2)
+    }
+    
+    func testPerformanceReplay() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 132)
+        let entries = (0 ..< 5000).map { drawable in
+            (key: key(Int.random(in: 0 ..< 8, using: &generator), drawable / 100, Int.random(in: 0 ..< 50, using: &generator), drawable / 100), drawable: drawable, isBlended: drawable % 3 == 0)
+        }
+        let queue = GLLRenderQueue(entries: entries)
+        let visible = GLLBitSet(count: entries.count, members: Array(stride(from: 0, to: entries.count, by: 2)))
+        
+        measure {
+            // One solid pass and seven depth peel layers, like a frame
+            var sink = RecordingSink()
+            queue.replay(blended: false, into: &sink) { visible[$0] }
+            for _ in 0 ..< 7 {
+                queue.replay(blended: true, into: &sink) { visible[$0] }
+            }
+        }
+    }
+}
@@ -0,0 +1,102 @@
+//
+//  GLLSkeletonIndexTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLSkeletonIndexTest: XCTestCase {
+    
+    /*
+     * 0 root
+     * ├ 1 spine
+     * │ ├ 3 arm left
+     * │ │ └ 5 hand left
+     * │ └ 4 arm right
+     * └ 2 leg
+     * 6 unused (its own parent)
+     */
+    let parents = [-1, 0, 0, 1, 1, 3, 6]
+    let names = ["root", "spine", "leg", "arm left", "arm right", "hand left", "unused"]
+    
+    func testChildren() {
+        let index = GLLSkeletonIndex(parentIndices: parents, names: names)
+        
+        XCTAssertEqual(Array(index.children(of: 0)), [1, 2])
+        XCTAssertEqual(Array(index.children(of: 1)), [3, 4])
+        XCTAssertEqual(Array(index.children(of: 3)), [5])
+        XCTAssertEqual(Array(index.children(of: 5)), [])
+        XCTAssertEqual(index.roots, [0, 6])
+        XCTAssertNil(index.parent(of: 6))
+        XCTAssertEqual(index.parent(of: 5), 3)
+        XCTAssertNil(index.boneInCycle)
+    }
+    
+    func testDepthFirstOrder() {
+        let index = GLLSkeletonIndex(parentIndices: parents, names: names)
+        
+        XCTAssertEqual(index.preorder, [0, 1, 3, 5, 4, 2, 6])
+        XCTAssertEqual(Array(index.subtree(of: 1)), [1, 3, 5, 4])
+        XCTAssertEqual(Array(index.subtree(of: 2)), [2])
+    }
+    
+    func testDescendants() {
+        let index = GLLSkeletonIndex(parentIndices: parents, names: names)
+        
+        XCTAssertTrue(index.isDescendant(5, of: 0))
+        XCTAssertTrue(index.isDescendant(5, of: 1))
+        XCTAssertFalse(index.isDescendant(5, of: 4))
+        XCTAssertFalse(index.isDescendant(1, of: 1))
+        XCTAssertFalse(index.isDescendant(0, of: 5))
+        XCTAssertFalse(index.isDescendant(6, of: 0))
+        
+        XCTAssertEqual(index.descendantsMask(ofAny: [3, 2]), [false, false, false, false, false, true, false])
+        XCTAssertEqual(index.descendantsMask(ofAny: [1, 3]), [false, false, false, true, true, true, false])
+        XCTAssertEqual(index.descendantsMask(ofAny: []), Array(repeating: false, count: 7))
+    }
+    
+    func testNames() {
+        let index = GLLSkeletonIndex(parentIndices: parents + [0], names: names + ["spine"])
+        
+        XCTAssertEqual(index.index(named: "hand left"), 5)
+        // First one wins
+        XCTAssertEqual(index.index(named: "spine"), 1)
+        XCTAssertNil(index.index(named: "tail"))
+    }
+    
+    func testCycle() {
+        // 1 and 2 are each other's parents, 3 is below them
+        let index = GLLSkeletonIndex(parentIndices: [-1, 2, 1, 2], names: ["a", "b", "c", "d"])
+        
+        XCTAssertNotNil(index.boneInCycle)
+        XCTAssertTrue([1, 2].contains(index.boneInCycle!))
+        XCTAssertEqual(index.preorder.sorted(), [0, 1, 2, 3])
+        XCTAssertFalse(index.isDescendant(3, of: 2))
+    }
+    
+    func testMaskMatchesParentWalk() {
+        // Random tree; parents always have lower indices, like in most model files
+        var generator = GLLCPUSkinnerTest.Generator(state: 28)
+        let count = 2000
+        let parents = (0 ..< count).map { $0 == 0 ? -1 : Int.random(in: 0 ..< $0, using: &generator) }
+        let index = GLLSkeletonIndex(parentIndices: parents, names: (0 ..< count).map { "bone \($0)" })
+        let selected = (0 ..< 20).map { _ in Int.random(in: 0 ..< count, using: &generator) }
+        
+        let mask = index.descendantsMask(ofAny: selected)
+        for bone in 0 ..< count {
+            var isBelowSelected = false
+            var ancestor = parents[bone]
+            while ancestor >= 0 {
+                if selected.contains(ancestor) {
+                    isBelowSelected = true
+                }
+                ancestor = parents[ancestor]
+            }
+            XCTAssertEqual(mask[bone], isBelowSelected)
+            XCTAssertEqual(mask[bone], selected.contains { index.isDescendant(bone, of: $0) })
+        }
+    }
+}
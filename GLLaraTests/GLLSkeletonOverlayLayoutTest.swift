@@ -0,0 +1,99 @@
+//
+//  GLLSkeletonOverlayLayoutTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLSkeletonOverlayLayoutTest: XCTestCase {
+    
+    let colors = GLLSkeletonOverlayLayout.Colors(selected: vector_uchar4(255, 0, 0, 127), childOfSelected: vector_uchar4(0, 255, 0, 127), normal: vector_uchar4(255, 255, 0, 127))
+    
+    func testBitSet() {
+        var set = GLLBitSet(count: 70, members: [0, 3, 64, 69])
+        XCTAssertTrue(set.contains(3))
+        XCTAssertTrue(set[64])
+        XCTAssertFalse(set.contains(63))
+        XCTAssertEqual(set.countOfMembers, 4)
+        
+        set.remove(3)
+        set[5] = true
+        set.append(contentsOf: GLLBitSet(count: 10, members: [1, 9]))
+        XCTAssertEqual(set.count, 80)
+        
+        var members: [Int] = []
+        set.forEachMember { members.append($0) }
+        XCTAssertEqual(members, [0, 5, 64, 69, 71, 79])
+    }
+    
+    func testTwoItems() {
+        var layout = GLLSkeletonOverlayLayout()
+        // First item: 0 ← 1 ← 2, and 3 without displayed parent
+        layout.appendItem(parents: [-1, 0, 1, -1], isSelected: GLLBitSet(count: 4, members: [1]), isChildOfSelected: GLLBitSet(count: 4, members: [2]))
+        // Second item: 0 ← 1
+        layout.appendItem(parents: [-1, 0], isSelected: GLLBitSet(count: 2), isChildOfSelected: GLLBitSet(count: 2))
+        
+        XCTAssertEqual(layout.count, 6)
+        XCTAssertEqual(layout.parentSlots, [0, 0, 1, 3, 4, 4])
+        
+        var vertices = Array(repeating: GLLSkeletonDrawerVertex(), count: layout.count)
+        var elements = Array(repeating: UInt16(0), count: layout.elementCount)
+        layout.writeStaticData(colors: colors, vertices: &vertices, elements: &elements)
+        
+        XCTAssertEqual(elements, [0, 0, 1, 0, 2, 1, 3, 3, 4, 4, 5, 4])
+        XCTAssertEqual(vertices.map { $0.color }, [colors.normal, colors.selected, colors.childOfSelected, colors.normal, colors.normal, colors.normal])
+        
+        // Positions don't touch the colors
+        layout.writePositions(vertices: &vertices) { vector_float3(Float($0), 0, 1) }
+        XCTAssertEqual(vertices[4].position, vector_float3(4, 0, 1))
+        XCTAssertEqual(vertices[1].color, colors.selected)
+    }
+    
+    // Random tree per item, parents always before children
+    static func randomItems(count: Int, bonesPerItem: Int) -> [(parents: [Int], selected: GLLBitSet, childOfSelected: GLLBitSet)] {
+        var generator = GLLCPUSkinnerTest.Generator(state: 29)
+        return (0 ..< count).map { _ in
+            let parents = (0 ..< bonesPerItem).map { $0 == 0 ? -1 : Int.random(in: 0 ..< $0, using: &generator) }
+            let index = GLLSkeletonIndex(parentIndices: parents, names: parents.indices.map { "bone \($0)" })
+            let selected = (0 ..< 3).map { _ in Int.random(in: 0 ..< bonesPerItem, using: &generator) }
+            let mask = index.descendantsMask(ofAny: selected)
+            return (parents, GLLBitSet(count: bonesPerItem, members: selected), GLLBitSet(count: bonesPerItem, members: mask.indices.filter { mask[$0] }))
+        }
+    }
+    
+    func testPerformanceSelectionChange() {
+        let items = GLLSkeletonOverlayLayoutTest.randomItems(count: 20, bonesPerItem: 300)
+        var vertices = Array(repeating: GLLSkeletonDrawerVertex(), count: 20 * 300)
+        var elements = Array(repeating: UInt16(0), count: 2 * 20 * 300)
+        
+        measure {
+            for _ in 0 ..< 100 {
+                var layout = GLLSkeletonOverlayLayout()
+                for item in items {
+                    layout.appendItem(parents: item.parents, isSelected: item.selected, isChildOfSelected: item.childOfSelected)
+                }
+                layout.writeStaticData(colors: colors, vertices: &vertices, elements: &elements)
+                layout.writePositions(vertices: &vertices) { vector_float3(Float($0), 0, 0) }
+            }
+        }
+    }
+    
+    func testPerformancePoseChange() {
+        let items = GLLSkeletonOverlayLayoutTest.randomItems(count: 20, bonesPerItem: 300)
+        var layout = GLLSkeletonOverlayLayout()
+        for item in items {
+            layout.appendItem(parents: item.parents, isSelected: item.selected, isChildOfSelected: item.childOfSelected)
+        }
+        let positions = (0 ..< layout.count).map { vector_float3(Float($0), 1, 2) }
+        var vertices = Array(repeating: GLLSkeletonDrawerVertex(), count: layout.count)
+        
+        measure {
+            for _ in 0 ..< 1000 {
+                layout.writePositions(vertices: &vertices) { positions[$0] }
+            }
+        }
+    }
+}
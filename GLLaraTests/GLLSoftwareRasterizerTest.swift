@@ -0,0 +1,350 @@
+//
+//  GLLSoftwareRasterizerTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+import CoreGraphics
+import ImageIO
+
+class GLLSoftwareRasterizerTest: XCTestCase {
+    
+    static let noLights = GLLSoftwareLights(cameraPosition: SIMD3<Float>(), ambientColor: SIMD4<Float>(), lights: [])
+    static let clearColor = SIMD4<Float>(0.2, 0.2, 0.2, 1.0)
+    
+    // The test scenes are in clip space directly, with w = 1, so the view projection is the identity
+    static let identity = matrix_float4x4(diagonal: SIMD4<Float>(repeating: 1))
+    
+    static func quantized(_ color: SIMD4<Float>) -> SIMD4<Float> {
+        return (simd_clamp(color, SIMD4<Float>(repeating: 0), SIMD4<Float>(repeating: 1)) * 255).rounded() / 255
+    }
+    
+    // Clockwise on screen, i.e. front facing
+    static func quad(from minimum: SIMD2<Float>, to maximum: SIMD2<Float>, depth: Float, material: GLLSoftwareMaterial, color: SIMD4<Float>? = nil) -> GLLSoftwareDrawable {
+        let positions = [
+            SIMD3<Float>(minimum.x, minimum.y, depth),
+            SIMD3<Float>(minimum.x, maximum.y, depth),
+            SIMD3<Float>(maximum.x, maximum.y, depth),
+            SIMD3<Float>(maximum.x, minimum.y, depth)
+        ]
+        var drawable = GLLSoftwareDrawable(positions: positions, normals: Array(repeating: SIMD3<Float>(0, 0, -1), count: 4), indices: [0, 1, 2, 0, 2, 3], material: material)
+        drawable.texCoords = [Array(repeating: SIMD2<Float>(0.5, 0.5), count: 4)]
+        if let color = color {
+            drawable.colors = Array(repeating: color, count: 4)
+        }
+        return drawable
+    }
+    
+    static func vertexColorMaterial() -> GLLSoftwareMaterial {
+        return GLLSoftwareMaterial(features: [.isShadeless, .hasVertexColor])
+    }
+    
+    // Shadeless, with the color and alpha from the diffuse texture
+    static func blendedMaterial(color: SIMD4<Float>) -> GLLSoftwareMaterial {
+        var material = GLLSoftwareMaterial(features: [.isShadeless, .hasDiffuseTexture], isBlended: true)
+        material.set(texture: GLLSoftwareTexture(color: color), for: .diffuse)
+        return material
+    }
+    
+    func assertEqual(_ a: SIMD4<Float>, _ b: SIMD4<Float>, accuracy: Float = 1e-5, file: StaticString = #filePath, line: UInt = #line) {
+        XCTAssertEqual(a.x, b.x, accuracy: accuracy, file: file, line: line)
+        XCTAssertEqual(a.y, b.y, accuracy: accuracy, file: file, line: line)
+        XCTAssertEqual(a.z, b.z, accuracy: accuracy, file: file, line: line)
+        XCTAssertEqual(a.w, b.w, accuracy: accuracy, file: file, line: line)
+    }
+    
+    // MARK: - Rasterizing
+    
+    func testCoverage() {
+        let rasterizer = GLLSoftwareRasterizer(width: 16, height: 16)
+        let red = SIMD4<Float>(1, 0, 0, 1)
+        let drawable = GLLSoftwareRasterizerTest.quad(from: SIMD2<Float>(-0.5, -0.5), to: SIMD2<Float>(0.5, 0.5), depth: 0.5, material: GLLSoftwareRasterizerTest.vertexColorMaterial(), color: red)
+        let image = rasterizer.render(drawables: [drawable], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        
+        for y in 0 ..< 16 {
+            for x in 0 ..< 16 {
+                let inside = (4 ..< 12).contains(x) && (4 ..< 12).contains(y)
+                assertEqual(image[x: x, y: y], inside ? red : GLLSoftwareRasterizerTest.clearColor)
+            }
+        }
+        // The pixel centers on the diagonal belong to exactly one of the two triangles
+        XCTAssertEqual(rasterizer.statistics.shadedFragments, 64)
+        XCTAssertEqual(rasterizer.statistics.triangles, 2)
+        XCTAssertEqual(rasterizer.statistics.culledTriangles, 0)
+    }
+    
+    func testCulling() {
+        let rasterizer = GLLSoftwareRasterizer(width: 16, height: 16)
+        var drawable = GLLSoftwareRasterizerTest.quad(from: SIMD2<Float>(-1, -1), to: SIMD2<Float>(1, 1), depth: 0.5, material: GLLSoftwareRasterizerTest.vertexColorMaterial())
+        // Counter-clockwise
+        drawable.indices = [0, 2, 1, 0, 3, 2]
+        
+        drawable.cullMode = .back
+        _ = rasterizer.render(drawables: [drawable], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        XCTAssertEqual(rasterizer.statistics.shadedFragments, 0)
+        XCTAssertEqual(rasterizer.statistics.culledTriangles, 2)
+        
+        drawable.cullMode = .front
+        _ = rasterizer.render(drawables: [drawable], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        XCTAssertEqual(rasterizer.statistics.shadedFragments, 256)
+        
+        drawable.cullMode = .none
+        _ = rasterizer.render(drawables: [drawable], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        XCTAssertEqual(rasterizer.statistics.shadedFragments, 256)
+    }
+    
+    func testNearPlaneClipping() {
+        let rasterizer = GLLSoftwareRasterizer(width: 16, height: 16)
+        var drawable = GLLSoftwareRasterizerTest.quad(from: SIMD2<Float>(-1, -1), to: SIMD2<Float>(1, 1), depth: 0.5, material: GLLSoftwareRasterizerTest.vertexColorMaterial())
+        // The left half is in front of the near plane
+        drawable.positions[0].z = -0.5
+        drawable.positions[1].z = -0.5
+        drawable.positions[2].z = 0.5
+        drawable.positions[3].z = 0.5
+        _ = rasterizer.render(drawables: [drawable], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        XCTAssertEqual(rasterizer.statistics.clippedTriangles, 2)
+        XCTAssertEqual(rasterizer.statistics.shadedFragments, 8 * 16)
+    }
+    
+    func testDiffuseLighting() {
+        let rasterizer = GLLSoftwareRasterizer(width: 8, height: 8)
+        let material = GLLSoftwareMaterial(features: [.hasNormal, .hasDiffuseLighting])
+        let drawable = GLLSoftwareRasterizerTest.quad(from: SIMD2<Float>(-1, -1), to: SIMD2<Float>(1, 1), depth: 0.5, material: material)
+        
+        let light = GLLLightBuffer(diffuseColor: SIMD4<Float>(0.5, 0.25, 0.125, 1), specularColor: SIMD4<Float>(), direction: SIMD4<Float>(0, 0, 1, 0))
+        let otherLight = GLLLightBuffer(diffuseColor: SIMD4<Float>(1, 1, 1, 1), specularColor: SIMD4<Float>(), direction: SIMD4<Float>(0, 0, -1, 0))
+        let lights = GLLSoftwareLights(cameraPosition: SIMD3<Float>(0, 0, -1), ambientColor: SIMD4<Float>(0.1, 0.1, 0.1, 1), lights: [light, otherLight])
+        let image = rasterizer.render(drawables: [drawable], viewProjection: GLLSoftwareRasterizerTest.identity, lights: lights)
+        
+        // Ambient plus the first light head-on; the second one comes from behind
+        let expected = GLLSoftwareRasterizerTest.quantized(SIMD4<Float>(0.6, 0.35, 0.225, 1))
+        for pixel in image.pixels {
+            assertEqual(pixel, expected)
+        }
+    }
+    
+    func testDepthTestIsOrderIndependent() {
+        let green = SIMD4<Float>(0, 1, 0, 1)
+        let red = SIMD4<Float>(1, 0, 0, 1)
+        let near = GLLSoftwareRasterizerTest.quad(from: SIMD2<Float>(-1, -1), to: SIMD2<Float>(0.5, 0.5), depth: 0.3, material: GLLSoftwareRasterizerTest.vertexColorMaterial(), color: green)
+        let far = GLLSoftwareRasterizerTest.quad(from: SIMD2<Float>(-0.5, -0.5), to: SIMD2<Float>(1, 1), depth: 0.6, material: GLLSoftwareRasterizerTest.vertexColorMaterial(), color: red)
+        
+        let rasterizer = GLLSoftwareRasterizer(width: 32, height: 32)
+        let nearFirst = rasterizer.render(drawables: [near, far], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        let farFirst = rasterizer.render(drawables: [far, near], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        
+        XCTAssertEqual(nearFirst.pixels, farFirst.pixels)
+        // In the overlap
+        assertEqual(nearFirst[x: 16, y: 16], green)
+    }
+    
+    func testDepthPeeling() {
+        let farColor = SIMD4<Float>(1, 0, 0, 0.5)
+        let middleColor = SIMD4<Float>(0, 1, 0, 0.25)
+        let nearColor = SIMD4<Float>(0, 0, 1, 0.75)
+        let solidColor = SIMD4<Float>(1, 1, 0, 1)
+        let full = (SIMD2<Float>(-1, -1), SIMD2<Float>(1, 1))
+        let far = GLLSoftwareRasterizerTest.quad(from: full.0, to: full.1, depth: 0.7, material: GLLSoftwareRasterizerTest.blendedMaterial(color: farColor))
+        let middle = GLLSoftwareRasterizerTest.quad(from: full.0, to: full.1, depth: 0.5, material: GLLSoftwareRasterizerTest.blendedMaterial(color: middleColor))
+        let near = GLLSoftwareRasterizerTest.quad(from: full.0, to: full.1, depth: 0.2, material: GLLSoftwareRasterizerTest.blendedMaterial(color: nearColor))
+        // Hides the far blended quad in the right half
+        let solid = GLLSoftwareRasterizerTest.quad(from: SIMD2<Float>(0, -1), to: SIMD2<Float>(1, 1), depth: 0.6, material: GLLSoftwareRasterizerTest.vertexColorMaterial(), color: solidColor)
+        
+        let rasterizer = GLLSoftwareRasterizer(width: 16, height: 16)
+        let image = rasterizer.render(drawables: [middle, near, solid, far], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        XCTAssertEqual(rasterizer.statistics.depthPeelLayers, 3)
+        
+        // Back to front, by hand
+        let q = GLLSoftwareRasterizerTest.quantized
+        var left = GLLSoftwareRasterizerTest.clearColor
+        for color in [farColor, middleColor, nearColor] {
+            left = GLLSoftwareRasterizer.blend(q(color), over: left)
+        }
+        var right = GLLSoftwareRasterizer.blend(solidColor, over: GLLSoftwareRasterizerTest.clearColor)
+        for color in [middleColor, nearColor] {
+            right = GLLSoftwareRasterizer.blend(q(color), over: right)
+        }
+        assertEqual(image[x: 2, y: 8], left)
+        assertEqual(image[x: 13, y: 8], right)
+        
+        // With fewer layers, the farthest ones get lost
+        rasterizer.depthPeelLayerCount = 2
+        let twoLayers = rasterizer.render(drawables: [middle, near, solid, far], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        var leftTwoLayers = GLLSoftwareRasterizerTest.clearColor
+        for color in [middleColor, nearColor] {
+            leftTwoLayers = GLLSoftwareRasterizer.blend(q(color), over: leftTwoLayers)
+        }
+        assertEqual(twoLayers[x: 2, y: 8], leftTwoLayers)
+        assertEqual(twoLayers[x: 13, y: 8], right)
+    }
+    
+    // MARK: - Tiles
+    
+    static func randomTriangles(count: Int, blendedFraction: Float, generator: inout GLLCPUSkinnerTest.Generator) -> [GLLSoftwareDrawable] {
+        return (0 ..< count).map { _ in
+            let center = SIMD2<Float>(Float.random(in: -1 ... 1, using: &generator), Float.random(in: -1 ... 1, using: &generator))
+            let positions = (0 ..< 3).map { _ in
+                SIMD3<Float>(center.x + Float.random(in: -0.3 ... 0.3, using: &generator), center.y + Float.random(in: -0.3 ... 0.3, using: &generator), Float.random(in: 0 ... 1, using: &generator))
+            }
+            let color = SIMD4<Float>(Float.random(in: 0 ... 1, using: &generator), Float.random(in: 0 ... 1, using: &generator), Float.random(in: 0 ... 1, using: &generator), Float.random(in: 0 ... 1, using: &generator))
+            let material = Float.random(in: 0 ... 1, using: &generator) < blendedFraction ? blendedMaterial(color: color) : vertexColorMaterial()
+            var drawable = GLLSoftwareDrawable(positions: positions, normals: Array(repeating: SIMD3<Float>(0, 0, -1), count: 3), indices: [0, 1, 2], material: material)
+            drawable.texCoords = [Array(repeating: SIMD2<Float>(), count: 3)]
+            drawable.colors = Array(repeating: color, count: 3)
+            drawable.cullMode = .none
+            return drawable
+        }
+    }
+    
+    func testTileSizeDoesNotChangeImage() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 33)
+        let drawables = GLLSoftwareRasterizerTest.randomTriangles(count: 200, blendedFraction: 0.5, generator: &generator)
+        
+        let reference = GLLSoftwareRasterizer(width: 100, height: 70, tileSize: 100).render(drawables: drawables, viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        for tileSize in [7, 16, 64] {
+            let image = GLLSoftwareRasterizer(width: 100, height: 70, tileSize: tileSize).render(drawables: drawables, viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+            XCTAssertEqual(image.pixels, reference.pixels, "tile size \(tileSize)")
+        }
+    }
+    
+    func testSharedEdgesHaveNoGapsOrOverlaps() {
+        // An irregular grid over the whole screen. Every triangle has its own vertices and is nearer than the ones before, so a pixel that two triangles cover gets shaded twice.
+        var generator = GLLCPUSkinnerTest.Generator(state: 34)
+        let cells = 6
+        var lattice: [SIMD2<Float>] = []
+        for y in 0 ... cells {
+            for x in 0 ... cells {
+                var point = SIMD2<Float>(Float(x), Float(y)) / Float(cells) * 2 - 1
+                if x > 0 && x < cells && y > 0 && y < cells {
+                    point += SIMD2<Float>(Float.random(in: -0.1 ... 0.1, using: &generator), Float.random(in: -0.1 ... 0.1, using: &generator))
+                }
+                lattice.append(point)
+            }
+        }
+        var positions: [SIMD3<Float>] = []
+        for y in 0 ..< cells {
+            for x in 0 ..< cells {
+                let corners = [lattice[y * (cells + 1) + x], lattice[(y + 1) * (cells + 1) + x], lattice[(y + 1) * (cells + 1) + x + 1], lattice[y * (cells + 1) + x + 1]]
+                for triangle in [[0, 1, 2], [0, 2, 3]] {
+                    let depth = 1 - Float(positions.count + 1) / Float(cells * cells * 6 + 1)
+                    positions += triangle.map { SIMD3<Float>(corners[$0], depth) }
+                }
+            }
+        }
+        var drawable = GLLSoftwareDrawable(positions: positions, normals: Array(repeating: SIMD3<Float>(0, 0, -1), count: positions.count), indices: (0 ..< UInt32(positions.count)).map { $0 }, material: GLLSoftwareRasterizerTest.vertexColorMaterial())
+        drawable.cullMode = .none
+        
+        let rasterizer = GLLSoftwareRasterizer(width: 123, height: 77, tileSize: 16)
+        _ = rasterizer.render(drawables: [drawable], viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        XCTAssertEqual(rasterizer.statistics.shadedFragments, 123 * 77)
+    }
+    
+    // MARK: - Textures
+    
+    func testBilinearSampling() {
+        let texture = GLLSoftwareTexture(width: 2, height: 1, rgba8: [0, 0, 0, 255, 255, 255, 255, 255])
+        assertEqual(texture.sample(SIMD2<Float>(0.25, 0.5)), SIMD4<Float>(0, 0, 0, 1))
+        assertEqual(texture.sample(SIMD2<Float>(0.75, 0.5)), SIMD4<Float>(1, 1, 1, 1))
+        assertEqual(texture.sample(SIMD2<Float>(0.5, 0.5)), SIMD4<Float>(0.5, 0.5, 0.5, 1))
+        // Repeating, also across the edge
+        assertEqual(texture.sample(SIMD2<Float>(1.25, -0.5)), SIMD4<Float>(0, 0, 0, 1))
+        assertEqual(texture.sample(SIMD2<Float>(0, 0.5)), SIMD4<Float>(0.5, 0.5, 0.5, 1))
+    }
+    
+    func testBC1Decoding() {
+        let red = SIMD4<Float>(1, 0, 0, 1)
+        let blue = SIMD4<Float>(0, 0, 1, 1)
+        // Indices 0, 1, 2, 3 for the first row, 0 for the rest
+        let opaque: [UInt8] = [0x00, 0xF8, 0x1F, 0x00, 0xE4, 0x00, 0x00, 0x00]
+        let opaqueTexels = opaque.withUnsafeBytes { GLLSoftwareTexture.decode(block: $0, format: .bc1) }
+        assertEqual(opaqueTexels[0], red)
+        assertEqual(opaqueTexels[1], blue)
+        assertEqual(opaqueTexels[2], (2 * red + blue) / 3)
+        assertEqual(opaqueTexels[3], (red + 2 * blue) / 3)
+        assertEqual(opaqueTexels[15], red)
+        
+        // Colors swapped is the mode with transparent black
+        let transparent: [UInt8] = [0x1F, 0x00, 0x00, 0xF8, 0xE4, 0x00, 0x00, 0x00]
+        let transparentTexels = transparent.withUnsafeBytes { GLLSoftwareTexture.decode(block: $0, format: .bc1) }
+        assertEqual(transparentTexels[2], (red + blue) / 2)
+        assertEqual(transparentTexels[3], SIMD4<Float>())
+    }
+    
+    // MARK: - Image comparison
+    
+    // Largest and average difference per channel, from 0 to 1
+    static func difference(_ a: GLLSoftwareImage, _ b: GLLSoftwareImage) -> (maximum: Float, mean: Float) {
+        precondition(a.width == b.width && a.height == b.height)
+        var maximum: Float = 0
+        var sum: Float = 0
+        for (pixelA, pixelB) in zip(a.pixels, b.pixels) {
+            let difference = abs(pixelA - pixelB)
+            maximum = max(maximum, difference.max())
+            sum += difference.sum()
+        }
+        return (maximum, sum / Float(a.pixels.count * 4))
+    }
+    
+    // Decodes with ImageIO, like a reference image would be. GLLSoftwareSceneRendererTest compares with the reference images.
+    static func image(encoded data: Data) -> GLLSoftwareImage? {
+        guard let source = CGImageSourceCreateWithData(data as CFData, nil), let image = CGImageSourceCreateImageAtIndex(source, 0, nil) else {
+            return nil
+        }
+        let width = image.width
+        let height = image.height
+        var bytes = Array(repeating: UInt8(0), count: width * height * 4)
+        let drawn = bytes.withUnsafeMutableBytes { bytes -> Bool in
+            guard let context = CGContext(data: bytes.baseAddress, width: width, height: height, bitsPerComponent: 8, bytesPerRow: width * 4, space: CGColorSpace(name: CGColorSpace.sRGB)!, bitmapInfo: CGImageAlphaInfo.premultipliedLast.rawValue) else {
+                return false
+            }
+            context.draw(image, in: CGRect(x: 0, y: 0, width: width, height: height))
+            return true
+        }
+        guard drawn else {
+            return nil
+        }
+        let pixels = (0 ..< width * height).map { i -> SIMD4<Float> in
+            let alpha = Float(bytes[i*4 + 3]) / 255
+            let premultiplied = SIMD3<Float>(Float(bytes[i*4 + 0]), Float(bytes[i*4 + 1]), Float(bytes[i*4 + 2])) / 255
+            return SIMD4<Float>(alpha > 0 ? premultiplied / alpha : premultiplied, alpha)
+        }
+        return GLLSoftwareImage(width: width, height: height, pixels: pixels)
+    }
+    
+    static func referenceImage(named name: String) throws -> GLLSoftwareImage {
+        let url = try XCTUnwrap(Bundle(for: GLLSoftwareRasterizerTest.self).url(forResource: name, withExtension: "png"))
+        return try XCTUnwrap(image(encoded: Data(contentsOf: url)))
+    }
+    
+    func testEncodedImageMatchesRendering() throws {
+        var generator = GLLCPUSkinnerTest.Generator(state: 35)
+        let drawables = GLLSoftwareRasterizerTest.randomTriangles(count: 50, blendedFraction: 0.5, generator: &generator)
+        let rendered = GLLSoftwareRasterizer(width: 64, height: 48).render(drawables: drawables, viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        
+        // Same layout as GLLViewDrawer.writeImage
+        let provider = try XCTUnwrap(CGDataProvider(data: rendered.bgra8Data as CFData))
+        let cgImage = try XCTUnwrap(CGImage(width: 64, height: 48, bitsPerComponent: 8, bitsPerPixel: 32, bytesPerRow: 64 * 4, space: CGColorSpace(name: CGColorSpace.sRGB)!, bitmapInfo: CGBitmapInfo(rawValue: CGImageAlphaInfo.first.rawValue + CGImageByteOrderInfo.order32Little.rawValue), provider: provider, decode: nil, shouldInterpolate: false, intent: .defaultIntent))
+        let data = NSMutableData()
+        let destination = try XCTUnwrap(CGImageDestinationCreateWithData(data as CFMutableData, "public.png" as CFString, 1, nil))
+        CGImageDestinationAddImage(destination, cgImage, nil)
+        XCTAssertTrue(CGImageDestinationFinalize(destination))
+        
+        let decoded = try XCTUnwrap(GLLSoftwareRasterizerTest.image(encoded: data as Data))
+        XCTAssertLessThanOrEqual(GLLSoftwareRasterizerTest.difference(rendered, decoded).maximum, 1.0 / 255.0 + 1e-5)
+    }
+    
+    // MARK: - Performance
+    
+    func testRenderingPerformance() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 36)
+        let drawables = GLLSoftwareRasterizerTest.randomTriangles(count: 20_000, blendedFraction: 0.2, generator: &generator)
+        let rasterizer = GLLSoftwareRasterizer(width: 512, height: 512)
+        
+        measure {
+            _ = rasterizer.render(drawables: drawables, viewProjection: GLLSoftwareRasterizerTest.identity, lights: GLLSoftwareRasterizerTest.noLights)
+        }
+    }
+}
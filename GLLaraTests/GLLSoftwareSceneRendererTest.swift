@@ -0,0 +1,239 @@
+//
+//  GLLSoftwareSceneRendererTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+import UniformTypeIdentifiers
+@testable import GLLara
+
+class GLLSoftwareSceneRendererTest: XCTestCase {
+    
+    // The test textures, by texture identifier
+    static let textureFiles = [
+        "diffuseTexture": "testDiffusetexture.png",
+        "lightmapTexture": "testLightmaptexture.png",
+        "bumpTexture": "testBumptexture.png",
+        "maskTexture": "testMasktexture.png",
+        "bump1Texture": "testBump1Texture.png",
+        "bump2Texture": "testBump2Texture.png",
+        "specularTexture": "testSpeculartexture.png",
+        "emissionTexture": "testEmissiontexture.png",
+        "reflectionTexture": "testReflectiontexture.png"
+    ]
+    
+    struct ReferenceShader {
+        var renderGroup: Int
+        // In the order the shader expects them in the file
+        var textures: [String]
+        var renderParameters: [Double] = []
+    }
+    
+    // Keyed by the name of the shader, which is also the name of the reference image without the "test" in front
+    static let referenceShaders = [
+        "Diffuse": ReferenceShader(renderGroup: 5, textures: ["diffuseTexture"]),
+        "DiffuseBump": ReferenceShader(renderGroup: 4, textures: ["diffuseTexture", "bumpTexture"], renderParameters: [0.5]),
+        "DiffuseBumpEmission": ReferenceShader(renderGroup: 30, textures: ["diffuseTexture", "bumpTexture", "emissionTexture"], renderParameters: [0.5]),
+        "DiffuseLightmap": ReferenceShader(renderGroup: 3, textures: ["diffuseTexture", "lightmapTexture"]),
+        "DiffuseLightmapBump": ReferenceShader(renderGroup: 2, textures: ["diffuseTexture", "lightmapTexture", "bumpTexture"], renderParameters: [0.5]),
+        "DiffuseLightmapBump3": ReferenceShader(renderGroup: 1, textures: ["diffuseTexture", "lightmapTexture", "bumpTexture", "maskTexture", "bump1Texture", "bump2Texture"], renderParameters: [0.5, 4, 4]),
+        "DiffuseLightmapBump3Specular": ReferenceShader(renderGroup: 22, textures: ["diffuseTexture", "lightmapTexture", "bumpTexture", "maskTexture", "bump1Texture", "bump2Texture", "specularTexture"], renderParameters: [0.5, 4, 4]),
+        "DiffuseLightmapBumpSpecular": ReferenceShader(renderGroup: 24, textures: ["diffuseTexture", "lightmapTexture", "bumpTexture", "specularTexture"], renderParameters: [0.5]),
+        "DiffuseSpecular": ReferenceShader(renderGroup: 32, textures: ["diffuseTexture"], renderParameters: [0.5]),
+        "Metallic": ReferenceShader(renderGroup: 26, textures: ["diffuseTexture", "bumpTexture", "reflectionTexture"], renderParameters: [0.5]),
+        "MetallicBump3": ReferenceShader(renderGroup: 29, textures: ["diffuseTexture", "bumpTexture", "maskTexture", "bump1Texture", "bump2Texture", "reflectionTexture"], renderParameters: [0.5, 0.5, 4]),
+        "Shadeless": ReferenceShader(renderGroup: 10, textures: ["diffuseTexture"]),
+        "StaticTRLBasic": ReferenceShader(renderGroup: 14, textures: ["diffuseTexture"]),
+        "StaticTRLNextGen": ReferenceShader(renderGroup: 11, textures: ["diffuseTexture", "bumpTexture"], renderParameters: [0.5]),
+        "StaticTRLShadeless": ReferenceShader(renderGroup: 13, textures: ["diffuseTexture"]),
+        "StaticTRUDiffuse": ReferenceShader(renderGroup: 16, textures: ["diffuseTexture"]),
+        "StaticTRUDiffuseLightmap": ReferenceShader(renderGroup: 17, textures: ["diffuseTexture", "lightmapTexture"])
+    ]
+    
+    // The reference images are from the GPU renderer, so edges and filtering differ a bit. This is the average difference per channel; a wrong texture or light is a lot more than that.
+    static let meanTolerance: Float = 0.04
+    
+    var directory: URL!
+    
+    override func setUpWithError() throws {
+        // The model file needs the textures next to it
+        directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString, isDirectory: true)
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        let bundle = Bundle(for: GLLSoftwareSceneRendererTest.self)
+        for file in GLLSoftwareSceneRendererTest.textureFiles.values {
+            let url = try XCTUnwrap(bundle.url(forResource: file, withExtension: nil))
+            try FileManager.default.copyItem(at: url, to: directory.appendingPathComponent(file))
+        }
+    }
+    
+    override func tearDownWithError() throws {
+        try FileManager.default.removeItem(at: directory)
+    }
+    
+    /**
+     * # A scene with the test object, set up like for the reference images.
+     *
+     * Two cubes with one bone each, the second one turned against the first, seen from above at an angle. The document is never shown, so there is no window, view or Metal drawing.
+     */
+    func document(shader: ReferenceShader) throws -> (GLLDocument, GLLCamera) {
+        let writer = GLLTestObjectWriter()
+        writer.numBones = 2
+        writer.numMeshes = 1
+        writer.setNumUVLayers(1, forMesh: 0)
+        for texture in shader.textures {
+            writer.addTextureFilename(GLLSoftwareSceneRendererTest.textureFiles[texture]!, uvLayer: 0, toMesh: 0)
+        }
+        writer.setRenderGroup(UInt(shader.renderGroup), renderParameterValues: shader.renderParameters, forMesh: 0)
+        // Its own name for each shader, so the model cache doesn't mix them up
+        let modelURL = directory.appendingPathComponent("test\(shader.renderGroup).mesh.ascii")
+        try writer.testFileString.write(to: modelURL, atomically: true, encoding: .utf8)
+        
+        let document = try GLLDocument(type: "de.ferroequinologist.gllara.scene")
+        let item = try document.addModel(at: modelURL)
+        let bone = item.bones[1] as! GLLItemBone
+        bone.rotationY = .pi / 2
+        
+        let cameraRequest = NSFetchRequest<GLLCamera>(entityName: "GLLCamera")
+        let camera = try XCTUnwrap(document.managedObjectContext!.fetch(cameraRequest).first)
+        camera.positionX = 0.5
+        camera.positionY = 0
+        camera.positionZ = 0
+        camera.distance = 4
+        camera.latitude = -0.5
+        camera.longitude = 0.6
+        camera.fieldOfViewY = 0.7
+        return (document, camera)
+    }
+    
+    // Renders to a PNG file through the same call the render window uses, reads it back and compares it with the reference image
+    func assertRenderingMatchesReference(_ name: String, file: StaticString = #filePath, line: UInt = #line) throws {
+        let shader = try XCTUnwrap(GLLSoftwareSceneRendererTest.referenceShaders[name], file: file, line: line)
+        let reference = try GLLSoftwareRasterizerTest.referenceImage(named: "test" + name)
+        let (document, camera) = try self.document(shader: shader)
+        
+        let renderer = GLLSoftwareSceneRenderer(managedObjectContext: document.managedObjectContext!, camera: camera)
+        let imageURL = directory.appendingPathComponent("\(name).png")
+        try renderer.writeImage(to: imageURL, fileType: .png, size: CGSize(width: reference.width, height: reference.height), transparentBackground: true)
+        XCTAssertEqual(renderer.replacedTextures.count, 0, file: file, line: line)
+        XCTAssertGreaterThan(renderer.statistics.shadedFragments, 0, file: file, line: line)
+        
+        let data = try Data(contentsOf: imageURL)
+        let rendered = try XCTUnwrap(GLLSoftwareRasterizerTest.image(encoded: data), file: file, line: line)
+        let difference = GLLSoftwareRasterizerTest.difference(rendered, reference)
+        if difference.mean > GLLSoftwareSceneRendererTest.meanTolerance {
+            let attachment = XCTAttachment(data: data, uniformTypeIdentifier: UTType.png.identifier)
+            attachment.name = "\(name) rendered"
+            attachment.lifetime = .keepAlways
+            add(attachment)
+        }
+        XCTAssertLessThanOrEqual(difference.mean, GLLSoftwareSceneRendererTest.meanTolerance, name, file: file, line: line)
+    }
+    
+    func testDiffuse() throws {
+        try assertRenderingMatchesReference("Diffuse")
+    }
+    
+    func testDiffuseBump() throws {
+        try assertRenderingMatchesReference("DiffuseBump")
+    }
+    
+    func testDiffuseBumpEmission() throws {
+        try assertRenderingMatchesReference("DiffuseBumpEmission")
+    }
+    
+    func testDiffuseLightmap() throws {
+        try assertRenderingMatchesReference("DiffuseLightmap")
+    }
+    
+    func testDiffuseLightmapBump() throws {
+        try assertRenderingMatchesReference("DiffuseLightmapBump")
+    }
+    
+    func testDiffuseLightmapBump3() throws {
+        try assertRenderingMatchesReference("DiffuseLightmapBump3")
+    }
+    
+    func testDiffuseLightmapBump3Specular() throws {
+        try assertRenderingMatchesReference("DiffuseLightmapBump3Specular")
+    }
+    
+    func testDiffuseLightmapBumpSpecular() throws {
+        try assertRenderingMatchesReference("DiffuseLightmapBumpSpecular")
+    }
+    
+    func testDiffuseSpecular() throws {
+        try assertRenderingMatchesReference("DiffuseSpecular")
+    }
+    
+    func testMetallic() throws {
+        try assertRenderingMatchesReference("Metallic")
+    }
+    
+    func testMetallicBump3() throws {
+        try assertRenderingMatchesReference("MetallicBump3")
+    }
+    
+    func testShadeless() throws {
+        try assertRenderingMatchesReference("Shadeless")
+    }
+    
+    func testStaticTRLBasic() throws {
+        try assertRenderingMatchesReference("StaticTRLBasic")
+    }
+    
+    func testStaticTRLNextGen() throws {
+        try assertRenderingMatchesReference("StaticTRLNextGen")
+    }
+    
+    func testStaticTRLShadeless() throws {
+        try assertRenderingMatchesReference("StaticTRLShadeless")
+    }
+    
+    func testStaticTRUDiffuse() throws {
+        try assertRenderingMatchesReference("StaticTRUDiffuse")
+    }
+    
+    func testStaticTRUDiffuseLightmap() throws {
+        try assertRenderingMatchesReference("StaticTRUDiffuseLightmap")
+    }
+    
+    func testMissingTextureIsReported() throws {
+        let shader = GLLSoftwareSceneRendererTest.referenceShaders["Diffuse"]!
+        let (document, camera) = try self.document(shader: shader)
+        try FileManager.default.removeItem(at: directory.appendingPathComponent(GLLSoftwareSceneRendererTest.textureFiles["diffuseTexture"]!))
+        
+        // Drawn with the default texture instead
+        let renderer = GLLSoftwareSceneRenderer(managedObjectContext: document.managedObjectContext!, camera: camera)
+        try renderer.writeImage(to: directory.appendingPathComponent("missing.png"), fileType: .png, size: CGSize(width: 64, height: 64), transparentBackground: false)
+        XCTAssertEqual(renderer.replacedTextures.count, 1)
+    }
+    
+    func testMoreThanThreeDirectionalLights() throws {
+        let shader = GLLSoftwareSceneRendererTest.referenceShaders["Diffuse"]!
+        let (document, camera) = try self.document(shader: shader)
+        let context = document.managedObjectContext!
+        for index in 4 ... 5 {
+            let light = NSEntityDescription.insertNewObject(forEntityName: "GLLDirectionalLight", into: context) as! GLLDirectionalLight
+            light.isEnabled = true
+            light.diffuseColor = .white
+            light.specularColor = .white
+            light.index = Int64(index)
+        }
+        let lights = try context.fetch(NSFetchRequest<GLLDirectionalLight>(entityName: "GLLDirectionalLight")).sorted { $0.index < $1.index }
+        XCTAssertEqual(lights.count, 5)
+        
+        lights[1].isEnabled = true
+        
+        // The disabled one is left out, and all enabled ones are used, in order
+        let enabled = GLLDirectionalLight.enabledUniformBlocks(lights)
+        XCTAssertEqual(enabled.count, 4)
+        XCTAssertEqual(enabled.map { $0.direction }, [lights[0], lights[1], lights[3], lights[4]].map { $0.uniformBlock.direction })
+        
+        let renderer = GLLSoftwareSceneRenderer(managedObjectContext: context, camera: camera)
+        try renderer.writeImage(to: directory.appendingPathComponent("lights.png"), fileType: .png, size: CGSize(width: 64, height: 64), transparentBackground: false)
+        XCTAssertGreaterThan(renderer.statistics.shadedFragments, 0)
+    }
+}
@@ -0,0 +1,101 @@
+//
+//  GLLStreamingImageEncoderTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+import CoreGraphics
+import ImageIO
+import UniformTypeIdentifiers
+
+class GLLStreamingImageEncoderTest: XCTestCase {
+    
+    func testChecksums() {
+        var crc = GLLStreamingImageEncoder.CRC32()
+        crc.update("123456789".data(using: .ascii)!)
+        XCTAssertEqual(crc.value, 0xCBF43926)
+        
+        var adler = GLLStreamingImageEncoder.Adler32()
+        adler.update("Wikipedia".data(using: .ascii)!)
+        XCTAssertEqual(adler.value, 0x11E60398)
+    }
+    
+    // Opaque, so the decoder can't change anything by premultiplying
+    static func randomBGRA(width: Int, height: Int, generator: inout GLLCPUSkinnerTest.Generator) -> [UInt8] {
+        return (0 ..< width * height * 4).map { i in
+            i % 4 == 3 ? 255 : UInt8.random(in: 0 ... 255, using: &generator)
+        }
+    }
+    
+    static func encode(_ bgra: [UInt8], width: Int, height: Int, format: GLLStreamingImageEncoder.Format, rowsPerBatch: [Int]) throws -> Data {
+        var encoded = Data()
+        let encoder = try GLLStreamingImageEncoder(format: format, width: width, height: height) { encoded.append($0) }
+        var row = 0
+        var batch = 0
+        try bgra.withUnsafeBytes { bytes in
+            while row < height {
+                let count = min(rowsPerBatch[batch % rowsPerBatch.count], height - row)
+                try encoder.append(bgra8Rows: UnsafeRawBufferPointer(rebasing: bytes[row * width * 4 ..< (row + count) * width * 4]), bytesPerRow: width * 4, count: count)
+                row += count
+                batch += 1
+            }
+        }
+        try encoder.finish()
+        return encoded
+    }
+    
+    func assertDecodes(_ data: Data, to bgra: [UInt8], width: Int, height: Int, file: StaticString = #filePath, line: UInt = #line) throws {
+        let source = try XCTUnwrap(CGImageSourceCreateWithData(data as CFData, nil), file: file, line: line)
+        let image = try XCTUnwrap(CGImageSourceCreateImageAtIndex(source, 0, nil), file: file, line: line)
+        XCTAssertEqual(image.width, width, file: file, line: line)
+        XCTAssertEqual(image.height, height, file: file, line: line)
+        XCTAssertEqual(image.bitsPerPixel, 32, file: file, line: line)
+        
+        // Compare the data as stored, not as drawn, so no color matching gets in the way
+        let decoded = try XCTUnwrap(image.dataProvider?.data as Data?, file: file, line: line)
+        var mismatches = 0
+        for y in 0 ..< height {
+            for x in 0 ..< width {
+                let stored = y * image.bytesPerRow + x * 4
+                let original = (y * width + x) * 4
+                if decoded[stored + 0] != bgra[original + 2] || decoded[stored + 1] != bgra[original + 1] || decoded[stored + 2] != bgra[original + 0] || decoded[stored + 3] != bgra[original + 3] {
+                    mismatches += 1
+                }
+            }
+        }
+        XCTAssertEqual(mismatches, 0, file: file, line: line)
+    }
+    
+    func testPNGRoundTrip() throws {
+        var generator = GLLCPUSkinnerTest.Generator(state: 42)
+        let bgra = GLLStreamingImageEncoderTest.randomBGRA(width: 97, height: 61, generator: &generator)
+        let data = try GLLStreamingImageEncoderTest.encode(bgra, width: 97, height: 61, format: .png, rowsPerBatch: [1, 7, 32])
+        try assertDecodes(data, to: bgra, width: 97, height: 61)
+    }
+    
+    func testTIFFRoundTrip() throws {
+        var generator = GLLCPUSkinnerTest.Generator(state: 43)
+        // Wide enough for several strips
+        let bgra = GLLStreamingImageEncoderTest.randomBGRA(width: 1001, height: 83, generator: &generator)
+        let data = try GLLStreamingImageEncoderTest.encode(bgra, width: 1001, height: 83, format: .tiff, rowsPerBatch: [5, 16, 3])
+        try assertDecodes(data, to: bgra, width: 1001, height: 83)
+    }
+    
+    func testFormatFromFileType() {
+        XCTAssertEqual(GLLStreamingImageEncoder.Format(fileType: .png), .png)
+        XCTAssertEqual(GLLStreamingImageEncoder.Format(fileType: .tiff), .tiff)
+        XCTAssertNil(GLLStreamingImageEncoder.Format(fileType: .jpeg))
+    }
+    
+    func testPNGEncodingPerformance() throws {
+        var generator = GLLCPUSkinnerTest.Generator(state: 44)
+        let bgra = GLLStreamingImageEncoderTest.randomBGRA(width: 2048, height: 256, generator: &generator)
+        
+        measure {
+            _ = try? GLLStreamingImageEncoderTest.encode(bgra, width: 2048, height: 256, format: .png, rowsPerBatch: [256])
+        }
+    }
+}
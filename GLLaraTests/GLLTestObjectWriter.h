@@ -22,6 +22,11 @@
 - (void)setNumUVLayers:(NSUInteger)layers forMesh:(NSUInteger)mesh;
 - (void)addTextureFilename:(NSString *)name uvLayer:(NSUInteger)layer toMesh:(NSUInteger)mesh;
 - (void)setRenderGroup:(NSUInteger)group renderParameterValues:(NSArray *)values forMesh:(NSUInteger)mesh;
+/*!
+ * @abstract Makes the mesh an optional part with the mesh's name, which starts out shown or hidden.
+ * @discussion Only has an effect if the mesh has a render group.
+ */
+- (void)setOptionalPartVisible:(BOOL)visible forMesh:(NSUInteger)mesh;
 
 @property (nonatomic, readonly) NSString *testFileString;
 
@@ -30,6 +30,7 @@ enum quadDirection
     NSMutableArray *meshes;
 }
 
+- (NSString *)_nameOfMesh:(NSUInteger)mesh;
 - (NSString *)_vertexAt:(enum quadPosition)position direction:(enum quadDirection)direction quadCenter:(const float *)center bonesLowX:(const uint16_t *)bonesLowX bonesHighX:(const uint16_t *)bonesHighX numTexCoords:(NSUInteger)numTexCoords;
 - (NSString *)_quadWithDirection:(enum quadDirection)direction cubeCenter:(const float *)center bonesLowX:(const uint16_t *)bonesLowX bonesHighX:(const uint16_t *)bonesHighX numTexCoords:(NSUInteger)numTexCoords;
 
@@ -67,10 +68,13 @@ enum quadDirection
 
 - (void)setRenderGroup:(NSUInteger)group renderParameterValues:(NSArray *)values forMesh:(NSUInteger)mesh;
 {
-    NSMutableString *name = [NSMutableString stringWithFormat:@"%lu_mesh%lu", group, mesh];
-    for (id value in values)
-        [name appendFormat:@"_%@", value];
-    meshes[mesh][@"name"] = name;
+    meshes[mesh][@"group"] = @(group);
+    meshes[mesh][@"renderParameterValues"] = values;
+}
+
+- (void)setOptionalPartVisible:(BOOL)visible forMesh:(NSUInteger)mesh;
+{
+    meshes[mesh][@"optionalPrefix"] = visible ? @"+" : @"-";
 }
 
 - (NSString *)testFileString
@@ -93,7 +97,7 @@ enum quadDirection
     {
         NSDictionary *description = meshes[i];
         NSUInteger numTexCoords = [description[@"layers"] unsignedIntegerValue];
-        [result appendFormat:@"%@\n%lu\n%lu\n", description[@"name"], numTexCoords, [description[@"textures"] count]];
+        [result appendFormat:@"%@\n%lu\n%lu\n", [self _nameOfMesh:i], numTexCoords, [description[@"textures"] count]];
         for (NSDictionary *texture in description[@"textures"])
             [result appendFormat:@"%@\n%@\n", texture[@"name"], texture[@"layer"]];
         
@@ -162,6 +166,19 @@ enum quadDirection
 
 #pragma mark - Private methods
 
+- (NSString *)_nameOfMesh:(NSUInteger)mesh
+{
+    NSDictionary *description = meshes[mesh];
+    if (!description[@"group"])
+        return description[@"name"];
+    
+    NSString *optionalPrefix = description[@"optionalPrefix"] ?: @"";
+    NSMutableString *name = [NSMutableString stringWithFormat:@"%@_%@mesh%lu", description[@"group"], optionalPrefix, mesh];
+    for (id value in description[@"renderParameterValues"])
+        [name appendFormat:@"_%@", value];
+    return name;
+}
+
 - (NSString *)_quadWithDirection:(enum quadDirection)direction cubeCenter:(const float *)center bonesLowX:(const uint16_t *)bonesLowX bonesHighX:(const uint16_t *)bonesHighX numTexCoords:(NSUInteger)numTexCoords;
 {
     NSMutableString *result = [NSMutableString string];
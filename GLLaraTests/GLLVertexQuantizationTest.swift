@@ -0,0 +1,112 @@
+//
+//  GLLVertexQuantizationTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLVertexQuantizationTest: XCTestCase {
+    
+    func randomNormals(count: Int, generator: inout GLLCPUSkinnerTest.Generator) -> [SIMD3<Float>] {
+        var result: [SIMD3<Float>] = []
+        while result.count < count {
+            let vector = GLLCPUSkinnerTest.randomVector(generator: &generator)
+            if simd_length_squared(vector) > 0.01 {
+                result.append(simd_normalize(vector))
+            }
+        }
+        // The axes and the edges of the octahedron are the difficult cases
+        result.append(contentsOf: [SIMD3<Float>(1, 0, 0), SIMD3<Float>(-1, 0, 0), SIMD3<Float>(0, 1, 0), SIMD3<Float>(0, -1, 0), SIMD3<Float>(0, 0, 1), SIMD3<Float>(0, 0, -1), simd_normalize(SIMD3<Float>(1, -1, 0)), simd_normalize(SIMD3<Float>(-1, -1, -0.0001))])
+        return result
+    }
+    
+    func testOctahedralRoundTrip() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 90)
+        for normal in randomNormals(count: 10000, generator: &generator) {
+            let decoded = GLLVertexQuantization.decodeOctahedral(GLLVertexQuantization.octahedral(normal))
+            GLLCPUSkinnerTest.assertEqual(decoded, normal, accuracy: 1e-4)
+        }
+    }
+    
+    func testTangentKeepsSign() {
+        let tangent = GLLVertexQuantization.tangent(SIMD4<Float>(0, 0, -1, -1))
+        XCTAssertEqual(tangent.z, -Int16.max)
+        XCTAssertEqual(GLLVertexQuantization.decodeOctahedral(SIMD2<Int16>(tangent.x, tangent.y)), SIMD3<Float>(0, 0, -1))
+        XCTAssertEqual(GLLVertexQuantization.tangent(SIMD4<Float>(1, 0, 0, 1)).z, Int16.max)
+    }
+    
+    func testWeightsAddUpTo255() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 91)
+        for _ in 0 ..< 10000 {
+            var weights = SIMD4<Float>(Float.random(in: 0 ..< 1, using: &generator), Float.random(in: 0 ..< 1, using: &generator), Float.random(in: 0 ..< 1, using: &generator), Float.random(in: 0 ..< 1, using: &generator))
+            // Often only one or two bones
+            for i in 0 ..< 4 where Bool.random(using: &generator) {
+                weights[i] = 0
+            }
+            let quantized = GLLVertexQuantization.weights(weights)
+            XCTAssertEqual(Int(quantized.x) + Int(quantized.y) + Int(quantized.z) + Int(quantized.w), 255)
+            
+            let sum = weights.sum()
+            for i in 0 ..< 4 {
+                if sum > 0 {
+                    XCTAssertEqual(Float(quantized[i]), weights[i] / sum * 255, accuracy: 1)
+                }
+                if weights[i] == 0 && sum > 0 {
+                    XCTAssertEqual(quantized[i], 0)
+                }
+            }
+        }
+        XCTAssertEqual(GLLVertexQuantization.weights(SIMD4<Float>(0, 0, 0, 0)), SIMD4<UInt8>(255, 0, 0, 0))
+        XCTAssertEqual(GLLVertexQuantization.weights(SIMD4<Float>(1, 1, 1, 0)), SIMD4<UInt8>(85, 85, 85, 0))
+        XCTAssertEqual(GLLVertexQuantization.weights(SIMD4<Float>(.nan, 1, 0, 0)), SIMD4<UInt8>(0, 255, 0, 0))
+    }
+    
+    func testPositionsThroughMatrix() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 92)
+        // A character about 1.8 high; the largest error is half a step along each axis
+        let positions = (0 ..< 5000).map { _ in GLLCPUSkinnerTest.randomVector(generator: &generator) * SIMD3<Float>(0.4, 0.9, 0.2) + SIMD3<Float>(0, 0.9, 0) }
+        let quantization = GLLVertexQuantization(positions: positions)
+        let halfStep = simd_length(quantization.scale) / Float(UInt16.max) / 2
+        
+        let boneTransforms = GLLCPUSkinnerTest.randomTransforms(count: 1, generator: &generator)
+        for position in positions {
+            let quantized = quantization.position(position)
+            XCTAssertEqual(quantized.w, UInt16.max)
+            
+            // What the shader does: the unorm value goes through the bone matrix that has the dequantization folded in
+            let normalized = SIMD4<Float>(Float(quantized.x), Float(quantized.y), Float(quantized.z), Float(quantized.w)) / Float(UInt16.max)
+            let folded = boneTransforms[0] * quantization.dequantization * normalized
+            let expected = boneTransforms[0] * SIMD4<Float>(position, 1)
+            GLLCPUSkinnerTest.assertEqual(SIMD3<Float>(folded.x, folded.y, folded.z), SIMD3<Float>(expected.x, expected.y, expected.z), accuracy: halfStep * 4)
+        }
+        
+        let errors = quantization.errors(positions: positions, normals: randomNormals(count: 5000, generator: &generator))
+        XCTAssertLessThanOrEqual(errors.position, halfStep * 1.1)
+        XCTAssertLessThan(errors.normalDegrees, 0.01)
+    }
+    
+    func testFlatMeshHasInvertibleScale() {
+        let quantization = GLLVertexQuantization(positions: [SIMD3<Float>(0, 1, 2), SIMD3<Float>(4, 1, 3)])
+        XCTAssertEqual(quantization.scale, SIMD3<Float>(4, 1, 1))
+        GLLCPUSkinnerTest.assertEqual(quantization.decodePosition(quantization.position(SIMD3<Float>(2, 1, 2.5))), SIMD3<Float>(2, 1, 2.5))
+        
+        // Normals go through the scaled bone matrix and then get the inverse scale
+        let normal = simd_normalize(SIMD3<Float>(1, 2, 3))
+        let scaledBack = quantization.inverseScale * normal
+        let dequantization = quantization.dequantization
+        let upperLeft = matrix_float3x3(columns: (SIMD3<Float>(dequantization.columns.0.x, dequantization.columns.0.y, dequantization.columns.0.z), SIMD3<Float>(dequantization.columns.1.x, dequantization.columns.1.y, dequantization.columns.1.z), SIMD3<Float>(dequantization.columns.2.x, dequantization.columns.2.y, dequantization.columns.2.z)))
+        GLLCPUSkinnerTest.assertEqual(upperLeft * scaledBack, normal, accuracy: 1e-6)
+        XCTAssertEqual(quantization.normalPermutation(matrix_identity_float4x4).columns.3, SIMD4<Float>(0.25, 1, 1, 1))
+    }
+    
+    func testEncodingPerformance() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 93)
+        let normals = randomNormals(count: 100000, generator: &generator)
+        measure {
+            _ = normals.map { GLLVertexQuantization.octahedral($0) }
+        }
+    }
+}
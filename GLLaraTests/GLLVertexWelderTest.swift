@@ -0,0 +1,134 @@
+//
+//  GLLVertexWelderTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class GLLVertexWelderTest: XCTestCase {
+    
+    // A grid of quads where every quad has its own four vertices, the way exporters that write one vertex per corner do it, plus unused vertices at the end
+    func quadSoup(size: Int, unused: Int = 0) -> (vertices: GLLVertexWelder.Vertices, positions: [SIMD3<Float>], indices: [UInt32]) {
+        var positions: [SIMD3<Float>] = []
+        var texCoords: [Float] = []
+        var indices: [UInt32] = []
+        for y in 0 ..< size {
+            for x in 0 ..< size {
+                let base = UInt32(positions.count)
+                for corner in [SIMD2<Int>(0, 0), SIMD2<Int>(1, 0), SIMD2<Int>(1, 1), SIMD2<Int>(0, 1)] {
+                    positions.append(SIMD3<Float>(Float(x + corner.x) * 0.1, Float(y + corner.y) * 0.1, 0))
+                    texCoords.append(contentsOf: [Float(x + corner.x) / Float(size), Float(y + corner.y) / Float(size)])
+                }
+                indices.append(contentsOf: [base, base + 1, base + 2, base, base + 2, base + 3])
+            }
+        }
+        for i in 0 ..< unused {
+            positions.append(SIMD3<Float>(Float(i), -1, 0))
+            texCoords.append(contentsOf: [0, 0])
+        }
+        
+        var vertices = GLLVertexWelder.Vertices(count: positions.count)
+        vertices.append(floats: positions.flatMap { [$0.x, $0.y, $0.z] }, perVertex: 3, tolerance: GLLVertexWelder.defaultTolerance)
+        vertices.append(floats: positions.flatMap { _ in [Float(0), 0, 1] }, perVertex: 3, tolerance: GLLVertexWelder.defaultTolerance)
+        vertices.append(floats: texCoords, perVertex: 2, tolerance: GLLVertexWelder.defaultTolerance)
+        vertices.append(bytes: positions.flatMap { _ in [UInt8(255), 255, 255, 255] }, perVertex: 4)
+        return (vertices, positions, indices)
+    }
+    
+    func testWeldsQuadSoup() {
+        let mesh = quadSoup(size: 10, unused: 7)
+        let welder = GLLVertexWelder(vertices: mesh.vertices, indices: mesh.indices, positions: mesh.positions)
+        
+        XCTAssertEqual(welder.vertices.count, 11 * 11)
+        XCTAssertEqual(welder.indices.count, mesh.indices.count)
+        XCTAssertEqual(welder.statistics.mergedVertices, 400 - 121)
+        XCTAssertEqual(welder.statistics.unreferencedVertices, 7)
+        XCTAssertEqual(welder.statistics.degenerateTriangles, 0)
+        
+        // Same triangles as before, just with different vertices
+        for (old, new) in zip(mesh.indices, welder.indices) {
+            XCTAssertEqual(mesh.positions[Int(old)], mesh.positions[Int(welder.vertices[Int(new)])])
+        }
+        // Kept vertices stay in their original order
+        XCTAssertEqual(welder.vertices, welder.vertices.sorted())
+    }
+    
+    func testKeepsVerticesThatDifferInOneAttribute() {
+        var mesh = quadSoup(size: 4)
+        // Give the first quad a different color; its corners must not merge with those of its neighbours
+        for vertex in 0 ..< 4 {
+            mesh.vertices.bytes[vertex * 4] = 0
+        }
+        let welder = GLLVertexWelder(vertices: mesh.vertices, indices: mesh.indices, positions: mesh.positions)
+        XCTAssertEqual(welder.vertices.count, 5 * 5 + 3)
+    }
+    
+    func testWeldsWithinTolerance() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 80)
+        var mesh = quadSoup(size: 8)
+        // Noise much smaller than the tolerance; the grid cells are tolerance wide, so use values well inside one
+        for i in 0 ..< mesh.vertices.floats.count {
+            let value = mesh.vertices.floats[i]
+            let cell = (value / GLLVertexWelder.defaultTolerance).rounded(.down) * GLLVertexWelder.defaultTolerance
+            mesh.vertices.floats[i] = cell + GLLVertexWelder.defaultTolerance * Float.random(in: 0.3 ..< 0.7, using: &generator)
+        }
+        let welder = GLLVertexWelder(vertices: mesh.vertices, indices: mesh.indices)
+        XCTAssertEqual(welder.vertices.count, 9 * 9)
+        
+        // With a tolerance of 0, nothing is equal anymore
+        var exact = mesh.vertices
+        exact.tolerances = Array(repeating: 0, count: exact.floatsPerVertex)
+        let exactWelder = GLLVertexWelder(vertices: exact, indices: mesh.indices)
+        XCTAssertEqual(exactWelder.statistics.mergedVertices, 0)
+    }
+    
+    func testRemovesDegenerateTriangles() {
+        let mesh = quadSoup(size: 3)
+        var indices = mesh.indices
+        // Same vertex twice
+        indices.append(contentsOf: [0, 0, 5])
+        // Different vertices that are the same after welding; 1 and 4 are both at (0.1, 0, 0)
+        indices.append(contentsOf: [1, 4, 2])
+        // Three vertices in a line
+        indices.append(contentsOf: [0, 1, 5])
+        let welder = GLLVertexWelder(vertices: mesh.vertices, indices: indices, positions: mesh.positions)
+        XCTAssertEqual(welder.statistics.degenerateTriangles, 3)
+        XCTAssertEqual(welder.indices.count, mesh.indices.count)
+        
+        // Without positions, only the ones that use a vertex twice can be found
+        let withoutPositions = GLLVertexWelder(vertices: mesh.vertices, indices: indices)
+        XCTAssertEqual(withoutPositions.statistics.degenerateTriangles, 2)
+    }
+    
+    func testTreatsZeroAndNegativeZeroAsEqual() {
+        var vertices = GLLVertexWelder.Vertices(count: 3)
+        vertices.append(floats: [0, 1, -0.0, 1, 2, 2], perVertex: 2, tolerance: 0)
+        let welder = GLLVertexWelder(vertices: vertices, indices: [0, 1, 2, 1, 0, 2])
+        XCTAssertEqual(welder.statistics.mergedVertices, 1)
+        XCTAssertEqual(welder.statistics.degenerateTriangles, 2)
+    }
+    
+    func testConcurrentMatchesSerial() {
+        var generator = GLLCPUSkinnerTest.Generator(state: 81)
+        let mesh = quadSoup(size: 150, unused: 1000)
+        // Shuffle the triangles so the order is less regular
+        var triangles = (0 ..< mesh.indices.count / 3).map { $0 }
+        triangles.shuffle(using: &generator)
+        let indices = triangles.flatMap { mesh.indices[$0 * 3 ..< $0 * 3 + 3] }
+        
+        let concurrent = GLLVertexWelder(vertices: mesh.vertices, indices: indices, positions: mesh.positions, concurrent: true)
+        let serial = GLLVertexWelder(vertices: mesh.vertices, indices: indices, positions: mesh.positions, concurrent: false)
+        XCTAssertEqual(concurrent.vertices, serial.vertices)
+        XCTAssertEqual(concurrent.indices, serial.indices)
+    }
+    
+    func testWeldPerformance() {
+        let mesh = quadSoup(size: 300)
+        measure {
+            _ = GLLVertexWelder(vertices: mesh.vertices, indices: mesh.indices, positions: mesh.positions)
+        }
+    }
+}
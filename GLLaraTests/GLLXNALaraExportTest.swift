@@ -0,0 +1,97 @@
+//
+//  GLLXNALaraExportTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+@testable import GLLara
+
+class GLLXNALaraExportTest: XCTestCase {
+    
+    var sourceURL: URL!
+    var document: GLLDocument!
+    var item: GLLItem!
+    
+    override func setUpWithError() throws {
+        sourceURL = try XCTUnwrap(Bundle(for: GLLXNALaraExportTest.self).url(forResource: "generic_item.mesh", withExtension: "ascii"))
+        document = try GLLDocument(type: "de.ferroequinologist.gllara.scene")
+        item = try document.addModel(at: sourceURL)
+    }
+    
+    override func tearDownWithError() throws {
+        item = nil
+        document = nil
+    }
+    
+    // The whole export in memory. GLLExportSink.swift is also part of the test target, so this has to name the app's sink explicitly.
+    func export(_ write: (GLLara.GLLExportSink) throws -> Void) throws -> Data {
+        var data = Data()
+        let sink = GLLara.GLLExportSink { data.append($0) }
+        try write(sink)
+        try sink.flush()
+        XCTAssertEqual(sink.bytesWritten, data.count)
+        return data
+    }
+    
+    // Fixed four bones per vertex, which is all the XNALara formats can store
+    func boneData(of mesh: GLLModelMesh, file: StaticString = #filePath, line: UInt = #line) -> (indices: [SIMD4<UInt16>], weights: [SIMD4<Float>]) {
+        guard case .fixed(let indices, let weights) = mesh.cpuBoneData else {
+            XCTFail("\(mesh.name) has no fixed bone data", file: file, line: line)
+            return ([], [])
+        }
+        return (indices, weights)
+    }
+    
+    /**
+     * # Compares a model read back from an export with the item's model.
+     *
+     * An unposed export writes the vertices as they are, and the shortest round-trip text makes ASCII exact as well, so everything has to match exactly.
+     */
+    func assertMatchesSource(_ exported: GLLModel, file: StaticString = #filePath, line: UInt = #line) throws {
+        let source = item.model!
+        XCTAssertEqual(exported.bones.map { $0.name }, source.bones.map { $0.name }, file: file, line: line)
+        XCTAssertEqual(exported.bones.map { $0.position }, source.bones.map { $0.position }, file: file, line: line)
+        
+        let sourceMeshes = item.meshes.map { $0 as! GLLItemMesh }.filter { $0.shouldExport }.map { $0.mesh! }
+        XCTAssertEqual(sourceMeshes.count, source.meshes.count, file: file, line: line)
+        XCTAssertEqual(exported.meshes.count, sourceMeshes.count, file: file, line: line)
+        for (exportedMesh, sourceMesh) in zip(exported.meshes, sourceMeshes) {
+            let count = sourceMesh.countOfVertices
+            XCTAssertEqual(exportedMesh.countOfVertices, count, file: file, line: line)
+            XCTAssertEqual(exportedMesh.countOfUVLayers, sourceMesh.countOfUVLayers, file: file, line: line)
+            guard exportedMesh.countOfVertices == count else {
+                continue
+            }
+            
+            let exportedAccessors = try XCTUnwrap(exportedMesh.vertexDataAccessors, file: file, line: line)
+            let sourceAccessors = try XCTUnwrap(sourceMesh.vertexDataAccessors, file: file, line: line)
+            XCTAssertEqual(exportedAccessors.accessor(semantic: .position)!.simdArray(count: count, type: SIMD3<Float>.self), sourceAccessors.accessor(semantic: .position)!.simdArray(count: count, type: SIMD3<Float>.self), file: file, line: line)
+            for layer in 0 ..< sourceMesh.countOfUVLayers {
+                XCTAssertEqual(exportedAccessors.accessor(semantic: .texCoord0, layer: layer)!.simdArray(count: count, type: SIMD2<Float>.self), sourceAccessors.accessor(semantic: .texCoord0, layer: layer)!.simdArray(count: count, type: SIMD2<Float>.self), file: file, line: line)
+            }
+            
+            let exportedBones = boneData(of: exportedMesh, file: file, line: line)
+            let sourceBones = boneData(of: sourceMesh, file: file, line: line)
+            XCTAssertEqual(exportedBones.indices, sourceBones.indices, file: file, line: line)
+            XCTAssertEqual(exportedBones.weights, sourceBones.weights, file: file, line: line)
+            
+            XCTAssertEqual(exportedMesh.usedElements, sourceMesh.usedElements, file: file, line: line)
+        }
+    }
+    
+    func testBinaryRoundTrip() throws {
+        let data = try export { try item.writeBinary(posed: false, to: $0) }
+        let exported = try GLLModelXNALara(binaryFrom: data, baseURL: sourceURL, parent: nil)
+        try assertMatchesSource(exported)
+    }
+    
+    func testASCIIRoundTrip() throws {
+        let data = try export { try item.writeASCII(posed: false, to: $0) }
+        let exported = try GLLModelXNALara(asciiFrom: String(decoding: data, as: UTF8.self), baseURL: sourceURL, parent: nil)
+        try assertMatchesSource(exported)
+    }
+    
+}
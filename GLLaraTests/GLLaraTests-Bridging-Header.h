@@ -4,3 +4,6 @@
 
 #import "GLLItemBone.h"
 #import "GLLModelBone.h"
+#import "GLLSkeletonDrawerVertexFormat.h"
+#import "GLLTestObjectWriter.h"
+#import "GLLRenderParameters.h"
@@ -0,0 +1,155 @@
+//
+//  ObjFileTest.swift
+//  GLLaraTests
+//
+//  Created by Torsten Kammer on 19.10.26.
+//  Copyright © 2026 Torsten Kammer. All rights reserved.
+//
+
+import XCTest
+
+class ObjFileTest: XCTestCase {
+    
+    let baseURL = URL(fileURLWithPath: "/tmp/test.obj")
+    
+    /**
+     * # A grid like the ones photogrammetry tools export.
+     *
+     * Every vertex has its own tex coord and normal, faces are triangles. Optionally with relative indices, and with a new material every few rows.
+     */
+    static func photogrammetryObj(size: Int, relativeIndices: Bool = false, materials: Int = 1) -> Data {
+        var generator = GLLCPUSkinnerTest.Generator(state: 45)
+        var text = "mtllib scan.mtl\n"
+        text.reserveCapacity(size * size * 140)
+        for y in 0 ..< size {
+            for x in 0 ..< size {
+                let height = Float.random(in: -0.01 ... 0.01, using: &generator)
+                text += "v \(Float(x) / Float(size)) \(Float(y) / Float(size)) \(height)\n"
+                text += "vt \(Float(x) / Float(size - 1)) \(Float(y) / Float(size - 1))\n"
+                let normal = simd_normalize(SIMD3<Float>(height, -height, 1))
+                text += "vn \(normal.x) \(normal.y) \(normal.z)\n"
+            }
+        }
+        let count = size * size
+        func corner(_ x: Int, _ y: Int) -> String {
+            let index = relativeIndices ? y * size + x - count : y * size + x + 1
+            return "\(index)/\(index)/\(index)"
+        }
+        for y in 0 ..< size - 1 {
+            if y % max((size - 1) / materials, 1) == 0 {
+                text += "usemtl material\(y)\n"
+            }
+            for x in 0 ..< size - 1 {
+                text += "f \(corner(x, y)) \(corner(x + 1, y)) \(corner(x + 1, y + 1))\n"
+                text += "f \(corner(x, y)) \(corner(x + 1, y + 1)) \(corner(x, y + 1))\n"
+            }
+        }
+        return text.data(using: .utf8)!
+    }
+    
+    func assertEqual(_ a: ObjFile, _ b: ObjFile, file: StaticString = #filePath, line: UInt = #line) {
+        XCTAssertEqual(a.indices, b.indices, file: file, line: line)
+        XCTAssertEqual(a.vertexData.count, b.vertexData.count, file: file, line: line)
+        for (first, second) in zip(a.vertexData, b.vertexData) {
+            XCTAssertTrue(first.vert == second.vert && first.norm == second.norm && first.tex == second.tex && first.color == second.color, file: file, line: line)
+        }
+        XCTAssertEqual(a.materialRanges.map { $0.start }, b.materialRanges.map { $0.start }, file: file, line: line)
+        XCTAssertEqual(a.materialRanges.map { $0.end }, b.materialRanges.map { $0.end }, file: file, line: line)
+        XCTAssertEqual(a.materialRanges.map { $0.materialName }, b.materialRanges.map { $0.materialName }, file: file, line: line)
+        XCTAssertEqual(a.materialLibraries, b.materialLibraries, file: file, line: line)
+    }
+    
+    func testSmallFile() throws {
+        let text = "# Exported by hand\r\nmtllib test.mtl\r\nv 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\nv 0 1 0\r\nvt 0 0\r\nvt 1 0\r\nvt 1 1\r\nvt 0 1\r\nvn 0 0 1\r\nusemtl first\r\nf 1/1/1 2/2/1 3/3/1 4/4/1\r\nusemtl second\r\nf -4//-1 -2//-1 -1//-1\r\n"
+        let file = try ObjFile(data: text.data(using: .utf8)!, baseURL: baseURL)
+        
+        // The quad becomes a fan, with the order reversed; the last face has no tex coords, so its corners are new
+        XCTAssertEqual(file.indices, [0, 1, 2, 0, 3, 1, 4, 5, 6])
+        XCTAssertEqual(file.vertexData.count, 7)
+        XCTAssertEqual(file.vertexData[1].vert, SIMD3<Float>(1, 1, 0))
+        XCTAssertEqual(file.vertexData[1].tex, SIMD2<Float>(1, 1))
+        XCTAssertEqual(file.vertexData[3].vert, SIMD3<Float>(0, 1, 0))
+        XCTAssertEqual(file.vertexData[5].vert, SIMD3<Float>(0, 1, 0))
+        XCTAssertEqual(file.vertexData[5].tex, SIMD2<Float>(0, 0))
+        XCTAssertEqual(file.vertexData[5].norm, SIMD3<Float>(0, 0, 1))
+        XCTAssertEqual(file.vertexData[5].color, SIMD4<Float>(1, 1, 1, 1))
+        
+        XCTAssertEqual(file.materialRanges.map { $0.materialName }, ["first", "second"])
+        XCTAssertEqual(file.materialRanges.map { $0.start }, [0, 6])
+        XCTAssertEqual(file.materialRanges.map { $0.end }, [6, 9])
+        XCTAssertEqual(file.materialLibraries.map { $0.lastPathComponent }, ["test.mtl"])
+    }
+    
+    func testNumbers() throws {
+        let text = "v 1e-3 -2.5E+2 0.1234567890123456789\nv +4 .5 -0.000001\nv nan inf 12345678901234567890\nvn 0 1 0\nvt 0.25 0.75\nvc 0.5 0.25\nf 1//-1 2 3/-1/1/1\n"
+        let file = try ObjFile(data: text.data(using: .utf8)!, baseURL: baseURL)
+        XCTAssertEqual(file.vertexData.count, 3)
+        XCTAssertEqual(file.vertexData[0].vert.x, 1e-3)
+        XCTAssertEqual(file.vertexData[0].vert.y, -250)
+        XCTAssertEqual(file.vertexData[0].vert.z, 0.1234567890123456789)
+        // Reversed, so this is the second one
+        XCTAssertEqual(file.vertexData[2].vert, SIMD3<Float>(4, 0.5, -0.000001))
+        XCTAssertTrue(file.vertexData[1].vert.x.isNaN)
+        XCTAssertEqual(file.vertexData[1].vert.y, .infinity)
+        XCTAssertEqual(file.vertexData[1].vert.z, 12345678901234567890)
+        // Missing values are 0
+        XCTAssertEqual(file.vertexData[1].color, SIMD4<Float>(0.5, 0.25, 0, 0))
+        XCTAssertEqual(file.vertexData[1].tex, SIMD2<Float>(0.25, 0.75))
+        XCTAssertEqual(file.vertexData[0].norm, SIMD3<Float>(0, 1, 0))
+        XCTAssertEqual(file.vertexData[2].norm, SIMD3<Float>(0, 0, 0))
+    }
+    
+    func testIndexOutOfRange() {
+        XCTAssertThrowsError(try ObjFile(data: "v 0 0 0\nf 1 2 3\n".data(using: .utf8)!, baseURL: baseURL))
+        XCTAssertThrowsError(try ObjFile(data: "v 0 0 0\nf 1 -1 -2\n".data(using: .utf8)!, baseURL: baseURL))
+        XCTAssertThrowsError(try ObjFile(data: "v 0 0 0\nf 1/1 1/1 1/1\n".data(using: .utf8)!, baseURL: baseURL))
+        // Not a face, so nothing wrong with it
+        XCTAssertNoThrow(try ObjFile(data: "v 0 0 0\nf 1 2\nfo 1 2 3".data(using: .utf8)!, baseURL: baseURL))
+    }
+    
+    func testChunksGiveSameResult() throws {
+        for relativeIndices in [false, true] {
+            let data = ObjFileTest.photogrammetryObj(size: 40, relativeIndices: relativeIndices, materials: 3)
+            let whole = try ObjFile(data: data, baseURL: baseURL, chunkCount: 1)
+            XCTAssertEqual(whole.indices.count, 39 * 39 * 6)
+            XCTAssertEqual(whole.vertexData.count, 40 * 40)
+            XCTAssertEqual(whole.materialRanges.count, 3)
+            for chunkCount in [2, 3, 17, 500] {
+                assertEqual(try ObjFile(data: data, baseURL: baseURL, chunkCount: chunkCount), whole)
+            }
+        }
+        // Without anything in it
+        let empty = try ObjFile(data: Data(), baseURL: baseURL, chunkCount: 4)
+        XCTAssertTrue(empty.indices.isEmpty)
+        XCTAssertEqual(empty.materialRanges.count, 1)
+    }
+    
+    func testCornerTable() {
+        var table = ObjFile.CornerTable(minimumCapacity: 1)
+        var generator = GLLCPUSkinnerTest.Generator(state: 46)
+        var reference: [ObjFile.Corner: Int] = [:]
+        for _ in 0 ..< 20000 {
+            let corner = ObjFile.Corner(Int32.random(in: 0 ..< 100, using: &generator), Int32.random(in: -1 ..< 50, using: &generator), Int32.random(in: -1 ..< 3, using: &generator), -1)
+            let expected = reference[corner] ?? reference.count
+            reference[corner] = expected
+            XCTAssertEqual(table.index(of: corner, insertingAs: reference.count - 1), expected)
+        }
+        XCTAssertEqual(table.count, reference.count)
+    }
+    
+    /**
+     * Parses a generated file of about 90 MB. Set GLLARA_OBJ_BENCHMARK_FILE to the path of a real export (for example a 1 GB photogrammetry prop) to measure that instead.
+     */
+    func testPerformanceParse() throws {
+        let data: Data
+        if let path = ProcessInfo.processInfo.environment["GLLARA_OBJ_BENCHMARK_FILE"] {
+            data = try Data(contentsOf: URL(fileURLWithPath: path), options: .mappedIfSafe)
+        } else {
+            data = ObjFileTest.photogrammetryObj(size: 640, materials: 4)
+        }
+        measure {
+            let file = try! ObjFile(data: data, baseURL: baseURL)
+            XCTAssertFalse(file.indices.isEmpty)
+        }
+    }
+}